@@ -0,0 +1,704 @@
+#include "duckdb_extension.h"
+#include "address_tracking.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// DHCP message types (option 53)
+#define DHCP_DISCOVER 1
+#define DHCP_OFFER 2
+#define DHCP_REQUEST 3
+#define DHCP_DECLINE 4
+#define DHCP_ACK 5
+#define DHCP_NAK 6
+#define DHCP_RELEASE 7
+#define DHCP_INFORM 8
+
+#define DHCP_FIXED_LEN 236
+#define DHCP_MAGIC_COOKIE 0x63825363
+
+// ICMPv6 neighbor discovery
+#define ND_ROUTER_ADVERT 134
+#define ND_NEIGHBOR_SOLICIT 135
+#define ND_NEIGHBOR_ADVERT 136
+#define ND_OPT_SOURCE_LINKADDR 1
+#define ND_OPT_TARGET_LINKADDR 2
+
+// Events produced by a single packet never exceed this
+#define ADDRESS_MAX_PENDING 8
+
+// Decoded DHCPv4 message
+typedef struct {
+    uint8_t message_type;
+    uint32_t xid;
+    const uint8_t *client_mac;
+    const uint8_t *client_ip;     // ciaddr
+    const uint8_t *your_ip;       // yiaddr
+    const uint8_t *server_id;     // option 54
+    const uint8_t *requested_ip;  // option 50
+    const uint8_t *hostname;      // option 12
+    uint8_t hostname_len;
+    const uint8_t *vendor_class;  // option 60
+    uint8_t vendor_class_len;
+    uint32_t lease_seconds;       // option 51
+    int has_lease;
+} dhcp_message_t;
+
+// Key of the IP binding table
+typedef struct {
+    uint16_t vlan_id;
+    uint8_t ip_version;
+    uint8_t reserved;
+    uint8_t ip[16];
+} binding_key_t;
+
+typedef struct {
+    uint64_t last_seen_ns;
+    uint8_t mac[6];
+    uint8_t mismatch_reported;
+} binding_t;
+
+// Key of the DHCP hostname table
+typedef struct {
+    uint8_t mac[6];
+    uint16_t vlan_id;
+} hostname_key_t;
+
+typedef struct {
+    char hostname[64];
+} hostname_t;
+
+// One output row of pcap_address_bindings
+typedef struct {
+    uint64_t timestamp_ns;
+    const char *protocol;
+    const char *event;
+    const char *alert;
+    uint16_t vlan_id;
+    char ip[46];
+    char mac[18];
+    char previous_mac[18];
+    char hostname[256];
+    uint32_t lease_seconds;
+    int has_lease;
+} address_event_t;
+
+typedef struct {
+    pcap_source_t *source;
+    hash_map_t bindings;      // binding_key_t -> binding_t
+    hash_map_t hostnames;     // hostname_key_t -> hostname_t
+    hash_map_t dhcp_servers;  // IPv4 address -> first seen
+    address_event_t pending[ADDRESS_MAX_PENDING];
+    idx_t pending_count;
+    idx_t pending_index;
+} address_state_t;
+
+enum {
+    ADDR_COL_TIMESTAMP,
+    ADDR_COL_PROTOCOL,
+    ADDR_COL_EVENT,
+    ADDR_COL_VLAN,
+    ADDR_COL_IP,
+    ADDR_COL_MAC,
+    ADDR_COL_PREVIOUS_MAC,
+    ADDR_COL_HOSTNAME,
+    ADDR_COL_LEASE,
+    ADDR_COL_ALERT,
+    ADDR_COL_COUNT
+};
+
+enum {
+    DHCP_COL_TIMESTAMP,
+    DHCP_COL_MESSAGE_TYPE,
+    DHCP_COL_XID,
+    DHCP_COL_CLIENT_MAC,
+    DHCP_COL_CLIENT_IP,
+    DHCP_COL_YOUR_IP,
+    DHCP_COL_SERVER_ID,
+    DHCP_COL_REQUESTED_IP,
+    DHCP_COL_HOSTNAME,
+    DHCP_COL_LEASE,
+    DHCP_COL_VENDOR_CLASS,
+    DHCP_COL_COUNT
+};
+
+static const char *DhcpMessageTypeName(uint8_t message_type) {
+    static const char *names[] = {"UNKNOWN", "DISCOVER", "OFFER", "REQUEST", "DECLINE",
+                                  "ACK",     "NAK",      "RELEASE", "INFORM"};
+    return message_type <= DHCP_INFORM ? names[message_type] : "UNKNOWN";
+}
+
+static int IsZeroIp(const uint8_t *ip) {
+    return !ip || (ip[0] | ip[1] | ip[2] | ip[3]) == 0;
+}
+
+static int ParseDhcp(const packet_info_t *pkt, dhcp_message_t *msg) {
+    if (pkt->ip_proto != IPPROTO_NUM_UDP || !pkt->payload || pkt->payload_len < DHCP_FIXED_LEN + 4) {
+        return 0;
+    }
+    if (!((pkt->src_port == DHCP_SERVER_PORT || pkt->src_port == DHCP_CLIENT_PORT) &&
+          (pkt->dst_port == DHCP_SERVER_PORT || pkt->dst_port == DHCP_CLIENT_PORT))) {
+        return 0;
+    }
+    const uint8_t *p = pkt->payload;
+    if (PacketRead32(p + DHCP_FIXED_LEN) != DHCP_MAGIC_COOKIE || p[1] != 1 || p[2] != 6) {
+        return 0;
+    }
+
+    memset(msg, 0, sizeof(dhcp_message_t));
+    msg->xid = PacketRead32(p + 4);
+    msg->client_ip = p + 12;
+    msg->your_ip = p + 16;
+    msg->client_mac = p + 28;
+
+    uint32_t offset = DHCP_FIXED_LEN + 4;
+    while (offset < pkt->payload_len) {
+        uint8_t code = p[offset++];
+        if (code == 0) {
+            continue;
+        }
+        if (code == 255 || offset >= pkt->payload_len) {
+            break;
+        }
+        uint8_t len = p[offset++];
+        if (offset + len > pkt->payload_len) {
+            break;
+        }
+        const uint8_t *value = p + offset;
+        switch (code) {
+        case 12:
+            msg->hostname = value;
+            msg->hostname_len = len;
+            break;
+        case 50:
+            if (len == 4) {
+                msg->requested_ip = value;
+            }
+            break;
+        case 51:
+            if (len == 4) {
+                msg->lease_seconds = PacketRead32(value);
+                msg->has_lease = 1;
+            }
+            break;
+        case 53:
+            if (len == 1) {
+                msg->message_type = value[0];
+            }
+            break;
+        case 54:
+            if (len == 4) {
+                msg->server_id = value;
+            }
+            break;
+        case 60:
+            msg->vendor_class = value;
+            msg->vendor_class_len = len;
+            break;
+        default:
+            break;
+        }
+        offset += len;
+    }
+    return msg->message_type != 0;
+}
+
+// Copy a length-delimited option into a NUL-terminated buffer, dropping
+// control characters
+static void CopyOptionString(const uint8_t *value, size_t len, char *out, size_t out_len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len && n + 1 < out_len; i++) {
+        if (value[i] >= 0x20 && value[i] < 0x7F) {
+            out[n++] = (char)value[i];
+        }
+    }
+    out[n] = '\0';
+}
+
+static void AddressInitDataFree(void *data) {
+    address_state_t *state = (address_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        HashMapDestroy(&state->bindings);
+        HashMapDestroy(&state->hostnames);
+        HashMapDestroy(&state->dhcp_servers);
+        duckdb_free(state);
+    }
+}
+
+static void AddressInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    address_state_t *state = (address_state_t *)duckdb_malloc(sizeof(address_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(address_state_t));
+    if (!HashMapInit(&state->bindings, sizeof(binding_key_t), sizeof(binding_t)) ||
+        !HashMapInit(&state->hostnames, sizeof(hostname_key_t), sizeof(hostname_t)) ||
+        !HashMapInit(&state->dhcp_servers, 4, sizeof(uint64_t))) {
+        AddressInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        AddressInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, AddressInitDataFree);
+}
+
+static address_event_t *PushEvent(address_state_t *state, uint64_t timestamp_ns, const char *protocol,
+                                  const char *event, uint16_t vlan_id) {
+    if (state->pending_count >= ADDRESS_MAX_PENDING) {
+        return NULL;
+    }
+    address_event_t *ev = &state->pending[state->pending_count++];
+    memset(ev, 0, sizeof(address_event_t));
+    ev->timestamp_ns = timestamp_ns;
+    ev->protocol = protocol;
+    ev->event = event;
+    ev->vlan_id = vlan_id;
+    return ev;
+}
+
+// Record that ip is at mac. Emits a 'new' or 'changed' event when the binding
+// differs from what is known and returns it so callers can add details.
+static address_event_t *ObserveBinding(address_state_t *state, uint64_t timestamp_ns, const char *protocol,
+                                       uint16_t vlan_id, uint8_t ip_version, const uint8_t *ip,
+                                       const uint8_t *mac) {
+    binding_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.vlan_id = vlan_id;
+    key.ip_version = ip_version;
+    memcpy(key.ip, ip, ip_version == 4 ? 4 : 16);
+
+    int is_new;
+    binding_t *binding = (binding_t *)HashMapInsert(&state->bindings, &key, &is_new);
+    if (!binding) {
+        return NULL;
+    }
+
+    address_event_t *ev = NULL;
+    if (is_new) {
+        ev = PushEvent(state, timestamp_ns, protocol, "new", vlan_id);
+    } else if (memcmp(binding->mac, mac, 6) != 0) {
+        ev = PushEvent(state, timestamp_ns, protocol, "changed", vlan_id);
+        if (ev) {
+            PacketFormatMac(binding->mac, ev->previous_mac, sizeof(ev->previous_mac));
+            if (timestamp_ns - binding->last_seen_ns < ADDRESS_CONFLICT_WINDOW_NS) {
+                ev->alert = "ip_conflict";
+            }
+        }
+        binding->mismatch_reported = 0;
+    }
+    memcpy(binding->mac, mac, 6);
+    binding->last_seen_ns = timestamp_ns;
+
+    if (ev) {
+        PacketFormatIp(ip_version, ip, ev->ip, sizeof(ev->ip));
+        PacketFormatMac(mac, ev->mac, sizeof(ev->mac));
+    }
+    return ev;
+}
+
+static void ProcessArp(address_state_t *state, uint64_t timestamp_ns, const packet_info_t *pkt) {
+    const uint8_t *p = pkt->l3;
+    if (pkt->l3_len < 28 || PacketRead16(p) != 1 || PacketRead16(p + 2) != ETHERTYPE_IPV4 || p[4] != 6 ||
+        p[5] != 4) {
+        return;
+    }
+    uint16_t operation = PacketRead16(p + 6);
+    const uint8_t *sender_mac = p + 8;
+    const uint8_t *sender_ip = p + 14;
+    const uint8_t *target_ip = p + 24;
+    if ((operation != 1 && operation != 2) || IsZeroIp(sender_ip)) {
+        // ARP probes (sender 0.0.0.0) do not claim an address
+        return;
+    }
+
+    address_event_t *ev = ObserveBinding(state, timestamp_ns, "arp", pkt->vlan_id, 4, sender_ip, sender_mac);
+    if (ev && memcmp(sender_ip, target_ip, 4) == 0 && !ev->alert && strcmp(ev->event, "changed") == 0) {
+        ev->alert = "gratuitous_arp_takeover";
+    }
+
+    // A sender hardware address that differs from the frame's source MAC is a
+    // classic sign of ARP spoofing (or a proxy); report it once per binding
+    if (pkt->src_mac && memcmp(pkt->src_mac, sender_mac, 6) != 0) {
+        binding_key_t key;
+        memset(&key, 0, sizeof(key));
+        key.vlan_id = pkt->vlan_id;
+        key.ip_version = 4;
+        memcpy(key.ip, sender_ip, 4);
+        binding_t *binding = (binding_t *)HashMapFind(&state->bindings, &key);
+        if (binding && !binding->mismatch_reported) {
+            binding->mismatch_reported = 1;
+            address_event_t *alert = PushEvent(state, timestamp_ns, "arp", "conflict", pkt->vlan_id);
+            if (alert) {
+                alert->alert = "arp_sender_mismatch";
+                PacketFormatIp(4, sender_ip, alert->ip, sizeof(alert->ip));
+                PacketFormatMac(sender_mac, alert->mac, sizeof(alert->mac));
+                PacketFormatMac(pkt->src_mac, alert->previous_mac, sizeof(alert->previous_mac));
+            }
+        }
+    }
+}
+
+static void ProcessDhcp(address_state_t *state, uint64_t timestamp_ns, const packet_info_t *pkt,
+                        const dhcp_message_t *msg) {
+    hostname_key_t host_key;
+    memset(&host_key, 0, sizeof(host_key));
+    memcpy(host_key.mac, msg->client_mac, 6);
+    host_key.vlan_id = pkt->vlan_id;
+    char hostname[64];
+    hostname[0] = '\0';
+    if (msg->hostname) {
+        CopyOptionString(msg->hostname, msg->hostname_len, hostname, sizeof(hostname));
+    }
+
+    switch (msg->message_type) {
+    case DHCP_DISCOVER:
+    case DHCP_REQUEST:
+    case DHCP_INFORM: {
+        if (!hostname[0]) {
+            break;
+        }
+        int is_new;
+        hostname_t *entry = (hostname_t *)HashMapInsert(&state->hostnames, &host_key, &is_new);
+        if (entry && strcmp(entry->hostname, hostname) != 0) {
+            memcpy(entry->hostname, hostname, sizeof(hostname));
+            address_event_t *ev = PushEvent(state, timestamp_ns, "dhcp", "hostname", pkt->vlan_id);
+            if (ev) {
+                PacketFormatMac(msg->client_mac, ev->mac, sizeof(ev->mac));
+                memcpy(ev->hostname, hostname, sizeof(hostname));
+                if (!IsZeroIp(msg->client_ip)) {
+                    PacketFormatIp(4, msg->client_ip, ev->ip, sizeof(ev->ip));
+                }
+            }
+        }
+        break;
+    }
+    case DHCP_ACK: {
+        if (IsZeroIp(msg->your_ip)) {
+            break;
+        }
+        address_event_t *ev = ObserveBinding(state, timestamp_ns, "dhcp", pkt->vlan_id, 4, msg->your_ip,
+                                             msg->client_mac);
+        if (ev) {
+            hostname_t *entry = (hostname_t *)HashMapFind(&state->hostnames, &host_key);
+            if (hostname[0]) {
+                memcpy(ev->hostname, hostname, sizeof(hostname));
+            } else if (entry) {
+                memcpy(ev->hostname, entry->hostname, sizeof(entry->hostname));
+            }
+            ev->lease_seconds = msg->lease_seconds;
+            ev->has_lease = msg->has_lease;
+        }
+        break;
+    }
+    case DHCP_DECLINE: {
+        // The client found the offered address already in use
+        address_event_t *ev = PushEvent(state, timestamp_ns, "dhcp", "conflict", pkt->vlan_id);
+        if (ev) {
+            ev->alert = "dhcp_decline";
+            PacketFormatMac(msg->client_mac, ev->mac, sizeof(ev->mac));
+            if (msg->requested_ip) {
+                PacketFormatIp(4, msg->requested_ip, ev->ip, sizeof(ev->ip));
+            }
+        }
+        break;
+    }
+    case DHCP_RELEASE: {
+        binding_key_t key;
+        memset(&key, 0, sizeof(key));
+        key.vlan_id = pkt->vlan_id;
+        key.ip_version = 4;
+        memcpy(key.ip, msg->client_ip, 4);
+        binding_t *binding = (binding_t *)HashMapFind(&state->bindings, &key);
+        if (binding && memcmp(binding->mac, msg->client_mac, 6) == 0) {
+            HashMapRemove(&state->bindings, &key);
+            address_event_t *ev = PushEvent(state, timestamp_ns, "dhcp", "released", pkt->vlan_id);
+            if (ev) {
+                PacketFormatIp(4, msg->client_ip, ev->ip, sizeof(ev->ip));
+                PacketFormatMac(msg->client_mac, ev->mac, sizeof(ev->mac));
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    // More than one server answering clients indicates a rogue DHCP server
+    if ((msg->message_type == DHCP_OFFER || msg->message_type == DHCP_ACK) && pkt->ip_version == 4) {
+        const uint8_t *server = msg->server_id ? msg->server_id : pkt->src_ip;
+        int is_new;
+        uint64_t *first_seen = (uint64_t *)HashMapInsert(&state->dhcp_servers, server, &is_new);
+        if (first_seen && is_new) {
+            *first_seen = timestamp_ns;
+            if (state->dhcp_servers.count > 1) {
+                address_event_t *ev = PushEvent(state, timestamp_ns, "dhcp", "conflict", pkt->vlan_id);
+                if (ev) {
+                    ev->alert = "multiple_dhcp_servers";
+                    PacketFormatIp(4, server, ev->ip, sizeof(ev->ip));
+                    if (pkt->src_mac) {
+                        PacketFormatMac(pkt->src_mac, ev->mac, sizeof(ev->mac));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Find a link-layer address option in an ND message
+static const uint8_t *FindNdLinkAddress(const uint8_t *options, uint32_t len, uint8_t wanted) {
+    uint32_t offset = 0;
+    while (offset + 2 <= len) {
+        uint32_t option_len = (uint32_t)options[offset + 1] * 8;
+        if (option_len == 0 || offset + option_len > len) {
+            return NULL;
+        }
+        if (options[offset] == wanted && option_len >= 8) {
+            return options + offset + 2;
+        }
+        offset += option_len;
+    }
+    return NULL;
+}
+
+static void ProcessNeighborDiscovery(address_state_t *state, uint64_t timestamp_ns, const packet_info_t *pkt) {
+    const uint8_t *p = pkt->payload;
+    uint32_t len = pkt->payload_len;
+    if (!p || len < 4) {
+        return;
+    }
+    static const uint8_t unspecified[16] = {0};
+
+    switch (p[0]) {
+    case ND_ROUTER_ADVERT: {
+        if (len < 16) {
+            return;
+        }
+        const uint8_t *mac = FindNdLinkAddress(p + 16, len - 16, ND_OPT_SOURCE_LINKADDR);
+        if (mac) {
+            ObserveBinding(state, timestamp_ns, "ndp", pkt->vlan_id, 6, pkt->src_ip, mac);
+        }
+        break;
+    }
+    case ND_NEIGHBOR_SOLICIT: {
+        if (len < 24) {
+            return;
+        }
+        const uint8_t *target = p + 8;
+        if (memcmp(pkt->src_ip, unspecified, 16) == 0) {
+            // Duplicate address detection: another host wants an address we
+            // have already seen in use by a different MAC
+            binding_key_t key;
+            memset(&key, 0, sizeof(key));
+            key.vlan_id = pkt->vlan_id;
+            key.ip_version = 6;
+            memcpy(key.ip, target, 16);
+            binding_t *binding = (binding_t *)HashMapFind(&state->bindings, &key);
+            if (binding && pkt->src_mac && memcmp(binding->mac, pkt->src_mac, 6) != 0) {
+                address_event_t *ev = PushEvent(state, timestamp_ns, "ndp", "conflict", pkt->vlan_id);
+                if (ev) {
+                    ev->alert = "duplicate_address_detection";
+                    PacketFormatIp(6, target, ev->ip, sizeof(ev->ip));
+                    PacketFormatMac(pkt->src_mac, ev->mac, sizeof(ev->mac));
+                    PacketFormatMac(binding->mac, ev->previous_mac, sizeof(ev->previous_mac));
+                }
+            }
+            return;
+        }
+        const uint8_t *mac = FindNdLinkAddress(p + 24, len - 24, ND_OPT_SOURCE_LINKADDR);
+        if (mac) {
+            ObserveBinding(state, timestamp_ns, "ndp", pkt->vlan_id, 6, pkt->src_ip, mac);
+        }
+        break;
+    }
+    case ND_NEIGHBOR_ADVERT: {
+        if (len < 24) {
+            return;
+        }
+        const uint8_t *mac = FindNdLinkAddress(p + 24, len - 24, ND_OPT_TARGET_LINKADDR);
+        if (mac) {
+            ObserveBinding(state, timestamp_ns, "ndp", pkt->vlan_id, 6, p + 8, mac);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void AddressBindingsBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "protocol", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "event", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "vlan_id", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "mac", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "previous_mac", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hostname", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "lease_seconds", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "alert", DUCKDB_TYPE_VARCHAR);
+}
+
+static void AddressBindingsFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    address_state_t *state = (address_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[ADDR_COL_COUNT];
+    for (idx_t i = 0; i < ADDR_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(vectors[ADDR_COL_TIMESTAMP]);
+    uint16_t *vlan_data = (uint16_t *)duckdb_vector_get_data(vectors[ADDR_COL_VLAN]);
+    uint32_t *lease_data = (uint32_t *)duckdb_vector_get_data(vectors[ADDR_COL_LEASE]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    dhcp_message_t dhcp;
+
+    while (row_count < max_rows) {
+        // Drain events from the previous packet before reading the next one
+        if (state->pending_index < state->pending_count) {
+            const address_event_t *ev = &state->pending[state->pending_index++];
+            idx_t row = row_count++;
+            timestamp_data[row] = ev->timestamp_ns;
+            duckdb_vector_assign_string_element(vectors[ADDR_COL_PROTOCOL], row, ev->protocol);
+            duckdb_vector_assign_string_element(vectors[ADDR_COL_EVENT], row, ev->event);
+            vlan_data[row] = ev->vlan_id;
+            PcapVectorAssignString(vectors[ADDR_COL_IP], row, ev->ip);
+            PcapVectorAssignString(vectors[ADDR_COL_MAC], row, ev->mac);
+            PcapVectorAssignString(vectors[ADDR_COL_PREVIOUS_MAC], row, ev->previous_mac);
+            PcapVectorAssignString(vectors[ADDR_COL_HOSTNAME], row, ev->hostname);
+            if (ev->has_lease) {
+                lease_data[row] = ev->lease_seconds;
+            } else {
+                PcapVectorSetNull(vectors[ADDR_COL_LEASE], row);
+            }
+            PcapVectorAssignString(vectors[ADDR_COL_ALERT], row, ev->alert);
+            continue;
+        }
+        state->pending_count = 0;
+        state->pending_index = 0;
+
+        if (!PcapSourceNext(state->source, &packet)) {
+            break;
+        }
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt)) {
+            continue;
+        }
+        if (pkt.ethertype == ETHERTYPE_ARP) {
+            ProcessArp(state, packet.timestamp_ns, &pkt);
+        } else if (pkt.ip_proto == IPPROTO_NUM_ICMPV6 && pkt.ip_version == 6) {
+            ProcessNeighborDiscovery(state, packet.timestamp_ns, &pkt);
+        } else if (ParseDhcp(&pkt, &dhcp)) {
+            ProcessDhcp(state, packet.timestamp_ns, &pkt, &dhcp);
+        }
+    }
+
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+static void DhcpBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "message_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "xid", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "client_mac", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "client_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "your_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "server_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "requested_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hostname", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "lease_seconds", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "vendor_class", DUCKDB_TYPE_VARCHAR);
+}
+
+static void AssignOptionalIp(duckdb_vector vector, idx_t row, const uint8_t *ip) {
+    char text[16];
+    if (IsZeroIp(ip)) {
+        PcapVectorSetNull(vector, row);
+        return;
+    }
+    PacketFormatIp(4, ip, text, sizeof(text));
+    duckdb_vector_assign_string_element(vector, row, text);
+}
+
+static void DhcpFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    address_state_t *state = (address_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[DHCP_COL_COUNT];
+    for (idx_t i = 0; i < DHCP_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(vectors[DHCP_COL_TIMESTAMP]);
+    uint32_t *xid_data = (uint32_t *)duckdb_vector_get_data(vectors[DHCP_COL_XID]);
+    uint32_t *lease_data = (uint32_t *)duckdb_vector_get_data(vectors[DHCP_COL_LEASE]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    dhcp_message_t msg;
+    char text[256];
+
+    while (row_count < max_rows && PcapSourceNext(state->source, &packet)) {
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) || !ParseDhcp(&pkt, &msg)) {
+            continue;
+        }
+        idx_t row = row_count++;
+        timestamp_data[row] = packet.timestamp_ns;
+        duckdb_vector_assign_string_element(vectors[DHCP_COL_MESSAGE_TYPE], row,
+                                            DhcpMessageTypeName(msg.message_type));
+        xid_data[row] = msg.xid;
+        PacketFormatMac(msg.client_mac, text, sizeof(text));
+        duckdb_vector_assign_string_element(vectors[DHCP_COL_CLIENT_MAC], row, text);
+        AssignOptionalIp(vectors[DHCP_COL_CLIENT_IP], row, msg.client_ip);
+        AssignOptionalIp(vectors[DHCP_COL_YOUR_IP], row, msg.your_ip);
+        AssignOptionalIp(vectors[DHCP_COL_SERVER_ID], row, msg.server_id);
+        AssignOptionalIp(vectors[DHCP_COL_REQUESTED_IP], row, msg.requested_ip);
+        text[0] = '\0';
+        if (msg.hostname) {
+            CopyOptionString(msg.hostname, msg.hostname_len, text, sizeof(text));
+        }
+        PcapVectorAssignString(vectors[DHCP_COL_HOSTNAME], row, text);
+        if (msg.has_lease) {
+            lease_data[row] = msg.lease_seconds;
+        } else {
+            PcapVectorSetNull(vectors[DHCP_COL_LEASE], row);
+        }
+        text[0] = '\0';
+        if (msg.vendor_class) {
+            CopyOptionString(msg.vendor_class, msg.vendor_class_len, text, sizeof(text));
+        }
+        PcapVectorAssignString(vectors[DHCP_COL_VENDOR_CLASS], row, text);
+    }
+
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterAddressBindingsFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_address_bindings", AddressBindingsBind, AddressInit, AddressBindingsFunction);
+}
+
+void RegisterDhcpFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_dhcp", DhcpBind, AddressInit, DhcpFunction);
+}
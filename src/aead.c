@@ -0,0 +1,653 @@
+#include "aead.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AEAD_HAVE_AESNI 1
+#include <immintrin.h>
+#endif
+
+static uint32_t ReadBe32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void WriteBe32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint64_t ReadBe64(const uint8_t *p) {
+    return ((uint64_t)ReadBe32(p) << 32) | ReadBe32(p + 4);
+}
+
+static void WriteBe64(uint8_t *p, uint64_t v) {
+    WriteBe32(p, (uint32_t)(v >> 32));
+    WriteBe32(p + 4, (uint32_t)v);
+}
+
+static uint32_t ReadLe32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void WriteLe32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t Rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t Rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Constant-time tag comparison
+static int TagEqual(const uint8_t *a, const uint8_t *b) {
+    uint8_t diff = 0;
+    for (int i = 0; i < AEAD_TAG_LEN; i++) {
+        diff |= (uint8_t)(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+// ---------------------------------------------------------------------------
+// AES (FIPS 197)
+// ---------------------------------------------------------------------------
+
+static uint8_t Rotl8(uint8_t x, int n) {
+    return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+static uint8_t Xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+}
+
+// Derive the S-box and the combined SubBytes/MixColumns table
+static void AesBuildTables(aead_key_t *key) {
+    uint8_t p = 1, q = 1;
+    do {
+        // p walks the multiplicative group by powers of 3, q by powers of 3^-1
+        p = (uint8_t)(p ^ Xtime(p));
+        q = (uint8_t)(q ^ (q << 1));
+        q = (uint8_t)(q ^ (q << 2));
+        q = (uint8_t)(q ^ (q << 4));
+        if (q & 0x80) {
+            q ^= 0x09;
+        }
+        uint8_t x = (uint8_t)(q ^ Rotl8(q, 1) ^ Rotl8(q, 2) ^ Rotl8(q, 3) ^ Rotl8(q, 4));
+        key->sbox[p] = (uint8_t)(x ^ 0x63);
+    } while (p != 1);
+    key->sbox[0] = 0x63;
+
+    for (int i = 0; i < 256; i++) {
+        uint8_t s = key->sbox[i];
+        uint8_t s2 = Xtime(s);
+        uint8_t s3 = (uint8_t)(s2 ^ s);
+        key->te[i] = ((uint32_t)s2 << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | s3;
+    }
+}
+
+static void AesExpandKey(aead_key_t *key, const uint8_t *secret, int key_words) {
+    key->rounds = key_words + 6;
+    int total_words = 4 * (key->rounds + 1);
+    uint8_t *w = key->round_keys;
+    memcpy(w, secret, (size_t)key_words * 4);
+    uint8_t rcon = 1;
+    for (int i = key_words; i < total_words; i++) {
+        uint8_t temp[4];
+        memcpy(temp, w + (i - 1) * 4, 4);
+        if (i % key_words == 0) {
+            uint8_t first = temp[0];
+            temp[0] = (uint8_t)(key->sbox[temp[1]] ^ rcon);
+            temp[1] = key->sbox[temp[2]];
+            temp[2] = key->sbox[temp[3]];
+            temp[3] = key->sbox[first];
+            rcon = Xtime(rcon);
+        } else if (key_words > 6 && i % key_words == 4) {
+            for (int j = 0; j < 4; j++) {
+                temp[j] = key->sbox[temp[j]];
+            }
+        }
+        for (int j = 0; j < 4; j++) {
+            w[i * 4 + j] = (uint8_t)(w[(i - key_words) * 4 + j] ^ temp[j]);
+        }
+    }
+}
+
+static void AesEncryptBlock(const aead_key_t *key, const uint8_t in[16], uint8_t out[16]) {
+    const uint8_t *rk = key->round_keys;
+    const uint32_t *te = key->te;
+    uint32_t s0 = ReadBe32(in) ^ ReadBe32(rk);
+    uint32_t s1 = ReadBe32(in + 4) ^ ReadBe32(rk + 4);
+    uint32_t s2 = ReadBe32(in + 8) ^ ReadBe32(rk + 8);
+    uint32_t s3 = ReadBe32(in + 12) ^ ReadBe32(rk + 12);
+
+    for (int round = 1; round < key->rounds; round++) {
+        rk += 16;
+        uint32_t t0 = te[s0 >> 24] ^ Rotr32(te[(s1 >> 16) & 0xFF], 8) ^ Rotr32(te[(s2 >> 8) & 0xFF], 16) ^
+                      Rotr32(te[s3 & 0xFF], 24) ^ ReadBe32(rk);
+        uint32_t t1 = te[s1 >> 24] ^ Rotr32(te[(s2 >> 16) & 0xFF], 8) ^ Rotr32(te[(s3 >> 8) & 0xFF], 16) ^
+                      Rotr32(te[s0 & 0xFF], 24) ^ ReadBe32(rk + 4);
+        uint32_t t2 = te[s2 >> 24] ^ Rotr32(te[(s3 >> 16) & 0xFF], 8) ^ Rotr32(te[(s0 >> 8) & 0xFF], 16) ^
+                      Rotr32(te[s1 & 0xFF], 24) ^ ReadBe32(rk + 8);
+        uint32_t t3 = te[s3 >> 24] ^ Rotr32(te[(s0 >> 16) & 0xFF], 8) ^ Rotr32(te[(s1 >> 8) & 0xFF], 16) ^
+                      Rotr32(te[s2 & 0xFF], 24) ^ ReadBe32(rk + 12);
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    rk += 16;
+    const uint8_t *sbox = key->sbox;
+    uint32_t state[4] = {s0, s1, s2, s3};
+    for (int i = 0; i < 4; i++) {
+        uint32_t v = ((uint32_t)sbox[state[i] >> 24] << 24) | ((uint32_t)sbox[(state[(i + 1) & 3] >> 16) & 0xFF] << 16) |
+                     ((uint32_t)sbox[(state[(i + 2) & 3] >> 8) & 0xFF] << 8) | sbox[state[(i + 3) & 3] & 0xFF];
+        WriteBe32(out + i * 4, v ^ ReadBe32(rk + i * 4));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GCM (NIST SP 800-38D), portable path
+// ---------------------------------------------------------------------------
+
+static void GhashBuildTable(aead_key_t *key) {
+    uint64_t vh = ReadBe64(key->ghash_key);
+    uint64_t vl = ReadBe64(key->ghash_key + 8);
+    key->ghash_hi[0] = 0;
+    key->ghash_lo[0] = 0;
+    key->ghash_hi[8] = vh;
+    key->ghash_lo[8] = vl;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t carry = (vl & 1) ? 0xE100000000000000ULL : 0;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ carry;
+        key->ghash_hi[i] = vh;
+        key->ghash_lo[i] = vl;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+        for (int j = 1; j < i; j++) {
+            key->ghash_hi[i + j] = key->ghash_hi[i] ^ key->ghash_hi[j];
+            key->ghash_lo[i + j] = key->ghash_lo[i] ^ key->ghash_lo[j];
+        }
+    }
+}
+
+static const uint64_t ghash_reduce4[16] = {0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+                                           0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0};
+
+// x = x * H in GF(2^128)
+static void GhashMultiply(const aead_key_t *key, uint8_t x[16]) {
+    uint8_t low = x[15] & 0x0F;
+    uint64_t zh = key->ghash_hi[low];
+    uint64_t zl = key->ghash_lo[low];
+    for (int i = 15; i >= 0; i--) {
+        low = x[i] & 0x0F;
+        uint8_t high = (uint8_t)(x[i] >> 4);
+        if (i != 15) {
+            uint8_t rem = (uint8_t)(zl & 0x0F);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (ghash_reduce4[rem] << 48);
+            zh ^= key->ghash_hi[low];
+            zl ^= key->ghash_lo[low];
+        }
+        uint8_t rem = (uint8_t)(zl & 0x0F);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (ghash_reduce4[rem] << 48);
+        zh ^= key->ghash_hi[high];
+        zl ^= key->ghash_lo[high];
+    }
+    WriteBe64(x, zh);
+    WriteBe64(x + 8, zl);
+}
+
+// Absorb data, zero-padded to a whole number of blocks
+static void GhashUpdate(const aead_key_t *key, uint8_t x[16], const uint8_t *data, size_t len) {
+    while (len) {
+        size_t take = len < 16 ? len : 16;
+        for (size_t i = 0; i < take; i++) {
+            x[i] ^= data[i];
+        }
+        GhashMultiply(key, x);
+        data += take;
+        len -= take;
+    }
+}
+
+static int GcmOpenPortable(const aead_key_t *key, const uint8_t nonce[AEAD_NONCE_LEN], const uint8_t *aad,
+                           size_t aad_len, const uint8_t *input, size_t len, const uint8_t tag[AEAD_TAG_LEN],
+                           uint8_t *output) {
+    uint8_t x[16] = {0};
+    GhashUpdate(key, x, aad, aad_len);
+    GhashUpdate(key, x, input, len);
+    uint8_t lengths[16];
+    WriteBe64(lengths, (uint64_t)aad_len * 8);
+    WriteBe64(lengths + 8, (uint64_t)len * 8);
+    GhashUpdate(key, x, lengths, 16);
+
+    uint8_t counter[16];
+    uint8_t keystream[16];
+    memcpy(counter, nonce, AEAD_NONCE_LEN);
+    WriteBe32(counter + 12, 1);
+    AesEncryptBlock(key, counter, keystream);
+    uint8_t expected[16];
+    for (int i = 0; i < 16; i++) {
+        expected[i] = (uint8_t)(x[i] ^ keystream[i]);
+    }
+    if (!TagEqual(expected, tag)) {
+        return 0;
+    }
+
+    uint32_t block = 2;
+    for (size_t offset = 0; offset < len; offset += 16) {
+        WriteBe32(counter + 12, block++);
+        AesEncryptBlock(key, counter, keystream);
+        size_t take = len - offset < 16 ? len - offset : 16;
+        for (size_t i = 0; i < take; i++) {
+            output[offset + i] = (uint8_t)(input[offset + i] ^ keystream[i]);
+        }
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// GCM with AES-NI and PCLMULQDQ
+// ---------------------------------------------------------------------------
+
+#ifdef AEAD_HAVE_AESNI
+#define AEAD_TARGET __attribute__((target("aes,pclmul,ssse3")))
+
+static int CpuHasAesni(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+AEAD_TARGET static inline __m128i ByteSwap(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+// Carry-less 128x128 multiply, accumulated unreduced into hi:lo
+AEAD_TARGET static inline void ClmulAccumulate(__m128i a, __m128i b, __m128i *lo, __m128i *hi) {
+    __m128i low = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    __m128i high = _mm_clmulepi64_si128(a, b, 0x11);
+    *lo = _mm_xor_si128(*lo, _mm_xor_si128(low, _mm_slli_si128(mid, 8)));
+    *hi = _mm_xor_si128(*hi, _mm_xor_si128(high, _mm_srli_si128(mid, 8)));
+}
+
+// Reduce a 256-bit product of byte-reflected operands modulo the GCM
+// polynomial (Intel carry-less multiplication white paper, algorithm 5)
+AEAD_TARGET static inline __m128i GhashReduce(__m128i lo, __m128i hi) {
+    __m128i lo_carry = _mm_srli_epi32(lo, 31);
+    __m128i hi_carry = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    __m128i cross = _mm_srli_si128(lo_carry, 12);
+    hi_carry = _mm_slli_si128(hi_carry, 4);
+    lo_carry = _mm_slli_si128(lo_carry, 4);
+    lo = _mm_or_si128(lo, lo_carry);
+    hi = _mm_or_si128(_mm_or_si128(hi, hi_carry), cross);
+
+    __m128i a = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+    __m128i b = _mm_srli_si128(a, 4);
+    a = _mm_slli_si128(a, 12);
+    lo = _mm_xor_si128(lo, a);
+    __m128i c = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+    c = _mm_xor_si128(c, b);
+    lo = _mm_xor_si128(lo, c);
+    return _mm_xor_si128(hi, lo);
+}
+
+AEAD_TARGET static inline __m128i GhashMultiplyClmul(__m128i a, __m128i b) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    ClmulAccumulate(a, b, &lo, &hi);
+    return GhashReduce(lo, hi);
+}
+
+AEAD_TARGET static inline __m128i LoadPartial(const uint8_t *data, size_t len) {
+    uint8_t block[16] = {0};
+    memcpy(block, data, len);
+    return _mm_loadu_si128((const __m128i *)block);
+}
+
+// Absorb data, zero-padded, four blocks per reduction
+AEAD_TARGET static __m128i GhashUpdateClmul(__m128i x, const __m128i powers[4], const uint8_t *data, size_t len) {
+    while (len >= 64) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        __m128i b0 = _mm_xor_si128(x, ByteSwap(_mm_loadu_si128((const __m128i *)data)));
+        ClmulAccumulate(b0, powers[3], &lo, &hi);
+        ClmulAccumulate(ByteSwap(_mm_loadu_si128((const __m128i *)(data + 16))), powers[2], &lo, &hi);
+        ClmulAccumulate(ByteSwap(_mm_loadu_si128((const __m128i *)(data + 32))), powers[1], &lo, &hi);
+        ClmulAccumulate(ByteSwap(_mm_loadu_si128((const __m128i *)(data + 48))), powers[0], &lo, &hi);
+        x = GhashReduce(lo, hi);
+        data += 64;
+        len -= 64;
+    }
+    while (len) {
+        size_t take = len < 16 ? len : 16;
+        __m128i block = take == 16 ? _mm_loadu_si128((const __m128i *)data) : LoadPartial(data, take);
+        x = GhashMultiplyClmul(_mm_xor_si128(x, ByteSwap(block)), powers[0]);
+        data += take;
+        len -= take;
+    }
+    return x;
+}
+
+AEAD_TARGET static inline __m128i AesniEncrypt(const __m128i *rk, int rounds, __m128i block) {
+    block = _mm_xor_si128(block, rk[0]);
+    for (int round = 1; round < rounds; round++) {
+        block = _mm_aesenc_si128(block, rk[round]);
+    }
+    return _mm_aesenclast_si128(block, rk[rounds]);
+}
+
+AEAD_TARGET static inline __m128i CounterBlock(__m128i base, uint32_t counter) {
+    return _mm_or_si128(base, _mm_set_epi32((int)__builtin_bswap32(counter), 0, 0, 0));
+}
+
+AEAD_TARGET static int GcmOpenAesni(const aead_key_t *key, const uint8_t nonce[AEAD_NONCE_LEN], const uint8_t *aad,
+                                    size_t aad_len, const uint8_t *input, size_t len, const uint8_t tag[AEAD_TAG_LEN],
+                                    uint8_t *output) {
+    __m128i rk[15];
+    for (int i = 0; i <= key->rounds; i++) {
+        rk[i] = _mm_loadu_si128((const __m128i *)(key->round_keys + 16 * i));
+    }
+    __m128i powers[4];
+    powers[0] = ByteSwap(_mm_loadu_si128((const __m128i *)key->ghash_key));
+    for (int i = 1; i < 4; i++) {
+        powers[i] = GhashMultiplyClmul(powers[i - 1], powers[0]);
+    }
+
+    // Authenticate before releasing any plaintext
+    __m128i x = _mm_setzero_si128();
+    x = GhashUpdateClmul(x, powers, aad, aad_len);
+    x = GhashUpdateClmul(x, powers, input, len);
+    uint8_t lengths[16];
+    WriteBe64(lengths, (uint64_t)aad_len * 8);
+    WriteBe64(lengths + 8, (uint64_t)len * 8);
+    x = GhashUpdateClmul(x, powers, lengths, 16);
+
+    uint8_t base_bytes[16] = {0};
+    memcpy(base_bytes, nonce, AEAD_NONCE_LEN);
+    __m128i base = _mm_loadu_si128((const __m128i *)base_bytes);
+    uint8_t expected[16];
+    _mm_storeu_si128((__m128i *)expected,
+                     _mm_xor_si128(ByteSwap(x), AesniEncrypt(rk, key->rounds, CounterBlock(base, 1))));
+    if (!TagEqual(expected, tag)) {
+        return 0;
+    }
+
+    // CTR mode, four independent blocks in flight to hide AESENC latency
+    uint32_t counter = 2;
+    size_t offset = 0;
+    int rounds = key->rounds;
+    for (; offset + 64 <= len; offset += 64, counter += 4) {
+        __m128i c0 = _mm_xor_si128(CounterBlock(base, counter), rk[0]);
+        __m128i c1 = _mm_xor_si128(CounterBlock(base, counter + 1), rk[0]);
+        __m128i c2 = _mm_xor_si128(CounterBlock(base, counter + 2), rk[0]);
+        __m128i c3 = _mm_xor_si128(CounterBlock(base, counter + 3), rk[0]);
+        for (int round = 1; round < rounds; round++) {
+            c0 = _mm_aesenc_si128(c0, rk[round]);
+            c1 = _mm_aesenc_si128(c1, rk[round]);
+            c2 = _mm_aesenc_si128(c2, rk[round]);
+            c3 = _mm_aesenc_si128(c3, rk[round]);
+        }
+        c0 = _mm_aesenclast_si128(c0, rk[rounds]);
+        c1 = _mm_aesenclast_si128(c1, rk[rounds]);
+        c2 = _mm_aesenclast_si128(c2, rk[rounds]);
+        c3 = _mm_aesenclast_si128(c3, rk[rounds]);
+        const __m128i *in = (const __m128i *)(input + offset);
+        __m128i *out = (__m128i *)(output + offset);
+        _mm_storeu_si128(out, _mm_xor_si128(c0, _mm_loadu_si128(in)));
+        _mm_storeu_si128(out + 1, _mm_xor_si128(c1, _mm_loadu_si128(in + 1)));
+        _mm_storeu_si128(out + 2, _mm_xor_si128(c2, _mm_loadu_si128(in + 2)));
+        _mm_storeu_si128(out + 3, _mm_xor_si128(c3, _mm_loadu_si128(in + 3)));
+    }
+    for (; offset < len; offset += 16, counter++) {
+        uint8_t keystream[16];
+        _mm_storeu_si128((__m128i *)keystream, AesniEncrypt(rk, rounds, CounterBlock(base, counter)));
+        size_t take = len - offset < 16 ? len - offset : 16;
+        for (size_t i = 0; i < take; i++) {
+            output[offset + i] = (uint8_t)(input[offset + i] ^ keystream[i]);
+        }
+    }
+    return 1;
+}
+#endif // AEAD_HAVE_AESNI
+
+// ---------------------------------------------------------------------------
+// ChaCha20-Poly1305 (RFC 8439)
+// ---------------------------------------------------------------------------
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d)                                                                               \
+    a += b;                                                                                                            \
+    d = Rotl32(d ^ a, 16);                                                                                             \
+    c += d;                                                                                                            \
+    b = Rotl32(b ^ c, 12);                                                                                             \
+    a += b;                                                                                                            \
+    d = Rotl32(d ^ a, 8);                                                                                              \
+    c += d;                                                                                                            \
+    b = Rotl32(b ^ c, 7);
+
+static void ChaChaBlock(const uint8_t key[32], uint32_t counter, const uint8_t nonce[12], uint8_t out[64]) {
+    uint32_t input[16] = {0x61707865, 0x3320646E, 0x79622D32, 0x6B206574};
+    for (int i = 0; i < 8; i++) {
+        input[4 + i] = ReadLe32(key + i * 4);
+    }
+    input[12] = counter;
+    input[13] = ReadLe32(nonce);
+    input[14] = ReadLe32(nonce + 4);
+    input[15] = ReadLe32(nonce + 8);
+
+    uint32_t x[16];
+    memcpy(x, input, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+        CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12])
+        CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13])
+        CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13])
+        CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; i++) {
+        WriteLe32(out + i * 4, x[i] + input[i]);
+    }
+}
+
+// Poly1305 with 26-bit limbs; every input here is a whole number of blocks
+typedef struct {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} poly1305_t;
+
+static void Poly1305Init(poly1305_t *poly, const uint8_t key[32]) {
+    poly->r[0] = ReadLe32(key) & 0x3FFFFFF;
+    poly->r[1] = (ReadLe32(key + 3) >> 2) & 0x3FFFF03;
+    poly->r[2] = (ReadLe32(key + 6) >> 4) & 0x3FFC0FF;
+    poly->r[3] = (ReadLe32(key + 9) >> 6) & 0x3F03FFF;
+    poly->r[4] = (ReadLe32(key + 12) >> 8) & 0x00FFFFF;
+    memset(poly->h, 0, sizeof(poly->h));
+    for (int i = 0; i < 4; i++) {
+        poly->pad[i] = ReadLe32(key + 16 + i * 4);
+    }
+}
+
+static void Poly1305Block(poly1305_t *poly, const uint8_t m[16]) {
+    uint32_t r0 = poly->r[0], r1 = poly->r[1], r2 = poly->r[2], r3 = poly->r[3], r4 = poly->r[4];
+    uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = poly->h[0] + (ReadLe32(m) & 0x3FFFFFF);
+    uint32_t h1 = poly->h[1] + ((ReadLe32(m + 3) >> 2) & 0x3FFFFFF);
+    uint32_t h2 = poly->h[2] + ((ReadLe32(m + 6) >> 4) & 0x3FFFFFF);
+    uint32_t h3 = poly->h[3] + ((ReadLe32(m + 9) >> 6) & 0x3FFFFFF);
+    uint32_t h4 = poly->h[4] + ((ReadLe32(m + 12) >> 8) | (1u << 24));
+
+    uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+    uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+    uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+    uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+    uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+    uint32_t c = (uint32_t)(d0 >> 26);
+    h0 = (uint32_t)d0 & 0x3FFFFFF;
+    d1 += c;
+    c = (uint32_t)(d1 >> 26);
+    h1 = (uint32_t)d1 & 0x3FFFFFF;
+    d2 += c;
+    c = (uint32_t)(d2 >> 26);
+    h2 = (uint32_t)d2 & 0x3FFFFFF;
+    d3 += c;
+    c = (uint32_t)(d3 >> 26);
+    h3 = (uint32_t)d3 & 0x3FFFFFF;
+    d4 += c;
+    c = (uint32_t)(d4 >> 26);
+    h4 = (uint32_t)d4 & 0x3FFFFFF;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3FFFFFF;
+    h1 += c;
+
+    poly->h[0] = h0;
+    poly->h[1] = h1;
+    poly->h[2] = h2;
+    poly->h[3] = h3;
+    poly->h[4] = h4;
+}
+
+// Absorb data zero-padded to 16 bytes, as the AEAD construction requires
+static void Poly1305UpdatePadded(poly1305_t *poly, const uint8_t *data, size_t len) {
+    while (len >= 16) {
+        Poly1305Block(poly, data);
+        data += 16;
+        len -= 16;
+    }
+    if (len) {
+        uint8_t block[16] = {0};
+        memcpy(block, data, len);
+        Poly1305Block(poly, block);
+    }
+}
+
+static void Poly1305Final(poly1305_t *poly, uint8_t mac[16]) {
+    uint32_t h0 = poly->h[0], h1 = poly->h[1], h2 = poly->h[2], h3 = poly->h[3], h4 = poly->h[4];
+    uint32_t c = h1 >> 26;
+    h1 &= 0x3FFFFFF;
+    h2 += c;
+    c = h2 >> 26;
+    h2 &= 0x3FFFFFF;
+    h3 += c;
+    c = h3 >> 26;
+    h3 &= 0x3FFFFFF;
+    h4 += c;
+    c = h4 >> 26;
+    h4 &= 0x3FFFFFF;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3FFFFFF;
+    h1 += c;
+
+    // Compute h - p and select it when h >= p
+    uint32_t g0 = h0 + 5;
+    c = g0 >> 26;
+    g0 &= 0x3FFFFFF;
+    uint32_t g1 = h1 + c;
+    c = g1 >> 26;
+    g1 &= 0x3FFFFFF;
+    uint32_t g2 = h2 + c;
+    c = g2 >> 26;
+    g2 &= 0x3FFFFFF;
+    uint32_t g3 = h3 + c;
+    c = g3 >> 26;
+    g3 &= 0x3FFFFFF;
+    uint32_t g4 = h4 + c - (1u << 26);
+    uint32_t mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    uint32_t words[4] = {h0 | (h1 << 26), (h1 >> 6) | (h2 << 20), (h2 >> 12) | (h3 << 14), (h3 >> 18) | (h4 << 8)};
+    uint64_t f = 0;
+    for (int i = 0; i < 4; i++) {
+        f = (uint64_t)words[i] + poly->pad[i] + (f >> 32);
+        WriteLe32(mac + i * 4, (uint32_t)f);
+    }
+}
+
+static int ChaChaPolyOpen(const aead_key_t *key, const uint8_t nonce[AEAD_NONCE_LEN], const uint8_t *aad,
+                          size_t aad_len, const uint8_t *input, size_t len, const uint8_t tag[AEAD_TAG_LEN],
+                          uint8_t *output) {
+    uint8_t block[64];
+    ChaChaBlock(key->chacha_key, 0, nonce, block);
+    poly1305_t poly;
+    Poly1305Init(&poly, block);
+    Poly1305UpdatePadded(&poly, aad, aad_len);
+    Poly1305UpdatePadded(&poly, input, len);
+    uint8_t lengths[16];
+    for (int i = 0; i < 8; i++) {
+        lengths[i] = (uint8_t)((uint64_t)aad_len >> (8 * i));
+        lengths[8 + i] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+    Poly1305Block(&poly, lengths);
+    uint8_t expected[16];
+    Poly1305Final(&poly, expected);
+    if (!TagEqual(expected, tag)) {
+        return 0;
+    }
+
+    uint32_t counter = 1;
+    for (size_t offset = 0; offset < len; offset += 64) {
+        ChaChaBlock(key->chacha_key, counter++, nonce, block);
+        size_t take = len - offset < 64 ? len - offset : 64;
+        for (size_t i = 0; i < take; i++) {
+            output[offset + i] = (uint8_t)(input[offset + i] ^ block[i]);
+        }
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+
+size_t AeadKeyLength(aead_algorithm_t algorithm) {
+    return algorithm == AEAD_AES_128_GCM ? 16 : 32;
+}
+
+void AeadInit(aead_key_t *key, aead_algorithm_t algorithm, const uint8_t *secret) {
+    memset(key, 0, sizeof(aead_key_t));
+    key->algorithm = algorithm;
+    if (algorithm == AEAD_CHACHA20_POLY1305) {
+        memcpy(key->chacha_key, secret, 32);
+        return;
+    }
+    AesBuildTables(key);
+    AesExpandKey(key, secret, algorithm == AEAD_AES_128_GCM ? 4 : 8);
+    static const uint8_t zero[16] = {0};
+    AesEncryptBlock(key, zero, key->ghash_key);
+    GhashBuildTable(key);
+#ifdef AEAD_HAVE_AESNI
+    key->hardware = CpuHasAesni();
+#endif
+}
+
+int AeadOpen(const aead_key_t *key, const uint8_t nonce[AEAD_NONCE_LEN], const uint8_t *aad, size_t aad_len,
+             const uint8_t *input, size_t len, const uint8_t tag[AEAD_TAG_LEN], uint8_t *output) {
+    if (key->algorithm == AEAD_CHACHA20_POLY1305) {
+        return ChaChaPolyOpen(key, nonce, aad, aad_len, input, len, tag, output);
+    }
+#ifdef AEAD_HAVE_AESNI
+    if (key->hardware) {
+        return GcmOpenAesni(key, nonce, aad, aad_len, input, len, tag, output);
+    }
+#endif
+    return GcmOpenPortable(key, nonce, aad, aad_len, input, len, tag, output);
+}
@@ -0,0 +1,203 @@
+#include "duckdb_extension.h"
+#include "aho_corasick.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+static uint8_t FoldByte(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + 32) : c;
+}
+
+void AcInit(ac_matcher_t *matcher) {
+    memset(matcher, 0, sizeof(ac_matcher_t));
+}
+
+void AcDestroy(ac_matcher_t *matcher) {
+    duckdb_free(matcher->pattern_bytes);
+    duckdb_free(matcher->pattern_offsets);
+    duckdb_free(matcher->transitions);
+    duckdb_free(matcher->first_pattern);
+    duckdb_free(matcher->output_link);
+    duckdb_free(matcher->next_pattern);
+    memset(matcher, 0, sizeof(ac_matcher_t));
+}
+
+int64_t AcAddPattern(ac_matcher_t *matcher, const uint8_t *pattern, size_t len) {
+    if (!len || len > UINT32_MAX - matcher->bytes_len) {
+        return -1;
+    }
+    if (matcher->pattern_count + 2 > matcher->pattern_capacity) {
+        uint32_t capacity = matcher->pattern_capacity ? matcher->pattern_capacity * 2 : 64;
+        uint32_t *offsets = (uint32_t *)duckdb_malloc(capacity * sizeof(uint32_t));
+        if (!offsets) {
+            return -1;
+        }
+        if (matcher->pattern_offsets) {
+            memcpy(offsets, matcher->pattern_offsets, (matcher->pattern_count + 1) * sizeof(uint32_t));
+            duckdb_free(matcher->pattern_offsets);
+        } else {
+            offsets[0] = 0;
+        }
+        matcher->pattern_offsets = offsets;
+        matcher->pattern_capacity = capacity;
+    }
+    if (matcher->bytes_len + len > matcher->bytes_capacity) {
+        size_t capacity = matcher->bytes_capacity ? matcher->bytes_capacity * 2 : 1024;
+        while (capacity < matcher->bytes_len + len) {
+            capacity *= 2;
+        }
+        uint8_t *bytes = (uint8_t *)duckdb_malloc(capacity);
+        if (!bytes) {
+            return -1;
+        }
+        if (matcher->pattern_bytes) {
+            memcpy(bytes, matcher->pattern_bytes, matcher->bytes_len);
+            duckdb_free(matcher->pattern_bytes);
+        }
+        matcher->pattern_bytes = bytes;
+        matcher->bytes_capacity = capacity;
+    }
+    for (size_t i = 0; i < len; i++) {
+        matcher->pattern_bytes[matcher->bytes_len + i] = FoldByte(pattern[i]);
+    }
+    matcher->bytes_len += len;
+    matcher->pattern_offsets[matcher->pattern_count + 1] = (uint32_t)matcher->bytes_len;
+    return matcher->pattern_count++;
+}
+
+int AcCompile(ac_matcher_t *matcher) {
+    // Bytes that occur in some pattern get a class of their own (shared by
+    // both cases of a letter); all other bytes share class 0
+    memset(matcher->byte_class, 0, sizeof(matcher->byte_class));
+    matcher->class_count = 1;
+    for (size_t i = 0; i < matcher->bytes_len; i++) {
+        uint8_t c = matcher->pattern_bytes[i];
+        if (!matcher->byte_class[c]) {
+            matcher->byte_class[c] = (uint8_t)matcher->class_count++;
+        }
+    }
+    for (uint8_t c = 'a'; c <= 'z'; c++) {
+        matcher->byte_class[c - 32] = matcher->byte_class[c];
+    }
+
+    // The trie has at most one state per pattern byte plus the root
+    size_t max_states = matcher->bytes_len + 1;
+    size_t class_count = matcher->class_count;
+    matcher->transitions = (uint32_t *)duckdb_malloc(max_states * class_count * sizeof(uint32_t));
+    matcher->first_pattern = (uint32_t *)duckdb_malloc(max_states * sizeof(uint32_t));
+    matcher->output_link = (uint32_t *)duckdb_malloc(max_states * sizeof(uint32_t));
+    matcher->next_pattern = (uint32_t *)duckdb_malloc((matcher->pattern_count + 1) * sizeof(uint32_t));
+    uint32_t *fail = (uint32_t *)duckdb_malloc(max_states * sizeof(uint32_t));
+    uint32_t *queue = (uint32_t *)duckdb_malloc(max_states * sizeof(uint32_t));
+    if (!matcher->transitions || !matcher->first_pattern || !matcher->output_link || !matcher->next_pattern ||
+        !fail || !queue) {
+        duckdb_free(fail);
+        duckdb_free(queue);
+        return 0;
+    }
+    memset(matcher->transitions, 0, max_states * class_count * sizeof(uint32_t));
+    memset(matcher->first_pattern, 0, max_states * sizeof(uint32_t));
+    memset(matcher->output_link, 0, max_states * sizeof(uint32_t));
+
+    // Trie: 0 doubles as "no edge" since no edge leads back to the root
+    uint32_t state_count = 1;
+    for (uint32_t p = 0; p < matcher->pattern_count; p++) {
+        uint32_t state = AC_ROOT;
+        for (uint32_t i = matcher->pattern_offsets[p]; i < matcher->pattern_offsets[p + 1]; i++) {
+            uint32_t *edge = &matcher->transitions[state * class_count + matcher->byte_class[matcher->pattern_bytes[i]]];
+            if (!*edge) {
+                *edge = state_count++;
+            }
+            state = *edge;
+        }
+        matcher->next_pattern[p] = matcher->first_pattern[state];
+        matcher->first_pattern[state] = p + 1;
+    }
+    matcher->state_count = state_count;
+
+    // Breadth-first: fail links, output links and the full DFA transitions
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    fail[AC_ROOT] = AC_ROOT;
+    for (size_t c = 0; c < class_count; c++) {
+        uint32_t child = matcher->transitions[c];
+        if (child) {
+            fail[child] = AC_ROOT;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t suffix = fail[state];
+        matcher->output_link[state] = matcher->first_pattern[suffix] ? suffix : matcher->output_link[suffix];
+        for (size_t c = 0; c < class_count; c++) {
+            uint32_t *edge = &matcher->transitions[(size_t)state * class_count + c];
+            uint32_t via_fail = matcher->transitions[(size_t)suffix * class_count + c];
+            if (*edge) {
+                fail[*edge] = via_fail;
+                queue[tail++] = *edge;
+            } else {
+                *edge = via_fail;
+            }
+        }
+    }
+    duckdb_free(fail);
+    duckdb_free(queue);
+
+    // Store transition targets as row offsets, flagging states that report
+    // patterns, so the scan loop needs one load per byte
+    if ((size_t)state_count * class_count > AC_OUTPUT_FLAG) {
+        return 0;
+    }
+    for (size_t i = 0; i < (size_t)state_count * class_count; i++) {
+        uint32_t target = matcher->transitions[i];
+        int reports = matcher->first_pattern[target] || matcher->output_link[target];
+        matcher->transitions[i] = (uint32_t)(target * class_count) | (reports ? AC_OUTPUT_FLAG : 0);
+    }
+    for (size_t c = 0; c < 256; c++) {
+        matcher->leaves_root[c] = matcher->transitions[matcher->byte_class[c]] != AC_ROOT;
+    }
+    return 1;
+}
+
+uint32_t AcScan(const ac_matcher_t *matcher, uint32_t state, const uint8_t *data, size_t len,
+                ac_match_callback_t callback, void *context) {
+    const uint32_t *transitions = matcher->transitions;
+    const uint8_t *byte_class = matcher->byte_class;
+    const uint8_t *leaves_root = matcher->leaves_root;
+    if (!transitions || !matcher->pattern_count) {
+        return state;
+    }
+    for (size_t i = 0; i < len; i++) {
+        // Most bytes of typical payloads keep the automaton at the root;
+        // skipping them does not depend on the previous transition
+        if (state == AC_ROOT) {
+            while (i + 8 <= len && !(leaves_root[data[i]] | leaves_root[data[i + 1]] | leaves_root[data[i + 2]] |
+                                     leaves_root[data[i + 3]] | leaves_root[data[i + 4]] | leaves_root[data[i + 5]] |
+                                     leaves_root[data[i + 6]] | leaves_root[data[i + 7]])) {
+                i += 8;
+            }
+            while (i < len && !leaves_root[data[i]]) {
+                i++;
+            }
+            if (i == len) {
+                break;
+            }
+        }
+        state = transitions[(state & ~AC_OUTPUT_FLAG) + byte_class[data[i]]];
+        if (!(state & AC_OUTPUT_FLAG)) {
+            continue;
+        }
+        uint32_t index = (state & ~AC_OUTPUT_FLAG) / matcher->class_count;
+        uint32_t out = matcher->first_pattern[index] ? index : matcher->output_link[index];
+        while (out) {
+            for (uint32_t p = matcher->first_pattern[out]; p; p = matcher->next_pattern[p - 1]) {
+                if (callback(context, p - 1, i + 1)) {
+                    return state;
+                }
+            }
+            out = matcher->output_link[out];
+        }
+    }
+    return state;
+}
@@ -0,0 +1,575 @@
+#include "app_classifier.h"
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+const char *const app_protocol_names[APP_PROTOCOL_COUNT] = {
+    "unknown", "http", "http2",  "tls",  "dtls",   "quic", "ssh", "dns",  "smtp", "ftp",
+    "pop3",    "imap", "smb",    "rdp",  "sip",    "stun", "mqtt", "bittorrent", "wireguard",
+    "bgp",     "modbus", "dnp3", "s7comm", "ntp",  "ptp",  "dhcp", "snmp", "syslog"};
+
+// Cached classification of one flow
+typedef struct {
+    uint8_t verdict;      // app_protocol_t
+    uint8_t decided;
+    uint8_t inspected;    // payload packets looked at so far
+    uint8_t fin;          // FIN seen, bit per flow direction
+} app_flow_t;
+
+// ---------------------------------------------------------------------------
+// Signatures
+// ---------------------------------------------------------------------------
+
+static int HasPrefix(const uint8_t *p, size_t len, const char *prefix) {
+    size_t prefix_len = strlen(prefix);
+    return len >= prefix_len && memcmp(p, prefix, prefix_len) == 0;
+}
+
+// Whether the first line of p contains needle
+static int LineContains(const uint8_t *p, size_t len, const char *needle) {
+    size_t needle_len = strlen(needle);
+    for (size_t i = 0; i + needle_len <= len && p[i] != '\n'; i++) {
+        if (memcmp(p + i, needle, needle_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int IsHttp(const uint8_t *p, size_t len) {
+    static const char *const methods[] = {"GET ",     "POST ",  "HEAD ",  "PUT ",     "DELETE ",
+                                          "OPTIONS ", "PATCH ", "TRACE ", "CONNECT "};
+    if (HasPrefix(p, len, "HTTP/1.")) {
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        size_t method_len = strlen(methods[i]);
+        if (HasPrefix(p, len, methods[i]) && len > method_len) {
+            // Origin, absolute or asterisk form, or an authority for CONNECT
+            uint8_t c = p[method_len];
+            return c == '/' || c == '*' || c == 'h' || (i == 8 && c != ' ');
+        }
+    }
+    return 0;
+}
+
+static int IsSip(const uint8_t *p, size_t len) {
+    static const char *const starts[] = {"SIP/2.0 ",     "INVITE sip:", "REGISTER sip:",  "OPTIONS sip:",
+                                         "ACK sip:",     "BYE sip:",    "CANCEL sip:",    "SUBSCRIBE sip:",
+                                         "NOTIFY sip:",  "MESSAGE sip:", "INFO sip:",     "PRACK sip:"};
+    for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+        if (HasPrefix(p, len, starts[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// A record header of SSL 3.0 - TLS 1.3; handshake records must hold a hello
+static int IsTls(const uint8_t *p, size_t len) {
+    if (len < 6 || p[0] < 20 || p[0] > 23 || p[1] != 3 || p[2] > 4 || PacketRead16(p + 3) > 18432) {
+        return 0;
+    }
+    return p[0] != 22 || p[5] == 1 || p[5] == 2;
+}
+
+static int IsDtls(const uint8_t *p, size_t len) {
+    return len >= 13 && p[0] >= 20 && p[0] <= 23 && p[1] == 0xFE && (p[2] == 0xFF || p[2] == 0xFD || p[2] == 0xFC) &&
+           13 + (size_t)PacketRead16(p + 11) <= len;
+}
+
+// An identification string, possibly after other lines (RFC 4253 section 4.2)
+static int IsSsh(const uint8_t *p, size_t len) {
+    if (HasPrefix(p, len, "SSH-")) {
+        return 1;
+    }
+    for (size_t i = 0; i + 5 <= len; i++) {
+        if (p[i] == '\n' && memcmp(p + i + 1, "SSH-", 4) == 0) {
+            return 1;
+        }
+        if (p[i] != '\r' && p[i] != '\n' && p[i] != '\t' && (p[i] < 0x20 || p[i] > 0x7E)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// Text banner or greeting of the mail and file transfer protocols
+static app_protocol_t ClassifyGreeting(const uint8_t *p, size_t len) {
+    if (len >= 4 && p[0] == '2' && p[1] == '2' && p[2] == '0' && (p[3] == ' ' || p[3] == '-')) {
+        if (LineContains(p, len, "SMTP")) {
+            return APP_PROTOCOL_SMTP;
+        }
+        if (LineContains(p, len, "FTP")) {
+            return APP_PROTOCOL_FTP;
+        }
+        return APP_PROTOCOL_UNKNOWN;
+    }
+    if (HasPrefix(p, len, "EHLO ") || HasPrefix(p, len, "HELO ")) {
+        return APP_PROTOCOL_SMTP;
+    }
+    if (HasPrefix(p, len, "+OK")) {
+        return APP_PROTOCOL_POP3;
+    }
+    if (HasPrefix(p, len, "* OK") || HasPrefix(p, len, "* PREAUTH")) {
+        return APP_PROTOCOL_IMAP;
+    }
+    return APP_PROTOCOL_UNKNOWN;
+}
+
+// TPKT + COTP carries both RDP and S7comm
+static app_protocol_t ClassifyTpkt(const uint8_t *p, size_t len) {
+    if (len < 7 || p[0] != 3 || p[1] != 0 || PacketRead16(p + 2) != len || p[4] + 5u > len) {
+        return APP_PROTOCOL_UNKNOWN;
+    }
+    uint8_t tpdu = p[5] & 0xF0;
+    if (tpdu == 0xF0) {
+        return len > 7 && p[7] == 0x32 ? APP_PROTOCOL_S7COMM : APP_PROTOCOL_UNKNOWN;
+    }
+    if (tpdu == 0xE0 || tpdu == 0xD0) {
+        // RDP connection requests carry a routing cookie or an RDP negotiation
+        // structure; S7 connections use TSAP parameters
+        if ((len > 11 && LineContains(p + 11, len - 11, "Cookie: ")) ||
+            (len >= 19 && (p[len - 8] == 0x01 || p[len - 8] == 0x02) && p[len - 6] == 0x08 && p[len - 5] == 0)) {
+            return APP_PROTOCOL_RDP;
+        }
+        for (size_t pos = 11; pos + 2 <= (size_t)p[4] + 5 && pos + 2 <= len; pos += 2u + p[pos + 1]) {
+            if (p[pos] == 0xC1 || p[pos] == 0xC2) {
+                return APP_PROTOCOL_S7COMM;
+            }
+        }
+    }
+    return APP_PROTOCOL_UNKNOWN;
+}
+
+static int IsModbus(const uint8_t *p, size_t len) {
+    if (len < 8 || PacketRead16(p + 2) != 0 || PacketRead16(p + 4) + 6u != len) {
+        return 0;
+    }
+    switch (p[7] & 0x7F) {
+    case 1: case 2: case 3: case 4: case 5: case 6: case 7: case 8: case 11: case 12:
+    case 15: case 16: case 17: case 20: case 21: case 22: case 23: case 24: case 43:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int IsBgp(const uint8_t *p, size_t len) {
+    if (len < 19) {
+        return 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (p[i] != 0xFF) {
+            return 0;
+        }
+    }
+    uint16_t length = PacketRead16(p + 16);
+    return length >= 19 && length <= 4096 && p[18] >= 1 && p[18] <= 5;
+}
+
+static int IsMqttConnect(const uint8_t *p, size_t len) {
+    if (len < 2 || p[0] != 0x10) {
+        return 0;
+    }
+    // Variable-length remaining length, then the protocol name
+    size_t pos = 1;
+    while (pos < len && pos < 5 && (p[pos] & 0x80)) {
+        pos++;
+    }
+    pos++;
+    if (pos >= len) {
+        return 0;
+    }
+    // Embedded NULs: compare with memcmp rather than HasPrefix
+    return (len - pos >= 6 && memcmp(p + pos, "\x00\x04MQTT", 6) == 0) ||
+           (len - pos >= 8 && memcmp(p + pos, "\x00\x06MQIsdp", 8) == 0);
+}
+
+// DNS message header and first question (RFC 1035 section 4.1)
+static int IsDnsMessage(const uint8_t *p, size_t len) {
+    if (len < 17) {
+        return 0;
+    }
+    uint16_t flags = PacketRead16(p + 2);
+    uint8_t opcode = (uint8_t)((flags >> 11) & 0x0F);
+    if ((opcode > 2 && opcode != 4 && opcode != 5) || (flags & 0x0040) || PacketRead16(p + 4) != 1 ||
+        PacketRead16(p + 6) > 255 || PacketRead16(p + 8) > 255 || PacketRead16(p + 10) > 255) {
+        return 0;
+    }
+    size_t pos = 12;
+    size_t name_len = 0;
+    while (pos < len && p[pos]) {
+        if (p[pos] > 63) {
+            return 0;
+        }
+        name_len += 1u + p[pos];
+        pos += 1u + p[pos];
+        if (name_len > 255) {
+            return 0;
+        }
+    }
+    if (pos + 5 > len) {
+        return 0;
+    }
+    // QCLASS IN, CH, HS or ANY; mDNS sets the top bit for unicast responses
+    uint16_t qclass = PacketRead16(p + pos + 3) & 0x7FFF;
+    return qclass == 1 || qclass == 3 || qclass == 4 || qclass == 255;
+}
+
+static int IsQuicLongHeader(const uint8_t *p, size_t len) {
+    if (len < 7 || (p[0] & 0xC0) != 0xC0 || p[5] > 20) {
+        return 0;
+    }
+    uint32_t version = PacketRead32(p + 1);
+    // v1, v2, IETF drafts, or version negotiation
+    return version == 0x00000001 || version == 0x6B3343CF || (version & 0xFFFFFF00) == 0xFF000000 || version == 0;
+}
+
+static int IsStun(const uint8_t *p, size_t len) {
+    return len >= 20 && (p[0] & 0xC0) == 0 && PacketRead32(p + 4) == 0x2112A442 && PacketRead16(p + 2) + 20u == len;
+}
+
+static int IsWireGuard(const uint8_t *p, size_t len) {
+    if (len < 4 || p[1] || p[2] || p[3]) {
+        return 0;
+    }
+    switch (p[0]) {
+    case 1: return len == 148;
+    case 2: return len == 92;
+    case 3: return len == 64;
+    case 4: return len >= 32 && (len - 32) % 16 == 0;
+    default: return 0;
+    }
+}
+
+static int IsNtp(const uint8_t *p, size_t len) {
+    uint8_t version = (uint8_t)((p[0] >> 3) & 0x07);
+    uint8_t mode = p[0] & 0x07;
+    return (len == 48 || len == 68 || len == 72) && version >= 1 && version <= 4 && mode >= 1 && mode <= 5 &&
+           p[1] <= 16;
+}
+
+static int IsPtp(const uint8_t *p, size_t len) {
+    if (len < 34 || (p[1] & 0x0F) != 2) {
+        return 0;
+    }
+    uint8_t type = p[0] & 0x0F;
+    uint16_t length = PacketRead16(p + 2);
+    return (type <= 3 || (type >= 8 && type <= 13)) && length >= 34 && length <= len;
+}
+
+static int IsDhcp(const uint8_t *p, size_t len) {
+    return len >= 240 && (p[0] == 1 || p[0] == 2) && p[1] == 1 && p[2] == 6 && PacketRead32(p + 236) == 0x63825363;
+}
+
+// BER SEQUENCE { INTEGER version (v1, v2c, v3), ... }
+static int IsSnmp(const uint8_t *p, size_t len) {
+    if (len < 8 || p[0] != 0x30) {
+        return 0;
+    }
+    size_t pos = 2;
+    if (p[1] & 0x80) {
+        pos += p[1] & 0x7F;
+    }
+    return pos + 3 <= len && p[pos] == 0x02 && p[pos + 1] == 0x01 && (p[pos + 2] <= 1 || p[pos + 2] == 3);
+}
+
+static int IsSyslog(const uint8_t *p, size_t len) {
+    if (len < 4 || p[0] != '<') {
+        return 0;
+    }
+    size_t pos = 1;
+    while (pos < len && pos < 4 && p[pos] >= '0' && p[pos] <= '9') {
+        pos++;
+    }
+    return pos > 1 && pos < len && p[pos] == '>';
+}
+
+static app_protocol_t ClassifyTcp(const uint8_t *p, size_t len) {
+    if (IsTls(p, len)) {
+        return APP_PROTOCOL_TLS;
+    }
+    if (IsHttp(p, len)) {
+        return APP_PROTOCOL_HTTP;
+    }
+    if (HasPrefix(p, len, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n")) {
+        return APP_PROTOCOL_HTTP2;
+    }
+    if (IsSsh(p, len)) {
+        return APP_PROTOCOL_SSH;
+    }
+    if (IsSip(p, len)) {
+        return APP_PROTOCOL_SIP;
+    }
+    app_protocol_t greeting = ClassifyGreeting(p, len);
+    if (greeting != APP_PROTOCOL_UNKNOWN) {
+        return greeting;
+    }
+    if (len >= 8 && p[0] == 0 && (HasPrefix(p + 4, len - 4, "\xFFSMB") || HasPrefix(p + 4, len - 4, "\xFESMB") ||
+                                  HasPrefix(p + 4, len - 4, "\xFDSMB"))) {
+        return APP_PROTOCOL_SMB;
+    }
+    if (len >= 20 && p[0] == 19 && HasPrefix(p + 1, len - 1, "BitTorrent protocol")) {
+        return APP_PROTOCOL_BITTORRENT;
+    }
+    if (IsBgp(p, len)) {
+        return APP_PROTOCOL_BGP;
+    }
+    if (IsMqttConnect(p, len)) {
+        return APP_PROTOCOL_MQTT;
+    }
+    app_protocol_t tpkt = ClassifyTpkt(p, len);
+    if (tpkt != APP_PROTOCOL_UNKNOWN) {
+        return tpkt;
+    }
+    if (len >= 10 && p[0] == 0x05 && p[1] == 0x64 && p[2] >= 5) {
+        return APP_PROTOCOL_DNP3;
+    }
+    if (IsModbus(p, len)) {
+        return APP_PROTOCOL_MODBUS;
+    }
+    // DNS over TCP: two-byte length prefix
+    if (len >= 14 && PacketRead16(p) + 2u == len && IsDnsMessage(p + 2, len - 2)) {
+        return APP_PROTOCOL_DNS;
+    }
+    return APP_PROTOCOL_UNKNOWN;
+}
+
+static app_protocol_t ClassifyUdp(const uint8_t *p, size_t len, size_t full_len) {
+    // Length-exact checks use the whole datagram, content checks the prefix
+    if (IsStun(p, full_len)) {
+        return APP_PROTOCOL_STUN;
+    }
+    if (IsDtls(p, len)) {
+        return APP_PROTOCOL_DTLS;
+    }
+    if (IsQuicLongHeader(p, len)) {
+        return APP_PROTOCOL_QUIC;
+    }
+    if (IsWireGuard(p, full_len)) {
+        return APP_PROTOCOL_WIREGUARD;
+    }
+    if (IsDhcp(p, len)) {
+        return APP_PROTOCOL_DHCP;
+    }
+    if (IsPtp(p, full_len)) {
+        return APP_PROTOCOL_PTP;
+    }
+    if (IsNtp(p, full_len)) {
+        return APP_PROTOCOL_NTP;
+    }
+    if (IsSip(p, len)) {
+        return APP_PROTOCOL_SIP;
+    }
+    if (IsSyslog(p, len)) {
+        return APP_PROTOCOL_SYSLOG;
+    }
+    if (HasPrefix(p, len, "d1:ad2:id20:") || HasPrefix(p, len, "d1:rd2:id20:")) {
+        return APP_PROTOCOL_BITTORRENT;
+    }
+    if (len >= 10 && p[0] == 0x05 && p[1] == 0x64 && p[2] >= 5) {
+        return APP_PROTOCOL_DNP3;
+    }
+    if (IsSnmp(p, len)) {
+        return APP_PROTOCOL_SNMP;
+    }
+    if (IsDnsMessage(p, len)) {
+        return APP_PROTOCOL_DNS;
+    }
+    return APP_PROTOCOL_UNKNOWN;
+}
+
+app_protocol_t AppClassifyPayload(const packet_info_t *pkt) {
+    if (!pkt->payload || !pkt->payload_len || pkt->is_fragment) {
+        return APP_PROTOCOL_UNKNOWN;
+    }
+    size_t len = pkt->payload_len < APP_INSPECT_BYTES ? pkt->payload_len : APP_INSPECT_BYTES;
+    if (pkt->ip_proto == IPPROTO_NUM_TCP) {
+        // Exact-length checks only make sense when the segment was not cut short
+        return ClassifyTcp(pkt->payload, pkt->payload_len <= APP_INSPECT_BYTES ? pkt->payload_len : len);
+    }
+    if (pkt->ip_proto == IPPROTO_NUM_UDP) {
+        return ClassifyUdp(pkt->payload, len, pkt->payload_len);
+    }
+    return APP_PROTOCOL_UNKNOWN;
+}
+
+// ---------------------------------------------------------------------------
+// Flow verdict cache
+// ---------------------------------------------------------------------------
+
+int AppClassifierInit(app_classifier_t *classifier) {
+    return HashMapInit(&classifier->flows, sizeof(flow_key_t), sizeof(app_flow_t));
+}
+
+void AppClassifierDestroy(app_classifier_t *classifier) {
+    HashMapDestroy(&classifier->flows);
+}
+
+app_protocol_t AppClassifierPacket(app_classifier_t *classifier, const packet_info_t *pkt) {
+    if ((pkt->ip_proto != IPPROTO_NUM_TCP && pkt->ip_proto != IPPROTO_NUM_UDP) || pkt->is_fragment) {
+        return APP_PROTOCOL_UNKNOWN;
+    }
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0) {
+        return APP_PROTOCOL_UNKNOWN;
+    }
+
+    app_flow_t *flow = (app_flow_t *)HashMapFind(&classifier->flows, &key);
+    if (!flow || !flow->decided) {
+        if (!pkt->payload_len) {
+            // Only payload packets start an entry, so bare ACKs after a close
+            // do not leave one behind
+            return flow ? (app_protocol_t)flow->verdict : APP_PROTOCOL_UNKNOWN;
+        }
+        if (!flow) {
+            if (classifier->flows.count >= APP_MAX_FLOWS) {
+                HashMapDestroy(&classifier->flows);
+                if (!HashMapInit(&classifier->flows, sizeof(flow_key_t), sizeof(app_flow_t))) {
+                    return APP_PROTOCOL_UNKNOWN;
+                }
+            }
+            int is_new;
+            flow = (app_flow_t *)HashMapInsert(&classifier->flows, &key, &is_new);
+            if (!flow) {
+                return AppClassifyPayload(pkt);
+            }
+        }
+        app_protocol_t verdict = AppClassifyPayload(pkt);
+        flow->inspected++;
+        if (verdict != APP_PROTOCOL_UNKNOWN || flow->inspected >= APP_MAX_INSPECT_PACKETS) {
+            flow->verdict = (uint8_t)verdict;
+            flow->decided = 1;
+        }
+    }
+
+    app_protocol_t verdict = (app_protocol_t)flow->verdict;
+    if (pkt->ip_proto == IPPROTO_NUM_TCP) {
+        if (pkt->tcp_flags & TCP_FLAG_FIN) {
+            flow->fin |= (uint8_t)(1 << direction);
+        }
+        if ((pkt->tcp_flags & TCP_FLAG_RST) || flow->fin == 3) {
+            HashMapRemove(&classifier->flows, &key);
+        }
+    }
+    return verdict;
+}
+
+// ---------------------------------------------------------------------------
+// pcap_classify(path)
+// ---------------------------------------------------------------------------
+
+enum {
+    CLASSIFY_COL_TIMESTAMP,
+    CLASSIFY_COL_SRC_IP,
+    CLASSIFY_COL_SRC_PORT,
+    CLASSIFY_COL_DST_IP,
+    CLASSIFY_COL_DST_PORT,
+    CLASSIFY_COL_IP_PROTO,
+    CLASSIFY_COL_PAYLOAD_LEN,
+    CLASSIFY_COL_APP_PROTOCOL,
+    CLASSIFY_COL_COUNT
+};
+
+typedef struct {
+    pcap_source_t *source;
+    app_classifier_t classifier;
+} classify_state_t;
+
+static void ClassifyInitDataFree(void *data) {
+    classify_state_t *state = (classify_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        AppClassifierDestroy(&state->classifier);
+        duckdb_free(state);
+    }
+}
+
+static void ClassifyBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "ip_proto", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "payload_len", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddEnumColumn(info, "app_protocol", app_protocol_names, APP_PROTOCOL_COUNT);
+}
+
+static void ClassifyInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    classify_state_t *state = (classify_state_t *)duckdb_malloc(sizeof(classify_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(classify_state_t));
+    if (!AppClassifierInit(&state->classifier)) {
+        ClassifyInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        ClassifyInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, ClassifyInitDataFree);
+}
+
+static void ClassifyFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    classify_state_t *state = (classify_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[CLASSIFY_COL_COUNT];
+    for (idx_t i = 0; i < CLASSIFY_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamps = (uint64_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_TIMESTAMP]);
+    uint16_t *src_ports = (uint16_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_SRC_PORT]);
+    uint16_t *dst_ports = (uint16_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_DST_PORT]);
+    uint8_t *ip_protos = (uint8_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_IP_PROTO]);
+    uint32_t *payload_lens = (uint32_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_PAYLOAD_LEN]);
+    uint8_t *app_protocols = (uint8_t *)duckdb_vector_get_data(vectors[CLASSIFY_COL_APP_PROTOCOL]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    char addr[64];
+    while (row_count < max_rows && PcapSourceNext(state->source, &packet)) {
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) || !pkt.ip_version) {
+            continue;
+        }
+        idx_t row = row_count++;
+        timestamps[row] = packet.timestamp_ns;
+        PacketFormatIp(pkt.ip_version, pkt.src_ip, addr, sizeof(addr));
+        duckdb_vector_assign_string_element(vectors[CLASSIFY_COL_SRC_IP], row, addr);
+        PacketFormatIp(pkt.ip_version, pkt.dst_ip, addr, sizeof(addr));
+        duckdb_vector_assign_string_element(vectors[CLASSIFY_COL_DST_IP], row, addr);
+        src_ports[row] = pkt.src_port;
+        dst_ports[row] = pkt.dst_port;
+        ip_protos[row] = pkt.ip_proto;
+        payload_lens[row] = pkt.payload ? pkt.payload_len : 0;
+        if (pkt.ip_proto == IPPROTO_NUM_TCP || pkt.ip_proto == IPPROTO_NUM_UDP) {
+            app_protocols[row] = (uint8_t)AppClassifierPacket(&state->classifier, &pkt);
+        } else {
+            PcapVectorSetNull(vectors[CLASSIFY_COL_APP_PROTOCOL], row);
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterClassifyFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_classify", ClassifyBind, ClassifyInit, ClassifyFunction);
+}
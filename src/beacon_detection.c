@@ -0,0 +1,340 @@
+#include "duckdb_extension.h"
+#include "beacon_detection.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Client and server of a pair; the server is the endpoint with the lower
+// port, so both directions of an exchange share one pair
+typedef struct {
+    uint8_t ip_version;
+    uint8_t ip_proto;
+    uint16_t server_port;
+    uint8_t client[16];
+    uint8_t server[16];
+} beacon_key_t;
+
+// Timing sketch of a pair. Intervals are between the starts of consecutive
+// events; mean and m2 are Welford's running mean and sum of squared
+// deviations, in seconds.
+typedef struct {
+    uint64_t first_ns;      // start of the first event
+    uint64_t event_ns;      // start of the current event
+    uint64_t last_ns;       // last packet
+    uint64_t events;
+    double mean;
+    double m2;
+    uint8_t histogram[BEACON_HIST_BUCKETS];
+} beacon_pair_t;
+
+typedef struct {
+    char *filename;
+    uint64_t min_events;
+} beacon_bind_t;
+
+typedef struct {
+    pcap_source_t *source;
+    hash_map_t pairs;         // beacon_key_t -> beacon_pair_t
+    int scanned;
+    size_t position;          // next pair to emit
+} beacon_state_t;
+
+enum {
+    BEACON_COL_SRC_IP,
+    BEACON_COL_DST_IP,
+    BEACON_COL_DST_PORT,
+    BEACON_COL_IP_PROTO,
+    BEACON_COL_EVENTS,
+    BEACON_COL_FIRST_TIMESTAMP,
+    BEACON_COL_LAST_TIMESTAMP,
+    BEACON_COL_MEAN_INTERVAL,
+    BEACON_COL_STDDEV_INTERVAL,
+    BEACON_COL_MODE_INTERVAL,
+    BEACON_COL_MODE_FRACTION,
+    BEACON_COL_SCORE,
+    BEACON_COL_COUNT
+};
+
+// Histogram bucket of an interval: the octave of its length in ms and the
+// two bits after the leading one
+static uint32_t IntervalBucket(uint64_t interval_ns) {
+    uint64_t ms = interval_ns / 1000000;
+    if (ms < (1ULL << BEACON_HIST_MIN_OCTAVE)) {
+        return 0;
+    }
+    uint32_t octave = 63;
+    while (!(ms >> octave)) {
+        octave--;
+    }
+    uint32_t quarter = (uint32_t)(ms >> (octave - 2)) & 3;
+    uint32_t bucket = (octave - BEACON_HIST_MIN_OCTAVE) * 4 + quarter;
+    return bucket < BEACON_HIST_BUCKETS ? bucket : BEACON_HIST_BUCKETS - 1;
+}
+
+// Middle of a bucket's range, in seconds
+static double BucketSeconds(uint32_t bucket) {
+    uint32_t octave = bucket / 4 + BEACON_HIST_MIN_OCTAVE;
+    double low = (double)((4ULL + bucket % 4) << (octave - 2));
+    double high = (double)((5ULL + bucket % 4) << (octave - 2));
+    return (low + high) / 2 / 1000;
+}
+
+// Newton's method; only used per output row
+static double SquareRoot(double x) {
+    if (x <= 0) {
+        return 0;
+    }
+    double root = x > 1 ? x : 1;
+    for (int i = 0; i < 128; i++) {
+        double next = (root + x / root) / 2;
+        if (next >= root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+static void AddInterval(beacon_pair_t *pair, uint64_t interval_ns) {
+    double seconds = (double)interval_ns / 1e9;
+    uint64_t intervals = pair->events - 1;
+    double delta = seconds - pair->mean;
+    pair->mean += delta / (double)intervals;
+    pair->m2 += delta * (seconds - pair->mean);
+
+    uint32_t bucket = IntervalBucket(interval_ns);
+    if (pair->histogram[bucket] == UINT8_MAX) {
+        for (uint32_t i = 0; i < BEACON_HIST_BUCKETS; i++) {
+            pair->histogram[i] /= 2;
+        }
+    }
+    pair->histogram[bucket]++;
+}
+
+static void ObservePacket(beacon_state_t *state, uint64_t timestamp_ns, const packet_info_t *pkt) {
+    size_t addr_len = pkt->ip_version == 4 ? 4 : 16;
+    beacon_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.ip_version = pkt->ip_version;
+    key.ip_proto = pkt->ip_proto;
+    int cmp = memcmp(pkt->src_ip, pkt->dst_ip, addr_len);
+    int from_server = pkt->src_port < pkt->dst_port || (pkt->src_port == pkt->dst_port && cmp < 0);
+    memcpy(key.client, from_server ? pkt->dst_ip : pkt->src_ip, addr_len);
+    memcpy(key.server, from_server ? pkt->src_ip : pkt->dst_ip, addr_len);
+    key.server_port = from_server ? pkt->src_port : pkt->dst_port;
+
+    int is_new;
+    beacon_pair_t *pair = (beacon_pair_t *)HashMapInsert(&state->pairs, &key, &is_new);
+    if (!pair) {
+        return;
+    }
+    if (is_new) {
+        pair->first_ns = pair->event_ns = pair->last_ns = timestamp_ns;
+        pair->events = 1;
+        return;
+    }
+    // Packets out of timestamp order stay in the current event
+    if (timestamp_ns >= pair->last_ns + BEACON_IDLE_NS) {
+        uint64_t interval_ns = timestamp_ns - pair->event_ns;
+        pair->events++;
+        pair->event_ns = timestamp_ns;
+        AddInterval(pair, interval_ns);
+    }
+    if (timestamp_ns > pair->last_ns) {
+        pair->last_ns = timestamp_ns;
+    }
+}
+
+static void BeaconBindDataFree(void *data) {
+    beacon_bind_t *bind = (beacon_bind_t *)data;
+    if (bind) {
+        duckdb_free(bind->filename);
+        duckdb_free(bind);
+    }
+}
+
+static void BeaconBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    beacon_bind_t *bind = (beacon_bind_t *)duckdb_malloc(sizeof(beacon_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, BeaconBindDataFree);
+
+    duckdb_value min_value = duckdb_bind_get_parameter(info, 1);
+    int is_null = duckdb_is_null_value(min_value);
+    int64_t min_events = is_null ? 0 : duckdb_get_int64(min_value);
+    duckdb_destroy_value(&min_value);
+    if (is_null || min_events < 2) {
+        duckdb_bind_set_error(info, "min_events must be at least 2");
+        return;
+    }
+    bind->min_events = (uint64_t)min_events;
+
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "ip_proto", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "events", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "first_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "last_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "mean_interval_s", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "stddev_interval_s", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "mode_interval_s", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "mode_fraction", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "score", DUCKDB_TYPE_DOUBLE);
+}
+
+static void BeaconInitDataFree(void *data) {
+    beacon_state_t *state = (beacon_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        HashMapDestroy(&state->pairs);
+        duckdb_free(state);
+    }
+}
+
+static void BeaconInit(duckdb_init_info info) {
+    beacon_bind_t *bind = (beacon_bind_t *)duckdb_init_get_bind_data(info);
+
+    beacon_state_t *state = (beacon_state_t *)duckdb_malloc(sizeof(beacon_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(beacon_state_t));
+    if (!HashMapInit(&state->pairs, sizeof(beacon_key_t), sizeof(beacon_pair_t))) {
+        BeaconInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        BeaconInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, BeaconInitDataFree);
+}
+
+// The most common interval and the share of intervals within one bucket of
+// it, which tolerates jitter and the odd missed or extra event
+static uint32_t HistogramMode(const beacon_pair_t *pair, double *fraction) {
+    uint32_t total = 0;
+    uint32_t best = 0;
+    uint32_t best_count = 0;
+    for (uint32_t i = 0; i < BEACON_HIST_BUCKETS; i++) {
+        uint32_t count = pair->histogram[i];
+        total += count;
+        if (i > 0) {
+            count += pair->histogram[i - 1];
+        }
+        if (i + 1 < BEACON_HIST_BUCKETS) {
+            count += pair->histogram[i + 1];
+        }
+        if (count > best_count || (count == best_count && pair->histogram[i] > pair->histogram[best])) {
+            best = i;
+            best_count = count;
+        }
+    }
+    *fraction = total ? (double)best_count / total : 0;
+    return best;
+}
+
+static void BeaconFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    beacon_bind_t *bind = (beacon_bind_t *)duckdb_function_get_bind_data(info);
+    beacon_state_t *state = (beacon_state_t *)duckdb_function_get_init_data(info);
+
+    // Every pair is complete only at the end of the capture
+    if (!state->scanned) {
+        pcap_packet_t packet;
+        packet_info_t pkt;
+        while (PcapSourceNext(state->source, &packet)) {
+            if (PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) && pkt.ip_version &&
+                !pkt.is_fragment) {
+                ObservePacket(state, packet.timestamp_ns, &pkt);
+            }
+        }
+        state->scanned = 1;
+    }
+
+    duckdb_vector vectors[BEACON_COL_COUNT];
+    for (idx_t i = 0; i < BEACON_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint16_t *ports = (uint16_t *)duckdb_vector_get_data(vectors[BEACON_COL_DST_PORT]);
+    uint8_t *protos = (uint8_t *)duckdb_vector_get_data(vectors[BEACON_COL_IP_PROTO]);
+    uint64_t *events = (uint64_t *)duckdb_vector_get_data(vectors[BEACON_COL_EVENTS]);
+    uint64_t *firsts = (uint64_t *)duckdb_vector_get_data(vectors[BEACON_COL_FIRST_TIMESTAMP]);
+    uint64_t *lasts = (uint64_t *)duckdb_vector_get_data(vectors[BEACON_COL_LAST_TIMESTAMP]);
+    double *means = (double *)duckdb_vector_get_data(vectors[BEACON_COL_MEAN_INTERVAL]);
+    double *stddevs = (double *)duckdb_vector_get_data(vectors[BEACON_COL_STDDEV_INTERVAL]);
+    double *modes = (double *)duckdb_vector_get_data(vectors[BEACON_COL_MODE_INTERVAL]);
+    double *fractions = (double *)duckdb_vector_get_data(vectors[BEACON_COL_MODE_FRACTION]);
+    double *scores = (double *)duckdb_vector_get_data(vectors[BEACON_COL_SCORE]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    const void *key_data;
+    void *value;
+    while (row_count < max_rows && HashMapNext(&state->pairs, &state->position, &key_data, &value)) {
+        const beacon_key_t *key = (const beacon_key_t *)key_data;
+        const beacon_pair_t *pair = (const beacon_pair_t *)value;
+        if (pair->events < bind->min_events) {
+            continue;
+        }
+        idx_t row = row_count++;
+        char text[46];
+        PacketFormatIp(key->ip_version, key->client, text, sizeof(text));
+        duckdb_vector_assign_string_element(vectors[BEACON_COL_SRC_IP], row, text);
+        PacketFormatIp(key->ip_version, key->server, text, sizeof(text));
+        duckdb_vector_assign_string_element(vectors[BEACON_COL_DST_IP], row, text);
+        ports[row] = key->server_port;
+        protos[row] = key->ip_proto;
+        events[row] = pair->events;
+        firsts[row] = pair->first_ns;
+        lasts[row] = pair->last_ns;
+        means[row] = pair->mean;
+        double stddev = SquareRoot(pair->m2 / (double)(pair->events - 1));
+        stddevs[row] = stddev;
+        double fraction;
+        modes[row] = BucketSeconds(HistogramMode(pair, &fraction));
+        fractions[row] = fraction;
+
+        // Regularity is 1 - the coefficient of variation of the intervals;
+        // the score averages it with the share of intervals near the mode
+        double variation = pair->mean > 0 ? stddev / pair->mean : 1;
+        double regularity = variation < 1 ? 1 - variation : 0;
+        scores[row] = (regularity + fraction) / 2;
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterBeaconsFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_beacons");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_logical_type bigint_type = duckdb_create_logical_type(DUCKDB_TYPE_BIGINT);
+    duckdb_table_function_add_parameter(function, bigint_type);
+    duckdb_destroy_logical_type(&bigint_type);
+
+    duckdb_table_function_set_bind(function, BeaconBind);
+    duckdb_table_function_set_init(function, BeaconInit);
+    duckdb_table_function_set_function(function, BeaconFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
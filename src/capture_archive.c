@@ -0,0 +1,740 @@
+#include "duckdb_extension.h"
+#include "capture_archive.h"
+#include "inflate.h"
+#include "zstd_codec.h"
+#include <ctype.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_TYPE_OFFSET 156
+#define TAR_SIZE_OFFSET 124
+#define TAR_CHECKSUM_OFFSET 148
+
+// Longest GNU long name or pax header record read
+#define TAR_MAX_NAME_RECORD (1 << 16)
+
+#define ZIP_LOCAL_HEADER_MAGIC 0x04034b50u
+#define ZIP_CENTRAL_HEADER_MAGIC 0x02014b50u
+#define ZIP_END_MAGIC 0x06054b50u
+#define ZIP64_END_MAGIC 0x06064b50u
+#define ZIP64_LOCATOR_MAGIC 0x07064b50u
+#define ZIP_LOCAL_HEADER_LEN 30
+#define ZIP_CENTRAL_HEADER_LEN 46
+#define ZIP_END_LEN 22
+#define ZIP64_END_LEN 56
+#define ZIP64_LOCATOR_LEN 20
+#define ZIP_MAX_COMMENT 65535
+#define ZIP64_EXTRA_ID 0x0001
+#define ZIP_FLAG_ENCRYPTED 0x0001
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+// Largest zip central directory read
+#define ZIP_MAX_DIRECTORY (256u << 20)
+
+static const char *const archive_suffixes[] = {".tar", ".tgz", ".tar.gz", ".tzst", ".tar.zst", ".zip"};
+
+typedef enum {
+    ARCHIVE_TAR,             // uncompressed tar, listed up front
+    ARCHIVE_TAR_STREAM,      // compressed tar, decoded front to back
+    ARCHIVE_ZIP
+} archive_kind_t;
+
+typedef struct {
+    uint64_t offset;         // tar: data offset; zip: offset of the local header
+    uint64_t size;           // stored size
+    uint64_t uncompressed_size;
+    uint16_t method;         // ZIP_METHOD_*
+} archive_member_t;
+
+struct capture_archive {
+    char *path;
+    char *pattern;
+    archive_kind_t kind;
+    capture_file_t *file;    // the archive itself
+    capture_file_t *stream;  // decoded tar of an ARCHIVE_TAR_STREAM
+    capture_cache_t cache;   // for the archive and every member opened from it
+    archive_member_t *members;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t next_member;    // next listed member CaptureArchiveNext returns
+    uint64_t next_header;    // offset of the next tar header in the stream
+};
+
+static uint16_t Get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t Get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t Get64(const uint8_t *p) {
+    return (uint64_t)Get32(p) | (uint64_t)Get32(p + 4) << 32;
+}
+
+static char *CopyString(const char *text, size_t len) {
+    char *copy = (char *)duckdb_malloc(len + 1);
+    if (copy) {
+        memcpy(copy, text, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+// ---------------------------------------------------------------------------
+// Paths and patterns
+// ---------------------------------------------------------------------------
+
+static int HasSuffix(const char *path, size_t len, const char *suffix) {
+    size_t suffix_len = strlen(suffix);
+    if (len <= suffix_len) {
+        return 0;
+    }
+    for (size_t i = 0; i < suffix_len; i++) {
+        if (tolower((unsigned char)path[len - suffix_len + i]) != suffix[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int CaptureArchiveSplitPath(const char *path, char **archive_path, char **pattern) {
+    for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/')) {
+        size_t len = (size_t)(slash - path);
+        int is_archive = 0;
+        for (size_t i = 0; i < sizeof(archive_suffixes) / sizeof(archive_suffixes[0]); i++) {
+            is_archive = is_archive || HasSuffix(path, len, archive_suffixes[i]);
+        }
+        if (!is_archive || !slash[1]) {
+            continue;
+        }
+        *archive_path = CopyString(path, len);
+        *pattern = CopyString(slash + 1, strlen(slash + 1));
+        if (!*archive_path || !*pattern) {
+            duckdb_free(*archive_path);
+            duckdb_free(*pattern);
+            return -1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static const char *MemberName(const char *name) {
+    for (;;) {
+        if (name[0] == '.' && name[1] == '/') {
+            name += 2;
+        } else if (name[0] == '/') {
+            name++;
+        } else {
+            return name;
+        }
+    }
+}
+
+// '*' stops at a '/', '**' does not, and "**/" also matches no directory
+static int MatchPattern(const char *pattern, const char *name) {
+    for (; *pattern; pattern++, name++) {
+        if (*pattern == '*') {
+            int any_depth = pattern[1] == '*';
+            pattern += any_depth ? 2 : 1;
+            if (any_depth && *pattern == '/' && MatchPattern(pattern + 1, name)) {
+                return 1;
+            }
+            for (;; name++) {
+                if (MatchPattern(pattern, name)) {
+                    return 1;
+                }
+                if (!*name || (!any_depth && *name == '/')) {
+                    return 0;
+                }
+            }
+        }
+        if (!*name || (*pattern == '?' ? *name == '/' : *pattern != *name)) {
+            return 0;
+        }
+    }
+    return !*name;
+}
+
+static int MemberMatches(const capture_archive_t *archive, const char *name) {
+    return MatchPattern(MemberName(archive->pattern), MemberName(name));
+}
+
+static int AddMember(capture_archive_t *archive, const archive_member_t *member) {
+    if (archive->count == archive->capacity) {
+        if (archive->capacity >= ARCHIVE_MAX_MEMBERS) {
+            return 0;
+        }
+        uint32_t capacity = archive->capacity ? archive->capacity * 2 : 16;
+        archive_member_t *grown = (archive_member_t *)duckdb_malloc(capacity * sizeof(archive_member_t));
+        if (!grown) {
+            return 0;
+        }
+        if (archive->members) {
+            memcpy(grown, archive->members, archive->count * sizeof(archive_member_t));
+            duckdb_free(archive->members);
+        }
+        archive->members = grown;
+        archive->capacity = capacity;
+    }
+    archive->members[archive->count++] = *member;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Decoded members and streams
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    DECODE_GZIP,
+    DECODE_ZSTD,
+    DECODE_DEFLATE
+} decode_kind_t;
+
+typedef struct {
+    capture_file_t base;
+    capture_file_t *inner;
+    inflate_stream_t *inflate;
+    zstd_stream_t *zstd;
+    int owns_inner;
+} decoded_file_t;
+
+static size_t DecodedRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    decoded_file_t *decoded = (decoded_file_t *)file;
+    return decoded->inflate ? InflateRead(decoded->inflate, buffer, len) : ZstdRead(decoded->zstd, buffer, len);
+}
+
+static void DecodedClose(capture_file_t *file) {
+    decoded_file_t *decoded = (decoded_file_t *)file;
+    if (decoded->inflate) {
+        InflateClose(decoded->inflate);
+    }
+    ZstdClose(decoded->zstd);
+    if (decoded->owns_inner) {
+        CaptureFileClose(decoded->inner);
+    }
+}
+
+static const capture_file_ops_t decoded_ops = {DecodedRead, NULL, DecodedClose};
+
+// Decode inner, whose first prefix_len bytes were already read into prefix
+// (for gzip and zstd). On failure inner is closed when owned.
+static capture_file_t *OpenDecoded(capture_file_t *inner, int owns_inner, decode_kind_t kind, const uint8_t *prefix,
+                                   size_t prefix_len, int64_t size) {
+    decoded_file_t *decoded = (decoded_file_t *)duckdb_malloc(sizeof(decoded_file_t));
+    if (decoded) {
+        memset(decoded, 0, sizeof(decoded_file_t));
+        decoded->base.ops = &decoded_ops;
+        decoded->base.size = size;
+        decoded->inner = inner;
+        decoded->owns_inner = owns_inner;
+        if (kind == DECODE_GZIP) {
+            decoded->inflate = InflateOpen(inner, prefix, prefix_len);
+        } else if (kind == DECODE_ZSTD) {
+            decoded->zstd = ZstdOpen(inner, prefix, prefix_len);
+        } else {
+            decoded->inflate = InflateOpenRaw(inner);
+        }
+        if (decoded->inflate || decoded->zstd) {
+            return &decoded->base;
+        }
+        duckdb_free(decoded);
+    }
+    if (owns_inner) {
+        CaptureFileClose(inner);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// tar
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char *name;
+    uint64_t size;
+    uint64_t data_offset;
+} tar_entry_t;
+
+// Octal number, or base-256 when the top bit of the first byte is set
+static int TarNumber(const uint8_t *field, size_t len, uint64_t *value) {
+    uint64_t result = 0;
+    size_t i = 0;
+    if (field[0] & 0x80) {
+        if (field[0] & 0x40) {
+            return 0;
+        }
+        result = field[0] & 0x3f;
+        for (i = 1; i < len; i++) {
+            if (result >> 56) {
+                return 0;
+            }
+            result = result << 8 | field[i];
+        }
+        *value = result;
+        return 1;
+    }
+    while (i < len && field[i] == ' ') {
+        i++;
+    }
+    for (; i < len && field[i] >= '0' && field[i] <= '7'; i++) {
+        if (result >> 61) {
+            return 0;
+        }
+        result = result << 3 | (uint64_t)(field[i] - '0');
+    }
+    for (; i < len; i++) {
+        if (field[i] != ' ' && field[i] != '\0') {
+            return 0;
+        }
+    }
+    *value = result;
+    return 1;
+}
+
+// The checksum counts the checksum field as spaces; old tars summed signed
+// bytes
+static int TarChecksumValid(const uint8_t *header) {
+    uint64_t expected;
+    if (!TarNumber(header + TAR_CHECKSUM_OFFSET, 8, &expected)) {
+        return 0;
+    }
+    uint64_t unsigned_sum = 0;
+    int64_t signed_sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        uint8_t byte = i >= TAR_CHECKSUM_OFFSET && i < TAR_CHECKSUM_OFFSET + 8 ? ' ' : header[i];
+        unsigned_sum += byte;
+        signed_sum += (int8_t)byte;
+    }
+    return expected == unsigned_sum || (int64_t)expected == signed_sum;
+}
+
+// Length of a string field, which is only NUL-terminated when shorter than
+// the field
+static size_t FieldLength(const uint8_t *field, size_t len) {
+    const uint8_t *end = (const uint8_t *)memchr(field, '\0', len);
+    return end ? (size_t)(end - field) : len;
+}
+
+// Name of a ustar or old-style header: the prefix, if any, then the name
+static char *TarHeaderName(const uint8_t *header) {
+    size_t name_len = FieldLength(header, 100);
+    size_t prefix_len = memcmp(header + 257, "ustar", 5) == 0 ? FieldLength(header + 345, 155) : 0;
+    char *name = (char *)duckdb_malloc(prefix_len + 1 + name_len + 1);
+    if (name) {
+        memcpy(name, header + 345, prefix_len);
+        size_t len = prefix_len;
+        if (prefix_len) {
+            name[len++] = '/';
+        }
+        memcpy(name + len, header, name_len);
+        name[len + name_len] = '\0';
+    }
+    return name;
+}
+
+// Apply the path and size records of a pax extended header
+static void TarPaxRecords(const char *records, size_t len, char **name, uint64_t *size, int *has_size) {
+    size_t pos = 0;
+    while (pos < len) {
+        size_t record_len = 0;
+        size_t i = pos;
+        while (i < len && records[i] >= '0' && records[i] <= '9' && record_len < len) {
+            record_len = record_len * 10 + (size_t)(records[i++] - '0');
+        }
+        if (i >= len || records[i] != ' ' || record_len <= i - pos || record_len > len - pos ||
+            records[pos + record_len - 1] != '\n') {
+            return;
+        }
+        const char *key = records + i + 1;
+        const char *end = records + pos + record_len - 1;
+        const char *equals = (const char *)memchr(key, '=', (size_t)(end - key));
+        if (equals) {
+            const char *value = equals + 1;
+            size_t key_len = (size_t)(equals - key);
+            if (key_len == 4 && memcmp(key, "path", 4) == 0) {
+                char *path = CopyString(value, (size_t)(end - value));
+                if (path) {
+                    duckdb_free(*name);
+                    *name = path;
+                }
+            } else if (key_len == 4 && memcmp(key, "size", 4) == 0) {
+                uint64_t value_size = 0;
+                const char *digit = value;
+                while (digit < end && *digit >= '0' && *digit <= '9' && !(value_size >> 59)) {
+                    value_size = value_size * 10 + (uint64_t)(*digit++ - '0');
+                }
+                if (digit == end && digit > value) {
+                    *size = value_size;
+                    *has_size = 1;
+                }
+            }
+        }
+        pos += record_len;
+    }
+}
+
+static uint64_t TarPadded(uint64_t size) {
+    return (size + TAR_BLOCK_SIZE - 1) & ~(uint64_t)(TAR_BLOCK_SIZE - 1);
+}
+
+// Read headers from the stream's position up to the next regular file,
+// applying GNU long names and pax headers. Returns 0 at the end of the
+// archive, on corrupt data or when out of memory.
+static int TarNextEntry(capture_file_t *stream, tar_entry_t *entry) {
+    char *long_name = NULL;
+    uint64_t pax_size = 0;
+    int has_pax_size = 0;
+    for (;;) {
+        uint8_t header[TAR_BLOCK_SIZE];
+        uint64_t size;
+        if (CaptureFileRead(stream, header, sizeof(header)) != sizeof(header) || !TarChecksumValid(header) ||
+            !TarNumber(header + TAR_SIZE_OFFSET, 12, &size)) {
+            break;
+        }
+        char type = (char)header[TAR_TYPE_OFFSET];
+        if (type == 'L' || type == 'x') {
+            uint64_t skip = TarPadded(size);
+            if (size <= TAR_MAX_NAME_RECORD) {
+                char *record = (char *)duckdb_malloc((size_t)size + 1);
+                if (!record || CaptureFileRead(stream, record, (size_t)size) != size) {
+                    duckdb_free(record);
+                    break;
+                }
+                record[size] = '\0';
+                skip -= size;
+                if (type == 'L') {
+                    duckdb_free(long_name);
+                    long_name = record;
+                } else {
+                    TarPaxRecords(record, (size_t)size, &long_name, &pax_size, &has_pax_size);
+                    duckdb_free(record);
+                }
+            }
+            if (!CaptureFileSkip(stream, skip)) {
+                break;
+            }
+            continue;
+        }
+        if (has_pax_size) {
+            size = pax_size;
+        }
+        if (type == '0' || type == '\0' || type == '7') {
+            entry->name = long_name ? long_name : TarHeaderName(header);
+            entry->size = size;
+            entry->data_offset = stream->position;
+            return entry->name != NULL;
+        }
+        // Directories, links, devices and global pax headers carry no member
+        duckdb_free(long_name);
+        long_name = NULL;
+        has_pax_size = 0;
+        if (!CaptureFileSkip(stream, type == '1' || type == '2' || type == '5' ? 0 : TarPadded(size))) {
+            break;
+        }
+    }
+    duckdb_free(long_name);
+    return 0;
+}
+
+static const char *ListTar(capture_archive_t *archive) {
+    tar_entry_t entry;
+    while (TarNextEntry(archive->file, &entry)) {
+        int matches = MemberMatches(archive, entry.name);
+        duckdb_free(entry.name);
+        if (matches) {
+            archive_member_t member = {entry.data_offset, entry.size, entry.size, ZIP_METHOD_STORED};
+            if (!AddMember(archive, &member)) {
+                return "Too many archive members";
+            }
+        }
+        if (!CaptureFileSeek(archive->file, entry.data_offset + TarPadded(entry.size))) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static capture_file_t *NextStreamMember(capture_archive_t *archive) {
+    capture_file_t *stream = archive->stream;
+    if (stream->position > archive->next_header ||
+        !CaptureFileSkip(stream, archive->next_header - stream->position)) {
+        return NULL;
+    }
+    tar_entry_t entry;
+    while (TarNextEntry(stream, &entry)) {
+        int matches = MemberMatches(archive, entry.name);
+        duckdb_free(entry.name);
+        archive->next_header = entry.data_offset + TarPadded(entry.size);
+        if (matches) {
+            return CaptureFileSlice(stream, entry.data_offset, entry.size, 0);
+        }
+        if (!CaptureFileSkip(stream, archive->next_header - stream->position)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// zip
+// ---------------------------------------------------------------------------
+
+// Locate the central directory through the end record, or the zip64 one
+static int ZipDirectory(capture_file_t *file, uint64_t *entries, uint64_t *offset, uint64_t *size) {
+    uint64_t file_size = (uint64_t)file->size;
+    size_t tail_len = file_size < ZIP_END_LEN + ZIP_MAX_COMMENT ? (size_t)file_size : ZIP_END_LEN + ZIP_MAX_COMMENT;
+    if (tail_len < ZIP_END_LEN) {
+        return 0;
+    }
+    uint8_t *tail = (uint8_t *)duckdb_malloc(tail_len);
+    if (!tail || !CaptureFileReadAt(file, file_size - tail_len, tail, tail_len)) {
+        duckdb_free(tail);
+        return 0;
+    }
+    // The last end record whose comment fits the file
+    size_t pos = tail_len - ZIP_END_LEN + 1;
+    int found = 0;
+    while (pos-- > 0) {
+        if (Get32(tail + pos) == ZIP_END_MAGIC && pos + ZIP_END_LEN + Get16(tail + pos + 20) <= tail_len) {
+            found = 1;
+            break;
+        }
+    }
+    if (found) {
+        *entries = Get16(tail + pos + 10);
+        *size = Get32(tail + pos + 12);
+        *offset = Get32(tail + pos + 16);
+    }
+    duckdb_free(tail);
+    if (!found) {
+        return 0;
+    }
+    if (*entries != 0xFFFF && *size != 0xFFFFFFFF && *offset != 0xFFFFFFFF) {
+        return 1;
+    }
+    uint64_t end_offset = file_size - tail_len + pos;
+    uint8_t locator[ZIP64_LOCATOR_LEN];
+    uint8_t end[ZIP64_END_LEN];
+    if (end_offset < ZIP64_LOCATOR_LEN ||
+        !CaptureFileReadAt(file, end_offset - ZIP64_LOCATOR_LEN, locator, sizeof(locator)) ||
+        Get32(locator) != ZIP64_LOCATOR_MAGIC || !CaptureFileReadAt(file, Get64(locator + 8), end, sizeof(end)) ||
+        Get32(end) != ZIP64_END_MAGIC) {
+        return 0;
+    }
+    *entries = Get64(end + 32);
+    *size = Get64(end + 40);
+    *offset = Get64(end + 48);
+    return 1;
+}
+
+// Sizes and offset too large for the central header are in its zip64 extra
+// field, in this order, when their field is all ones
+static void ZipExtraFields(const uint8_t *extra, size_t len, archive_member_t *member) {
+    size_t pos = 0;
+    while (pos + 4 <= len) {
+        uint16_t id = Get16(extra + pos);
+        size_t field_len = Get16(extra + pos + 2);
+        pos += 4;
+        if (field_len > len - pos) {
+            return;
+        }
+        if (id == ZIP64_EXTRA_ID) {
+            const uint8_t *value = extra + pos;
+            const uint8_t *end = value + field_len;
+            uint64_t *fields[3] = {&member->uncompressed_size, &member->size, &member->offset};
+            for (int i = 0; i < 3; i++) {
+                if (*fields[i] == 0xFFFFFFFF && value + 8 <= end) {
+                    *fields[i] = Get64(value);
+                    value += 8;
+                }
+            }
+            return;
+        }
+        pos += field_len;
+    }
+}
+
+static const char *ListZip(capture_archive_t *archive) {
+    capture_file_t *file = archive->file;
+    uint64_t entries;
+    uint64_t offset;
+    uint64_t size;
+    if (file->size < 0 || !ZipDirectory(file, &entries, &offset, &size) || size > ZIP_MAX_DIRECTORY ||
+        offset > (uint64_t)file->size || size > (uint64_t)file->size - offset) {
+        return "Invalid zip archive";
+    }
+    uint8_t *directory = (uint8_t *)duckdb_malloc(size ? (size_t)size : 1);
+    if (!directory) {
+        return "Failed to allocate memory for zip directory";
+    }
+    const char *error = NULL;
+    if (!CaptureFileReadAt(file, offset, directory, (size_t)size)) {
+        error = "Invalid zip archive";
+    }
+    size_t pos = 0;
+    for (uint64_t i = 0; i < entries && !error; i++) {
+        const uint8_t *header = directory + pos;
+        if (size - pos < ZIP_CENTRAL_HEADER_LEN || Get32(header) != ZIP_CENTRAL_HEADER_MAGIC) {
+            error = "Invalid zip archive";
+            break;
+        }
+        size_t name_len = Get16(header + 28);
+        size_t extra_len = Get16(header + 30);
+        size_t entry_len = ZIP_CENTRAL_HEADER_LEN + name_len + extra_len + Get16(header + 32);
+        if (size - pos < entry_len) {
+            error = "Invalid zip archive";
+            break;
+        }
+        pos += entry_len;
+        const char *name_bytes = (const char *)header + ZIP_CENTRAL_HEADER_LEN;
+        if (!name_len || name_bytes[name_len - 1] == '/') {
+            continue;
+        }
+        char *name = CopyString(name_bytes, name_len);
+        if (!name) {
+            error = "Failed to allocate memory for zip directory";
+            break;
+        }
+        int matches = MemberMatches(archive, name);
+        duckdb_free(name);
+        if (!matches) {
+            continue;
+        }
+        archive_member_t member = {Get32(header + 42), Get32(header + 20), Get32(header + 24), Get16(header + 10)};
+        ZipExtraFields(header + ZIP_CENTRAL_HEADER_LEN + name_len, extra_len, &member);
+        if ((Get16(header + 8) & ZIP_FLAG_ENCRYPTED) ||
+            (member.method != ZIP_METHOD_STORED && member.method != ZIP_METHOD_DEFLATED)) {
+            error = "Unsupported zip member: only unencrypted stored or deflated members can be read";
+        } else if (!AddMember(archive, &member)) {
+            error = "Too many archive members";
+        }
+    }
+    duckdb_free(directory);
+    return error;
+}
+
+// ---------------------------------------------------------------------------
+// Members and the archive
+// ---------------------------------------------------------------------------
+
+// Open a listed member over file, a handle on the archive
+static capture_file_t *OpenListed(const capture_archive_t *archive, capture_file_t *file, int owns_file,
+                                  uint32_t index) {
+    const archive_member_t *member = &archive->members[index];
+    uint64_t data_offset = member->offset;
+    if (archive->kind == ARCHIVE_ZIP) {
+        // The local header repeats the name and has an extra field of its own
+        uint8_t header[ZIP_LOCAL_HEADER_LEN];
+        if (!CaptureFileReadAt(file, member->offset, header, sizeof(header)) ||
+            Get32(header) != ZIP_LOCAL_HEADER_MAGIC) {
+            if (owns_file) {
+                CaptureFileClose(file);
+            }
+            return NULL;
+        }
+        data_offset += ZIP_LOCAL_HEADER_LEN + (uint64_t)Get16(header + 26) + Get16(header + 28);
+    }
+    capture_file_t *slice = CaptureFileSlice(file, data_offset, member->size, owns_file);
+    if (!slice) {
+        if (owns_file) {
+            CaptureFileClose(file);
+        }
+        return NULL;
+    }
+    if (member->method == ZIP_METHOD_DEFLATED) {
+        return OpenDecoded(slice, 1, DECODE_DEFLATE, NULL, 0, (int64_t)member->uncompressed_size);
+    }
+    return slice;
+}
+
+const char *CaptureArchiveOpen(const char *archive_path, const char *pattern, capture_cache_t cache,
+                               capture_archive_t **out) {
+    *out = NULL;
+    capture_archive_t *archive = (capture_archive_t *)duckdb_malloc(sizeof(capture_archive_t));
+    if (!archive) {
+        return "Failed to allocate memory for archive";
+    }
+    memset(archive, 0, sizeof(capture_archive_t));
+    archive->cache = cache;
+    archive->path = CopyString(archive_path, strlen(archive_path));
+    archive->pattern = CopyString(pattern, strlen(pattern));
+    if (!archive->path || !archive->pattern) {
+        CaptureArchiveClose(archive);
+        return "Failed to allocate memory for archive";
+    }
+    archive->file = CaptureFileOpen(archive_path, cache);
+    if (!archive->file) {
+        CaptureArchiveClose(archive);
+        return "Failed to open archive file";
+    }
+
+    const char *error = NULL;
+    uint8_t magic[4];
+    if (HasSuffix(archive_path, strlen(archive_path), ".zip")) {
+        archive->kind = ARCHIVE_ZIP;
+        error = ListZip(archive);
+    } else if (CaptureFileRead(archive->file, magic, sizeof(magic)) != sizeof(magic)) {
+        error = "Failed to read archive file";
+    } else if ((magic[0] == GZIP_MAGIC_0 && magic[1] == GZIP_MAGIC_1) || Get32(magic) == ZSTD_MAGIC) {
+        // Whatever the suffix says, a compressed tar is decoded front to back
+        archive->kind = ARCHIVE_TAR_STREAM;
+        decode_kind_t kind = magic[0] == GZIP_MAGIC_0 ? DECODE_GZIP : DECODE_ZSTD;
+        archive->stream = OpenDecoded(archive->file, 0, kind, magic, sizeof(magic), -1);
+        if (!archive->stream) {
+            error = "Failed to allocate memory for archive";
+        }
+    } else if (!CaptureFileSeek(archive->file, 0)) {
+        error = "Failed to read archive file";
+    } else {
+        archive->kind = ARCHIVE_TAR;
+        error = ListTar(archive);
+    }
+    if (!error && archive->kind != ARCHIVE_TAR_STREAM && !archive->count) {
+        error = "No archive member matches the path";
+    }
+    if (error) {
+        CaptureArchiveClose(archive);
+        return error;
+    }
+    *out = archive;
+    return NULL;
+}
+
+uint32_t CaptureArchiveMemberCount(const capture_archive_t *archive) {
+    return archive->count;
+}
+
+capture_file_t *CaptureArchiveNext(capture_archive_t *archive) {
+    if (archive->kind == ARCHIVE_TAR_STREAM) {
+        return NextStreamMember(archive);
+    }
+    if (archive->next_member >= archive->count) {
+        return NULL;
+    }
+    return OpenListed(archive, archive->file, 0, archive->next_member++);
+}
+
+capture_file_t *CaptureArchiveOpenMember(const capture_archive_t *archive, uint32_t member) {
+    if (member >= archive->count) {
+        return NULL;
+    }
+    capture_file_t *file = CaptureFileOpen(archive->path, archive->cache);
+    return file ? OpenListed(archive, file, 1, member) : NULL;
+}
+
+void CaptureArchiveClose(capture_archive_t *archive) {
+    if (!archive) {
+        return;
+    }
+    CaptureFileClose(archive->stream);
+    CaptureFileClose(archive->file);
+    duckdb_free(archive->members);
+    duckdb_free(archive->path);
+    duckdb_free(archive->pattern);
+    duckdb_free(archive);
+}
@@ -0,0 +1,394 @@
+#ifndef _WIN32
+// fseeko/ftello and pread with a 64-bit off_t on 32-bit platforms, and
+// O_DIRECT
+#define _FILE_OFFSET_BITS 64
+#define _GNU_SOURCE
+#endif
+#include "duckdb_extension.h"
+#include "capture_file.h"
+#include "http_file.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DUCKDB_EXTENSION_EXTERN
+
+// Bytes discarded at a time when skipping over a source that cannot seek
+#define SKIP_CHUNK 16384
+
+// 64-bit file positioning, also for files over 2GB on platforms with a 32-bit
+// long
+static int FileSeek64(FILE *file, int64_t offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin);
+#else
+    return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+static int64_t FileTell64(FILE *file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (int64_t)ftello(file);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Local files read around the page cache
+// ---------------------------------------------------------------------------
+
+int CaptureCacheParse(const char *name, capture_cache_t *cache) {
+    if (strcmp(name, "normal") == 0) {
+        *cache = CAPTURE_CACHE_NORMAL;
+    } else if (strcmp(name, "dontneed") == 0) {
+        *cache = CAPTURE_CACHE_DONTNEED;
+    } else if (strcmp(name, "direct") == 0) {
+        *cache = CAPTURE_CACHE_DIRECT;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+#ifndef _WIN32
+
+// Reads go through one aligned buffer, refilled with a pread at an aligned
+// offset. With O_DIRECT they never enter the page cache; otherwise the pages
+// of every range read are dropped (POSIX_FADV_DONTNEED) as soon as they are in
+// the buffer, while the kernel's sequential read-ahead still brings in the
+// pages after them. Systems without posix_fadvise but with F_NOCACHE
+// (macOS) are asked not to cache the file at all.
+typedef struct {
+    capture_file_t base;
+    int fd;
+    int direct;              // opened with O_DIRECT and not refused since
+    uint8_t *allocation;
+    uint8_t *buffer;         // CAPTURE_DIRECT_ALIGN-aligned within allocation
+    uint64_t buffer_offset;  // file offset of buffer[0]
+    size_t buffer_len;
+} uncached_file_t;
+
+static long ReadAligned(uncached_file_t *file, uint64_t offset) {
+    long got;
+    do {
+        got = (long)pread(file->fd, file->buffer, CAPTURE_UNCACHED_BUFFER_SIZE, (off_t)offset);
+    } while (got < 0 && errno == EINTR);
+    return got;
+}
+
+// Load the aligned block holding offset. Returns 0 on a read error.
+static int FillBuffer(uncached_file_t *file, uint64_t offset) {
+    uint64_t start = offset - offset % CAPTURE_DIRECT_ALIGN;
+    long got = ReadAligned(file, start);
+#ifdef O_DIRECT
+    if (got < 0 && errno == EINVAL && file->direct) {
+        // Some filesystems accept O_DIRECT when opening but not when reading:
+        // drop pages instead
+        int flags = fcntl(file->fd, F_GETFL);
+        if (flags != -1 && fcntl(file->fd, F_SETFL, flags & ~O_DIRECT) == 0) {
+            file->direct = 0;
+            got = ReadAligned(file, start);
+        }
+    }
+#endif
+    if (got < 0) {
+        return 0;
+    }
+#ifdef POSIX_FADV_DONTNEED
+    if (!file->direct && got > 0) {
+        posix_fadvise(file->fd, (off_t)start, (off_t)got, POSIX_FADV_DONTNEED);
+    }
+#endif
+    file->buffer_offset = start;
+    file->buffer_len = (size_t)got;
+    return 1;
+}
+
+static size_t UncachedRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    uncached_file_t *uncached = (uncached_file_t *)file;
+    size_t done = 0;
+    while (done < len) {
+        uint64_t position = file->position + done;
+        if (position < uncached->buffer_offset || position >= uncached->buffer_offset + uncached->buffer_len) {
+            if (!FillBuffer(uncached, position) || position >= uncached->buffer_offset + uncached->buffer_len) {
+                break;
+            }
+        }
+        size_t at = (size_t)(position - uncached->buffer_offset);
+        size_t chunk = uncached->buffer_len - at < len - done ? uncached->buffer_len - at : len - done;
+        memcpy(buffer + done, uncached->buffer + at, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+// The position is applied by the next read
+static int UncachedSeek(capture_file_t *file, uint64_t offset) {
+    (void)file;
+    (void)offset;
+    return 1;
+}
+
+static void UncachedClose(capture_file_t *file) {
+    uncached_file_t *uncached = (uncached_file_t *)file;
+    close(uncached->fd);
+    duckdb_free(uncached->allocation);
+}
+
+static const capture_file_ops_t uncached_ops = {UncachedRead, UncachedSeek, UncachedClose};
+
+// Open a regular file for uncached reads. Returns NULL when it cannot be
+// opened or is not a regular file.
+static capture_file_t *OpenUncached(const char *path, capture_cache_t cache) {
+    int flags = O_RDONLY;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    int fd = -1;
+    int direct = 0;
+#ifdef O_DIRECT
+    if (cache == CAPTURE_CACHE_DIRECT) {
+        fd = open(path, flags | O_DIRECT);
+        direct = fd >= 0;
+    }
+#else
+    (void)cache;
+#endif
+    if (fd < 0) {
+        fd = open(path, flags);
+    }
+    struct stat st;
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    uncached_file_t *file = (uncached_file_t *)duckdb_malloc(sizeof(uncached_file_t));
+    uint8_t *allocation = (uint8_t *)duckdb_malloc(CAPTURE_UNCACHED_BUFFER_SIZE + CAPTURE_DIRECT_ALIGN);
+    if (!file || !allocation) {
+        duckdb_free(file);
+        duckdb_free(allocation);
+        close(fd);
+        return NULL;
+    }
+    memset(file, 0, sizeof(uncached_file_t));
+    file->base.ops = &uncached_ops;
+    file->base.size = (int64_t)st.st_size;
+    file->fd = fd;
+    file->direct = direct;
+    file->allocation = allocation;
+    file->buffer = allocation + (CAPTURE_DIRECT_ALIGN - (uintptr_t)allocation % CAPTURE_DIRECT_ALIGN) % CAPTURE_DIRECT_ALIGN;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_NOCACHE)
+    fcntl(fd, F_NOCACHE, 1);
+#endif
+    return &file->base;
+}
+
+#endif // _WIN32
+
+// ---------------------------------------------------------------------------
+// Local files and stdin
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    capture_file_t base;
+    FILE *file;
+    int is_stdin;
+} stdio_file_t;
+
+static size_t StdioRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    return fread(buffer, 1, len, ((stdio_file_t *)file)->file);
+}
+
+static int StdioSeek(capture_file_t *file, uint64_t offset) {
+    return FileSeek64(((stdio_file_t *)file)->file, (int64_t)offset, SEEK_SET) == 0;
+}
+
+static void StdioClose(capture_file_t *file) {
+    stdio_file_t *stdio_file = (stdio_file_t *)file;
+    if (!stdio_file->is_stdin) {
+        fclose(stdio_file->file);
+    }
+}
+
+static const capture_file_ops_t stdio_ops = {StdioRead, StdioSeek, StdioClose};
+static const capture_file_ops_t stdin_ops = {StdioRead, NULL, StdioClose};
+
+capture_file_t *CaptureFileOpen(const char *path, capture_cache_t cache) {
+    if (HttpFileIsUrl(path)) {
+        return HttpFileOpen(path);
+    }
+#ifndef _WIN32
+    if (cache != CAPTURE_CACHE_NORMAL) {
+        capture_file_t *uncached = OpenUncached(path, cache);
+        if (uncached) {
+            return uncached;
+        }
+        // Pipes and devices have no pages to keep out of the cache
+    }
+#else
+    (void)cache;
+#endif
+    FILE *handle = NULL;
+#ifdef _WIN32
+    if (fopen_s(&handle, path, "rb") != 0) {
+        handle = NULL;
+    }
+#else
+    handle = fopen(path, "rb");
+#endif
+    if (!handle) {
+        return NULL;
+    }
+    stdio_file_t *file = (stdio_file_t *)duckdb_malloc(sizeof(stdio_file_t));
+    if (!file) {
+        fclose(handle);
+        return NULL;
+    }
+    memset(file, 0, sizeof(stdio_file_t));
+    file->base.ops = &stdio_ops;
+    file->file = handle;
+
+    // Pipes and character devices have no size, and cannot seek either
+    int64_t size = -1;
+    if (FileSeek64(handle, 0, SEEK_END) == 0) {
+        size = FileTell64(handle);
+    }
+    if (size < 0 || FileSeek64(handle, 0, SEEK_SET) != 0) {
+        file->base.ops = &stdin_ops;
+        size = -1;
+    }
+    file->base.size = size;
+    return &file->base;
+}
+
+capture_file_t *CaptureFileStdin(void) {
+    stdio_file_t *file = (stdio_file_t *)duckdb_malloc(sizeof(stdio_file_t));
+    if (!file) {
+        return NULL;
+    }
+    memset(file, 0, sizeof(stdio_file_t));
+    file->base.ops = &stdin_ops;
+    file->base.size = -1;
+    file->file = stdin;
+    file->is_stdin = 1;
+#ifdef _WIN32
+    // Set stdin to binary mode on Windows
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    return &file->base;
+}
+
+// ---------------------------------------------------------------------------
+// Slices
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    capture_file_t base;
+    capture_file_t *parent;
+    uint64_t offset;         // start of the slice in parent
+    int owns_parent;
+} slice_file_t;
+
+static size_t SliceRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    slice_file_t *slice = (slice_file_t *)file;
+    uint64_t left = (uint64_t)file->size - file->position;
+    if (len > left) {
+        len = (size_t)left;
+    }
+    uint64_t at = slice->offset + file->position;
+    if (slice->parent->position != at && !CaptureFileSeek(slice->parent, at)) {
+        return 0;
+    }
+    return CaptureFileRead(slice->parent, buffer, len);
+}
+
+// The position is applied to the parent on the next read
+static int SliceSeek(capture_file_t *file, uint64_t offset) {
+    (void)file;
+    (void)offset;
+    return 1;
+}
+
+static void SliceClose(capture_file_t *file) {
+    slice_file_t *slice = (slice_file_t *)file;
+    if (slice->owns_parent) {
+        CaptureFileClose(slice->parent);
+    }
+}
+
+static const capture_file_ops_t slice_ops = {SliceRead, SliceSeek, SliceClose};
+static const capture_file_ops_t stream_slice_ops = {SliceRead, NULL, SliceClose};
+
+capture_file_t *CaptureFileSlice(capture_file_t *parent, uint64_t offset, uint64_t len, int owns_parent) {
+    slice_file_t *slice = (slice_file_t *)duckdb_malloc(sizeof(slice_file_t));
+    if (!slice) {
+        return NULL;
+    }
+    memset(slice, 0, sizeof(slice_file_t));
+    slice->base.ops = parent->ops->seek ? &slice_ops : &stream_slice_ops;
+    slice->base.size = (int64_t)len;
+    slice->parent = parent;
+    slice->offset = offset;
+    slice->owns_parent = owns_parent;
+    return &slice->base;
+}
+
+// ---------------------------------------------------------------------------
+// Common interface
+// ---------------------------------------------------------------------------
+
+size_t CaptureFileRead(capture_file_t *file, void *buffer, size_t len) {
+    size_t read = len ? file->ops->read(file, (uint8_t *)buffer, len) : 0;
+    file->position += read;
+    return read;
+}
+
+int CaptureFileSeek(capture_file_t *file, uint64_t offset) {
+    if (!file->ops->seek || (file->size >= 0 && offset > (uint64_t)file->size) || !file->ops->seek(file, offset)) {
+        return 0;
+    }
+    file->position = offset;
+    return 1;
+}
+
+int CaptureFileSkip(capture_file_t *file, uint64_t len) {
+    if (file->ops->seek && file->size >= 0) {
+        uint64_t left = (uint64_t)file->size - file->position;
+        return CaptureFileSeek(file, file->position + (len < left ? len : left)) && len <= left;
+    }
+    uint8_t scratch[SKIP_CHUNK];
+    while (len) {
+        size_t chunk = len < sizeof(scratch) ? (size_t)len : sizeof(scratch);
+        if (CaptureFileRead(file, scratch, chunk) != chunk) {
+            return 0;
+        }
+        len -= chunk;
+    }
+    return 1;
+}
+
+int CaptureFileReadAt(capture_file_t *file, uint64_t offset, void *buffer, size_t len) {
+    return CaptureFileSeek(file, offset) && CaptureFileRead(file, buffer, len) == len;
+}
+
+void CaptureFileClose(capture_file_t *file) {
+    if (file) {
+        file->ops->close(file);
+        duckdb_free(file);
+    }
+}
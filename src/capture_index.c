@@ -0,0 +1,54 @@
+#include "duckdb_extension.h"
+#include "capture_index.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+capture_index_t *CaptureIndexCreate(void) {
+    capture_index_t *index = (capture_index_t *)duckdb_malloc(sizeof(capture_index_t));
+    if (index) {
+        memset(index, 0, sizeof(capture_index_t));
+    }
+    return index;
+}
+
+capture_checkpoint_t *CaptureIndexAddCheckpoint(capture_index_t *index) {
+    if (index->count == index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 16;
+        capture_checkpoint_t *checkpoints =
+            (capture_checkpoint_t *)duckdb_malloc(capacity * sizeof(capture_checkpoint_t));
+        if (!checkpoints) {
+            return NULL;
+        }
+        if (index->count) {
+            memcpy(checkpoints, index->checkpoints, index->count * sizeof(capture_checkpoint_t));
+        }
+        duckdb_free(index->checkpoints);
+        index->checkpoints = checkpoints;
+        index->capacity = capacity;
+    }
+    capture_checkpoint_t *checkpoint = &index->checkpoints[index->count++];
+    memset(checkpoint, 0, sizeof(capture_checkpoint_t));
+    checkpoint->min_timestamp_ns = UINT64_MAX;
+    return checkpoint;
+}
+
+int CaptureIndexRegionOverlaps(const capture_index_t *index, uint32_t region, uint64_t start_ns, uint64_t end_ns) {
+    const capture_checkpoint_t *checkpoint = &index->checkpoints[region];
+    return checkpoint->packets && checkpoint->max_timestamp_ns >= start_ns && checkpoint->min_timestamp_ns < end_ns;
+}
+
+uint64_t CaptureIndexRegionEnd(const capture_index_t *index, uint32_t region) {
+    return region + 1 < index->count ? index->checkpoints[region + 1].record_offset : UINT64_MAX;
+}
+
+void CaptureIndexFree(capture_index_t *index) {
+    if (!index) {
+        return;
+    }
+    for (uint32_t i = 0; i < index->count; i++) {
+        duckdb_free(index->checkpoints[i].window);
+    }
+    duckdb_free(index->checkpoints);
+    duckdb_free(index);
+}
@@ -0,0 +1,521 @@
+#include "duckdb_extension.h"
+#include "capture_loss.h"
+#include "flow.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+typedef struct {
+    uint64_t packets;       // TCP packets
+    uint64_t acks;          // acknowledgments covering new data
+    uint64_t gaps;          // acknowledgments covering data never seen
+    uint64_t acked_bytes;
+    uint64_t gap_bytes;
+} loss_counts_t;
+
+// Sequence space of one side of a connection
+typedef struct {
+    uint32_t max_end;       // end of the highest sequence number seen or acknowledged
+    uint32_t acked;         // highest acknowledgment by the peer
+    uint8_t has_seq;        // the fields above have a baseline
+    uint8_t fin;
+} loss_direction_t;
+
+typedef struct {
+    loss_direction_t directions[2];
+    loss_counts_t counts;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint32_t interface_id;  // interface of the first packet
+    uint8_t initiator;      // direction of the first packet
+} loss_flow_t;
+
+typedef struct {
+    uint64_t index;         // timestamp / bucket width
+    uint32_t interface_id;
+    uint32_t reserved;      // keeps the key free of padding
+} loss_bucket_key_t;
+
+// Totals of a time bucket or an interface
+typedef struct {
+    loss_counts_t counts;
+    uint64_t first_ns;
+    uint64_t last_ns;
+} loss_totals_t;
+
+enum {
+    LOSS_SCOPE_FLOW,
+    LOSS_SCOPE_INTERFACE,
+    LOSS_SCOPE_BUCKET
+};
+
+static const char *const loss_scope_names[] = {"flow", "interface", "bucket"};
+
+typedef struct {
+    flow_key_t key;
+    loss_counts_t counts;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t interface_id;
+    uint8_t scope;
+    uint8_t initiator;
+} loss_row_t;
+
+typedef struct {
+    char *filename;
+    uint64_t bucket_ns;
+} loss_bind_t;
+
+enum {
+    LOSS_PHASE_SCAN,
+    LOSS_PHASE_FLOWS,
+    LOSS_PHASE_BUCKETS,
+    LOSS_PHASE_INTERFACES,
+    LOSS_PHASE_DONE
+};
+
+typedef struct {
+    const loss_bind_t *bind;
+    pcap_source_t *source;
+    hash_map_t flows;              // flow_key_t -> loss_flow_t
+    hash_map_t buckets;            // loss_bucket_key_t -> loss_totals_t
+    hash_map_t interfaces;         // uint32_t -> loss_totals_t
+    // Packets come in time order, so a bucket is accumulated here and only
+    // folded into the maps when the next one starts
+    loss_bucket_key_t bucket_key;
+    loss_totals_t bucket;
+    int has_bucket;
+    int phase;
+    size_t position;               // next map entry to emit in the current phase
+    stream_buffer_t rows;          // loss_row_t
+    size_t row_next;
+} loss_state_t;
+
+enum {
+    LOSS_COL_SCOPE,
+    LOSS_COL_INTERFACE_ID,
+    LOSS_COL_START_TIMESTAMP,
+    LOSS_COL_END_TIMESTAMP,
+    LOSS_COL_SRC_IP,
+    LOSS_COL_SRC_PORT,
+    LOSS_COL_DST_IP,
+    LOSS_COL_DST_PORT,
+    LOSS_COL_TCP_PACKETS,
+    LOSS_COL_ACKS,
+    LOSS_COL_GAPS,
+    LOSS_COL_ACKED_BYTES,
+    LOSS_COL_GAP_BYTES,
+    LOSS_COL_LOSS_PERCENT,
+    LOSS_COL_COUNT
+};
+
+static void AddCounts(loss_counts_t *total, const loss_counts_t *counts) {
+    total->packets += counts->packets;
+    total->acks += counts->acks;
+    total->gaps += counts->gaps;
+    total->acked_bytes += counts->acked_bytes;
+    total->gap_bytes += counts->gap_bytes;
+}
+
+static void AddTotals(loss_totals_t *total, const loss_totals_t *part, int is_new) {
+    if (is_new || part->first_ns < total->first_ns) {
+        total->first_ns = part->first_ns;
+    }
+    if (is_new || part->last_ns > total->last_ns) {
+        total->last_ns = part->last_ns;
+    }
+    AddCounts(&total->counts, &part->counts);
+}
+
+static void QueueRow(loss_state_t *state, const loss_row_t *row) {
+    StreamBufferAppend(&state->rows, (const uint8_t *)row, sizeof(loss_row_t), SIZE_MAX);
+}
+
+// Flows that never acknowledged new data say nothing about loss and are
+// left out (scans, stray resets, the last ACK after a connection closed)
+static void QueueFlow(loss_state_t *state, const flow_key_t *key, const loss_flow_t *flow) {
+    if (!flow->counts.acked_bytes) {
+        return;
+    }
+    loss_row_t row;
+    memset(&row, 0, sizeof(row));
+    row.scope = LOSS_SCOPE_FLOW;
+    row.key = *key;
+    row.counts = flow->counts;
+    row.start_ns = flow->first_ns;
+    row.end_ns = flow->last_ns;
+    row.interface_id = flow->interface_id;
+    row.initiator = flow->initiator;
+    QueueRow(state, &row);
+}
+
+static void FlushBucket(loss_state_t *state) {
+    if (!state->has_bucket) {
+        return;
+    }
+    state->has_bucket = 0;
+    int is_new;
+    loss_totals_t *bucket = (loss_totals_t *)HashMapInsert(&state->buckets, &state->bucket_key, &is_new);
+    if (bucket) {
+        AddTotals(bucket, &state->bucket, is_new);
+    }
+    loss_totals_t *interface = (loss_totals_t *)HashMapInsert(&state->interfaces, &state->bucket_key.interface_id,
+                                                              &is_new);
+    if (interface) {
+        AddTotals(interface, &state->bucket, is_new);
+    }
+}
+
+// Follow one segment: extend the sender's sequence space, then check the
+// acknowledgment against what was seen of the peer. Bytes acknowledged
+// beyond the highest sequence number seen from the peer went past the
+// capture unseen.
+static void TrackSegment(loss_flow_t *flow, int direction, const packet_info_t *pkt, loss_counts_t *delta) {
+    loss_direction_t *sender = &flow->directions[direction];
+    loss_direction_t *peer = &flow->directions[1 - direction];
+    uint8_t flags = pkt->tcp_flags;
+
+    if (flags & TCP_FLAG_SYN) {
+        // A new connection (or a reused port) starts the sequence spaces over
+        if (flags & TCP_FLAG_ACK) {
+            memset(sender, 0, sizeof(loss_direction_t));
+        } else {
+            memset(flow->directions, 0, sizeof(flow->directions));
+        }
+    }
+    uint32_t start = pkt->tcp_seq + ((flags & TCP_FLAG_SYN) ? 1 : 0);
+    uint32_t end = start + (pkt->payload ? pkt->payload_len : 0) + ((flags & TCP_FLAG_FIN) ? 1 : 0);
+    if (!sender->has_seq) {
+        // Mid-stream pickup: nothing before the first segment is counted
+        sender->acked = start;
+        sender->max_end = end;
+        sender->has_seq = 1;
+    } else if ((int32_t)(end - sender->max_end) > 0) {
+        sender->max_end = end;
+    }
+    if (flags & TCP_FLAG_FIN) {
+        sender->fin = 1;
+    }
+    if (!(flags & TCP_FLAG_ACK)) {
+        return;
+    }
+
+    uint32_t ack = pkt->tcp_ack;
+    if (!peer->has_seq) {
+        peer->acked = peer->max_end = ack;
+        peer->has_seq = 1;
+        return;
+    }
+    uint32_t advance = ack - peer->acked;
+    if ((int32_t)advance <= 0) {
+        return;
+    }
+    peer->acked = ack;
+    uint32_t gap = ack - peer->max_end;
+    if ((int32_t)gap > 0) {
+        peer->max_end = ack;
+    }
+    if (advance >= CAPTURE_LOSS_MAX_ADVANCE) {
+        return;
+    }
+    delta->acks++;
+    delta->acked_bytes += advance;
+    if ((int32_t)gap > 0) {
+        delta->gaps++;
+        delta->gap_bytes += gap;
+    }
+}
+
+static void ProcessPacket(loss_state_t *state, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    uint64_t timestamp_ns = packet->timestamp_ns;
+    loss_bucket_key_t bucket_key;
+    memset(&bucket_key, 0, sizeof(bucket_key));
+    bucket_key.index = timestamp_ns / state->bind->bucket_ns;
+    bucket_key.interface_id = packet->interface_id;
+    if (!state->has_bucket || memcmp(&bucket_key, &state->bucket_key, sizeof(bucket_key)) != 0) {
+        FlushBucket(state);
+        state->bucket_key = bucket_key;
+        memset(&state->bucket, 0, sizeof(state->bucket));
+        state->bucket.first_ns = state->bucket.last_ns = timestamp_ns;
+        state->has_bucket = 1;
+    }
+    loss_totals_t *bucket = &state->bucket;
+    if (timestamp_ns < bucket->first_ns) {
+        bucket->first_ns = timestamp_ns;
+    }
+    if (timestamp_ns > bucket->last_ns) {
+        bucket->last_ns = timestamp_ns;
+    }
+    bucket->counts.packets++;
+
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    loss_flow_t *flow;
+    if (pkt->tcp_flags & TCP_FLAG_RST) {
+        // A reset never opens a flow; it would only linger until the end
+        flow = (loss_flow_t *)HashMapFind(&state->flows, &key);
+        if (!flow) {
+            return;
+        }
+    } else {
+        int is_new;
+        flow = (loss_flow_t *)HashMapInsert(&state->flows, &key, &is_new);
+        if (!flow) {
+            return;
+        }
+        if (is_new) {
+            flow->first_ns = timestamp_ns;
+            flow->interface_id = packet->interface_id;
+            flow->initiator = (uint8_t)direction;
+        }
+    }
+    if (timestamp_ns > flow->last_ns) {
+        flow->last_ns = timestamp_ns;
+    }
+
+    loss_counts_t delta;
+    memset(&delta, 0, sizeof(delta));
+    delta.packets = 1;
+    TrackSegment(flow, direction, pkt, &delta);
+    AddCounts(&flow->counts, &delta);
+    delta.packets = 0;
+    AddCounts(&bucket->counts, &delta);
+
+    // Emit and forget a connection once it is reset, or at the ACK of the
+    // second FIN, which keeps the flow table at the open connections
+    uint8_t flags = pkt->tcp_flags;
+    int closed = (flags & TCP_FLAG_RST) ||
+                 (flow->directions[0].fin && flow->directions[1].fin && (flags & TCP_FLAG_ACK) &&
+                  !(flags & TCP_FLAG_FIN) && !(pkt->payload && pkt->payload_len));
+    if (closed) {
+        QueueFlow(state, &key, flow);
+        HashMapRemove(&state->flows, &key);
+    }
+}
+
+static void LossBindDataFree(void *data) {
+    loss_bind_t *bind = (loss_bind_t *)data;
+    if (bind) {
+        duckdb_free(bind->filename);
+        duckdb_free(bind);
+    }
+}
+
+static void LossBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    loss_bind_t *bind = (loss_bind_t *)duckdb_malloc(sizeof(loss_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, LossBindDataFree);
+
+    int64_t bucket_seconds = CAPTURE_LOSS_DEFAULT_BUCKET_SECONDS;
+    duckdb_value named = duckdb_bind_get_named_parameter(info, "bucket_seconds");
+    if (named) {
+        if (!duckdb_is_null_value(named)) {
+            bucket_seconds = duckdb_get_int64(named);
+        }
+        duckdb_destroy_value(&named);
+    }
+    if (bucket_seconds <= 0 || (uint64_t)bucket_seconds > UINT64_MAX / 1000000000ULL) {
+        duckdb_bind_set_error(info, "bucket_seconds must be positive");
+        return;
+    }
+    bind->bucket_ns = (uint64_t)bucket_seconds * 1000000000ULL;
+
+    PcapBindAddColumn(info, "scope", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "interface_id", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "start_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "end_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "tcp_packets", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "acks", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "gaps", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "acked_bytes", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "gap_bytes", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "loss_percent", DUCKDB_TYPE_DOUBLE);
+}
+
+static void LossInitDataFree(void *data) {
+    loss_state_t *state = (loss_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        HashMapDestroy(&state->flows);
+        HashMapDestroy(&state->buckets);
+        HashMapDestroy(&state->interfaces);
+        StreamBufferFree(&state->rows);
+        duckdb_free(state);
+    }
+}
+
+static void LossInit(duckdb_init_info info) {
+    loss_bind_t *bind = (loss_bind_t *)duckdb_init_get_bind_data(info);
+
+    loss_state_t *state = (loss_state_t *)duckdb_malloc(sizeof(loss_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(loss_state_t));
+    state->bind = bind;
+    if (!HashMapInit(&state->flows, sizeof(flow_key_t), sizeof(loss_flow_t)) ||
+        !HashMapInit(&state->buckets, sizeof(loss_bucket_key_t), sizeof(loss_totals_t)) ||
+        !HashMapInit(&state->interfaces, sizeof(uint32_t), sizeof(loss_totals_t))) {
+        LossInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        LossInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, LossInitDataFree);
+}
+
+// Queue the row of the next flow, bucket or interface once the capture has
+// been read; moves on to the next phase when a map is exhausted
+static void DrainNext(loss_state_t *state) {
+    const void *key;
+    void *value;
+    hash_map_t *map = state->phase == LOSS_PHASE_FLOWS     ? &state->flows
+                      : state->phase == LOSS_PHASE_BUCKETS ? &state->buckets
+                                                           : &state->interfaces;
+    if (!HashMapNext(map, &state->position, &key, &value)) {
+        state->phase++;
+        state->position = 0;
+        return;
+    }
+    if (state->phase == LOSS_PHASE_FLOWS) {
+        QueueFlow(state, (const flow_key_t *)key, (const loss_flow_t *)value);
+        return;
+    }
+    const loss_totals_t *totals = (const loss_totals_t *)value;
+    loss_row_t row;
+    memset(&row, 0, sizeof(row));
+    row.counts = totals->counts;
+    if (state->phase == LOSS_PHASE_BUCKETS) {
+        const loss_bucket_key_t *bucket_key = (const loss_bucket_key_t *)key;
+        row.scope = LOSS_SCOPE_BUCKET;
+        row.interface_id = bucket_key->interface_id;
+        row.start_ns = bucket_key->index * state->bind->bucket_ns;
+        row.end_ns = row.start_ns + state->bind->bucket_ns;
+    } else {
+        row.scope = LOSS_SCOPE_INTERFACE;
+        memcpy(&row.interface_id, key, sizeof(uint32_t));
+        row.start_ns = totals->first_ns;
+        row.end_ns = totals->last_ns;
+    }
+    QueueRow(state, &row);
+}
+
+static void LossFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    loss_state_t *state = (loss_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[LOSS_COL_COUNT];
+    for (idx_t i = 0; i < LOSS_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint32_t *interfaces = (uint32_t *)duckdb_vector_get_data(vectors[LOSS_COL_INTERFACE_ID]);
+    uint64_t *starts = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_START_TIMESTAMP]);
+    uint64_t *ends = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_END_TIMESTAMP]);
+    uint16_t *src_ports = (uint16_t *)duckdb_vector_get_data(vectors[LOSS_COL_SRC_PORT]);
+    uint16_t *dst_ports = (uint16_t *)duckdb_vector_get_data(vectors[LOSS_COL_DST_PORT]);
+    uint64_t *packets = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_TCP_PACKETS]);
+    uint64_t *acks = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_ACKS]);
+    uint64_t *gaps = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_GAPS]);
+    uint64_t *acked_bytes = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_ACKED_BYTES]);
+    uint64_t *gap_bytes = (uint64_t *)duckdb_vector_get_data(vectors[LOSS_COL_GAP_BYTES]);
+    double *percents = (double *)duckdb_vector_get_data(vectors[LOSS_COL_LOSS_PERCENT]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    while (row_count < max_rows) {
+        if (state->row_next * sizeof(loss_row_t) == state->rows.len) {
+            state->rows.len = 0;
+            state->row_next = 0;
+            if (state->phase == LOSS_PHASE_DONE) {
+                break;
+            }
+            if (state->phase != LOSS_PHASE_SCAN) {
+                DrainNext(state);
+                continue;
+            }
+            if (!PcapSourceNext(state->source, &packet)) {
+                FlushBucket(state);
+                state->phase = LOSS_PHASE_FLOWS;
+                continue;
+            }
+            if (PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) &&
+                pkt.ip_proto == IPPROTO_NUM_TCP && pkt.l4 && !pkt.is_fragment) {
+                ProcessPacket(state, &packet, &pkt);
+            }
+            continue;
+        }
+        const loss_row_t *queued = (const loss_row_t *)(const void *)state->rows.data + state->row_next++;
+        idx_t row = row_count++;
+        duckdb_vector_assign_string_element(vectors[LOSS_COL_SCOPE], row, loss_scope_names[queued->scope]);
+        interfaces[row] = queued->interface_id;
+        starts[row] = queued->start_ns;
+        ends[row] = queued->end_ns;
+        if (queued->scope == LOSS_SCOPE_FLOW) {
+            char src_ip[64];
+            char dst_ip[64];
+            FlowFormatEndpoint(&queued->key, queued->initiator, src_ip, sizeof(src_ip), &src_ports[row]);
+            FlowFormatEndpoint(&queued->key, 1 - queued->initiator, dst_ip, sizeof(dst_ip), &dst_ports[row]);
+            duckdb_vector_assign_string_element(vectors[LOSS_COL_SRC_IP], row, src_ip);
+            duckdb_vector_assign_string_element(vectors[LOSS_COL_DST_IP], row, dst_ip);
+        } else {
+            PcapVectorSetNull(vectors[LOSS_COL_SRC_IP], row);
+            PcapVectorSetNull(vectors[LOSS_COL_SRC_PORT], row);
+            PcapVectorSetNull(vectors[LOSS_COL_DST_IP], row);
+            PcapVectorSetNull(vectors[LOSS_COL_DST_PORT], row);
+        }
+        packets[row] = queued->counts.packets;
+        acks[row] = queued->counts.acks;
+        gaps[row] = queued->counts.gaps;
+        acked_bytes[row] = queued->counts.acked_bytes;
+        gap_bytes[row] = queued->counts.gap_bytes;
+        if (queued->counts.acked_bytes) {
+            percents[row] = 100.0 * (double)queued->counts.gap_bytes / (double)queued->counts.acked_bytes;
+        } else {
+            PcapVectorSetNull(vectors[LOSS_COL_LOSS_PERCENT], row);
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterCaptureLossFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_capture_loss");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_logical_type bigint_type = duckdb_create_logical_type(DUCKDB_TYPE_BIGINT);
+    duckdb_table_function_add_named_parameter(function, "bucket_seconds", bigint_type);
+    duckdb_destroy_logical_type(&bigint_type);
+
+    duckdb_table_function_set_bind(function, LossBind);
+    duckdb_table_function_set_init(function, LossInit);
+    duckdb_table_function_set_function(function, LossFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
@@ -1,5 +1,22 @@
 #include "duckdb_extension.h"
 #include "pcap_reader.h"
+#include "app_classifier.h"
+#include "address_tracking.h"
+#include "beacon_detection.h"
+#include "capture_loss.h"
+#include "ids_rules.h"
+#include "industrial_protocols.h"
+#include "io_scheduler.h"
+#include "payload_similarity.h"
+#include "pcapng_writer.h"
+#include "regex_match.h"
+#include "routing_protocols.h"
+#include "scan_detection.h"
+#include "ssh_decoder.h"
+#include "timing_protocols.h"
+#include "tls_decoder.h"
+#include "yara_rules.h"
+#include "zstd_writer.h"
 
 // Forward declaration for the function generated by the macro
 #ifdef _WIN32
@@ -17,6 +34,36 @@ DUCKDB_EXTENSION_ENTRYPOINT(duckdb_connection connection, duckdb_extension_info
 	
 	// Register pcap reader function
 	RegisterPcapReaderFunction(connection);
+	RegisterInterfaceStatsFunction(connection);
+	RegisterGzipIndexFunction(connection);
+
+	// Register protocol decoders
+	RegisterPtpFunction(connection);
+	RegisterNtpFunction(connection);
+	RegisterAddressBindingsFunction(connection);
+	RegisterDhcpFunction(connection);
+	RegisterSshFunction(connection);
+	RegisterModbusFunction(connection);
+	RegisterDnp3Function(connection);
+	RegisterS7commFunction(connection);
+	RegisterBgpFunction(connection);
+	RegisterOspfFunction(connection);
+	RegisterTlsFunction(connection);
+	RegisterClassifyFunction(connection);
+	RegisterAlertsFunction(connection);
+	RegisterYaraFunction(connection);
+	RegisterBeaconsFunction(connection);
+	RegisterScansFunction(connection);
+	RegisterCaptureLossFunction(connection);
+
+	// Register scalar functions
+	RegisterRegexFunctions(connection);
+	RegisterSimilarityFunctions(connection);
+	RegisterIoSchedulerFunction(connection);
+
+	// Register writers
+	RegisterPcapngWriterFunction(connection);
+	RegisterZstdWriterFunction(connection);
 
 	// Return true to indicate successful initialization
 	return true;
@@ -0,0 +1,118 @@
+#include "duckdb_extension.h"
+#include "flow.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+int FlowKeyFromPacket(const packet_info_t *pkt, flow_key_t *key) {
+    if (!pkt->ip_version) {
+        return -1;
+    }
+    size_t addr_len = pkt->ip_version == 4 ? 4 : 16;
+    memset(key, 0, sizeof(flow_key_t));
+    key->ip_version = pkt->ip_version;
+    key->ip_proto = pkt->ip_proto;
+
+    int cmp = memcmp(pkt->src_ip, pkt->dst_ip, addr_len);
+    int forward = cmp < 0 || (cmp == 0 && pkt->src_port <= pkt->dst_port);
+    if (forward) {
+        memcpy(key->addr_a, pkt->src_ip, addr_len);
+        memcpy(key->addr_b, pkt->dst_ip, addr_len);
+        key->port_a = pkt->src_port;
+        key->port_b = pkt->dst_port;
+        return 0;
+    }
+    memcpy(key->addr_a, pkt->dst_ip, addr_len);
+    memcpy(key->addr_b, pkt->src_ip, addr_len);
+    key->port_a = pkt->dst_port;
+    key->port_b = pkt->src_port;
+    return 1;
+}
+
+void FlowFormatEndpoint(const flow_key_t *key, int endpoint, char *addr, size_t addr_len, uint16_t *port) {
+    PacketFormatIp(key->ip_version, endpoint ? key->addr_b : key->addr_a, addr, addr_len);
+    *port = endpoint ? key->port_b : key->port_a;
+}
+
+uint32_t TcpDirectionAccept(tcp_direction_t *dir, const packet_info_t *pkt, const uint8_t **data) {
+    uint32_t seq = pkt->tcp_seq;
+    uint32_t len = pkt->payload ? pkt->payload_len : 0;
+
+    if (pkt->tcp_flags & TCP_FLAG_SYN) {
+        // The SYN consumes one sequence number
+        dir->next_seq = seq + 1;
+        dir->has_seq = 1;
+        return 0;
+    }
+    if (!dir->has_seq) {
+        // Mid-stream pickup: start at the first segment we see
+        dir->next_seq = seq;
+        dir->has_seq = 1;
+    }
+    if (pkt->tcp_flags & TCP_FLAG_FIN) {
+        dir->fin = 1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    int32_t delta = (int32_t)(seq - dir->next_seq);
+    if (delta > 0) {
+        dir->gap = 1;
+        return 0;
+    }
+    uint32_t overlap = dir->next_seq - seq;
+    if (overlap >= len) {
+        return 0;
+    }
+    *data = pkt->payload + overlap;
+    dir->next_seq = seq + len;
+    return len - overlap;
+}
+
+void TcpDirectionResync(tcp_direction_t *dir, const packet_info_t *pkt) {
+    dir->next_seq = pkt->tcp_seq;
+    dir->has_seq = 1;
+    dir->gap = 0;
+}
+
+int StreamBufferAppend(stream_buffer_t *buffer, const uint8_t *data, size_t len, size_t limit) {
+    if (buffer->len + len > limit) {
+        return 0;
+    }
+    if (buffer->len + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->len + len) {
+            capacity *= 2;
+        }
+        uint8_t *grown = (uint8_t *)duckdb_malloc(capacity);
+        if (!grown) {
+            return 0;
+        }
+        if (buffer->data) {
+            memcpy(grown, buffer->data, buffer->len);
+            duckdb_free(buffer->data);
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 1;
+}
+
+void StreamBufferConsume(stream_buffer_t *buffer, size_t len) {
+    if (len >= buffer->len) {
+        buffer->len = 0;
+        return;
+    }
+    memmove(buffer->data, buffer->data + len, buffer->len - len);
+    buffer->len -= len;
+}
+
+void StreamBufferFree(stream_buffer_t *buffer) {
+    if (buffer->data) {
+        duckdb_free(buffer->data);
+    }
+    memset(buffer, 0, sizeof(stream_buffer_t));
+}
@@ -0,0 +1,269 @@
+#include "duckdb_extension.h"
+#include "gzip_index.h"
+#include "inflate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Sidecar layout, all integers little-endian: magic, compressed size,
+// trailer, checkpoint count, then per checkpoint the six 64-bit fields of
+// capture_checkpoint_t, the window length and the window bytes
+#define HEADER_LEN (8 + 8 + GZIP_INDEX_TRAILER_LEN + 4)
+#define CHECKPOINT_LEN (6 * 8 + 4)
+
+// Upper bound on checkpoints accepted from a sidecar
+#define MAX_CHECKPOINTS (1u << 24)
+
+static void PutU32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void PutU64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t GetU32(const uint8_t *p) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+static uint64_t GetU64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+int GzipIndexFingerprint(capture_file_t *file, uint64_t *size, uint8_t *trailer) {
+    uint64_t position = file->position;
+    int64_t end = file->size;
+    if (end < GZIP_INDEX_TRAILER_LEN) {
+        return 0;
+    }
+    int ok = CaptureFileReadAt(file, (uint64_t)end - GZIP_INDEX_TRAILER_LEN, trailer, GZIP_INDEX_TRAILER_LEN);
+    *size = (uint64_t)end;
+    return CaptureFileSeek(file, position) && ok;
+}
+
+capture_index_t *GzipIndexCreate(uint64_t compressed_size, const uint8_t *trailer, uint64_t record_offset) {
+    capture_index_t *index = CaptureIndexCreate();
+    if (!index) {
+        return NULL;
+    }
+    index->compressed_size = compressed_size;
+    memcpy(index->trailer, trailer, GZIP_INDEX_TRAILER_LEN);
+    index->next_checkpoint = GZIP_INDEX_SPACING;
+
+    // The first region starts with the file itself
+    capture_checkpoint_t *first = CaptureIndexAddCheckpoint(index);
+    if (!first) {
+        CaptureIndexFree(index);
+        return NULL;
+    }
+    first->record_offset = record_offset;
+    return index;
+}
+
+void GzipIndexBlock(void *context, uint64_t in_bits, uint64_t out_offset, const uint8_t *window, size_t window_len) {
+    capture_index_t *index = (capture_index_t *)context;
+    if (out_offset < index->next_checkpoint || index->pending || index->failed) {
+        return;
+    }
+    uint8_t *copy = (uint8_t *)duckdb_malloc(window_len ? window_len : 1);
+    capture_checkpoint_t *checkpoint = copy ? CaptureIndexAddCheckpoint(index) : NULL;
+    if (!checkpoint) {
+        duckdb_free(copy);
+        index->failed = 1;
+        return;
+    }
+    if (window_len) {
+        memcpy(copy, window, window_len);
+    }
+    checkpoint->in_bits = in_bits;
+    checkpoint->out_offset = out_offset;
+    checkpoint->window = copy;
+    checkpoint->window_len = (uint32_t)window_len;
+    index->pending = 1;
+    index->next_checkpoint = out_offset + GZIP_INDEX_SPACING;
+}
+
+void GzipIndexAddRecord(capture_index_t *index, uint64_t offset, uint64_t timestamp_ns) {
+    capture_checkpoint_t *last = &index->checkpoints[index->count - 1];
+    if (index->pending && offset >= last->out_offset) {
+        last->record_offset = offset;
+        index->pending = 0;
+    }
+    // Records before a pending checkpoint's first one still belong to the
+    // previous region
+    capture_checkpoint_t *region = &index->checkpoints[index->count - 1 - (uint32_t)index->pending];
+    region->packets++;
+    if (timestamp_ns < region->min_timestamp_ns) {
+        region->min_timestamp_ns = timestamp_ns;
+    }
+    if (timestamp_ns > region->max_timestamp_ns) {
+        region->max_timestamp_ns = timestamp_ns;
+    }
+}
+
+static FILE *OpenSidecar(const char *path, const char *mode) {
+    FILE *file = NULL;
+#ifdef _WIN32
+    if (fopen_s(&file, path, mode) != 0) {
+        file = NULL;
+    }
+#else
+    file = fopen(path, mode);
+#endif
+    return file;
+}
+
+static char *SidecarPath(const char *capture_path, const char *suffix) {
+    size_t path_len = strlen(capture_path);
+    size_t suffix_len = strlen(suffix);
+    char *path = (char *)duckdb_malloc(path_len + suffix_len + 1);
+    if (path) {
+        memcpy(path, capture_path, path_len);
+        memcpy(path + path_len, suffix, suffix_len + 1);
+    }
+    return path;
+}
+
+static int WriteIndex(const capture_index_t *index, FILE *file) {
+    uint8_t header[HEADER_LEN];
+    memcpy(header, GZIP_INDEX_MAGIC, 8);
+    PutU64(header + 8, index->compressed_size);
+    memcpy(header + 16, index->trailer, GZIP_INDEX_TRAILER_LEN);
+    PutU32(header + 16 + GZIP_INDEX_TRAILER_LEN, index->count);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < index->count; i++) {
+        const capture_checkpoint_t *checkpoint = &index->checkpoints[i];
+        uint8_t entry[CHECKPOINT_LEN];
+        PutU64(entry, checkpoint->in_bits);
+        PutU64(entry + 8, checkpoint->out_offset);
+        PutU64(entry + 16, checkpoint->record_offset);
+        PutU64(entry + 24, checkpoint->packets);
+        PutU64(entry + 32, checkpoint->min_timestamp_ns);
+        PutU64(entry + 40, checkpoint->max_timestamp_ns);
+        PutU32(entry + 48, checkpoint->window_len);
+        // The first checkpoint has no window (and a NULL one)
+        if (fwrite(entry, 1, sizeof(entry), file) != sizeof(entry) ||
+            (checkpoint->window_len &&
+             fwrite(checkpoint->window, 1, checkpoint->window_len, file) != checkpoint->window_len)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int GzipIndexSave(capture_index_t *index, const char *capture_path) {
+    if (index->failed) {
+        return 0;
+    }
+    // A checkpoint after the last record opens no region
+    if (index->pending) {
+        duckdb_free(index->checkpoints[--index->count].window);
+        index->pending = 0;
+    }
+
+    // Write to a temporary name first so readers never see a partial sidecar
+    char *path = SidecarPath(capture_path, GZIP_INDEX_SUFFIX);
+    char *temp_path = SidecarPath(capture_path, GZIP_INDEX_SUFFIX ".tmp");
+    int ok = 0;
+    if (path && temp_path) {
+        FILE *file = OpenSidecar(temp_path, "wb");
+        if (file) {
+            ok = WriteIndex(index, file);
+            ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+            // rename() does not replace an existing file on Windows
+            if (ok) {
+                remove(path);
+            }
+#endif
+            ok = ok && rename(temp_path, path) == 0;
+            if (!ok) {
+                remove(temp_path);
+            }
+        }
+    }
+    duckdb_free(path);
+    duckdb_free(temp_path);
+    return ok;
+}
+
+static capture_index_t *ReadIndex(FILE *file, uint64_t compressed_size, const uint8_t *trailer) {
+    uint8_t header[HEADER_LEN];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, GZIP_INDEX_MAGIC, 8) != 0 ||
+        GetU64(header + 8) != compressed_size || memcmp(header + 16, trailer, GZIP_INDEX_TRAILER_LEN) != 0) {
+        return NULL;
+    }
+    uint32_t count = GetU32(header + 16 + GZIP_INDEX_TRAILER_LEN);
+    if (!count || count > MAX_CHECKPOINTS) {
+        return NULL;
+    }
+    capture_index_t *index = CaptureIndexCreate();
+    if (!index) {
+        return NULL;
+    }
+    index->compressed_size = compressed_size;
+    memcpy(index->trailer, trailer, GZIP_INDEX_TRAILER_LEN);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t entry[CHECKPOINT_LEN];
+        capture_checkpoint_t *checkpoint = CaptureIndexAddCheckpoint(index);
+        if (!checkpoint || fread(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            CaptureIndexFree(index);
+            return NULL;
+        }
+        checkpoint->in_bits = GetU64(entry);
+        checkpoint->out_offset = GetU64(entry + 8);
+        checkpoint->record_offset = GetU64(entry + 16);
+        checkpoint->packets = GetU64(entry + 24);
+        checkpoint->min_timestamp_ns = GetU64(entry + 32);
+        checkpoint->max_timestamp_ns = GetU64(entry + 40);
+        checkpoint->window_len = GetU32(entry + 48);
+
+        // Only the first region may start at the beginning of the file, and
+        // regions must follow each other
+        int valid = checkpoint->window_len <= INFLATE_WINDOW_SIZE && checkpoint->window_len <= checkpoint->out_offset &&
+                    checkpoint->record_offset >= checkpoint->out_offset && (checkpoint->in_bits == 0) == (i == 0) &&
+                    (i == 0 || checkpoint->record_offset > index->checkpoints[i - 1].record_offset);
+        if (valid) {
+            checkpoint->window = (uint8_t *)duckdb_malloc(checkpoint->window_len ? checkpoint->window_len : 1);
+            valid = checkpoint->window &&
+                    fread(checkpoint->window, 1, checkpoint->window_len, file) == checkpoint->window_len;
+        }
+        if (!valid) {
+            CaptureIndexFree(index);
+            return NULL;
+        }
+    }
+    return index;
+}
+
+capture_index_t *GzipIndexLoad(const char *capture_path, uint64_t compressed_size, const uint8_t *trailer) {
+    char *path = SidecarPath(capture_path, GZIP_INDEX_SUFFIX);
+    if (!path) {
+        return NULL;
+    }
+    FILE *file = OpenSidecar(path, "rb");
+    duckdb_free(path);
+    if (!file) {
+        return NULL;
+    }
+    capture_index_t *index = ReadIndex(file, compressed_size, trailer);
+    fclose(file);
+    return index;
+}
@@ -0,0 +1,156 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define HASH_MAP_INITIAL_CAPACITY 64
+// Keys and values start on 8-byte boundaries so values may hold any scalar
+#define HASH_MAP_KEY_OFFSET 8
+
+uint64_t HashBytes(const void *data, size_t len) {
+    // Eight bytes per multiply (keys are mostly flow tuples of 20-40 bytes),
+    // then a murmur3 finaliser to spread the low bits
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t hash = 0xcbf29ce484222325ULL ^ len;
+    uint64_t word;
+    for (; len >= 8; p += 8, len -= 8) {
+        memcpy(&word, p, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+    word = 0;
+    memcpy(&word, p, len);
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint8_t *SlotAt(const hash_map_t *map, size_t index) {
+    return map->slots + index * map->slot_size;
+}
+
+static int Allocate(hash_map_t *map, size_t capacity) {
+    map->slots = (uint8_t *)duckdb_malloc(capacity * map->slot_size);
+    if (!map->slots) {
+        return 0;
+    }
+    memset(map->slots, 0, capacity * map->slot_size);
+    map->capacity = capacity;
+    map->count = 0;
+    return 1;
+}
+
+int HashMapInit(hash_map_t *map, size_t key_size, size_t value_size) {
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->value_offset = HASH_MAP_KEY_OFFSET + ((key_size + 7) & ~(size_t)7);
+    map->slot_size = map->value_offset + ((value_size + 7) & ~(size_t)7);
+    return Allocate(map, HASH_MAP_INITIAL_CAPACITY);
+}
+
+void HashMapDestroy(hash_map_t *map) {
+    if (map->slots) {
+        duckdb_free(map->slots);
+        map->slots = NULL;
+    }
+    map->capacity = 0;
+    map->count = 0;
+}
+
+// Locate the slot holding key, or the empty slot where it would be inserted
+static size_t Probe(const hash_map_t *map, const void *key) {
+    size_t mask = map->capacity - 1;
+    size_t index = (size_t)HashBytes(key, map->key_size) & mask;
+    for (;;) {
+        uint8_t *slot = SlotAt(map, index);
+        if (!slot[0] || memcmp(slot + HASH_MAP_KEY_OFFSET, key, map->key_size) == 0) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+void *HashMapFind(const hash_map_t *map, const void *key) {
+    uint8_t *slot = SlotAt(map, Probe(map, key));
+    return slot[0] ? slot + map->value_offset : NULL;
+}
+
+static int Grow(hash_map_t *map) {
+    hash_map_t old = *map;
+    if (!Allocate(map, old.capacity * 2)) {
+        *map = old;
+        return 0;
+    }
+    for (size_t i = 0; i < old.capacity; i++) {
+        uint8_t *slot = SlotAt(&old, i);
+        if (slot[0]) {
+            memcpy(SlotAt(map, Probe(map, slot + HASH_MAP_KEY_OFFSET)), slot, map->slot_size);
+            map->count++;
+        }
+    }
+    duckdb_free(old.slots);
+    return 1;
+}
+
+void *HashMapInsert(hash_map_t *map, const void *key, int *is_new) {
+    uint8_t *slot = SlotAt(map, Probe(map, key));
+    if (slot[0]) {
+        *is_new = 0;
+        return slot + map->value_offset;
+    }
+    // Keep the load factor below 3/4
+    if ((map->count + 1) * 4 > map->capacity * 3) {
+        if (!Grow(map)) {
+            return NULL;
+        }
+        slot = SlotAt(map, Probe(map, key));
+    }
+    slot[0] = 1;
+    memcpy(slot + HASH_MAP_KEY_OFFSET, key, map->key_size);
+    memset(slot + map->value_offset, 0, map->value_size);
+    map->count++;
+    *is_new = 1;
+    return slot + map->value_offset;
+}
+
+void HashMapRemove(hash_map_t *map, const void *key) {
+    size_t mask = map->capacity - 1;
+    size_t hole = Probe(map, key);
+    if (!SlotAt(map, hole)[0]) {
+        return;
+    }
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    size_t index = hole;
+    for (;;) {
+        index = (index + 1) & mask;
+        uint8_t *slot = SlotAt(map, index);
+        if (!slot[0]) {
+            break;
+        }
+        size_t home = (size_t)HashBytes(slot + HASH_MAP_KEY_OFFSET, map->key_size) & mask;
+        // Move the entry into the hole if the hole lies on its probe path
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            memcpy(SlotAt(map, hole), slot, map->slot_size);
+            hole = index;
+        }
+    }
+    memset(SlotAt(map, hole), 0, map->slot_size);
+    map->count--;
+}
+
+int HashMapNext(const hash_map_t *map, size_t *position, const void **key, void **value) {
+    while (*position < map->capacity) {
+        uint8_t *slot = SlotAt(map, (*position)++);
+        if (slot[0]) {
+            *key = slot + HASH_MAP_KEY_OFFSET;
+            *value = slot + map->value_offset;
+            return 1;
+        }
+    }
+    return 0;
+}
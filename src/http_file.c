@@ -0,0 +1,906 @@
+#include "duckdb_extension.h"
+#include "digest.h"
+#include "http_file.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+DUCKDB_EXTENSION_EXTERN
+
+// Case-insensitive prefix test against a lowercase prefix
+static int HasPrefix(const char *text, const char *prefix) {
+    for (; *prefix; text++, prefix++) {
+        if (tolower((unsigned char)*text) != *prefix) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int HttpFileIsUrl(const char *path) {
+    return HasPrefix(path, "http://") || HasPrefix(path, "https://") || HasPrefix(path, "s3://");
+}
+
+#ifdef __EMSCRIPTEN__
+
+// Sockets are not available to Wasm extensions
+capture_file_t *HttpFileOpen(const char *url) {
+    (void)url;
+    return NULL;
+}
+
+#else
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define NO_SOCKET INVALID_SOCKET
+#define CloseSocket closesocket
+#else
+typedef int socket_t;
+#define NO_SOCKET (-1)
+#define CloseSocket close
+#endif
+
+// Writing to a connection the server closed must fail rather than raise
+// SIGPIPE
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Ranges held at once: the one being read and those requested ahead of it
+#define HTTP_RANGES (HTTP_READ_AHEAD + 1)
+
+// Longest region name accepted for signing
+#define S3_REGION_MAX 64
+
+typedef enum { RANGE_EMPTY, RANGE_LOADING, RANGE_READY, RANGE_FAILED } range_state_t;
+
+// A range of the file and the connection it is received on
+typedef struct {
+    socket_t socket;
+    int keep_alive;          // whether the server leaves the connection open
+    range_state_t state;
+    int64_t chunk;           // chunk held or requested, -1 for none
+    int attempts;            // requests made for it so far
+    uint64_t start;
+    uint64_t request_len;    // bytes asked for
+    uint8_t *data;
+    size_t capacity;
+    size_t len;              // bytes of the range, once the first response header arrived
+    size_t filled;
+    size_t part_end;         // where the body of the response being received ends in data
+    int in_body;
+    char header[HTTP_HEADER_MAX];
+    size_t header_len;
+} http_range_t;
+
+typedef struct {
+    capture_file_t base;
+    char *host;              // name to resolve, without IPv6 brackets
+    char *port;
+    char *host_header;       // host and port as sent in Host
+    char *target;            // request target, encoded
+    char *access_key;        // S3 credentials, NULL for unsigned requests
+    char *secret_key;
+    char *session_token;
+    char *region;
+    int64_t last_chunk;      // chunk of the previous read
+    int64_t ahead;           // chunks requested ahead, doubling while reads stay sequential
+    int streaming;           // the server sent the whole file instead of a range
+    size_t consumed;         // streaming: bytes of ranges[0].data passed on
+    http_range_t ranges[HTTP_RANGES];
+} http_file_t;
+
+// ---------------------------------------------------------------------------
+// Sockets
+// ---------------------------------------------------------------------------
+
+static long SocketRecv(socket_t socket, void *buffer, size_t len) {
+#ifdef _WIN32
+    return recv(socket, (char *)buffer, len > INT32_MAX ? INT32_MAX : (int)len, 0);
+#else
+    return (long)recv(socket, buffer, len, 0);
+#endif
+}
+
+static int SocketSendAll(socket_t socket, const char *data, size_t len) {
+    while (len) {
+#ifdef _WIN32
+        long sent = send(socket, data, len > INT32_MAX ? INT32_MAX : (int)len, 0);
+#else
+        long sent = (long)send(socket, data, len, MSG_NOSIGNAL);
+#endif
+        if (sent <= 0) {
+            return 0;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 1;
+}
+
+static int PollSockets(struct pollfd *fds, size_t count, int timeout_ms) {
+#ifdef _WIN32
+    return WSAPoll(fds, (ULONG)count, timeout_ms);
+#else
+    return poll(fds, (nfds_t)count, timeout_ms);
+#endif
+}
+
+static int SetBlocking(socket_t socket, int blocking) {
+#ifdef _WIN32
+    u_long non_blocking = blocking ? 0 : 1;
+    return ioctlsocket(socket, FIONBIO, &non_blocking) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Connect within HTTP_TIMEOUT_MS, so that an unreachable host fails an
+// attempt like a stalled response does, then go back to blocking I/O
+static int ConnectWithTimeout(socket_t connection, const struct addrinfo *address) {
+    if (!SetBlocking(connection, 0)) {
+        return 0;
+    }
+    if (connect(connection, address->ai_addr, (socklen_t)address->ai_addrlen) != 0) {
+#ifdef _WIN32
+        if (WSAGetLastError() != WSAEWOULDBLOCK) {
+            return 0;
+        }
+#else
+        if (errno != EINPROGRESS) {
+            return 0;
+        }
+#endif
+        struct pollfd fd;
+        fd.fd = connection;
+        fd.events = POLLOUT;
+        fd.revents = 0;
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (PollSockets(&fd, 1, HTTP_TIMEOUT_MS) <= 0 ||
+            getsockopt(connection, SOL_SOCKET, SO_ERROR, (char *)&error, &error_len) != 0 || error != 0) {
+            return 0;
+        }
+    }
+    return SetBlocking(connection, 1);
+}
+
+static socket_t Connect(const http_file_t *http) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *addresses;
+    if (getaddrinfo(http->host, http->port, &hints, &addresses) != 0) {
+        return NO_SOCKET;
+    }
+    socket_t connection = NO_SOCKET;
+    for (struct addrinfo *address = addresses; address; address = address->ai_next) {
+        connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (connection == NO_SOCKET) {
+            continue;
+        }
+        if (ConnectWithTimeout(connection, address)) {
+            break;
+        }
+        CloseSocket(connection);
+        connection = NO_SOCKET;
+    }
+    freeaddrinfo(addresses);
+    if (connection != NO_SOCKET) {
+        // Requests are single small writes, sent at once
+        int one = 1;
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+    return connection;
+}
+
+static void CloseConnection(http_range_t *range) {
+    if (range->socket != NO_SOCKET) {
+        CloseSocket(range->socket);
+        range->socket = NO_SOCKET;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// URLs and S3 request signing
+// ---------------------------------------------------------------------------
+
+static char *CopyString(const char *text, size_t len) {
+    char *copy = (char *)duckdb_malloc(len + 1);
+    if (copy) {
+        memcpy(copy, text, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+// A non-empty environment variable, copied; NULL when unset
+static char *CopyEnv(const char *name) {
+#ifdef _WIN32
+    char *value = NULL;
+    size_t len;
+    if (_dupenv_s(&value, &len, name) != 0 || !value) {
+        return NULL;
+    }
+    char *copy = *value ? CopyString(value, strlen(value)) : NULL;
+    free(value);
+    return copy;
+#else
+    const char *value = getenv(name);
+    return value && *value ? CopyString(value, strlen(value)) : NULL;
+#endif
+}
+
+// Percent-encode a path into out (3 * len + 1 bytes). S3 keys keep only
+// unreserved characters and '/'; other paths only lose spaces and control
+// characters, which cannot appear in a request line.
+static void EncodePath(const char *path, size_t len, int strict, char *out) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)path[i];
+        int keep = strict ? (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~' || c == '/') : (c > ' ' && c < 0x7F);
+        if (keep) {
+            *out++ = (char)c;
+        } else {
+            *out++ = '%';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 15];
+        }
+    }
+    *out = '\0';
+}
+
+// Take the server from an http:// URL and point *path at what follows it.
+// Returns 0 for other schemes, a malformed server or when out of memory.
+static int SetServer(http_file_t *http, const char *url, const char **path) {
+    if (!HasPrefix(url, "http://")) {
+        return 0;
+    }
+    const char *server = url + 7;
+    const char *server_end = server + strcspn(server, "/?#");
+    const char *name = server;
+    const char *name_end;
+    const char *port = NULL;
+    if (*server == '[') {
+        // IPv6 literal
+        name++;
+        name_end = (const char *)memchr(name, ']', (size_t)(server_end - name));
+        if (!name_end || (name_end + 1 != server_end && name_end[1] != ':')) {
+            return 0;
+        }
+        port = name_end + 1 != server_end ? name_end + 2 : NULL;
+    } else {
+        name_end = (const char *)memchr(server, ':', (size_t)(server_end - server));
+        if (name_end) {
+            port = name_end + 1;
+        } else {
+            name_end = server_end;
+        }
+    }
+    if (name_end == name || (port && port == server_end)) {
+        return 0;
+    }
+    http->host = CopyString(name, (size_t)(name_end - name));
+    http->port = port ? CopyString(port, (size_t)(server_end - port)) : CopyString("80", 2);
+    http->host_header = CopyString(server, (size_t)(server_end - server));
+    *path = server_end;
+    return http->host && http->port && http->host_header;
+}
+
+static int ParseHttpUrl(http_file_t *http, const char *url) {
+    const char *path;
+    if (!SetServer(http, url, &path)) {
+        return 0;
+    }
+    size_t len = strcspn(path, "#");
+    http->target = (char *)duckdb_malloc(3 * len + 2);
+    if (!http->target) {
+        return 0;
+    }
+    http->target[0] = '/';
+    EncodePath(path, len, 0, http->target + (*path != '/'));
+    return 1;
+}
+
+// s3://bucket/key, read from the configured endpoint with the bucket as the
+// first path component
+static int ParseS3Url(http_file_t *http, const char *url) {
+    const char *bucket = url + 5;
+    const char *slash = strchr(bucket, '/');
+    if (!slash || slash == bucket || !slash[1]) {
+        return 0;
+    }
+    char *endpoint = CopyEnv("AWS_ENDPOINT_URL_S3");
+    if (!endpoint) {
+        endpoint = CopyEnv("AWS_ENDPOINT_URL");
+    }
+    const char *path;
+    int ok = endpoint && SetServer(http, endpoint, &path);
+    if (ok) {
+        size_t prefix_len = strcspn(path, "?#");
+        while (prefix_len && path[prefix_len - 1] == '/') {
+            prefix_len--;
+        }
+        size_t len = strlen(bucket);
+        http->target = (char *)duckdb_malloc(3 * prefix_len + 3 * len + 2);
+        ok = http->target != NULL;
+        if (ok) {
+            EncodePath(path, prefix_len, 0, http->target);
+            size_t at = strlen(http->target);
+            http->target[at] = '/';
+            EncodePath(bucket, len, 1, http->target + at + 1);
+        }
+    }
+    duckdb_free(endpoint);
+    if (!ok) {
+        return 0;
+    }
+
+    http->access_key = CopyEnv("AWS_ACCESS_KEY_ID");
+    http->secret_key = CopyEnv("AWS_SECRET_ACCESS_KEY");
+    if (!http->access_key || !http->secret_key) {
+        // Anonymous access to a public bucket
+        duckdb_free(http->access_key);
+        duckdb_free(http->secret_key);
+        http->access_key = NULL;
+        http->secret_key = NULL;
+        return 1;
+    }
+    http->session_token = CopyEnv("AWS_SESSION_TOKEN");
+    http->region = CopyEnv("AWS_REGION");
+    if (!http->region) {
+        http->region = CopyEnv("AWS_DEFAULT_REGION");
+    }
+    if (!http->region) {
+        http->region = CopyString("us-east-1", 9);
+    }
+    return http->region && strlen(http->region) <= S3_REGION_MAX;
+}
+
+static void HmacSha256(const uint8_t *key, size_t key_len, const void *data, size_t len, uint8_t out[SHA256_DIGEST_LEN]) {
+    uint8_t pad[64];
+    uint8_t inner[SHA256_DIGEST_LEN];
+    sha256_ctx_t ctx;
+    memset(pad, 0, sizeof(pad));
+    if (key_len > sizeof(pad)) {
+        Sha256Init(&ctx);
+        Sha256Update(&ctx, key, key_len);
+        Sha256Final(&ctx, pad);
+    } else {
+        memcpy(pad, key, key_len);
+    }
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] ^= 0x36;
+    }
+    Sha256Init(&ctx);
+    Sha256Update(&ctx, pad, sizeof(pad));
+    Sha256Update(&ctx, data, len);
+    Sha256Final(&ctx, inner);
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] ^= 0x36 ^ 0x5C;
+    }
+    Sha256Init(&ctx);
+    Sha256Update(&ctx, pad, sizeof(pad));
+    Sha256Update(&ctx, inner, SHA256_DIGEST_LEN);
+    Sha256Final(&ctx, out);
+}
+
+static void HashText(sha256_ctx_t *ctx, const char *text) {
+    Sha256Update(ctx, text, strlen(text));
+}
+
+// Headers signing a GET of http->target with AWS signature version 4. The
+// payload is declared unsigned and Range is left out of the signature, so
+// every range of the file is signed alike.
+static int WriteSignature(const http_file_t *http, char *out, size_t size) {
+    time_t now = time(NULL);
+    struct tm utc;
+#ifdef _WIN32
+    if (gmtime_s(&utc, &now) != 0) {
+        return -1;
+    }
+#else
+    if (!gmtime_r(&now, &utc)) {
+        return -1;
+    }
+#endif
+    char date[17];
+    char day[9];
+    strftime(date, sizeof(date), "%Y%m%dT%H%M%SZ", &utc);
+    memcpy(day, date, 8);
+    day[8] = '\0';
+    const char *signed_headers = http->session_token ? "host;x-amz-content-sha256;x-amz-date;x-amz-security-token"
+                                                     : "host;x-amz-content-sha256;x-amz-date";
+
+    sha256_ctx_t ctx;
+    uint8_t digest[SHA256_DIGEST_LEN];
+    Sha256Init(&ctx);
+    HashText(&ctx, "GET\n");
+    HashText(&ctx, http->target);
+    HashText(&ctx, "\n\nhost:");
+    HashText(&ctx, http->host_header);
+    HashText(&ctx, "\nx-amz-content-sha256:UNSIGNED-PAYLOAD\nx-amz-date:");
+    HashText(&ctx, date);
+    if (http->session_token) {
+        HashText(&ctx, "\nx-amz-security-token:");
+        HashText(&ctx, http->session_token);
+    }
+    HashText(&ctx, "\n\n");
+    HashText(&ctx, signed_headers);
+    HashText(&ctx, "\nUNSIGNED-PAYLOAD");
+    Sha256Final(&ctx, digest);
+    char request_hash[2 * SHA256_DIGEST_LEN + 1];
+    DigestToHex(digest, SHA256_DIGEST_LEN, request_hash);
+
+    char scope[S3_REGION_MAX + 32];
+    snprintf(scope, sizeof(scope), "%s/%s/s3/aws4_request", day, http->region);
+    char string_to_sign[sizeof(scope) + 128];
+    int string_len = snprintf(string_to_sign, sizeof(string_to_sign), "AWS4-HMAC-SHA256\n%s\n%s\n%s", date, scope, request_hash);
+
+    size_t secret_len = strlen(http->secret_key);
+    uint8_t *secret = (uint8_t *)duckdb_malloc(secret_len + 4);
+    if (!secret) {
+        return -1;
+    }
+    memcpy(secret, "AWS4", 4);
+    memcpy(secret + 4, http->secret_key, secret_len);
+    uint8_t key[SHA256_DIGEST_LEN];
+    HmacSha256(secret, secret_len + 4, day, strlen(day), key);
+    duckdb_free(secret);
+    HmacSha256(key, sizeof(key), http->region, strlen(http->region), key);
+    HmacSha256(key, sizeof(key), "s3", 2, key);
+    HmacSha256(key, sizeof(key), "aws4_request", 12, key);
+    HmacSha256(key, sizeof(key), string_to_sign, (size_t)string_len, digest);
+    char signature[2 * SHA256_DIGEST_LEN + 1];
+    DigestToHex(digest, SHA256_DIGEST_LEN, signature);
+
+    int len = snprintf(out, size, "x-amz-content-sha256: UNSIGNED-PAYLOAD\r\nx-amz-date: %s\r\n", date);
+    if (http->session_token && len >= 0 && (size_t)len < size) {
+        len += snprintf(out + len, size - (size_t)len, "x-amz-security-token: %s\r\n", http->session_token);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(out + len, size - (size_t)len,
+                        "Authorization: AWS4-HMAC-SHA256 Credential=%s/%s, SignedHeaders=%s, Signature=%s\r\n",
+                        http->access_key, scope, signed_headers, signature);
+    }
+    return len;
+}
+
+// ---------------------------------------------------------------------------
+// Range requests
+// ---------------------------------------------------------------------------
+
+static int SendRequest(http_file_t *http, http_range_t *range) {
+    if (range->socket == NO_SOCKET) {
+        range->socket = Connect(http);
+        if (range->socket == NO_SOCKET) {
+            return 0;
+        }
+    }
+    size_t size = strlen(http->target) + strlen(http->host_header) + 512;
+    if (http->access_key) {
+        size += strlen(http->access_key) + (http->session_token ? strlen(http->session_token) : 0) + 512;
+    }
+    char *request = (char *)duckdb_malloc(size);
+    if (!request) {
+        return 0;
+    }
+    // After a short response or a failure, only the rest is asked for
+    int len = snprintf(request, size, "GET %s HTTP/1.1\r\nHost: %s\r\nRange: bytes=%llu-%llu\r\nUser-Agent: duckdb_pcap\r\n",
+                       http->target, http->host_header, (unsigned long long)(range->start + range->filled),
+                       (unsigned long long)(range->start + range->request_len - 1));
+    if (http->access_key && len >= 0 && (size_t)len < size) {
+        int signature_len = WriteSignature(http, request + len, size - (size_t)len);
+        len = signature_len < 0 ? -1 : len + signature_len;
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(request + len, size - (size_t)len, "\r\n");
+    }
+    int sent = len >= 0 && (size_t)len < size && SocketSendAll(range->socket, request, (size_t)len);
+    duckdb_free(request);
+    return sent;
+}
+
+// (Re)send the request for what is missing of a range, on a new connection
+// after a failure
+static void IssueRange(http_file_t *http, http_range_t *range) {
+    while (range->attempts < HTTP_ATTEMPTS) {
+        range->attempts++;
+        range->state = RANGE_LOADING;
+        range->header_len = 0;
+        range->in_body = 0;
+        if (SendRequest(http, range)) {
+            return;
+        }
+        CloseConnection(range);
+    }
+    range->state = RANGE_FAILED;
+}
+
+static void RetryRange(http_file_t *http, http_range_t *range) {
+    CloseConnection(range);
+    IssueRange(http, range);
+}
+
+// Request one chunk into the range it maps to, abandoning whatever that range
+// was receiving
+static void RequestChunk(http_file_t *http, int64_t chunk) {
+    http_range_t *range = &http->ranges[(uint64_t)chunk % HTTP_RANGES];
+    if (range->state == RANGE_LOADING) {
+        CloseConnection(range);
+    }
+    uint64_t left = (uint64_t)http->base.size - (uint64_t)chunk * HTTP_CHUNK_SIZE;
+    range->chunk = chunk;
+    range->start = (uint64_t)chunk * HTTP_CHUNK_SIZE;
+    range->request_len = left < HTTP_CHUNK_SIZE ? left : HTTP_CHUNK_SIZE;
+    range->len = 0;
+    range->filled = 0;
+    range->attempts = 0;
+    IssueRange(http, range);
+}
+
+// Unsigned decimal at text, or -1
+static int64_t ParseNumber(const char *text, const char **end) {
+    int64_t value = 0;
+    const char *p = text;
+    while (*p >= '0' && *p <= '9' && value <= (INT64_MAX - 9) / 10) {
+        value = value * 10 + (*p++ - '0');
+    }
+    *end = p;
+    return p == text || (*p >= '0' && *p <= '9') ? -1 : value;
+}
+
+// Value of a response header field, or NULL. The header is NUL-terminated.
+static const char *FindField(const char *header, const char *name) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(header, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (HasPrefix(line, name) && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value == ' ' || *value == '\t') {
+                value++;
+            }
+            return value;
+        }
+    }
+    return NULL;
+}
+
+static int ReserveData(http_range_t *range, size_t len) {
+    if (len <= range->capacity) {
+        return 1;
+    }
+    uint8_t *data = (uint8_t *)duckdb_malloc(len);
+    if (!data) {
+        return 0;
+    }
+    if (range->data) {
+        duckdb_free(range->data);
+    }
+    range->data = data;
+    range->capacity = len;
+    return 1;
+}
+
+// Check the response header against the request and size the body.
+// body_len bytes of it came with the header. A 206 response may hold less
+// than was asked for, and is then followed by a request for the rest.
+static int ParseHeader(http_file_t *http, http_range_t *range, size_t body_len) {
+    const char *header = range->header;
+    const char *end;
+    if (!HasPrefix(header, "http/1.") || (header[7] != '0' && header[7] != '1') || header[8] != ' ') {
+        return 0;
+    }
+    int64_t status = ParseNumber(header + 9, &end);
+    const char *connection = FindField(header, "connection");
+    range->keep_alive = header[7] == '1' && !(connection && HasPrefix(connection, "close"));
+    const char *encoding = FindField(header, "transfer-encoding");
+    if (encoding && !HasPrefix(encoding, "identity")) {
+        return 0;
+    }
+    const char *length_field = FindField(header, "content-length");
+    int64_t content_length = length_field ? ParseNumber(length_field, &end) : -1;
+    const char *content_range = FindField(header, "content-range");
+
+    if (status == 206 && content_range && HasPrefix(content_range, "bytes ")) {
+        // Content-Range: bytes first-last/size
+        int64_t first = ParseNumber(content_range + 6, &end);
+        int64_t last = *end == '-' ? ParseNumber(end + 1, &end) : -1;
+        int64_t total = *end == '/' ? ParseNumber(end + 1, &end) : -1;
+        if (first != (int64_t)(range->start + range->filled) || last < first ||
+            (content_length >= 0 && content_length != last - first + 1)) {
+            return 0;
+        }
+        if (http->base.size < 0) {
+            if (total < 0) {
+                return 0;
+            }
+            http->base.size = total;
+            // The probe may ask for more than the file holds
+            uint64_t left = range->start < (uint64_t)total ? (uint64_t)total - range->start : 0;
+            if (range->request_len > left) {
+                range->request_len = left;
+            }
+        }
+        if ((uint64_t)(last - first) >= range->request_len - range->filled) {
+            return 0;
+        }
+        range->len = (size_t)range->request_len;
+        range->part_end = range->filled + (size_t)(last - first + 1);
+    } else if (status == 416 && http->base.size < 0 && content_range && HasPrefix(content_range, "bytes */0")) {
+        // Nothing to send of an empty file
+        http->base.size = 0;
+        range->len = 0;
+        range->part_end = 0;
+    } else if (status == 200 && http->base.size < 0) {
+        // The server ignored the range and sends the whole file; what came
+        // with the header is read first
+        http->streaming = 1;
+        http->base.size = content_length;
+        range->len = body_len;
+        range->part_end = body_len;
+    } else {
+        return 0;
+    }
+    return body_len <= range->part_end - range->filled && ReserveData(range, range->len ? range->len : 1);
+}
+
+// Take in what arrived for a range: its response header, then its body.
+// Returns 0 on a closed connection or a bad response.
+static int ReceiveRange(http_file_t *http, http_range_t *range) {
+    if (!range->in_body) {
+        long received = SocketRecv(range->socket, range->header + range->header_len, HTTP_HEADER_MAX - 1 - range->header_len);
+        if (received <= 0) {
+            return 0;
+        }
+        range->header_len += (size_t)received;
+        range->header[range->header_len] = '\0';
+        char *end = strstr(range->header, "\r\n\r\n");
+        if (!end) {
+            return range->header_len < HTTP_HEADER_MAX - 1;
+        }
+        size_t header_len = (size_t)(end + 4 - range->header);
+        size_t body_len = range->header_len - header_len;
+        end[2] = '\0';
+        if (!ParseHeader(http, range, body_len)) {
+            return 0;
+        }
+        memcpy(range->data + range->filled, range->header + header_len, body_len);
+        range->filled += body_len;
+        range->in_body = 1;
+    } else {
+        long received = SocketRecv(range->socket, range->data + range->filled, range->part_end - range->filled);
+        if (received <= 0) {
+            return 0;
+        }
+        range->filled += (size_t)received;
+    }
+    if (range->filled < range->part_end) {
+        return 1;
+    }
+    if (!range->keep_alive && !http->streaming) {
+        CloseConnection(range);
+    }
+    if (range->filled == range->len) {
+        range->state = RANGE_READY;
+    } else {
+        // The server sent part of the range; ask for the rest
+        range->attempts = 0;
+        IssueRange(http, range);
+    }
+    return 1;
+}
+
+// Receive on every pending range until the wanted one has arrived or failed
+static int AwaitRange(http_file_t *http, http_range_t *wanted) {
+    struct pollfd fds[HTTP_RANGES];
+    http_range_t *polled[HTTP_RANGES];
+    while (wanted->state == RANGE_LOADING) {
+        size_t count = 0;
+        for (size_t i = 0; i < HTTP_RANGES; i++) {
+            if (http->ranges[i].state == RANGE_LOADING) {
+                fds[count].fd = http->ranges[i].socket;
+                fds[count].events = POLLIN;
+                fds[count].revents = 0;
+                polled[count++] = &http->ranges[i];
+            }
+        }
+        // A timeout or interruption counts as a failed attempt of every
+        // pending range
+        int ready = PollSockets(fds, count, HTTP_TIMEOUT_MS);
+        for (size_t i = 0; i < count; i++) {
+            if (ready <= 0 || (fds[i].revents && !ReceiveRange(http, polled[i]))) {
+                RetryRange(http, polled[i]);
+            }
+        }
+    }
+    return wanted->state == RANGE_READY;
+}
+
+// The range holding a chunk, requested if needed (offset is the position
+// wanted within it). Moving on to the next chunk requests those after it as
+// well, twice as many each time up to HTTP_READ_AHEAD, so that a scan
+// downloads several chunks at once while a seek costs a single one.
+static http_range_t *FetchChunk(http_file_t *http, int64_t chunk, uint64_t offset) {
+    http_range_t *range = &http->ranges[(uint64_t)chunk % HTTP_RANGES];
+    // The probe made when opening holds only the start of chunk 0
+    int held = range->chunk == chunk &&
+               (range->state == RANGE_LOADING || (range->state == RANGE_READY && offset < range->len));
+    if (!held) {
+        RequestChunk(http, chunk);
+    }
+    if (chunk != http->last_chunk) {
+        if (chunk == http->last_chunk + 1) {
+            http->ahead = http->ahead ? http->ahead * 2 : 1;
+            if (http->ahead > HTTP_READ_AHEAD) {
+                http->ahead = HTTP_READ_AHEAD;
+            }
+        } else {
+            http->ahead = 0;
+        }
+        for (int64_t next = chunk + 1; next <= chunk + http->ahead; next++) {
+            if ((uint64_t)next * HTTP_CHUNK_SIZE >= (uint64_t)http->base.size) {
+                break;
+            }
+            http_range_t *ahead = &http->ranges[(uint64_t)next % HTTP_RANGES];
+            if (ahead->chunk != next || ahead->state == RANGE_FAILED) {
+                RequestChunk(http, next);
+            }
+        }
+        http->last_chunk = chunk;
+    }
+    return AwaitRange(http, range) ? range : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// File operations
+// ---------------------------------------------------------------------------
+
+static size_t HttpRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    http_file_t *http = (http_file_t *)file;
+    uint64_t left = file->position < (uint64_t)file->size ? (uint64_t)file->size - file->position : 0;
+    if (len > left) {
+        len = (size_t)left;
+    }
+    size_t done = 0;
+    while (done < len) {
+        uint64_t position = file->position + done;
+        http_range_t *range = FetchChunk(http, (int64_t)(position / HTTP_CHUNK_SIZE), position % HTTP_CHUNK_SIZE);
+        if (!range) {
+            break;
+        }
+        size_t at = (size_t)(position - range->start);
+        if (at >= range->len) {
+            break;
+        }
+        size_t chunk_len = range->len - at < len - done ? range->len - at : len - done;
+        memcpy(buffer + done, range->data + at, chunk_len);
+        done += chunk_len;
+    }
+    return done;
+}
+
+// Positions are applied by the next read
+static int HttpSeek(capture_file_t *file, uint64_t offset) {
+    (void)file;
+    (void)offset;
+    return 1;
+}
+
+// The whole file, from a server that ignored the range
+static size_t HttpStreamRead(capture_file_t *file, uint8_t *buffer, size_t len) {
+    http_file_t *http = (http_file_t *)file;
+    http_range_t *range = &http->ranges[0];
+    if (file->size >= 0 && len > (uint64_t)file->size - file->position) {
+        len = (size_t)((uint64_t)file->size - file->position);
+    }
+    size_t done = 0;
+    if (http->consumed < range->len) {
+        done = range->len - http->consumed < len ? range->len - http->consumed : len;
+        memcpy(buffer, range->data + http->consumed, done);
+        http->consumed += done;
+    }
+    while (done < len && range->socket != NO_SOCKET) {
+        struct pollfd fd;
+        fd.fd = range->socket;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        long received = PollSockets(&fd, 1, HTTP_TIMEOUT_MS) > 0 ? SocketRecv(range->socket, buffer + done, len - done) : -1;
+        if (received <= 0) {
+            CloseConnection(range);
+            break;
+        }
+        done += (size_t)received;
+    }
+    return done;
+}
+
+static void HttpClose(capture_file_t *file) {
+    http_file_t *http = (http_file_t *)file;
+    for (size_t i = 0; i < HTTP_RANGES; i++) {
+        CloseConnection(&http->ranges[i]);
+        if (http->ranges[i].data) {
+            duckdb_free(http->ranges[i].data);
+        }
+    }
+    duckdb_free(http->host);
+    duckdb_free(http->port);
+    duckdb_free(http->host_header);
+    duckdb_free(http->target);
+    duckdb_free(http->access_key);
+    duckdb_free(http->secret_key);
+    duckdb_free(http->session_token);
+    duckdb_free(http->region);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static const capture_file_ops_t http_ops = {HttpRead, HttpSeek, HttpClose};
+static const capture_file_ops_t http_stream_ops = {HttpStreamRead, NULL, HttpClose};
+
+capture_file_t *HttpFileOpen(const char *url) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        return NULL;
+    }
+#endif
+    http_file_t *http = (http_file_t *)duckdb_malloc(sizeof(http_file_t));
+    if (!http) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return NULL;
+    }
+    memset(http, 0, sizeof(http_file_t));
+    http->base.ops = &http_ops;
+    http->base.size = -1;
+    http->last_chunk = -2;
+    for (size_t i = 0; i < HTTP_RANGES; i++) {
+        http->ranges[i].socket = NO_SOCKET;
+        http->ranges[i].chunk = -1;
+    }
+    int parsed = HasPrefix(url, "s3://") ? ParseS3Url(http, url) : ParseHttpUrl(http, url);
+
+    // Probe the start of the file, which also tells its size
+    http_range_t *probe = &http->ranges[0];
+    if (parsed) {
+        probe->chunk = 0;
+        probe->request_len = HTTP_PROBE_SIZE;
+        IssueRange(http, probe);
+    }
+    if (!parsed || !AwaitRange(http, probe)) {
+        HttpClose(&http->base);
+        duckdb_free(http);
+        return NULL;
+    }
+    if (http->streaming) {
+        http->base.ops = &http_stream_ops;
+    }
+    return &http->base;
+}
+
+#endif // __EMSCRIPTEN__
@@ -0,0 +1,1839 @@
+#include "duckdb_extension.h"
+#include "aho_corasick.h"
+#include "app_classifier.h"
+#include "flow.h"
+#include "hash_map.h"
+#include "ids_rules.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "regex_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define IPPROTO_NUM_ICMP 1
+#define IPPROTO_NUM_ICMPV6 58
+
+// flow keyword options
+#define IDS_FLOW_TO_SERVER 0x01
+#define IDS_FLOW_TO_CLIENT 0x02
+#define IDS_FLOW_ESTABLISHED 0x04
+#define IDS_FLOW_NOT_ESTABLISHED 0x08
+
+// Variable expansions nested inside one address or port specification
+#define IDS_MAX_VARIABLE_DEPTH 8
+
+// Address or port list entry; a specification matches when it matches any
+// positive entry (or has none) and no negated entry
+typedef struct {
+    uint8_t negated;
+    uint8_t ip_version;    // 0 matches both versions (any)
+    uint8_t prefix_len;
+    uint8_t addr[16];
+} ids_addr_item_t;
+
+typedef struct {
+    uint8_t negated;
+    uint16_t low;
+    uint16_t high;
+} ids_port_item_t;
+
+// Entries of one rule in a rule set pool
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+} ids_range_t;
+
+typedef enum {
+    IDS_ELEMENT_CONTENT,
+    IDS_ELEMENT_PCRE
+} ids_element_type_t;
+
+// A content or pcre match, evaluated in rule order
+typedef struct {
+    uint8_t type;          // ids_element_type_t
+    uint8_t negated;
+    uint8_t nocase;
+    uint8_t relative;      // distance/within, or the pcre R flag
+    uint8_t has_depth;     // depth, or within for relative contents
+    uint8_t has_offset;    // offset, or distance for relative contents
+    uint8_t fast_pattern;
+    uint8_t need_end;      // the next element is relative to this match
+    int32_t offset;        // offset, or distance
+    uint32_t depth;        // depth, or within
+    uint32_t data;         // content bytes in the byte pool
+    uint32_t data_len;
+    regex_prog_t *regex;
+} ids_element_t;
+
+typedef enum {
+    FLOWBIT_SET,
+    FLOWBIT_UNSET,
+    FLOWBIT_TOGGLE,
+    FLOWBIT_ISSET,
+    FLOWBIT_ISNOTSET
+} ids_flowbit_op_type_t;
+
+typedef struct {
+    uint8_t op;            // ids_flowbit_op_type_t
+    uint16_t bit;
+} ids_flowbit_op_t;
+
+typedef enum {
+    IDS_COMPARE_NONE,
+    IDS_COMPARE_EQUAL,
+    IDS_COMPARE_LESS,
+    IDS_COMPARE_GREATER,
+    IDS_COMPARE_BETWEEN    // exclusive bounds, as in dsize:10<>20
+} ids_compare_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint32_t low;
+    uint32_t high;
+} ids_compare_t;
+
+typedef enum {
+    IDS_FLAGS_EXACT,       // flags:SA
+    IDS_FLAGS_ALL,         // flags:+S
+    IDS_FLAGS_ANY,         // flags:*SF
+    IDS_FLAGS_NONE         // flags:!R
+} ids_flags_mode_t;
+
+typedef struct {
+    uint32_t sid;
+    uint32_t rev;
+    uint32_t msg;          // string offsets in the byte pool, UINT32_MAX when absent
+    uint32_t classtype;
+    uint8_t priority;      // 0 when absent
+    uint8_t ip_proto;      // 0 matches any IP packet
+    uint8_t app_protocol;  // APP_PROTOCOL_UNKNOWN when the header names a transport
+    uint8_t bidirectional;
+    uint8_t flow;          // IDS_FLOW_* options
+    uint8_t noalert;
+    uint8_t has_flags;
+    uint8_t flags_mode;    // ids_flags_mode_t
+    uint8_t flags;
+    uint8_t flags_ignore;
+    ids_compare_t dsize;
+    ids_compare_t itype;
+    ids_compare_t icode;
+    ids_range_t src_addr;
+    ids_range_t dst_addr;
+    ids_range_t src_port;
+    ids_range_t dst_port;
+    ids_range_t elements;
+    ids_range_t flowbits;
+} ids_rule_t;
+
+// Parsed and compiled rules file. Rule parts live in typed pools (stream
+// buffers used as growable arrays) that are addressed by index.
+typedef struct {
+    char *filename;
+    stream_buffer_t rules;         // ids_rule_t
+    stream_buffer_t addr_items;    // ids_addr_item_t
+    stream_buffer_t port_items;    // ids_port_item_t
+    stream_buffer_t elements;      // ids_element_t
+    stream_buffer_t flowbit_ops;   // ids_flowbit_op_t
+    stream_buffer_t bytes;         // content bytes and NUL-terminated strings
+    uint32_t flowbit_names[IDS_MAX_FLOWBITS];
+    uint32_t flowbit_count;
+    uint32_t rule_count;
+    int needs_app_protocol;
+
+    // Prefilter: one literal per rule that has a non-negated content
+    ac_matcher_t prefilter;
+    stream_buffer_t pattern_rules; // uint32_t rule index per prefilter pattern
+    stream_buffer_t unfiltered;    // uint32_t rules without a prefilter literal
+} ids_bind_t;
+
+static ids_rule_t *Rules(const ids_bind_t *bind) {
+    return (ids_rule_t *)(void *)bind->rules.data;
+}
+
+static ids_element_t *Elements(const ids_bind_t *bind) {
+    return (ids_element_t *)(void *)bind->elements.data;
+}
+
+static uint32_t PoolCount(const stream_buffer_t *pool, size_t item_size) {
+    return (uint32_t)(pool->len / item_size);
+}
+
+static int PoolAppend(stream_buffer_t *pool, const void *item, size_t item_size) {
+    return StreamBufferAppend(pool, (const uint8_t *)item, item_size, UINT32_MAX);
+}
+
+// Add a NUL-terminated string to the byte pool; returns its offset or UINT32_MAX
+static uint32_t PoolString(ids_bind_t *bind, const char *text, size_t len) {
+    uint32_t offset = (uint32_t)bind->bytes.len;
+    if (!StreamBufferAppend(&bind->bytes, (const uint8_t *)text, len, UINT32_MAX) ||
+        !StreamBufferAppend(&bind->bytes, (const uint8_t *)"", 1, UINT32_MAX)) {
+        return UINT32_MAX;
+    }
+    return offset;
+}
+
+// ---------------------------------------------------------------------------
+// Rule parsing
+// ---------------------------------------------------------------------------
+
+static char *SkipSpace(char *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+static void TrimEnd(char *start) {
+    size_t len = strlen(start);
+    while (len && (start[len - 1] == ' ' || start[len - 1] == '\t' || start[len - 1] == '\r' ||
+                   start[len - 1] == '\n')) {
+        start[--len] = '\0';
+    }
+}
+
+static int ParseUnsigned(const char *text, uint32_t *value) {
+    char *end;
+    text = SkipSpace((char *)text);
+    if (*text < '0' || *text > '9') {
+        return 0;
+    }
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (parsed > UINT32_MAX || *SkipSpace(end)) {
+        return 0;
+    }
+    *value = (uint32_t)parsed;
+    return 1;
+}
+
+static int ParseSigned(const char *text, int32_t *value) {
+    char *end;
+    text = SkipSpace((char *)text);
+    long parsed = strtol(text, &end, 10);
+    if (end == text || parsed < INT32_MIN || parsed > INT32_MAX || *SkipSpace(end)) {
+        return 0;
+    }
+    *value = (int32_t)parsed;
+    return 1;
+}
+
+// Default values of the address and port variables of suricata.yaml
+static const char *ExpandVariable(const char *name, int is_port) {
+    if (is_port) {
+        return "any";
+    }
+    if (strcmp(name, "HOME_NET") == 0) {
+        return "[10.0.0.0/8,172.16.0.0/12,192.168.0.0/16]";
+    }
+    if (strcmp(name, "EXTERNAL_NET") == 0) {
+        return "!$HOME_NET";
+    }
+    return "any";
+}
+
+// Split a list body at top-level commas; calls back for each item
+typedef const char *(*ids_list_item_t)(ids_bind_t *bind, const char *text, size_t len, int negated, int depth);
+
+static const char *ParseList(ids_bind_t *bind, const char *text, size_t len, int negated, int depth,
+                             ids_list_item_t parse_item) {
+    size_t start = 0;
+    int nesting = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i < len && text[i] == '[') {
+            nesting++;
+        } else if (i < len && text[i] == ']') {
+            nesting--;
+        } else if (i == len || (text[i] == ',' && nesting == 0)) {
+            const char *error = parse_item(bind, text + start, i - start, negated, depth);
+            if (error) {
+                return error;
+            }
+            start = i + 1;
+        }
+    }
+    return nesting ? "Unbalanced [ ] in address or port list" : NULL;
+}
+
+// Shared handling of negation, lists and variables. Returns 1 when the
+// specification was a list or variable (already parsed), 0 for a plain item.
+static int ParseSpecStructure(ids_bind_t *bind, const char **text, size_t *len, int *negated, int depth, int is_port,
+                              ids_list_item_t parse_item, const char **error) {
+    while (*len && (**text == ' ' || **text == '\t')) {
+        (*text)++;
+        (*len)--;
+    }
+    while (*len && ((*text)[*len - 1] == ' ' || (*text)[*len - 1] == '\t')) {
+        (*len)--;
+    }
+    while (*len && **text == '!') {
+        *negated = !*negated;
+        (*text)++;
+        (*len)--;
+    }
+    if (!*len) {
+        *error = "Empty address or port";
+        return 1;
+    }
+    if (**text == '[') {
+        if ((*text)[*len - 1] != ']') {
+            *error = "Unbalanced [ ] in address or port list";
+            return 1;
+        }
+        *error = ParseList(bind, *text + 1, *len - 2, *negated, depth, parse_item);
+        return 1;
+    }
+    if (**text == '$') {
+        char name[64];
+        if (*len - 1 >= sizeof(name) || depth >= IDS_MAX_VARIABLE_DEPTH) {
+            *error = "Invalid variable in address or port";
+            return 1;
+        }
+        memcpy(name, *text + 1, *len - 1);
+        name[*len - 1] = '\0';
+        const char *value = ExpandVariable(name, is_port);
+        *error = parse_item(bind, value, strlen(value), *negated, depth + 1);
+        return 1;
+    }
+    return 0;
+}
+
+static int ParseIpv4(const char *text, uint8_t *addr) {
+    for (int i = 0; i < 4; i++) {
+        if (*text < '0' || *text > '9') {
+            return 0;
+        }
+        uint32_t octet = 0;
+        int digits = 0;
+        while (*text >= '0' && *text <= '9' && digits < 4) {
+            octet = octet * 10 + (uint32_t)(*text++ - '0');
+            digits++;
+        }
+        if (octet > 255 || *text != (i == 3 ? '\0' : '.')) {
+            return 0;
+        }
+        addr[i] = (uint8_t)octet;
+        text++;
+    }
+    return 1;
+}
+
+// Hex groups with at most one "::"; an embedded IPv4 tail is not supported
+static int ParseIpv6(const char *text, uint8_t *addr) {
+    uint16_t groups[8];
+    int count = 0;
+    int gap = -1;
+    if (text[0] == ':' && text[1] == ':') {
+        gap = 0;
+        text += 2;
+    }
+    while (*text) {
+        uint32_t value = 0;
+        int digits = 0;
+        for (;; text++, digits++) {
+            char c = (char)(*text | 0x20);
+            int digit = (*text >= '0' && *text <= '9') ? *text - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+            if (digit < 0) {
+                break;
+            }
+            value = value * 16 + (uint32_t)digit;
+        }
+        if (!digits || digits > 4 || count == 8) {
+            return 0;
+        }
+        groups[count++] = (uint16_t)value;
+        if (!*text) {
+            break;
+        }
+        if (*text != ':') {
+            return 0;
+        }
+        text++;
+        if (*text == ':') {
+            if (gap >= 0) {
+                return 0;
+            }
+            gap = count;
+            text++;
+        } else if (!*text) {
+            return 0;
+        }
+    }
+    if (gap < 0 ? count != 8 : count == 8) {
+        return 0;
+    }
+    memset(addr, 0, 16);
+    int tail = gap < 0 ? 0 : count - gap;
+    for (int i = 0; i < count; i++) {
+        int slot = (gap < 0 || i < gap) ? i : 8 - tail + (i - gap);
+        addr[slot * 2] = (uint8_t)(groups[i] >> 8);
+        addr[slot * 2 + 1] = (uint8_t)groups[i];
+    }
+    return 1;
+}
+
+static const char *ParseAddrItem(ids_bind_t *bind, const char *text, size_t len, int negated, int depth) {
+    const char *error = NULL;
+    if (ParseSpecStructure(bind, &text, &len, &negated, depth, 0, ParseAddrItem, &error)) {
+        return error;
+    }
+    ids_addr_item_t item;
+    memset(&item, 0, sizeof(item));
+    item.negated = (uint8_t)negated;
+    char buffer[64];
+    if (len >= sizeof(buffer)) {
+        return "Invalid address";
+    }
+    memcpy(buffer, text, len);
+    buffer[len] = '\0';
+    if (strcmp(buffer, "any") == 0) {
+        // A positive "any" inside a list still has to count as an entry
+        return PoolAppend(&bind->addr_items, &item, sizeof(item)) ? NULL : "Out of memory parsing rules";
+    }
+    char *slash = strchr(buffer, '/');
+    uint32_t prefix = UINT32_MAX;
+    if (slash) {
+        *slash = '\0';
+        if (!ParseUnsigned(slash + 1, &prefix)) {
+            return "Invalid address prefix length";
+        }
+    }
+    if (ParseIpv4(buffer, item.addr)) {
+        item.ip_version = 4;
+        prefix = prefix == UINT32_MAX ? 32 : prefix;
+        if (prefix > 32) {
+            return "Invalid address prefix length";
+        }
+    } else if (ParseIpv6(buffer, item.addr)) {
+        item.ip_version = 6;
+        prefix = prefix == UINT32_MAX ? 128 : prefix;
+        if (prefix > 128) {
+            return "Invalid address prefix length";
+        }
+    } else {
+        return "Invalid address";
+    }
+    item.prefix_len = (uint8_t)prefix;
+    return PoolAppend(&bind->addr_items, &item, sizeof(item)) ? NULL : "Out of memory parsing rules";
+}
+
+static const char *ParsePortItem(ids_bind_t *bind, const char *text, size_t len, int negated, int depth) {
+    const char *error = NULL;
+    if (ParseSpecStructure(bind, &text, &len, &negated, depth, 1, ParsePortItem, &error)) {
+        return error;
+    }
+    ids_port_item_t item;
+    item.negated = (uint8_t)negated;
+    item.low = 0;
+    item.high = 65535;
+    char buffer[32];
+    if (len >= sizeof(buffer)) {
+        return "Invalid port";
+    }
+    memcpy(buffer, text, len);
+    buffer[len] = '\0';
+    if (strcmp(buffer, "any") != 0) {
+        char *colon = strchr(buffer, ':');
+        uint32_t low = 0;
+        uint32_t high = 65535;
+        if (colon) {
+            *colon = '\0';
+            if ((buffer[0] && !ParseUnsigned(buffer, &low)) || (colon[1] && !ParseUnsigned(colon + 1, &high))) {
+                return "Invalid port range";
+            }
+        } else if (!ParseUnsigned(buffer, &low)) {
+            return "Invalid port";
+        } else {
+            high = low;
+        }
+        if (low > high || high > 65535) {
+            return "Invalid port range";
+        }
+        item.low = (uint16_t)low;
+        item.high = (uint16_t)high;
+    }
+    return PoolAppend(&bind->port_items, &item, sizeof(item)) ? NULL : "Out of memory parsing rules";
+}
+
+// Parse a specification into a range of pool entries. A plain "any" adds no
+// entry, so it matches everything.
+static const char *ParseSpec(ids_bind_t *bind, const char *text, int is_port, ids_range_t *range) {
+    stream_buffer_t *pool = is_port ? &bind->port_items : &bind->addr_items;
+    size_t item_size = is_port ? sizeof(ids_port_item_t) : sizeof(ids_addr_item_t);
+    range->first = PoolCount(pool, item_size);
+    if (strcmp(text, "any") != 0) {
+        const char *error = is_port ? ParsePortItem(bind, text, strlen(text), 0, 0)
+                                    : ParseAddrItem(bind, text, strlen(text), 0, 0);
+        if (error) {
+            return error;
+        }
+    }
+    range->count = PoolCount(pool, item_size) - range->first;
+    return NULL;
+}
+
+static const char *ParseProtocol(const char *name, ids_rule_t *rule) {
+    static const struct {
+        const char *name;
+        uint8_t ip_proto;
+    } transports[] = {{"ip", 0}, {"pkthdr", 0}, {"tcp", IPPROTO_NUM_TCP}, {"udp", IPPROTO_NUM_UDP},
+                      {"icmp", IPPROTO_NUM_ICMP}, {"icmpv6", IPPROTO_NUM_ICMPV6}};
+    for (size_t i = 0; i < sizeof(transports) / sizeof(transports[0]); i++) {
+        if (strcmp(name, transports[i].name) == 0) {
+            rule->ip_proto = transports[i].ip_proto;
+            return NULL;
+        }
+    }
+    // Application layer protocols as recognized by the payload classifier
+    const char *app_name = strcmp(name, "http1") == 0 ? "http" : name;
+    for (int i = APP_PROTOCOL_UNKNOWN + 1; i < APP_PROTOCOL_COUNT; i++) {
+        if (strcmp(app_name, app_protocol_names[i]) == 0) {
+            rule->app_protocol = (uint8_t)i;
+            return NULL;
+        }
+    }
+    return "Unsupported protocol in rule header";
+}
+
+// Decode a quoted content string with |hex| segments and \ escapes
+static const char *ParseContentBytes(ids_bind_t *bind, char *value, ids_element_t *element) {
+    value = SkipSpace(value);
+    if (*value == '!') {
+        element->negated = 1;
+        value = SkipSpace(value + 1);
+    }
+    if (*value != '"') {
+        return "content must be a quoted string";
+    }
+    value++;
+    element->data = (uint32_t)bind->bytes.len;
+    int hex = 0;
+    int high = -1;
+    for (;; value++) {
+        char c = *value;
+        if (!c) {
+            return "Unterminated content string";
+        }
+        if (c == '"' && !hex) {
+            break;
+        }
+        uint8_t byte;
+        if (c == '|') {
+            if (hex && high >= 0) {
+                return "Odd number of hex digits in content";
+            }
+            hex = !hex;
+            continue;
+        }
+        if (hex) {
+            if (c == ' ' || c == '\t') {
+                continue;
+            }
+            int digit = (c >= '0' && c <= '9') ? c - '0'
+                        : ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') ? (c | 0x20) - 'a' + 10
+                                                                    : -1;
+            if (digit < 0) {
+                return "Invalid hex digit in content";
+            }
+            if (high < 0) {
+                high = digit;
+                continue;
+            }
+            byte = (uint8_t)(high * 16 + digit);
+            high = -1;
+        } else if (c == '\\') {
+            value++;
+            if (!*value) {
+                return "Unterminated content string";
+            }
+            byte = (uint8_t)*value;
+        } else {
+            byte = (uint8_t)c;
+        }
+        if (!StreamBufferAppend(&bind->bytes, &byte, 1, UINT32_MAX)) {
+            return "Out of memory parsing rules";
+        }
+    }
+    if (*SkipSpace(value + 1)) {
+        return "Unexpected text after content string";
+    }
+    element->data_len = (uint32_t)(bind->bytes.len - element->data);
+    return element->data_len ? NULL : "Empty content";
+}
+
+// Strip quotes and \ escapes from an option value in place
+static char *Unquote(char *value) {
+    value = SkipSpace(value);
+    TrimEnd(value);
+    size_t len = strlen(value);
+    if (len < 2 || value[0] != '"' || value[len - 1] != '"') {
+        return value;
+    }
+    value[len - 1] = '\0';
+    char *out = value;
+    for (char *in = value + 1; *in; in++) {
+        if (*in == '\\' && in[1]) {
+            in++;
+        }
+        *out++ = *in;
+    }
+    *out = '\0';
+    return value;
+}
+
+static const char *ParsePcre(char *value, ids_element_t *element) {
+    value = SkipSpace(value);
+    TrimEnd(value);
+    if (*value == '!') {
+        element->negated = 1;
+        value = SkipSpace(value + 1);
+    }
+    size_t len = strlen(value);
+    if (len < 4 || value[0] != '"' || value[len - 1] != '"' || value[1] != '/') {
+        return "pcre must be a quoted /pattern/flags string";
+    }
+    // The pattern keeps its escapes: \; and \" are literal characters to the regex
+    char *pattern = value + 2;
+    char *close = strrchr(pattern, '/');
+    if (!close) {
+        return "pcre must be a quoted /pattern/flags string";
+    }
+    uint32_t flags = 0;
+    for (char *f = close + 1; f < value + len - 1; f++) {
+        switch (*f) {
+        case 'i': flags |= REGEX_NOCASE; break;
+        case 's': flags |= REGEX_DOTALL; break;
+        case 'm': flags |= REGEX_MULTILINE; break;
+        case 'x': flags |= REGEX_EXTENDED; break;
+        case 'A': flags |= REGEX_ANCHORED; break;
+        case 'E': flags |= REGEX_DOLLAR_ENDONLY; break;
+        case 'G': flags |= REGEX_UNGREEDY; break;
+        case 'R': element->relative = 1; break;
+        case 'B':
+        case 'O':
+            // Raw bytes and match limit override do not change packet matching
+            break;
+        default:
+            return "Unsupported pcre modifier";
+        }
+    }
+    return RegexCompile(pattern, (size_t)(close - pattern), flags, &element->regex);
+}
+
+// dsize, itype and icode: N, <N, >N or N<>M
+static int ParseCompare(const char *value, ids_compare_t *compare) {
+    value = SkipSpace((char *)value);
+    if (*value == '<' || *value == '>') {
+        compare->op = *value == '<' ? IDS_COMPARE_LESS : IDS_COMPARE_GREATER;
+        return ParseUnsigned(value + 1, &compare->low);
+    }
+    const char *between = strstr(value, "<>");
+    if (between) {
+        char low[32];
+        size_t low_len = (size_t)(between - value);
+        if (low_len >= sizeof(low)) {
+            return 0;
+        }
+        memcpy(low, value, low_len);
+        low[low_len] = '\0';
+        compare->op = IDS_COMPARE_BETWEEN;
+        return ParseUnsigned(low, &compare->low) && ParseUnsigned(between + 2, &compare->high) &&
+               compare->low < compare->high;
+    }
+    compare->op = IDS_COMPARE_EQUAL;
+    return ParseUnsigned(value, &compare->low);
+}
+
+static int CompareMatches(const ids_compare_t *compare, uint32_t value) {
+    switch (compare->op) {
+    case IDS_COMPARE_EQUAL:
+        return value == compare->low;
+    case IDS_COMPARE_LESS:
+        return value < compare->low;
+    case IDS_COMPARE_GREATER:
+        return value > compare->low;
+    case IDS_COMPARE_BETWEEN:
+        return value > compare->low && value < compare->high;
+    default:
+        return 1;
+    }
+}
+
+static const char *ParseFlow(char *value, ids_rule_t *rule) {
+    for (char *item = strtok(value, ","); item; item = strtok(NULL, ",")) {
+        item = SkipSpace(item);
+        TrimEnd(item);
+        if (strcmp(item, "to_server") == 0 || strcmp(item, "from_client") == 0) {
+            rule->flow |= IDS_FLOW_TO_SERVER;
+        } else if (strcmp(item, "to_client") == 0 || strcmp(item, "from_server") == 0) {
+            rule->flow |= IDS_FLOW_TO_CLIENT;
+        } else if (strcmp(item, "established") == 0) {
+            rule->flow |= IDS_FLOW_ESTABLISHED;
+        } else if (strcmp(item, "not_established") == 0) {
+            rule->flow |= IDS_FLOW_NOT_ESTABLISHED;
+        } else if (strcmp(item, "stateless") != 0 && strcmp(item, "no_stream") != 0 &&
+                   strcmp(item, "only_stream") != 0 && strcmp(item, "no_frag") != 0 &&
+                   strcmp(item, "only_frag") != 0) {
+            // Rules are matched per packet, so the stream options make no difference
+            return "Unsupported flow option";
+        }
+    }
+    if ((rule->flow & IDS_FLOW_TO_SERVER) && (rule->flow & IDS_FLOW_TO_CLIENT)) {
+        return "flow cannot be both to_server and to_client";
+    }
+    return NULL;
+}
+
+static const char *ParseTcpFlags(char *value, ids_rule_t *rule) {
+    static const char flag_chars[] = "FSRPAUEC";   // bit order of the TCP flags byte
+    char *comma = strchr(value, ',');
+    if (comma) {
+        *comma = '\0';
+        for (char *c = SkipSpace(comma + 1); *c && *c != ' '; c++) {
+            const char *bit = *c == '1' ? strchr(flag_chars, 'C') : *c == '2' ? strchr(flag_chars, 'E')
+                                                                              : strchr(flag_chars, *c);
+            if (!bit) {
+                return "Invalid flags mask";
+            }
+            rule->flags_ignore |= (uint8_t)(1u << (bit - flag_chars));
+        }
+    }
+    rule->has_flags = 1;
+    rule->flags_mode = IDS_FLAGS_EXACT;
+    for (char *c = SkipSpace(value); *c && *c != ' '; c++) {
+        if (*c == '+' || *c == '*' || *c == '!') {
+            rule->flags_mode = *c == '+' ? IDS_FLAGS_ALL : *c == '*' ? IDS_FLAGS_ANY : IDS_FLAGS_NONE;
+            continue;
+        }
+        if (*c == '0') {
+            continue;
+        }
+        const char *bit = *c == '1' ? strchr(flag_chars, 'C') : *c == '2' ? strchr(flag_chars, 'E')
+                                                                          : strchr(flag_chars, *c);
+        if (!bit || !*c) {
+            return "Invalid TCP flags";
+        }
+        rule->flags |= (uint8_t)(1u << (bit - flag_chars));
+    }
+    return NULL;
+}
+
+static const char *ParseFlowbits(ids_bind_t *bind, char *value, ids_rule_t *rule) {
+    value = SkipSpace(value);
+    TrimEnd(value);
+    if (strcmp(value, "noalert") == 0) {
+        rule->noalert = 1;
+        return NULL;
+    }
+    char *comma = strchr(value, ',');
+    if (!comma) {
+        return "flowbits needs an operation and a name";
+    }
+    *comma = '\0';
+    TrimEnd(value);
+    char *name = SkipSpace(comma + 1);
+    static const char *const ops[] = {"set", "unset", "toggle", "isset", "isnotset"};
+    ids_flowbit_op_t op;
+    size_t i = 0;
+    while (i < sizeof(ops) / sizeof(ops[0]) && strcmp(value, ops[i]) != 0) {
+        i++;
+    }
+    if (i == sizeof(ops) / sizeof(ops[0])) {
+        return "Unsupported flowbits operation";
+    }
+    if (strpbrk(name, "|&")) {
+        return "flowbits expressions are not supported";
+    }
+    op.op = (uint8_t)i;
+    uint32_t bit = 0;
+    while (bit < bind->flowbit_count && strcmp((const char *)bind->bytes.data + bind->flowbit_names[bit], name) != 0) {
+        bit++;
+    }
+    if (bit == bind->flowbit_count) {
+        if (bind->flowbit_count >= IDS_MAX_FLOWBITS) {
+            return "Too many flowbit names";
+        }
+        uint32_t offset = PoolString(bind, name, strlen(name));
+        if (offset == UINT32_MAX) {
+            return "Out of memory parsing rules";
+        }
+        bind->flowbit_names[bind->flowbit_count++] = offset;
+    }
+    op.bit = (uint16_t)bit;
+    if (rule->flowbits.count == 0) {
+        rule->flowbits.first = PoolCount(&bind->flowbit_ops, sizeof(ids_flowbit_op_t));
+    }
+    rule->flowbits.count++;
+    return PoolAppend(&bind->flowbit_ops, &op, sizeof(op)) ? NULL : "Out of memory parsing rules";
+}
+
+// Keywords that only describe the alert or affect logging
+static int IsIgnoredKeyword(const char *name) {
+    static const char *const ignored[] = {"gid", "reference", "metadata", "target", "rawbytes", "tag"};
+    for (size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); i++) {
+        if (strcmp(name, ignored[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Content modifiers apply to the most recent content
+static const char *ParseContentModifier(const char *name, char *value, ids_element_t *element) {
+    if (!element || element->type != IDS_ELEMENT_CONTENT) {
+        return "Content modifier without a preceding content";
+    }
+    if (strcmp(name, "nocase") == 0) {
+        element->nocase = 1;
+        return NULL;
+    }
+    if (strcmp(name, "fast_pattern") == 0) {
+        element->fast_pattern = 1;
+        return NULL;
+    }
+    if (strcmp(name, "startswith") == 0) {
+        element->has_offset = 1;
+        element->offset = 0;
+        element->has_depth = 1;
+        element->depth = element->data_len;
+        return element->relative ? "startswith cannot be combined with distance or within" : NULL;
+    }
+    int relative = strcmp(name, "distance") == 0 || strcmp(name, "within") == 0;
+    if ((relative && element->has_offset && !element->relative) ||
+        (!relative && element->relative && (element->has_offset || element->has_depth))) {
+        return "offset and depth cannot be combined with distance and within";
+    }
+    element->relative = (uint8_t)(element->relative | relative);
+    if (strcmp(name, "offset") == 0 || strcmp(name, "distance") == 0) {
+        element->has_offset = 1;
+        if (!ParseSigned(value, &element->offset) || (!relative && element->offset < 0)) {
+            return "Invalid content offset";
+        }
+        return NULL;
+    }
+    element->has_depth = 1;
+    if (!ParseUnsigned(value, &element->depth) || element->depth < element->data_len) {
+        return "Invalid content depth";
+    }
+    return NULL;
+}
+
+static int IsContentModifier(const char *name) {
+    static const char *const modifiers[] = {"nocase", "offset", "depth", "distance", "within", "fast_pattern",
+                                            "startswith"};
+    for (size_t i = 0; i < sizeof(modifiers) / sizeof(modifiers[0]); i++) {
+        if (strcmp(name, modifiers[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const char *ParseOption(ids_bind_t *bind, ids_rule_t *rule, char *name, char *value, int *has_sid) {
+    ids_element_t *last = rule->elements.count ? &Elements(bind)[rule->elements.first + rule->elements.count - 1]
+                                               : NULL;
+    if (strcmp(name, "msg") == 0 || strcmp(name, "classtype") == 0) {
+        char *text = Unquote(value);
+        uint32_t offset = PoolString(bind, text, strlen(text));
+        if (offset == UINT32_MAX) {
+            return "Out of memory parsing rules";
+        }
+        *(name[0] == 'm' ? &rule->msg : &rule->classtype) = offset;
+        return NULL;
+    }
+    if (strcmp(name, "sid") == 0) {
+        *has_sid = 1;
+        return ParseUnsigned(value, &rule->sid) ? NULL : "Invalid sid";
+    }
+    if (strcmp(name, "rev") == 0) {
+        return ParseUnsigned(value, &rule->rev) ? NULL : "Invalid rev";
+    }
+    if (strcmp(name, "priority") == 0) {
+        uint32_t priority;
+        if (!ParseUnsigned(value, &priority) || priority < 1 || priority > 255) {
+            return "Invalid priority";
+        }
+        rule->priority = (uint8_t)priority;
+        return NULL;
+    }
+    if (strcmp(name, "content") == 0 || strcmp(name, "pcre") == 0) {
+        if (rule->elements.count >= IDS_MAX_ELEMENTS) {
+            return "Too many content and pcre matches in rule";
+        }
+        ids_element_t element;
+        memset(&element, 0, sizeof(element));
+        const char *error;
+        if (name[0] == 'c') {
+            element.type = IDS_ELEMENT_CONTENT;
+            error = ParseContentBytes(bind, value, &element);
+        } else {
+            element.type = IDS_ELEMENT_PCRE;
+            error = ParsePcre(value, &element);
+        }
+        if (!error && !PoolAppend(&bind->elements, &element, sizeof(element))) {
+            error = "Out of memory parsing rules";
+        }
+        if (error) {
+            RegexFree(element.regex);
+            return error;
+        }
+        if (rule->elements.count == 0) {
+            rule->elements.first = PoolCount(&bind->elements, sizeof(ids_element_t)) - 1;
+        }
+        rule->elements.count++;
+        return NULL;
+    }
+    if (IsContentModifier(name)) {
+        return ParseContentModifier(name, value, last);
+    }
+    if (strcmp(name, "flow") == 0) {
+        return ParseFlow(value, rule);
+    }
+    if (strcmp(name, "flowbits") == 0) {
+        return ParseFlowbits(bind, value, rule);
+    }
+    if (strcmp(name, "dsize") == 0) {
+        return ParseCompare(value, &rule->dsize) ? NULL : "Invalid dsize";
+    }
+    if (strcmp(name, "itype") == 0) {
+        return ParseCompare(value, &rule->itype) ? NULL : "Invalid itype";
+    }
+    if (strcmp(name, "icode") == 0) {
+        return ParseCompare(value, &rule->icode) ? NULL : "Invalid icode";
+    }
+    if (strcmp(name, "flags") == 0) {
+        return ParseTcpFlags(value, rule);
+    }
+    if (IsIgnoredKeyword(name)) {
+        return NULL;
+    }
+    return "Unsupported rule keyword";
+}
+
+// Split the option list at semicolons outside quoted strings
+static const char *ParseOptions(ids_bind_t *bind, ids_rule_t *rule, char *options) {
+    int has_sid = 0;
+    char *start = options;
+    int quoted = 0;
+    for (char *p = options;; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+            continue;
+        }
+        if (*p == '"') {
+            quoted = !quoted;
+            continue;
+        }
+        if (*p && (*p != ';' || quoted)) {
+            continue;
+        }
+        int at_end = !*p;
+        *p = '\0';
+        char *name = SkipSpace(start);
+        if (*name) {
+            char *value = name;
+            while (*value && *value != ':') {
+                value++;
+            }
+            if (*value) {
+                *value++ = '\0';
+            }
+            TrimEnd(name);
+            const char *error = ParseOption(bind, rule, name, value, &has_sid);
+            if (error) {
+                return error;
+            }
+        }
+        if (at_end) {
+            break;
+        }
+        start = p + 1;
+    }
+    if (quoted) {
+        return "Unterminated quoted string in rule options";
+    }
+    return has_sid ? NULL : "Rule without sid";
+}
+
+static const char *ParseRule(ids_bind_t *bind, char *text, ids_rule_t *rule) {
+    memset(rule, 0, sizeof(ids_rule_t));
+    rule->msg = UINT32_MAX;
+    rule->classtype = UINT32_MAX;
+
+    // action proto src_addr src_port direction dst_addr dst_port (options)
+    char *fields[7];
+    char *cursor = text;
+    for (int i = 0; i < 7; i++) {
+        cursor = SkipSpace(cursor);
+        if (!*cursor || *cursor == '(') {
+            return "Incomplete rule header";
+        }
+        fields[i] = cursor;
+        int nesting = 0;
+        while (*cursor && (nesting || (*cursor != ' ' && *cursor != '\t' && *cursor != '('))) {
+            nesting += *cursor == '[' ? 1 : *cursor == ']' ? -1 : 0;
+            cursor++;
+        }
+        if (*cursor == '(' || !*cursor) {
+            // The option list may follow the last field without a space
+            if (i < 6 || !*cursor) {
+                return "Incomplete rule header";
+            }
+            memmove(cursor + 1, cursor, strlen(cursor) + 1);
+        }
+        *cursor++ = '\0';
+    }
+    cursor = SkipSpace(cursor);
+    char *close = strrchr(cursor, ')');
+    if (*cursor != '(' || !close || *SkipSpace(close + 1)) {
+        return "Rule options must be enclosed in ( )";
+    }
+    *close = '\0';
+
+    static const char *const actions[] = {"alert", "drop", "reject", "rejectsrc", "rejectdst", "rejectboth",
+                                          "sdrop", "log"};
+    size_t action = 0;
+    while (action < sizeof(actions) / sizeof(actions[0]) && strcmp(fields[0], actions[action]) != 0) {
+        action++;
+    }
+    if (action == sizeof(actions) / sizeof(actions[0])) {
+        return "Unsupported rule action";
+    }
+    const char *error = ParseProtocol(fields[1], rule);
+    if (!error) {
+        error = ParseSpec(bind, fields[2], 0, &rule->src_addr);
+    }
+    if (!error) {
+        error = ParseSpec(bind, fields[3], 1, &rule->src_port);
+    }
+    if (!error && strcmp(fields[4], "->") != 0 && strcmp(fields[4], "<>") != 0) {
+        error = "Rule direction must be -> or <>";
+    }
+    rule->bidirectional = fields[4][0] == '<';
+    if (!error) {
+        error = ParseSpec(bind, fields[5], 0, &rule->dst_addr);
+    }
+    if (!error) {
+        error = ParseSpec(bind, fields[6], 1, &rule->dst_port);
+    }
+    if (!error) {
+        error = ParseOptions(bind, rule, cursor + 1);
+    }
+    if (error) {
+        return error;
+    }
+
+    // pcre matches report where they end only when a relative match follows
+    ids_element_t *elements = Elements(bind) + rule->elements.first;
+    for (uint32_t i = 0; i + 1 < rule->elements.count; i++) {
+        elements[i].need_end = elements[i + 1].relative;
+    }
+    return NULL;
+}
+
+// Drop the pool entries a rule that failed to parse left behind
+static void DiscardRule(ids_bind_t *bind, const size_t marks[5]) {
+    ids_element_t *elements = Elements(bind);
+    for (uint32_t i = (uint32_t)(marks[2] / sizeof(ids_element_t)); i < PoolCount(&bind->elements, sizeof(ids_element_t));
+         i++) {
+        RegexFree(elements[i].regex);
+    }
+    bind->addr_items.len = marks[0];
+    bind->port_items.len = marks[1];
+    bind->elements.len = marks[2];
+    bind->flowbit_ops.len = marks[3];
+    // Flowbit names may have been interned; the byte pool keeps its strings
+    (void)marks[4];
+}
+
+static const char *AddRule(ids_bind_t *bind, char *text, int strict) {
+    size_t marks[5] = {bind->addr_items.len, bind->port_items.len, bind->elements.len, bind->flowbit_ops.len,
+                       bind->bytes.len};
+    ids_rule_t rule;
+    const char *error = ParseRule(bind, text, &rule);
+    if (error) {
+        DiscardRule(bind, marks);
+        return strict ? error : NULL;
+    }
+    if (rule.app_protocol != APP_PROTOCOL_UNKNOWN) {
+        bind->needs_app_protocol = 1;
+    }
+    if (!PoolAppend(&bind->rules, &rule, sizeof(rule))) {
+        DiscardRule(bind, marks);
+        return "Out of memory parsing rules";
+    }
+    bind->rule_count++;
+    return NULL;
+}
+
+// Choose each rule's prefilter literal: the content marked fast_pattern, or
+// else the longest non-negated content
+static int BuildPrefilter(ids_bind_t *bind) {
+    AcInit(&bind->prefilter);
+    ids_rule_t *rules = Rules(bind);
+    ids_element_t *elements = Elements(bind);
+    for (uint32_t r = 0; r < bind->rule_count; r++) {
+        const ids_element_t *best = NULL;
+        for (uint32_t i = 0; i < rules[r].elements.count; i++) {
+            const ids_element_t *element = &elements[rules[r].elements.first + i];
+            if (element->type != IDS_ELEMENT_CONTENT || element->negated) {
+                continue;
+            }
+            if (!best || (element->fast_pattern && !best->fast_pattern) ||
+                (element->fast_pattern == best->fast_pattern && element->data_len > best->data_len)) {
+                best = element;
+            }
+        }
+        int ok;
+        if (best) {
+            ok = AcAddPattern(&bind->prefilter, bind->bytes.data + best->data, best->data_len) >= 0 &&
+                 PoolAppend(&bind->pattern_rules, &r, sizeof(r));
+        } else {
+            ok = PoolAppend(&bind->unfiltered, &r, sizeof(r));
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+    return AcCompile(&bind->prefilter);
+}
+
+static const char *LoadRules(ids_bind_t *bind, const char *path, int strict, char *error_text, size_t error_len) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return "Failed to open rules file";
+    }
+    stream_buffer_t rule_text;
+    memset(&rule_text, 0, sizeof(rule_text));
+    char chunk[4096];
+    uint32_t line_number = 0;
+    uint32_t rule_line = 0;
+    const char *error = NULL;
+    int line_start = 1;
+    while (!error && fgets(chunk, sizeof(chunk), file)) {
+        size_t len = strlen(chunk);
+        int line_end = len && chunk[len - 1] == '\n';
+        if (line_start) {
+            line_number++;
+            if (!rule_text.len) {
+                rule_line = line_number;
+            }
+        }
+        line_start = line_end;
+        while (len && (chunk[len - 1] == '\n' || chunk[len - 1] == '\r')) {
+            len--;
+        }
+        int continued = line_end && len && chunk[len - 1] == '\\';
+        if (continued) {
+            len--;
+        }
+        if (!StreamBufferAppend(&rule_text, (const uint8_t *)chunk, len, IDS_MAX_RULE_LENGTH)) {
+            error = "Rule too long in rules file";
+            break;
+        }
+        if (!line_end && !feof(file)) {
+            continue;
+        }
+        if (continued) {
+            continue;
+        }
+        if (!StreamBufferAppend(&rule_text, (const uint8_t *)"", 1, IDS_MAX_RULE_LENGTH + 1)) {
+            error = "Rule too long in rules file";
+            break;
+        }
+        char *text = SkipSpace((char *)rule_text.data);
+        if (*text && *text != '#') {
+            error = AddRule(bind, text, strict);
+        }
+        rule_text.len = 0;
+    }
+    if (!error && rule_text.len) {
+        // Continuation at end of file
+        if (StreamBufferAppend(&rule_text, (const uint8_t *)"", 1, IDS_MAX_RULE_LENGTH + 1)) {
+            char *text = SkipSpace((char *)rule_text.data);
+            if (*text && *text != '#') {
+                error = AddRule(bind, text, strict);
+            }
+        }
+    }
+    StreamBufferFree(&rule_text);
+    fclose(file);
+    if (error) {
+        snprintf(error_text, error_len, "%s (rules file line %u)", error, rule_line);
+        return error_text;
+    }
+    if (!bind->rule_count) {
+        return "No supported rules in rules file";
+    }
+    return BuildPrefilter(bind) ? NULL : "Out of memory parsing rules";
+}
+
+// ---------------------------------------------------------------------------
+// Matching
+// ---------------------------------------------------------------------------
+
+// Per-flow state, keyed by flow_key_t
+typedef struct {
+    uint8_t client;        // flow endpoint (0 = A, 1 = B) that opened the flow
+    uint8_t seen;          // bit per endpoint that has sent a packet
+    uint8_t syn_ack;
+    uint8_t established;
+    uint64_t flowbits[IDS_MAX_FLOWBITS / 64];
+} ids_flow_t;
+
+// Packet fields the rules look at
+typedef struct {
+    const packet_info_t *pkt;
+    const uint8_t *payload;
+    uint32_t payload_len;
+    ids_flow_t *flow;      // NULL when the packet has no flow
+    int to_server;
+    uint8_t app_protocol;
+} ids_packet_t;
+
+static int AddrItemMatches(const ids_addr_item_t *item, uint8_t ip_version, const uint8_t *addr) {
+    if (item->ip_version && item->ip_version != ip_version) {
+        return 0;
+    }
+    uint8_t full = (uint8_t)(item->prefix_len / 8);
+    if (memcmp(item->addr, addr, full) != 0) {
+        return 0;
+    }
+    uint8_t rest = item->prefix_len % 8;
+    if (!rest) {
+        return 1;
+    }
+    uint8_t mask = (uint8_t)(0xFF << (8 - rest));
+    return (item->addr[full] & mask) == (addr[full] & mask);
+}
+
+static int AddrMatches(const ids_bind_t *bind, ids_range_t range, uint8_t ip_version, const uint8_t *addr) {
+    const ids_addr_item_t *items = (const ids_addr_item_t *)(const void *)bind->addr_items.data + range.first;
+    int has_positive = 0;
+    int positive = 0;
+    for (uint32_t i = 0; i < range.count; i++) {
+        int matches = AddrItemMatches(&items[i], ip_version, addr);
+        if (items[i].negated) {
+            if (matches) {
+                return 0;
+            }
+        } else {
+            has_positive = 1;
+            positive |= matches;
+        }
+    }
+    return !has_positive || positive;
+}
+
+static int PortMatches(const ids_bind_t *bind, ids_range_t range, uint16_t port) {
+    const ids_port_item_t *items = (const ids_port_item_t *)(const void *)bind->port_items.data + range.first;
+    int has_positive = 0;
+    int positive = 0;
+    for (uint32_t i = 0; i < range.count; i++) {
+        int matches = port >= items[i].low && port <= items[i].high;
+        if (items[i].negated) {
+            if (matches) {
+                return 0;
+            }
+        } else {
+            has_positive = 1;
+            positive |= matches;
+        }
+    }
+    return !has_positive || positive;
+}
+
+static int HeaderMatches(const ids_bind_t *bind, const ids_rule_t *rule, const packet_info_t *pkt) {
+    if (rule->ip_proto && rule->ip_proto != pkt->ip_proto) {
+        return 0;
+    }
+    if (AddrMatches(bind, rule->src_addr, pkt->ip_version, pkt->src_ip) &&
+        PortMatches(bind, rule->src_port, pkt->src_port) &&
+        AddrMatches(bind, rule->dst_addr, pkt->ip_version, pkt->dst_ip) &&
+        PortMatches(bind, rule->dst_port, pkt->dst_port)) {
+        return 1;
+    }
+    return rule->bidirectional && AddrMatches(bind, rule->src_addr, pkt->ip_version, pkt->dst_ip) &&
+           PortMatches(bind, rule->src_port, pkt->dst_port) &&
+           AddrMatches(bind, rule->dst_addr, pkt->ip_version, pkt->src_ip) &&
+           PortMatches(bind, rule->dst_port, pkt->src_port);
+}
+
+static uint8_t FoldByte(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + 32) : c;
+}
+
+// First occurrence of needle in haystack[start, end), or SIZE_MAX
+static size_t FindBytes(const uint8_t *haystack, size_t start, size_t end, const uint8_t *needle, size_t len,
+                        int nocase) {
+    if (end < start || end - start < len) {
+        return SIZE_MAX;
+    }
+    size_t last = end - len;
+    if (!nocase) {
+        for (size_t pos = start; pos <= last;) {
+            const uint8_t *hit = (const uint8_t *)memchr(haystack + pos, needle[0], last - pos + 1);
+            if (!hit) {
+                return SIZE_MAX;
+            }
+            pos = (size_t)(hit - haystack);
+            if (memcmp(hit, needle, len) == 0) {
+                return pos;
+            }
+            pos++;
+        }
+        return SIZE_MAX;
+    }
+    uint8_t first = FoldByte(needle[0]);
+    for (size_t pos = start; pos <= last; pos++) {
+        if (FoldByte(haystack[pos]) != first) {
+            continue;
+        }
+        size_t i = 1;
+        while (i < len && FoldByte(haystack[pos + i]) == FoldByte(needle[i])) {
+            i++;
+        }
+        if (i == len) {
+            return pos;
+        }
+    }
+    return SIZE_MAX;
+}
+
+typedef struct {
+    const ids_bind_t *bind;
+    const ids_element_t *elements;
+    uint32_t count;
+    const uint8_t *payload;
+    size_t len;
+    uint32_t steps;
+} ids_match_context_t;
+
+// Match elements[index..] given the end of the previous match. Contents
+// followed by a relative match try each occurrence in their window, so a
+// later failure can move the earlier match forward.
+static int MatchElements(ids_match_context_t *context, uint32_t index, size_t prev_end) {
+    if (index == context->count) {
+        return 1;
+    }
+    if (++context->steps > IDS_MAX_MATCH_STEPS) {
+        return 0;
+    }
+    const ids_element_t *element = &context->elements[index];
+    size_t len = context->len;
+    if (element->type == IDS_ELEMENT_PCRE) {
+        size_t start = element->relative ? prev_end : 0;
+        regex_match_t match;
+        int found = RegexSearch(element->regex, context->payload + start, len - start,
+                                element->need_end ? &match : NULL);
+        if (found < 0) {
+            return 0;
+        }
+        if (element->negated) {
+            return !found && MatchElements(context, index + 1, prev_end);
+        }
+        return found && MatchElements(context, index + 1, element->need_end ? start + match.end[0] : prev_end);
+    }
+
+    // Content window [start, end)
+    int64_t start;
+    int64_t end = (int64_t)len;
+    if (element->relative) {
+        start = (int64_t)prev_end + element->offset;
+        if (element->has_depth) {
+            end = start + element->depth;
+        }
+    } else {
+        start = element->offset;
+        if (element->has_depth) {
+            end = start + element->depth;
+        }
+    }
+    start = start < 0 ? 0 : start;
+    end = end > (int64_t)len ? (int64_t)len : end;
+    const uint8_t *needle = context->bind->bytes.data + element->data;
+    size_t pos = start < end ? FindBytes(context->payload, (size_t)start, (size_t)end, needle, element->data_len,
+                                         element->nocase)
+                             : SIZE_MAX;
+    if (element->negated) {
+        return pos == SIZE_MAX && MatchElements(context, index + 1, prev_end);
+    }
+    int retry = index + 1 < context->count && context->elements[index + 1].relative;
+    while (pos != SIZE_MAX) {
+        if (MatchElements(context, index + 1, pos + element->data_len)) {
+            return 1;
+        }
+        if (!retry || context->steps > IDS_MAX_MATCH_STEPS) {
+            return 0;
+        }
+        pos = FindBytes(context->payload, pos + 1, (size_t)end, needle, element->data_len, element->nocase);
+    }
+    return 0;
+}
+
+static int FlowbitIsSet(const ids_flow_t *flow, uint16_t bit) {
+    return flow && ((flow->flowbits[bit / 64] >> (bit % 64)) & 1);
+}
+
+static int RuleMatches(const ids_bind_t *bind, const ids_rule_t *rule, const ids_packet_t *packet) {
+    const packet_info_t *pkt = packet->pkt;
+    if (!HeaderMatches(bind, rule, pkt)) {
+        return 0;
+    }
+    if (rule->app_protocol != APP_PROTOCOL_UNKNOWN && rule->app_protocol != packet->app_protocol) {
+        return 0;
+    }
+    if (rule->flow) {
+        int established = packet->flow && packet->flow->established;
+        if (((rule->flow & IDS_FLOW_TO_SERVER) && !packet->to_server) ||
+            ((rule->flow & IDS_FLOW_TO_CLIENT) && packet->to_server) ||
+            ((rule->flow & IDS_FLOW_ESTABLISHED) && !established) ||
+            ((rule->flow & IDS_FLOW_NOT_ESTABLISHED) && established)) {
+            return 0;
+        }
+    }
+    if (rule->dsize.op && !CompareMatches(&rule->dsize, packet->payload_len)) {
+        return 0;
+    }
+    if (rule->itype.op || rule->icode.op) {
+        int icmp = (pkt->ip_proto == IPPROTO_NUM_ICMP || pkt->ip_proto == IPPROTO_NUM_ICMPV6) && pkt->l4 &&
+                   pkt->l4_len >= 2;
+        if (!icmp || !CompareMatches(&rule->itype, pkt->l4[0]) || !CompareMatches(&rule->icode, pkt->l4[1])) {
+            return 0;
+        }
+    }
+    if (rule->has_flags) {
+        if (pkt->ip_proto != IPPROTO_NUM_TCP) {
+            return 0;
+        }
+        uint8_t flags = (uint8_t)(pkt->tcp_flags & ~rule->flags_ignore);
+        int ok;
+        switch (rule->flags_mode) {
+        case IDS_FLAGS_ALL:
+            ok = (flags & rule->flags) == rule->flags;
+            break;
+        case IDS_FLAGS_ANY:
+            ok = (flags & rule->flags) != 0;
+            break;
+        case IDS_FLAGS_NONE:
+            ok = (flags & rule->flags) == 0;
+            break;
+        default:
+            ok = flags == rule->flags;
+            break;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+    const ids_flowbit_op_t *ops = (const ids_flowbit_op_t *)(const void *)bind->flowbit_ops.data + rule->flowbits.first;
+    for (uint32_t i = 0; i < rule->flowbits.count; i++) {
+        if ((ops[i].op == FLOWBIT_ISSET && !FlowbitIsSet(packet->flow, ops[i].bit)) ||
+            (ops[i].op == FLOWBIT_ISNOTSET && FlowbitIsSet(packet->flow, ops[i].bit))) {
+            return 0;
+        }
+    }
+    if (rule->elements.count) {
+        ids_match_context_t context;
+        context.bind = bind;
+        context.elements = Elements(bind) + rule->elements.first;
+        context.count = rule->elements.count;
+        context.payload = packet->payload;
+        context.len = packet->payload_len;
+        context.steps = 0;
+        if (!MatchElements(&context, 0, 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void ApplyFlowbits(const ids_bind_t *bind, const ids_rule_t *rule, ids_flow_t *flow) {
+    if (!flow) {
+        return;
+    }
+    const ids_flowbit_op_t *ops = (const ids_flowbit_op_t *)(const void *)bind->flowbit_ops.data + rule->flowbits.first;
+    for (uint32_t i = 0; i < rule->flowbits.count; i++) {
+        uint64_t bit = 1ULL << (ops[i].bit % 64);
+        uint64_t *word = &flow->flowbits[ops[i].bit / 64];
+        switch (ops[i].op) {
+        case FLOWBIT_SET:
+            *word |= bit;
+            break;
+        case FLOWBIT_UNSET:
+            *word &= ~bit;
+            break;
+        case FLOWBIT_TOGGLE:
+            *word ^= bit;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// pcap_alerts(path, rules_file)
+// ---------------------------------------------------------------------------
+
+enum {
+    ALERTS_COL_TIMESTAMP,
+    ALERTS_COL_SID,
+    ALERTS_COL_REV,
+    ALERTS_COL_MSG,
+    ALERTS_COL_CLASSTYPE,
+    ALERTS_COL_PRIORITY,
+    ALERTS_COL_SRC_IP,
+    ALERTS_COL_SRC_PORT,
+    ALERTS_COL_DST_IP,
+    ALERTS_COL_DST_PORT,
+    ALERTS_COL_IP_PROTO,
+    ALERTS_COL_COUNT
+};
+
+typedef struct {
+    const ids_bind_t *bind;
+    pcap_source_t *source;
+    hash_map_t flows;             // flow_key_t -> ids_flow_t
+    app_classifier_t classifier;
+    uint32_t *stamps;             // per rule: generation it was last marked a candidate
+    uint32_t generation;
+    uint32_t *candidates;         // prefilter hits of the current packet
+    uint32_t candidate_count;
+
+    // Alerts of the current packet not yet emitted
+    uint32_t *alerts;
+    uint32_t alert_count;
+    uint32_t alert_next;
+    uint64_t timestamp_ns;
+    char src_ip[64];
+    char dst_ip[64];
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t ip_proto;
+} alerts_state_t;
+
+static void AlertsBindDataFree(void *data) {
+    ids_bind_t *bind = (ids_bind_t *)data;
+    if (!bind) {
+        return;
+    }
+    ids_element_t *elements = Elements(bind);
+    for (uint32_t i = 0; i < PoolCount(&bind->elements, sizeof(ids_element_t)); i++) {
+        RegexFree(elements[i].regex);
+    }
+    StreamBufferFree(&bind->rules);
+    StreamBufferFree(&bind->addr_items);
+    StreamBufferFree(&bind->port_items);
+    StreamBufferFree(&bind->elements);
+    StreamBufferFree(&bind->flowbit_ops);
+    StreamBufferFree(&bind->bytes);
+    StreamBufferFree(&bind->pattern_rules);
+    StreamBufferFree(&bind->unfiltered);
+    AcDestroy(&bind->prefilter);
+    duckdb_free(bind->filename);
+    duckdb_free(bind);
+}
+
+static void AlertsInitDataFree(void *data) {
+    alerts_state_t *state = (alerts_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        HashMapDestroy(&state->flows);
+        AppClassifierDestroy(&state->classifier);
+        duckdb_free(state->stamps);
+        duckdb_free(state->candidates);
+        duckdb_free(state->alerts);
+        duckdb_free(state);
+    }
+}
+
+static void AlertsBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    ids_bind_t *bind = (ids_bind_t *)duckdb_malloc(sizeof(ids_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    memset(bind, 0, sizeof(ids_bind_t));
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, AlertsBindDataFree);
+
+    duckdb_value rules_value = duckdb_bind_get_parameter(info, 1);
+    char *rules_path = duckdb_is_null_value(rules_value) ? NULL : duckdb_get_varchar(rules_value);
+    duckdb_destroy_value(&rules_value);
+    if (!rules_path) {
+        duckdb_bind_set_error(info, "Rules file path cannot be NULL");
+        return;
+    }
+    int strict = 0;
+    duckdb_value strict_value = duckdb_bind_get_named_parameter(info, "strict");
+    if (strict_value) {
+        strict = !duckdb_is_null_value(strict_value) && duckdb_get_bool(strict_value);
+        duckdb_destroy_value(&strict_value);
+    }
+    char error_text[256];
+    const char *error = LoadRules(bind, rules_path, strict, error_text, sizeof(error_text));
+    duckdb_free(rules_path);
+    if (error) {
+        duckdb_bind_set_error(info, error);
+        return;
+    }
+
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "sid", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "rev", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "msg", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "classtype", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "priority", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "ip_proto", DUCKDB_TYPE_UTINYINT);
+}
+
+static void AlertsInit(duckdb_init_info info) {
+    ids_bind_t *bind = (ids_bind_t *)duckdb_init_get_bind_data(info);
+
+    alerts_state_t *state = (alerts_state_t *)duckdb_malloc(sizeof(alerts_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(alerts_state_t));
+    state->bind = bind;
+    size_t rule_bytes = bind->rule_count * sizeof(uint32_t);
+    state->stamps = (uint32_t *)duckdb_malloc(rule_bytes);
+    state->candidates = (uint32_t *)duckdb_malloc(rule_bytes);
+    state->alerts = (uint32_t *)duckdb_malloc(rule_bytes);
+    if (!state->stamps || !state->candidates || !state->alerts ||
+        !HashMapInit(&state->flows, sizeof(flow_key_t), sizeof(ids_flow_t)) ||
+        !AppClassifierInit(&state->classifier)) {
+        AlertsInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state->stamps, 0, rule_bytes);
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        AlertsInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, AlertsInitDataFree);
+}
+
+// Track who opened the flow and whether it is established. TCP flows
+// picked up mid-stream count as established, with the first sender as
+// client; UDP and other flows are established once both sides have spoken.
+static ids_flow_t *UpdateFlow(alerts_state_t *state, const packet_info_t *pkt, int *to_server) {
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0 || pkt->is_fragment) {
+        return NULL;
+    }
+    if (state->flows.count >= IDS_MAX_FLOWS) {
+        HashMapDestroy(&state->flows);
+        if (!HashMapInit(&state->flows, sizeof(flow_key_t), sizeof(ids_flow_t))) {
+            return NULL;
+        }
+    }
+    int is_new;
+    ids_flow_t *flow = (ids_flow_t *)HashMapInsert(&state->flows, &key, &is_new);
+    if (!flow) {
+        return NULL;
+    }
+    int is_tcp = pkt->ip_proto == IPPROTO_NUM_TCP;
+    int syn = is_tcp && (pkt->tcp_flags & TCP_FLAG_SYN);
+    int ack = is_tcp && (pkt->tcp_flags & TCP_FLAG_ACK);
+    if (syn && !ack && !is_new && flow->established) {
+        // A new connection reusing the tuple starts with fresh state
+        memset(flow, 0, sizeof(ids_flow_t));
+        is_new = 1;
+    }
+    if (is_new) {
+        flow->client = (uint8_t)(syn && ack ? 1 - direction : direction);
+        flow->established = (uint8_t)(is_tcp && !syn);
+    }
+    flow->seen = (uint8_t)(flow->seen | (1 << direction));
+    *to_server = direction == flow->client;
+    if (is_tcp) {
+        if (syn && ack && !*to_server) {
+            flow->syn_ack = 1;
+        } else if (ack && !syn && *to_server && flow->syn_ack) {
+            flow->established = 1;
+        }
+    } else if (flow->seen == 3) {
+        flow->established = 1;
+    }
+    return flow;
+}
+
+static int MarkCandidate(void *context, uint32_t pattern, size_t end) {
+    (void)end;
+    alerts_state_t *state = (alerts_state_t *)context;
+    uint32_t rule = ((const uint32_t *)(const void *)state->bind->pattern_rules.data)[pattern];
+    if (state->stamps[rule] != state->generation) {
+        state->stamps[rule] = state->generation;
+        state->candidates[state->candidate_count++] = rule;
+    }
+    return 0;
+}
+
+static int CompareRuleIndex(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+// Evaluate the rules for one packet and queue its alerts
+static void InspectPacket(alerts_state_t *state, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    const ids_bind_t *bind = state->bind;
+    ids_packet_t info;
+    memset(&info, 0, sizeof(info));
+    info.pkt = pkt;
+    info.to_server = 1;
+    info.flow = UpdateFlow(state, pkt, &info.to_server);
+    if ((pkt->ip_proto == IPPROTO_NUM_ICMP || pkt->ip_proto == IPPROTO_NUM_ICMPV6) && pkt->l4 && pkt->l4_len >= 8) {
+        info.payload = pkt->l4 + 8;
+        info.payload_len = pkt->l4_len - 8;
+    } else if (pkt->payload) {
+        info.payload = pkt->payload;
+        info.payload_len = pkt->payload_len;
+    }
+    if (bind->needs_app_protocol) {
+        info.app_protocol = (uint8_t)AppClassifierPacket(&state->classifier, pkt);
+    }
+
+    if (++state->generation == 0) {
+        memset(state->stamps, 0, bind->rule_count * sizeof(uint32_t));
+        state->generation = 1;
+    }
+    state->candidate_count = 0;
+    if (info.payload_len) {
+        AcScan(&bind->prefilter, AC_ROOT, info.payload, info.payload_len, MarkCandidate, state);
+        if (state->candidate_count > 1) {
+            qsort(state->candidates, state->candidate_count, sizeof(uint32_t), CompareRuleIndex);
+        }
+    }
+
+    // Merge prefilter hits with the rules that have no literal, in rule order
+    const ids_rule_t *rules = Rules(bind);
+    const uint32_t *unfiltered = (const uint32_t *)(const void *)bind->unfiltered.data;
+    uint32_t unfiltered_count = PoolCount(&bind->unfiltered, sizeof(uint32_t));
+    uint32_t i = 0;
+    uint32_t j = 0;
+    state->alert_count = 0;
+    state->alert_next = 0;
+    while (i < state->candidate_count || j < unfiltered_count) {
+        uint32_t rule_index;
+        if (j == unfiltered_count || (i < state->candidate_count && state->candidates[i] < unfiltered[j])) {
+            rule_index = state->candidates[i++];
+        } else {
+            rule_index = unfiltered[j++];
+        }
+        const ids_rule_t *rule = &rules[rule_index];
+        if (!RuleMatches(bind, rule, &info)) {
+            continue;
+        }
+        ApplyFlowbits(bind, rule, info.flow);
+        if (!rule->noalert) {
+            state->alerts[state->alert_count++] = rule_index;
+        }
+    }
+    if (state->alert_count) {
+        state->timestamp_ns = packet->timestamp_ns;
+        PacketFormatIp(pkt->ip_version, pkt->src_ip, state->src_ip, sizeof(state->src_ip));
+        PacketFormatIp(pkt->ip_version, pkt->dst_ip, state->dst_ip, sizeof(state->dst_ip));
+        state->src_port = pkt->src_port;
+        state->dst_port = pkt->dst_port;
+        state->ip_proto = pkt->ip_proto;
+    }
+}
+
+static void AlertsFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    alerts_state_t *state = (alerts_state_t *)duckdb_function_get_init_data(info);
+    const ids_bind_t *bind = state->bind;
+
+    duckdb_vector vectors[ALERTS_COL_COUNT];
+    for (idx_t i = 0; i < ALERTS_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamps = (uint64_t *)duckdb_vector_get_data(vectors[ALERTS_COL_TIMESTAMP]);
+    uint32_t *sids = (uint32_t *)duckdb_vector_get_data(vectors[ALERTS_COL_SID]);
+    uint32_t *revs = (uint32_t *)duckdb_vector_get_data(vectors[ALERTS_COL_REV]);
+    uint8_t *priorities = (uint8_t *)duckdb_vector_get_data(vectors[ALERTS_COL_PRIORITY]);
+    uint16_t *src_ports = (uint16_t *)duckdb_vector_get_data(vectors[ALERTS_COL_SRC_PORT]);
+    uint16_t *dst_ports = (uint16_t *)duckdb_vector_get_data(vectors[ALERTS_COL_DST_PORT]);
+    uint8_t *ip_protos = (uint8_t *)duckdb_vector_get_data(vectors[ALERTS_COL_IP_PROTO]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    while (row_count < max_rows) {
+        if (state->alert_next == state->alert_count) {
+            if (!PcapSourceNext(state->source, &packet)) {
+                break;
+            }
+            if (PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) && pkt.ip_version) {
+                InspectPacket(state, &packet, &pkt);
+            }
+            continue;
+        }
+        const ids_rule_t *rule = &Rules(bind)[state->alerts[state->alert_next++]];
+        idx_t row = row_count++;
+        timestamps[row] = state->timestamp_ns;
+        sids[row] = rule->sid;
+        revs[row] = rule->rev;
+        if (rule->msg != UINT32_MAX) {
+            duckdb_vector_assign_string_element(vectors[ALERTS_COL_MSG], row, (const char *)bind->bytes.data + rule->msg);
+        } else {
+            PcapVectorSetNull(vectors[ALERTS_COL_MSG], row);
+        }
+        if (rule->classtype != UINT32_MAX) {
+            duckdb_vector_assign_string_element(vectors[ALERTS_COL_CLASSTYPE], row,
+                                                (const char *)bind->bytes.data + rule->classtype);
+        } else {
+            PcapVectorSetNull(vectors[ALERTS_COL_CLASSTYPE], row);
+        }
+        if (rule->priority) {
+            priorities[row] = rule->priority;
+        } else {
+            PcapVectorSetNull(vectors[ALERTS_COL_PRIORITY], row);
+        }
+        duckdb_vector_assign_string_element(vectors[ALERTS_COL_SRC_IP], row, state->src_ip);
+        src_ports[row] = state->src_port;
+        duckdb_vector_assign_string_element(vectors[ALERTS_COL_DST_IP], row, state->dst_ip);
+        dst_ports[row] = state->dst_port;
+        ip_protos[row] = state->ip_proto;
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterAlertsFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_alerts");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_logical_type bool_type = duckdb_create_logical_type(DUCKDB_TYPE_BOOLEAN);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_table_function_add_named_parameter(function, "strict", bool_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_destroy_logical_type(&bool_type);
+
+    duckdb_table_function_set_bind(function, AlertsBind);
+    duckdb_table_function_set_init(function, AlertsInit);
+    duckdb_table_function_set_function(function, AlertsFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
@@ -0,0 +1,22 @@
+#ifndef ADDRESS_TRACKING_H
+#define ADDRESS_TRACKING_H
+
+#include "duckdb_extension.h"
+
+// DHCPv4 UDP ports
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+
+// A binding that moves to a new MAC within this window of the previous owner
+// being seen is reported as an IP conflict (possible spoofing)
+#define ADDRESS_CONFLICT_WINDOW_NS (60ULL * 1000000000ULL)
+
+// Register pcap_address_bindings(path): IP-to-MAC(-to-hostname) binding change
+// events learned from ARP, DHCPv4 and ICMPv6 neighbor discovery in one pass,
+// including spoofing and conflict alerts
+void RegisterAddressBindingsFunction(duckdb_connection connection);
+
+// Register pcap_dhcp(path): one row per DHCPv4 message with decoded options
+void RegisterDhcpFunction(duckdb_connection connection);
+
+#endif // ADDRESS_TRACKING_H
@@ -0,0 +1,45 @@
+#ifndef AEAD_H
+#define AEAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AEAD_NONCE_LEN 12
+#define AEAD_TAG_LEN 16
+#define AEAD_MAX_KEY_LEN 32
+
+// The AEAD ciphers used by TLS 1.2 and 1.3 record protection
+typedef enum {
+    AEAD_AES_128_GCM,
+    AEAD_AES_256_GCM,
+    AEAD_CHACHA20_POLY1305,
+} aead_algorithm_t;
+
+// Expanded key. AES-GCM uses AES-NI and PCLMULQDQ when the CPU has them and
+// falls back to T-table AES with a 4-bit GHASH table otherwise.
+typedef struct {
+    aead_algorithm_t algorithm;
+    int hardware;
+    int rounds;
+    uint8_t round_keys[240];    // AES key schedule in FIPS 197 byte order
+    uint8_t sbox[256];
+    uint32_t te[256];           // AES round table, rotated for the other columns
+    uint8_t ghash_key[16];      // H = AES(K, 0^128)
+    uint64_t ghash_hi[16];      // H multiples for the 4-bit GHASH
+    uint64_t ghash_lo[16];
+    uint8_t chacha_key[32];
+} aead_key_t;
+
+// Key length in bytes for an algorithm
+size_t AeadKeyLength(aead_algorithm_t algorithm);
+
+// Expand secret (AeadKeyLength(algorithm) bytes)
+void AeadInit(aead_key_t *key, aead_algorithm_t algorithm, const uint8_t *secret);
+
+// Authenticate aad and len bytes of input against tag and decrypt input into
+// output (which must not overlap input). Returns 1 when the tag matches;
+// output is undefined otherwise.
+int AeadOpen(const aead_key_t *key, const uint8_t nonce[AEAD_NONCE_LEN], const uint8_t *aad, size_t aad_len,
+             const uint8_t *input, size_t len, const uint8_t tag[AEAD_TAG_LEN], uint8_t *output);
+
+#endif // AEAD_H
@@ -0,0 +1,61 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include "duckdb_extension.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Multi-pattern literal matcher compiled into a DFA over byte classes.
+// Matching folds ASCII case, so it serves as a prefilter: callers verify
+// case-sensitive patterns at the reported position.
+typedef struct {
+    // Build input
+    uint8_t *pattern_bytes;
+    uint32_t *pattern_offsets;   // pattern_count + 1 entries
+    uint32_t pattern_count;
+    uint32_t pattern_capacity;
+    size_t bytes_len;
+    size_t bytes_capacity;
+
+    // Compiled automaton
+    uint8_t byte_class[256];
+    uint8_t leaves_root[256];    // nonzero for bytes that start some pattern
+    uint32_t class_count;
+    uint32_t state_count;
+    uint32_t *transitions;       // [state * class_count + class] = target * class_count, | AC_OUTPUT_FLAG
+    uint32_t *first_pattern;     // per state: first pattern ending here + 1, or 0
+    uint32_t *output_link;       // per state: nearest proper suffix state with patterns, or 0
+    uint32_t *next_pattern;      // per pattern: next pattern ending at the same state + 1, or 0
+} ac_matcher_t;
+
+// Initial state, also the state to resume a scan from the start of a stream
+#define AC_ROOT 0
+
+// Set in transition targets whose state reports at least one pattern
+#define AC_OUTPUT_FLAG 0x80000000u
+
+void AcInit(ac_matcher_t *matcher);
+void AcDestroy(ac_matcher_t *matcher);
+
+// Add a pattern before AcCompile. Returns its id (ids are assigned in
+// order from 0) or -1 when memory is exhausted or the pattern is empty.
+int64_t AcAddPattern(ac_matcher_t *matcher, const uint8_t *pattern, size_t len);
+
+// Build the automaton. Returns 0 when memory is exhausted.
+int AcCompile(ac_matcher_t *matcher);
+
+static inline uint32_t AcPatternLength(const ac_matcher_t *matcher, uint32_t id) {
+    return matcher->pattern_offsets[id + 1] - matcher->pattern_offsets[id];
+}
+
+// Called for each occurrence with the offset just past its last byte.
+// Returning nonzero stops the scan.
+typedef int (*ac_match_callback_t)(void *context, uint32_t pattern, size_t end);
+
+// Run data through the automaton from state and return the final state, so
+// a stream can be scanned in chunks. Offsets passed to the callback are
+// relative to data.
+uint32_t AcScan(const ac_matcher_t *matcher, uint32_t state, const uint8_t *data, size_t len,
+                ac_match_callback_t callback, void *context);
+
+#endif // AHO_CORASICK_H
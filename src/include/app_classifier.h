@@ -0,0 +1,74 @@
+#ifndef APP_CLASSIFIER_H
+#define APP_CLASSIFIER_H
+
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+
+// Application protocols recognized from payload content, independent of ports.
+// The order matches app_protocol_names and the app_protocol ENUM.
+typedef enum {
+    APP_PROTOCOL_UNKNOWN,
+    APP_PROTOCOL_HTTP,
+    APP_PROTOCOL_HTTP2,
+    APP_PROTOCOL_TLS,
+    APP_PROTOCOL_DTLS,
+    APP_PROTOCOL_QUIC,
+    APP_PROTOCOL_SSH,
+    APP_PROTOCOL_DNS,
+    APP_PROTOCOL_SMTP,
+    APP_PROTOCOL_FTP,
+    APP_PROTOCOL_POP3,
+    APP_PROTOCOL_IMAP,
+    APP_PROTOCOL_SMB,
+    APP_PROTOCOL_RDP,
+    APP_PROTOCOL_SIP,
+    APP_PROTOCOL_STUN,
+    APP_PROTOCOL_MQTT,
+    APP_PROTOCOL_BITTORRENT,
+    APP_PROTOCOL_WIREGUARD,
+    APP_PROTOCOL_BGP,
+    APP_PROTOCOL_MODBUS,
+    APP_PROTOCOL_DNP3,
+    APP_PROTOCOL_S7COMM,
+    APP_PROTOCOL_NTP,
+    APP_PROTOCOL_PTP,
+    APP_PROTOCOL_DHCP,
+    APP_PROTOCOL_SNMP,
+    APP_PROTOCOL_SYSLOG,
+    APP_PROTOCOL_COUNT
+} app_protocol_t;
+
+extern const char *const app_protocol_names[APP_PROTOCOL_COUNT];
+
+// Payload bytes the signatures look at
+#define APP_INSPECT_BYTES 512
+
+// Payload-carrying packets of a flow inspected before it is settled as unknown
+#define APP_MAX_INSPECT_PACKETS 8
+
+// Flows with a cached verdict; the cache starts over when it fills up
+#define APP_MAX_FLOWS (1 << 20)
+
+// Classify a single TCP or UDP payload with no flow context
+app_protocol_t AppClassifyPayload(const packet_info_t *pkt);
+
+// Per-flow verdict cache. The first payload packets of a flow are inspected
+// until a signature matches; afterwards every packet of the flow costs one
+// hash lookup. Entries are dropped when a TCP connection closes.
+typedef struct {
+    hash_map_t flows;     // flow_key_t -> app_flow_t
+} app_classifier_t;
+
+int AppClassifierInit(app_classifier_t *classifier);
+void AppClassifierDestroy(app_classifier_t *classifier);
+
+// Verdict for the flow of a decoded packet (APP_PROTOCOL_UNKNOWN until one
+// of its payloads matches, and for non TCP/UDP packets)
+app_protocol_t AppClassifierPacket(app_classifier_t *classifier, const packet_info_t *pkt);
+
+// Register pcap_classify(path): one row per IP packet with its flow's
+// app_protocol
+void RegisterClassifyFunction(duckdb_connection connection);
+
+#endif // APP_CLASSIFIER_H
@@ -0,0 +1,23 @@
+#ifndef BEACON_DETECTION_H
+#define BEACON_DETECTION_H
+
+#include "duckdb_extension.h"
+
+// Packets of a pair closer than this to the previous one belong to the same
+// event (a connection or exchange); a longer silence starts a new event
+#define BEACON_IDLE_NS 1000000000ULL
+
+// Interval histogram: four log-scale buckets per octave of milliseconds,
+// the first starting at 2^BEACON_HIST_MIN_OCTAVE ms (about 1 s) and the last
+// open-ended from about 18 hours. Counters are halved together when one
+// would overflow, keeping the shape.
+#define BEACON_HIST_BUCKETS 64
+#define BEACON_HIST_MIN_OCTAVE 10
+
+// Register pcap_beacons(path, min_events): one pass over the capture keeping
+// a timing sketch per (client, server, server port, protocol) pair (event
+// interval mean and variance, and a histogram), then one row per pair with
+// at least min_events events and a periodicity score
+void RegisterBeaconsFunction(duckdb_connection connection);
+
+#endif // BEACON_DETECTION_H
@@ -0,0 +1,53 @@
+#ifndef CAPTURE_ARCHIVE_H
+#define CAPTURE_ARCHIVE_H
+
+#include "capture_file.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Captures inside tar and zip archives, read in place. A path such as
+// "evidence.tar.gz/*.pcap" names an archive (the path up to the first
+// component ending in .tar, .tgz, .tar.gz, .tzst, .tar.zst or .zip, compared
+// case-insensitively) and a pattern its members must match: '*' matches
+// within a path component, '**' across components and '?' a single
+// character. Member names are compared without a leading "./".
+//
+// Zip archives and uncompressed tars are listed up front: their members sit
+// at known offsets and can be opened independently, by several threads at
+// once. Zip members may be stored or deflated. Gzip- or zstd-compressed tars
+// can only be decoded front to back, one member after another. Tar archives
+// may use ustar, pax or GNU long names; zip archives may use zip64.
+
+// Upper bound on the members listed from one archive
+#define ARCHIVE_MAX_MEMBERS (1u << 20)
+
+typedef struct capture_archive capture_archive_t;
+
+// Split path into the archive's path and the member pattern, both allocated
+// with duckdb_malloc. Returns 1 when the path names archive members, 0 when it
+// does not and -1 when out of memory.
+int CaptureArchiveSplitPath(const char *path, char **archive_path, char **pattern);
+
+// Open an archive and find the members matching pattern; the archive and its
+// members are read with the given cache mode. Returns NULL on success and
+// stores the archive in *out, otherwise returns a static error message.
+const char *CaptureArchiveOpen(const char *archive_path, const char *pattern, capture_cache_t cache,
+                               capture_archive_t **out);
+
+// Matching members that CaptureArchiveOpenMember can open, 0 for compressed
+// tars
+uint32_t CaptureArchiveMemberCount(const capture_archive_t *archive);
+
+// The next matching member, reading the archive front to back. The caller
+// closes each member before asking for the next one; the archive must outlive
+// them. Returns NULL after the last member, on corrupt data or when out of
+// memory.
+capture_file_t *CaptureArchiveNext(capture_archive_t *archive);
+
+// Open a listed member through a file handle of its own. Returns NULL when it
+// cannot be opened.
+capture_file_t *CaptureArchiveOpenMember(const capture_archive_t *archive, uint32_t member);
+
+void CaptureArchiveClose(capture_archive_t *archive);
+
+#endif // CAPTURE_ARCHIVE_H
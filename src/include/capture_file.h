@@ -0,0 +1,75 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte source a capture is read from: a local file, a URL, standard input, a
+// range of another source (an archive member stored as is) or the output of a
+// decoder. Sources that cannot seek are read front to back. Implementations
+// embed capture_file_t as their first member; the position is kept by the
+// CaptureFile* functions, not by the implementations.
+typedef struct capture_file capture_file_t;
+
+typedef struct {
+    // Read up to len bytes at file->position; fewer only at the end of the
+    // data or on an error
+    size_t (*read)(capture_file_t *file, uint8_t *buffer, size_t len);
+    // Make offset the position of the next read; NULL for sources that
+    // cannot seek
+    int (*seek)(capture_file_t *file, uint64_t offset);
+    void (*close)(capture_file_t *file);
+} capture_file_ops_t;
+
+// How reading a local file treats the operating system's page cache. Both
+// uncached modes read through a buffer of their own and read-ahead hints;
+// other sources ignore the mode.
+typedef enum {
+    CAPTURE_CACHE_NORMAL,    // pages stay cached as usual
+    CAPTURE_CACHE_DONTNEED,  // pages are dropped from the cache once read
+    CAPTURE_CACHE_DIRECT     // reads bypass the cache (O_DIRECT), falling back to dropping pages
+} capture_cache_t;
+
+// Buffer of uncached reads, and the alignment direct I/O needs for its
+// offsets, lengths and memory
+#define CAPTURE_UNCACHED_BUFFER_SIZE (1 << 20)
+#define CAPTURE_DIRECT_ALIGN 4096
+
+struct capture_file {
+    const capture_file_ops_t *ops;
+    uint64_t position;       // offset of the next byte read
+    int64_t size;            // total size, -1 when unknown
+};
+
+// Open a local file, or a URL read over HTTP (see http_file.h), for reading.
+// Returns NULL when it cannot be opened.
+capture_file_t *CaptureFileOpen(const char *path, capture_cache_t cache);
+
+// Parse a cache mode name: 'normal', 'dontneed' or 'direct'. Returns 0 for
+// other names.
+int CaptureCacheParse(const char *name, capture_cache_t *cache);
+
+// Standard input, in binary mode; closing it leaves stdin open
+capture_file_t *CaptureFileStdin(void);
+
+// The len bytes of parent starting at offset. Reading a slice of a source
+// that cannot seek requires parent to be positioned at offset. With
+// owns_parent, closing the slice closes parent as well. Returns NULL when out
+// of memory.
+capture_file_t *CaptureFileSlice(capture_file_t *parent, uint64_t offset, uint64_t len, int owns_parent);
+
+size_t CaptureFileRead(capture_file_t *file, void *buffer, size_t len);
+
+// Returns 0 when the file cannot seek or offset is out of range
+int CaptureFileSeek(capture_file_t *file, uint64_t offset);
+
+// Move past len bytes, seeking when the file allows it. Returns 0 when the
+// data ends first.
+int CaptureFileSkip(capture_file_t *file, uint64_t len);
+
+// Read exactly len bytes at offset, leaving the file positioned after them
+int CaptureFileReadAt(capture_file_t *file, uint64_t offset, void *buffer, size_t len);
+
+void CaptureFileClose(capture_file_t *file);
+
+#endif // CAPTURE_FILE_H
@@ -0,0 +1,56 @@
+#ifndef CAPTURE_INDEX_H
+#define CAPTURE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Region index of a compressed capture. Each checkpoint is a place where
+// decompression can start without the data before it, and opens a region:
+// the records from its record_offset up to the next checkpoint's. With the
+// packet count and timestamp range of every region, scans skip regions
+// outside their time window and decode the others in parallel. Gzip captures
+// get one from a sidecar (gzip_index.h), seekable zstd captures carry one in
+// their seek table (zstd_seekable.h).
+
+// Bytes at the end of a compressed file that, with its size, fingerprint it
+#define CAPTURE_INDEX_TRAILER_LEN 8
+
+typedef struct {
+    uint64_t in_bits;            // compressed position in bits; 0 for the start of the file
+    uint64_t out_offset;         // uncompressed offset where decoding resumes
+    uint64_t record_offset;      // first pcap record at or after out_offset, where the region starts
+    uint64_t packets;            // records in the region
+    uint64_t min_timestamp_ns;   // timestamp range of the region's records
+    uint64_t max_timestamp_ns;
+    uint32_t window_len;
+    uint8_t *window;             // uncompressed history preceding out_offset (gzip only)
+} capture_checkpoint_t;
+
+typedef struct {
+    capture_checkpoint_t *checkpoints;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t compressed_size;
+    uint8_t trailer[CAPTURE_INDEX_TRAILER_LEN];
+
+    // While building
+    uint64_t next_checkpoint;    // uncompressed offset that triggers the next checkpoint
+    int pending;                 // the last checkpoint has not seen its first record yet
+    int failed;                  // out of memory; the index is not saved
+} capture_index_t;
+
+// Returns NULL when out of memory
+capture_index_t *CaptureIndexCreate(void);
+
+// Append a checkpoint with no records yet. Returns NULL when out of memory.
+capture_checkpoint_t *CaptureIndexAddCheckpoint(capture_index_t *index);
+
+// Whether a region may hold records with start_ns <= timestamp_ns < end_ns
+int CaptureIndexRegionOverlaps(const capture_index_t *index, uint32_t region, uint64_t start_ns, uint64_t end_ns);
+
+// Uncompressed offset where a region's records end
+uint64_t CaptureIndexRegionEnd(const capture_index_t *index, uint32_t region);
+
+void CaptureIndexFree(capture_index_t *index);
+
+#endif // CAPTURE_INDEX_H
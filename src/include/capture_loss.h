@@ -0,0 +1,21 @@
+#ifndef CAPTURE_LOSS_H
+#define CAPTURE_LOSS_H
+
+#include "duckdb_extension.h"
+
+// Default width of the time buckets, in seconds
+#define CAPTURE_LOSS_DEFAULT_BUCKET_SECONDS 60
+
+// An acknowledgment advancing by this much or more is taken as a
+// desynchronised connection (port reuse, a bogus segment) rather than loss,
+// and only moves the baseline
+#define CAPTURE_LOSS_MAX_ADVANCE (1U << 30)
+
+// Register pcap_capture_loss(path [, bucket_seconds]): estimates how much of
+// the traffic the capture missed from bytes acknowledged by TCP receivers
+// but never seen from the sender, like Zeek's capture_loss. One pass keeps
+// sequence and acknowledgment state per connection and returns rows per
+// flow, per interface and per time bucket of each interface.
+void RegisterCaptureLossFunction(duckdb_connection connection);
+
+#endif // CAPTURE_LOSS_H
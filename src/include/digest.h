@@ -0,0 +1,54 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MD5_DIGEST_LEN 16
+#define SHA256_DIGEST_LEN 32
+#define SHA384_DIGEST_LEN 48
+#define SHA512_DIGEST_LEN 64
+
+// Streaming MD5 (RFC 1321), used for fingerprints such as HASSH
+typedef struct {
+    uint32_t state[4];
+    uint64_t length;      // total bytes hashed
+    uint8_t buffer[64];
+    size_t buffer_len;
+} md5_ctx_t;
+
+void Md5Init(md5_ctx_t *ctx);
+void Md5Update(md5_ctx_t *ctx, const void *data, size_t len);
+void Md5Final(md5_ctx_t *ctx, uint8_t digest[MD5_DIGEST_LEN]);
+
+// Streaming SHA-256 (FIPS 180-4)
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[64];
+    size_t buffer_len;
+} sha256_ctx_t;
+
+void Sha256Init(sha256_ctx_t *ctx);
+void Sha256Update(sha256_ctx_t *ctx, const void *data, size_t len);
+void Sha256Final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+
+// Streaming SHA-512, or SHA-384 when initialized with Sha384Init
+typedef struct {
+    uint64_t state[8];
+    uint64_t length;
+    uint8_t buffer[128];
+    size_t buffer_len;
+    size_t digest_len;    // SHA384_DIGEST_LEN or SHA512_DIGEST_LEN
+} sha512_ctx_t;
+
+void Sha384Init(sha512_ctx_t *ctx);
+void Sha512Init(sha512_ctx_t *ctx);
+void Sha512Update(sha512_ctx_t *ctx, const void *data, size_t len);
+// Writes digest_len bytes
+void Sha512Final(sha512_ctx_t *ctx, uint8_t *digest);
+
+// Hex-encode a digest into out (2 * len + 1 bytes)
+void DigestToHex(const uint8_t *digest, size_t len, char *out);
+
+#endif // DIGEST_H
@@ -0,0 +1,58 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "packet_decode.h"
+#include <stdint.h>
+
+// Direction-independent key of a transport flow. Endpoint A is the one that
+// compares lower (address, then port), so both directions map to one key.
+typedef struct {
+    uint8_t ip_version;
+    uint8_t ip_proto;
+    uint16_t port_a;
+    uint16_t port_b;
+    uint8_t addr_a[16];
+    uint8_t addr_b[16];
+} flow_key_t;
+
+// Fill key for the packet's flow. Returns the packet's direction: 0 when it
+// was sent by endpoint A, 1 when sent by endpoint B. Returns -1 for packets
+// without a decoded IP/transport header.
+int FlowKeyFromPacket(const packet_info_t *pkt, flow_key_t *key);
+
+// Format one endpoint of a flow (0 = A, 1 = B) as an address string and port
+void FlowFormatEndpoint(const flow_key_t *key, int endpoint, char *addr, size_t addr_len, uint16_t *port);
+
+// In-order tracking of one direction of a TCP connection
+typedef struct {
+    uint32_t next_seq;
+    uint8_t has_seq;
+    uint8_t fin;
+    uint8_t gap;       // data was lost (a segment beyond next_seq arrived)
+} tcp_direction_t;
+
+// Accept a segment in sequence order. Returns the number of new in-order
+// payload bytes and points *data at them; retransmitted bytes are trimmed and
+// out-of-order segments (after a gap) return 0 and set dir->gap.
+uint32_t TcpDirectionAccept(tcp_direction_t *dir, const packet_info_t *pkt, const uint8_t **data);
+
+// Resynchronize a direction after a gap: continue from this segment on
+void TcpDirectionResync(tcp_direction_t *dir, const packet_info_t *pkt);
+
+// Growable buffer holding the not yet consumed bytes of a reassembled stream
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} stream_buffer_t;
+
+// Append bytes. Returns 0 (leaving the buffer unchanged) when the buffered
+// length would exceed limit or memory is exhausted.
+int StreamBufferAppend(stream_buffer_t *buffer, const uint8_t *data, size_t len, size_t limit);
+
+// Drop len bytes from the front of the buffer
+void StreamBufferConsume(stream_buffer_t *buffer, size_t len);
+
+void StreamBufferFree(stream_buffer_t *buffer);
+
+#endif // FLOW_H
@@ -0,0 +1,52 @@
+#ifndef GZIP_INDEX_H
+#define GZIP_INDEX_H
+
+#include "capture_file.h"
+#include "capture_index.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Checkpoint index of a gzip-compressed classic pcap. It is built while the
+// capture is first read from start to end and kept next to it in a sidecar
+// file, so that later scans can resume decompression at the checkpoint
+// nearest a time window instead of at the start of the file. A gzip
+// checkpoint carries the 32KB of output preceding it, which back-references
+// after it may reach into.
+
+// Uncompressed bytes between checkpoints (each costs a 32KB window)
+#define GZIP_INDEX_SPACING (4 << 20)
+
+// Sidecar file name: the capture's path with this suffix
+#define GZIP_INDEX_SUFFIX ".gzidx"
+#define GZIP_INDEX_MAGIC "PCAPGZX1"
+
+// The last bytes of a gzip file (CRC32 and ISIZE of the final member), which
+// together with its size tell whether a sidecar still matches it
+#define GZIP_INDEX_TRAILER_LEN CAPTURE_INDEX_TRAILER_LEN
+
+// Read the size and trailer of an open gzip file, restoring its position.
+// Returns 0 when the file cannot be positioned.
+int GzipIndexFingerprint(capture_file_t *file, uint64_t *size, uint8_t *trailer);
+
+// Start an index for a capture whose first record is at record_offset.
+// Returns NULL when out of memory.
+capture_index_t *GzipIndexCreate(uint64_t compressed_size, const uint8_t *trailer, uint64_t record_offset);
+
+// Inflate block callback (context is the index) adding a checkpoint every
+// GZIP_INDEX_SPACING uncompressed bytes
+void GzipIndexBlock(void *context, uint64_t in_bits, uint64_t out_offset, const uint8_t *window, size_t window_len);
+
+// Account for the record at the given uncompressed offset. Records must be
+// added in file order.
+void GzipIndexAddRecord(capture_index_t *index, uint64_t offset, uint64_t timestamp_ns);
+
+// Complete an index built over the whole capture and write its sidecar.
+// Returns 0 when the sidecar cannot be written (such as in a read-only
+// directory).
+int GzipIndexSave(capture_index_t *index, const char *capture_path);
+
+// Load the sidecar of a capture. Returns NULL when there is none or it does
+// not match the capture's size and trailer.
+capture_index_t *GzipIndexLoad(const char *capture_path, uint64_t compressed_size, const uint8_t *trailer);
+
+#endif // GZIP_INDEX_H
@@ -0,0 +1,45 @@
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing hash map with fixed-size byte keys and fixed-size values,
+// stored inline in a single slot array (linear probing, backward-shift
+// deletion). Used for per-flow and per-address state tables where millions of
+// small entries must stay compact and cache friendly.
+typedef struct {
+    uint8_t *slots;       // capacity * slot_size bytes
+    size_t key_size;
+    size_t value_size;
+    size_t value_offset;  // offset of the value within a slot
+    size_t slot_size;     // occupancy word + key + value, each 8-byte aligned
+    size_t capacity;      // always a power of two
+    size_t count;
+} hash_map_t;
+
+// Initialise an empty map. Returns 0 on allocation failure.
+int HashMapInit(hash_map_t *map, size_t key_size, size_t value_size);
+
+// Release the slot array
+void HashMapDestroy(hash_map_t *map);
+
+// Look up a key; returns a pointer to the value or NULL if absent
+void *HashMapFind(const hash_map_t *map, const void *key);
+
+// Find or insert a key. New values are zero-filled and *is_new is set to 1.
+// Returns NULL on allocation failure. Value pointers are invalidated by any
+// subsequent insert or remove.
+void *HashMapInsert(hash_map_t *map, const void *key, int *is_new);
+
+// Remove a key if present
+void HashMapRemove(hash_map_t *map, const void *key);
+
+// Iterate over occupied slots: start with *position = 0 and call until it
+// returns 0. Key and value pointers stay valid until the map is modified.
+int HashMapNext(const hash_map_t *map, size_t *position, const void **key, void **value);
+
+// 64-bit hash of an arbitrary byte string
+uint64_t HashBytes(const void *data, size_t len);
+
+#endif // HASH_MAP_H
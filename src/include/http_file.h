@@ -0,0 +1,45 @@
+#ifndef HTTP_FILE_H
+#define HTTP_FILE_H
+
+#include "capture_file.h"
+
+// Captures read over HTTP with range requests, so that nothing is copied
+// locally first. The file is fetched in HTTP_CHUNK_SIZE ranges; once reads
+// move on sequentially from one chunk to the next, the following
+// HTTP_READ_AHEAD chunks are requested as well, each on a connection of its
+// own, and download in parallel while the earlier data is decoded. Seeks only
+// cost the chunk they land in. Connections are kept alive between requests,
+// and a failed request is retried on a new connection.
+//
+// s3://bucket/key paths are read from the S3-compatible service at
+// AWS_ENDPOINT_URL_S3 or AWS_ENDPOINT_URL, addressing buckets by path. When
+// AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY are set, requests are signed
+// (AWS signature version 4) for AWS_REGION, AWS_DEFAULT_REGION or us-east-1,
+// with AWS_SESSION_TOKEN if any. There is no TLS: URLs and endpoints must be
+// http://. A server that ignores ranges sends the whole file, which is then
+// read front to back.
+
+// Bytes per range request
+#define HTTP_CHUNK_SIZE (4 << 20)
+
+// Chunks requested ahead of sequential reads
+#define HTTP_READ_AHEAD 4
+
+// Range fetched when opening, for the size and the file header
+#define HTTP_PROBE_SIZE (64 << 10)
+
+// Longest response header, and the wait for data from a request
+#define HTTP_HEADER_MAX 16384
+#define HTTP_TIMEOUT_MS 30000
+
+// Attempts per range before a read fails
+#define HTTP_ATTEMPTS 3
+
+// Whether path is an http://, https:// or s3:// URL
+int HttpFileIsUrl(const char *path);
+
+// Open a URL for reading. Returns NULL when it cannot be reached, responds
+// with an error or needs TLS.
+capture_file_t *HttpFileOpen(const char *url);
+
+#endif // HTTP_FILE_H
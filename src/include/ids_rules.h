@@ -0,0 +1,28 @@
+#ifndef IDS_RULES_H
+#define IDS_RULES_H
+
+#include "duckdb_extension.h"
+
+// Content and pcre matches per rule
+#define IDS_MAX_ELEMENTS 32
+
+// Distinct flowbit names in a rules file
+#define IDS_MAX_FLOWBITS 256
+
+// Flows with tracked state (direction, handshake, flowbits); the table
+// starts over when it fills up
+#define IDS_MAX_FLOWS (1 << 20)
+
+// Content match attempts per rule and packet; bounds the backtracking of
+// relative contents over payloads with many candidate positions
+#define IDS_MAX_MATCH_STEPS 4096
+
+// Longest rule, including continuation lines
+#define IDS_MAX_RULE_LENGTH 65536
+
+// Register pcap_alerts(path, rules_file, strict := false): evaluate a subset
+// of Suricata/Snort rule syntax against each packet and return one row per
+// alert. Rules with unsupported keywords are skipped unless strict is set.
+void RegisterAlertsFunction(duckdb_connection connection);
+
+#endif // IDS_RULES_H
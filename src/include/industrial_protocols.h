@@ -0,0 +1,30 @@
+#ifndef INDUSTRIAL_PROTOCOLS_H
+#define INDUSTRIAL_PROTOCOLS_H
+
+#include "duckdb_extension.h"
+
+// Well-known server ports
+#define MODBUS_TCP_PORT 502
+#define DNP3_PORT 20000
+#define S7COMM_PORT 102
+
+// Requests awaiting a response are kept per query up to this many; further
+// requests are reported without being paired
+#define OT_MAX_PENDING_REQUESTS 65536
+
+// Register pcap_modbus(path): one row per Modbus/TCP ADU with unit id,
+// function code, register range and exception code, responses paired with
+// their request by transaction id
+void RegisterModbusFunction(duckdb_connection connection);
+
+// Register pcap_dnp3(path): one row per DNP3 application fragment (TCP or UDP)
+// with link addresses, function code, IIN flags and the first object header,
+// responses paired with their request by application sequence number
+void RegisterDnp3Function(duckdb_connection connection);
+
+// Register pcap_s7comm(path): one row per S7comm PDU carried in TPKT/COTP with
+// function, memory area and address range, error and return codes, responses
+// paired with their job by PDU reference
+void RegisterS7commFunction(duckdb_connection connection);
+
+#endif // INDUSTRIAL_PROTOCOLS_H
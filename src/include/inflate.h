@@ -0,0 +1,65 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include "capture_file.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming decoder for gzip files (RFC 1952, including concatenated
+// members) over DEFLATE (RFC 1951). Decoding can be suspended at any deflate
+// block boundary and later resumed from the compressed bit position, the
+// uncompressed offset and the preceding 32KB of output (a zran-style
+// checkpoint). Member CRCs are not verified, since a stream resumed from a
+// checkpoint could not check them either; member lengths are, for members
+// decoded from their start.
+
+#define GZIP_MAGIC_0 0x1f
+#define GZIP_MAGIC_1 0x8b
+
+// Distance limit of DEFLATE back-references, and so the history a checkpoint
+// must carry
+#define INFLATE_WINDOW_SIZE 32768
+
+// Compressed bytes read from the file at a time
+#define INFLATE_INPUT_SIZE 65536
+
+// Decoded output buffer: the history window plus room for decoding ahead
+#define INFLATE_OUTPUT_SIZE (8 * INFLATE_WINDOW_SIZE)
+
+typedef struct inflate_stream inflate_stream_t;
+
+// Called before each deflate block header is read. in_bits is the block's
+// position in the compressed file in bits, out_offset the number of bytes
+// decoded before it and window the (up to INFLATE_WINDOW_SIZE) bytes that
+// precede out_offset.
+typedef void (*inflate_block_callback_t)(void *context, uint64_t in_bits, uint64_t out_offset, const uint8_t *window,
+                                         size_t window_len);
+
+// Start decoding a gzip file. The stream reads from file, which must be
+// positioned right after the prefix_len bytes in prefix (the bytes already
+// consumed while detecting the format, at most 16). Returns NULL when out of
+// memory.
+inflate_stream_t *InflateOpen(capture_file_t *file, const uint8_t *prefix, size_t prefix_len);
+
+// Start decoding a bare DEFLATE stream (a zip member) at the file's position
+inflate_stream_t *InflateOpenRaw(capture_file_t *file);
+
+// Resume decoding at a checkpoint reported by the block callback. Returns 0
+// when the file cannot be positioned.
+int InflateSeek(inflate_stream_t *stream, uint64_t in_bits, uint64_t out_offset, const uint8_t *window,
+                size_t window_len);
+
+// Decode up to len bytes into buffer (or discard them when buffer is NULL).
+// Returns the number of bytes produced, which is less than len only at the
+// end of the data or on a corrupt stream.
+size_t InflateRead(inflate_stream_t *stream, uint8_t *buffer, size_t len);
+
+// Whether the last member ended cleanly (rather than on truncated or corrupt
+// data)
+int InflateFinished(const inflate_stream_t *stream);
+
+void InflateSetBlockCallback(inflate_stream_t *stream, inflate_block_callback_t callback, void *context);
+
+void InflateClose(inflate_stream_t *stream);
+
+#endif // INFLATE_H
@@ -0,0 +1,63 @@
+#ifndef IO_SCHEDULER_H
+#define IO_SCHEDULER_H
+
+#include "duckdb_extension.h"
+#include <stdint.h>
+
+// Extension-wide scheduler of the reading and decompressing done by read_pcap
+// scans. Each scan is a stream with a share; every chunk of rows it produces
+// is a unit of work taken in turn from a shared queue. At most the configured
+// number of units run at once (no limit by default, in which case turns are
+// never waited for). When units queue up, streams that have decoded less than
+// IO_SCHEDULER_SMALL_SCAN bytes go first, so short interactive scans are not
+// held up by long ones; among the rest, the stream that has decoded the
+// fewest bytes per share goes next, which splits the throughput between
+// concurrent scans in proportion to their shares.
+
+// Scans that have decoded less than this are served first
+#define IO_SCHEDULER_SMALL_SCAN (64ULL << 20)
+
+// Longest wait for a turn before the caller gets control back
+#define IO_SCHEDULER_WAIT_MS 100
+
+// A stream whose unit just ended is expected back for the next one within
+// this long. Meanwhile streams whose turns come after its own leave it a
+// slot, so that it is not passed over merely for being between two calls.
+#define IO_SCHEDULER_ANTICIPATE_MS 2
+
+// A unit of work ends after this many packets or decoded bytes, counting
+// packets outside the scan's time window as well
+#define IO_SCHEDULER_TURN_PACKETS 65536
+#define IO_SCHEDULER_TURN_BYTES (16ULL << 20)
+
+#define IO_SCHEDULER_DEFAULT_SHARE 1
+#define IO_SCHEDULER_MAX_SHARE 1000
+
+typedef struct io_stream io_stream_t;
+
+// Register a scan with the given share (1 to IO_SCHEDULER_MAX_SHARE).
+// Returns NULL when out of memory; a NULL stream is never held back.
+io_stream_t *IoStreamOpen(uint32_t share);
+
+void IoStreamClose(io_stream_t *stream);
+
+// Wait for the stream's turn to produce a chunk. Returns 1 with the turn,
+// to be handed back with IoSchedulerRelease reporting the bytes decoded
+// meanwhile. Returns 0 without it after IO_SCHEDULER_WAIT_MS: the caller
+// should then do no more than a token amount of work, report it with
+// IoSchedulerCharge and return to DuckDB, which stops calling a scan whose
+// query was interrupted. While the slots
+// stay full with other streams' work, a stream can go without a turn
+// indefinitely. A thread holds at most one turn at a time and must not hold
+// one across calls into DuckDB.
+int IoSchedulerAcquire(io_stream_t *stream);
+void IoSchedulerRelease(io_stream_t *stream, uint64_t bytes);
+
+// Count bytes decoded without a turn towards the stream's share
+void IoSchedulerCharge(io_stream_t *stream, uint64_t bytes);
+
+// Register pcap_io_slots(slots) -> INTEGER: set how many units of work may run
+// at once across all scans (0 for no limit) and return the previous limit
+void RegisterIoSchedulerFunction(duckdb_connection connection);
+
+#endif // IO_SCHEDULER_H
@@ -0,0 +1,49 @@
+#ifndef MESSAGE_STREAM_H
+#define MESSAGE_STREAM_H
+
+#include "flow.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Returned by a message_frame_t when the bytes cannot start a message
+#define MESSAGE_FRAME_INVALID SIZE_MAX
+
+// Length of the message starting at data, of which avail bytes are buffered.
+// Returns 0 when more bytes are needed to tell, or MESSAGE_FRAME_INVALID.
+typedef size_t (*message_frame_t)(const uint8_t *data, size_t avail);
+
+// A length-framed application protocol on a well-known port
+typedef struct {
+    uint16_t port;            // 0 frames every flow regardless of port
+    int udp;                  // also take datagrams on port (one or more messages each)
+    message_frame_t frame;
+    size_t max_message;       // longer messages are treated as framing errors
+} message_protocol_t;
+
+// One complete application message. data is valid until the next call to
+// MessageStreamNext.
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    const flow_key_t *key;
+    int direction;            // sending endpoint of the flow key (0 = A, 1 = B)
+    int to_server;            // sent to the protocol port (always 0 for port 0)
+    int is_udp;
+    uint64_t timestamp_ns;    // capture time of the packet completing the message
+} message_t;
+
+// Splits the TCP streams (reassembled in sequence order) and UDP datagrams of
+// one protocol into messages. Several messages per segment and messages
+// spanning segments are both handled; after a gap or a framing error a
+// direction resynchronizes at the start of the next segment.
+typedef struct message_stream message_stream_t;
+
+// Open a capture. Returns NULL on success, otherwise a static error message.
+const char *MessageStreamOpen(const char *filename, const message_protocol_t *protocol, message_stream_t **out);
+
+// Read the next message. Returns 1 when a message was read, 0 at end of capture.
+int MessageStreamNext(message_stream_t *stream, message_t *message);
+
+void MessageStreamClose(message_stream_t *stream);
+
+#endif // MESSAGE_STREAM_H
@@ -0,0 +1,100 @@
+#ifndef PACKET_DECODE_H
+#define PACKET_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Data link types (LINKTYPE_* from the tcpdump.org registry)
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_PPP_HDLC 50
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+#define LINKTYPE_LINUX_SLL2 276
+
+// EtherTypes
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP 0x0806
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_QINQ 0x88A8
+#define ETHERTYPE_IPV6 0x86DD
+#define ETHERTYPE_PTP 0x88F7
+
+// IP protocol numbers
+#define IPPROTO_NUM_ICMP 1
+#define IPPROTO_NUM_TCP 6
+#define IPPROTO_NUM_UDP 17
+#define IPPROTO_NUM_ICMPV6 58
+#define IPPROTO_NUM_OSPF 89
+
+// TCP flags
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_SYN 0x02
+#define TCP_FLAG_RST 0x04
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_ACK 0x10
+
+// Result of dissecting the link, network and transport headers of a packet.
+// Pointers refer into the packet buffer passed to PacketDecode. Addresses are
+// stored in network byte order; IPv4 addresses use the first four bytes.
+typedef struct {
+    // Link layer (only set for Ethernet-like link types)
+    const uint8_t *src_mac;
+    const uint8_t *dst_mac;
+    uint16_t ethertype;          // EtherType after any VLAN tags
+    uint16_t vlan_id;            // innermost VLAN id, 0 when untagged
+
+    // Network layer
+    const uint8_t *l3;           // start of the EtherType payload
+    uint32_t l3_len;
+    uint8_t ip_version;          // 4, 6 or 0 when not IP
+    uint8_t ip_proto;            // transport protocol (after IPv6 extension headers)
+    uint8_t ttl;                 // TTL / hop limit
+    uint8_t is_fragment;         // non-first fragment or fragmented datagram
+    uint8_t src_ip[16];
+    uint8_t dst_ip[16];
+
+    // Transport layer
+    const uint8_t *l4;           // start of the transport header
+    uint32_t l4_len;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint32_t tcp_seq;
+    uint32_t tcp_ack;
+    uint16_t tcp_window;
+    uint8_t tcp_flags;
+
+    // Application payload after the transport header
+    const uint8_t *payload;
+    uint32_t payload_len;
+} packet_info_t;
+
+// Dissect a packet captured with the given link type. Returns 1 if at least
+// the link layer could be decoded; fields beyond the decoded layers are zero.
+int PacketDecode(uint32_t link_type, const uint8_t *data, uint32_t len, packet_info_t *info);
+
+// Big-endian field readers
+static inline uint16_t PacketRead16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t PacketRead32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t PacketRead48(const uint8_t *p) {
+    return ((uint64_t)PacketRead16(p) << 32) | (uint64_t)PacketRead32(p + 2);
+}
+
+static inline uint64_t PacketRead64(const uint8_t *p) {
+    return ((uint64_t)PacketRead32(p) << 32) | (uint64_t)PacketRead32(p + 4);
+}
+
+// Format helpers. The output buffer must hold at least 46 bytes for IP
+// addresses (INET6_ADDRSTRLEN) and 18 bytes for MAC addresses.
+void PacketFormatIp(uint8_t ip_version, const uint8_t *addr, char *out, size_t out_len);
+void PacketFormatMac(const uint8_t *mac, char *out, size_t out_len);
+
+#endif // PACKET_DECODE_H
@@ -0,0 +1,114 @@
+#ifndef PARTITIONED_WRITER_H
+#define PARTITIONED_WRITER_H
+
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "hash_map.h"
+#include <stdio.h>
+
+// Output file handles kept open at once over all writers; the least recently
+// written one is closed (and later reopened for appending) beyond this
+#define PARTITIONED_WRITER_MAX_OPEN_FILES 256
+
+// The layer shared by the capture-writing aggregates (pcap_write_pcapng,
+// pcap_write_zstd). Each aggregate state buffers the records of every path it
+// receives in a partition of its own; outputs are shared by all states
+// writing to a path. A format describes itself with partitioned_writer_ops_t
+// and embeds partitioned_output_t, partitioned_partition_t and
+// partitioned_writer_t as the first members of its own structures.
+typedef struct partitioned_output partitioned_output_t;
+typedef struct partitioned_partition partitioned_partition_t;
+typedef struct partitioned_writer partitioned_writer_t;
+
+typedef struct {
+    size_t writer_size;      // aggregate state size
+    size_t output_size;
+    size_t partition_size;
+    // A partition is written out once it buffers this much, and the fullest
+    // are written out once a state buffers more than the budget
+    size_t flush_size;
+    size_t buffer_budget;
+    const char *open_error;  // error when an output file cannot be opened
+    const char *write_error;  // error when it cannot be written
+    // Write the start of a new file (output->file is open and truncated).
+    // arg is the one given to PartitionedWriterPartition.
+    int (*start_file)(partitioned_writer_t *writer, partitioned_output_t *output, const void *arg);
+    // Encode the partition's buffered records as the bytes to append to its
+    // file, outside the registry lock. Returns NULL on failure.
+    const uint8_t *(*encode)(partitioned_writer_t *writer, partitioned_partition_t *partition, size_t *len);
+    // Note that the bytes encode returned were appended to the file; NULL
+    // when the format keeps no track of them
+    int (*appended)(partitioned_writer_t *writer, partitioned_output_t *output);
+    // Write the end of the file once its last reference is released; NULL
+    // when the format has none
+    int (*finish_file)(partitioned_output_t *output);
+    // Free what the format added to each structure; NULL when nothing
+    void (*free_output)(partitioned_output_t *output);
+    void (*free_partition)(partitioned_partition_t *partition);
+    void (*free_writer)(partitioned_writer_t *writer);
+} partitioned_writer_ops_t;
+
+// A file being written, shared by every state writing to its path. Its
+// handle may be closed while it stays in use.
+struct partitioned_output {
+    const partitioned_writer_ops_t *ops;
+    char *path;
+    size_t path_len;
+    uint64_t hash;
+    FILE *file;                  // NULL while closed
+    uint32_t refs;
+    int failed;                  // a write failed; the file is not finished
+    partitioned_output_t *hash_next;  // outputs whose path has the same hash
+    partitioned_output_t *lru_prev;   // open outputs, most recent first
+    partitioned_output_t *lru_next;
+};
+
+// Records of one state bound for one output
+struct partitioned_partition {
+    partitioned_output_t *output;
+    stream_buffer_t records;     // encoded records not yet written
+    partitioned_partition_t *hash_next;
+};
+
+struct partitioned_writer {
+    const partitioned_writer_ops_t *ops;
+    hash_map_t partitions;       // path hash -> partitioned_partition_t *
+    partitioned_partition_t **list;  // every partition, for flushing
+    uint32_t count;
+    uint32_t capacity;
+    partitioned_partition_t *last;  // partition of the previous row
+    size_t buffered;             // bytes buffered over all partitions
+    uint64_t packets;
+};
+
+// Partition for a row's path, creating the output (and starting its file
+// with arg) on first use. Returns NULL when the file cannot be opened.
+partitioned_partition_t *PartitionedWriterPartition(partitioned_writer_t *writer, const char *path, size_t path_len,
+                                                    const void *arg);
+
+// Account for a record of bytes the format appended to partition->records,
+// writing out buffers as they fill up. Returns 0 when a file could not be
+// written.
+int PartitionedWriterAdded(partitioned_writer_t *writer, partitioned_partition_t *partition, size_t bytes);
+
+// Write out the partition's buffered records. Returns 0 on failure.
+int PartitionedWriterFlush(partitioned_writer_t *writer, partitioned_partition_t *partition);
+
+// Original length of a row's packet of len captured bytes: its original_len
+// argument (a BIGINT column, NULL when not given) or len. Returns 0 when the
+// argument is below len or above 32 bits.
+int PartitionedWriterOriginalLen(const int64_t *original_lens, uint64_t *validity, idx_t row, size_t len,
+                                 uint32_t *original_len);
+
+#define PARTITIONED_WRITER_ORIGINAL_LEN_ERROR "original_len must be between the data length and 4294967295"
+
+// Append bytes to an output directly, under the registry lock
+int PartitionedOutputWrite(partitioned_output_t *output, const uint8_t *data, size_t len);
+
+// Set the state, combine, finalize and destroy callbacks of an aggregate
+// writing with ops, next to its own update; the aggregate returns the number
+// of packets written and its files are complete when the query returns
+void PartitionedWriterSetFunctions(duckdb_aggregate_function function, const partitioned_writer_ops_t *ops,
+                                   duckdb_aggregate_update_t update);
+
+#endif // PARTITIONED_WRITER_H
@@ -0,0 +1,21 @@
+#ifndef PAYLOAD_SIMILARITY_H
+#define PAYLOAD_SIMILARITY_H
+
+#include "duckdb_extension.h"
+
+// Shingle length (bytes per hashed window) when none is given
+#define SIMILARITY_DEFAULT_SHINGLE 4
+
+// Longest shingle and largest MinHash signature accepted
+#define SIMILARITY_MAX_SHINGLE 1024
+#define SIMILARITY_MAX_MINHASH 1024
+
+// Shingle hashes computed at a time before being folded into a signature
+#define SIMILARITY_BLOCK 256
+
+// Register the scalar functions pcap_simhash(data [, shingle_len]) -> UBIGINT
+// and pcap_minhash(data, k [, shingle_len]) -> UBIGINT[]. Both hash every
+// window of shingle_len bytes of a BLOB or VARCHAR; empty data gives NULL.
+void RegisterSimilarityFunctions(duckdb_connection connection);
+
+#endif // PAYLOAD_SIMILARITY_H
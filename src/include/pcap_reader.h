@@ -12,6 +12,54 @@
 #define PCAP_MAGIC_NANO_NATIVE 0xa1b23c4d
 #define PCAP_MAGIC_NANO_SWAPPED 0x4d3cb2a1
 
+// Modified pcap (Alexey Kuznetzov's patches): the classic layout with 8 more
+// bytes per record header (ifindex, protocol, packet type)
+#define PCAP_MAGIC_MODIFIED_NATIVE 0xa1b2cd34
+#define PCAP_MAGIC_MODIFIED_SWAPPED 0x34cdb2a1
+#define PCAP_MODIFIED_EXTRA_LEN 8
+
+// Solaris snoop (RFC 1761): an 8-byte identification pattern, then version
+// and datalink type, all fields big-endian
+#define SNOOP_MAGIC "snoop\0\0\0"
+#define SNOOP_VERSION 2
+#define SNOOP_RECORD_HEADER_LEN 24
+#define SNOOP_DATALINK_8023 0
+#define SNOOP_DATALINK_ETHERNET 4
+
+// Endace ERF has no file header: the file is a sequence of records, each
+// with a 16-byte header (little-endian fixed-point timestamp, type, flags,
+// then big-endian record length, loss counter and wire length)
+#define ERF_HEADER_LEN 16
+#define ERF_TYPE_MASK 0x7F
+#define ERF_TYPE_EXTENSION 0x80      // 8-byte extension headers follow
+#define ERF_TYPE_HDLC_POS 1
+#define ERF_TYPE_ETH 2
+#define ERF_TYPE_COLOR_HDLC_POS 10
+#define ERF_TYPE_COLOR_ETH 11
+#define ERF_TYPE_DSM_COLOR_HDLC_POS 15
+#define ERF_TYPE_DSM_COLOR_ETH 16
+#define ERF_TYPE_COLOR_HASH_POS 19
+#define ERF_TYPE_COLOR_HASH_ETH 20
+#define ERF_TYPE_IPV4 22
+#define ERF_TYPE_IPV6 23
+#define ERF_TYPE_MAX 48              // highest type accepted when detecting ERF
+#define ERF_FLAGS_INTERFACE_MASK 0x03
+#define ERF_FLAGS_RX_ERROR 0x10
+#define ERF_FLAGS_RESERVED 0xC0
+
+// pcapng block types. A Section Header Block starts every pcapng file, so
+// its type doubles as the file magic number.
+#define PCAPNG_BLOCK_SHB 0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB 0x00000001
+#define PCAPNG_BLOCK_PB 0x00000002       // obsolete Packet Block
+#define PCAPNG_BLOCK_SPB 0x00000003
+#define PCAPNG_BLOCK_ISB 0x00000005
+#define PCAPNG_BLOCK_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+
+// Largest pcapng block accepted; anything bigger is taken as corruption
+#define PCAPNG_MAX_BLOCK_SIZE (1U << 28)
+
 // PCAP file header (24 bytes)
 typedef struct {
     uint32_t magic_number;   // magic number
@@ -34,4 +82,56 @@ typedef struct {
 // Function to register the pcap reader table function
 void RegisterPcapReaderFunction(duckdb_connection connection);
 
+// Register pcapng_interface_stats(path): one row per Interface Statistics
+// Block of a pcapng capture (none for classic pcap), read without touching
+// packet data
+void RegisterInterfaceStatsFunction(duckdb_connection connection);
+
+// Register pcap_gzip_index(path): the checkpoints of a gzip-compressed classic
+// pcap, one row per region, building the sidecar with a full scan if needed
+void RegisterGzipIndexFunction(duckdb_connection connection);
+
+// Bind data for table functions that take a capture path as their first parameter
+typedef struct {
+    char *filename;
+} pcap_path_bind_t;
+
+// Shared bind helpers for table functions that take a capture path as their
+// first parameter. PcapBindFilename returns a duckdb_malloc'd copy of the path
+// or NULL after setting a bind error. PcapBindPath also installs it as the
+// function's bind data.
+char *PcapBindFilename(duckdb_bind_info info);
+pcap_path_bind_t *PcapBindPath(duckdb_bind_info info);
+void PcapBindAddColumn(duckdb_bind_info info, const char *name, duckdb_type type);
+
+// Add a LIST(child_type) result column
+void PcapBindAddListColumn(duckdb_bind_info info, const char *name, duckdb_type child_type);
+
+// Add an ENUM result column with the given members (fewer than 256, so the
+// vector holds uint8_t member indexes)
+void PcapBindAddEnumColumn(duckdb_bind_info info, const char *name, const char *const *members, idx_t count);
+
+// Set a row of a LIST(VARCHAR) vector to the separator-delimited items of text
+void PcapListAssignSplit(duckdb_vector vector, idx_t row, const char *text, size_t len, char separator);
+
+// Register a table function whose single positional parameter is a capture path
+void PcapRegisterPathFunction(duckdb_connection connection, const char *name, duckdb_table_function_bind_t bind,
+                              duckdb_table_function_init_t init, duckdb_table_function_t function);
+
+// Set a row of a LIST(UINTEGER) vector
+void PcapListAssignU32(duckdb_vector vector, idx_t row, const uint32_t *values, idx_t count);
+
+// Mark a row of an output vector as NULL
+void PcapVectorSetNull(duckdb_vector vector, idx_t row);
+
+// Set a row of a VARCHAR vector to value, or to NULL when value is NULL or
+// empty
+void PcapVectorAssignString(duckdb_vector vector, idx_t row, const char *value);
+
+// Bytes of a BLOB or VARCHAR element
+const uint8_t *PcapStringBytes(duckdb_string_t *string, size_t *len);
+
+// Whether a row of an input vector is not NULL (validity may be NULL)
+int PcapRowValid(uint64_t *validity, idx_t row);
+
 #endif // PCAP_READER_H
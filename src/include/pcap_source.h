@@ -0,0 +1,118 @@
+#ifndef PCAP_SOURCE_H
+#define PCAP_SOURCE_H
+
+#include "capture_archive.h"
+#include "capture_index.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Bits of pcap_packet_t.present for the optional per-packet fields
+#define PCAP_PACKET_HAS_FLAGS 0x01
+#define PCAP_PACKET_HAS_DROP_COUNT 0x02
+
+// pcapng packet flags (epb_flags): inbound/outbound direction in the low two
+// bits, link-layer errors in the high byte
+#define PCAP_FLAGS_DIRECTION_MASK 0x00000003
+#define PCAP_FLAGS_INBOUND 1
+#define PCAP_FLAGS_OUTBOUND 2
+#define PCAP_FLAGS_CRC_ERROR 0x01000000
+
+// A single packet as returned by a capture source. The data pointer refers to
+// a buffer owned by the source and is only valid until the next call to
+// PcapSourceNext.
+typedef struct {
+    uint64_t timestamp_ns;   // packet timestamp in nanoseconds
+    uint32_t original_len;   // actual length of packet on the wire
+    uint32_t capture_len;    // number of octets of packet saved
+    uint32_t interface_id;   // capturing interface (ERF port, modified pcap ifindex); 0 in classic pcap
+    uint32_t link_type;      // data link type of the capturing interface
+    uint32_t flags;          // pcapng packet flags (PCAP_FLAGS_*), also mapped from ERF and modified pcap
+    uint32_t present;        // PCAP_PACKET_HAS_* bits: which of flags and drop_count are set
+    uint64_t drop_count;     // packets lost on the interface since the previous one
+    const uint8_t *data;     // captured bytes
+} pcap_packet_t;
+
+// Bits of pcap_interface_stats_t.present
+#define PCAP_STATS_START 0x01
+#define PCAP_STATS_END 0x02
+#define PCAP_STATS_RECEIVED 0x04
+#define PCAP_STATS_DROPPED 0x08
+#define PCAP_STATS_FILTER_ACCEPTED 0x10
+#define PCAP_STATS_OS_DROPPED 0x20
+#define PCAP_STATS_DELIVERED 0x40
+
+// Interface Statistics Block of a pcapng capture. Counters are only set when
+// their PCAP_STATS_* bit is in present; the name is valid until the next call
+// to PcapSourceNextStats.
+typedef struct {
+    uint32_t interface_id;
+    uint32_t link_type;
+    const char *interface_name;   // NULL when the interface has no if_name
+    uint64_t timestamp_ns;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t received;            // packets seen by the interface
+    uint64_t dropped;             // dropped by the interface for lack of resources
+    uint64_t filter_accepted;
+    uint64_t os_dropped;          // dropped by the operating system
+    uint64_t delivered;           // delivered to the capturing application
+    uint32_t present;
+} pcap_interface_stats_t;
+
+// Sequential reader over a capture file (or stdin)
+typedef struct pcap_source pcap_source_t;
+
+// Open a capture (classic or modified pcap, pcapng, snoop or ERF, optionally
+// gzip- or zstd-compressed) and validate its file header. A gzip-compressed
+// classic pcap gets its checkpoint index loaded, or built while it is read to
+// the end; a seekable zstd one gets the index of its seek table. A path into
+// a tar or zip archive (capture_archive.h) reads the matching members one
+// after another, passing over those that hold no capture. Returns NULL on
+// success and stores the new source in *out, otherwise returns a static
+// error message.
+const char *PcapSourceOpen(const char *filename, pcap_source_t **out);
+
+// PcapSourceOpen reading local files with the given page cache mode
+const char *PcapSourceOpenWithCache(const char *filename, capture_cache_t cache, pcap_source_t **out);
+
+// Open one region of a compressed classic pcap, using the checkpoint index of
+// another source of the same file. The source returns the region's
+// packets only.
+const char *PcapSourceOpenRegion(const char *filename, const capture_index_t *index, uint32_t region,
+                                 capture_cache_t cache, pcap_source_t **out);
+
+// Open one member of an archive listed by another source
+const char *PcapSourceOpenMember(const capture_archive_t *archive, uint32_t member, pcap_source_t **out);
+
+// Checkpoint index of a compressed classic pcap: a gzip one's, loaded from its
+// sidecar or complete once a first scan has read the file to the end, or a
+// seekable zstd one's; NULL otherwise
+const capture_index_t *PcapSourceIndex(const pcap_source_t *source);
+
+// Archive whose members PcapSourceOpenMember can open independently: a zip
+// or uncompressed tar. NULL for other sources.
+const capture_archive_t *PcapSourceArchive(const pcap_source_t *source);
+
+// Read the next packet. Returns 1 when a packet was read, 0 at end of file or
+// on a truncated record.
+int PcapSourceNext(pcap_source_t *source, pcap_packet_t *packet);
+
+// Read the next Interface Statistics Block, skipping over packet blocks
+// without reading their data. Returns 1 when one was read, 0 at end of file
+// (and right away for classic pcap, which has no statistics).
+int PcapSourceNextStats(pcap_source_t *source, pcap_interface_stats_t *stats);
+
+// Data link type (LINKTYPE_*) of the packets in this capture. For pcapng it
+// is the type of the first interface; packets carry their own.
+uint32_t PcapSourceLinkType(const pcap_source_t *source);
+
+// Whether the capture stores nanosecond-precision timestamps
+int PcapSourceIsNanosecond(const pcap_source_t *source);
+
+// Close the source, releasing the file handle and packet buffer
+void PcapSourceClose(pcap_source_t *source);
+
+// Returns 1 if the filename refers to standard input ("-" or "/dev/stdin")
+int PcapSourceIsStdin(const char *filename);
+
+#endif // PCAP_SOURCE_H
@@ -0,0 +1,25 @@
+#ifndef PCAPNG_WRITER_H
+#define PCAPNG_WRITER_H
+
+#include "duckdb_extension.h"
+
+// Packet blocks buffered per aggregate state and output file before they
+// are written out in one call
+#define PCAPNG_WRITE_BUFFER_SIZE (1 << 20)
+
+// Bytes buffered per aggregate state over all of its output files; past
+// this the fullest buffers are written out
+#define PCAPNG_PARTITION_BUFFER_BUDGET (16 << 20)
+
+// Longest packet comment written; longer ones are truncated
+#define PCAPNG_MAX_COMMENT 65535
+
+// Register the pcap_write_pcapng(path, timestamp_ns, data [, interface
+// [, comment [, link_type [, original_len]]]]) aggregate: writes each packet
+// to the pcapng file named by its path (SHB, one IDB per distinct interface
+// name, EPBs with optional comments) and returns the number written. The
+// original length defaults to the length of data. The path may
+// differ per row, which partitions a capture into many files in one pass.
+void RegisterPcapngWriterFunction(duckdb_connection connection);
+
+#endif // PCAPNG_WRITER_H
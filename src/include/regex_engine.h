@@ -0,0 +1,122 @@
+#ifndef REGEX_ENGINE_H
+#define REGEX_ENGINE_H
+
+#include "duckdb_extension.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compile flags (the PCRE options of the same letter)
+#define REGEX_NOCASE 0x01          // i
+#define REGEX_DOTALL 0x02          // s
+#define REGEX_MULTILINE 0x04       // m
+#define REGEX_EXTENDED 0x08        // x: whitespace and # comments are ignored
+#define REGEX_ANCHORED 0x10        // A: match only at the start of the input
+#define REGEX_UNGREEDY 0x20        // G/U: quantifiers are lazy unless followed by ?
+#define REGEX_DOLLAR_ENDONLY 0x40  // E: $ does not match before a final newline
+
+// Capture groups, including group 0 for the whole match
+#define REGEX_MAX_GROUPS 16
+
+// Compiled program size; bounds the expansion of counted repetition
+#define REGEX_MAX_INSTRUCTIONS 20000
+
+// Largest count accepted in {n,m}
+#define REGEX_MAX_REPEAT 1000
+
+// Patterns in one program built by RegexCompileSet
+#define REGEX_MAX_PATTERNS 65536
+
+// Memory for the cached states of a lazy DFA; when it runs out the cache
+// is rebuilt with only the states still in use
+#define REGEX_DFA_CACHE_BYTES (8 << 20)
+
+// Byte-oriented regular expressions with Perl syntax: classes, escapes,
+// alternation, groups, greedy and lazy quantifiers, anchors and word
+// boundaries. Backreferences and lookaround are not supported. Matching runs
+// in time linear in the input (Thompson NFA simulation).
+typedef struct regex_prog_s regex_prog_t;
+
+// Leftmost-first match; offsets of unset groups are SIZE_MAX
+typedef struct {
+    size_t start[REGEX_MAX_GROUPS];
+    size_t end[REGEX_MAX_GROUPS];
+} regex_match_t;
+
+typedef struct {
+    const char *pattern;
+    size_t len;
+    uint32_t flags;
+} regex_pattern_t;
+
+// Compile pattern. Returns NULL on success or a static error message.
+const char *RegexCompile(const char *pattern, size_t len, uint32_t flags, regex_prog_t **out);
+
+// Compile several patterns into one program for a lazy DFA, which reports
+// matches by pattern index. Each pattern keeps its own flags.
+const char *RegexCompileSet(const regex_pattern_t *patterns, size_t count, regex_prog_t **out);
+
+void RegexFree(regex_prog_t *prog);
+
+// Number of groups including group 0
+uint32_t RegexGroupCount(const regex_prog_t *prog);
+
+uint32_t RegexPatternCount(const regex_prog_t *prog);
+
+// Shortest and longest match of a pattern; max is UINT32_MAX when unbounded
+void RegexPatternLength(const regex_prog_t *prog, uint32_t pattern, uint32_t *min, uint32_t *max);
+
+// Copy up to capacity bytes that every match of a single unanchored pattern
+// starts with into prefix; returns their number. Matches can only start
+// where the prefix occurs, so a search may begin at its first occurrence.
+size_t RegexLiteralPrefix(const regex_prog_t *prog, uint8_t *prefix, size_t capacity);
+
+// Search data for the first match. With match NULL the search stops at the
+// first position where any match ends. Returns 1 on a match, 0 if there is
+// none and -1 if memory is exhausted.
+int RegexSearch(const regex_prog_t *prog, const uint8_t *data, size_t len, regex_match_t *match);
+
+// Lazy DFA over a program: states are built on first use and cached, so
+// scanning costs one table lookup per byte once the cache is warm. Every
+// pattern is reported at each position where one of its matches ends.
+// Input can arrive in chunks; the only per-input state is a uint32_t.
+// Assertions see the byte after the position, so matches are reported when
+// the following byte (or the end of input) is consumed.
+typedef struct regex_dfa_s regex_dfa_t;
+
+// State at the start of an input
+#define REGEX_DFA_START 0
+
+// Called for each match with its end offset relative to the scanned data.
+// Returning nonzero stops the scan.
+typedef int (*regex_dfa_match_t)(void *context, uint32_t pattern, size_t end);
+
+// Visit every state a caller keeps between scans (see RegexDfaSetRoots)
+typedef void (*regex_dfa_visit_t)(void *visitor, uint32_t *state);
+typedef void (*regex_dfa_roots_t)(void *context, regex_dfa_visit_t visit, void *visitor);
+
+// Create a DFA for prog, which must outlive it. Returns NULL on success or
+// a static error message.
+const char *RegexDfaCreate(const regex_prog_t *prog, regex_dfa_t **out);
+void RegexDfaFree(regex_dfa_t *dfa);
+
+// Callers that keep states of many inputs between scans register a function
+// enumerating them; when the cache is rebuilt those states are kept and
+// renumbered in place. Without it only the state of the running scan
+// survives a rebuild.
+void RegexDfaSetRoots(regex_dfa_t *dfa, regex_dfa_roots_t roots, void *context);
+
+// State to continue from after input was lost: no match in progress and not
+// at the start of the input
+uint32_t RegexDfaResumeState(regex_dfa_t *dfa);
+
+// Run data through the DFA from *state and update it. Returns 1 when all
+// data was consumed, 0 when the callback stopped the scan and -1 when
+// memory is exhausted.
+int RegexDfaScan(regex_dfa_t *dfa, uint32_t *state, const uint8_t *data, size_t len, regex_dfa_match_t callback,
+                 void *context);
+
+// Report the matches that end at the end of input; end is passed through to
+// the callback. Returns like RegexDfaScan.
+int RegexDfaFinish(regex_dfa_t *dfa, uint32_t state, size_t end, regex_dfa_match_t callback, void *context);
+
+#endif // REGEX_ENGINE_H
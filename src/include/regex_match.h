@@ -0,0 +1,20 @@
+#ifndef REGEX_MATCH_H
+#define REGEX_MATCH_H
+
+#include "duckdb_extension.h"
+
+// Compiled patterns (each with its lazy DFA) kept per function; the least
+// recently used one is dropped when a new pattern needs a slot. Threads
+// scanning with the same pattern at once each get their own entry.
+#define REGEX_MATCH_CACHE_ENTRIES 16
+
+// Longest literal prefix used to skip to candidate match positions
+#define REGEX_MATCH_PREFIX_BYTES 16
+
+// Register the scalar functions pcap_regex_match(data, pattern) -> BOOLEAN
+// and pcap_regex_extract(data, pattern [, group]) -> BLOB. data is a BLOB
+// or VARCHAR and is matched byte by byte, so payloads need no cast and
+// invalid UTF-8 is fine.
+void RegisterRegexFunctions(duckdb_connection connection);
+
+#endif // REGEX_MATCH_H
@@ -0,0 +1,23 @@
+#ifndef ROUTING_PROTOCOLS_H
+#define ROUTING_PROTOCOLS_H
+
+#include "duckdb_extension.h"
+
+#define BGP_PORT 179
+
+// BGP messages up to the extended message size (RFC 8654)
+#define BGP_MAX_MESSAGE 65535
+
+// Longest AS path returned per prefix; longer paths are truncated
+#define BGP_MAX_AS_PATH 4096
+
+// Register pcap_bgp(path): one row per announced or withdrawn prefix of each
+// UPDATE (IPv4 NLRI and MP-BGP IPv4/IPv6 unicast and multicast) with its path
+// attributes, and one row for every other message
+void RegisterBgpFunction(duckdb_connection connection);
+
+// Register pcap_ospf(path): one row per OSPFv2/v3 packet, or per LSA for Link
+// State Updates, with hello parameters and advertised prefixes
+void RegisterOspfFunction(duckdb_connection connection);
+
+#endif // ROUTING_PROTOCOLS_H
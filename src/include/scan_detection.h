@@ -0,0 +1,31 @@
+#ifndef SCAN_DETECTION_H
+#define SCAN_DETECTION_H
+
+#include "duckdb_extension.h"
+
+// Defaults of the window_seconds, scan_threshold and flood_threshold
+// parameters
+#define SCAN_DEFAULT_WINDOW_SECONDS 60
+#define SCAN_DEFAULT_THRESHOLD 100
+#define SCAN_DEFAULT_FLOOD_THRESHOLD 1000
+
+// HyperLogLog registers per distinct-count sketch (standard error about
+// 1.04 / sqrt(registers), 13%); small counts use linear counting over the
+// empty registers, i.e. the sketch acts as a bitmap
+#define SCAN_HLL_REGISTERS 64
+
+// Tracked sources and flood targets. Both tables are 4-way set associative
+// and allocated up front, which bounds memory (about 30 MB) however many
+// addresses a capture holds; a new address evicts the least recently
+// active one in its set, ending any alert in progress for it.
+#define SCAN_SOURCE_SLOTS (1 << 16)
+#define SCAN_TARGET_SLOTS (1 << 14)
+#define SCAN_WAYS 4
+
+// Register pcap_scans(path [, window_seconds, scan_threshold,
+// flood_threshold]): per-source sketches of distinct destination hosts and
+// ports probed, and per-destination SYN counts and distinct sources, over a
+// sliding window; one row per port scan, host sweep or SYN flood episode
+void RegisterScansFunction(duckdb_connection connection);
+
+#endif // SCAN_DETECTION_H
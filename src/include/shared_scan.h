@@ -0,0 +1,41 @@
+#ifndef SHARED_SCAN_H
+#define SHARED_SCAN_H
+
+#include "capture_file.h"
+#include "pcap_source.h"
+#include <stdint.h>
+
+// Sequential scans of one capture shared by concurrent readers, so that the
+// file is read and decoded once for all of them. The capture is read in
+// batches of SHARED_SCAN_BATCH_PACKETS packets, the last SHARED_SCAN_BATCHES
+// of which are kept for the readers. Whichever reader needs the next batch
+// first reads it. At the end of the capture the scan starts over from the
+// beginning: a reader joining a scan in progress starts at a recent batch,
+// reads to the end and wraps around to where it joined, so every reader sees
+// every packet once, in an order that depends on when it joined.
+//
+// Readers never wait for each other. One that falls more than
+// SHARED_SCAN_BATCHES behind the scan reads the capture again on its own,
+// passing over the batches it already returned.
+
+#define SHARED_SCAN_BATCH_PACKETS 2048
+#define SHARED_SCAN_BATCHES 16
+
+typedef struct shared_reader shared_reader_t;
+
+// Join the scan of filename with the given cache mode, starting one if there
+// is none. source is a freshly opened source of the capture, which the new
+// scan takes over (or which is closed when joining a scan in progress).
+// Returns NULL on success and stores the reader in *out, otherwise returns a
+// static error message.
+const char *SharedScanJoin(const char *filename, capture_cache_t cache, pcap_source_t *source,
+                           shared_reader_t **out);
+
+// Read the reader's next packet, valid until the next call. Returns 0 once
+// the reader has seen the whole capture.
+int SharedScanNext(shared_reader_t *reader, pcap_packet_t *packet);
+
+// Leave the scan, which ends with its last reader
+void SharedScanLeave(shared_reader_t *reader);
+
+#endif // SHARED_SCAN_H
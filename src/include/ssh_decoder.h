@@ -0,0 +1,17 @@
+#ifndef SSH_DECODER_H
+#define SSH_DECODER_H
+
+#include "duckdb_extension.h"
+
+// Largest unencrypted handshake backlog buffered per direction; a session that
+// exceeds it is reported without KEXINIT details
+#define SSH_MAX_HANDSHAKE_BUFFER 65536
+
+// Largest version banner kept (RFC 4253 limits it to 255 characters)
+#define SSH_MAX_BANNER 256
+
+// Register pcap_ssh(path): one row per SSH session with banners, KEXINIT
+// algorithm lists, HASSH/HASSHServer fingerprints and encrypted byte counts
+void RegisterSshFunction(duckdb_connection connection);
+
+#endif // SSH_DECODER_H
@@ -0,0 +1,77 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+// Minimal mutex and condition variable for state shared between queries and
+// threads (statically initialised, so shared tables need no setup call)
+#ifdef _WIN32
+#include <stdint.h>
+#include <windows.h>
+
+typedef SRWLOCK pcap_mutex_t;
+#define PCAP_MUTEX_INITIALIZER SRWLOCK_INIT
+
+typedef CONDITION_VARIABLE pcap_cond_t;
+#define PCAP_COND_INITIALIZER CONDITION_VARIABLE_INIT
+
+static inline void PcapMutexLock(pcap_mutex_t *mutex) {
+    AcquireSRWLockExclusive(mutex);
+}
+
+static inline void PcapMutexUnlock(pcap_mutex_t *mutex) {
+    ReleaseSRWLockExclusive(mutex);
+}
+
+// Wait until woken or until the clock of PcapClockMs passes deadline_ms
+static inline void PcapCondWaitUntil(pcap_cond_t *cond, pcap_mutex_t *mutex, uint64_t deadline_ms) {
+    ULONGLONG now = GetTickCount64();
+    SleepConditionVariableSRW(cond, mutex, deadline_ms > now ? (DWORD)(deadline_ms - now) : 0, 0);
+}
+
+static inline void PcapCondBroadcast(pcap_cond_t *cond) {
+    WakeAllConditionVariable(cond);
+}
+
+// Milliseconds on the clock timed waits use
+static inline uint64_t PcapClockMs(void) {
+    return GetTickCount64();
+}
+#else
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef pthread_mutex_t pcap_mutex_t;
+#define PCAP_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+typedef pthread_cond_t pcap_cond_t;
+#define PCAP_COND_INITIALIZER PTHREAD_COND_INITIALIZER
+
+static inline void PcapMutexLock(pcap_mutex_t *mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static inline void PcapMutexUnlock(pcap_mutex_t *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+// Wait until woken or until the clock of PcapClockMs passes deadline_ms
+static inline void PcapCondWaitUntil(pcap_cond_t *cond, pcap_mutex_t *mutex, uint64_t deadline_ms) {
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)(deadline_ms / 1000);
+    deadline.tv_nsec = (long)(deadline_ms % 1000) * 1000000L;
+    pthread_cond_timedwait(cond, mutex, &deadline);
+}
+
+static inline void PcapCondBroadcast(pcap_cond_t *cond) {
+    pthread_cond_broadcast(cond);
+}
+
+// Milliseconds on the clock timed waits use
+static inline uint64_t PcapClockMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+#endif
+
+#endif // SYNC_H
@@ -0,0 +1,23 @@
+#ifndef TIMING_PROTOCOLS_H
+#define TIMING_PROTOCOLS_H
+
+#include "duckdb_extension.h"
+
+// PTP (IEEE 1588) UDP ports
+#define PTP_EVENT_PORT 319
+#define PTP_GENERAL_PORT 320
+
+// NTP UDP port
+#define NTP_PORT 123
+
+// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+#define NTP_UNIX_EPOCH_OFFSET 2208988800ULL
+
+// Register pcap_ptp(path): one row per PTP message with offset and path delay
+// estimates on the messages that complete a Sync/Delay_Req or Pdelay exchange
+void RegisterPtpFunction(duckdb_connection connection);
+
+// Register pcap_ntp(path): one row per NTP packet with decoded timestamps
+void RegisterNtpFunction(duckdb_connection connection);
+
+#endif // TIMING_PROTOCOLS_H
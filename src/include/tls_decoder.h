@@ -0,0 +1,25 @@
+#ifndef TLS_DECODER_H
+#define TLS_DECODER_H
+
+#include "duckdb_extension.h"
+
+// Largest TLSCiphertext fragment (RFC 5246 section 6.2.3)
+#define TLS_MAX_RECORD_BODY (16384 + 2048)
+
+// Handshake bytes buffered per direction while reassembling handshake
+// messages; a certificate chain larger than this disables 1.3 key tracking
+#define TLS_MAX_HANDSHAKE_BUFFER 262144
+
+// Connections tracked at once; records of further connections are still
+// reported but not decrypted
+#define TLS_MAX_SESSIONS 65536
+
+// Longest server_name kept from the ClientHello
+#define TLS_MAX_SERVER_NAME 256
+
+// Register pcap_tls(path, keylog := ...): one row per TLS record on any TCP
+// port. Given an NSS key log file, TLS 1.2 and 1.3 records protected with
+// AES-GCM or ChaCha20-Poly1305 are decrypted into the plaintext column.
+void RegisterTlsFunction(duckdb_connection connection);
+
+#endif // TLS_DECODER_H
@@ -0,0 +1,30 @@
+#ifndef YARA_RULES_H
+#define YARA_RULES_H
+
+#include "duckdb_extension.h"
+
+// Largest rules file
+#define YARA_MAX_RULES_FILE (16 << 20)
+
+// Leading bytes of each TCP stream kept for uint8/16/32 conditions (only
+// when some rule uses them)
+#define YARA_PREFIX_BYTES 64
+
+// Distinct strings with matches, and satisfied at/in constraints, tracked
+// per stream; matches beyond that are not recorded
+#define YARA_MAX_STREAM_HITS 256
+
+// Flows with open streams; when the table fills up every open stream is
+// finished and the table starts over
+#define YARA_MAX_FLOWS (1 << 18)
+
+// Nesting of parentheses and not in conditions and hex strings
+#define YARA_MAX_DEPTH 64
+
+// Register pcap_yara(path, rules_file): run a subset of YARA rules over each
+// direction of the reassembled TCP streams and over UDP payloads, scanning
+// incrementally with one lazy DFA for all strings, and return one row per
+// matching rule and matched string.
+void RegisterYaraFunction(duckdb_connection connection);
+
+#endif // YARA_RULES_H
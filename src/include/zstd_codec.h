@@ -0,0 +1,67 @@
+#ifndef ZSTD_CODEC_H
+#define ZSTD_CODEC_H
+
+#include "capture_file.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Zstandard (RFC 8878) streaming decoder and frame encoder. The decoder
+// handles concatenated frames and passes over skippable frames; frames that
+// need a dictionary are rejected, and content checksums are skipped rather
+// than verified. Decoding can restart at any frame boundary, since frames do
+// not refer to each other. The encoder writes one single-segment frame per
+// call, with greedy hash-chain matching, Huffman-coded literals and sequences
+// in the predefined FSE tables.
+
+#define ZSTD_MAGIC 0xFD2FB528u
+
+// Skippable frames have any magic in 0x184D2A50..0x184D2A5F
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A50u
+#define ZSTD_SKIPPABLE_MASK 0xFFFFFFF0u
+
+// Largest block, in decoded bytes and in compressed bytes
+#define ZSTD_BLOCK_SIZE_MAX (128 << 10)
+
+// Largest window decoded, as with the reference decoder's default limit
+#define ZSTD_WINDOW_SIZE_MAX (1u << 27)
+
+typedef struct zstd_stream zstd_stream_t;
+
+// Start decoding a zstd file. The stream reads from file, which must be
+// positioned right after the prefix_len bytes in prefix (the bytes already
+// consumed while detecting the format, at most 16). Returns NULL when out of
+// memory.
+zstd_stream_t *ZstdOpen(capture_file_t *file, const uint8_t *prefix, size_t prefix_len);
+
+// Resume decoding at the frame starting at compressed offset in_offset.
+// Returns 0 when the file cannot be positioned.
+int ZstdSeek(zstd_stream_t *stream, uint64_t in_offset);
+
+// Decode up to len bytes into buffer (or discard them when buffer is NULL).
+// Returns the number of bytes produced, which is less than len only at the
+// end of the data or on a corrupt stream.
+size_t ZstdRead(zstd_stream_t *stream, uint8_t *buffer, size_t len);
+
+// Whether the last frame ended cleanly (rather than on truncated or corrupt
+// data)
+int ZstdFinished(const zstd_stream_t *stream);
+
+void ZstdClose(zstd_stream_t *stream);
+
+typedef struct zstd_encoder zstd_encoder_t;
+
+// Match finder state, reusable across frames. Returns NULL when out of
+// memory.
+zstd_encoder_t *ZstdEncoderCreate(void);
+
+// Size of the output buffer ZstdCompressFrame needs for len input bytes
+size_t ZstdFrameBound(size_t len);
+
+// Compress len bytes (at most UINT32_MAX) into one frame at dst, which must
+// hold ZstdFrameBound(len) bytes. Returns the frame size, or 0 when out of
+// memory.
+size_t ZstdCompressFrame(zstd_encoder_t *encoder, const uint8_t *src, size_t len, uint8_t *dst);
+
+void ZstdEncoderFree(zstd_encoder_t *encoder);
+
+#endif // ZSTD_CODEC_H
@@ -0,0 +1,46 @@
+#ifndef ZSTD_SEEKABLE_H
+#define ZSTD_SEEKABLE_H
+
+#include "capture_file.h"
+#include "capture_index.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Seekable zstd captures: a classic pcap compressed as independent frames,
+// each holding whole records, followed by a time index and the seek table of
+// the Zstandard seekable format. Both are skippable frames, so any zstd
+// decoder still reads the file as one capture, and seekable-format tools see
+// a regular seek table. The time index sits just before it:
+//
+//   skippable frame header (ZSTD_TIME_INDEX_MAGIC, content size)
+//   ZSTD_TIME_INDEX_TAG, frame count (u32), reserved (u32)
+//   per frame: packets, min and max timestamp in nanoseconds (u64 each)
+//
+// All integers are little-endian. Frames without packets store zero
+// timestamps.
+
+#define ZSTD_SEEK_TABLE_MAGIC 0x184D2A5Eu
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1u
+#define ZSTD_TIME_INDEX_MAGIC 0x184D2A5Cu
+#define ZSTD_TIME_INDEX_TAG "PCAPTIX1"
+
+typedef struct {
+    uint32_t compressed_size;
+    uint32_t decompressed_size;
+    uint64_t packets;
+    uint64_t min_timestamp_ns;
+    uint64_t max_timestamp_ns;
+} zstd_seekable_frame_t;
+
+// Append the time index and seek table describing frames to file. Returns 0
+// on a write error.
+int ZstdSeekableWriteTables(FILE *file, const zstd_seekable_frame_t *frames, uint32_t count);
+
+// Region index of a seekable zstd capture whose first record is at
+// first_record: every frame that starts past it opens a region. Reads the
+// tables at the end of the open file and restores its position. Returns NULL
+// when the file has no time index or its tables do not match the file.
+capture_index_t *ZstdSeekableLoad(capture_file_t *file, uint64_t first_record);
+
+#endif // ZSTD_SEEKABLE_H
@@ -0,0 +1,22 @@
+#ifndef ZSTD_WRITER_H
+#define ZSTD_WRITER_H
+
+#include "duckdb_extension.h"
+
+// Uncompressed bytes of pcap records per zstd frame. Frames hold whole
+// records, so one larger than this gets a frame of its own.
+#define ZSTD_WRITER_FRAME_SIZE (1 << 20)
+
+// Bytes buffered per aggregate state over all of its output files; past
+// this the fullest partial frames are compressed and written out early
+#define ZSTD_WRITER_BUFFER_BUDGET (16 << 20)
+
+// Register the pcap_write_zstd(path, timestamp_ns, data [, link_type
+// [, original_len]]) aggregate: writes each packet to a seekable zstd capture (zstd_seekable.h)
+// named by its path, a nanosecond classic pcap compressed in independent
+// frames with per-frame timestamp ranges, and returns the number written.
+// read_pcap scans such files in parallel and skips frames outside its time
+// window. The path may differ per row; each file has a single link type.
+void RegisterZstdWriterFunction(duckdb_connection connection);
+
+#endif // ZSTD_WRITER_H
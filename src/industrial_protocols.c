@@ -0,0 +1,879 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "industrial_protocols.h"
+#include "message_stream.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Modbus/TCP application protocol header
+#define MBAP_HEADER_LEN 7
+#define MODBUS_MAX_ADU 260
+
+// DNP3 link layer frames: 10-byte header block, then user data in blocks of
+// up to 16 bytes, every block followed by a CRC
+#define DNP3_START_0 0x05
+#define DNP3_START_1 0x64
+#define DNP3_HEADER_LEN 10
+#define DNP3_MAX_FRAME 292
+#define DNP3_MAX_USER_DATA 250
+#define DNP3_TRANSPORT_FIR 0x40
+#define DNP3_CONTROL_DIR 0x80
+#define DNP3_FC_CONFIRM 0
+#define DNP3_FC_RESPONSE 129
+#define DNP3_FC_UNSOLICITED 130
+
+// S7comm in COTP data TPDUs in TPKT (RFC 1006)
+#define TPKT_VERSION 3
+#define TPKT_HEADER_LEN 4
+#define TPKT_MAX_LEN 65535
+#define COTP_DT 0xF0
+#define S7COMM_PROTOCOL_ID 0x32
+#define S7_JOB 1
+#define S7_ACK 2
+#define S7_ACK_DATA 3
+#define S7_USERDATA 7
+#define S7_FC_READ_VAR 0x04
+#define S7_FC_WRITE_VAR 0x05
+
+// Columns shared by all industrial protocol functions
+enum {
+    OT_COL_TIMESTAMP,
+    OT_COL_SRC_IP,
+    OT_COL_SRC_PORT,
+    OT_COL_DST_IP,
+    OT_COL_DST_PORT,
+    OT_COMMON_COLS
+};
+
+// Outstanding request, keyed by flow and protocol transaction identifier
+typedef struct {
+    flow_key_t key;
+    uint32_t id;
+} ot_request_key_t;
+
+typedef struct {
+    uint64_t timestamp_ns;
+    uint32_t start;
+    uint32_t quantity;
+    uint16_t db_number;
+    uint8_t area;
+    uint8_t has_range;
+} ot_request_t;
+
+typedef struct {
+    message_stream_t *stream;
+    hash_map_t requests;   // ot_request_key_t -> ot_request_t
+} ot_state_t;
+
+static void OtInitDataFree(void *data) {
+    ot_state_t *state = (ot_state_t *)data;
+    if (state) {
+        MessageStreamClose(state->stream);
+        HashMapDestroy(&state->requests);
+        duckdb_free(state);
+    }
+}
+
+static void OtInit(duckdb_init_info info, const message_protocol_t *protocol) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    ot_state_t *state = (ot_state_t *)duckdb_malloc(sizeof(ot_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(ot_state_t));
+    if (!HashMapInit(&state->requests, sizeof(ot_request_key_t), sizeof(ot_request_t))) {
+        OtInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = MessageStreamOpen(bind->filename, protocol, &state->stream);
+    if (error) {
+        OtInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, OtInitDataFree);
+}
+
+static void RememberRequest(ot_state_t *state, const message_t *msg, uint32_t id, const ot_request_t *request) {
+    ot_request_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.key = *msg->key;
+    key.id = id;
+    if (state->requests.count >= OT_MAX_PENDING_REQUESTS && !HashMapFind(&state->requests, &key)) {
+        return;
+    }
+    int is_new;
+    ot_request_t *slot = (ot_request_t *)HashMapInsert(&state->requests, &key, &is_new);
+    if (slot) {
+        *slot = *request;
+        slot->timestamp_ns = msg->timestamp_ns;
+    }
+}
+
+// Find and forget the request a response answers
+static int TakeRequest(ot_state_t *state, const message_t *msg, uint32_t id, ot_request_t *out) {
+    ot_request_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.key = *msg->key;
+    key.id = id;
+    ot_request_t *request = (ot_request_t *)HashMapFind(&state->requests, &key);
+    if (!request) {
+        return 0;
+    }
+    *out = *request;
+    HashMapRemove(&state->requests, &key);
+    return 1;
+}
+
+static void OtBindCommon(duckdb_bind_info info) {
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+}
+
+static void OtAssignCommon(duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    char addr[64];
+    uint16_t port;
+    ((uint64_t *)duckdb_vector_get_data(vectors[OT_COL_TIMESTAMP]))[row] = msg->timestamp_ns;
+    FlowFormatEndpoint(msg->key, msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[OT_COL_SRC_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[OT_COL_SRC_PORT]))[row] = port;
+    FlowFormatEndpoint(msg->key, 1 - msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[OT_COL_DST_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[OT_COL_DST_PORT]))[row] = port;
+}
+
+// Request timestamp and latency columns of a response row
+static void AssignPairing(duckdb_vector ts_vector, duckdb_vector latency_vector, idx_t row, const message_t *msg,
+                          const ot_request_t *request) {
+    if (!request) {
+        PcapVectorSetNull(ts_vector, row);
+        PcapVectorSetNull(latency_vector, row);
+        return;
+    }
+    ((uint64_t *)duckdb_vector_get_data(ts_vector))[row] = request->timestamp_ns;
+    ((int64_t *)duckdb_vector_get_data(latency_vector))[row] =
+        (int64_t)(msg->timestamp_ns - request->timestamp_ns);
+}
+
+static void AssignU8(duckdb_vector vector, idx_t row, uint8_t value, int valid) {
+    if (valid) {
+        ((uint8_t *)duckdb_vector_get_data(vector))[row] = value;
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+static void AssignU16(duckdb_vector vector, idx_t row, uint16_t value, int valid) {
+    if (valid) {
+        ((uint16_t *)duckdb_vector_get_data(vector))[row] = value;
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+static void AssignU32(duckdb_vector vector, idx_t row, uint32_t value, int valid) {
+    if (valid) {
+        ((uint32_t *)duckdb_vector_get_data(vector))[row] = value;
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Modbus/TCP
+// ---------------------------------------------------------------------------
+
+enum {
+    MODBUS_COL_TRANSACTION_ID = OT_COMMON_COLS,
+    MODBUS_COL_UNIT_ID,
+    MODBUS_COL_FUNCTION_CODE,
+    MODBUS_COL_FUNCTION_NAME,
+    MODBUS_COL_IS_RESPONSE,
+    MODBUS_COL_START_ADDRESS,
+    MODBUS_COL_QUANTITY,
+    MODBUS_COL_EXCEPTION_CODE,
+    MODBUS_COL_EXCEPTION_NAME,
+    MODBUS_COL_REQUEST_TS,
+    MODBUS_COL_RESPONSE_TIME,
+    MODBUS_COL_COUNT
+};
+
+static const char *ModbusFunctionName(uint8_t function_code) {
+    switch (function_code) {
+    case 1: return "read_coils";
+    case 2: return "read_discrete_inputs";
+    case 3: return "read_holding_registers";
+    case 4: return "read_input_registers";
+    case 5: return "write_single_coil";
+    case 6: return "write_single_register";
+    case 7: return "read_exception_status";
+    case 8: return "diagnostics";
+    case 11: return "get_comm_event_counter";
+    case 12: return "get_comm_event_log";
+    case 15: return "write_multiple_coils";
+    case 16: return "write_multiple_registers";
+    case 17: return "report_server_id";
+    case 20: return "read_file_record";
+    case 21: return "write_file_record";
+    case 22: return "mask_write_register";
+    case 23: return "read_write_multiple_registers";
+    case 24: return "read_fifo_queue";
+    case 43: return "encapsulated_interface_transport";
+    default: return NULL;
+    }
+}
+
+static const char *ModbusExceptionName(uint8_t exception_code) {
+    switch (exception_code) {
+    case 1: return "illegal_function";
+    case 2: return "illegal_data_address";
+    case 3: return "illegal_data_value";
+    case 4: return "server_device_failure";
+    case 5: return "acknowledge";
+    case 6: return "server_device_busy";
+    case 8: return "memory_parity_error";
+    case 10: return "gateway_path_unavailable";
+    case 11: return "gateway_target_failed_to_respond";
+    default: return NULL;
+    }
+}
+
+static size_t ModbusFrame(const uint8_t *data, size_t avail) {
+    if (avail < 6) {
+        return 0;
+    }
+    uint16_t length = PacketRead16(data + 4);
+    // Protocol identifier 0 is Modbus; length covers unit id and PDU
+    if (PacketRead16(data + 2) != 0 || length < 2) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    return 6 + (size_t)length;
+}
+
+// Address range a request PDU operates on
+static int ModbusRequestRange(uint8_t function_code, const uint8_t *pdu, size_t pdu_len, ot_request_t *request) {
+    switch (function_code) {
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 15:
+    case 16:
+    case 23:  // the read half of read/write multiple registers
+        if (pdu_len < 4) {
+            return 0;
+        }
+        request->start = PacketRead16(pdu);
+        request->quantity = PacketRead16(pdu + 2);
+        return 1;
+    case 5:
+    case 6:
+    case 22:
+        if (pdu_len < 2) {
+            return 0;
+        }
+        request->start = PacketRead16(pdu);
+        request->quantity = 1;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void ModbusBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    OtBindCommon(info);
+    PcapBindAddColumn(info, "transaction_id", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "unit_id", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "function_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "function_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "is_response", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "start_address", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "quantity", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "exception_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "exception_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "request_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "response_time_ns", DUCKDB_TYPE_BIGINT);
+}
+
+static void ModbusInit(duckdb_init_info info) {
+    static const message_protocol_t protocol = {MODBUS_TCP_PORT, 0, ModbusFrame, MODBUS_MAX_ADU};
+    OtInit(info, &protocol);
+}
+
+static void ModbusEmit(ot_state_t *state, duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    uint16_t transaction_id = PacketRead16(msg->data);
+    uint8_t function_code = msg->data[MBAP_HEADER_LEN] & 0x7F;
+    int is_exception = (msg->data[MBAP_HEADER_LEN] & 0x80) != 0;
+    const uint8_t *pdu = msg->data + MBAP_HEADER_LEN + 1;
+    size_t pdu_len = msg->len - MBAP_HEADER_LEN - 1;
+    int is_response = !msg->to_server;
+
+    ot_request_t request;
+    memset(&request, 0, sizeof(request));
+    int has_request = 0;
+    if (is_response) {
+        has_request = TakeRequest(state, msg, transaction_id, &request);
+    } else {
+        request.has_range = (uint8_t)ModbusRequestRange(function_code, pdu, pdu_len, &request);
+        RememberRequest(state, msg, transaction_id, &request);
+    }
+
+    OtAssignCommon(vectors, row, msg);
+    ((uint16_t *)duckdb_vector_get_data(vectors[MODBUS_COL_TRANSACTION_ID]))[row] = transaction_id;
+    ((uint8_t *)duckdb_vector_get_data(vectors[MODBUS_COL_UNIT_ID]))[row] = msg->data[6];
+    ((uint8_t *)duckdb_vector_get_data(vectors[MODBUS_COL_FUNCTION_CODE]))[row] = function_code;
+    PcapVectorAssignString(vectors[MODBUS_COL_FUNCTION_NAME], row, ModbusFunctionName(function_code));
+    ((bool *)duckdb_vector_get_data(vectors[MODBUS_COL_IS_RESPONSE]))[row] = is_response;
+    AssignU16(vectors[MODBUS_COL_START_ADDRESS], row, (uint16_t)request.start, request.has_range);
+    AssignU16(vectors[MODBUS_COL_QUANTITY], row, (uint16_t)request.quantity, request.has_range);
+
+    int has_exception = is_response && is_exception && pdu_len >= 1;
+    uint8_t exception_code = has_exception ? pdu[0] : 0;
+    AssignU8(vectors[MODBUS_COL_EXCEPTION_CODE], row, exception_code, has_exception);
+    PcapVectorAssignString(vectors[MODBUS_COL_EXCEPTION_NAME], row,
+                         has_exception ? ModbusExceptionName(exception_code) : NULL);
+    AssignPairing(vectors[MODBUS_COL_REQUEST_TS], vectors[MODBUS_COL_RESPONSE_TIME], row, msg,
+                  has_request ? &request : NULL);
+}
+
+static void ModbusFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    ot_state_t *state = (ot_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[MODBUS_COL_COUNT];
+    for (idx_t i = 0; i < MODBUS_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    message_t msg;
+    while (row_count < max_rows && MessageStreamNext(state->stream, &msg)) {
+        if (msg.len < MBAP_HEADER_LEN + 1) {
+            continue;
+        }
+        ModbusEmit(state, vectors, row_count++, &msg);
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+// ---------------------------------------------------------------------------
+// DNP3
+// ---------------------------------------------------------------------------
+
+enum {
+    DNP3_COL_LINK_SRC = OT_COMMON_COLS,
+    DNP3_COL_LINK_DST,
+    DNP3_COL_FROM_MASTER,
+    DNP3_COL_SEQUENCE,
+    DNP3_COL_FUNCTION_CODE,
+    DNP3_COL_FUNCTION_NAME,
+    DNP3_COL_IS_RESPONSE,
+    DNP3_COL_IIN,
+    DNP3_COL_IIN_FLAGS,
+    DNP3_COL_OBJECT_GROUP,
+    DNP3_COL_OBJECT_VARIATION,
+    DNP3_COL_QUALIFIER,
+    DNP3_COL_RANGE_START,
+    DNP3_COL_RANGE_STOP,
+    DNP3_COL_OBJECT_COUNT,
+    DNP3_COL_REQUEST_TS,
+    DNP3_COL_RESPONSE_TIME,
+    DNP3_COL_COUNT
+};
+
+static const char *Dnp3FunctionName(uint8_t function_code) {
+    static const char *names[] = {
+        "confirm", "read", "write", "select", "operate", "direct_operate", "direct_operate_nr",
+        "immediate_freeze", "immediate_freeze_nr", "freeze_clear", "freeze_clear_nr", "freeze_at_time",
+        "freeze_at_time_nr", "cold_restart", "warm_restart", "initialize_data", "initialize_application",
+        "start_application", "stop_application", "save_configuration", "enable_unsolicited",
+        "disable_unsolicited", "assign_class", "delay_measure", "record_current_time", "open_file", "close_file",
+        "delete_file", "get_file_info", "authenticate_file", "abort_file", "activate_config", "authenticate_req",
+        "authenticate_err"};
+    if (function_code < sizeof(names) / sizeof(names[0])) {
+        return names[function_code];
+    }
+    switch (function_code) {
+    case 129: return "response";
+    case 130: return "unsolicited_response";
+    case 131: return "authenticate_resp";
+    default: return NULL;
+    }
+}
+
+// Internal indications, IIN1 in the high byte
+static const struct {
+    uint16_t bit;
+    const char *name;
+} dnp3_iin_flags[] = {
+    {0x0100, "broadcast"},         {0x0200, "class_1_events"},       {0x0400, "class_2_events"},
+    {0x0800, "class_3_events"},    {0x1000, "need_time"},            {0x2000, "local_control"},
+    {0x4000, "device_trouble"},    {0x8000, "device_restart"},       {0x0001, "no_func_code_support"},
+    {0x0002, "object_unknown"},    {0x0004, "parameter_error"},      {0x0008, "event_buffer_overflow"},
+    {0x0010, "already_executing"}, {0x0020, "config_corrupt"},
+};
+
+static uint16_t ReadLe16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadLe32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t Dnp3Frame(const uint8_t *data, size_t avail) {
+    if (avail < 3) {
+        return 0;
+    }
+    if (data[0] != DNP3_START_0 || data[1] != DNP3_START_1 || data[2] < 5) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    // The length byte counts control, addresses and user data, not CRCs
+    size_t user_len = (size_t)data[2] - 5;
+    return DNP3_HEADER_LEN + user_len + 2 * ((user_len + 15) / 16);
+}
+
+// Copy the user data out of a link frame, dropping the per-block CRCs
+static size_t Dnp3UserData(const message_t *msg, uint8_t *out) {
+    size_t user_len = (size_t)msg->data[2] - 5;
+    const uint8_t *block = msg->data + DNP3_HEADER_LEN;
+    size_t copied = 0;
+    while (copied < user_len) {
+        size_t take = user_len - copied < 16 ? user_len - copied : 16;
+        memcpy(out + copied, block, take);
+        copied += take;
+        block += take + 2;
+    }
+    return user_len;
+}
+
+static void Dnp3Bind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    OtBindCommon(info);
+    PcapBindAddColumn(info, "link_src", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "link_dst", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "from_master", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "sequence", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "function_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "function_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "is_response", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "iin", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddListColumn(info, "iin_flags", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "object_group", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "object_variation", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "qualifier", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "range_start", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "range_stop", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "object_count", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "request_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "response_time_ns", DUCKDB_TYPE_BIGINT);
+}
+
+static void Dnp3Init(duckdb_init_info info) {
+    static const message_protocol_t protocol = {DNP3_PORT, 1, Dnp3Frame, DNP3_MAX_FRAME};
+    OtInit(info, &protocol);
+}
+
+static void Dnp3AssignIinFlags(duckdb_vector vector, idx_t row, uint16_t iin) {
+    char flags[256];
+    size_t len = 0;
+    for (size_t i = 0; i < sizeof(dnp3_iin_flags) / sizeof(dnp3_iin_flags[0]); i++) {
+        if (iin & dnp3_iin_flags[i].bit) {
+            int written = snprintf(flags + len, sizeof(flags) - len, "%s%s", len ? "," : "", dnp3_iin_flags[i].name);
+            len += (size_t)written;
+        }
+    }
+    PcapListAssignSplit(vector, row, flags, len, ',');
+}
+
+// Decode the first object header of an application fragment
+static void Dnp3AssignObject(duckdb_vector *vectors, idx_t row, const uint8_t *objects, size_t len) {
+    int has_header = len >= 3;
+    uint8_t qualifier = has_header ? objects[2] : 0;
+    const uint8_t *range = objects + 3;
+    size_t range_len = has_header ? len - 3 : 0;
+    uint32_t start = 0, stop = 0, count = 0;
+    int has_range = 0, has_count = 0;
+
+    if (has_header) {
+        switch (qualifier & 0x0F) {
+        case 0x00:  // start/stop indices
+            has_range = range_len >= 2;
+            if (has_range) {
+                start = range[0];
+                stop = range[1];
+            }
+            break;
+        case 0x01:
+            has_range = range_len >= 4;
+            if (has_range) {
+                start = ReadLe16(range);
+                stop = ReadLe16(range + 2);
+            }
+            break;
+        case 0x02:
+            has_range = range_len >= 8;
+            if (has_range) {
+                start = ReadLe32(range);
+                stop = ReadLe32(range + 4);
+            }
+            break;
+        case 0x07:  // object count
+            has_count = range_len >= 1;
+            count = has_count ? range[0] : 0;
+            break;
+        case 0x08:
+            has_count = range_len >= 2;
+            count = has_count ? ReadLe16(range) : 0;
+            break;
+        case 0x09:
+            has_count = range_len >= 4;
+            count = has_count ? ReadLe32(range) : 0;
+            break;
+        default:  // 0x06: all objects, no range
+            break;
+        }
+    }
+    if (has_range && stop >= start) {
+        has_count = 1;
+        count = stop - start + 1;
+    }
+
+    AssignU8(vectors[DNP3_COL_OBJECT_GROUP], row, has_header ? objects[0] : 0, has_header);
+    AssignU8(vectors[DNP3_COL_OBJECT_VARIATION], row, has_header ? objects[1] : 0, has_header);
+    AssignU8(vectors[DNP3_COL_QUALIFIER], row, qualifier, has_header);
+    AssignU32(vectors[DNP3_COL_RANGE_START], row, start, has_range);
+    AssignU32(vectors[DNP3_COL_RANGE_STOP], row, stop, has_range);
+    AssignU32(vectors[DNP3_COL_OBJECT_COUNT], row, count, has_count);
+}
+
+// Emit the application fragment of a link frame. Returns 0 for frames without
+// one (link-layer only frames and non-first transport segments).
+static int Dnp3Emit(ot_state_t *state, duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    uint8_t user[DNP3_MAX_USER_DATA];
+    size_t user_len = Dnp3UserData(msg, user);
+    // Transport header, application control and function code
+    if (user_len < 3 || !(user[0] & DNP3_TRANSPORT_FIR)) {
+        return 0;
+    }
+    uint8_t sequence = user[1] & 0x0F;
+    uint8_t function_code = user[2];
+    int is_response = function_code >= DNP3_FC_RESPONSE;
+    size_t objects = is_response ? 5 : 3;
+    if (objects > user_len) {
+        return 0;
+    }
+
+    ot_request_t request;
+    int has_request = 0;
+    if (function_code == DNP3_FC_RESPONSE) {
+        has_request = TakeRequest(state, msg, sequence, &request);
+    } else if (!is_response && function_code != DNP3_FC_CONFIRM) {
+        memset(&request, 0, sizeof(request));
+        RememberRequest(state, msg, sequence, &request);
+    }
+
+    OtAssignCommon(vectors, row, msg);
+    ((uint16_t *)duckdb_vector_get_data(vectors[DNP3_COL_LINK_SRC]))[row] = ReadLe16(msg->data + 6);
+    ((uint16_t *)duckdb_vector_get_data(vectors[DNP3_COL_LINK_DST]))[row] = ReadLe16(msg->data + 4);
+    ((bool *)duckdb_vector_get_data(vectors[DNP3_COL_FROM_MASTER]))[row] = (msg->data[3] & DNP3_CONTROL_DIR) != 0;
+    ((uint8_t *)duckdb_vector_get_data(vectors[DNP3_COL_SEQUENCE]))[row] = sequence;
+    ((uint8_t *)duckdb_vector_get_data(vectors[DNP3_COL_FUNCTION_CODE]))[row] = function_code;
+    PcapVectorAssignString(vectors[DNP3_COL_FUNCTION_NAME], row, Dnp3FunctionName(function_code));
+    ((bool *)duckdb_vector_get_data(vectors[DNP3_COL_IS_RESPONSE]))[row] = is_response;
+    if (is_response) {
+        uint16_t iin = (uint16_t)((user[3] << 8) | user[4]);
+        ((uint16_t *)duckdb_vector_get_data(vectors[DNP3_COL_IIN]))[row] = iin;
+        Dnp3AssignIinFlags(vectors[DNP3_COL_IIN_FLAGS], row, iin);
+    } else {
+        PcapVectorSetNull(vectors[DNP3_COL_IIN], row);
+        PcapVectorSetNull(vectors[DNP3_COL_IIN_FLAGS], row);
+    }
+    Dnp3AssignObject(vectors, row, user + objects, user_len - objects);
+    AssignPairing(vectors[DNP3_COL_REQUEST_TS], vectors[DNP3_COL_RESPONSE_TIME], row, msg,
+                  has_request ? &request : NULL);
+    return 1;
+}
+
+static void Dnp3Function(duckdb_function_info info, duckdb_data_chunk output) {
+    ot_state_t *state = (ot_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[DNP3_COL_COUNT];
+    for (idx_t i = 0; i < DNP3_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    message_t msg;
+    while (row_count < max_rows && MessageStreamNext(state->stream, &msg)) {
+        if (Dnp3Emit(state, vectors, row_count, &msg)) {
+            row_count++;
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+// ---------------------------------------------------------------------------
+// S7comm
+// ---------------------------------------------------------------------------
+
+enum {
+    S7_COL_ROSCTR = OT_COMMON_COLS,
+    S7_COL_MESSAGE_TYPE,
+    S7_COL_PDU_REFERENCE,
+    S7_COL_FUNCTION_CODE,
+    S7_COL_FUNCTION_NAME,
+    S7_COL_IS_RESPONSE,
+    S7_COL_ITEM_COUNT,
+    S7_COL_AREA,
+    S7_COL_DB_NUMBER,
+    S7_COL_START_ADDRESS,
+    S7_COL_QUANTITY,
+    S7_COL_ERROR_CLASS,
+    S7_COL_ERROR_CODE,
+    S7_COL_RETURN_CODE,
+    S7_COL_REQUEST_TS,
+    S7_COL_RESPONSE_TIME,
+    S7_COL_COUNT
+};
+
+static const char *S7MessageTypeName(uint8_t rosctr) {
+    switch (rosctr) {
+    case S7_JOB: return "job";
+    case S7_ACK: return "ack";
+    case S7_ACK_DATA: return "ack_data";
+    case S7_USERDATA: return "userdata";
+    default: return NULL;
+    }
+}
+
+static const char *S7FunctionName(uint8_t function_code) {
+    switch (function_code) {
+    case 0x00: return "cpu_services";
+    case 0x04: return "read_var";
+    case 0x05: return "write_var";
+    case 0x1A: return "request_download";
+    case 0x1B: return "download_block";
+    case 0x1C: return "download_ended";
+    case 0x1D: return "start_upload";
+    case 0x1E: return "upload";
+    case 0x1F: return "end_upload";
+    case 0x28: return "pi_service";
+    case 0x29: return "plc_stop";
+    case 0xF0: return "setup_communication";
+    default: return NULL;
+    }
+}
+
+// Userdata PDUs carry a function group instead of a function code
+static const char *S7UserdataGroupName(uint8_t group) {
+    switch (group) {
+    case 0x1: return "programmer_commands";
+    case 0x2: return "cyclic_data";
+    case 0x3: return "block_functions";
+    case 0x4: return "cpu_functions";
+    case 0x5: return "security";
+    case 0x6: return "pbc_bsend";
+    case 0x7: return "time_functions";
+    case 0xF: return "ncprg";
+    default: return NULL;
+    }
+}
+
+static const char *S7AreaName(uint8_t area) {
+    switch (area) {
+    case 0x03: return "system_info";
+    case 0x05: return "system_flags";
+    case 0x06: return "analog_inputs";
+    case 0x07: return "analog_outputs";
+    case 0x1C: return "counter";
+    case 0x1D: return "timer";
+    case 0x80: return "peripheral";
+    case 0x81: return "inputs";
+    case 0x82: return "outputs";
+    case 0x83: return "flags";
+    case 0x84: return "data_block";
+    case 0x85: return "instance_data_block";
+    case 0x86: return "local_data";
+    default: return NULL;
+    }
+}
+
+static size_t TpktFrame(const uint8_t *data, size_t avail) {
+    if (avail < TPKT_HEADER_LEN) {
+        return 0;
+    }
+    uint16_t length = PacketRead16(data + 2);
+    if (data[0] != TPKT_VERSION || length < TPKT_HEADER_LEN + 3) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    return length;
+}
+
+static void S7commBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    OtBindCommon(info);
+    PcapBindAddColumn(info, "rosctr", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "message_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "pdu_reference", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "function_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "function_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "is_response", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "item_count", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "area", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "db_number", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "start_address", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "quantity", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "error_class", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "error_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "return_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "request_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "response_time_ns", DUCKDB_TYPE_BIGINT);
+}
+
+static void S7commInit(duckdb_init_info info) {
+    static const message_protocol_t protocol = {S7COMM_PORT, 0, TpktFrame, TPKT_MAX_LEN};
+    OtInit(info, &protocol);
+}
+
+// Emit the S7comm PDU of a TPKT. Returns 0 for connection management TPDUs
+// and other protocols (such as S7comm-plus) on the same port.
+static int S7commEmit(ot_state_t *state, duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    const uint8_t *cotp = msg->data + TPKT_HEADER_LEN;
+    size_t cotp_len = (size_t)cotp[0] + 1;
+    if ((cotp[1] & 0xF0) != COTP_DT || TPKT_HEADER_LEN + cotp_len + 10 > msg->len) {
+        return 0;
+    }
+    const uint8_t *s7 = cotp + cotp_len;
+    size_t s7_len = msg->len - TPKT_HEADER_LEN - cotp_len;
+    if (s7[0] != S7COMM_PROTOCOL_ID) {
+        return 0;
+    }
+    uint8_t rosctr = s7[1];
+    uint16_t pdu_reference = PacketRead16(s7 + 4);
+    size_t param_len = PacketRead16(s7 + 6);
+    size_t data_len = PacketRead16(s7 + 8);
+    int has_error = rosctr == S7_ACK || rosctr == S7_ACK_DATA;
+    size_t header_len = has_error ? 12 : 10;
+    if (header_len + param_len > s7_len) {
+        return 0;
+    }
+    const uint8_t *params = s7 + header_len;
+    const uint8_t *data = params + param_len;
+    if (data_len > s7_len - header_len - param_len) {
+        data_len = s7_len - header_len - param_len;
+    }
+
+    int is_response = has_error;
+    int has_function = 0;
+    uint8_t function_code = 0;
+    const char *function_name = NULL;
+    int has_items = 0;
+    uint8_t item_count = 0;
+    if (rosctr == S7_USERDATA) {
+        // Parameter head (3), length, method, type/group, subfunction
+        if (param_len >= 7) {
+            has_function = 1;
+            function_code = params[5] & 0x0F;
+            function_name = S7UserdataGroupName(function_code);
+            is_response = (params[5] >> 4) == 0x8;
+        }
+    } else if (param_len >= 1) {
+        has_function = 1;
+        function_code = params[0];
+        function_name = S7FunctionName(function_code);
+        if ((function_code == S7_FC_READ_VAR || function_code == S7_FC_WRITE_VAR) && param_len >= 2) {
+            has_items = 1;
+            item_count = params[1];
+        }
+    }
+
+    ot_request_t request;
+    memset(&request, 0, sizeof(request));
+    int has_request = 0;
+    if (rosctr == S7_JOB) {
+        // First S7ANY item: spec type 0x12, length, syntax id 0x10
+        const uint8_t *item = params + 2;
+        if (has_items && item_count && param_len >= 14 && item[0] == 0x12 && item[2] == 0x10) {
+            request.has_range = 1;
+            request.quantity = PacketRead16(item + 4);
+            request.db_number = PacketRead16(item + 6);
+            request.area = item[8];
+            // Bit address; the byte offset is what tools display
+            request.start = ((uint32_t)item[9] << 16 | (uint32_t)item[10] << 8 | item[11]) >> 3;
+        }
+        RememberRequest(state, msg, pdu_reference, &request);
+    } else if (has_error) {
+        has_request = TakeRequest(state, msg, pdu_reference, &request);
+    }
+
+    OtAssignCommon(vectors, row, msg);
+    ((uint8_t *)duckdb_vector_get_data(vectors[S7_COL_ROSCTR]))[row] = rosctr;
+    PcapVectorAssignString(vectors[S7_COL_MESSAGE_TYPE], row, S7MessageTypeName(rosctr));
+    ((uint16_t *)duckdb_vector_get_data(vectors[S7_COL_PDU_REFERENCE]))[row] = pdu_reference;
+    AssignU8(vectors[S7_COL_FUNCTION_CODE], row, function_code, has_function);
+    PcapVectorAssignString(vectors[S7_COL_FUNCTION_NAME], row, function_name);
+    ((bool *)duckdb_vector_get_data(vectors[S7_COL_IS_RESPONSE]))[row] = is_response;
+    AssignU8(vectors[S7_COL_ITEM_COUNT], row, item_count, has_items);
+    PcapVectorAssignString(vectors[S7_COL_AREA], row, request.has_range ? S7AreaName(request.area) : NULL);
+    AssignU16(vectors[S7_COL_DB_NUMBER], row, request.db_number, request.has_range && request.area == 0x84);
+    AssignU32(vectors[S7_COL_START_ADDRESS], row, request.start, request.has_range);
+    AssignU32(vectors[S7_COL_QUANTITY], row, request.quantity, request.has_range);
+    AssignU8(vectors[S7_COL_ERROR_CLASS], row, has_error ? s7[10] : 0, has_error);
+    AssignU8(vectors[S7_COL_ERROR_CODE], row, has_error ? s7[11] : 0, has_error);
+    // Read/write responses start their data with the first item's return code
+    int has_return = rosctr == S7_ACK_DATA && has_items && data_len >= 1;
+    AssignU8(vectors[S7_COL_RETURN_CODE], row, has_return ? data[0] : 0, has_return);
+    AssignPairing(vectors[S7_COL_REQUEST_TS], vectors[S7_COL_RESPONSE_TIME], row, msg,
+                  has_request ? &request : NULL);
+    return 1;
+}
+
+static void S7commFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    ot_state_t *state = (ot_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[S7_COL_COUNT];
+    for (idx_t i = 0; i < S7_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    message_t msg;
+    while (row_count < max_rows && MessageStreamNext(state->stream, &msg)) {
+        if (S7commEmit(state, vectors, row_count, &msg)) {
+            row_count++;
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterModbusFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_modbus", ModbusBind, ModbusInit, ModbusFunction);
+}
+
+void RegisterDnp3Function(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_dnp3", Dnp3Bind, Dnp3Init, Dnp3Function);
+}
+
+void RegisterS7commFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_s7comm", S7commBind, S7commInit, S7commFunction);
+}
@@ -0,0 +1,639 @@
+#include "duckdb_extension.h"
+#include "inflate.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define MAX_CODE_BITS 15
+#define MAX_LITLEN_CODES 288
+#define MAX_DIST_CODES 30
+#define MAX_MATCH 258
+
+// Codes up to FAST_BITS long are decoded with a single table lookup, longer
+// ones by walking the canonical code lengths
+#define FAST_BITS 10
+#define FAST_MASK ((1u << FAST_BITS) - 1)
+
+// gzip header flags
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+// Canonical Huffman code: symbols ordered by code length, plus a lookup
+// table of (symbol << 4) | length indexed by the next FAST_BITS input bits
+typedef struct {
+    uint16_t count[MAX_CODE_BITS + 1];
+    uint16_t symbol[MAX_LITLEN_CODES];
+    uint16_t fast[1 << FAST_BITS];
+} huffman_t;
+
+typedef enum {
+    STATE_MEMBER_HEADER,
+    STATE_BLOCK_HEADER,
+    STATE_STORED,
+    STATE_HUFFMAN,
+    STATE_MEMBER_TRAILER,
+    STATE_DONE,
+    STATE_ERROR
+} inflate_state_t;
+
+struct inflate_stream {
+    capture_file_t *file;
+    uint8_t input[INFLATE_INPUT_SIZE];
+    size_t in_pos;
+    size_t in_len;
+    uint64_t in_offset;      // file offset just past input[in_len - 1]
+    int in_eof;
+    uint64_t bits;           // bit buffer, least significant bit first
+    unsigned bit_count;
+
+    // Decoded bytes: at least the last INFLATE_WINDOW_SIZE of history (or all
+    // since the start) followed by bytes not yet read
+    uint8_t output[INFLATE_OUTPUT_SIZE];
+    size_t out_len;
+    size_t out_read;
+    uint64_t out_base;       // uncompressed offset of output[0]
+
+    inflate_state_t state;
+    int raw;                 // a bare deflate stream, without gzip framing
+    int members;             // gzip members started so far
+    uint64_t member_start;   // uncompressed offset of the current member
+    int member_known;        // member_start is known (the member was not entered through a checkpoint)
+    int final_block;
+    size_t stored_left;
+    const huffman_t *lit;
+    const huffman_t *dist;
+    huffman_t dynamic_lit;
+    huffman_t dynamic_dist;
+    huffman_t fixed_lit;
+    huffman_t fixed_dist;
+
+    inflate_block_callback_t callback;
+    void *context;
+};
+
+static const uint16_t length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[MAX_DIST_CODES] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                   33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                   1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[MAX_DIST_CODES] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                   6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t code_length_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// ---------------------------------------------------------------------------
+// Bit input
+// ---------------------------------------------------------------------------
+
+// Top up the bit buffer to at least 57 bits, or as many as the file has left
+static void Refill(inflate_stream_t *stream) {
+    while (stream->bit_count <= 56) {
+        if (stream->in_pos == stream->in_len) {
+            if (stream->in_eof) {
+                return;
+            }
+            stream->in_len = CaptureFileRead(stream->file, stream->input, sizeof(stream->input));
+            stream->in_pos = 0;
+            stream->in_offset += stream->in_len;
+            if (!stream->in_len) {
+                stream->in_eof = 1;
+                return;
+            }
+        }
+        stream->bits |= (uint64_t)stream->input[stream->in_pos++] << stream->bit_count;
+        stream->bit_count += 8;
+    }
+}
+
+static int NeedBits(inflate_stream_t *stream, unsigned count) {
+    if (stream->bit_count < count) {
+        Refill(stream);
+    }
+    return stream->bit_count >= count;
+}
+
+// Take count bits, which NeedBits must have made available
+static uint32_t TakeBits(inflate_stream_t *stream, unsigned count) {
+    uint32_t value = (uint32_t)(stream->bits & ((1ULL << count) - 1));
+    stream->bits >>= count;
+    stream->bit_count -= count;
+    return value;
+}
+
+static int TakeByte(inflate_stream_t *stream) {
+    return NeedBits(stream, 8) ? (int)TakeBits(stream, 8) : -1;
+}
+
+static void AlignToByte(inflate_stream_t *stream) {
+    TakeBits(stream, stream->bit_count & 7);
+}
+
+// Position of the next unread bit in the file
+static uint64_t InputBitOffset(const inflate_stream_t *stream) {
+    return (stream->in_offset - (stream->in_len - stream->in_pos)) * 8 - stream->bit_count;
+}
+
+// ---------------------------------------------------------------------------
+// Huffman codes
+// ---------------------------------------------------------------------------
+
+// Build a code from per-symbol lengths. Incomplete codes are accepted (their
+// unused codes fail to decode); returns 0 for an over-subscribed one.
+static int BuildHuffman(huffman_t *code, const uint8_t *lengths, unsigned symbols) {
+    memset(code->count, 0, sizeof(code->count));
+    for (unsigned i = 0; i < symbols; i++) {
+        code->count[lengths[i]]++;
+    }
+    int left = 1;
+    for (unsigned len = 1; len <= MAX_CODE_BITS; len++) {
+        left <<= 1;
+        left -= code->count[len];
+        if (left < 0) {
+            return 0;
+        }
+    }
+
+    uint16_t offsets[MAX_CODE_BITS + 1];
+    uint32_t next_code[MAX_CODE_BITS + 1];
+    offsets[1] = 0;
+    next_code[1] = 0;
+    for (unsigned len = 1; len < MAX_CODE_BITS; len++) {
+        offsets[len + 1] = (uint16_t)(offsets[len] + code->count[len]);
+        next_code[len + 1] = (next_code[len] + code->count[len]) << 1;
+    }
+
+    memset(code->fast, 0, sizeof(code->fast));
+    for (unsigned i = 0; i < symbols; i++) {
+        unsigned len = lengths[i];
+        if (!len) {
+            continue;
+        }
+        code->symbol[offsets[len]++] = (uint16_t)i;
+        uint32_t value = next_code[len]++;
+        if (len > FAST_BITS) {
+            continue;
+        }
+        // Codes are packed most significant bit first into an LSB-first stream
+        uint32_t reversed = 0;
+        for (unsigned bit = 0; bit < len; bit++) {
+            reversed |= ((value >> bit) & 1) << (len - 1 - bit);
+        }
+        for (uint32_t entry = reversed; entry < (1u << FAST_BITS); entry += 1u << len) {
+            code->fast[entry] = (uint16_t)((i << 4) | len);
+        }
+    }
+    return 1;
+}
+
+// Decode one symbol; returns -1 on an invalid code or truncated input
+static int DecodeSymbol(inflate_stream_t *stream, const huffman_t *code) {
+    if (stream->bit_count < MAX_CODE_BITS) {
+        Refill(stream);
+    }
+    uint16_t entry = code->fast[stream->bits & FAST_MASK];
+    unsigned len = entry & 15;
+    if (len) {
+        if (len > stream->bit_count) {
+            return -1;
+        }
+        TakeBits(stream, len);
+        return entry >> 4;
+    }
+
+    // Longer code: compare against the first code of each length in turn
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    uint64_t bits = stream->bits;
+    for (len = 1; len <= MAX_CODE_BITS && len <= stream->bit_count; len++) {
+        value |= (int)(bits & 1);
+        bits >>= 1;
+        int count = code->count[len];
+        if (value - count < first) {
+            TakeBits(stream, len);
+            return code->symbol[index + (value - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+static void BuildFixedCodes(inflate_stream_t *stream) {
+    uint8_t lengths[MAX_LITLEN_CODES];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 256 - 144);
+    memset(lengths + 256, 7, 280 - 256);
+    memset(lengths + 280, 8, MAX_LITLEN_CODES - 280);
+    BuildHuffman(&stream->fixed_lit, lengths, MAX_LITLEN_CODES);
+    memset(lengths, 5, MAX_DIST_CODES);
+    BuildHuffman(&stream->fixed_dist, lengths, MAX_DIST_CODES);
+}
+
+// Read the code lengths of a dynamic block and build its codes
+static int ReadDynamicCodes(inflate_stream_t *stream) {
+    if (!NeedBits(stream, 14)) {
+        return 0;
+    }
+    unsigned lit_count = TakeBits(stream, 5) + 257;
+    unsigned dist_count = TakeBits(stream, 5) + 1;
+    unsigned length_count = TakeBits(stream, 4) + 4;
+    if (lit_count > 286 || dist_count > MAX_DIST_CODES) {
+        return 0;
+    }
+
+    uint8_t lengths[MAX_LITLEN_CODES + MAX_DIST_CODES];
+    memset(lengths, 0, 19);
+    for (unsigned i = 0; i < length_count; i++) {
+        if (!NeedBits(stream, 3)) {
+            return 0;
+        }
+        lengths[code_length_order[i]] = (uint8_t)TakeBits(stream, 3);
+    }
+    // The code length code is only needed here; build it in the literal slot
+    huffman_t *length_code = &stream->dynamic_lit;
+    if (!BuildHuffman(length_code, lengths, 19)) {
+        return 0;
+    }
+
+    unsigned index = 0;
+    while (index < lit_count + dist_count) {
+        int symbol = DecodeSymbol(stream, length_code);
+        if (symbol < 0) {
+            return 0;
+        }
+        if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t len = 0;
+        unsigned repeat;
+        if (symbol == 16) {
+            if (!index || !NeedBits(stream, 2)) {
+                return 0;
+            }
+            len = lengths[index - 1];
+            repeat = 3 + TakeBits(stream, 2);
+        } else if (symbol == 17) {
+            if (!NeedBits(stream, 3)) {
+                return 0;
+            }
+            repeat = 3 + TakeBits(stream, 3);
+        } else {
+            if (!NeedBits(stream, 7)) {
+                return 0;
+            }
+            repeat = 11 + TakeBits(stream, 7);
+        }
+        if (index + repeat > lit_count + dist_count) {
+            return 0;
+        }
+        memset(lengths + index, len, repeat);
+        index += repeat;
+    }
+    if (!lengths[256]) {
+        return 0;
+    }
+    return BuildHuffman(&stream->dynamic_lit, lengths, lit_count) &&
+           BuildHuffman(&stream->dynamic_dist, lengths + lit_count, dist_count);
+}
+
+// ---------------------------------------------------------------------------
+// Decoding
+// ---------------------------------------------------------------------------
+
+// Parse a gzip member header. After the first member, anything but another
+// header (such as zero padding) ends the data cleanly.
+static void ReadMemberHeader(inflate_stream_t *stream) {
+    Refill(stream);
+    if (stream->bit_count < 16 || (stream->bits & 0xffff) != (GZIP_MAGIC_1 << 8 | GZIP_MAGIC_0)) {
+        stream->state = stream->members ? STATE_DONE : STATE_ERROR;
+        return;
+    }
+    stream->members++;
+    stream->member_start = stream->out_base + stream->out_len;
+    stream->member_known = 1;
+    stream->state = STATE_ERROR;
+    TakeBits(stream, 16);
+    int method = TakeByte(stream);
+    int flags = TakeByte(stream);
+    if (method != 8 || flags < 0) {
+        return;
+    }
+    // MTIME, XFL and OS
+    for (int i = 0; i < 6; i++) {
+        if (TakeByte(stream) < 0) {
+            return;
+        }
+    }
+    if (flags & GZIP_FEXTRA) {
+        int low = TakeByte(stream);
+        int high = TakeByte(stream);
+        if (high < 0) {
+            return;
+        }
+        for (int i = low | high << 8; i > 0; i--) {
+            if (TakeByte(stream) < 0) {
+                return;
+            }
+        }
+    }
+    for (int flag = GZIP_FNAME; flag <= GZIP_FCOMMENT; flag <<= 1) {
+        if (flags & flag) {
+            int byte;
+            while ((byte = TakeByte(stream)) > 0) {
+            }
+            if (byte < 0) {
+                return;
+            }
+        }
+    }
+    if ((flags & GZIP_FHCRC) && (TakeByte(stream) < 0 || TakeByte(stream) < 0)) {
+        return;
+    }
+    stream->state = STATE_BLOCK_HEADER;
+}
+
+static void ReadBlockHeader(inflate_stream_t *stream) {
+    if (stream->callback) {
+        size_t window = stream->out_len < INFLATE_WINDOW_SIZE ? stream->out_len : INFLATE_WINDOW_SIZE;
+        stream->callback(stream->context, InputBitOffset(stream), stream->out_base + stream->out_len,
+                         stream->output + stream->out_len - window, window);
+    }
+    stream->state = STATE_ERROR;
+    if (!NeedBits(stream, 3)) {
+        return;
+    }
+    stream->final_block = (int)TakeBits(stream, 1);
+    switch (TakeBits(stream, 2)) {
+    case 0: {
+        AlignToByte(stream);
+        if (!NeedBits(stream, 32)) {
+            return;
+        }
+        uint32_t len = TakeBits(stream, 16);
+        if ((len ^ TakeBits(stream, 16)) != 0xffff) {
+            return;
+        }
+        stream->stored_left = len;
+        stream->state = STATE_STORED;
+        break;
+    }
+    case 1:
+        stream->lit = &stream->fixed_lit;
+        stream->dist = &stream->fixed_dist;
+        stream->state = STATE_HUFFMAN;
+        break;
+    case 2:
+        if (ReadDynamicCodes(stream)) {
+            stream->lit = &stream->dynamic_lit;
+            stream->dist = &stream->dynamic_dist;
+            stream->state = STATE_HUFFMAN;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void EndBlock(inflate_stream_t *stream) {
+    if (!stream->final_block) {
+        stream->state = STATE_BLOCK_HEADER;
+    } else {
+        stream->state = stream->raw ? STATE_DONE : STATE_MEMBER_TRAILER;
+    }
+}
+
+static void CopyStored(inflate_stream_t *stream) {
+    while (stream->stored_left && stream->out_len < INFLATE_OUTPUT_SIZE) {
+        // Whole bytes left in the bit buffer come first
+        if (stream->bit_count >= 8) {
+            stream->output[stream->out_len++] = (uint8_t)TakeBits(stream, 8);
+            stream->stored_left--;
+            continue;
+        }
+        if (stream->in_pos == stream->in_len) {
+            Refill(stream);
+            if (stream->bit_count < 8) {
+                stream->state = STATE_ERROR;
+                return;
+            }
+            continue;
+        }
+        size_t chunk = stream->in_len - stream->in_pos;
+        if (chunk > stream->stored_left) {
+            chunk = stream->stored_left;
+        }
+        if (chunk > INFLATE_OUTPUT_SIZE - stream->out_len) {
+            chunk = INFLATE_OUTPUT_SIZE - stream->out_len;
+        }
+        memcpy(stream->output + stream->out_len, stream->input + stream->in_pos, chunk);
+        stream->in_pos += chunk;
+        stream->out_len += chunk;
+        stream->stored_left -= chunk;
+    }
+    if (!stream->stored_left) {
+        EndBlock(stream);
+    }
+}
+
+// Decode literals and matches while a maximal match still fits the output
+static void DecodeHuffman(inflate_stream_t *stream) {
+    uint8_t *output = stream->output;
+    size_t pos = stream->out_len;
+    while (pos <= INFLATE_OUTPUT_SIZE - MAX_MATCH) {
+        int symbol = DecodeSymbol(stream, stream->lit);
+        if (symbol < 256) {
+            if (symbol < 0) {
+                stream->state = STATE_ERROR;
+                break;
+            }
+            output[pos++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 256) {
+            EndBlock(stream);
+            break;
+        }
+        symbol -= 257;
+        if (symbol >= 29 || !NeedBits(stream, length_extra[symbol])) {
+            stream->state = STATE_ERROR;
+            break;
+        }
+        size_t len = length_base[symbol] + TakeBits(stream, length_extra[symbol]);
+        symbol = DecodeSymbol(stream, stream->dist);
+        if (symbol < 0 || symbol >= MAX_DIST_CODES || !NeedBits(stream, dist_extra[symbol])) {
+            stream->state = STATE_ERROR;
+            break;
+        }
+        size_t distance = dist_base[symbol] + TakeBits(stream, dist_extra[symbol]);
+        if (distance > pos) {
+            stream->state = STATE_ERROR;
+            break;
+        }
+        const uint8_t *from = output + pos - distance;
+        if (distance >= len) {
+            memcpy(output + pos, from, len);
+        } else {
+            // Overlapping match repeats the last distance bytes
+            for (size_t i = 0; i < len; i++) {
+                output[pos + i] = from[i];
+            }
+        }
+        pos += len;
+    }
+    stream->out_len = pos;
+}
+
+// The trailer holds the member's CRC32 and its length modulo 2^32 (ISIZE),
+// which catches corrupt data that happened to end the member early
+static void ReadMemberTrailer(inflate_stream_t *stream) {
+    AlignToByte(stream);
+    stream->state = STATE_ERROR;
+    if (!NeedBits(stream, 64)) {
+        return;
+    }
+    TakeBits(stream, 32);
+    uint32_t size = TakeBits(stream, 32);
+    if (stream->member_known && size != (uint32_t)(stream->out_base + stream->out_len - stream->member_start)) {
+        return;
+    }
+    stream->state = STATE_MEMBER_HEADER;
+}
+
+// Decode until the output buffer is full or the data ends
+static void Decode(inflate_stream_t *stream) {
+    while (stream->out_len <= INFLATE_OUTPUT_SIZE - MAX_MATCH) {
+        switch (stream->state) {
+        case STATE_MEMBER_HEADER:
+            ReadMemberHeader(stream);
+            break;
+        case STATE_BLOCK_HEADER:
+            ReadBlockHeader(stream);
+            break;
+        case STATE_STORED:
+            CopyStored(stream);
+            break;
+        case STATE_HUFFMAN:
+            DecodeHuffman(stream);
+            break;
+        case STATE_MEMBER_TRAILER:
+            ReadMemberTrailer(stream);
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+// Drop consumed output beyond the history window
+static void Compact(inflate_stream_t *stream) {
+    if (stream->out_len <= INFLATE_WINDOW_SIZE) {
+        return;
+    }
+    size_t drop = stream->out_len - INFLATE_WINDOW_SIZE;
+    if (drop > stream->out_read) {
+        drop = stream->out_read;
+    }
+    memmove(stream->output, stream->output + drop, stream->out_len - drop);
+    stream->out_len -= drop;
+    stream->out_read -= drop;
+    stream->out_base += drop;
+}
+
+// ---------------------------------------------------------------------------
+// Public interface
+// ---------------------------------------------------------------------------
+
+inflate_stream_t *InflateOpen(capture_file_t *file, const uint8_t *prefix, size_t prefix_len) {
+    inflate_stream_t *stream = (inflate_stream_t *)duckdb_malloc(sizeof(inflate_stream_t));
+    if (!stream) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(inflate_stream_t));
+    stream->file = file;
+    if (prefix_len) {
+        memcpy(stream->input, prefix, prefix_len);
+    }
+    stream->in_len = prefix_len;
+    stream->in_offset = prefix_len;
+    stream->state = STATE_MEMBER_HEADER;
+    BuildFixedCodes(stream);
+    return stream;
+}
+
+inflate_stream_t *InflateOpenRaw(capture_file_t *file) {
+    inflate_stream_t *stream = InflateOpen(file, NULL, 0);
+    if (stream) {
+        stream->raw = 1;
+        stream->members = 1;
+        stream->state = STATE_BLOCK_HEADER;
+    }
+    return stream;
+}
+
+int InflateSeek(inflate_stream_t *stream, uint64_t in_bits, uint64_t out_offset, const uint8_t *window,
+                size_t window_len) {
+    if (window_len > INFLATE_WINDOW_SIZE || window_len > out_offset ||
+        !CaptureFileSeek(stream->file, in_bits / 8)) {
+        return 0;
+    }
+    stream->in_pos = 0;
+    stream->in_len = 0;
+    stream->in_offset = in_bits / 8;
+    stream->in_eof = 0;
+    stream->bits = 0;
+    stream->bit_count = 0;
+    if (!NeedBits(stream, (unsigned)(in_bits & 7))) {
+        return 0;
+    }
+    TakeBits(stream, (unsigned)(in_bits & 7));
+
+    memcpy(stream->output, window, window_len);
+    stream->out_len = window_len;
+    stream->out_read = window_len;
+    stream->out_base = out_offset - window_len;
+    stream->members = 1;
+    stream->member_known = 0;
+    stream->state = STATE_BLOCK_HEADER;
+    return 1;
+}
+
+size_t InflateRead(inflate_stream_t *stream, uint8_t *buffer, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        size_t available = stream->out_len - stream->out_read;
+        if (available) {
+            size_t chunk = available < len - done ? available : len - done;
+            if (buffer) {
+                memcpy(buffer + done, stream->output + stream->out_read, chunk);
+            }
+            stream->out_read += chunk;
+            done += chunk;
+            continue;
+        }
+        if (stream->state == STATE_DONE || stream->state == STATE_ERROR) {
+            break;
+        }
+        Compact(stream);
+        Decode(stream);
+    }
+    return done;
+}
+
+int InflateFinished(const inflate_stream_t *stream) {
+    return stream->state == STATE_DONE;
+}
+
+void InflateSetBlockCallback(inflate_stream_t *stream, inflate_block_callback_t callback, void *context) {
+    stream->callback = callback;
+    stream->context = context;
+}
+
+void InflateClose(inflate_stream_t *stream) {
+    duckdb_free(stream);
+}
@@ -0,0 +1,195 @@
+#include "duckdb_extension.h"
+#include "io_scheduler.h"
+#include "sync.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+struct io_stream {
+    struct io_stream *next;  // in the list of open streams
+    uint32_t share;
+    uint32_t waiting;        // threads waiting for a turn
+    uint64_t bytes;          // decoded so far
+    uint64_t cost;           // bytes decoded, weighted by IO_SCHEDULER_MAX_SHARE / share
+    uint64_t order;          // when the stream was opened, breaking ties
+    uint64_t released_ms;    // when its last unit ended, 0 while it waits or runs
+};
+
+// Everything below is guarded by scheduler_lock
+static pcap_mutex_t scheduler_lock = PCAP_MUTEX_INITIALIZER;
+static pcap_cond_t scheduler_turn = PCAP_COND_INITIALIZER;
+static io_stream_t *streams = NULL;
+static uint64_t streams_opened = 0;
+static uint32_t slots = 0;   // units of work allowed at once, 0 for no limit
+static uint32_t busy = 0;    // units of work running
+
+io_stream_t *IoStreamOpen(uint32_t share) {
+    io_stream_t *stream = (io_stream_t *)duckdb_malloc(sizeof(io_stream_t));
+    if (!stream) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(io_stream_t));
+    stream->share = share ? share : IO_SCHEDULER_DEFAULT_SHARE;
+
+    PcapMutexLock(&scheduler_lock);
+    // Start level with the streams already open rather than ahead of them
+    // all, which would hold them back until the new one caught up
+    int first = 1;
+    for (io_stream_t *other = streams; other; other = other->next) {
+        if (first || other->cost < stream->cost) {
+            stream->cost = other->cost;
+            first = 0;
+        }
+    }
+    stream->order = streams_opened++;
+    stream->next = streams;
+    streams = stream;
+    PcapMutexUnlock(&scheduler_lock);
+    return stream;
+}
+
+void IoStreamClose(io_stream_t *stream) {
+    if (!stream) {
+        return;
+    }
+    PcapMutexLock(&scheduler_lock);
+    io_stream_t **link = &streams;
+    while (*link != stream) {
+        link = &(*link)->next;
+    }
+    *link = stream->next;
+    PcapMutexUnlock(&scheduler_lock);
+    duckdb_free(stream);
+}
+
+// Whether a's turn comes before b's
+static int GoesBefore(const io_stream_t *a, const io_stream_t *b) {
+    int a_small = a->bytes < IO_SCHEDULER_SMALL_SCAN;
+    int b_small = b->bytes < IO_SCHEDULER_SMALL_SCAN;
+    if (a_small != b_small) {
+        return a_small;
+    }
+    if (a->cost != b->cost) {
+        return a->cost < b->cost;
+    }
+    return a->order < b->order;
+}
+
+// Whether a slot is free for the stream once every stream whose turn comes
+// first, waiting or expected back from its last unit, has one. *wake is
+// lowered to when an expected stream stops being waited for.
+static int SlotFree(const io_stream_t *stream, uint64_t now, uint64_t *wake) {
+    uint32_t ahead = 0;
+    for (const io_stream_t *other = streams; other; other = other->next) {
+        uint64_t until = other->released_ms + IO_SCHEDULER_ANTICIPATE_MS;
+        int expected = !other->waiting && other->released_ms && now < until;
+        if (other != stream && (other->waiting || expected) && GoesBefore(other, stream)) {
+            ahead++;
+            if (expected && until < *wake) {
+                *wake = until;
+            }
+        }
+    }
+    return busy + ahead < slots;
+}
+
+int IoSchedulerAcquire(io_stream_t *stream) {
+    if (!stream) {
+        return 1;
+    }
+    PcapMutexLock(&scheduler_lock);
+    stream->waiting++;
+    stream->released_ms = 0;
+    uint64_t deadline = PcapClockMs() + IO_SCHEDULER_WAIT_MS;
+    int granted;
+    for (;;) {
+        uint64_t now = PcapClockMs();
+        uint64_t wake = deadline;
+        granted = !slots || SlotFree(stream, now, &wake);
+        if (granted || now >= deadline) {
+            break;
+        }
+        PcapCondWaitUntil(&scheduler_turn, &scheduler_lock, wake);
+    }
+    stream->waiting--;
+    if (granted) {
+        busy++;
+    } else {
+        // Another stream may be next now
+        PcapCondBroadcast(&scheduler_turn);
+    }
+    PcapMutexUnlock(&scheduler_lock);
+    return granted;
+}
+
+// Called with the scheduler locked
+static void Charge(io_stream_t *stream, uint64_t bytes) {
+    stream->bytes += bytes;
+    stream->cost += bytes * IO_SCHEDULER_MAX_SHARE / stream->share;
+}
+
+void IoSchedulerRelease(io_stream_t *stream, uint64_t bytes) {
+    if (!stream) {
+        return;
+    }
+    PcapMutexLock(&scheduler_lock);
+    busy--;
+    Charge(stream, bytes);
+    stream->released_ms = PcapClockMs();
+    if (slots) {
+        PcapCondBroadcast(&scheduler_turn);
+    }
+    PcapMutexUnlock(&scheduler_lock);
+}
+
+void IoSchedulerCharge(io_stream_t *stream, uint64_t bytes) {
+    if (!stream) {
+        return;
+    }
+    PcapMutexLock(&scheduler_lock);
+    Charge(stream, bytes);
+    PcapMutexUnlock(&scheduler_lock);
+}
+
+// ---------------------------------------------------------------------------
+// pcap_io_slots(slots)
+// ---------------------------------------------------------------------------
+
+static void IoSlotsFunction(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output) {
+    idx_t size = duckdb_data_chunk_get_size(input);
+    duckdb_vector slots_vector = duckdb_data_chunk_get_vector(input, 0);
+    int32_t *values = (int32_t *)duckdb_vector_get_data(slots_vector);
+    uint64_t *validity = duckdb_vector_get_validity(slots_vector);
+    int32_t *previous = (int32_t *)duckdb_vector_get_data(output);
+
+    for (idx_t row = 0; row < size; row++) {
+        if (validity && !duckdb_validity_row_is_valid(validity, row)) {
+            duckdb_scalar_function_set_error(info, "I/O slots must not be NULL");
+            return;
+        }
+        if (values[row] < 0) {
+            duckdb_scalar_function_set_error(info, "I/O slots must be 0 (no limit) or more");
+            return;
+        }
+        PcapMutexLock(&scheduler_lock);
+        previous[row] = (int32_t)slots;
+        slots = (uint32_t)values[row];
+        // Waiters may go now, or no longer wait at all
+        PcapCondBroadcast(&scheduler_turn);
+        PcapMutexUnlock(&scheduler_lock);
+    }
+}
+
+void RegisterIoSchedulerFunction(duckdb_connection connection) {
+    duckdb_scalar_function function = duckdb_create_scalar_function();
+    duckdb_scalar_function_set_name(function, "pcap_io_slots");
+    duckdb_logical_type integer_type = duckdb_create_logical_type(DUCKDB_TYPE_INTEGER);
+    duckdb_scalar_function_add_parameter(function, integer_type);
+    duckdb_scalar_function_set_return_type(function, integer_type);
+    duckdb_destroy_logical_type(&integer_type);
+    duckdb_scalar_function_set_volatile(function);
+    duckdb_scalar_function_set_special_handling(function);
+    duckdb_scalar_function_set_function(function, IoSlotsFunction);
+    duckdb_register_scalar_function(connection, function);
+    duckdb_destroy_scalar_function(&function);
+}
@@ -0,0 +1,217 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "message_stream.h"
+#include "packet_decode.h"
+#include "pcap_source.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+typedef struct {
+    flow_key_t key;
+    tcp_direction_t tcp[2];
+    stream_buffer_t buffer[2];
+    uint8_t fin[2];
+    uint8_t closed;
+} message_flow_t;
+
+struct message_stream {
+    pcap_source_t *source;
+    message_protocol_t protocol;
+    hash_map_t flows;             // flow_key_t -> message_flow_t *
+
+    // TCP direction messages are currently taken from
+    message_flow_t *active;
+    int active_direction;
+    size_t active_consumed;       // length of the message last returned
+    uint64_t active_ts_ns;
+
+    // UDP datagram messages are currently taken from
+    const uint8_t *datagram;
+    size_t datagram_len;
+    flow_key_t datagram_key;
+    int datagram_direction;
+    uint64_t datagram_ts_ns;
+};
+
+static void FreeFlow(message_flow_t *flow) {
+    StreamBufferFree(&flow->buffer[0]);
+    StreamBufferFree(&flow->buffer[1]);
+    duckdb_free(flow);
+}
+
+const char *MessageStreamOpen(const char *filename, const message_protocol_t *protocol, message_stream_t **out) {
+    message_stream_t *stream = (message_stream_t *)duckdb_malloc(sizeof(message_stream_t));
+    if (!stream) {
+        return "Failed to allocate memory for init state";
+    }
+    memset(stream, 0, sizeof(message_stream_t));
+    stream->protocol = *protocol;
+    if (!HashMapInit(&stream->flows, sizeof(flow_key_t), sizeof(message_flow_t *))) {
+        MessageStreamClose(stream);
+        return "Failed to allocate memory for init state";
+    }
+    const char *error = PcapSourceOpen(filename, &stream->source);
+    if (error) {
+        MessageStreamClose(stream);
+        return error;
+    }
+    *out = stream;
+    return NULL;
+}
+
+void MessageStreamClose(message_stream_t *stream) {
+    if (!stream) {
+        return;
+    }
+    PcapSourceClose(stream->source);
+    if (stream->flows.slots) {
+        size_t position = 0;
+        const void *key;
+        void *value;
+        while (HashMapNext(&stream->flows, &position, &key, &value)) {
+            FreeFlow(*(message_flow_t **)value);
+        }
+    }
+    HashMapDestroy(&stream->flows);
+    duckdb_free(stream);
+}
+
+// Length of a complete message at the front of data, 0 if incomplete, or
+// MESSAGE_FRAME_INVALID when framing is lost
+static size_t FrameMessage(const message_protocol_t *protocol, const uint8_t *data, size_t avail) {
+    size_t len = protocol->frame(data, avail);
+    if (len == MESSAGE_FRAME_INVALID || len > protocol->max_message) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    return len <= avail ? len : 0;
+}
+
+static int TakeTcpMessage(message_stream_t *stream, message_t *message) {
+    message_flow_t *flow = stream->active;
+    stream_buffer_t *buffer = &flow->buffer[stream->active_direction];
+    StreamBufferConsume(buffer, stream->active_consumed);
+    stream->active_consumed = 0;
+
+    if (buffer->len) {
+        size_t len = FrameMessage(&stream->protocol, buffer->data, buffer->len);
+        if (len == MESSAGE_FRAME_INVALID) {
+            // Release the memory too: with port 0 most flows never frame
+            StreamBufferFree(buffer);
+        } else if (len) {
+            stream->active_consumed = len;
+            message->data = buffer->data;
+            message->len = len;
+            message->key = &flow->key;
+            message->direction = stream->active_direction;
+            message->to_server = stream->active_direction ? flow->key.port_a == stream->protocol.port
+                                                          : flow->key.port_b == stream->protocol.port;
+            message->is_udp = 0;
+            message->timestamp_ns = stream->active_ts_ns;
+            return 1;
+        }
+    }
+
+    // Direction drained; a closed connection can now be forgotten
+    if (flow->closed) {
+        HashMapRemove(&stream->flows, &flow->key);
+        FreeFlow(flow);
+    }
+    stream->active = NULL;
+    return 0;
+}
+
+static int TakeDatagramMessage(message_stream_t *stream, message_t *message) {
+    size_t len = FrameMessage(&stream->protocol, stream->datagram, stream->datagram_len);
+    if (len == 0 || len == MESSAGE_FRAME_INVALID) {
+        stream->datagram = NULL;
+        return 0;
+    }
+    message->data = stream->datagram;
+    message->len = len;
+    message->key = &stream->datagram_key;
+    message->direction = stream->datagram_direction;
+    message->to_server = stream->datagram_direction ? stream->datagram_key.port_a == stream->protocol.port
+                                                    : stream->datagram_key.port_b == stream->protocol.port;
+    message->is_udp = 1;
+    message->timestamp_ns = stream->datagram_ts_ns;
+    stream->datagram += len;
+    stream->datagram_len -= len;
+    return 1;
+}
+
+static void ProcessTcp(message_stream_t *stream, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0) {
+        return;
+    }
+    int is_new;
+    message_flow_t **slot = (message_flow_t **)HashMapInsert(&stream->flows, &key, &is_new);
+    if (!slot) {
+        return;
+    }
+    if (is_new) {
+        *slot = (message_flow_t *)duckdb_malloc(sizeof(message_flow_t));
+        if (!*slot) {
+            HashMapRemove(&stream->flows, &key);
+            return;
+        }
+        memset(*slot, 0, sizeof(message_flow_t));
+        (*slot)->key = key;
+    }
+    message_flow_t *flow = *slot;
+    stream_buffer_t *buffer = &flow->buffer[direction];
+
+    const uint8_t *data;
+    uint32_t len = TcpDirectionAccept(&flow->tcp[direction], pkt, &data);
+    if (flow->tcp[direction].gap) {
+        // Bytes were lost: drop the partial message and restart at this segment
+        StreamBufferConsume(buffer, buffer->len);
+        TcpDirectionResync(&flow->tcp[direction], pkt);
+        len = TcpDirectionAccept(&flow->tcp[direction], pkt, &data);
+    }
+    if (len && !StreamBufferAppend(buffer, data, len, 2 * stream->protocol.max_message)) {
+        StreamBufferConsume(buffer, buffer->len);
+    }
+
+    if (pkt->tcp_flags & TCP_FLAG_FIN) {
+        flow->fin[direction] = 1;
+    }
+    if ((pkt->tcp_flags & TCP_FLAG_RST) || (flow->fin[0] && flow->fin[1])) {
+        flow->closed = 1;
+    }
+    stream->active = flow;
+    stream->active_direction = direction;
+    stream->active_ts_ns = packet->timestamp_ns;
+}
+
+int MessageStreamNext(message_stream_t *stream, message_t *message) {
+    pcap_packet_t packet;
+    packet_info_t pkt;
+
+    for (;;) {
+        if (stream->active && TakeTcpMessage(stream, message)) {
+            return 1;
+        }
+        if (stream->datagram && TakeDatagramMessage(stream, message)) {
+            return 1;
+        }
+        if (!PcapSourceNext(stream->source, &packet)) {
+            return 0;
+        }
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) || pkt.is_fragment ||
+            (stream->protocol.port && pkt.src_port != stream->protocol.port &&
+             pkt.dst_port != stream->protocol.port)) {
+            continue;
+        }
+        if (pkt.ip_proto == IPPROTO_NUM_TCP) {
+            ProcessTcp(stream, &packet, &pkt);
+        } else if (pkt.ip_proto == IPPROTO_NUM_UDP && stream->protocol.udp && pkt.payload_len) {
+            stream->datagram_direction = FlowKeyFromPacket(&pkt, &stream->datagram_key);
+            stream->datagram = pkt.payload;
+            stream->datagram_len = pkt.payload_len;
+            stream->datagram_ts_ns = packet.timestamp_ns;
+        }
+    }
+}
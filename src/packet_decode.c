@@ -0,0 +1,263 @@
+#include "packet_decode.h"
+#include <stdio.h>
+#include <string.h>
+
+// Decode UDP or TCP headers starting at info->l4
+static void DecodeTransport(packet_info_t *info) {
+    const uint8_t *p = info->l4;
+    uint32_t len = info->l4_len;
+
+    if (info->is_fragment) {
+        return;
+    }
+    if (info->ip_proto == IPPROTO_NUM_UDP) {
+        if (len < 8) {
+            return;
+        }
+        info->src_port = PacketRead16(p);
+        info->dst_port = PacketRead16(p + 2);
+        info->payload = p + 8;
+        info->payload_len = len - 8;
+    } else if (info->ip_proto == IPPROTO_NUM_TCP) {
+        if (len < 20) {
+            return;
+        }
+        uint32_t header_len = (uint32_t)(p[12] >> 4) * 4;
+        if (header_len < 20 || header_len > len) {
+            return;
+        }
+        info->src_port = PacketRead16(p);
+        info->dst_port = PacketRead16(p + 2);
+        info->tcp_seq = PacketRead32(p + 4);
+        info->tcp_ack = PacketRead32(p + 8);
+        info->tcp_flags = p[13];
+        info->tcp_window = PacketRead16(p + 14);
+        info->payload = p + header_len;
+        info->payload_len = len - header_len;
+    } else {
+        info->payload = p;
+        info->payload_len = len;
+    }
+}
+
+static void DecodeIpv4(packet_info_t *info) {
+    const uint8_t *p = info->l3;
+    uint32_t len = info->l3_len;
+
+    if (len < 20 || (p[0] >> 4) != 4) {
+        return;
+    }
+    uint32_t header_len = (uint32_t)(p[0] & 0x0F) * 4;
+    uint32_t total_len = PacketRead16(p + 2);
+    if (header_len < 20 || header_len > len) {
+        return;
+    }
+    // Trust the shorter of the captured and declared lengths (Ethernet padding)
+    if (total_len >= header_len && total_len < len) {
+        len = total_len;
+    }
+    uint16_t fragment = PacketRead16(p + 6);
+
+    info->ip_version = 4;
+    info->ttl = p[8];
+    info->ip_proto = p[9];
+    info->is_fragment = (fragment & 0x3FFF) != 0;
+    memcpy(info->src_ip, p + 12, 4);
+    memcpy(info->dst_ip, p + 16, 4);
+    info->l4 = p + header_len;
+    info->l4_len = len - header_len;
+    DecodeTransport(info);
+}
+
+static void DecodeIpv6(packet_info_t *info) {
+    const uint8_t *p = info->l3;
+    uint32_t len = info->l3_len;
+
+    if (len < 40 || (p[0] >> 4) != 6) {
+        return;
+    }
+    uint32_t payload_len = PacketRead16(p + 4);
+    if (payload_len + 40 < len) {
+        len = payload_len + 40;
+    }
+    info->ip_version = 6;
+    info->ttl = p[7];
+    memcpy(info->src_ip, p + 8, 16);
+    memcpy(info->dst_ip, p + 24, 16);
+
+    // Walk extension headers until we reach the upper-layer protocol
+    uint8_t next = p[6];
+    uint32_t offset = 40;
+    for (;;) {
+        if (next == 0 || next == 43 || next == 60) {
+            // Hop-by-hop, routing and destination options
+            if (offset + 8 > len) {
+                return;
+            }
+            next = p[offset];
+            offset += ((uint32_t)p[offset + 1] + 1) * 8;
+        } else if (next == 44) {
+            // Fragment header
+            if (offset + 8 > len) {
+                return;
+            }
+            uint16_t fragment = PacketRead16(p + offset + 2);
+            info->is_fragment = (fragment & 0xFFF9) != 0;
+            next = p[offset];
+            offset += 8;
+        } else {
+            break;
+        }
+        if (offset > len) {
+            return;
+        }
+    }
+    info->ip_proto = next;
+    info->l4 = p + offset;
+    info->l4_len = len - offset;
+    DecodeTransport(info);
+}
+
+static void DecodeNetwork(packet_info_t *info) {
+    if (info->ethertype == ETHERTYPE_IPV4) {
+        DecodeIpv4(info);
+    } else if (info->ethertype == ETHERTYPE_IPV6) {
+        DecodeIpv6(info);
+    }
+}
+
+// Skip any 802.1Q / 802.1ad tags that follow an EtherType field
+static int DecodeEthertype(packet_info_t *info, const uint8_t *p, uint32_t len) {
+    if (len < 2) {
+        return 0;
+    }
+    uint16_t ethertype = PacketRead16(p);
+    p += 2;
+    len -= 2;
+    while (ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) {
+        if (len < 4) {
+            return 0;
+        }
+        info->vlan_id = PacketRead16(p) & 0x0FFF;
+        ethertype = PacketRead16(p + 2);
+        p += 4;
+        len -= 4;
+    }
+    info->ethertype = ethertype;
+    info->l3 = p;
+    info->l3_len = len;
+    return 1;
+}
+
+int PacketDecode(uint32_t link_type, const uint8_t *data, uint32_t len, packet_info_t *info) {
+    memset(info, 0, sizeof(packet_info_t));
+
+    switch (link_type) {
+    case LINKTYPE_ETHERNET:
+        if (len < 14) {
+            return 0;
+        }
+        info->dst_mac = data;
+        info->src_mac = data + 6;
+        if (!DecodeEthertype(info, data + 12, len - 12)) {
+            return 0;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (len < 16) {
+            return 0;
+        }
+        if (PacketRead16(data + 4) == 6) {
+            info->src_mac = data + 6;
+        }
+        if (!DecodeEthertype(info, data + 14, len - 14)) {
+            return 0;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (len < 20) {
+            return 0;
+        }
+        if (data[11] == 6) {
+            info->src_mac = data + 12;
+        }
+        info->ethertype = PacketRead16(data);
+        info->l3 = data + 20;
+        info->l3_len = len - 20;
+        break;
+    case LINKTYPE_NULL: {
+        if (len < 4) {
+            return 0;
+        }
+        // Host byte order address family; IPv6 values differ per platform
+        uint32_t family = data[0] | (uint32_t)data[3];
+        info->ethertype = family == 2 ? ETHERTYPE_IPV4 : ETHERTYPE_IPV6;
+        info->l3 = data + 4;
+        info->l3_len = len - 4;
+        break;
+    }
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        if (len < 1) {
+            return 0;
+        }
+        info->ethertype = (data[0] >> 4) == 6 ? ETHERTYPE_IPV6 : ETHERTYPE_IPV4;
+        info->l3 = data;
+        info->l3_len = len;
+        break;
+    default:
+        return 0;
+    }
+
+    DecodeNetwork(info);
+    return 1;
+}
+
+void PacketFormatIp(uint8_t ip_version, const uint8_t *addr, char *out, size_t out_len) {
+    if (ip_version == 4) {
+        snprintf(out, out_len, "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+        return;
+    }
+
+    // RFC 5952: compress the longest run (length >= 2) of zero groups
+    uint16_t groups[8];
+    for (int i = 0; i < 8; i++) {
+        groups[i] = PacketRead16(addr + i * 2);
+    }
+    int best_start = -1, best_len = 0;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (i < 8 && groups[i] == 0) {
+            i++;
+        }
+        if (i - start > best_len) {
+            best_start = start;
+            best_len = i - start;
+        }
+    }
+    if (best_len < 2) {
+        best_start = -1;
+        best_len = 0;
+    }
+
+    size_t pos = 0;
+    out[0] = '\0';
+    for (int i = 0; i < 8 && pos < out_len; i++) {
+        if (i == best_start) {
+            pos += (size_t)snprintf(out + pos, out_len - pos, "::");
+            i += best_len - 1;
+            continue;
+        }
+        int needs_colon = i > 0 && i != best_start + best_len;
+        pos += (size_t)snprintf(out + pos, out_len - pos, needs_colon ? ":%x" : "%x", groups[i]);
+    }
+}
+
+void PacketFormatMac(const uint8_t *mac, char *out, size_t out_len) {
+    snprintf(out, out_len, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
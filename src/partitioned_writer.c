@@ -0,0 +1,451 @@
+#include "duckdb_extension.h"
+#include "partitioned_writer.h"
+#include "pcap_reader.h"
+#include "sync.h"
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// ---------------------------------------------------------------------------
+// Output files
+// ---------------------------------------------------------------------------
+
+// All of the registry below is guarded by outputs_lock
+static pcap_mutex_t outputs_lock = PCAP_MUTEX_INITIALIZER;
+static hash_map_t outputs;             // path hash -> partitioned_output_t *
+static partitioned_output_t *lru_head;
+static partitioned_output_t *lru_tail;
+static uint32_t open_files;
+
+static void LruUnlink(partitioned_output_t *output) {
+    if (output->lru_prev) {
+        output->lru_prev->lru_next = output->lru_next;
+    } else {
+        lru_head = output->lru_next;
+    }
+    if (output->lru_next) {
+        output->lru_next->lru_prev = output->lru_prev;
+    } else {
+        lru_tail = output->lru_prev;
+    }
+    output->lru_prev = NULL;
+    output->lru_next = NULL;
+}
+
+static void LruPushFront(partitioned_output_t *output) {
+    output->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = output;
+    } else {
+        lru_tail = output;
+    }
+    lru_head = output;
+}
+
+static int CloseFile(partitioned_output_t *output) {
+    int ok = 1;
+    if (output->file) {
+        ok = fclose(output->file) == 0;
+        output->file = NULL;
+        LruUnlink(output);
+        open_files--;
+    }
+    return ok;
+}
+
+// Make sure the output has an open handle and mark it most recently used.
+// mode is "wb" when the file is created and "ab" when it is reopened.
+static int OpenFile(partitioned_output_t *output, const char *mode) {
+    if (output->file) {
+        if (lru_head != output) {
+            LruUnlink(output);
+            LruPushFront(output);
+        }
+        return 1;
+    }
+    partitioned_output_t *oldest = lru_tail;
+    if (open_files >= PARTITIONED_WRITER_MAX_OPEN_FILES && oldest) {
+        oldest->failed |= !CloseFile(oldest);
+    }
+#ifdef _WIN32
+    if (fopen_s(&output->file, output->path, mode) != 0) {
+        output->file = NULL;
+    }
+#else
+    output->file = fopen(output->path, mode);
+#endif
+    if (!output->file) {
+        return 0;
+    }
+    // Records arrive in large batches, so stdio buffering would only add a
+    // copy
+    setvbuf(output->file, NULL, _IONBF, 0);
+    LruPushFront(output);
+    open_files++;
+    return 1;
+}
+
+static void FreeOutput(partitioned_output_t *output) {
+    CloseFile(output);
+    if (output->ops->free_output) {
+        output->ops->free_output(output);
+    }
+    duckdb_free(output->path);
+    duckdb_free(output);
+}
+
+// Find or create the output for a path, taking a reference. A new file is
+// truncated and started by the format.
+static partitioned_output_t *AcquireOutput(partitioned_writer_t *writer, const char *path, size_t path_len,
+                                           uint64_t hash, const void *arg) {
+    const partitioned_writer_ops_t *ops = writer->ops;
+    PcapMutexLock(&outputs_lock);
+    if (!outputs.slots && !HashMapInit(&outputs, sizeof(uint64_t), sizeof(partitioned_output_t *))) {
+        PcapMutexUnlock(&outputs_lock);
+        return NULL;
+    }
+    partitioned_output_t **chain = (partitioned_output_t **)HashMapFind(&outputs, &hash);
+    partitioned_output_t *output = chain ? *chain : NULL;
+    while (output && (output->ops != ops || output->path_len != path_len ||
+                      memcmp(output->path, path, path_len) != 0)) {
+        output = output->hash_next;
+    }
+    if (!output) {
+        output = (partitioned_output_t *)duckdb_malloc(ops->output_size);
+        if (output) {
+            memset(output, 0, ops->output_size);
+            output->ops = ops;
+            output->path = (char *)duckdb_malloc(path_len + 1);
+        }
+        int is_new;
+        if (!output || !output->path) {
+            duckdb_free(output);
+            output = NULL;
+        } else {
+            memcpy(output->path, path, path_len);
+            output->path[path_len] = '\0';
+            output->path_len = path_len;
+            output->hash = hash;
+            if (!OpenFile(output, "wb") || !ops->start_file(writer, output, arg) ||
+                !(chain = (partitioned_output_t **)HashMapInsert(&outputs, &hash, &is_new))) {
+                FreeOutput(output);
+                output = NULL;
+            } else {
+                output->hash_next = *chain;
+                *chain = output;
+            }
+        }
+    }
+    if (output) {
+        output->refs++;
+    }
+    PcapMutexUnlock(&outputs_lock);
+    return output;
+}
+
+// Drop a reference; the last one finishes and closes the file. Returns 0
+// when the file could not be completed.
+static int ReleaseOutput(partitioned_output_t *output) {
+    int ok = 1;
+    PcapMutexLock(&outputs_lock);
+    if (--output->refs == 0) {
+        partitioned_output_t **chain = (partitioned_output_t **)HashMapFind(&outputs, &output->hash);
+        partitioned_output_t **link = chain;
+        while (*link != output) {
+            link = &(*link)->hash_next;
+        }
+        *link = output->hash_next;
+        if (!*chain) {
+            HashMapRemove(&outputs, &output->hash);
+        }
+        ok = !output->failed;
+        if (ok && output->ops->finish_file) {
+            ok = OpenFile(output, "ab") && output->ops->finish_file(output);
+        }
+        ok = CloseFile(output) && ok;
+        FreeOutput(output);
+        if (outputs.count == 0) {
+            HashMapDestroy(&outputs);
+        }
+    }
+    PcapMutexUnlock(&outputs_lock);
+    return ok;
+}
+
+int PartitionedOutputWrite(partitioned_output_t *output, const uint8_t *data, size_t len) {
+    PcapMutexLock(&outputs_lock);
+    int ok = !output->failed && OpenFile(output, "ab") && fwrite(data, 1, len, output->file) == len;
+    output->failed |= !ok;
+    PcapMutexUnlock(&outputs_lock);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Partitions
+// ---------------------------------------------------------------------------
+
+int PartitionedWriterFlush(partitioned_writer_t *writer, partitioned_partition_t *partition) {
+    size_t buffered = partition->records.len;
+    if (!buffered) {
+        return 1;
+    }
+    // Encode outside the lock, so states only wait on each other for the
+    // write itself
+    size_t len = 0;
+    const uint8_t *data = writer->ops->encode(writer, partition, &len);
+    partitioned_output_t *output = partition->output;
+    PcapMutexLock(&outputs_lock);
+    int ok = data && !output->failed && OpenFile(output, "ab") && fwrite(data, 1, len, output->file) == len &&
+             (!writer->ops->appended || writer->ops->appended(writer, output));
+    output->failed |= !ok;
+    PcapMutexUnlock(&outputs_lock);
+    writer->buffered -= buffered;
+    partition->records.len = 0;
+    return ok;
+}
+
+static int FlushAll(partitioned_writer_t *writer) {
+    int ok = 1;
+    for (uint32_t i = 0; i < writer->count; i++) {
+        ok &= PartitionedWriterFlush(writer, writer->list[i]);
+    }
+    return ok;
+}
+
+static int CompareBuffered(const void *a, const void *b) {
+    size_t len_a = (*(partitioned_partition_t *const *)a)->records.len;
+    size_t len_b = (*(partitioned_partition_t *const *)b)->records.len;
+    return len_a < len_b ? 1 : len_a > len_b ? -1 : 0;
+}
+
+// Over budget: write out the fullest buffers (releasing their memory) until
+// half the budget is left, so quiet partitions keep collecting records
+// instead of cycling their file handles for a few bytes each
+static int FlushLargest(partitioned_writer_t *writer) {
+    partitioned_partition_t **order =
+        (partitioned_partition_t **)duckdb_malloc(writer->count * sizeof(partitioned_partition_t *));
+    if (!order) {
+        return FlushAll(writer);
+    }
+    memcpy(order, writer->list, writer->count * sizeof(partitioned_partition_t *));
+    qsort(order, writer->count, sizeof(partitioned_partition_t *), CompareBuffered);
+    int ok = 1;
+    for (uint32_t i = 0; i < writer->count && writer->buffered > writer->ops->buffer_budget / 2; i++) {
+        ok &= PartitionedWriterFlush(writer, order[i]);
+        StreamBufferFree(&order[i]->records);
+    }
+    duckdb_free(order);
+    return ok;
+}
+
+int PartitionedWriterOriginalLen(const int64_t *original_lens, uint64_t *validity, idx_t row, size_t len,
+                                 uint32_t *original_len) {
+    *original_len = (uint32_t)len;
+    if (!original_lens || !PcapRowValid(validity, row)) {
+        return 1;
+    }
+    if (original_lens[row] < (int64_t)len || original_lens[row] > UINT32_MAX) {
+        return 0;
+    }
+    *original_len = (uint32_t)original_lens[row];
+    return 1;
+}
+
+int PartitionedWriterAdded(partitioned_writer_t *writer, partitioned_partition_t *partition, size_t bytes) {
+    writer->buffered += bytes;
+    writer->packets++;
+    if (partition->records.len >= writer->ops->flush_size) {
+        return PartitionedWriterFlush(writer, partition);
+    }
+    if (writer->buffered >= writer->ops->buffer_budget) {
+        return FlushLargest(writer);
+    }
+    return 1;
+}
+
+// Release the partitions and their output references. Returns 0 when a file
+// could not be completed.
+static int ClearPartitions(partitioned_writer_t *writer) {
+    int ok = 1;
+    for (uint32_t i = 0; i < writer->count; i++) {
+        partitioned_partition_t *partition = writer->list[i];
+        if (partition->output) {
+            ok &= ReleaseOutput(partition->output);
+        }
+        if (writer->ops->free_partition) {
+            writer->ops->free_partition(partition);
+        }
+        StreamBufferFree(&partition->records);
+        duckdb_free(partition);
+    }
+    duckdb_free(writer->list);
+    HashMapDestroy(&writer->partitions);
+    writer->list = NULL;
+    writer->count = 0;
+    writer->capacity = 0;
+    writer->last = NULL;
+    writer->buffered = 0;
+    return ok;
+}
+
+// Write out and release everything the state holds. Returns 0 when a file
+// could not be written or completed.
+static int CloseWriter(partitioned_writer_t *writer) {
+    int ok = FlushAll(writer);
+    ok = ClearPartitions(writer) && ok;
+    if (writer->ops->free_writer) {
+        writer->ops->free_writer(writer);
+    }
+    return ok;
+}
+
+static partitioned_partition_t *FindPartition(partitioned_writer_t *writer, const char *path, size_t path_len,
+                                              uint64_t hash) {
+    if (!writer->partitions.slots) {
+        return NULL;
+    }
+    partitioned_partition_t **chain = (partitioned_partition_t **)HashMapFind(&writer->partitions, &hash);
+    partitioned_partition_t *partition = chain ? *chain : NULL;
+    while (partition && (partition->output->path_len != path_len ||
+                         memcmp(partition->output->path, path, path_len) != 0)) {
+        partition = partition->hash_next;
+    }
+    return partition;
+}
+
+// Add a partition writing to output, taking over the caller's reference
+static partitioned_partition_t *AddPartition(partitioned_writer_t *writer, partitioned_output_t *output) {
+    const partitioned_writer_ops_t *ops = writer->ops;
+    if (!writer->partitions.slots &&
+        !HashMapInit(&writer->partitions, sizeof(uint64_t), sizeof(partitioned_partition_t *))) {
+        return NULL;
+    }
+    if (writer->count == writer->capacity) {
+        uint32_t capacity = writer->capacity ? writer->capacity * 2 : 4;
+        partitioned_partition_t **grown =
+            (partitioned_partition_t **)duckdb_malloc(capacity * sizeof(partitioned_partition_t *));
+        if (!grown) {
+            return NULL;
+        }
+        if (writer->list) {
+            memcpy(grown, writer->list, writer->count * sizeof(partitioned_partition_t *));
+            duckdb_free(writer->list);
+        }
+        writer->list = grown;
+        writer->capacity = capacity;
+    }
+    partitioned_partition_t *partition = (partitioned_partition_t *)duckdb_malloc(ops->partition_size);
+    if (!partition) {
+        return NULL;
+    }
+    int is_new;
+    partitioned_partition_t **chain =
+        (partitioned_partition_t **)HashMapInsert(&writer->partitions, &output->hash, &is_new);
+    if (!chain) {
+        duckdb_free(partition);
+        return NULL;
+    }
+    memset(partition, 0, ops->partition_size);
+    partition->output = output;
+    partition->hash_next = *chain;
+    *chain = partition;
+    writer->list[writer->count++] = partition;
+    return partition;
+}
+
+partitioned_partition_t *PartitionedWriterPartition(partitioned_writer_t *writer, const char *path, size_t path_len,
+                                                    const void *arg) {
+    partitioned_partition_t *partition = writer->last;
+    if (partition && partition->output->path_len == path_len &&
+        memcmp(partition->output->path, path, path_len) == 0) {
+        return partition;
+    }
+    uint64_t hash = HashBytes(path, path_len);
+    partition = FindPartition(writer, path, path_len, hash);
+    if (!partition) {
+        partitioned_output_t *output = AcquireOutput(writer, path, path_len, hash, arg);
+        if (!output) {
+            return NULL;
+        }
+        partition = AddPartition(writer, output);
+        if (!partition) {
+            ReleaseOutput(output);
+            return NULL;
+        }
+    }
+    writer->last = partition;
+    return partition;
+}
+
+// ---------------------------------------------------------------------------
+// Aggregate
+// ---------------------------------------------------------------------------
+
+static const partitioned_writer_ops_t *WriterOps(duckdb_function_info info) {
+    return (const partitioned_writer_ops_t *)duckdb_aggregate_function_get_extra_info(info);
+}
+
+static idx_t WriterSize(duckdb_function_info info) {
+    return WriterOps(info)->writer_size;
+}
+
+static void WriterInit(duckdb_function_info info, duckdb_aggregate_state state) {
+    const partitioned_writer_ops_t *ops = WriterOps(info);
+    memset(state, 0, ops->writer_size);
+    ((partitioned_writer_t *)state)->ops = ops;
+}
+
+static void WriterCombine(duckdb_function_info info, duckdb_aggregate_state *source, duckdb_aggregate_state *target,
+                          idx_t count) {
+    for (idx_t i = 0; i < count; i++) {
+        partitioned_writer_t *from = (partitioned_writer_t *)source[i];
+        partitioned_writer_t *to = (partitioned_writer_t *)target[i];
+        if (!FlushAll(from)) {
+            duckdb_aggregate_function_set_error(info, from->ops->write_error);
+            return;
+        }
+        to->packets += from->packets;
+        from->packets = 0;
+        // Output references move to the target, so no file is finished (or
+        // truncated when created again) while another state may still write
+        // to it
+        for (uint32_t p = 0; p < from->count; p++) {
+            partitioned_partition_t *partition = from->list[p];
+            partitioned_output_t *output = partition->output;
+            if (!FindPartition(to, output->path, output->path_len, output->hash) && AddPartition(to, output)) {
+                partition->output = NULL;
+            }
+        }
+        CloseWriter(from);
+    }
+}
+
+static void WriterFinalize(duckdb_function_info info, duckdb_aggregate_state *source, duckdb_vector result,
+                           idx_t count, idx_t offset) {
+    uint64_t *written = (uint64_t *)duckdb_vector_get_data(result);
+    for (idx_t i = 0; i < count; i++) {
+        partitioned_writer_t *writer = (partitioned_writer_t *)source[i];
+        // Files are complete once the query returns: the final state of each
+        // releases its outputs here rather than when it is destroyed
+        if (!CloseWriter(writer)) {
+            duckdb_aggregate_function_set_error(info, writer->ops->write_error);
+            return;
+        }
+        written[offset + i] = writer->packets;
+    }
+}
+
+static void WriterDestroy(duckdb_aggregate_state *states, idx_t count) {
+    for (idx_t i = 0; i < count; i++) {
+        CloseWriter((partitioned_writer_t *)states[i]);
+    }
+}
+
+void PartitionedWriterSetFunctions(duckdb_aggregate_function function, const partitioned_writer_ops_t *ops,
+                                   duckdb_aggregate_update_t update) {
+    duckdb_aggregate_function_set_extra_info(function, (void *)ops, NULL);
+    duckdb_aggregate_function_set_functions(function, WriterSize, WriterInit, update, WriterCombine,
+                                            WriterFinalize);
+    duckdb_aggregate_function_set_destructor(function, WriterDestroy);
+}
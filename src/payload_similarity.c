@@ -0,0 +1,316 @@
+#include "duckdb_extension.h"
+#include "packet_decode.h"
+#include "payload_similarity.h"
+#include "pcap_reader.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Multiplier of the polynomial rolling hash over a shingle
+#define ROLLING_BASE 0x100000001b3ULL
+
+// Seed of the hash that picks the bin an empty MinHash bin borrows from,
+// fixed so signatures are comparable across queries and databases
+#define DENSIFY_SEED 0x5ca1ab1e0ddba11ULL
+
+// Shingle hashes added into one set of byte lanes before they could overflow
+#define LANE_LIMIT 255
+
+// Hashes of the consecutive shingles of data, produced a block at a time.
+// Shingles of up to 8 bytes are hashed from the bytes themselves, with no
+// dependency from one to the next; longer ones use a rolling hash.
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t width;      // shingle length, at most len
+    size_t next;       // start of the shingle whose hash is in rolling
+    uint64_t rolling;  // polynomial hash of data[next, next + width)
+    uint64_t top;      // ROLLING_BASE^(width - 1), to drop the oldest byte
+} shingle_iter_t;
+
+// Finalizer of MurmurHash3: spreads the rolling hash over all 64 bits
+static uint64_t Mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Data shorter than a shingle is hashed as one shorter shingle
+static void ShinglesInit(shingle_iter_t *it, const uint8_t *data, size_t len, size_t width) {
+    it->data = data;
+    it->len = len;
+    it->width = width < len ? width : len;
+    it->next = 0;
+    it->rolling = 0;
+    it->top = 1;
+    for (size_t i = 0; it->width > 8 && i < it->width; i++) {
+        it->rolling = it->rolling * ROLLING_BASE + data[i];
+        if (i) {
+            it->top *= ROLLING_BASE;
+        }
+    }
+}
+
+// Fill hashes with up to SIMILARITY_BLOCK shingle hashes; returns how many
+static size_t ShinglesNext(shingle_iter_t *it, uint64_t *hashes) {
+    size_t last = it->len - it->width;
+    size_t count = 0;
+    if (it->width <= 8) {
+        // Whole 8-byte loads while they stay inside data, then byte by byte
+        uint32_t shift = (uint32_t)(8 * (8 - it->width));
+        size_t end = it->next + SIMILARITY_BLOCK <= last + 1 ? it->next + SIMILARITY_BLOCK : last + 1;
+        size_t loads = it->len >= 8 ? it->len - 7 : 0;
+        size_t fast = end < loads ? end : loads;
+        for (; it->next < fast; it->next++) {
+            hashes[count++] = Mix64(PacketRead64(it->data + it->next) >> shift);
+        }
+        for (; it->next < end; it->next++) {
+            uint64_t window = 0;
+            for (size_t i = 0; i < it->width; i++) {
+                window = window << 8 | it->data[it->next + i];
+            }
+            hashes[count++] = Mix64(window);
+        }
+        return count;
+    }
+    while (count < SIMILARITY_BLOCK && it->next <= last) {
+        hashes[count++] = Mix64(it->rolling);
+        if (it->next < last) {
+            it->rolling = (it->rolling - it->data[it->next] * it->top) * ROLLING_BASE + it->data[it->next + it->width];
+        }
+        it->next++;
+    }
+    return count;
+}
+
+// Bin of a hash among count bins, from its high bits
+static uint32_t HashBin(uint64_t hash, uint32_t count) {
+    return (uint32_t)(((hash >> 32) * count) >> 32);
+}
+
+// Add byte lanes into per-bit counts; byte j of lane k counts bit 8 * j + k
+static void AddLanes(const uint64_t *lanes, uint64_t *ones) {
+    for (uint32_t bit = 0; bit < 64; bit++) {
+        ones[bit] += (lanes[bit % 8] >> (8 * (bit / 8))) & 0xff;
+    }
+}
+
+// Each bit of the signature is the majority vote of that bit over all
+// shingle hashes, so similar payloads differ in few bits. Votes are counted
+// eight bits at a time in byte lanes, with shifts and masks that vectorize
+// across the block, and added up before a lane can overflow.
+static uint64_t SimHash(const uint8_t *data, size_t len, size_t width) {
+    uint64_t ones[64] = {0};
+    uint64_t lanes[8];
+    uint64_t hashes[SIMILARITY_BLOCK];
+    uint64_t total = 0;
+    shingle_iter_t it;
+    ShinglesInit(&it, data, len, width);
+    size_t count;
+    while ((count = ShinglesNext(&it, hashes)) > 0) {
+        for (size_t start = 0; start < count; start += LANE_LIMIT) {
+            size_t stop = start + LANE_LIMIT < count ? start + LANE_LIMIT : count;
+            for (uint32_t k = 0; k < 8; k++) {
+                uint64_t sum = 0;
+                for (size_t i = start; i < stop; i++) {
+                    sum += (hashes[i] >> k) & 0x0101010101010101ULL;
+                }
+                lanes[k] = sum;
+            }
+            AddLanes(lanes, ones);
+        }
+        total += count;
+    }
+    uint64_t signature = 0;
+    for (uint32_t bit = 0; bit < 64; bit++) {
+        if (ones[bit] * 2 > total) {
+            signature |= 1ULL << bit;
+        }
+    }
+    return signature;
+}
+
+// One-permutation MinHash: each shingle hash goes to one of k bins by its
+// high bits and each bin keeps its minimum, so the cost does not grow with
+// k. Empty bins borrow the minimum of a bin picked by hashing the bin and
+// an attempt number (optimal densification), keeping positions aligned.
+// The fraction of equal positions in two signatures estimates the Jaccard
+// similarity of the shingle sets.
+static void MinHash(const uint8_t *data, size_t len, size_t width, uint64_t *mins, uint32_t k) {
+    uint8_t filled[SIMILARITY_MAX_MINHASH];
+    uint64_t hashes[SIMILARITY_BLOCK];
+    shingle_iter_t it;
+    ShinglesInit(&it, data, len, width);
+    memset(filled, 0, k);
+    for (uint32_t j = 0; j < k; j++) {
+        mins[j] = UINT64_MAX;
+    }
+    size_t count;
+    while ((count = ShinglesNext(&it, hashes)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bin = HashBin(hashes[i], k);
+            mins[bin] = hashes[i] < mins[bin] ? hashes[i] : mins[bin];
+            filled[bin] = 1;
+        }
+    }
+    // There is at least one shingle, so some bin is filled
+    for (uint32_t j = 0; j < k; j++) {
+        if (filled[j]) {
+            continue;
+        }
+        uint32_t from = j;
+        for (uint64_t attempt = 1; !filled[from]; attempt++) {
+            from = HashBin(Mix64(DENSIFY_SEED ^ ((uint64_t)j << 32 | attempt)), k);
+        }
+        mins[j] = mins[from];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar functions
+// ---------------------------------------------------------------------------
+
+// Integer argument column, or NULL when the overload does not take it
+static int32_t *IntegerColumn(duckdb_data_chunk input, idx_t column, uint64_t **validity) {
+    *validity = NULL;
+    if (duckdb_data_chunk_get_column_count(input) <= column) {
+        return NULL;
+    }
+    duckdb_vector vector = duckdb_data_chunk_get_vector(input, column);
+    *validity = duckdb_vector_get_validity(vector);
+    return (int32_t *)duckdb_vector_get_data(vector);
+}
+
+static void SetRangeError(duckdb_function_info info, const char *what, int maximum) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s must be between 1 and %d", what, maximum);
+    duckdb_scalar_function_set_error(info, message);
+}
+
+static void SimHashFunction(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output) {
+    idx_t size = duckdb_data_chunk_get_size(input);
+    duckdb_vector data_vector = duckdb_data_chunk_get_vector(input, 0);
+    duckdb_string_t *data = (duckdb_string_t *)duckdb_vector_get_data(data_vector);
+    uint64_t *data_validity = duckdb_vector_get_validity(data_vector);
+    uint64_t *width_validity;
+    int32_t *widths = IntegerColumn(input, 1, &width_validity);
+    uint64_t *signatures = (uint64_t *)duckdb_vector_get_data(output);
+
+    for (idx_t row = 0; row < size; row++) {
+        if (!PcapRowValid(data_validity, row) || (widths && !PcapRowValid(width_validity, row))) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        int32_t width = widths ? widths[row] : SIMILARITY_DEFAULT_SHINGLE;
+        if (width < 1 || width > SIMILARITY_MAX_SHINGLE) {
+            SetRangeError(info, "Shingle length", SIMILARITY_MAX_SHINGLE);
+            return;
+        }
+        size_t len;
+        const uint8_t *bytes = PcapStringBytes(&data[row], &len);
+        if (!len) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        signatures[row] = SimHash(bytes, len, (size_t)width);
+    }
+}
+
+static void MinHashFunction(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output) {
+    idx_t size = duckdb_data_chunk_get_size(input);
+    duckdb_vector data_vector = duckdb_data_chunk_get_vector(input, 0);
+    duckdb_string_t *data = (duckdb_string_t *)duckdb_vector_get_data(data_vector);
+    uint64_t *data_validity = duckdb_vector_get_validity(data_vector);
+    uint64_t *k_validity;
+    int32_t *ks = IntegerColumn(input, 1, &k_validity);
+    uint64_t *width_validity;
+    int32_t *widths = IntegerColumn(input, 2, &width_validity);
+    duckdb_list_entry *entries = (duckdb_list_entry *)duckdb_vector_get_data(output);
+
+    for (idx_t row = 0; row < size; row++) {
+        if (!PcapRowValid(data_validity, row) || !PcapRowValid(k_validity, row) ||
+            (widths && !PcapRowValid(width_validity, row))) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        int32_t k = ks[row];
+        if (k < 1 || k > SIMILARITY_MAX_MINHASH) {
+            SetRangeError(info, "MinHash size", SIMILARITY_MAX_MINHASH);
+            return;
+        }
+        int32_t width = widths ? widths[row] : SIMILARITY_DEFAULT_SHINGLE;
+        if (width < 1 || width > SIMILARITY_MAX_SHINGLE) {
+            SetRangeError(info, "Shingle length", SIMILARITY_MAX_SHINGLE);
+            return;
+        }
+        size_t len;
+        const uint8_t *bytes = PcapStringBytes(&data[row], &len);
+        if (!len) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        // The signature is computed straight into the list's child vector
+        idx_t offset = duckdb_list_vector_get_size(output);
+        if (duckdb_list_vector_reserve(output, offset + (idx_t)k) != DuckDBSuccess) {
+            duckdb_scalar_function_set_error(info, "Out of memory computing MinHash signature");
+            return;
+        }
+        uint64_t *mins = (uint64_t *)duckdb_vector_get_data(duckdb_list_vector_get_child(output)) + offset;
+        MinHash(bytes, len, (size_t)width, mins, (uint32_t)k);
+        duckdb_list_vector_set_size(output, offset + (idx_t)k);
+        entries[row].offset = offset;
+        entries[row].length = (uint64_t)k;
+    }
+}
+
+static void AddIntegerParameter(duckdb_scalar_function function) {
+    duckdb_logical_type type = duckdb_create_logical_type(DUCKDB_TYPE_INTEGER);
+    duckdb_scalar_function_add_parameter(function, type);
+    duckdb_destroy_logical_type(&type);
+}
+
+// Add one overload to set, taking data followed by integer_params integers
+static void AddOverload(duckdb_scalar_function_set set, const char *name, duckdb_type data_type, int integer_params,
+                        duckdb_logical_type return_type, duckdb_scalar_function_t callback) {
+    duckdb_scalar_function function = duckdb_create_scalar_function();
+    duckdb_scalar_function_set_name(function, name);
+    duckdb_logical_type type = duckdb_create_logical_type(data_type);
+    duckdb_scalar_function_add_parameter(function, type);
+    duckdb_destroy_logical_type(&type);
+    for (int i = 0; i < integer_params; i++) {
+        AddIntegerParameter(function);
+    }
+    duckdb_scalar_function_set_return_type(function, return_type);
+    duckdb_scalar_function_set_function(function, callback);
+    duckdb_add_scalar_function_to_set(set, function);
+    duckdb_destroy_scalar_function(&function);
+}
+
+void RegisterSimilarityFunctions(duckdb_connection connection) {
+    static const duckdb_type data_types[] = {DUCKDB_TYPE_BLOB, DUCKDB_TYPE_VARCHAR};
+
+    duckdb_logical_type ubigint = duckdb_create_logical_type(DUCKDB_TYPE_UBIGINT);
+    duckdb_scalar_function_set set = duckdb_create_scalar_function_set("pcap_simhash");
+    for (size_t i = 0; i < 2; i++) {
+        AddOverload(set, "pcap_simhash", data_types[i], 0, ubigint, SimHashFunction);
+        AddOverload(set, "pcap_simhash", data_types[i], 1, ubigint, SimHashFunction);
+    }
+    duckdb_register_scalar_function_set(connection, set);
+    duckdb_destroy_scalar_function_set(&set);
+
+    duckdb_logical_type signature = duckdb_create_list_type(ubigint);
+    set = duckdb_create_scalar_function_set("pcap_minhash");
+    for (size_t i = 0; i < 2; i++) {
+        AddOverload(set, "pcap_minhash", data_types[i], 1, signature, MinHashFunction);
+        AddOverload(set, "pcap_minhash", data_types[i], 2, signature, MinHashFunction);
+    }
+    duckdb_register_scalar_function_set(connection, set);
+    duckdb_destroy_scalar_function_set(&set);
+    duckdb_destroy_logical_type(&signature);
+    duckdb_destroy_logical_type(&ubigint);
+}
@@ -1,45 +1,74 @@
 #include "duckdb_extension.h"
 #include "pcap_reader.h"
+#include "io_scheduler.h"
+#include "pcap_source.h"
+#include "shared_scan.h"
+#include "sync.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-#include <fcntl.h>
-#include <io.h>
-#include <errno.h>
-#endif
-
 DUCKDB_EXTENSION_EXTERN
 
-// State for the pcap reader
+// Bind data of read_pcap
 typedef struct {
-    FILE *file;
-    pcap_file_header_t file_header;
-    int needs_swap;  // Whether we need to swap byte order
-    int is_nanosecond;  // Whether timestamps are in nanoseconds
     char *filename;
-    int is_stdin;  // Whether we're reading from stdin
-    uint8_t *packet_buffer;  // Reusable buffer for packet data
-    size_t buffer_size;      // Current buffer size
+    int metadata;            // add the interface, direction, flags and drop count columns
+    uint64_t start_ns;       // time window: start_ns <= timestamp_ns < end_ns
+    uint64_t end_ns;
+    capture_cache_t cache;   // page cache mode for local files
+    int shared;              // share a sequential scan with concurrent readers of the capture
+    uint32_t io_share;       // share of the I/O scheduler's throughput
+} pcap_reader_bind_t;
+
+// State for the pcap reader. Captures are read sequentially from source,
+// except compressed classic pcaps with a checkpoint index, whose regions
+// within the time window are handed out to threads, and zip or tar archives,
+// whose members are. Each thread decodes the regions or members it claimed.
+// A shared sequential scan reads through shared instead of source. Every
+// chunk is produced in a turn of the scan's I/O scheduler stream.
+typedef struct {
+    pcap_source_t *source;
+    shared_reader_t *shared;
+    io_stream_t *io;
+    int metadata;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    capture_cache_t cache;
+    const char *filename;
+    uint32_t *regions;       // indexed regions or archive members to read, NULL for a sequential scan
+    uint32_t region_count;
+    const capture_archive_t *archive;  // set when regions are archive members
+    uint32_t next_region;
+    pcap_mutex_t lock;
 } pcap_reader_state_t;
 
-// Swap byte order for 32-bit values
-static uint32_t swap32(uint32_t value) {
-    return ((value & 0xFF000000) >> 24) |
-           ((value & 0x00FF0000) >> 8) |
-           ((value & 0x0000FF00) << 8) |
-           ((value & 0x000000FF) << 24);
-}
+// Thread-local state: the region or member being decoded
+typedef struct {
+    pcap_source_t *source;
+} pcap_reader_local_t;
+
+enum {
+    PCAP_COL_TIMESTAMP,
+    PCAP_COL_ORIGINAL_LEN,
+    PCAP_COL_CAPTURE_LEN,
+    PCAP_COL_DATA,
+    PCAP_COL_INTERFACE_ID,
+    PCAP_COL_DIRECTION,
+    PCAP_COL_FLAGS,
+    PCAP_COL_CRC_ERROR,
+    PCAP_COL_DROP_COUNT,
+    PCAP_COL_COUNT
+};
 
 // Destructor for bind data
-static void PcapReaderBindDataFree(void *data) {
-    pcap_reader_state_t *state = (pcap_reader_state_t *)data;
-    if (state) {
-        if (state->filename) {
-            free(state->filename);
+static void PcapPathBindDataFree(void *data) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)data;
+    if (bind) {
+        if (bind->filename) {
+            duckdb_free(bind->filename);
         }
-        free(state);
+        duckdb_free(bind);
     }
 }
 
@@ -47,275 +76,700 @@ static void PcapReaderBindDataFree(void *data) {
 static void PcapReaderInitDataFree(void *data) {
     pcap_reader_state_t *state = (pcap_reader_state_t *)data;
     if (state) {
-        if (state->file && !state->is_stdin) {
-            fclose(state->file);
-        }
-        if (state->packet_buffer) {
-            duckdb_free(state->packet_buffer);
-        }
-        // Don't free filename here as it's owned by bind data
-        free(state);
+        PcapSourceClose(state->source);
+        SharedScanLeave(state->shared);
+        IoStreamClose(state->io);
+        duckdb_free(state->regions);
+        duckdb_free(state);
     }
 }
 
-// Bind function for the pcap reader
-static void PcapReaderBind(duckdb_bind_info info) {
+static void PcapReaderLocalFree(void *data) {
+    pcap_reader_local_t *local = (pcap_reader_local_t *)data;
+    if (local) {
+        PcapSourceClose(local->source);
+        duckdb_free(local);
+    }
+}
+
+char *PcapBindFilename(duckdb_bind_info info) {
     // Get the file path parameter
     duckdb_value filename_value = duckdb_bind_get_parameter(info, 0);
-    const char *filename = duckdb_get_varchar(filename_value);
-    
+    char *filename = duckdb_get_varchar(filename_value);
+    duckdb_destroy_value(&filename_value);
+
     if (!filename) {
         duckdb_bind_set_error(info, "Filename parameter is required");
-        duckdb_destroy_value(&filename_value);
-        return;
+        return NULL;
     }
-    
-    // Create state for the reader
-    pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_malloc(sizeof(pcap_reader_state_t));
-    if (!state) {
+    return filename;
+}
+
+pcap_path_bind_t *PcapBindPath(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return NULL;
+    }
+
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_malloc(sizeof(pcap_path_bind_t));
+    if (!bind) {
         duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
-        duckdb_free((void *)filename);
-        duckdb_destroy_value(&filename_value);
+        duckdb_free(filename);
+        return NULL;
+    }
+    bind->filename = filename;
+
+    // Set the bind data
+    duckdb_bind_set_bind_data(info, bind, PcapPathBindDataFree);
+    return bind;
+}
+
+void PcapBindAddColumn(duckdb_bind_info info, const char *name, duckdb_type type) {
+    duckdb_logical_type logical_type = duckdb_create_logical_type(type);
+    duckdb_bind_add_result_column(info, name, logical_type);
+    duckdb_destroy_logical_type(&logical_type);
+}
+
+void PcapBindAddListColumn(duckdb_bind_info info, const char *name, duckdb_type child_type) {
+    duckdb_logical_type child = duckdb_create_logical_type(child_type);
+    duckdb_logical_type list_type = duckdb_create_list_type(child);
+    duckdb_bind_add_result_column(info, name, list_type);
+    duckdb_destroy_logical_type(&list_type);
+    duckdb_destroy_logical_type(&child);
+}
+
+void PcapBindAddEnumColumn(duckdb_bind_info info, const char *name, const char *const *members, idx_t count) {
+    duckdb_logical_type enum_type = duckdb_create_enum_type((const char **)members, count);
+    duckdb_bind_add_result_column(info, name, enum_type);
+    duckdb_destroy_logical_type(&enum_type);
+}
+
+void PcapListAssignSplit(duckdb_vector vector, idx_t row, const char *text, size_t len, char separator) {
+    duckdb_list_entry *entries = (duckdb_list_entry *)duckdb_vector_get_data(vector);
+    idx_t offset = duckdb_list_vector_get_size(vector);
+
+    idx_t count = len ? 1 : 0;
+    for (size_t i = 0; i < len; i++) {
+        count += text[i] == separator;
+    }
+    duckdb_list_vector_reserve(vector, offset + count);
+    duckdb_vector child = duckdb_list_vector_get_child(vector);
+
+    size_t start = 0;
+    idx_t item = 0;
+    for (size_t i = 0; len && i <= len; i++) {
+        if (i == len || text[i] == separator) {
+            duckdb_vector_assign_string_element_len(child, offset + item++, text + start, i - start);
+            start = i + 1;
+        }
+    }
+    duckdb_list_vector_set_size(vector, offset + count);
+    entries[row].offset = offset;
+    entries[row].length = count;
+}
+
+void PcapListAssignU32(duckdb_vector vector, idx_t row, const uint32_t *values, idx_t count) {
+    duckdb_list_entry *entries = (duckdb_list_entry *)duckdb_vector_get_data(vector);
+    idx_t offset = duckdb_list_vector_get_size(vector);
+
+    duckdb_list_vector_reserve(vector, offset + count);
+    duckdb_vector child = duckdb_list_vector_get_child(vector);
+    if (count) {
+        memcpy((uint32_t *)duckdb_vector_get_data(child) + offset, values, count * sizeof(uint32_t));
+    }
+    duckdb_list_vector_set_size(vector, offset + count);
+    entries[row].offset = offset;
+    entries[row].length = count;
+}
+
+void PcapVectorSetNull(duckdb_vector vector, idx_t row) {
+    duckdb_vector_ensure_validity_writable(vector);
+    duckdb_validity_set_row_invalid(duckdb_vector_get_validity(vector), row);
+}
+
+void PcapVectorAssignString(duckdb_vector vector, idx_t row, const char *value) {
+    if (value && value[0]) {
+        duckdb_vector_assign_string_element(vector, row, value);
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+const uint8_t *PcapStringBytes(duckdb_string_t *string, size_t *len) {
+    *len = string->value.inlined.length;
+    if (*len <= sizeof(string->value.inlined.inlined)) {
+        return (const uint8_t *)string->value.inlined.inlined;
+    }
+    return (const uint8_t *)string->value.pointer.ptr;
+}
+
+int PcapRowValid(uint64_t *validity, idx_t row) {
+    return !validity || duckdb_validity_row_is_valid(validity, row);
+}
+
+static void PcapReaderBindDataFree(void *data) {
+    pcap_reader_bind_t *bind = (pcap_reader_bind_t *)data;
+    if (bind) {
+        duckdb_free(bind->filename);
+        duckdb_free(bind);
+    }
+}
+
+// Bind function for the pcap reader
+static void PcapReaderBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
         return;
     }
-    
-    // Store filename - we need to copy it as the value will be destroyed
-    size_t filename_len = strlen(filename) + 1;
-    state->filename = (char *)duckdb_malloc(filename_len);
-    if (!state->filename) {
-        duckdb_bind_set_error(info, "Failed to allocate memory for filename");
-        duckdb_free(state);
-        duckdb_free((void *)filename);
-        duckdb_destroy_value(&filename_value);
+    pcap_reader_bind_t *bind = (pcap_reader_bind_t *)duckdb_malloc(sizeof(pcap_reader_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
         return;
     }
-#ifdef _WIN32
-    strcpy_s(state->filename, filename_len, filename);
-#else
-    memcpy(state->filename, filename, filename_len);
-#endif
-    state->file = NULL;
-    state->needs_swap = 0;
-    state->is_nanosecond = 0;
-    state->is_stdin = (strcmp(filename, "/dev/stdin") == 0 || strcmp(filename, "-") == 0);
-    state->packet_buffer = NULL;
-    state->buffer_size = 0;
-    
-    // Free the filename from duckdb_get_varchar
-    duckdb_free((void *)filename);
-    
-    // Set the bind data
-    duckdb_bind_set_bind_data(info, state, PcapReaderBindDataFree);
-    
+    bind->filename = filename;
+    bind->metadata = 0;
+    bind->start_ns = 0;
+    bind->end_ns = UINT64_MAX;
+    bind->cache = CAPTURE_CACHE_NORMAL;
+    bind->shared = 0;
+    bind->io_share = IO_SCHEDULER_DEFAULT_SHARE;
+    duckdb_bind_set_bind_data(info, bind, PcapReaderBindDataFree);
+
+    duckdb_value metadata = duckdb_bind_get_named_parameter(info, "metadata");
+    if (metadata) {
+        bind->metadata = !duckdb_is_null_value(metadata) && duckdb_get_bool(metadata);
+        duckdb_destroy_value(&metadata);
+    }
+    duckdb_value shared = duckdb_bind_get_named_parameter(info, "shared");
+    if (shared) {
+        bind->shared = !duckdb_is_null_value(shared) && duckdb_get_bool(shared);
+        duckdb_destroy_value(&shared);
+    }
+    duckdb_value io_share = duckdb_bind_get_named_parameter(info, "io_share");
+    if (io_share) {
+        if (!duckdb_is_null_value(io_share)) {
+            bind->io_share = duckdb_get_uint32(io_share);
+        }
+        duckdb_destroy_value(&io_share);
+        if (bind->io_share < 1 || bind->io_share > IO_SCHEDULER_MAX_SHARE) {
+            duckdb_bind_set_error(info, "io_share must be between 1 and 1000");
+            return;
+        }
+    }
+    duckdb_value start = duckdb_bind_get_named_parameter(info, "start_ns");
+    if (start) {
+        if (!duckdb_is_null_value(start)) {
+            bind->start_ns = duckdb_get_uint64(start);
+        }
+        duckdb_destroy_value(&start);
+    }
+    duckdb_value end = duckdb_bind_get_named_parameter(info, "end_ns");
+    if (end) {
+        if (!duckdb_is_null_value(end)) {
+            bind->end_ns = duckdb_get_uint64(end);
+        }
+        duckdb_destroy_value(&end);
+    }
+    duckdb_value cache = duckdb_bind_get_named_parameter(info, "cache");
+    if (cache) {
+        int valid = 1;
+        if (!duckdb_is_null_value(cache)) {
+            char *name = duckdb_get_varchar(cache);
+            valid = name && CaptureCacheParse(name, &bind->cache);
+            duckdb_free(name);
+        }
+        duckdb_destroy_value(&cache);
+        if (!valid) {
+            duckdb_bind_set_error(info, "cache must be 'normal', 'dontneed' or 'direct'");
+            return;
+        }
+    }
+
     // Add return columns
-    duckdb_logical_type ubigint_type = duckdb_create_logical_type(DUCKDB_TYPE_UBIGINT);
-    duckdb_logical_type uinteger_type = duckdb_create_logical_type(DUCKDB_TYPE_UINTEGER);
-    duckdb_logical_type blob_type = duckdb_create_logical_type(DUCKDB_TYPE_BLOB);
-    
-    duckdb_bind_add_result_column(info, "timestamp_ns", ubigint_type);
-    duckdb_bind_add_result_column(info, "original_len", uinteger_type);
-    duckdb_bind_add_result_column(info, "capture_len", uinteger_type);
-    duckdb_bind_add_result_column(info, "data", blob_type);
-    
-    duckdb_destroy_logical_type(&ubigint_type);
-    duckdb_destroy_logical_type(&uinteger_type);
-    duckdb_destroy_logical_type(&blob_type);
-    
-    duckdb_destroy_value(&filename_value);
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "original_len", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "capture_len", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "data", DUCKDB_TYPE_BLOB);
+    if (bind->metadata) {
+        // pcapng per-packet fields; NULL when a packet (or the format) has none
+        PcapBindAddColumn(info, "interface_id", DUCKDB_TYPE_UINTEGER);
+        PcapBindAddColumn(info, "direction", DUCKDB_TYPE_VARCHAR);
+        PcapBindAddColumn(info, "flags", DUCKDB_TYPE_UINTEGER);
+        PcapBindAddColumn(info, "crc_error", DUCKDB_TYPE_BOOLEAN);
+        PcapBindAddColumn(info, "drop_count", DUCKDB_TYPE_UBIGINT);
+    }
 }
 
 // Init function for the pcap reader
 static void PcapReaderInit(duckdb_init_info info) {
-    pcap_reader_state_t *bind_state = (pcap_reader_state_t *)duckdb_init_get_bind_data(info);
-    
+    pcap_reader_bind_t *bind = (pcap_reader_bind_t *)duckdb_init_get_bind_data(info);
+
     // Create a new state for this init
     pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_malloc(sizeof(pcap_reader_state_t));
     if (!state) {
         duckdb_init_set_error(info, "Failed to allocate memory for init state");
         return;
     }
-    
-    // Copy relevant data from bind state
-    state->filename = bind_state->filename;  // Just reference, don't copy
-    state->needs_swap = 0;
-    state->is_nanosecond = 0;
-    state->is_stdin = bind_state->is_stdin;
-    state->packet_buffer = NULL;
-    state->buffer_size = 0;
-    
+    memset(state, 0, sizeof(pcap_reader_state_t));
+    pcap_mutex_t unlocked = PCAP_MUTEX_INITIALIZER;
+    state->lock = unlocked;
+    state->metadata = bind->metadata;
+    state->start_ns = bind->start_ns;
+    state->end_ns = bind->end_ns;
+    state->cache = bind->cache;
+    state->filename = bind->filename;
+
     // Open the pcap file or use stdin
-    if (state->is_stdin) {
-        state->file = stdin;
-#ifdef _WIN32
-        // Set stdin to binary mode on Windows
-        _setmode(_fileno(stdin), _O_BINARY);
-#endif
-    } else {
-#ifdef _WIN32
-        errno_t err = fopen_s(&state->file, state->filename, "rb");
-        if (err != 0 || !state->file) {
-            duckdb_free(state);
-            duckdb_init_set_error(info, "Failed to open pcap file");
-            return;
-        }
-#else
-        state->file = fopen(state->filename, "rb");
-        if (!state->file) {
-            duckdb_free(state);
-            duckdb_init_set_error(info, "Failed to open pcap file");
-            return;
-        }
-#endif
-    }
-    
-    // Read the file header
-    if (fread(&state->file_header, sizeof(pcap_file_header_t), 1, state->file) != 1) {
-        if (!state->is_stdin) {
-            fclose(state->file);
-        }
+    const char *error = PcapSourceOpenWithCache(bind->filename, bind->cache, &state->source);
+    if (error) {
         duckdb_free(state);
-        duckdb_init_set_error(info, "Failed to read pcap file header");
+        duckdb_init_set_error(info, error);
         return;
     }
-    
-    // Check magic number and determine if we need to swap bytes and timestamp precision
-    if (state->file_header.magic_number == PCAP_MAGIC_NATIVE) {
-        state->needs_swap = 0;
-        state->is_nanosecond = 0;
-    } else if (state->file_header.magic_number == PCAP_MAGIC_SWAPPED) {
-        state->needs_swap = 1;
-        state->is_nanosecond = 0;
-        // Swap the header fields we'll use
-        state->file_header.snaplen = swap32(state->file_header.snaplen);
-    } else if (state->file_header.magic_number == PCAP_MAGIC_NANO_NATIVE) {
-        state->needs_swap = 0;
-        state->is_nanosecond = 1;
-    } else if (state->file_header.magic_number == PCAP_MAGIC_NANO_SWAPPED) {
-        state->needs_swap = 1;
-        state->is_nanosecond = 1;
-        // Swap the header fields we'll use
-        state->file_header.snaplen = swap32(state->file_header.snaplen);
-    } else {
-        if (!state->is_stdin) {
-            fclose(state->file);
+    duckdb_init_set_init_data(info, state, PcapReaderInitDataFree);
+    state->io = IoStreamOpen(bind->io_share);
+
+    // With a checkpoint index, skip the regions outside the time window and
+    // let every thread decode regions of its own; archive members are shared
+    // out the same way
+    const capture_index_t *index = PcapSourceIndex(state->source);
+    state->archive = PcapSourceArchive(state->source);
+    if (!index && !state->archive) {
+        // Sequential scan, joining other readers of the capture if asked to
+        if (bind->shared && !PcapSourceIsStdin(bind->filename)) {
+            error = SharedScanJoin(bind->filename, bind->cache, state->source, &state->shared);
+            state->source = NULL;
+            if (error) {
+                duckdb_init_set_error(info, error);
+            }
         }
-        duckdb_free(state);
-        duckdb_init_set_error(info, "Invalid pcap file magic number");
         return;
     }
-    
-    // Pre-allocate packet buffer based on snaplen
-    state->buffer_size = state->file_header.snaplen;
-    state->packet_buffer = (uint8_t *)duckdb_malloc(state->buffer_size);
-    if (!state->packet_buffer) {
-        if (!state->is_stdin) {
-            fclose(state->file);
+    uint32_t count = index ? index->count : CaptureArchiveMemberCount(state->archive);
+    state->regions = (uint32_t *)duckdb_malloc(count * sizeof(uint32_t));
+    if (!state->regions) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    for (uint32_t region = 0; region < count; region++) {
+        if (!index || CaptureIndexRegionOverlaps(index, region, state->start_ns, state->end_ns)) {
+            state->regions[state->region_count++] = region;
         }
-        duckdb_free(state);
-        duckdb_init_set_error(info, "Failed to allocate packet buffer");
+    }
+    duckdb_init_set_max_threads(info, state->region_count ? state->region_count : 1);
+}
+
+static void PcapReaderLocalInit(duckdb_init_info info) {
+    pcap_reader_local_t *local = (pcap_reader_local_t *)duckdb_malloc(sizeof(pcap_reader_local_t));
+    if (!local) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
         return;
     }
-    
-    duckdb_init_set_init_data(info, state, PcapReaderInitDataFree);
+    local->source = NULL;
+    duckdb_init_set_init_data(info, local, PcapReaderLocalFree);
+}
+
+// The source to read the next packets from: the capture itself, or the
+// thread's current region or member, claiming the next one once it is
+// exhausted. Members that hold no capture are passed over, as in a
+// sequential read. Returns NULL when nothing is left.
+static pcap_source_t *ReaderSource(duckdb_function_info info, pcap_reader_state_t *state,
+                                   pcap_reader_local_t *local) {
+    if (!state->regions) {
+        return state->source;
+    }
+    while (!local->source) {
+        PcapMutexLock(&state->lock);
+        uint32_t claimed = state->next_region;
+        if (claimed < state->region_count) {
+            state->next_region++;
+        }
+        PcapMutexUnlock(&state->lock);
+        if (claimed >= state->region_count) {
+            return NULL;
+        }
+        if (state->archive) {
+            PcapSourceOpenMember(state->archive, state->regions[claimed], &local->source);
+            continue;
+        }
+        const char *error = PcapSourceOpenRegion(state->filename, PcapSourceIndex(state->source),
+                                                 state->regions[claimed], state->cache, &local->source);
+        if (error) {
+            duckdb_function_set_error(info, error);
+            return NULL;
+        }
+    }
+    return local->source;
+}
+
+static void AssignMetadata(duckdb_vector *vectors, idx_t row, const pcap_packet_t *packet) {
+    ((uint32_t *)duckdb_vector_get_data(vectors[PCAP_COL_INTERFACE_ID]))[row] = packet->interface_id;
+    if (packet->present & PCAP_PACKET_HAS_FLAGS) {
+        uint32_t direction = packet->flags & PCAP_FLAGS_DIRECTION_MASK;
+        if (direction == PCAP_FLAGS_INBOUND || direction == PCAP_FLAGS_OUTBOUND) {
+            duckdb_vector_assign_string_element(vectors[PCAP_COL_DIRECTION], row,
+                                                direction == PCAP_FLAGS_INBOUND ? "inbound" : "outbound");
+        } else {
+            PcapVectorSetNull(vectors[PCAP_COL_DIRECTION], row);
+        }
+        ((uint32_t *)duckdb_vector_get_data(vectors[PCAP_COL_FLAGS]))[row] = packet->flags;
+        ((bool *)duckdb_vector_get_data(vectors[PCAP_COL_CRC_ERROR]))[row] = (packet->flags & PCAP_FLAGS_CRC_ERROR) != 0;
+    } else {
+        PcapVectorSetNull(vectors[PCAP_COL_DIRECTION], row);
+        PcapVectorSetNull(vectors[PCAP_COL_FLAGS], row);
+        PcapVectorSetNull(vectors[PCAP_COL_CRC_ERROR], row);
+    }
+    if (packet->present & PCAP_PACKET_HAS_DROP_COUNT) {
+        ((uint64_t *)duckdb_vector_get_data(vectors[PCAP_COL_DROP_COUNT]))[row] = packet->drop_count;
+    } else {
+        PcapVectorSetNull(vectors[PCAP_COL_DROP_COUNT], row);
+    }
+}
+
+// Next packet of the scan, from the shared scan or the thread's source.
+// Returns 0 at the end.
+static int ReaderNext(duckdb_function_info info, pcap_reader_state_t *state, pcap_reader_local_t *local,
+                      pcap_packet_t *packet) {
+    if (state->shared) {
+        return SharedScanNext(state->shared, packet);
+    }
+    for (;;) {
+        pcap_source_t *source = ReaderSource(info, state, local);
+        if (!source) {
+            return 0;
+        }
+        if (PcapSourceNext(source, packet)) {
+            return 1;
+        }
+        if (source == state->source) {
+            return 0;
+        }
+        PcapSourceClose(local->source);
+        local->source = NULL;
+    }
 }
 
 // Function to read packets from the pcap file
 static void PcapReaderFunction(duckdb_function_info info, duckdb_data_chunk output) {
     pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_function_get_init_data(info);
-    
-    if (!state || !state->file) {
+    pcap_reader_local_t *local = (pcap_reader_local_t *)duckdb_function_get_local_init_data(info);
+
+    if (!state || (!state->source && !state->shared) || !local) {
         duckdb_data_chunk_set_size(output, 0);
         return;
     }
-    
+
     // Get output vectors
-    duckdb_vector timestamp_vec = duckdb_data_chunk_get_vector(output, 0);
-    duckdb_vector original_len_vec = duckdb_data_chunk_get_vector(output, 1);
-    duckdb_vector capture_len_vec = duckdb_data_chunk_get_vector(output, 2);
-    duckdb_vector data_vec = duckdb_data_chunk_get_vector(output, 3);
-    
-    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(timestamp_vec);
-    uint32_t *original_len_data = (uint32_t *)duckdb_vector_get_data(original_len_vec);
-    uint32_t *capture_len_data = (uint32_t *)duckdb_vector_get_data(capture_len_vec);
-    
+    duckdb_vector vectors[PCAP_COL_COUNT];
+    idx_t column_count = state->metadata ? PCAP_COL_COUNT : PCAP_COL_DATA + 1;
+    for (idx_t i = 0; i < column_count; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(vectors[PCAP_COL_TIMESTAMP]);
+    uint32_t *original_len_data = (uint32_t *)duckdb_vector_get_data(vectors[PCAP_COL_ORIGINAL_LEN]);
+    uint32_t *capture_len_data = (uint32_t *)duckdb_vector_get_data(vectors[PCAP_COL_CAPTURE_LEN]);
+
     idx_t row_count = 0;
     idx_t max_rows = duckdb_vector_size();
-    
-    while (row_count < max_rows && !feof(state->file)) {
-        pcap_packet_header_t packet_header;
-        
-        // Read packet header
-        if (fread(&packet_header, sizeof(pcap_packet_header_t), 1, state->file) != 1) {
-            break;
-        }
-        
-        // Swap bytes if needed
-        if (state->needs_swap) {
-            packet_header.ts_sec = swap32(packet_header.ts_sec);
-            packet_header.ts_usec = swap32(packet_header.ts_usec);
-            packet_header.caplen = swap32(packet_header.caplen);
-            packet_header.len = swap32(packet_header.len);
-        }
-        
-        // Convert timestamp to nanoseconds
-        uint64_t timestamp_ns;
-        if (state->is_nanosecond) {
-            // ts_usec field contains nanoseconds in nanosecond-precision files
-            timestamp_ns = ((uint64_t)packet_header.ts_sec * 1000000000ULL) + 
-                          (uint64_t)packet_header.ts_usec;
-        } else {
-            // ts_usec field contains microseconds in microsecond-precision files
-            timestamp_ns = ((uint64_t)packet_header.ts_sec * 1000000000ULL) + 
-                          ((uint64_t)packet_header.ts_usec * 1000ULL);
-        }
-        
-        // Reallocate buffer if packet is larger than current buffer
-        if (packet_header.caplen > state->buffer_size) {
-            uint8_t *new_buffer = (uint8_t *)duckdb_malloc(packet_header.caplen);
-            if (!new_buffer) {
+    pcap_packet_t packet;
+    int done = 0;
+
+    // Each pass is one unit of work, which ends with the chunk or with its
+    // budget of packets read, in the time window or not. Without a turn only
+    // one packet is read, so that a row can go back to DuckDB (which stops
+    // the scan if the query was interrupted) before waiting again. A chunk
+    // goes back once a unit produced rows; an empty one would end the scan.
+    do {
+        int turn = IoSchedulerAcquire(state->io);
+        uint64_t budget = turn ? IO_SCHEDULER_TURN_PACKETS : 1;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        while (row_count < max_rows && packets < budget && bytes < IO_SCHEDULER_TURN_BYTES) {
+            if (!ReaderNext(info, state, local, &packet)) {
+                done = 1;
                 break;
             }
-            duckdb_free(state->packet_buffer);
-            state->packet_buffer = new_buffer;
-            state->buffer_size = packet_header.caplen;
+            packets++;
+            bytes += packet.capture_len;
+            if (packet.timestamp_ns < state->start_ns || packet.timestamp_ns >= state->end_ns) {
+                continue;
+            }
+
+            // Set output values
+            timestamp_data[row_count] = packet.timestamp_ns;
+            original_len_data[row_count] = packet.original_len;
+            capture_len_data[row_count] = packet.capture_len;
+
+            // Set blob data - DuckDB copies the data internally
+            duckdb_vector_assign_string_element_len(vectors[PCAP_COL_DATA], row_count,
+                                                    (const char *)packet.data, packet.capture_len);
+            if (state->metadata) {
+                AssignMetadata(vectors, row_count, &packet);
+            }
+
+            row_count++;
         }
-        
-        // Read packet data into reusable buffer
-        if (fread(state->packet_buffer, 1, packet_header.caplen, state->file) != packet_header.caplen) {
-            break;
+        if (turn) {
+            IoSchedulerRelease(state->io, bytes);
+        } else {
+            IoSchedulerCharge(state->io, bytes);
         }
-        
-        // Set output values
-        timestamp_data[row_count] = timestamp_ns;
-        original_len_data[row_count] = packet_header.len;
-        capture_len_data[row_count] = packet_header.caplen;
-        
-        // Set blob data - DuckDB copies the data internally
-        duckdb_vector_assign_string_element_len(data_vec, row_count, (const char *)state->packet_buffer, packet_header.caplen);
-        
-        row_count++;
-    }
-    
+    } while (!row_count && !done);
+
     duckdb_data_chunk_set_size(output, row_count);
 }
 
-// Register the pcap reader function
-void RegisterPcapReaderFunction(duckdb_connection connection) {
+void PcapRegisterPathFunction(duckdb_connection connection, const char *name, duckdb_table_function_bind_t bind,
+                              duckdb_table_function_init_t init, duckdb_table_function_t function_ptr) {
     // Create table function
     duckdb_table_function function = duckdb_create_table_function();
-    duckdb_table_function_set_name(function, "read_pcap");
-    
+    duckdb_table_function_set_name(function, name);
+
     // Add parameter for filename
     duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
     duckdb_table_function_add_parameter(function, varchar_type);
     duckdb_destroy_logical_type(&varchar_type);
-    
+
     // Set function callbacks
+    duckdb_table_function_set_bind(function, bind);
+    duckdb_table_function_set_init(function, init);
+    duckdb_table_function_set_function(function, function_ptr);
+
+    // Register the function
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
+
+// Register the pcap reader function
+void RegisterPcapReaderFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "read_pcap");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_logical_type bool_type = duckdb_create_logical_type(DUCKDB_TYPE_BOOLEAN);
+    duckdb_table_function_add_named_parameter(function, "metadata", bool_type);
+    duckdb_table_function_add_named_parameter(function, "shared", bool_type);
+    duckdb_destroy_logical_type(&bool_type);
+    varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_named_parameter(function, "cache", varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_logical_type ubigint_type = duckdb_create_logical_type(DUCKDB_TYPE_UBIGINT);
+    duckdb_table_function_add_named_parameter(function, "start_ns", ubigint_type);
+    duckdb_table_function_add_named_parameter(function, "end_ns", ubigint_type);
+    duckdb_logical_type uinteger_type = duckdb_create_logical_type(DUCKDB_TYPE_UINTEGER);
+    duckdb_table_function_add_named_parameter(function, "io_share", uinteger_type);
+    duckdb_destroy_logical_type(&uinteger_type);
+    duckdb_destroy_logical_type(&ubigint_type);
+
     duckdb_table_function_set_bind(function, PcapReaderBind);
     duckdb_table_function_set_init(function, PcapReaderInit);
+    duckdb_table_function_set_local_init(function, PcapReaderLocalInit);
     duckdb_table_function_set_function(function, PcapReaderFunction);
-    
-    // Register the function
+
     duckdb_register_table_function(connection, function);
     duckdb_destroy_table_function(&function);
 }
+
+// ---------------------------------------------------------------------------
+// pcapng_interface_stats
+// ---------------------------------------------------------------------------
+
+enum {
+    STATS_COL_INTERFACE_ID,
+    STATS_COL_INTERFACE_NAME,
+    STATS_COL_LINK_TYPE,
+    STATS_COL_TIMESTAMP,
+    STATS_COL_START_TIMESTAMP,
+    STATS_COL_END_TIMESTAMP,
+    STATS_COL_RECEIVED,
+    STATS_COL_DROPPED,
+    STATS_COL_FILTER_ACCEPTED,
+    STATS_COL_OS_DROPPED,
+    STATS_COL_DELIVERED,
+    STATS_COL_COUNT
+};
+
+static void InterfaceStatsBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "interface_id", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "interface_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "link_type", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "start_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "end_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "received", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "dropped", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "filter_accepted", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "os_dropped", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "delivered", DUCKDB_TYPE_UBIGINT);
+}
+
+static void InterfaceStatsInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_malloc(sizeof(pcap_reader_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(pcap_reader_state_t));
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        duckdb_free(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, PcapReaderInitDataFree);
+}
+
+// Set an optional counter, NULL unless its bit is present
+static void AssignCounter(duckdb_vector vector, idx_t row, const pcap_interface_stats_t *stats, uint32_t bit,
+                          uint64_t value) {
+    if (stats->present & bit) {
+        ((uint64_t *)duckdb_vector_get_data(vector))[row] = value;
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+static void InterfaceStatsFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[STATS_COL_COUNT];
+    for (idx_t i = 0; i < STATS_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint32_t *interface_ids = (uint32_t *)duckdb_vector_get_data(vectors[STATS_COL_INTERFACE_ID]);
+    uint32_t *link_types = (uint32_t *)duckdb_vector_get_data(vectors[STATS_COL_LINK_TYPE]);
+    uint64_t *timestamps = (uint64_t *)duckdb_vector_get_data(vectors[STATS_COL_TIMESTAMP]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_interface_stats_t stats;
+    while (row_count < max_rows && PcapSourceNextStats(state->source, &stats)) {
+        idx_t row = row_count++;
+        interface_ids[row] = stats.interface_id;
+        if (stats.interface_name) {
+            duckdb_vector_assign_string_element(vectors[STATS_COL_INTERFACE_NAME], row, stats.interface_name);
+        } else {
+            PcapVectorSetNull(vectors[STATS_COL_INTERFACE_NAME], row);
+        }
+        link_types[row] = stats.link_type;
+        timestamps[row] = stats.timestamp_ns;
+        AssignCounter(vectors[STATS_COL_START_TIMESTAMP], row, &stats, PCAP_STATS_START, stats.start_ns);
+        AssignCounter(vectors[STATS_COL_END_TIMESTAMP], row, &stats, PCAP_STATS_END, stats.end_ns);
+        AssignCounter(vectors[STATS_COL_RECEIVED], row, &stats, PCAP_STATS_RECEIVED, stats.received);
+        AssignCounter(vectors[STATS_COL_DROPPED], row, &stats, PCAP_STATS_DROPPED, stats.dropped);
+        AssignCounter(vectors[STATS_COL_FILTER_ACCEPTED], row, &stats, PCAP_STATS_FILTER_ACCEPTED,
+                      stats.filter_accepted);
+        AssignCounter(vectors[STATS_COL_OS_DROPPED], row, &stats, PCAP_STATS_OS_DROPPED, stats.os_dropped);
+        AssignCounter(vectors[STATS_COL_DELIVERED], row, &stats, PCAP_STATS_DELIVERED, stats.delivered);
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterInterfaceStatsFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcapng_interface_stats", InterfaceStatsBind, InterfaceStatsInit,
+                             InterfaceStatsFunction);
+}
+
+// ---------------------------------------------------------------------------
+// pcap_gzip_index
+// ---------------------------------------------------------------------------
+
+enum {
+    GZIP_INDEX_COL_REGION,
+    GZIP_INDEX_COL_COMPRESSED_BIT_OFFSET,
+    GZIP_INDEX_COL_UNCOMPRESSED_OFFSET,
+    GZIP_INDEX_COL_RECORD_OFFSET,
+    GZIP_INDEX_COL_PACKETS,
+    GZIP_INDEX_COL_MIN_TIMESTAMP,
+    GZIP_INDEX_COL_MAX_TIMESTAMP,
+    GZIP_INDEX_COL_COUNT
+};
+
+static void GzipIndexBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "region", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "compressed_bit_offset", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "uncompressed_offset", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "record_offset", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "packets", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "min_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "max_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+}
+
+static void GzipIndexInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_malloc(sizeof(pcap_reader_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(pcap_reader_state_t));
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        duckdb_free(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, PcapReaderInitDataFree);
+
+    // Without a sidecar, build the index with a full scan
+    if (!PcapSourceIndex(state->source)) {
+        pcap_packet_t packet;
+        while (PcapSourceNext(state->source, &packet)) {
+        }
+    }
+    if (!PcapSourceIndex(state->source)) {
+        duckdb_init_set_error(info, "pcap_gzip_index requires a complete gzip-compressed classic pcap file");
+    }
+}
+
+static void GzipIndexFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    pcap_reader_state_t *state = (pcap_reader_state_t *)duckdb_function_get_init_data(info);
+    const capture_index_t *index = PcapSourceIndex(state->source);
+
+    duckdb_vector vectors[GZIP_INDEX_COL_COUNT];
+    for (idx_t i = 0; i < GZIP_INDEX_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint32_t *regions = (uint32_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_REGION]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    while (row_count < max_rows && state->next_region < index->count) {
+        idx_t row = row_count++;
+        uint32_t region = state->next_region++;
+        const capture_checkpoint_t *checkpoint = &index->checkpoints[region];
+        regions[row] = region;
+        ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_COMPRESSED_BIT_OFFSET]))[row] = checkpoint->in_bits;
+        ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_UNCOMPRESSED_OFFSET]))[row] =
+            checkpoint->out_offset;
+        ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_RECORD_OFFSET]))[row] = checkpoint->record_offset;
+        ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_PACKETS]))[row] = checkpoint->packets;
+        if (checkpoint->packets) {
+            ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_MIN_TIMESTAMP]))[row] =
+                checkpoint->min_timestamp_ns;
+            ((uint64_t *)duckdb_vector_get_data(vectors[GZIP_INDEX_COL_MAX_TIMESTAMP]))[row] =
+                checkpoint->max_timestamp_ns;
+        } else {
+            PcapVectorSetNull(vectors[GZIP_INDEX_COL_MIN_TIMESTAMP], row);
+            PcapVectorSetNull(vectors[GZIP_INDEX_COL_MAX_TIMESTAMP], row);
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterGzipIndexFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_gzip_index", GzipIndexBind, GzipIndexInit, GzipIndexFunction);
+}
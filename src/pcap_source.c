@@ -0,0 +1,1095 @@
+#include "duckdb_extension.h"
+#include "capture_archive.h"
+#include "capture_file.h"
+#include "gzip_index.h"
+#include "http_file.h"
+#include "inflate.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "zstd_codec.h"
+#include "zstd_seekable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Interface of a pcapng section, from its Interface Description Block
+typedef struct {
+    uint32_t link_type;
+    uint32_t snaplen;
+    uint8_t tsresol;         // if_tsresol: 10^-n seconds, or 2^-n with the high bit set
+    int64_t tsoffset;        // if_tsoffset: seconds added to every timestamp
+    char name[256];          // if_name, empty when absent
+} pcapng_interface_t;
+
+typedef enum {
+    FORMAT_PCAP,             // classic pcap, including the modified variant
+    FORMAT_PCAPNG,
+    FORMAT_SNOOP,
+    FORMAT_ERF
+} capture_format_t;
+
+struct pcap_source {
+    capture_file_t *file;    // the capture, or the current archive member
+    capture_archive_t *archive;  // archive whose matching members are read in turn, NULL otherwise
+    inflate_stream_t *inflate;  // decoder of a gzip-compressed capture, NULL otherwise
+    zstd_stream_t *zstd;     // decoder of a zstd-compressed capture, NULL otherwise
+    uint64_t offset;         // bytes consumed from the (uncompressed) capture
+    uint64_t region_end;     // record offset where a region read stops
+    capture_index_t *index;     // checkpoints loaded from the sidecar or seek table
+    capture_index_t *building;  // checkpoints collected by a first full scan
+    char *path;              // capture path, for saving the sidecar
+    pcap_file_header_t file_header;
+    capture_format_t format;
+    int needs_swap;          // Whether we need to swap byte order
+    int is_nanosecond;       // Whether timestamps are in nanoseconds
+    int is_stdin;            // Whether we're reading from stdin
+    uint32_t link_type;      // link type of the file header or first interface
+    uint32_t record_extra;   // bytes after the classic record header (modified pcap)
+    uint32_t snoop_drops;    // cumulative drop count of the previous snoop record
+    uint8_t erf_header[ERF_HEADER_LEN];  // first ERF record header, read while detecting the format
+    int has_erf_header;
+    uint8_t *packet_buffer;  // Reusable buffer for packet data (whole blocks for pcapng)
+    size_t buffer_size;      // Current buffer size
+
+    // pcapng interfaces of the current section
+    pcapng_interface_t *interfaces;
+    uint32_t interface_count;
+    uint32_t interface_capacity;
+};
+
+// Swap byte order for 32-bit values
+static uint32_t swap32(uint32_t value) {
+    return ((value & 0xFF000000) >> 24) |
+           ((value & 0x00FF0000) >> 8) |
+           ((value & 0x0000FF00) << 8) |
+           ((value & 0x000000FF) << 24);
+}
+
+static uint16_t swap16(uint16_t value) {
+    return (uint16_t)((value >> 8) | (value << 8));
+}
+
+int PcapSourceIsStdin(const char *filename) {
+    return strcmp(filename, "/dev/stdin") == 0 || strcmp(filename, "-") == 0;
+}
+
+void PcapSourceClose(pcap_source_t *source) {
+    if (!source) {
+        return;
+    }
+    CaptureIndexFree(source->building);
+    CaptureIndexFree(source->index);
+    if (source->inflate) {
+        InflateClose(source->inflate);
+    }
+    ZstdClose(source->zstd);
+    CaptureFileClose(source->file);
+    CaptureArchiveClose(source->archive);
+    duckdb_free(source->path);
+    if (source->packet_buffer) {
+        duckdb_free(source->packet_buffer);
+    }
+    if (source->interfaces) {
+        duckdb_free(source->interfaces);
+    }
+    duckdb_free(source);
+}
+
+// Read from the capture, decompressing gzip and zstd transparently
+static size_t SourceRead(pcap_source_t *source, void *buffer, size_t len) {
+    size_t read = source->inflate ? InflateRead(source->inflate, (uint8_t *)buffer, len)
+                  : source->zstd  ? ZstdRead(source->zstd, (uint8_t *)buffer, len)
+                                  : CaptureFileRead(source->file, buffer, len);
+    source->offset += read;
+    return read;
+}
+
+static int ReserveBuffer(pcap_source_t *source, size_t size) {
+    if (size <= source->buffer_size) {
+        return 1;
+    }
+    uint8_t *new_buffer = (uint8_t *)duckdb_malloc(size);
+    if (!new_buffer) {
+        return 0;
+    }
+    duckdb_free(source->packet_buffer);
+    source->packet_buffer = new_buffer;
+    source->buffer_size = size;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// pcapng
+// ---------------------------------------------------------------------------
+
+// Field readers in the byte order of the current section
+static uint16_t Block16(const pcap_source_t *source, const uint8_t *p) {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return source->needs_swap ? swap16(value) : value;
+}
+
+static uint32_t Block32(const pcap_source_t *source, const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return source->needs_swap ? swap32(value) : value;
+}
+
+// 64-bit option values are stored as a single integer in section byte order
+static uint64_t Block64(const pcap_source_t *source, const uint8_t *p) {
+    uint32_t first = Block32(source, p);
+    uint32_t second = Block32(source, p + 4);
+    return source->needs_swap ? ((uint64_t)first << 32) | second : ((uint64_t)second << 32) | first;
+}
+
+// Block timestamps are a 64-bit count split into high and low words
+static uint64_t BlockTimestamp(const pcap_source_t *source, const uint8_t *p) {
+    return ((uint64_t)Block32(source, p) << 32) | Block32(source, p + 4);
+}
+
+static const uint64_t powers_of_ten[] = {1ULL,
+                                         10ULL,
+                                         100ULL,
+                                         1000ULL,
+                                         10000ULL,
+                                         100000ULL,
+                                         1000000ULL,
+                                         10000000ULL,
+                                         100000000ULL,
+                                         1000000000ULL,
+                                         10000000000ULL,
+                                         100000000000ULL,
+                                         1000000000000ULL,
+                                         10000000000000ULL,
+                                         100000000000000ULL,
+                                         1000000000000000ULL,
+                                         10000000000000000ULL,
+                                         100000000000000000ULL,
+                                         1000000000000000000ULL,
+                                         10000000000000000000ULL};
+
+// Convert a timestamp in the interface's units to nanoseconds
+static uint64_t InterfaceNanoseconds(const pcapng_interface_t *iface, uint64_t units) {
+    uint64_t ns;
+    if (iface->tsresol & 0x80) {
+        uint32_t shift = iface->tsresol & 0x7F;
+        uint64_t seconds = shift < 64 ? units >> shift : 0;
+        uint64_t fraction = shift < 64 ? units & ((1ULL << shift) - 1) : units;
+        // Sub-nanosecond bits are dropped first so fraction * 10^9 fits
+        if (shift > 34) {
+            fraction = shift - 34 < 64 ? fraction >> (shift - 34) : 0;
+            shift = 34;
+        }
+        ns = seconds * 1000000000ULL + ((fraction * 1000000000ULL) >> shift);
+    } else if (iface->tsresol <= 9) {
+        ns = units * powers_of_ten[9 - iface->tsresol];
+    } else if (iface->tsresol <= 28) {
+        ns = units / powers_of_ten[iface->tsresol - 9];
+    } else {
+        ns = 0;
+    }
+    return ns + (uint64_t)iface->tsoffset * 1000000000ULL;
+}
+
+// Walk the options starting at offset: calls visit for each one until the
+// end-of-options marker or the end of the body
+typedef void (*option_visitor_t)(pcap_source_t *source, uint16_t code, const uint8_t *value, uint16_t len,
+                                 void *out);
+
+static void VisitOptions(pcap_source_t *source, const uint8_t *body, size_t body_len, size_t offset,
+                         option_visitor_t visit, void *out) {
+    while (offset + 4 <= body_len) {
+        uint16_t code = Block16(source, body + offset);
+        uint16_t len = Block16(source, body + offset + 2);
+        offset += 4;
+        if (code == 0 || offset + len > body_len) {
+            return;
+        }
+        visit(source, code, body + offset, len, out);
+        offset += ((size_t)len + 3) & ~(size_t)3;
+    }
+}
+
+static void InterfaceOption(pcap_source_t *source, uint16_t code, const uint8_t *value, uint16_t len, void *out) {
+    pcapng_interface_t *iface = (pcapng_interface_t *)out;
+    if (code == 2) {
+        size_t name_len = len < sizeof(iface->name) - 1 ? len : sizeof(iface->name) - 1;
+        memcpy(iface->name, value, name_len);
+        iface->name[name_len] = '\0';
+    } else if (code == 9 && len >= 1) {
+        iface->tsresol = value[0];
+    } else if (code == 14 && len >= 8) {
+        iface->tsoffset = (int64_t)Block64(source, value);
+    }
+}
+
+static void PacketOption(pcap_source_t *source, uint16_t code, const uint8_t *value, uint16_t len, void *out) {
+    pcap_packet_t *packet = (pcap_packet_t *)out;
+    if (code == 2 && len >= 4) {
+        packet->flags = Block32(source, value);
+        packet->present |= PCAP_PACKET_HAS_FLAGS;
+    } else if (code == 4 && len >= 8) {
+        packet->drop_count = Block64(source, value);
+        packet->present |= PCAP_PACKET_HAS_DROP_COUNT;
+    }
+}
+
+static void StatsOption(pcap_source_t *source, uint16_t code, const uint8_t *value, uint16_t len, void *out) {
+    pcap_interface_stats_t *stats = (pcap_interface_stats_t *)out;
+    if (len < 8) {
+        return;
+    }
+    switch (code) {
+    case 2:
+    case 3: {
+        const pcapng_interface_t *iface = &source->interfaces[stats->interface_id];
+        uint64_t ns = InterfaceNanoseconds(iface, BlockTimestamp(source, value));
+        if (code == 2) {
+            stats->start_ns = ns;
+            stats->present |= PCAP_STATS_START;
+        } else {
+            stats->end_ns = ns;
+            stats->present |= PCAP_STATS_END;
+        }
+        break;
+    }
+    case 4:
+        stats->received = Block64(source, value);
+        stats->present |= PCAP_STATS_RECEIVED;
+        break;
+    case 5:
+        stats->dropped = Block64(source, value);
+        stats->present |= PCAP_STATS_DROPPED;
+        break;
+    case 6:
+        stats->filter_accepted = Block64(source, value);
+        stats->present |= PCAP_STATS_FILTER_ACCEPTED;
+        break;
+    case 7:
+        stats->os_dropped = Block64(source, value);
+        stats->present |= PCAP_STATS_OS_DROPPED;
+        break;
+    case 8:
+        stats->delivered = Block64(source, value);
+        stats->present |= PCAP_STATS_DELIVERED;
+        break;
+    default:
+        break;
+    }
+}
+
+static int IsPacketBlock(uint32_t type) {
+    return type == PCAPNG_BLOCK_EPB || type == PCAPNG_BLOCK_SPB || type == PCAPNG_BLOCK_PB;
+}
+
+static int SkipBytes(pcap_source_t *source, size_t len) {
+    if (source->inflate || source->zstd) {
+        size_t skipped = source->inflate ? InflateRead(source->inflate, NULL, len) : ZstdRead(source->zstd, NULL, len);
+        source->offset += skipped;
+        return skipped == len;
+    }
+    uint64_t start = source->file->position;
+    int ok = CaptureFileSkip(source->file, len);
+    source->offset += source->file->position - start;
+    return ok;
+}
+
+// Read the next block into the packet buffer; *body_len excludes the type,
+// length and trailing length fields. The type of a section header may
+// already have been consumed as the file magic. With skip_packets, packet
+// blocks are passed over with *body_len set to 0. Returns 0 at end of file
+// or on a malformed block.
+static int ReadBlock(pcap_source_t *source, int have_type, uint32_t *type, size_t *body_len, int skip_packets) {
+    uint8_t header[8];
+    if (have_type) {
+        memcpy(header, type, 4);
+        if (SourceRead(source, header + 4, 4) != 4) {
+            return 0;
+        }
+    } else if (SourceRead(source, header, 8) != 8) {
+        return 0;
+    }
+    uint32_t raw_type;
+    memcpy(&raw_type, header, 4);
+    uint8_t byte_order[4];
+    if (raw_type == PCAPNG_BLOCK_SHB) {
+        // The byte order magic follows the length and decides how to read it
+        uint32_t magic;
+        if (SourceRead(source, byte_order, 4) != 4) {
+            return 0;
+        }
+        memcpy(&magic, byte_order, 4);
+        if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+            source->needs_swap = 0;
+        } else if (magic == swap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+            source->needs_swap = 1;
+        } else {
+            return 0;
+        }
+    }
+    *type = Block32(source, header);
+    uint32_t total_len = Block32(source, header + 4);
+    if (total_len < 12 || total_len % 4 || total_len > PCAPNG_MAX_BLOCK_SIZE ||
+        (*type == PCAPNG_BLOCK_SHB && total_len < 28)) {
+        return 0;
+    }
+    size_t len = total_len - 12;
+    if (skip_packets && IsPacketBlock(*type)) {
+        *body_len = 0;
+        return SkipBytes(source, len + 4);
+    }
+    if (!ReserveBuffer(source, len + 4)) {
+        return 0;
+    }
+    size_t have = 0;
+    if (*type == PCAPNG_BLOCK_SHB) {
+        memcpy(source->packet_buffer, byte_order, 4);
+        have = 4;
+    }
+    if (SourceRead(source, source->packet_buffer + have, len + 4 - have) != len + 4 - have) {
+        return 0;
+    }
+    *body_len = len;
+    return 1;
+}
+
+// Section headers and interface descriptions update the source's state;
+// returns 0 for an unsupported section
+static int HandleControlBlock(pcap_source_t *source, uint32_t type, size_t body_len) {
+    const uint8_t *body = source->packet_buffer;
+    if (type == PCAPNG_BLOCK_SHB) {
+        if (Block16(source, body + 4) != 1) {
+            return 0;
+        }
+        // Interface ids restart in every section
+        source->interface_count = 0;
+        return 1;
+    }
+    if (type != PCAPNG_BLOCK_IDB || body_len < 8) {
+        return 1;
+    }
+    if (source->interface_count == source->interface_capacity) {
+        uint32_t capacity = source->interface_capacity ? source->interface_capacity * 2 : 4;
+        pcapng_interface_t *grown = (pcapng_interface_t *)duckdb_malloc(capacity * sizeof(pcapng_interface_t));
+        if (!grown) {
+            return 0;
+        }
+        if (source->interfaces) {
+            memcpy(grown, source->interfaces, source->interface_count * sizeof(pcapng_interface_t));
+            duckdb_free(source->interfaces);
+        }
+        source->interfaces = grown;
+        source->interface_capacity = capacity;
+    }
+    pcapng_interface_t *iface = &source->interfaces[source->interface_count++];
+    memset(iface, 0, sizeof(pcapng_interface_t));
+    iface->link_type = Block16(source, body);
+    iface->snaplen = Block32(source, body + 4);
+    iface->tsresol = 6;
+    VisitOptions(source, body, body_len, 8, InterfaceOption, iface);
+    return 1;
+}
+
+// Fill packet from an EPB, SPB or obsolete PB in the packet buffer. Returns 0
+// for packets that cannot be used (unknown interface, bad lengths).
+static int ParsePacketBlock(pcap_source_t *source, uint32_t type, size_t body_len, pcap_packet_t *packet) {
+    const uint8_t *body = source->packet_buffer;
+    packet->flags = 0;
+    packet->present = 0;
+    packet->drop_count = 0;
+
+    uint32_t interface_id;
+    uint64_t units = 0;
+    size_t data_offset;
+    if (type == PCAPNG_BLOCK_SPB) {
+        if (body_len < 4 || !source->interface_count) {
+            return 0;
+        }
+        interface_id = 0;
+        packet->original_len = Block32(source, body);
+        size_t room = body_len - 4;
+        uint32_t snaplen = source->interfaces[0].snaplen;
+        uint32_t capture_len = packet->original_len;
+        if (snaplen && capture_len > snaplen) {
+            capture_len = snaplen;
+        }
+        packet->capture_len = capture_len < room ? capture_len : (uint32_t)room;
+        data_offset = 4;
+    } else {
+        if (body_len < 20) {
+            return 0;
+        }
+        if (type == PCAPNG_BLOCK_EPB) {
+            interface_id = Block32(source, body);
+        } else {
+            interface_id = Block16(source, body);
+            packet->drop_count = Block16(source, body + 2);
+            packet->present |= PCAP_PACKET_HAS_DROP_COUNT;
+        }
+        units = BlockTimestamp(source, body + 4);
+        packet->capture_len = Block32(source, body + 12);
+        packet->original_len = Block32(source, body + 16);
+        data_offset = 20;
+        if (packet->capture_len > body_len - data_offset) {
+            return 0;
+        }
+    }
+    if (interface_id >= source->interface_count) {
+        return 0;
+    }
+    const pcapng_interface_t *iface = &source->interfaces[interface_id];
+    packet->interface_id = interface_id;
+    packet->link_type = iface->link_type;
+    // Simple packet blocks carry no timestamp
+    packet->timestamp_ns = type == PCAPNG_BLOCK_SPB ? 0 : InterfaceNanoseconds(iface, units);
+    packet->data = body + data_offset;
+    if (type != PCAPNG_BLOCK_SPB) {
+        size_t options = data_offset + (((size_t)packet->capture_len + 3) & ~(size_t)3);
+        VisitOptions(source, body, body_len, options, PacketOption, packet);
+    }
+    return 1;
+}
+
+static int PcapngNext(pcap_source_t *source, pcap_packet_t *packet) {
+    uint32_t type;
+    size_t body_len;
+    while (ReadBlock(source, 0, &type, &body_len, 0)) {
+        if (IsPacketBlock(type)) {
+            if (ParsePacketBlock(source, type, body_len, packet)) {
+                return 1;
+            }
+        } else if (!HandleControlBlock(source, type, body_len)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int NextStats(pcap_source_t *source, pcap_interface_stats_t *stats) {
+    if (source->format != FORMAT_PCAPNG) {
+        return 0;
+    }
+    uint32_t type;
+    size_t body_len;
+    while (ReadBlock(source, 0, &type, &body_len, 1)) {
+        if (type != PCAPNG_BLOCK_ISB) {
+            if (!HandleControlBlock(source, type, body_len)) {
+                return 0;
+            }
+            continue;
+        }
+        const uint8_t *body = source->packet_buffer;
+        if (body_len < 12) {
+            continue;
+        }
+        memset(stats, 0, sizeof(pcap_interface_stats_t));
+        stats->interface_id = Block32(source, body);
+        if (stats->interface_id >= source->interface_count) {
+            continue;
+        }
+        const pcapng_interface_t *iface = &source->interfaces[stats->interface_id];
+        stats->link_type = iface->link_type;
+        stats->interface_name = iface->name[0] ? iface->name : NULL;
+        stats->timestamp_ns = InterfaceNanoseconds(iface, BlockTimestamp(source, body + 4));
+        VisitOptions(source, body, body_len, 12, StatsOption, stats);
+        return 1;
+    }
+    return 0;
+}
+
+// Parse the section header whose type was read as the file magic, then the
+// blocks up to the first interface description, which gives the link type
+static const char *PcapngOpen(pcap_source_t *source, uint32_t magic) {
+    source->format = FORMAT_PCAPNG;
+    uint32_t type = magic;
+    size_t body_len;
+    if (!ReadBlock(source, 1, &type, &body_len, 0) || !HandleControlBlock(source, type, body_len)) {
+        return "Invalid pcapng section header";
+    }
+    while (!source->interface_count) {
+        if (!ReadBlock(source, 0, &type, &body_len, 0)) {
+            return "pcapng file has no interface description";
+        }
+        if (IsPacketBlock(type) || !HandleControlBlock(source, type, body_len)) {
+            return "pcapng packet before interface description";
+        }
+    }
+    source->link_type = source->interfaces[0].link_type;
+    uint8_t tsresol = source->interfaces[0].tsresol;
+    source->is_nanosecond = (tsresol & 0x80) ? (tsresol & 0x7F) >= 30 : tsresol >= 9;
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// snoop
+// ---------------------------------------------------------------------------
+
+static uint16_t ReadBE16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t ReadBE32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// The first four bytes of the identification pattern were read as the magic
+static const char *SnoopOpen(pcap_source_t *source) {
+    uint8_t header[12];
+    if (SourceRead(source, header, sizeof(header)) != sizeof(header)) {
+        return "Failed to read pcap file header";
+    }
+    if (memcmp(header, SNOOP_MAGIC + 4, 4) != 0 || ReadBE32(header + 4) != SNOOP_VERSION) {
+        return "Invalid snoop file header";
+    }
+    uint32_t datalink = ReadBE32(header + 8);
+    if (datalink != SNOOP_DATALINK_ETHERNET && datalink != SNOOP_DATALINK_8023) {
+        return "Unsupported snoop datalink type";
+    }
+    source->format = FORMAT_SNOOP;
+    source->link_type = LINKTYPE_ETHERNET;
+    return NULL;
+}
+
+static int SnoopNext(pcap_source_t *source, pcap_packet_t *packet) {
+    uint8_t header[SNOOP_RECORD_HEADER_LEN];
+    if (SourceRead(source, header, sizeof(header)) != sizeof(header)) {
+        return 0;
+    }
+    uint32_t original_len = ReadBE32(header);
+    uint32_t included_len = ReadBE32(header + 4);
+    uint32_t record_len = ReadBE32(header + 8);
+    uint32_t drops = ReadBE32(header + 12);
+    // Records are padded to four bytes; the padding is read with the data
+    if (record_len < SNOOP_RECORD_HEADER_LEN + (uint64_t)included_len || record_len > PCAPNG_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+    size_t len = record_len - SNOOP_RECORD_HEADER_LEN;
+    if (!ReserveBuffer(source, len ? len : 1) || SourceRead(source, source->packet_buffer, len) != len) {
+        return 0;
+    }
+    packet->timestamp_ns = (uint64_t)ReadBE32(header + 16) * 1000000000ULL + (uint64_t)ReadBE32(header + 20) * 1000ULL;
+    packet->original_len = original_len;
+    packet->capture_len = included_len;
+    packet->interface_id = 0;
+    packet->link_type = source->link_type;
+    packet->flags = 0;
+    // The file keeps a running total; packets report the loss since the previous one
+    packet->drop_count = drops >= source->snoop_drops ? drops - source->snoop_drops : drops;
+    packet->present = PCAP_PACKET_HAS_DROP_COUNT;
+    source->snoop_drops = drops;
+    packet->data = source->packet_buffer;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// ERF
+// ---------------------------------------------------------------------------
+
+// Link type of the payload of an ERF record type, 0 for types that carry no
+// packets this reader understands (ATM cells, counters, padding, metadata)
+static uint32_t ErfLinkType(uint8_t type) {
+    switch (type & ERF_TYPE_MASK) {
+    case ERF_TYPE_ETH:
+    case ERF_TYPE_COLOR_ETH:
+    case ERF_TYPE_DSM_COLOR_ETH:
+    case ERF_TYPE_COLOR_HASH_ETH:
+        return LINKTYPE_ETHERNET;
+    case ERF_TYPE_HDLC_POS:
+    case ERF_TYPE_COLOR_HDLC_POS:
+    case ERF_TYPE_DSM_COLOR_HDLC_POS:
+    case ERF_TYPE_COLOR_HASH_POS:
+        return LINKTYPE_PPP_HDLC;
+    case ERF_TYPE_IPV4:
+        return LINKTYPE_IPV4;
+    case ERF_TYPE_IPV6:
+        return LINKTYPE_IPV6;
+    default:
+        return 0;
+    }
+}
+
+// Without a magic number, ERF is recognised by a plausible first record
+// header: a known type, no reserved flags and a length covering the header
+static int ErfHeaderValid(const uint8_t *header) {
+    uint8_t type = header[8] & ERF_TYPE_MASK;
+    uint16_t record_len = ReadBE16(header + 10);
+    return type != 0 && type <= ERF_TYPE_MAX && !(header[9] & ERF_FLAGS_RESERVED) && record_len >= ERF_HEADER_LEN;
+}
+
+// The first four bytes of the record header were read as the magic
+static const char *ErfOpen(pcap_source_t *source, uint32_t magic) {
+    memcpy(source->erf_header, &magic, 4);
+    if (SourceRead(source, source->erf_header + 4, ERF_HEADER_LEN - 4) != ERF_HEADER_LEN - 4 ||
+        !ErfHeaderValid(source->erf_header)) {
+        return "Invalid pcap file magic number";
+    }
+    source->format = FORMAT_ERF;
+    source->has_erf_header = 1;
+    source->is_nanosecond = 1;
+    uint32_t link_type = ErfLinkType(source->erf_header[8]);
+    source->link_type = link_type ? link_type : LINKTYPE_ETHERNET;
+    return NULL;
+}
+
+static int ErfNext(pcap_source_t *source, pcap_packet_t *packet) {
+    for (;;) {
+        uint8_t header[ERF_HEADER_LEN];
+        if (source->has_erf_header) {
+            memcpy(header, source->erf_header, ERF_HEADER_LEN);
+            source->has_erf_header = 0;
+        } else if (SourceRead(source, header, ERF_HEADER_LEN) != ERF_HEADER_LEN) {
+            return 0;
+        }
+        uint16_t record_len = ReadBE16(header + 10);
+        if (record_len < ERF_HEADER_LEN) {
+            return 0;
+        }
+        size_t len = record_len - ERF_HEADER_LEN;
+        if (!ReserveBuffer(source, len ? len : 1) || SourceRead(source, source->packet_buffer, len) != len) {
+            return 0;
+        }
+        uint8_t type = header[8];
+        uint32_t link_type = ErfLinkType(type);
+        if (!link_type) {
+            continue;
+        }
+        // Extension headers chain through the high bit of their first byte
+        size_t offset = 0;
+        int more = type & ERF_TYPE_EXTENSION;
+        while (more) {
+            if (offset + 8 > len) {
+                break;
+            }
+            more = source->packet_buffer[offset] & 0x80;
+            offset += 8;
+        }
+        if (link_type == LINKTYPE_ETHERNET) {
+            offset += 2;  // offset and pad bytes ahead of the frame
+        }
+        if (more || offset > len) {
+            continue;
+        }
+        // Fixed-point seconds: whole seconds in the high half, a binary
+        // fraction in the low half (rounded to the nearest nanosecond)
+        uint64_t timestamp = ((uint64_t)header[0]) | ((uint64_t)header[1] << 8) | ((uint64_t)header[2] << 16) |
+                             ((uint64_t)header[3] << 24) | ((uint64_t)header[4] << 32) |
+                             ((uint64_t)header[5] << 40) | ((uint64_t)header[6] << 48) | ((uint64_t)header[7] << 56);
+        packet->timestamp_ns = (timestamp >> 32) * 1000000000ULL +
+                               (((timestamp & 0xFFFFFFFFULL) * 1000000000ULL + 0x80000000ULL) >> 32);
+        uint16_t wire_len = ReadBE16(header + 14);
+        size_t room = len - offset;
+        // Records are padded, so the captured part ends at the wire length
+        packet->original_len = wire_len;
+        packet->capture_len = room < wire_len ? (uint32_t)room : wire_len;
+        packet->interface_id = header[9] & ERF_FLAGS_INTERFACE_MASK;
+        packet->link_type = link_type;
+        packet->flags = (header[9] & ERF_FLAGS_RX_ERROR) ? PCAP_FLAGS_CRC_ERROR : 0;
+        packet->present = PCAP_PACKET_HAS_FLAGS;
+        packet->drop_count = 0;
+        // The loss counter holds a color instead for the color types
+        uint8_t base = type & ERF_TYPE_MASK;
+        if (base == ERF_TYPE_ETH || base == ERF_TYPE_HDLC_POS) {
+            packet->drop_count = ReadBE16(header + 12);
+            packet->present |= PCAP_PACKET_HAS_DROP_COUNT;
+        }
+        packet->data = source->packet_buffer + offset;
+        return 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Opening and classic pcap
+// ---------------------------------------------------------------------------
+
+// Index a gzip-compressed classic pcap: load its sidecar, or collect
+// checkpoints while it is read and save them once the whole file was decoded
+static void AttachIndex(pcap_source_t *source, const char *filename) {
+    uint64_t size;
+    uint8_t trailer[GZIP_INDEX_TRAILER_LEN];
+    if (!GzipIndexFingerprint(source->file, &size, trailer)) {
+        return;
+    }
+    source->index = GzipIndexLoad(filename, size, trailer);
+    if (source->index) {
+        return;
+    }
+    size_t path_len = strlen(filename);
+    source->path = (char *)duckdb_malloc(path_len + 1);
+    if (!source->path) {
+        return;
+    }
+    memcpy(source->path, filename, path_len + 1);
+    source->building = GzipIndexCreate(size, trailer, source->offset);
+    if (source->building) {
+        InflateSetBlockCallback(source->inflate, GzipIndexBlock, source->building);
+    }
+}
+
+// At the end of the first full scan, keep the collected checkpoints and try
+// to save them (a read-only directory only costs the sidecar)
+static void FinishIndex(pcap_source_t *source) {
+    if (!source->building->failed && InflateFinished(source->inflate)) {
+        GzipIndexSave(source->building, source->path);
+        source->index = source->building;
+        source->building = NULL;
+    }
+}
+
+// Allocate a source with no capture open yet
+static pcap_source_t *NewSource(void) {
+    pcap_source_t *source = (pcap_source_t *)duckdb_malloc(sizeof(pcap_source_t));
+    if (source) {
+        memset(source, 0, sizeof(pcap_source_t));
+        source->region_end = UINT64_MAX;
+    }
+    return source;
+}
+
+// Detect the format of the capture in source->file and read its file header.
+// filename is the capture's own path, for its index. Returns a static error
+// message on failure.
+static const char *StartCapture(pcap_source_t *source, const char *filename, int use_index) {
+    // The magic number tells the formats apart; ERF, which has none, is
+    // tried last
+    uint32_t magic;
+    if (SourceRead(source, &magic, sizeof(magic)) != sizeof(magic)) {
+        return "Failed to read pcap file header";
+    }
+    uint8_t prefix[sizeof(magic)];
+    memcpy(prefix, &magic, sizeof(magic));
+    int is_gzip = prefix[0] == GZIP_MAGIC_0 && prefix[1] == GZIP_MAGIC_1;
+    int is_zstd = ((uint32_t)prefix[0] | (uint32_t)prefix[1] << 8 | (uint32_t)prefix[2] << 16 |
+                   (uint32_t)prefix[3] << 24) == ZSTD_MAGIC;
+    if (is_gzip || is_zstd) {
+        // Any of the formats may be gzip- or zstd-compressed
+        if (is_gzip) {
+            source->inflate = InflateOpen(source->file, prefix, sizeof(prefix));
+        } else {
+            source->zstd = ZstdOpen(source->file, prefix, sizeof(prefix));
+        }
+        source->offset = 0;
+        if (!source->inflate && !source->zstd) {
+            return "Failed to allocate memory for init state";
+        }
+        if (SourceRead(source, &magic, sizeof(magic)) != sizeof(magic)) {
+            return "Failed to read pcap file header";
+        }
+    }
+    const char *error = NULL;
+    switch (magic) {
+    case PCAP_MAGIC_NATIVE:
+    case PCAP_MAGIC_SWAPPED:
+    case PCAP_MAGIC_NANO_NATIVE:
+    case PCAP_MAGIC_NANO_SWAPPED:
+    case PCAP_MAGIC_MODIFIED_NATIVE:
+    case PCAP_MAGIC_MODIFIED_SWAPPED:
+        break;
+    case PCAPNG_BLOCK_SHB:
+        error = PcapngOpen(source, magic);
+        break;
+    default:
+        error = memcmp(&magic, SNOOP_MAGIC, 4) == 0 ? SnoopOpen(source) : ErfOpen(source, magic);
+        break;
+    }
+    if (error || source->format != FORMAT_PCAP) {
+        return error;
+    }
+
+    // Read the rest of the file header
+    source->file_header.magic_number = magic;
+    if (SourceRead(source, (uint8_t *)&source->file_header + sizeof(magic),
+                   sizeof(pcap_file_header_t) - sizeof(magic)) != sizeof(pcap_file_header_t) - sizeof(magic)) {
+        return "Failed to read pcap file header";
+    }
+
+    // Check magic number and determine if we need to swap bytes and timestamp precision
+    switch (source->file_header.magic_number) {
+    case PCAP_MAGIC_NATIVE:
+        break;
+    case PCAP_MAGIC_SWAPPED:
+        source->needs_swap = 1;
+        break;
+    case PCAP_MAGIC_NANO_NATIVE:
+        source->is_nanosecond = 1;
+        break;
+    case PCAP_MAGIC_NANO_SWAPPED:
+        source->needs_swap = 1;
+        source->is_nanosecond = 1;
+        break;
+    case PCAP_MAGIC_MODIFIED_NATIVE:
+        source->record_extra = PCAP_MODIFIED_EXTRA_LEN;
+        break;
+    case PCAP_MAGIC_MODIFIED_SWAPPED:
+        source->needs_swap = 1;
+        source->record_extra = PCAP_MODIFIED_EXTRA_LEN;
+        break;
+    default:
+        return "Invalid pcap file magic number";
+    }
+    if (source->needs_swap) {
+        // Swap the header fields we'll use
+        source->file_header.snaplen = swap32(source->file_header.snaplen);
+        source->file_header.network = swap32(source->file_header.network);
+    }
+    source->link_type = source->file_header.network;
+
+    // Pre-allocate packet buffer based on snaplen
+    if (!ReserveBuffer(source, source->file_header.snaplen ? source->file_header.snaplen : 1)) {
+        return "Failed to allocate packet buffer";
+    }
+    // Sidecars are kept next to local captures only
+    if (use_index && source->inflate && !source->is_stdin && !HttpFileIsUrl(filename)) {
+        AttachIndex(source, filename);
+    }
+    if (use_index && source->zstd && !source->is_stdin) {
+        source->index = ZstdSeekableLoad(source->file, source->offset);
+    }
+    return NULL;
+}
+
+// Close the current archive member and forget what its capture set up
+static void EndCapture(pcap_source_t *source) {
+    if (source->inflate) {
+        InflateClose(source->inflate);
+        source->inflate = NULL;
+    }
+    ZstdClose(source->zstd);
+    source->zstd = NULL;
+    CaptureFileClose(source->file);
+    source->file = NULL;
+    source->offset = 0;
+    memset(&source->file_header, 0, sizeof(source->file_header));
+    source->format = FORMAT_PCAP;
+    source->needs_swap = 0;
+    source->is_nanosecond = 0;
+    source->link_type = 0;
+    source->record_extra = 0;
+    source->snoop_drops = 0;
+    source->has_erf_header = 0;
+    source->interface_count = 0;
+}
+
+// Move on to the next archive member that holds a capture; members in no
+// format this reader knows are passed over
+static const char *NextMember(pcap_source_t *source) {
+    const char *error = "No archive member matches the path";
+    for (;;) {
+        EndCapture(source);
+        source->file = CaptureArchiveNext(source->archive);
+        if (!source->file) {
+            return error;
+        }
+        error = StartCapture(source, NULL, 0);
+        if (!error) {
+            return NULL;
+        }
+    }
+}
+
+static const char *OpenSource(const char *filename, int use_index, capture_cache_t cache, pcap_source_t **out) {
+    *out = NULL;
+    pcap_source_t *source = NewSource();
+    if (!source) {
+        return "Failed to allocate memory for init state";
+    }
+    source->is_stdin = PcapSourceIsStdin(filename);
+
+    // Archive members are read one after another, and never indexed
+    char *archive_path = NULL;
+    char *pattern = NULL;
+    int in_archive = source->is_stdin ? 0 : CaptureArchiveSplitPath(filename, &archive_path, &pattern);
+    const char *error;
+    if (in_archive < 0) {
+        error = "Failed to allocate memory for init state";
+    } else if (in_archive) {
+        error = CaptureArchiveOpen(archive_path, pattern, cache, &source->archive);
+        duckdb_free(archive_path);
+        duckdb_free(pattern);
+        if (!error) {
+            error = NextMember(source);
+        }
+    } else {
+        source->file = source->is_stdin ? CaptureFileStdin() : CaptureFileOpen(filename, cache);
+        error = source->file ? StartCapture(source, filename, use_index) : "Failed to open pcap file";
+    }
+    if (error) {
+        PcapSourceClose(source);
+        return error;
+    }
+    *out = source;
+    return NULL;
+}
+
+const char *PcapSourceOpen(const char *filename, pcap_source_t **out) {
+    return OpenSource(filename, 1, CAPTURE_CACHE_NORMAL, out);
+}
+
+const char *PcapSourceOpenWithCache(const char *filename, capture_cache_t cache, pcap_source_t **out) {
+    return OpenSource(filename, 1, cache, out);
+}
+
+const char *PcapSourceOpenRegion(const char *filename, const capture_index_t *index, uint32_t region,
+                                 capture_cache_t cache, pcap_source_t **out) {
+    pcap_source_t *source;
+    const char *error = OpenSource(filename, 0, cache, &source);
+    if (error) {
+        *out = NULL;
+        return error;
+    }
+    // The first region starts right after the file header; later ones resume
+    // decoding at their checkpoint and skip to its first record
+    const capture_checkpoint_t *checkpoint = &index->checkpoints[region];
+    int ok = (source->inflate || source->zstd) && source->format == FORMAT_PCAP;
+    if (ok && region) {
+        ok = source->inflate ? InflateSeek(source->inflate, checkpoint->in_bits, checkpoint->out_offset,
+                                           checkpoint->window, checkpoint->window_len)
+                             : ZstdSeek(source->zstd, checkpoint->in_bits / 8);
+        source->offset = checkpoint->out_offset;
+        ok = ok && SkipBytes(source, (size_t)(checkpoint->record_offset - checkpoint->out_offset));
+    }
+    if (!ok) {
+        PcapSourceClose(source);
+        *out = NULL;
+        return "Failed to seek to capture index checkpoint";
+    }
+    source->region_end = CaptureIndexRegionEnd(index, region);
+    *out = source;
+    return NULL;
+}
+
+const char *PcapSourceOpenMember(const capture_archive_t *archive, uint32_t member, pcap_source_t **out) {
+    *out = NULL;
+    pcap_source_t *source = NewSource();
+    if (!source) {
+        return "Failed to allocate memory for init state";
+    }
+    source->file = CaptureArchiveOpenMember(archive, member);
+    const char *error = source->file ? StartCapture(source, NULL, 0) : "Failed to open archive member";
+    if (error) {
+        PcapSourceClose(source);
+        return error;
+    }
+    *out = source;
+    return NULL;
+}
+
+const capture_index_t *PcapSourceIndex(const pcap_source_t *source) {
+    return source->index;
+}
+
+const capture_archive_t *PcapSourceArchive(const pcap_source_t *source) {
+    return source->archive && CaptureArchiveMemberCount(source->archive) ? source->archive : NULL;
+}
+
+static int NextPacket(pcap_source_t *source, pcap_packet_t *packet) {
+    switch (source->format) {
+    case FORMAT_PCAPNG:
+        return PcapngNext(source, packet);
+    case FORMAT_SNOOP:
+        return SnoopNext(source, packet);
+    case FORMAT_ERF:
+        return ErfNext(source, packet);
+    default:
+        break;
+    }
+
+    pcap_packet_header_t packet_header;
+    uint64_t record_offset = source->offset;
+    if (record_offset >= source->region_end) {
+        return 0;
+    }
+
+    // Read packet header
+    size_t header_len = SourceRead(source, &packet_header, sizeof(pcap_packet_header_t));
+    if (header_len != sizeof(pcap_packet_header_t)) {
+        if (!header_len && source->building) {
+            FinishIndex(source);
+        }
+        return 0;
+    }
+    uint8_t extra[PCAP_MODIFIED_EXTRA_LEN];
+    if (source->record_extra && SourceRead(source, extra, source->record_extra) != source->record_extra) {
+        return 0;
+    }
+
+    // Swap bytes if needed
+    if (source->needs_swap) {
+        packet_header.ts_sec = swap32(packet_header.ts_sec);
+        packet_header.ts_usec = swap32(packet_header.ts_usec);
+        packet_header.caplen = swap32(packet_header.caplen);
+        packet_header.len = swap32(packet_header.len);
+    }
+
+    // Reallocate buffer if packet is larger than current buffer
+    if (!ReserveBuffer(source, packet_header.caplen)) {
+        return 0;
+    }
+
+    // Read packet data into reusable buffer
+    if (SourceRead(source, source->packet_buffer, packet_header.caplen) != packet_header.caplen) {
+        return 0;
+    }
+
+    // Convert timestamp to nanoseconds
+    if (source->is_nanosecond) {
+        // ts_usec field contains nanoseconds in nanosecond-precision files
+        packet->timestamp_ns = ((uint64_t)packet_header.ts_sec * 1000000000ULL) +
+                               (uint64_t)packet_header.ts_usec;
+    } else {
+        // ts_usec field contains microseconds in microsecond-precision files
+        packet->timestamp_ns = ((uint64_t)packet_header.ts_sec * 1000000000ULL) +
+                               ((uint64_t)packet_header.ts_usec * 1000ULL);
+    }
+    packet->original_len = packet_header.len;
+    packet->capture_len = packet_header.caplen;
+    packet->interface_id = 0;
+    packet->link_type = source->link_type;
+    packet->flags = 0;
+    packet->present = 0;
+    packet->drop_count = 0;
+    if (source->record_extra) {
+        // Modified pcap records name the interface index and the kernel's
+        // packet type, of which PACKET_OUTGOING (4) marks sent packets
+        uint32_t ifindex;
+        memcpy(&ifindex, extra, sizeof(ifindex));
+        packet->interface_id = source->needs_swap ? swap32(ifindex) : ifindex;
+        packet->flags = extra[6] == 4 ? PCAP_FLAGS_OUTBOUND : PCAP_FLAGS_INBOUND;
+        packet->present = PCAP_PACKET_HAS_FLAGS;
+    }
+    packet->data = source->packet_buffer;
+    if (source->building) {
+        GzipIndexAddRecord(source->building, record_offset, packet->timestamp_ns);
+    }
+    return 1;
+}
+
+int PcapSourceNext(pcap_source_t *source, pcap_packet_t *packet) {
+    // The file is closed once the last archive member has been read
+    while (source->file && !NextPacket(source, packet)) {
+        if (!source->archive || NextMember(source)) {
+            return 0;
+        }
+    }
+    return source->file != NULL;
+}
+
+int PcapSourceNextStats(pcap_source_t *source, pcap_interface_stats_t *stats) {
+    // The file is closed once the last archive member has been read
+    while (source->file && !NextStats(source, stats)) {
+        if (!source->archive || NextMember(source)) {
+            return 0;
+        }
+    }
+    return source->file != NULL;
+}
+
+uint32_t PcapSourceLinkType(const pcap_source_t *source) {
+    return source->link_type;
+}
+
+int PcapSourceIsNanosecond(const pcap_source_t *source) {
+    return source->is_nanosecond;
+}
@@ -0,0 +1,388 @@
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "packet_decode.h"
+#include "partitioned_writer.h"
+#include "pcap_reader.h"
+#include "pcapng_writer.h"
+#include "sync.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// ---------------------------------------------------------------------------
+// Output files
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char *name;              // NULL for the unnamed interface
+    size_t name_len;
+    uint32_t link_type;
+} output_interface_t;
+
+// A pcapng file being written (partitioned_writer.h). Interface ids are
+// handed out here so all states agree on them, and each IDB is written
+// before any packet referencing it can be.
+typedef struct {
+    partitioned_output_t base;
+    output_interface_t *interfaces;
+    uint32_t interface_count;
+    uint32_t interface_capacity;
+} pcapng_output_t;
+
+// Guards the interfaces of every output; taken before the registry lock
+static pcap_mutex_t interfaces_lock = PCAP_MUTEX_INITIALIZER;
+
+static size_t Pad4(size_t len) {
+    return (len + 3) & ~(size_t)3;
+}
+
+static void Put16(uint8_t *p, uint16_t value) {
+    memcpy(p, &value, sizeof(value));
+}
+
+static void Put32(uint8_t *p, uint32_t value) {
+    memcpy(p, &value, sizeof(value));
+}
+
+static void Put64(uint8_t *p, uint64_t value) {
+    memcpy(p, &value, sizeof(value));
+}
+
+// Append an option (code, length, value, padding) at p; returns its size
+static size_t PutOption(uint8_t *p, uint16_t code, const void *value, size_t len) {
+    Put16(p, code);
+    Put16(p + 2, (uint16_t)len);
+    memcpy(p + 4, value, len);
+    memset(p + 4 + len, 0, Pad4(len) - len);
+    return 4 + Pad4(len);
+}
+
+// Blocks are written in host byte order; readers take it from the SHB
+static int StartFile(partitioned_writer_t *writer, partitioned_output_t *output, const void *arg) {
+    (void)writer;
+    (void)arg;
+    uint8_t block[28];
+    Put32(block, PCAPNG_BLOCK_SHB);
+    Put32(block + 4, sizeof(block));
+    Put32(block + 8, PCAPNG_BYTE_ORDER_MAGIC);
+    Put16(block + 12, 1);
+    Put16(block + 14, 0);
+    Put64(block + 16, UINT64_MAX);  // section length not given
+    Put32(block + 24, sizeof(block));
+    return fwrite(block, sizeof(block), 1, output->file) == 1;
+}
+
+// IDB with if_name (when named) and nanosecond if_tsresol
+static int WriteInterface(partitioned_output_t *output, const output_interface_t *iface) {
+    uint8_t block[20 + 4 + 256 + 8 + 4];
+    size_t name_len = iface->name_len < 255 ? iface->name_len : 255;
+    size_t len = 16;
+    Put32(block, PCAPNG_BLOCK_IDB);
+    Put16(block + 8, (uint16_t)iface->link_type);
+    Put16(block + 10, 0);
+    Put32(block + 12, 0);  // no snaplen limit
+    if (iface->name) {
+        len += PutOption(block + len, 2, iface->name, name_len);
+    }
+    uint8_t tsresol = 9;
+    len += PutOption(block + len, 9, &tsresol, 1);
+    Put32(block + len, 0);  // opt_endofopt
+    len += 4;
+    Put32(block + len, (uint32_t)len + 4);
+    len += 4;
+    Put32(block + 4, (uint32_t)len);
+    return PartitionedOutputWrite(output, block, len);
+}
+
+static void FreeOutput(partitioned_output_t *base) {
+    pcapng_output_t *output = (pcapng_output_t *)base;
+    for (uint32_t i = 0; i < output->interface_count; i++) {
+        duckdb_free(output->interfaces[i].name);
+    }
+    duckdb_free(output->interfaces);
+}
+
+// Id of the interface with this name and link type, writing its IDB the
+// first time. Returns UINT32_MAX on failure.
+static uint32_t OutputInterface(pcapng_output_t *output, const char *name, size_t name_len, uint32_t link_type) {
+    PcapMutexLock(&interfaces_lock);
+    uint32_t id = 0;
+    for (; id < output->interface_count; id++) {
+        const output_interface_t *iface = &output->interfaces[id];
+        if (iface->link_type == link_type && (name ? iface->name && iface->name_len == name_len &&
+                                                         memcmp(iface->name, name, name_len) == 0
+                                                   : !iface->name)) {
+            break;
+        }
+    }
+    if (id == output->interface_count) {
+        if (output->interface_count == output->interface_capacity) {
+            uint32_t capacity = output->interface_capacity ? output->interface_capacity * 2 : 4;
+            output_interface_t *grown = (output_interface_t *)duckdb_malloc(capacity * sizeof(output_interface_t));
+            if (!grown) {
+                PcapMutexUnlock(&interfaces_lock);
+                return UINT32_MAX;
+            }
+            if (output->interfaces) {
+                memcpy(grown, output->interfaces, output->interface_count * sizeof(output_interface_t));
+                duckdb_free(output->interfaces);
+            }
+            output->interfaces = grown;
+            output->interface_capacity = capacity;
+        }
+        output_interface_t *iface = &output->interfaces[id];
+        memset(iface, 0, sizeof(output_interface_t));
+        iface->link_type = link_type;
+        if (name) {
+            iface->name = (char *)duckdb_malloc(name_len + 1);
+            if (!iface->name) {
+                PcapMutexUnlock(&interfaces_lock);
+                return UINT32_MAX;
+            }
+            memcpy(iface->name, name, name_len);
+            iface->name[name_len] = '\0';
+            iface->name_len = name_len;
+        }
+        if (!WriteInterface(&output->base, iface)) {
+            duckdb_free(iface->name);
+            PcapMutexUnlock(&interfaces_lock);
+            return UINT32_MAX;
+        }
+        output->interface_count++;
+    }
+    PcapMutexUnlock(&interfaces_lock);
+    return id;
+}
+
+// ---------------------------------------------------------------------------
+// Aggregate
+// ---------------------------------------------------------------------------
+
+// Packets of one aggregate state bound for one output file
+typedef struct {
+    partitioned_partition_t base;  // records are encoded EPBs
+    // Interface of the previous packet, which saves a shared lookup per packet
+    char *interface_name;
+    size_t interface_name_len;
+    uint32_t interface_link_type;
+    uint32_t interface_id;
+    int interface_cached;        // the interface_* fields are set
+} pcapng_partition_t;
+
+enum {
+    WRITE_ARG_PATH,
+    WRITE_ARG_TIMESTAMP,
+    WRITE_ARG_DATA,
+    WRITE_ARG_INTERFACE,
+    WRITE_ARG_COMMENT,
+    WRITE_ARG_LINK_TYPE,
+    WRITE_ARG_ORIGINAL_LEN,
+    WRITE_ARG_COUNT
+};
+
+// EPBs are written as they were encoded
+static const uint8_t *EncodeBlocks(partitioned_writer_t *writer, partitioned_partition_t *partition, size_t *len) {
+    (void)writer;
+    *len = partition->records.len;
+    return partition->records.data;
+}
+
+static void FreePartition(partitioned_partition_t *base) {
+    duckdb_free(((pcapng_partition_t *)base)->interface_name);
+}
+
+static const partitioned_writer_ops_t pcapng_ops = {
+    .writer_size = sizeof(partitioned_writer_t),
+    .output_size = sizeof(pcapng_output_t),
+    .partition_size = sizeof(pcapng_partition_t),
+    .flush_size = PCAPNG_WRITE_BUFFER_SIZE,
+    .buffer_budget = PCAPNG_PARTITION_BUFFER_BUDGET,
+    .open_error = "Failed to open pcapng output file",
+    .write_error = "Failed to write pcapng output file",
+    .start_file = StartFile,
+    .encode = EncodeBlocks,
+    .free_output = FreeOutput,
+    .free_partition = FreePartition,
+};
+
+static uint32_t PartitionInterface(pcapng_partition_t *partition, const char *name, size_t name_len,
+                                   uint32_t link_type) {
+    if (partition->interface_cached && partition->interface_link_type == link_type &&
+        (name ? partition->interface_name && partition->interface_name_len == name_len &&
+                    memcmp(partition->interface_name, name, name_len) == 0
+              : !partition->interface_name)) {
+        return partition->interface_id;
+    }
+    uint32_t id = OutputInterface((pcapng_output_t *)partition->base.output, name, name_len, link_type);
+    if (id == UINT32_MAX) {
+        return id;
+    }
+    duckdb_free(partition->interface_name);
+    partition->interface_name = NULL;
+    partition->interface_name_len = 0;
+    partition->interface_cached = 0;
+    if (name) {
+        partition->interface_name = (char *)duckdb_malloc(name_len ? name_len : 1);
+        if (!partition->interface_name) {
+            return id;
+        }
+        memcpy(partition->interface_name, name, name_len);
+        partition->interface_name_len = name_len;
+    }
+    partition->interface_link_type = link_type;
+    partition->interface_id = id;
+    partition->interface_cached = 1;
+    return id;
+}
+
+// Encode an Enhanced Packet Block, with an opt_comment when given
+static int AppendPacket(stream_buffer_t *blocks, uint32_t interface_id, uint64_t timestamp_ns, const uint8_t *data,
+                        size_t len, uint32_t original_len, const uint8_t *comment, size_t comment_len) {
+    if (comment_len > PCAPNG_MAX_COMMENT) {
+        comment_len = PCAPNG_MAX_COMMENT;
+    }
+    size_t options = comment ? 4 + Pad4(comment_len) + 4 : 0;
+    size_t total = 32 + Pad4(len) + options;
+    uint8_t header[28];
+    Put32(header, PCAPNG_BLOCK_EPB);
+    Put32(header + 4, (uint32_t)total);
+    Put32(header + 8, interface_id);
+    Put32(header + 12, (uint32_t)(timestamp_ns >> 32));
+    Put32(header + 16, (uint32_t)timestamp_ns);
+    Put32(header + 20, (uint32_t)len);
+    Put32(header + 24, original_len);
+    static const uint8_t zeros[8] = {0};
+    uint8_t trailer[4];
+    Put32(trailer, (uint32_t)total);
+    if (!StreamBufferAppend(blocks, header, sizeof(header), SIZE_MAX) ||
+        !StreamBufferAppend(blocks, data, len, SIZE_MAX) ||
+        !StreamBufferAppend(blocks, zeros, Pad4(len) - len, SIZE_MAX)) {
+        return 0;
+    }
+    if (comment) {
+        uint8_t option[4];
+        Put16(option, 1);
+        Put16(option + 2, (uint16_t)comment_len);
+        if (!StreamBufferAppend(blocks, option, sizeof(option), SIZE_MAX) ||
+            !StreamBufferAppend(blocks, comment, comment_len, SIZE_MAX) ||
+            !StreamBufferAppend(blocks, zeros, Pad4(comment_len) - comment_len + 4, SIZE_MAX)) {
+            return 0;
+        }
+    }
+    return StreamBufferAppend(blocks, trailer, sizeof(trailer), SIZE_MAX);
+}
+
+static void WriteUpdate(duckdb_function_info info, duckdb_data_chunk input, duckdb_aggregate_state *states) {
+    idx_t size = duckdb_data_chunk_get_size(input);
+    idx_t columns = duckdb_data_chunk_get_column_count(input);
+    void *data[WRITE_ARG_COUNT] = {NULL};
+    uint64_t *validity[WRITE_ARG_COUNT] = {NULL};
+    for (idx_t i = 0; i < columns && i < WRITE_ARG_COUNT; i++) {
+        duckdb_vector vector = duckdb_data_chunk_get_vector(input, i);
+        data[i] = duckdb_vector_get_data(vector);
+        validity[i] = duckdb_vector_get_validity(vector);
+    }
+    duckdb_string_t *paths = (duckdb_string_t *)data[WRITE_ARG_PATH];
+    uint64_t *timestamps = (uint64_t *)data[WRITE_ARG_TIMESTAMP];
+    duckdb_string_t *packets = (duckdb_string_t *)data[WRITE_ARG_DATA];
+    duckdb_string_t *interfaces = (duckdb_string_t *)data[WRITE_ARG_INTERFACE];
+    duckdb_string_t *comments = (duckdb_string_t *)data[WRITE_ARG_COMMENT];
+    int32_t *link_types = (int32_t *)data[WRITE_ARG_LINK_TYPE];
+    int64_t *original_lens = (int64_t *)data[WRITE_ARG_ORIGINAL_LEN];
+
+    for (idx_t row = 0; row < size; row++) {
+        if (!PcapRowValid(validity[WRITE_ARG_PATH], row) || !PcapRowValid(validity[WRITE_ARG_TIMESTAMP], row) ||
+            !PcapRowValid(validity[WRITE_ARG_DATA], row)) {
+            continue;
+        }
+        partitioned_writer_t *writer = (partitioned_writer_t *)states[row];
+        size_t path_len;
+        const char *path = (const char *)PcapStringBytes(&paths[row], &path_len);
+        pcapng_partition_t *partition =
+            (pcapng_partition_t *)PartitionedWriterPartition(writer, path, path_len, NULL);
+        if (!partition) {
+            duckdb_aggregate_function_set_error(info, pcapng_ops.open_error);
+            return;
+        }
+
+        const char *name = NULL;
+        size_t name_len = 0;
+        if (interfaces && PcapRowValid(validity[WRITE_ARG_INTERFACE], row)) {
+            name = (const char *)PcapStringBytes(&interfaces[row], &name_len);
+        }
+        uint32_t link_type = LINKTYPE_ETHERNET;
+        if (link_types && PcapRowValid(validity[WRITE_ARG_LINK_TYPE], row)) {
+            if (link_types[row] < 0 || link_types[row] > UINT16_MAX) {
+                duckdb_aggregate_function_set_error(info, "link_type must be between 0 and 65535");
+                return;
+            }
+            link_type = (uint32_t)link_types[row];
+        }
+        uint32_t interface_id = PartitionInterface(partition, name, name_len, link_type);
+        if (interface_id == UINT32_MAX) {
+            duckdb_aggregate_function_set_error(info, pcapng_ops.write_error);
+            return;
+        }
+
+        size_t len;
+        const uint8_t *bytes = PcapStringBytes(&packets[row], &len);
+        if (len > PCAPNG_MAX_BLOCK_SIZE - 64 - PCAPNG_MAX_COMMENT) {
+            duckdb_aggregate_function_set_error(info, "Packet too large for pcapng");
+            return;
+        }
+        // A packet captured truncated keeps its length on the wire
+        uint32_t original_len;
+        if (!PartitionedWriterOriginalLen(original_lens, validity[WRITE_ARG_ORIGINAL_LEN], row, len, &original_len)) {
+            duckdb_aggregate_function_set_error(info, PARTITIONED_WRITER_ORIGINAL_LEN_ERROR);
+            return;
+        }
+        const uint8_t *comment = NULL;
+        size_t comment_len = 0;
+        if (comments && PcapRowValid(validity[WRITE_ARG_COMMENT], row)) {
+            comment = PcapStringBytes(&comments[row], &comment_len);
+        }
+        stream_buffer_t *blocks = &partition->base.records;
+        size_t buffered = blocks->len;
+        if (!AppendPacket(blocks, interface_id, timestamps[row], bytes, len, original_len, comment, comment_len)) {
+            duckdb_aggregate_function_set_error(info, "Out of memory buffering pcapng output");
+            return;
+        }
+        if (!PartitionedWriterAdded(writer, &partition->base, blocks->len - buffered)) {
+            duckdb_aggregate_function_set_error(info, pcapng_ops.write_error);
+            return;
+        }
+    }
+}
+
+static void AddParameter(duckdb_aggregate_function function, duckdb_type type) {
+    duckdb_logical_type logical_type = duckdb_create_logical_type(type);
+    duckdb_aggregate_function_add_parameter(function, logical_type);
+    duckdb_destroy_logical_type(&logical_type);
+}
+
+void RegisterPcapngWriterFunction(duckdb_connection connection) {
+    static const duckdb_type parameter_types[WRITE_ARG_COUNT] = {
+        DUCKDB_TYPE_VARCHAR, DUCKDB_TYPE_UBIGINT, DUCKDB_TYPE_BLOB,    DUCKDB_TYPE_VARCHAR,
+        DUCKDB_TYPE_VARCHAR, DUCKDB_TYPE_INTEGER, DUCKDB_TYPE_BIGINT};
+
+    duckdb_logical_type ubigint = duckdb_create_logical_type(DUCKDB_TYPE_UBIGINT);
+    duckdb_aggregate_function_set set = duckdb_create_aggregate_function_set("pcap_write_pcapng");
+    for (idx_t arity = WRITE_ARG_INTERFACE; arity <= WRITE_ARG_COUNT; arity++) {
+        duckdb_aggregate_function function = duckdb_create_aggregate_function();
+        duckdb_aggregate_function_set_name(function, "pcap_write_pcapng");
+        for (idx_t i = 0; i < arity; i++) {
+            AddParameter(function, parameter_types[i]);
+        }
+        duckdb_aggregate_function_set_return_type(function, ubigint);
+        PartitionedWriterSetFunctions(function, &pcapng_ops, WriteUpdate);
+        // NULL interfaces and comments are meaningful, and a NULL link type or
+        // original length takes the default, so rows are not skipped
+        duckdb_aggregate_function_set_special_handling(function);
+        duckdb_add_aggregate_function_to_set(set, function);
+        duckdb_destroy_aggregate_function(&function);
+    }
+    duckdb_register_aggregate_function_set(connection, set);
+    duckdb_destroy_aggregate_function_set(&set);
+    duckdb_destroy_logical_type(&ubigint);
+}
@@ -0,0 +1,2017 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "regex_engine.h"
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Set of bytes accepted by one input step
+typedef struct {
+    uint8_t bits[32];
+} byte_set_t;
+
+typedef enum {
+    NODE_EMPTY,
+    NODE_SET,
+    NODE_CONCAT,
+    NODE_ALT,
+    NODE_REPEAT,
+    NODE_GROUP,
+    NODE_ASSERT
+} node_type_t;
+
+typedef enum {
+    ASSERT_BEGIN_TEXT,     // ^ and \A
+    ASSERT_BEGIN_LINE,     // ^ with (?m)
+    ASSERT_END_TEXT,       // \z and $ with (?E)
+    ASSERT_END_TEXT_NL,    // $ and \Z: end or before a final newline
+    ASSERT_END_LINE,       // $ with (?m)
+    ASSERT_WORD_BOUNDARY,  // \b
+    ASSERT_NOT_WORD_BOUNDARY
+} assert_kind_t;
+
+typedef struct {
+    uint8_t type;       // node_type_t
+    uint8_t greedy;
+    uint8_t kind;       // assert_kind_t
+    int32_t left;       // child of REPEAT and GROUP
+    int32_t right;
+    uint32_t min;
+    uint32_t max;       // UINT32_MAX for unbounded
+    uint32_t index;     // set of SET, group of GROUP
+} node_t;
+
+typedef enum {
+    OP_SET,      // consume a byte in sets[x]
+    OP_SPLIT,    // continue at x, then (lower priority) at y
+    OP_JMP,
+    OP_SAVE,     // record the position in slot x
+    OP_ASSERT,   // zero-width check of kind x
+    OP_MATCH
+} opcode_t;
+
+typedef struct {
+    uint8_t op;
+    uint32_t x;
+    uint32_t y;
+} inst_t;
+
+// One pattern of a program; plain programs have exactly one
+typedef struct {
+    uint32_t start;        // first instruction
+    uint32_t flags;
+    uint32_t min_len;
+    uint32_t max_len;      // UINT32_MAX when unbounded
+} pattern_info_t;
+
+struct regex_prog_s {
+    inst_t *insts;
+    uint32_t inst_count;
+    byte_set_t *sets;
+    uint32_t set_count;
+    uint32_t group_count;
+    uint32_t flags;
+    pattern_info_t *patterns;
+    uint32_t pattern_count;
+    uint32_t assert_kinds;  // bit per assert_kind_t used
+};
+
+typedef struct {
+    const uint8_t *p;
+    size_t len;
+    size_t pos;
+    uint32_t flags;        // current flags, changed by inline modifiers
+    node_t *nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    byte_set_t *sets;
+    uint32_t set_count;
+    uint32_t set_capacity;
+    uint32_t group_count;
+    uint32_t depth;
+    const char *error;
+} regex_parser_t;
+
+// Nesting of groups accepted by the recursive parser and emitter
+#define REGEX_MAX_DEPTH 200
+
+// Generic doubling growth for the parser and compiler arrays
+static int GrowArray(void **items, uint32_t *capacity, size_t item_size, uint32_t needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    uint32_t new_capacity = *capacity ? *capacity * 2 : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void *grown = duckdb_malloc(new_capacity * item_size);
+    if (!grown) {
+        return 0;
+    }
+    if (*items) {
+        memcpy(grown, *items, *capacity * item_size);
+        duckdb_free(*items);
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Byte sets
+// ---------------------------------------------------------------------------
+
+static void SetAdd(byte_set_t *set, uint8_t c) {
+    set->bits[c >> 3] = (uint8_t)(set->bits[c >> 3] | (1u << (c & 7)));
+}
+
+static int SetHas(const byte_set_t *set, uint8_t c) {
+    return (set->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static void SetAddRange(byte_set_t *set, uint8_t lo, uint8_t hi) {
+    for (unsigned c = lo; c <= hi; c++) {
+        SetAdd(set, (uint8_t)c);
+    }
+}
+
+static void SetInvert(byte_set_t *set) {
+    for (int i = 0; i < 32; i++) {
+        set->bits[i] = (uint8_t)~set->bits[i];
+    }
+}
+
+static void SetUnion(byte_set_t *set, const byte_set_t *other) {
+    for (int i = 0; i < 32; i++) {
+        set->bits[i] |= other->bits[i];
+    }
+}
+
+static void SetFoldCase(byte_set_t *set) {
+    for (uint8_t c = 'a'; c <= 'z'; c++) {
+        uint8_t upper = (uint8_t)(c - 32);
+        if (SetHas(set, c) || SetHas(set, upper)) {
+            SetAdd(set, c);
+            SetAdd(set, upper);
+        }
+    }
+}
+
+static int IsWordByte(uint8_t c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Shorthand class for \d \w \s \h \v (lower case); returns 0 if c is none
+static int ShorthandSet(uint8_t c, byte_set_t *set) {
+    memset(set, 0, sizeof(byte_set_t));
+    switch (c | 0x20) {
+    case 'd':
+        SetAddRange(set, '0', '9');
+        break;
+    case 'w':
+        SetAddRange(set, '0', '9');
+        SetAddRange(set, 'a', 'z');
+        SetAddRange(set, 'A', 'Z');
+        SetAdd(set, '_');
+        break;
+    case 's':
+        SetAddRange(set, '\t', '\r');
+        SetAdd(set, ' ');
+        break;
+    case 'h':
+        SetAdd(set, '\t');
+        SetAdd(set, ' ');
+        break;
+    case 'v':
+        SetAddRange(set, '\n', '\r');
+        break;
+    default:
+        return 0;
+    }
+    if (c >= 'A' && c <= 'Z') {
+        SetInvert(set);
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Parser
+// ---------------------------------------------------------------------------
+
+static int32_t NewNode(regex_parser_t *parser, node_type_t type) {
+    if (!GrowArray((void **)&parser->nodes, &parser->node_capacity, sizeof(node_t), parser->node_count + 1)) {
+        parser->error = "Out of memory compiling regular expression";
+        return -1;
+    }
+    node_t *node = &parser->nodes[parser->node_count];
+    memset(node, 0, sizeof(node_t));
+    node->type = (uint8_t)type;
+    node->left = -1;
+    node->right = -1;
+    return (int32_t)parser->node_count++;
+}
+
+static int32_t NewSetNode(regex_parser_t *parser, const byte_set_t *set) {
+    if (!GrowArray((void **)&parser->sets, &parser->set_capacity, sizeof(byte_set_t), parser->set_count + 1)) {
+        parser->error = "Out of memory compiling regular expression";
+        return -1;
+    }
+    int32_t node = NewNode(parser, NODE_SET);
+    if (node < 0) {
+        return -1;
+    }
+    parser->sets[parser->set_count] = *set;
+    if (parser->flags & REGEX_NOCASE) {
+        SetFoldCase(&parser->sets[parser->set_count]);
+    }
+    parser->nodes[node].index = parser->set_count++;
+    return node;
+}
+
+static int32_t NewPair(regex_parser_t *parser, node_type_t type, int32_t left, int32_t right) {
+    int32_t node = NewNode(parser, type);
+    if (node >= 0) {
+        parser->nodes[node].left = left;
+        parser->nodes[node].right = right;
+    }
+    return node;
+}
+
+static int32_t NewAssert(regex_parser_t *parser, assert_kind_t kind) {
+    int32_t node = NewNode(parser, NODE_ASSERT);
+    if (node >= 0) {
+        parser->nodes[node].kind = (uint8_t)kind;
+    }
+    return node;
+}
+
+static int AtEnd(const regex_parser_t *parser) {
+    return parser->pos >= parser->len;
+}
+
+// In extended mode whitespace and comments between tokens are ignored
+static void SkipExtended(regex_parser_t *parser) {
+    if (!(parser->flags & REGEX_EXTENDED)) {
+        return;
+    }
+    while (!AtEnd(parser)) {
+        uint8_t c = parser->p[parser->pos];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            parser->pos++;
+        } else if (c == '#') {
+            while (!AtEnd(parser) && parser->p[parser->pos] != '\n') {
+                parser->pos++;
+            }
+        } else {
+            break;
+        }
+    }
+}
+
+static int HexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = (uint8_t)(c | 0x20);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// Parse a decimal number; returns 0 if there are no digits
+static int ParseNumber(regex_parser_t *parser, uint32_t *value) {
+    size_t start = parser->pos;
+    uint64_t number = 0;
+    while (!AtEnd(parser) && parser->p[parser->pos] >= '0' && parser->p[parser->pos] <= '9') {
+        number = number * 10 + (uint64_t)(parser->p[parser->pos++] - '0');
+        if (number > UINT32_MAX) {
+            number = UINT32_MAX;
+        }
+    }
+    *value = (uint32_t)number;
+    return parser->pos > start;
+}
+
+// Escaped single byte after the backslash (already consumed). Returns -1
+// when the escape is not a byte escape.
+static int ParseByteEscape(regex_parser_t *parser, uint8_t c) {
+    switch (c) {
+    case 'n':
+        return '\n';
+    case 'r':
+        return '\r';
+    case 't':
+        return '\t';
+    case 'f':
+        return '\f';
+    case 'e':
+        return 0x1B;
+    case 'a':
+        return 0x07;
+    case '0': {
+        // Up to two more octal digits
+        int value = 0;
+        for (int i = 0; i < 2 && !AtEnd(parser) && parser->p[parser->pos] >= '0' && parser->p[parser->pos] <= '7'; i++) {
+            value = value * 8 + (parser->p[parser->pos++] - '0');
+        }
+        return value;
+    }
+    case 'x': {
+        int value = 0;
+        if (!AtEnd(parser) && parser->p[parser->pos] == '{') {
+            parser->pos++;
+            int digits = 0;
+            while (!AtEnd(parser) && HexValue(parser->p[parser->pos]) >= 0) {
+                value = value * 16 + HexValue(parser->p[parser->pos++]);
+                if (++digits > 2 || value > 0xFF) {
+                    parser->error = "Regular expression code point above \\xFF";
+                    return -1;
+                }
+            }
+            if (AtEnd(parser) || parser->p[parser->pos] != '}' || !digits) {
+                parser->error = "Malformed \\x{...} escape in regular expression";
+                return -1;
+            }
+            parser->pos++;
+            return value;
+        }
+        for (int i = 0; i < 2 && !AtEnd(parser) && HexValue(parser->p[parser->pos]) >= 0; i++) {
+            value = value * 16 + HexValue(parser->p[parser->pos++]);
+        }
+        return value;
+    }
+    case 'c':
+        if (AtEnd(parser)) {
+            parser->error = "Regular expression ends after \\c";
+            return -1;
+        }
+        return (parser->p[parser->pos++] & 0xDF) ^ 0x40;
+    default:
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '1' && c <= '9')) {
+            parser->error = (c >= '1' && c <= '9') ? "Backreferences are not supported in regular expressions"
+                                                    : "Unsupported escape in regular expression";
+            return -1;
+        }
+        return c;
+    }
+}
+
+static const struct {
+    const char *name;
+    const char *ranges;   // pairs of inclusive bounds
+} posix_classes[] = {
+    {"alpha", "azAZ"}, {"digit", "09"}, {"alnum", "azAZ09"}, {"upper", "AZ"}, {"lower", "az"},
+    {"space", "\t\r  "}, {"blank", "\t\t  "}, {"punct", "!/:@[`{~"}, {"xdigit", "09afAF"},
+    {"word", "azAZ09__"}, {"cntrl", "\x01\x1f\x7f\x7f"}, {"print", " ~"}, {"graph", "!~"},
+};
+
+// [:name:] inside a class; the leading "[:" is at parser->pos
+static int ParsePosixClass(regex_parser_t *parser, byte_set_t *set) {
+    size_t start = parser->pos + 2;
+    size_t end = start;
+    int negate = 0;
+    if (end < parser->len && parser->p[end] == '^') {
+        negate = 1;
+        start++;
+        end++;
+    }
+    while (end + 1 < parser->len && parser->p[end] != ':') {
+        end++;
+    }
+    if (end + 1 >= parser->len || parser->p[end + 1] != ']') {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(posix_classes) / sizeof(posix_classes[0]); i++) {
+        size_t name_len = strlen(posix_classes[i].name);
+        if (name_len == end - start && memcmp(parser->p + start, posix_classes[i].name, name_len) == 0) {
+            byte_set_t item;
+            memset(&item, 0, sizeof(item));
+            // Ranges are byte pairs; NUL cannot appear, so cntrl starts at 1 and adds 0 below
+            for (const char *r = posix_classes[i].ranges; r[0]; r += 2) {
+                SetAddRange(&item, (uint8_t)r[0], (uint8_t)r[1]);
+            }
+            if (strcmp(posix_classes[i].name, "cntrl") == 0) {
+                SetAdd(&item, 0);
+            }
+            if (negate) {
+                SetInvert(&item);
+            }
+            SetUnion(set, &item);
+            parser->pos = end + 2;
+            return 1;
+        }
+    }
+    parser->error = "Unknown POSIX class in regular expression";
+    return -1;
+}
+
+// Bracket expression; the '[' is consumed
+static int32_t ParseClass(regex_parser_t *parser) {
+    byte_set_t set;
+    memset(&set, 0, sizeof(set));
+    int negate = 0;
+    if (!AtEnd(parser) && parser->p[parser->pos] == '^') {
+        negate = 1;
+        parser->pos++;
+    }
+    int first = 1;
+    for (;;) {
+        if (AtEnd(parser)) {
+            parser->error = "Missing ] in regular expression";
+            return -1;
+        }
+        uint8_t c = parser->p[parser->pos];
+        if (c == ']' && !first) {
+            parser->pos++;
+            break;
+        }
+        first = 0;
+        if (c == '[' && parser->pos + 1 < parser->len && parser->p[parser->pos + 1] == ':') {
+            int posix = ParsePosixClass(parser, &set);
+            if (posix < 0) {
+                return -1;
+            }
+            if (posix) {
+                continue;
+            }
+        }
+        parser->pos++;
+        int lo = c;
+        if (c == '\\') {
+            if (AtEnd(parser)) {
+                parser->error = "Regular expression ends with \\";
+                return -1;
+            }
+            uint8_t e = parser->p[parser->pos++];
+            byte_set_t shorthand;
+            if (ShorthandSet(e, &shorthand)) {
+                SetUnion(&set, &shorthand);
+                continue;
+            }
+            lo = e == 'b' ? 0x08 : ParseByteEscape(parser, e);
+            if (lo < 0) {
+                return -1;
+            }
+        }
+        int hi = lo;
+        if (parser->pos + 1 < parser->len && parser->p[parser->pos] == '-' && parser->p[parser->pos + 1] != ']') {
+            parser->pos++;
+            uint8_t h = parser->p[parser->pos++];
+            hi = h;
+            if (h == '\\') {
+                if (AtEnd(parser)) {
+                    parser->error = "Regular expression ends with \\";
+                    return -1;
+                }
+                hi = ParseByteEscape(parser, parser->p[parser->pos++]);
+                if (hi < 0) {
+                    return -1;
+                }
+            }
+            if (hi < lo) {
+                parser->error = "Invalid range in regular expression class";
+                return -1;
+            }
+        }
+        SetAddRange(&set, (uint8_t)lo, (uint8_t)hi);
+    }
+    // Case folding applies before the negation
+    if (parser->flags & REGEX_NOCASE) {
+        SetFoldCase(&set);
+    }
+    if (negate) {
+        SetInvert(&set);
+    }
+    return NewSetNode(parser, &set);
+}
+
+static int32_t ParseAlternation(regex_parser_t *parser);
+
+// Inline modifiers after "(?"; returns 1 for "(?flags)", 2 for "(?flags:",
+// 0 when the text is not a modifier group
+static int ParseModifiers(regex_parser_t *parser, uint32_t *flags) {
+    size_t pos = parser->pos;
+    uint32_t result = *flags;
+    int negate = 0;
+    while (pos < parser->len) {
+        uint8_t c = parser->p[pos++];
+        uint32_t bit = 0;
+        switch (c) {
+        case 'i': bit = REGEX_NOCASE; break;
+        case 's': bit = REGEX_DOTALL; break;
+        case 'm': bit = REGEX_MULTILINE; break;
+        case 'x': bit = REGEX_EXTENDED; break;
+        case 'U': bit = REGEX_UNGREEDY; break;
+        case '-':
+            negate = 1;
+            continue;
+        case ')':
+        case ':':
+            *flags = result;
+            parser->pos = pos;
+            return c == ')' ? 1 : 2;
+        default:
+            return 0;
+        }
+        result = negate ? (result & ~bit) : (result | bit);
+    }
+    return 0;
+}
+
+static int32_t ParseGroup(regex_parser_t *parser) {
+    uint32_t saved_flags = parser->flags;
+    int capture = 1;
+    if (!AtEnd(parser) && parser->p[parser->pos] == '?') {
+        parser->pos++;
+        if (AtEnd(parser)) {
+            parser->error = "Malformed group in regular expression";
+            return -1;
+        }
+        uint8_t c = parser->p[parser->pos];
+        if (c == ':') {
+            parser->pos++;
+            capture = 0;
+        } else if (c == '#') {
+            while (!AtEnd(parser) && parser->p[parser->pos] != ')') {
+                parser->pos++;
+            }
+            if (AtEnd(parser)) {
+                parser->error = "Missing ) in regular expression";
+                return -1;
+            }
+            parser->pos++;
+            return NewNode(parser, NODE_EMPTY);
+        } else if (c == 'P' || c == '<' || c == '\'') {
+            // Named group: (?P<name>...), (?<name>...) or (?'name'...)
+            if (c == 'P') {
+                parser->pos++;
+            }
+            if (AtEnd(parser) || (parser->p[parser->pos] != '<' && parser->p[parser->pos] != '\'')) {
+                parser->error = "Malformed group in regular expression";
+                return -1;
+            }
+            uint8_t close = parser->p[parser->pos] == '<' ? '>' : '\'';
+            parser->pos++;
+            if (!AtEnd(parser) && (parser->p[parser->pos] == '=' || parser->p[parser->pos] == '!')) {
+                parser->error = "Lookaround is not supported in regular expressions";
+                return -1;
+            }
+            while (!AtEnd(parser) && parser->p[parser->pos] != close) {
+                parser->pos++;
+            }
+            if (AtEnd(parser)) {
+                parser->error = "Malformed group name in regular expression";
+                return -1;
+            }
+            parser->pos++;
+        } else if (c == '=' || c == '!') {
+            parser->error = "Lookaround is not supported in regular expressions";
+            return -1;
+        } else {
+            uint32_t flags = parser->flags;
+            int modifiers = ParseModifiers(parser, &flags);
+            if (!modifiers) {
+                parser->error = "Unsupported group syntax in regular expression";
+                return -1;
+            }
+            parser->flags = flags;
+            if (modifiers == 1) {
+                // (?i) applies to the rest of the enclosing group
+                return NewNode(parser, NODE_EMPTY);
+            }
+            capture = 0;
+        }
+    }
+    uint32_t group = 0;
+    if (capture) {
+        if (parser->group_count + 1 >= REGEX_MAX_GROUPS) {
+            parser->error = "Too many capture groups in regular expression";
+            return -1;
+        }
+        group = ++parser->group_count;
+    }
+    if (++parser->depth > REGEX_MAX_DEPTH) {
+        parser->error = "Regular expression nested too deeply";
+        return -1;
+    }
+    int32_t child = ParseAlternation(parser);
+    parser->depth--;
+    if (child < 0) {
+        return -1;
+    }
+    if (AtEnd(parser) || parser->p[parser->pos] != ')') {
+        parser->error = "Missing ) in regular expression";
+        return -1;
+    }
+    parser->pos++;
+    parser->flags = saved_flags;
+    if (!capture) {
+        return child;
+    }
+    int32_t node = NewNode(parser, NODE_GROUP);
+    if (node >= 0) {
+        parser->nodes[node].left = child;
+        parser->nodes[node].index = group;
+    }
+    return node;
+}
+
+static int32_t ParseAtom(regex_parser_t *parser) {
+    uint8_t c = parser->p[parser->pos++];
+    byte_set_t set;
+    memset(&set, 0, sizeof(set));
+    switch (c) {
+    case '(':
+        return ParseGroup(parser);
+    case '[':
+        return ParseClass(parser);
+    case '.':
+        SetInvert(&set);
+        if (!(parser->flags & REGEX_DOTALL)) {
+            set.bits['\n' >> 3] = (uint8_t)(set.bits['\n' >> 3] & ~(1u << ('\n' & 7)));
+        }
+        return NewSetNode(parser, &set);
+    case '^':
+        return NewAssert(parser, (parser->flags & REGEX_MULTILINE) ? ASSERT_BEGIN_LINE : ASSERT_BEGIN_TEXT);
+    case '$':
+        if (parser->flags & REGEX_MULTILINE) {
+            return NewAssert(parser, ASSERT_END_LINE);
+        }
+        return NewAssert(parser, (parser->flags & REGEX_DOLLAR_ENDONLY) ? ASSERT_END_TEXT : ASSERT_END_TEXT_NL);
+    case '*':
+    case '+':
+    case '?':
+        parser->error = "Quantifier without a preceding item in regular expression";
+        return -1;
+    case '\\': {
+        if (AtEnd(parser)) {
+            parser->error = "Regular expression ends with \\";
+            return -1;
+        }
+        uint8_t e = parser->p[parser->pos++];
+        if (ShorthandSet(e, &set)) {
+            return NewSetNode(parser, &set);
+        }
+        switch (e) {
+        case 'b':
+            return NewAssert(parser, ASSERT_WORD_BOUNDARY);
+        case 'B':
+            return NewAssert(parser, ASSERT_NOT_WORD_BOUNDARY);
+        case 'A':
+        case 'G':
+            return NewAssert(parser, ASSERT_BEGIN_TEXT);
+        case 'z':
+            return NewAssert(parser, ASSERT_END_TEXT);
+        case 'Z':
+            return NewAssert(parser, ASSERT_END_TEXT_NL);
+        default:
+            break;
+        }
+        int value = ParseByteEscape(parser, e);
+        if (value < 0) {
+            return -1;
+        }
+        SetAdd(&set, (uint8_t)value);
+        return NewSetNode(parser, &set);
+    }
+    default:
+        SetAdd(&set, c);
+        return NewSetNode(parser, &set);
+    }
+}
+
+// {n}, {n,} or {n,m}; leaves pos unchanged and returns 0 if the brace is a literal
+static int ParseCounted(regex_parser_t *parser, uint32_t *min, uint32_t *max) {
+    size_t start = parser->pos;
+    parser->pos++;
+    if (!ParseNumber(parser, min)) {
+        parser->pos = start;
+        return 0;
+    }
+    *max = *min;
+    if (!AtEnd(parser) && parser->p[parser->pos] == ',') {
+        parser->pos++;
+        if (!ParseNumber(parser, max)) {
+            *max = UINT32_MAX;
+        }
+    }
+    if (AtEnd(parser) || parser->p[parser->pos] != '}') {
+        parser->pos = start;
+        return 0;
+    }
+    parser->pos++;
+    return 1;
+}
+
+static int32_t ParseRepeat(regex_parser_t *parser) {
+    int32_t atom = ParseAtom(parser);
+    for (;;) {
+        if (atom < 0) {
+            return -1;
+        }
+        SkipExtended(parser);
+        if (AtEnd(parser)) {
+            return atom;
+        }
+        uint32_t min;
+        uint32_t max;
+        uint8_t c = parser->p[parser->pos];
+        if (c == '*') {
+            min = 0;
+            max = UINT32_MAX;
+            parser->pos++;
+        } else if (c == '+') {
+            min = 1;
+            max = UINT32_MAX;
+            parser->pos++;
+        } else if (c == '?') {
+            min = 0;
+            max = 1;
+            parser->pos++;
+        } else if (c != '{' || !ParseCounted(parser, &min, &max)) {
+            return atom;
+        }
+        if ((min > REGEX_MAX_REPEAT && min != UINT32_MAX) || (max > REGEX_MAX_REPEAT && max != UINT32_MAX) ||
+            min > max) {
+            parser->error = "Invalid repetition count in regular expression";
+            return -1;
+        }
+        int greedy = !(parser->flags & REGEX_UNGREEDY);
+        if (!AtEnd(parser) && parser->p[parser->pos] == '?') {
+            greedy = !greedy;
+            parser->pos++;
+        } else if (!AtEnd(parser) && parser->p[parser->pos] == '+') {
+            // Possessive quantifiers only differ in backtracking behaviour
+            parser->pos++;
+        }
+        int32_t node = NewNode(parser, NODE_REPEAT);
+        if (node >= 0) {
+            parser->nodes[node].left = atom;
+            parser->nodes[node].min = min;
+            parser->nodes[node].max = max;
+            parser->nodes[node].greedy = (uint8_t)greedy;
+        }
+        atom = node;
+    }
+}
+
+static int32_t ParseConcat(regex_parser_t *parser) {
+    int32_t result = -1;
+    for (;;) {
+        SkipExtended(parser);
+        if (AtEnd(parser) || parser->p[parser->pos] == '|' || parser->p[parser->pos] == ')') {
+            break;
+        }
+        // The emitter recurses along concatenations; bound their length
+        if (parser->node_count >= REGEX_MAX_INSTRUCTIONS) {
+            parser->error = "Regular expression too large";
+            return -1;
+        }
+        int32_t item = ParseRepeat(parser);
+        if (item < 0) {
+            return -1;
+        }
+        result = result < 0 ? item : NewPair(parser, NODE_CONCAT, result, item);
+        if (result < 0) {
+            return -1;
+        }
+    }
+    return result < 0 ? NewNode(parser, NODE_EMPTY) : result;
+}
+
+static int32_t ParseAlternation(regex_parser_t *parser) {
+    int32_t result = ParseConcat(parser);
+    while (result >= 0 && !AtEnd(parser) && parser->p[parser->pos] == '|') {
+        parser->pos++;
+        int32_t right = ParseConcat(parser);
+        if (right < 0) {
+            return -1;
+        }
+        result = NewPair(parser, NODE_ALT, result, right);
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Compiler
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const node_t *nodes;
+    inst_t *insts;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t limit;         // instruction count at which the current pattern is too large
+    uint32_t assert_kinds;
+    const char *error;
+} regex_compiler_t;
+
+static uint32_t EmitInst(regex_compiler_t *compiler, opcode_t op, uint32_t x, uint32_t y) {
+    if (compiler->count >= compiler->limit) {
+        compiler->error = "Regular expression too large";
+        return UINT32_MAX;
+    }
+    if (!GrowArray((void **)&compiler->insts, &compiler->capacity, sizeof(inst_t), compiler->count + 1)) {
+        compiler->error = "Out of memory compiling regular expression";
+        return UINT32_MAX;
+    }
+    compiler->insts[compiler->count].op = (uint8_t)op;
+    compiler->insts[compiler->count].x = x;
+    compiler->insts[compiler->count].y = y;
+    return compiler->count++;
+}
+
+static int EmitNode(regex_compiler_t *compiler, int32_t index);
+
+// An optional copy of a node: SPLIT body, next (swapped when lazy)
+static int EmitOptional(regex_compiler_t *compiler, const node_t *node) {
+    uint32_t split = EmitInst(compiler, OP_SPLIT, 0, 0);
+    if (split == UINT32_MAX || !EmitNode(compiler, node->left)) {
+        return 0;
+    }
+    uint32_t body = split + 1;
+    uint32_t next = compiler->count;
+    compiler->insts[split].x = node->greedy ? body : next;
+    compiler->insts[split].y = node->greedy ? next : body;
+    return 1;
+}
+
+static int EmitRepeat(regex_compiler_t *compiler, const node_t *node) {
+    for (uint32_t i = 0; i < node->min; i++) {
+        if (!EmitNode(compiler, node->left)) {
+            return 0;
+        }
+    }
+    if (node->max == UINT32_MAX) {
+        // loop: SPLIT body, exit; body; JMP loop
+        uint32_t loop = EmitInst(compiler, OP_SPLIT, 0, 0);
+        if (loop == UINT32_MAX || !EmitNode(compiler, node->left) || EmitInst(compiler, OP_JMP, loop, 0) == UINT32_MAX) {
+            return 0;
+        }
+        uint32_t exit = compiler->count;
+        compiler->insts[loop].x = node->greedy ? loop + 1 : exit;
+        compiler->insts[loop].y = node->greedy ? exit : loop + 1;
+        return 1;
+    }
+    for (uint32_t i = node->min; i < node->max; i++) {
+        if (!EmitOptional(compiler, node)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int EmitNode(regex_compiler_t *compiler, int32_t index) {
+    const node_t *node = &compiler->nodes[index];
+    switch (node->type) {
+    case NODE_EMPTY:
+        return 1;
+    case NODE_SET:
+        return EmitInst(compiler, OP_SET, node->index, 0) != UINT32_MAX;
+    case NODE_ASSERT:
+        compiler->assert_kinds |= 1u << node->kind;
+        return EmitInst(compiler, OP_ASSERT, node->kind, 0) != UINT32_MAX;
+    case NODE_CONCAT:
+        return EmitNode(compiler, node->left) && EmitNode(compiler, node->right);
+    case NODE_GROUP:
+        return EmitInst(compiler, OP_SAVE, node->index * 2, 0) != UINT32_MAX && EmitNode(compiler, node->left) &&
+               EmitInst(compiler, OP_SAVE, node->index * 2 + 1, 0) != UINT32_MAX;
+    case NODE_ALT: {
+        uint32_t split = EmitInst(compiler, OP_SPLIT, 0, 0);
+        if (split == UINT32_MAX || !EmitNode(compiler, node->left)) {
+            return 0;
+        }
+        uint32_t jump = EmitInst(compiler, OP_JMP, 0, 0);
+        if (jump == UINT32_MAX || !EmitNode(compiler, node->right)) {
+            return 0;
+        }
+        compiler->insts[split].x = split + 1;
+        compiler->insts[split].y = jump + 1;
+        compiler->insts[jump].x = compiler->count;
+        return 1;
+    }
+    case NODE_REPEAT:
+        return EmitRepeat(compiler, node);
+    default:
+        return 0;
+    }
+}
+
+static uint32_t AddLength(uint32_t a, uint32_t b) {
+    return (a == UINT32_MAX || b == UINT32_MAX || a > UINT32_MAX - 1 - b) ? UINT32_MAX : a + b;
+}
+
+static uint32_t MultiplyLength(uint32_t a, uint32_t count) {
+    if (!a || !count) {
+        return 0;
+    }
+    return (a == UINT32_MAX || count == UINT32_MAX || a > (UINT32_MAX - 1) / count) ? UINT32_MAX : a * count;
+}
+
+// Shortest and longest match of a node; max is UINT32_MAX when unbounded
+static void NodeLength(const node_t *nodes, int32_t index, uint32_t *min, uint32_t *max) {
+    const node_t *node = &nodes[index];
+    uint32_t left_min;
+    uint32_t left_max;
+    uint32_t right_min;
+    uint32_t right_max;
+    switch (node->type) {
+    case NODE_SET:
+        *min = 1;
+        *max = 1;
+        return;
+    case NODE_CONCAT:
+    case NODE_ALT:
+        NodeLength(nodes, node->left, &left_min, &left_max);
+        NodeLength(nodes, node->right, &right_min, &right_max);
+        if (node->type == NODE_CONCAT) {
+            *min = AddLength(left_min, right_min);
+            *max = AddLength(left_max, right_max);
+        } else {
+            *min = left_min < right_min ? left_min : right_min;
+            *max = left_max > right_max ? left_max : right_max;
+        }
+        return;
+    case NODE_REPEAT:
+        NodeLength(nodes, node->left, &left_min, &left_max);
+        *min = MultiplyLength(left_min, node->min);
+        *max = MultiplyLength(left_max, node->max);
+        return;
+    case NODE_GROUP:
+        NodeLength(nodes, node->left, min, max);
+        return;
+    default:
+        *min = 0;
+        *max = 0;
+        return;
+    }
+}
+
+// Parse one pattern and append "SAVE 0, program, SAVE 1, MATCH id" to the
+// compiler. Sets accumulate in the parser, so patterns share one set table.
+static const char *CompilePattern(regex_parser_t *parser, regex_compiler_t *compiler, const char *pattern,
+                                  size_t len, uint32_t flags, uint32_t id, pattern_info_t *info) {
+    parser->p = (const uint8_t *)pattern;
+    parser->len = len;
+    parser->pos = 0;
+    parser->flags = flags;
+    parser->nodes = NULL;
+    parser->node_count = 0;
+    parser->node_capacity = 0;
+    parser->group_count = 0;
+    parser->depth = 0;
+
+    int32_t root = ParseAlternation(parser);
+    if (root >= 0 && !AtEnd(parser)) {
+        parser->error = "Unmatched ) in regular expression";
+    }
+    compiler->nodes = parser->nodes;
+    compiler->limit = compiler->count + REGEX_MAX_INSTRUCTIONS;
+    info->start = compiler->count;
+    info->flags = flags;
+    if (!parser->error) {
+        NodeLength(parser->nodes, root, &info->min_len, &info->max_len);
+        if (EmitInst(compiler, OP_SAVE, 0, 0) == UINT32_MAX || !EmitNode(compiler, root) ||
+            EmitInst(compiler, OP_SAVE, 1, 0) == UINT32_MAX || EmitInst(compiler, OP_MATCH, id, 0) == UINT32_MAX) {
+            parser->error = compiler->error;
+        }
+    }
+    duckdb_free(parser->nodes);
+    parser->nodes = NULL;
+    return parser->error;
+}
+
+static const char *CompilePatterns(const regex_pattern_t *patterns, size_t count, regex_prog_t **out) {
+    *out = NULL;
+    regex_parser_t parser;
+    memset(&parser, 0, sizeof(parser));
+    regex_compiler_t compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    const char *error = NULL;
+    pattern_info_t *infos = NULL;
+    if (!count || count > REGEX_MAX_PATTERNS) {
+        error = "Invalid number of regular expressions";
+    } else {
+        infos = (pattern_info_t *)duckdb_malloc(count * sizeof(pattern_info_t));
+        if (!infos) {
+            error = "Out of memory compiling regular expression";
+        }
+    }
+    uint32_t group_count = 0;
+    for (size_t i = 0; !error && i < count; i++) {
+        error = CompilePattern(&parser, &compiler, patterns[i].pattern, patterns[i].len, patterns[i].flags,
+                               (uint32_t)i, &infos[i]);
+        group_count = parser.group_count;
+    }
+    regex_prog_t *prog = NULL;
+    if (!error) {
+        prog = (regex_prog_t *)duckdb_malloc(sizeof(regex_prog_t));
+        if (!prog) {
+            error = "Out of memory compiling regular expression";
+        }
+    }
+    if (error) {
+        duckdb_free(infos);
+        duckdb_free(compiler.insts);
+        duckdb_free(parser.sets);
+        return error;
+    }
+    prog->insts = compiler.insts;
+    prog->inst_count = compiler.count;
+    prog->sets = parser.sets;
+    prog->set_count = parser.set_count;
+    prog->group_count = group_count + 1;
+    prog->flags = patterns[0].flags;
+    prog->patterns = infos;
+    prog->pattern_count = (uint32_t)count;
+    prog->assert_kinds = compiler.assert_kinds;
+    *out = prog;
+    return NULL;
+}
+
+const char *RegexCompile(const char *pattern, size_t len, uint32_t flags, regex_prog_t **out) {
+    regex_pattern_t single;
+    single.pattern = pattern;
+    single.len = len;
+    single.flags = flags;
+    return CompilePatterns(&single, 1, out);
+}
+
+const char *RegexCompileSet(const regex_pattern_t *patterns, size_t count, regex_prog_t **out) {
+    return CompilePatterns(patterns, count, out);
+}
+
+void RegexFree(regex_prog_t *prog) {
+    if (prog) {
+        duckdb_free(prog->insts);
+        duckdb_free(prog->sets);
+        duckdb_free(prog->patterns);
+        duckdb_free(prog);
+    }
+}
+
+uint32_t RegexPatternCount(const regex_prog_t *prog) {
+    return prog->pattern_count;
+}
+
+void RegexPatternLength(const regex_prog_t *prog, uint32_t pattern, uint32_t *min, uint32_t *max) {
+    *min = prog->patterns[pattern].min_len;
+    *max = prog->patterns[pattern].max_len;
+}
+
+uint32_t RegexGroupCount(const regex_prog_t *prog) {
+    return prog->group_count;
+}
+
+size_t RegexLiteralPrefix(const regex_prog_t *prog, uint8_t *prefix, size_t capacity) {
+    if (prog->pattern_count != 1 || (prog->patterns[0].flags & REGEX_ANCHORED)) {
+        return 0;
+    }
+    // Follow the single path from the start through sets of one byte
+    size_t len = 0;
+    uint32_t pc = prog->patterns[0].start;
+    for (uint32_t steps = 0; len < capacity && steps < prog->inst_count; steps++) {
+        const inst_t *inst = &prog->insts[pc];
+        if (inst->op == OP_SAVE) {
+            pc++;
+            continue;
+        }
+        if (inst->op == OP_JMP) {
+            pc = inst->x;
+            continue;
+        }
+        if (inst->op != OP_SET) {
+            break;
+        }
+        const byte_set_t *set = &prog->sets[inst->x];
+        int only = -1;
+        for (uint32_t c = 0; c < 256; c++) {
+            if (SetHas(set, (uint8_t)c)) {
+                if (only >= 0) {
+                    return len;
+                }
+                only = (int)c;
+            }
+        }
+        if (only < 0) {
+            break;
+        }
+        prefix[len++] = (uint8_t)only;
+        pc++;
+    }
+    return len;
+}
+
+// ---------------------------------------------------------------------------
+// Pike VM
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t count;
+    uint32_t *pcs;
+    size_t *slots;     // slot_count per thread
+} thread_list_t;
+
+// addthread work item: follow pc, or restore slot to value when backtracking
+typedef struct {
+    uint32_t pc;
+    uint32_t restore_slot;
+    size_t restore_value;
+} vm_frame_t;
+
+typedef struct {
+    const regex_prog_t *prog;
+    const uint8_t *data;
+    size_t len;
+    uint32_t slot_count;
+    uint32_t *marks;
+    uint32_t generation;
+    vm_frame_t *stack;
+} regex_vm_t;
+
+static int CheckAssert(const regex_vm_t *vm, uint32_t kind, size_t pos) {
+    const uint8_t *data = vm->data;
+    size_t len = vm->len;
+    switch (kind) {
+    case ASSERT_BEGIN_TEXT:
+        return pos == 0;
+    case ASSERT_BEGIN_LINE:
+        return pos == 0 || data[pos - 1] == '\n';
+    case ASSERT_END_TEXT:
+        return pos == len;
+    case ASSERT_END_TEXT_NL:
+        return pos == len || (pos + 1 == len && data[pos] == '\n');
+    case ASSERT_END_LINE:
+        return pos == len || data[pos] == '\n';
+    case ASSERT_WORD_BOUNDARY:
+    case ASSERT_NOT_WORD_BOUNDARY: {
+        int before = pos > 0 && IsWordByte(data[pos - 1]);
+        int after = pos < len && IsWordByte(data[pos]);
+        return (before != after) == (kind == ASSERT_WORD_BOUNDARY);
+    }
+    default:
+        return 0;
+    }
+}
+
+// Add the thread at pc and everything reachable from it without consuming
+// input, in priority order. slots is the working capture array and is
+// restored on return.
+static void AddThread(regex_vm_t *vm, thread_list_t *list, uint32_t pc, size_t *slots, size_t pos) {
+    uint32_t top = 0;
+    vm->stack[top].pc = pc;
+    vm->stack[top++].restore_slot = UINT32_MAX;
+    while (top) {
+        vm_frame_t frame = vm->stack[--top];
+        if (frame.restore_slot != UINT32_MAX) {
+            slots[frame.restore_slot] = frame.restore_value;
+            continue;
+        }
+        pc = frame.pc;
+        if (vm->marks[pc] == vm->generation) {
+            continue;
+        }
+        vm->marks[pc] = vm->generation;
+        const inst_t *inst = &vm->prog->insts[pc];
+        switch (inst->op) {
+        case OP_JMP:
+            vm->stack[top].pc = inst->x;
+            vm->stack[top++].restore_slot = UINT32_MAX;
+            break;
+        case OP_SPLIT:
+            vm->stack[top].pc = inst->y;
+            vm->stack[top++].restore_slot = UINT32_MAX;
+            vm->stack[top].pc = inst->x;
+            vm->stack[top++].restore_slot = UINT32_MAX;
+            break;
+        case OP_SAVE:
+            if (inst->x < vm->slot_count) {
+                vm->stack[top].restore_slot = inst->x;
+                vm->stack[top++].restore_value = slots[inst->x];
+                slots[inst->x] = pos;
+            }
+            vm->stack[top].pc = pc + 1;
+            vm->stack[top++].restore_slot = UINT32_MAX;
+            break;
+        case OP_ASSERT:
+            if (CheckAssert(vm, inst->x, pos)) {
+                vm->stack[top].pc = pc + 1;
+                vm->stack[top++].restore_slot = UINT32_MAX;
+            }
+            break;
+        default:
+            list->pcs[list->count] = pc;
+            if (vm->slot_count) {
+                memcpy(list->slots + (size_t)list->count * vm->slot_count, slots, vm->slot_count * sizeof(size_t));
+            }
+            list->count++;
+            break;
+        }
+    }
+}
+
+int RegexSearch(const regex_prog_t *prog, const uint8_t *data, size_t len, regex_match_t *match) {
+    uint32_t n = prog->inst_count;
+    uint32_t slot_count = match ? prog->group_count * 2 : 0;
+    size_t per_list = (size_t)n * (sizeof(uint32_t) + slot_count * sizeof(size_t));
+    // Each instruction is expanded at most once per step: a SPLIT pushes two
+    // frames and a SAVE a restore and a continuation
+    size_t bytes = 2 * per_list + (size_t)n * sizeof(uint32_t) + (size_t)(3 * n + 1) * sizeof(vm_frame_t) +
+                   3 * (size_t)slot_count * sizeof(size_t) + 16;
+    uint8_t *memory = (uint8_t *)duckdb_malloc(bytes);
+    if (!memory) {
+        return -1;
+    }
+    regex_vm_t vm;
+    vm.prog = prog;
+    vm.data = data;
+    vm.len = len;
+    vm.slot_count = slot_count;
+    vm.generation = 1;
+    // Frames first: they hold size_t members and need the strictest alignment
+    vm.stack = (vm_frame_t *)(void *)memory;
+    size_t *work = (size_t *)(void *)(memory + (size_t)(3 * n + 1) * sizeof(vm_frame_t));
+    size_t *best = work + slot_count;
+    thread_list_t lists[2];
+    lists[0].slots = best + slot_count;
+    lists[1].slots = lists[0].slots + (size_t)n * slot_count;
+    lists[0].pcs = (uint32_t *)(void *)(lists[1].slots + (size_t)n * slot_count);
+    lists[1].pcs = lists[0].pcs + n;
+    vm.marks = lists[1].pcs + n;
+    memset(vm.marks, 0, n * sizeof(uint32_t));
+
+    thread_list_t *current = &lists[0];
+    thread_list_t *next = &lists[1];
+    current->count = 0;
+    next->count = 0;
+    int matched = 0;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        work[i] = SIZE_MAX;
+    }
+    AddThread(&vm, current, 0, work, 0);
+
+    int anchored = (prog->flags & REGEX_ANCHORED) != 0;
+    for (size_t pos = 0;; pos++) {
+        // Without threads only a new unanchored attempt can still match
+        if (!current->count && (anchored || matched)) {
+            break;
+        }
+        vm.generation++;
+        next->count = 0;
+        for (uint32_t t = 0; t < current->count; t++) {
+            uint32_t pc = current->pcs[t];
+            const inst_t *inst = &prog->insts[pc];
+            size_t *thread_slots = current->slots + (size_t)t * slot_count;
+            if (inst->op == OP_MATCH) {
+                matched = 1;
+                if (!match) {
+                    break;
+                }
+                memcpy(best, thread_slots, slot_count * sizeof(size_t));
+                // Lower-priority threads cannot produce the leftmost-first match
+                break;
+            }
+            if (pos < len && SetHas(&prog->sets[inst->x], data[pos])) {
+                if (slot_count) {
+                    memcpy(work, thread_slots, slot_count * sizeof(size_t));
+                }
+                AddThread(&vm, next, pc + 1, work, pos + 1);
+            }
+        }
+        if (matched && !match) {
+            break;
+        }
+        if (pos >= len) {
+            break;
+        }
+        // A new attempt starting at the next position has the lowest priority
+        if (!matched && !anchored) {
+            for (uint32_t i = 0; i < slot_count; i++) {
+                work[i] = SIZE_MAX;
+            }
+            AddThread(&vm, next, 0, work, pos + 1);
+        }
+        thread_list_t *swap = current;
+        current = next;
+        next = swap;
+    }
+
+    if (matched && match) {
+        for (uint32_t g = 0; g < REGEX_MAX_GROUPS; g++) {
+            int set = g < prog->group_count && best[2 * g] != SIZE_MAX && best[2 * g + 1] != SIZE_MAX;
+            match->start[g] = set ? best[2 * g] : SIZE_MAX;
+            match->end[g] = set ? best[2 * g + 1] : SIZE_MAX;
+        }
+    }
+    duckdb_free(memory);
+    return matched;
+}
+
+// ---------------------------------------------------------------------------
+// Lazy DFA
+// ---------------------------------------------------------------------------
+
+// What the assertions need to know about the input before a position
+#define DFA_CONTEXT_START 0x01
+#define DFA_CONTEXT_WORD 0x02
+#define DFA_CONTEXT_NEWLINE 0x04
+
+// Transition entries hold the next state as a row offset, with DFA_MATCH
+// set when patterns match before the byte is consumed; DFA_UNKNOWN marks
+// transitions not computed yet
+#define DFA_MATCH 0x80000000u
+#define DFA_UNKNOWN 0xFFFFFFFFu
+
+// $ also matches before a final newline. Threads that pass it there are
+// conditional on the input ending right after that newline; their kernel
+// entries carry DFA_PENDING, and a conditional match becomes a pending
+// entry holding the pattern. Both are resolved by the next byte: dropped,
+// or at the end of input kept (the match then ends one byte earlier, which
+// DFA_EARLIER marks in match lists).
+#define DFA_PENDING 0x80000000u
+#define DFA_PENDING_MATCH 0x40000000u
+#define DFA_EARLIER 0x80000000u
+
+// State number of RegexDfaResumeState; state 0 is REGEX_DFA_START
+#define DFA_RESUME 1
+
+// Skipping bytes in DFA_RESUME only pays off when few bytes leave it
+#define DFA_IDLE_MAX_EXITS 16
+
+typedef struct {
+    uint32_t kernel;       // offset in the kernel pool
+    uint32_t kernel_len;
+    uint32_t hash;
+    uint8_t context;
+} dfa_state_t;
+
+struct regex_dfa_s {
+    const regex_prog_t *prog;
+    uint8_t byte_class[256];
+    uint8_t class_byte[256];   // a representative byte per class
+    uint32_t class_count;
+    uint32_t stride;           // class_count + 1: the last column is the end of input
+    uint8_t context_mask;
+
+    // A state is the set of instructions waiting for the next byte (its
+    // kernel) plus its context
+    dfa_state_t *states;
+    uint32_t state_count;
+    uint32_t state_capacity;
+    uint32_t max_states;
+    uint32_t *table;           // state_capacity * stride transition entries
+    uint32_t *match_lists;     // per entry with DFA_MATCH: offset in the match pool
+    uint32_t *kernels;
+    uint32_t kernel_len;
+    uint32_t kernel_capacity;
+    uint32_t *match_pool;      // pattern count followed by the patterns
+    uint32_t match_len;
+    uint32_t match_capacity;
+    uint32_t *buckets;         // open addressing over states: number + 1, or 0
+    uint32_t bucket_count;
+
+    // Bytes that leave the DFA in DFA_RESUME, where no match is in
+    // progress. idle_exit is the one byte that does not when there is
+    // exactly one (so memchr can find it); idle_accelerate is off when too
+    // many bytes leave the state for skipping to pay off.
+    uint8_t idle_skip[256];
+    int idle_exit;
+    int idle_accelerate;
+
+    uint32_t *unanchored_starts;
+    uint32_t unanchored_count;
+    uint32_t *anchored_starts;
+    uint32_t anchored_count;
+
+    // Scratch space for computing one transition
+    uint32_t *marks;           // per instruction
+    uint32_t *pattern_marks;
+    uint32_t generation;
+    uint32_t *stack;
+    uint32_t *next_kernel;
+    uint32_t next_len;
+    uint32_t *found;
+    uint32_t found_count;
+
+    regex_dfa_roots_t roots;
+    void *roots_context;
+};
+
+static int IsNewlineClassNeeded(uint32_t kinds) {
+    return (kinds & ((1u << ASSERT_BEGIN_LINE) | (1u << ASSERT_END_LINE) | (1u << ASSERT_END_TEXT_NL))) != 0;
+}
+
+static int IsWordClassNeeded(uint32_t kinds) {
+    return (kinds & ((1u << ASSERT_WORD_BOUNDARY) | (1u << ASSERT_NOT_WORD_BOUNDARY))) != 0;
+}
+
+// Split the classes of a byte partition by one predicate
+static void RefineClasses(uint8_t *byte_class, uint32_t *class_count, const byte_set_t *set) {
+    uint16_t remap[256][2];
+    memset(remap, 0xFF, sizeof(remap));
+    uint32_t count = 0;
+    for (int c = 0; c < 256; c++) {
+        int member = SetHas(set, (uint8_t)c);
+        uint16_t *slot = &remap[byte_class[c]][member];
+        if (*slot == 0xFFFF) {
+            *slot = (uint16_t)count++;
+        }
+        byte_class[c] = (uint8_t)*slot;
+    }
+    *class_count = count;
+}
+
+// Bytes are equivalent when every set, and every assertion that looks at
+// the byte, treats them alike
+static int ComputeByteClasses(regex_dfa_t *dfa) {
+    const regex_prog_t *prog = dfa->prog;
+    memset(dfa->byte_class, 0, sizeof(dfa->byte_class));
+    dfa->class_count = 1;
+    hash_map_t seen;
+    if (!HashMapInit(&seen, sizeof(byte_set_t), 1)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < prog->set_count && dfa->class_count < 256; i++) {
+        int is_new;
+        if (!HashMapInsert(&seen, &prog->sets[i], &is_new)) {
+            HashMapDestroy(&seen);
+            return 0;
+        }
+        if (is_new) {
+            RefineClasses(dfa->byte_class, &dfa->class_count, &prog->sets[i]);
+        }
+    }
+    HashMapDestroy(&seen);
+    byte_set_t set;
+    if (IsWordClassNeeded(prog->assert_kinds)) {
+        ShorthandSet('w', &set);
+        RefineClasses(dfa->byte_class, &dfa->class_count, &set);
+    }
+    if (IsNewlineClassNeeded(prog->assert_kinds)) {
+        memset(&set, 0, sizeof(set));
+        SetAdd(&set, '\n');
+        RefineClasses(dfa->byte_class, &dfa->class_count, &set);
+    }
+    for (int c = 255; c >= 0; c--) {
+        dfa->class_byte[dfa->byte_class[c]] = (uint8_t)c;
+    }
+    return 1;
+}
+
+static uint32_t HashKernel(const uint32_t *kernel, uint32_t len, uint8_t context) {
+    uint64_t h = (len ? HashBytes(kernel, len * sizeof(uint32_t)) : 0) ^ ((uint64_t)context * 0x9E3779B97F4A7C15ULL);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static int GrowStates(regex_dfa_t *dfa, uint32_t needed) {
+    if (needed <= dfa->state_capacity) {
+        return 1;
+    }
+    uint32_t capacity = dfa->state_capacity ? dfa->state_capacity * 2 : 16;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    size_t entries = (size_t)capacity * dfa->stride;
+    size_t old_entries = (size_t)dfa->state_capacity * dfa->stride;
+    dfa_state_t *states = (dfa_state_t *)duckdb_malloc(capacity * sizeof(dfa_state_t));
+    uint32_t *table = (uint32_t *)duckdb_malloc(entries * sizeof(uint32_t));
+    uint32_t *match_lists = (uint32_t *)duckdb_malloc(entries * sizeof(uint32_t));
+    if (!states || !table || !match_lists) {
+        duckdb_free(states);
+        duckdb_free(table);
+        duckdb_free(match_lists);
+        return 0;
+    }
+    if (dfa->states) {
+        memcpy(states, dfa->states, dfa->state_count * sizeof(dfa_state_t));
+        memcpy(table, dfa->table, old_entries * sizeof(uint32_t));
+        memcpy(match_lists, dfa->match_lists, old_entries * sizeof(uint32_t));
+    }
+    memset(table + old_entries, 0xFF, (entries - old_entries) * sizeof(uint32_t));
+    duckdb_free(dfa->states);
+    duckdb_free(dfa->table);
+    duckdb_free(dfa->match_lists);
+    dfa->states = states;
+    dfa->table = table;
+    dfa->match_lists = match_lists;
+    dfa->state_capacity = capacity;
+    return 1;
+}
+
+// Rebuild the bucket array for the current states
+static int RehashStates(regex_dfa_t *dfa, uint32_t bucket_count) {
+    uint32_t *buckets = (uint32_t *)duckdb_malloc(bucket_count * sizeof(uint32_t));
+    if (!buckets) {
+        return 0;
+    }
+    memset(buckets, 0, bucket_count * sizeof(uint32_t));
+    for (uint32_t s = 0; s < dfa->state_count; s++) {
+        uint32_t b = dfa->states[s].hash & (bucket_count - 1);
+        while (buckets[b]) {
+            b = (b + 1) & (bucket_count - 1);
+        }
+        buckets[b] = s + 1;
+    }
+    duckdb_free(dfa->buckets);
+    dfa->buckets = buckets;
+    dfa->bucket_count = bucket_count;
+    return 1;
+}
+
+// Look up or add the state for a kernel. Returns 1 with *number set, 0 when
+// the cache is full and -1 when memory is exhausted.
+static int InternState(regex_dfa_t *dfa, const uint32_t *kernel, uint32_t len, uint8_t context, uint32_t *number) {
+    uint32_t hash = HashKernel(kernel, len, context);
+    uint32_t b = hash & (dfa->bucket_count - 1);
+    for (; dfa->buckets[b]; b = (b + 1) & (dfa->bucket_count - 1)) {
+        const dfa_state_t *state = &dfa->states[dfa->buckets[b] - 1];
+        if (state->hash == hash && state->context == context && state->kernel_len == len &&
+            memcmp(dfa->kernels + state->kernel, kernel, len * sizeof(uint32_t)) == 0) {
+            *number = dfa->buckets[b] - 1;
+            return 1;
+        }
+    }
+    if (dfa->state_count >= dfa->max_states ||
+        ((size_t)dfa->kernel_len + len) * sizeof(uint32_t) > REGEX_DFA_CACHE_BYTES / 2) {
+        return 0;
+    }
+    if (!GrowStates(dfa, dfa->state_count + 1) ||
+        !GrowArray((void **)&dfa->kernels, &dfa->kernel_capacity, sizeof(uint32_t), dfa->kernel_len + len + 1)) {
+        return -1;
+    }
+    dfa_state_t *state = &dfa->states[dfa->state_count];
+    state->kernel = dfa->kernel_len;
+    state->kernel_len = len;
+    state->hash = hash;
+    state->context = context;
+    if (len) {
+        memcpy(dfa->kernels + dfa->kernel_len, kernel, len * sizeof(uint32_t));
+    }
+    dfa->kernel_len += len;
+    *number = dfa->state_count++;
+    dfa->buckets[b] = *number + 1;
+    // Keep the load factor at most one half
+    if (dfa->state_count * 2 > dfa->bucket_count && !RehashStates(dfa, dfa->bucket_count * 2)) {
+        return -1;
+    }
+    return 1;
+}
+
+typedef struct {
+    regex_dfa_t *dfa;
+    uint32_t *remap;       // old state number -> new number, UINT32_MAX when dropped
+    uint32_t count;        // states before compaction
+    int rewrite;
+} dfa_compact_t;
+
+static void CompactVisit(void *visitor, uint32_t *state) {
+    dfa_compact_t *compact = (dfa_compact_t *)visitor;
+    uint32_t number = *state / compact->dfa->stride;
+    if (number >= compact->count) {
+        return;
+    }
+    if (!compact->rewrite) {
+        compact->remap[number] = 0;
+    } else if (compact->remap[number] != UINT32_MAX) {
+        *state = compact->remap[number] * compact->dfa->stride;
+    }
+}
+
+// Drop every cached state except the fixed ones, the running scan's and
+// the caller's roots, renumbering the survivors in place
+static int CompactStates(regex_dfa_t *dfa, uint32_t *current) {
+    uint32_t count = dfa->state_count;
+    dfa_compact_t compact;
+    compact.dfa = dfa;
+    compact.count = count;
+    compact.rewrite = 0;
+    compact.remap = (uint32_t *)duckdb_malloc(count * sizeof(uint32_t));
+    if (!compact.remap) {
+        return 0;
+    }
+    memset(compact.remap, 0xFF, count * sizeof(uint32_t));
+    compact.remap[REGEX_DFA_START] = 0;
+    compact.remap[DFA_RESUME] = 0;
+    CompactVisit(&compact, current);
+    if (dfa->roots) {
+        dfa->roots(dfa->roots_context, CompactVisit, &compact);
+    }
+
+    uint32_t kept = 0;
+    uint32_t kernel_len = 0;
+    for (uint32_t s = 0; s < count; s++) {
+        if (compact.remap[s] == UINT32_MAX) {
+            continue;
+        }
+        dfa_state_t state = dfa->states[s];
+        memmove(dfa->kernels + kernel_len, dfa->kernels + state.kernel, state.kernel_len * sizeof(uint32_t));
+        state.kernel = kernel_len;
+        kernel_len += state.kernel_len;
+        dfa->states[kept] = state;
+        compact.remap[s] = kept++;
+    }
+    dfa->state_count = kept;
+    dfa->kernel_len = kernel_len;
+    dfa->match_len = 1;
+    memset(dfa->table, 0xFF, (size_t)dfa->state_capacity * dfa->stride * sizeof(uint32_t));
+
+    compact.rewrite = 1;
+    CompactVisit(&compact, current);
+    if (dfa->roots) {
+        dfa->roots(dfa->roots_context, CompactVisit, &compact);
+    }
+    duckdb_free(compact.remap);
+    // States in use are never dropped; leave room for new ones
+    if (kept * 2 > dfa->max_states) {
+        dfa->max_states = kept * 2;
+    }
+    uint32_t bucket_count = dfa->bucket_count;
+    while (bucket_count < kept * 2) {
+        bucket_count *= 2;
+    }
+    return RehashStates(dfa, bucket_count);
+}
+
+static int CheckDfaAssert(uint32_t kind, uint8_t context, int c) {
+    switch (kind) {
+    case ASSERT_BEGIN_TEXT:
+        return (context & DFA_CONTEXT_START) != 0;
+    case ASSERT_BEGIN_LINE:
+        return (context & (DFA_CONTEXT_START | DFA_CONTEXT_NEWLINE)) != 0;
+    case ASSERT_END_TEXT:
+    case ASSERT_END_TEXT_NL:
+        return c < 0;
+    case ASSERT_END_LINE:
+        return c < 0 || c == '\n';
+    case ASSERT_WORD_BOUNDARY:
+    case ASSERT_NOT_WORD_BOUNDARY: {
+        int before = (context & DFA_CONTEXT_WORD) != 0;
+        int after = c >= 0 && IsWordByte((uint8_t)c);
+        return (before != after) == (kind == ASSERT_WORD_BOUNDARY);
+    }
+    default:
+        return 0;
+    }
+}
+
+static int CompareKernelEntries(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+// Follow the empty transitions from a state's kernel (and the pattern
+// starts) with input byte c, or -1 for the end of input. Collects matching
+// patterns in found and the next kernel in next_kernel.
+static void ComputeClosure(regex_dfa_t *dfa, uint32_t number, int c) {
+    const regex_prog_t *prog = dfa->prog;
+    const dfa_state_t *state = &dfa->states[number];
+    uint32_t n = prog->inst_count;
+    if (++dfa->generation == 0) {
+        memset(dfa->marks, 0, 2 * (size_t)n * sizeof(uint32_t));
+        memset(dfa->pattern_marks, 0, 2 * (size_t)prog->pattern_count * sizeof(uint32_t));
+        dfa->generation = 1;
+    }
+    uint32_t generation = dfa->generation;
+    uint32_t top = 0;
+    dfa->next_len = 0;
+    dfa->found_count = 0;
+    for (uint32_t i = 0; i < state->kernel_len; i++) {
+        uint32_t entry = dfa->kernels[state->kernel + i];
+        if (!(entry & DFA_PENDING)) {
+            dfa->stack[top++] = entry;
+        } else if (c < 0 && (entry & DFA_PENDING_MATCH)) {
+            uint32_t pattern = entry & ~(DFA_PENDING | DFA_PENDING_MATCH);
+            if (dfa->pattern_marks[prog->pattern_count + pattern] != generation) {
+                dfa->pattern_marks[prog->pattern_count + pattern] = generation;
+                dfa->found[dfa->found_count++] = pattern | DFA_EARLIER;
+            }
+        } else if (c < 0) {
+            // The newline was the last byte: the thread holds unconditionally
+            dfa->stack[top++] = entry & ~DFA_PENDING;
+        }
+    }
+    for (uint32_t i = 0; i < dfa->unanchored_count; i++) {
+        dfa->stack[top++] = dfa->unanchored_starts[i];
+    }
+    if (state->context & DFA_CONTEXT_START) {
+        for (uint32_t i = 0; i < dfa->anchored_count; i++) {
+            dfa->stack[top++] = dfa->anchored_starts[i];
+        }
+    }
+    // Stack entries are instructions, with DFA_PENDING for conditional threads
+    while (top) {
+        uint32_t item = dfa->stack[--top];
+        uint32_t pending = item & DFA_PENDING;
+        uint32_t pc = item & ~DFA_PENDING;
+        uint32_t *mark = &dfa->marks[pending ? n + pc : pc];
+        if (*mark == generation) {
+            continue;
+        }
+        *mark = generation;
+        const inst_t *inst = &prog->insts[pc];
+        switch (inst->op) {
+        case OP_JMP:
+            dfa->stack[top++] = inst->x | pending;
+            break;
+        case OP_SPLIT:
+            dfa->stack[top++] = inst->y | pending;
+            dfa->stack[top++] = inst->x | pending;
+            break;
+        case OP_SAVE:
+            dfa->stack[top++] = (pc + 1) | pending;
+            break;
+        case OP_ASSERT:
+            if (CheckDfaAssert(inst->x, state->context, c)) {
+                dfa->stack[top++] = (pc + 1) | pending;
+            } else if (inst->x == ASSERT_END_TEXT_NL && c == '\n') {
+                dfa->stack[top++] = (pc + 1) | DFA_PENDING;
+            }
+            break;
+        case OP_MATCH:
+            if (pending) {
+                dfa->next_kernel[dfa->next_len++] = inst->x | DFA_PENDING | DFA_PENDING_MATCH;
+            } else if (dfa->pattern_marks[inst->x] != generation) {
+                dfa->pattern_marks[inst->x] = generation;
+                dfa->found[dfa->found_count++] = inst->x;
+            }
+            break;
+        default:
+            if (c >= 0 && SetHas(&prog->sets[inst->x], (uint8_t)c)) {
+                dfa->next_kernel[dfa->next_len++] = (pc + 1) | pending;
+            }
+            break;
+        }
+    }
+    if (dfa->next_len > 1) {
+        qsort(dfa->next_kernel, dfa->next_len, sizeof(uint32_t), CompareKernelEntries);
+        // Conditional matches of one pattern can come from several threads
+        uint32_t unique = 1;
+        for (uint32_t i = 1; i < dfa->next_len; i++) {
+            if (dfa->next_kernel[i] != dfa->next_kernel[unique - 1]) {
+                dfa->next_kernel[unique++] = dfa->next_kernel[i];
+            }
+        }
+        dfa->next_len = unique;
+    }
+}
+
+// Fill in the transition of the state at *row for column. The cache may be
+// rebuilt meanwhile, which renumbers *row. Returns 0 when memory is exhausted.
+static int ComputeTransition(regex_dfa_t *dfa, uint32_t *row, uint32_t column, uint32_t *entry) {
+    int c = column < dfa->class_count ? dfa->class_byte[column] : -1;
+    ComputeClosure(dfa, *row / dfa->stride, c);
+    uint8_t context = 0;
+    if (c >= 0) {
+        context = (uint8_t)((IsWordByte((uint8_t)c) ? DFA_CONTEXT_WORD : 0) | (c == '\n' ? DFA_CONTEXT_NEWLINE : 0));
+    }
+    context &= dfa->context_mask;
+
+    for (int attempt = 0;; attempt++) {
+        uint32_t next = *row / dfa->stride;
+        int result = 1;
+        if (c >= 0) {
+            result = InternState(dfa, dfa->next_kernel, dfa->next_len, context, &next);
+        }
+        uint32_t list = 0;
+        if (result > 0 && dfa->found_count) {
+            if (((size_t)dfa->match_len + dfa->found_count + 1) * sizeof(uint32_t) > REGEX_DFA_CACHE_BYTES / 4) {
+                result = 0;
+            } else if (!GrowArray((void **)&dfa->match_pool, &dfa->match_capacity, sizeof(uint32_t),
+                                  dfa->match_len + dfa->found_count + 1)) {
+                return 0;
+            } else {
+                list = dfa->match_len;
+                dfa->match_pool[list] = dfa->found_count;
+                memcpy(dfa->match_pool + list + 1, dfa->found, dfa->found_count * sizeof(uint32_t));
+                dfa->match_len += dfa->found_count + 1;
+            }
+        }
+        if (result < 0) {
+            return 0;
+        }
+        if (result == 0) {
+            // Cache full: keep the states in use and try again once
+            if (attempt || !CompactStates(dfa, row)) {
+                return 0;
+            }
+            continue;
+        }
+        *entry = next * dfa->stride | (list ? DFA_MATCH : 0);
+        dfa->table[*row + column] = *entry;
+        dfa->match_lists[*row + column] = list;
+        return 1;
+    }
+}
+
+// Outside matches most input bytes return the DFA to DFA_RESUME without
+// reporting anything. Which ones depends only on the program, so it stays
+// valid when the cache is rebuilt.
+static int ComputeIdleSkip(regex_dfa_t *dfa) {
+    uint32_t idle = DFA_RESUME * dfa->stride;
+    uint32_t exits = 0;
+    for (uint32_t column = 0; column < dfa->class_count; column++) {
+        uint32_t row = idle;
+        uint32_t entry;
+        if (!ComputeTransition(dfa, &row, column, &entry)) {
+            return 0;
+        }
+        uint8_t skip = entry == idle;
+        for (uint32_t c = 0; c < 256; c++) {
+            if (dfa->byte_class[c] == column) {
+                dfa->idle_skip[c] = skip;
+                if (!skip && exits++ == 0) {
+                    dfa->idle_exit = (int)c;
+                }
+            }
+        }
+    }
+    if (exits != 1) {
+        dfa->idle_exit = -1;
+    }
+    dfa->idle_accelerate = exits <= DFA_IDLE_MAX_EXITS;
+    return 1;
+}
+
+const char *RegexDfaCreate(const regex_prog_t *prog, regex_dfa_t **out) {
+    *out = NULL;
+    regex_dfa_t *dfa = (regex_dfa_t *)duckdb_malloc(sizeof(regex_dfa_t));
+    if (!dfa) {
+        return "Out of memory compiling regular expression";
+    }
+    memset(dfa, 0, sizeof(regex_dfa_t));
+    dfa->prog = prog;
+    uint32_t n = prog->inst_count;
+    uint32_t patterns = prog->pattern_count;
+    // Marks and stack cover both the plain and the conditional copy of each
+    // instruction; each is expanded once per closure and pushes at most two
+    // entries. Kernels hold at most one entry per instruction and copy, plus
+    // pending matches.
+    dfa->marks = (uint32_t *)duckdb_malloc(2 * (size_t)n * sizeof(uint32_t));
+    dfa->pattern_marks = (uint32_t *)duckdb_malloc(2 * (size_t)patterns * sizeof(uint32_t));
+    dfa->stack = (uint32_t *)duckdb_malloc(((size_t)6 * n + patterns + 8) * sizeof(uint32_t));
+    dfa->next_kernel = (uint32_t *)duckdb_malloc(((size_t)2 * n + patterns + 8) * sizeof(uint32_t));
+    dfa->found = (uint32_t *)duckdb_malloc(2 * (size_t)patterns * sizeof(uint32_t));
+    dfa->unanchored_starts = (uint32_t *)duckdb_malloc(patterns * sizeof(uint32_t));
+    dfa->anchored_starts = (uint32_t *)duckdb_malloc(patterns * sizeof(uint32_t));
+    if (!dfa->marks || !dfa->pattern_marks || !dfa->stack || !dfa->next_kernel || !dfa->found ||
+        !dfa->unanchored_starts || !dfa->anchored_starts || !ComputeByteClasses(dfa)) {
+        RegexDfaFree(dfa);
+        return "Out of memory compiling regular expression";
+    }
+    memset(dfa->marks, 0, 2 * (size_t)n * sizeof(uint32_t));
+    memset(dfa->pattern_marks, 0, 2 * (size_t)patterns * sizeof(uint32_t));
+    for (uint32_t i = 0; i < patterns; i++) {
+        if (prog->patterns[i].flags & REGEX_ANCHORED) {
+            dfa->anchored_starts[dfa->anchored_count++] = prog->patterns[i].start;
+        } else {
+            dfa->unanchored_starts[dfa->unanchored_count++] = prog->patterns[i].start;
+        }
+    }
+    dfa->context_mask = DFA_CONTEXT_START;
+    if (IsWordClassNeeded(prog->assert_kinds)) {
+        dfa->context_mask |= DFA_CONTEXT_WORD;
+    }
+    if (prog->assert_kinds & (1u << ASSERT_BEGIN_LINE)) {
+        dfa->context_mask |= DFA_CONTEXT_NEWLINE;
+    }
+    dfa->stride = dfa->class_count + 1;
+    dfa->max_states = (uint32_t)(REGEX_DFA_CACHE_BYTES / ((size_t)dfa->stride * 2 * sizeof(uint32_t)));
+    if (dfa->max_states < 16) {
+        dfa->max_states = 16;
+    }
+    dfa->match_len = 1;
+    uint32_t number;
+    if (!RehashStates(dfa, 64) || InternState(dfa, NULL, 0, DFA_CONTEXT_START, &number) <= 0 ||
+        InternState(dfa, NULL, 0, 0, &number) <= 0 || !ComputeIdleSkip(dfa)) {
+        RegexDfaFree(dfa);
+        return "Out of memory compiling regular expression";
+    }
+    *out = dfa;
+    return NULL;
+}
+
+void RegexDfaFree(regex_dfa_t *dfa) {
+    if (!dfa) {
+        return;
+    }
+    duckdb_free(dfa->states);
+    duckdb_free(dfa->table);
+    duckdb_free(dfa->match_lists);
+    duckdb_free(dfa->kernels);
+    duckdb_free(dfa->match_pool);
+    duckdb_free(dfa->buckets);
+    duckdb_free(dfa->unanchored_starts);
+    duckdb_free(dfa->anchored_starts);
+    duckdb_free(dfa->marks);
+    duckdb_free(dfa->pattern_marks);
+    duckdb_free(dfa->stack);
+    duckdb_free(dfa->next_kernel);
+    duckdb_free(dfa->found);
+    duckdb_free(dfa);
+}
+
+void RegexDfaSetRoots(regex_dfa_t *dfa, regex_dfa_roots_t roots, void *context) {
+    dfa->roots = roots;
+    dfa->roots_context = context;
+}
+
+uint32_t RegexDfaResumeState(regex_dfa_t *dfa) {
+    return DFA_RESUME * dfa->stride;
+}
+
+static int ReportMatches(const regex_dfa_t *dfa, uint32_t entry_index, size_t end, regex_dfa_match_t callback,
+                         void *context) {
+    const uint32_t *list = dfa->match_pool + dfa->match_lists[entry_index];
+    for (uint32_t i = 1; i <= list[0]; i++) {
+        uint32_t pattern = list[i];
+        if (callback(context, pattern & ~DFA_EARLIER, (pattern & DFA_EARLIER) ? end - 1 : end)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Transition entries with DFA_MATCH set are not computed yet or report
+// matches. Returns like RegexDfaScan, with 1 to continue.
+static int SlowTransition(regex_dfa_t *dfa, uint32_t *row, uint32_t column, size_t end, uint32_t *entry,
+                          regex_dfa_match_t callback, void *context) {
+    if (*entry == DFA_UNKNOWN && !ComputeTransition(dfa, row, column, entry)) {
+        return -1;
+    }
+    if ((*entry & DFA_MATCH) && ReportMatches(dfa, *row + column, end, callback, context)) {
+        return 0;
+    }
+    return 1;
+}
+
+// Bytes that leave DFA_RESUME are found by skipping the others
+static size_t SkipIdle(const regex_dfa_t *dfa, const uint8_t *data, size_t i, size_t len) {
+    if (dfa->idle_exit >= 0) {
+        const uint8_t *next = (const uint8_t *)memchr(data + i, dfa->idle_exit, len - i);
+        return next ? (size_t)(next - data) : len;
+    }
+    const uint8_t *skip = dfa->idle_skip;
+    while (i + 8 <= len && (skip[data[i]] & skip[data[i + 1]] & skip[data[i + 2]] & skip[data[i + 3]] &
+                            skip[data[i + 4]] & skip[data[i + 5]] & skip[data[i + 6]] & skip[data[i + 7]])) {
+        i += 8;
+    }
+    while (i < len && skip[data[i]]) {
+        i++;
+    }
+    return i;
+}
+
+int RegexDfaScan(regex_dfa_t *dfa, uint32_t *state, const uint8_t *data, size_t len, regex_dfa_match_t callback,
+                 void *context) {
+    const uint8_t *byte_class = dfa->byte_class;
+    uint32_t row = *state;
+    // Two copies of the loop: testing for the idle state on every byte
+    // slows down patterns that leave it too often to skip anything
+    if (!dfa->idle_accelerate) {
+        for (size_t i = 0; i < len; i++) {
+            uint32_t column = byte_class[data[i]];
+            uint32_t entry = dfa->table[row + column];
+            if (entry & DFA_MATCH) {
+                int result = SlowTransition(dfa, &row, column, i, &entry, callback, context);
+                if (result <= 0) {
+                    *state = result < 0 ? row : entry & ~DFA_MATCH;
+                    return result;
+                }
+            }
+            row = entry & ~DFA_MATCH;
+        }
+        *state = row;
+        return 1;
+    }
+    uint32_t idle = DFA_RESUME * dfa->stride;
+    for (size_t i = 0; i < len; i++) {
+        // Between matches, jump to the next byte that can start one
+        if (row == idle && (i = SkipIdle(dfa, data, i, len)) == len) {
+            break;
+        }
+        uint32_t column = byte_class[data[i]];
+        uint32_t entry = dfa->table[row + column];
+        if (entry & DFA_MATCH) {
+            int result = SlowTransition(dfa, &row, column, i, &entry, callback, context);
+            if (result <= 0) {
+                *state = result < 0 ? row : entry & ~DFA_MATCH;
+                return result;
+            }
+        }
+        row = entry & ~DFA_MATCH;
+    }
+    *state = row;
+    return 1;
+}
+
+int RegexDfaFinish(regex_dfa_t *dfa, uint32_t state, size_t end, regex_dfa_match_t callback, void *context) {
+    uint32_t column = dfa->class_count;
+    uint32_t entry = dfa->table[state + column];
+    if (entry == DFA_UNKNOWN && !ComputeTransition(dfa, &state, column, &entry)) {
+        return -1;
+    }
+    if ((entry & DFA_MATCH) && ReportMatches(dfa, state + column, end, callback, context)) {
+        return 0;
+    }
+    return 1;
+}
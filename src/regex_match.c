@@ -0,0 +1,377 @@
+#include "duckdb_extension.h"
+#include "pcap_reader.h"
+#include "regex_engine.h"
+#include "regex_match.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+DUCKDB_EXTENSION_EXTERN
+
+// A pattern compiled for matching: its program, a lazy DFA over it (which
+// is mutated while scanning, so one thread uses it at a time) and the
+// literal bytes every match starts with
+typedef struct {
+    char *pattern;
+    size_t pattern_len;
+    regex_prog_t *prog;
+    regex_dfa_t *dfa;
+    uint8_t prefix[REGEX_MATCH_PREFIX_BYTES];
+    size_t prefix_len;
+    uint32_t group_count;
+    int slot;                  // cache slot, -1 when not cached
+} regex_compiled_t;
+
+// Scalar functions run on several threads at once; the lock only guards
+// checking entries in and out
+typedef struct {
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+    regex_compiled_t *entries[REGEX_MATCH_CACHE_ENTRIES];
+    uint8_t in_use[REGEX_MATCH_CACHE_ENTRIES];
+    uint64_t last_used[REGEX_MATCH_CACHE_ENTRIES];
+    uint64_t clock;
+} regex_cache_t;
+
+static void CacheLock(regex_cache_t *cache) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&cache->lock);
+#else
+    pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+static void CacheUnlock(regex_cache_t *cache) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&cache->lock);
+#else
+    pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+static void FreeCompiled(regex_compiled_t *compiled) {
+    if (compiled) {
+        RegexDfaFree(compiled->dfa);
+        RegexFree(compiled->prog);
+        duckdb_free(compiled->pattern);
+        duckdb_free(compiled);
+    }
+}
+
+static const char *CompilePattern(const char *pattern, size_t len, regex_compiled_t **out) {
+    *out = NULL;
+    regex_compiled_t *compiled = (regex_compiled_t *)duckdb_malloc(sizeof(regex_compiled_t));
+    if (!compiled) {
+        return "Out of memory compiling regular expression";
+    }
+    memset(compiled, 0, sizeof(regex_compiled_t));
+    compiled->slot = -1;
+    compiled->pattern = (char *)duckdb_malloc(len ? len : 1);
+    if (!compiled->pattern) {
+        FreeCompiled(compiled);
+        return "Out of memory compiling regular expression";
+    }
+    memcpy(compiled->pattern, pattern, len);
+    compiled->pattern_len = len;
+    const char *error = RegexCompile(pattern, len, 0, &compiled->prog);
+    if (!error) {
+        error = RegexDfaCreate(compiled->prog, &compiled->dfa);
+    }
+    if (error) {
+        FreeCompiled(compiled);
+        return error;
+    }
+    compiled->prefix_len = RegexLiteralPrefix(compiled->prog, compiled->prefix, REGEX_MATCH_PREFIX_BYTES);
+    compiled->group_count = RegexGroupCount(compiled->prog);
+    *out = compiled;
+    return NULL;
+}
+
+static int SamePattern(const regex_compiled_t *compiled, const char *pattern, size_t len) {
+    return compiled->pattern_len == len && memcmp(compiled->pattern, pattern, len) == 0;
+}
+
+// Check out a compiled pattern: an idle cached one, or a new one that takes
+// the least recently used idle slot. When every slot is busy the new
+// pattern is not cached and is freed on release.
+static const char *CacheAcquire(regex_cache_t *cache, const char *pattern, size_t len, regex_compiled_t **out) {
+    CacheLock(cache);
+    for (int i = 0; i < REGEX_MATCH_CACHE_ENTRIES; i++) {
+        if (cache->entries[i] && !cache->in_use[i] && SamePattern(cache->entries[i], pattern, len)) {
+            cache->in_use[i] = 1;
+            *out = cache->entries[i];
+            CacheUnlock(cache);
+            return NULL;
+        }
+    }
+    CacheUnlock(cache);
+
+    // Compile without holding the lock
+    regex_compiled_t *compiled;
+    const char *error = CompilePattern(pattern, len, &compiled);
+    if (error) {
+        return error;
+    }
+    regex_compiled_t *evicted = NULL;
+    CacheLock(cache);
+    int slot = -1;
+    for (int i = 0; i < REGEX_MATCH_CACHE_ENTRIES; i++) {
+        if (!cache->entries[i]) {
+            slot = i;
+            break;
+        }
+        if (!cache->in_use[i] && (slot < 0 || cache->last_used[i] < cache->last_used[slot])) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        evicted = cache->entries[slot];
+        cache->entries[slot] = compiled;
+        cache->in_use[slot] = 1;
+        compiled->slot = slot;
+    }
+    CacheUnlock(cache);
+    FreeCompiled(evicted);
+    *out = compiled;
+    return NULL;
+}
+
+static void CacheRelease(regex_cache_t *cache, regex_compiled_t *compiled) {
+    if (compiled->slot < 0) {
+        FreeCompiled(compiled);
+        return;
+    }
+    CacheLock(cache);
+    cache->in_use[compiled->slot] = 0;
+    cache->last_used[compiled->slot] = ++cache->clock;
+    CacheUnlock(cache);
+}
+
+static void CacheFree(void *data) {
+    regex_cache_t *cache = (regex_cache_t *)data;
+    if (!cache) {
+        return;
+    }
+    for (int i = 0; i < REGEX_MATCH_CACHE_ENTRIES; i++) {
+        FreeCompiled(cache->entries[i]);
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    duckdb_free(cache);
+}
+
+static regex_cache_t *CacheCreate(void) {
+    regex_cache_t *cache = (regex_cache_t *)duckdb_malloc(sizeof(regex_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    memset(cache, 0, sizeof(regex_cache_t));
+#ifdef _WIN32
+    InitializeSRWLock(&cache->lock);
+#else
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        duckdb_free(cache);
+        return NULL;
+    }
+#endif
+    return cache;
+}
+
+// ---------------------------------------------------------------------------
+// Matching
+// ---------------------------------------------------------------------------
+
+static int StopAtMatch(void *context, uint32_t pattern, size_t end) {
+    (void)context;
+    (void)pattern;
+    (void)end;
+    return 1;
+}
+
+// Find where a search for the first match can start: the first occurrence
+// of the literal prefix. Returns 0 when the prefix does not occur.
+static int FindStart(const regex_compiled_t *compiled, const uint8_t *data, size_t len, size_t *start) {
+    size_t prefix_len = compiled->prefix_len;
+    size_t pos = 0;
+    *start = 0;
+    if (!prefix_len) {
+        return 1;
+    }
+    while (pos + prefix_len <= len) {
+        const uint8_t *hit = (const uint8_t *)memchr(data + pos, compiled->prefix[0], len - prefix_len + 1 - pos);
+        if (!hit) {
+            return 0;
+        }
+        pos = (size_t)(hit - data);
+        if (memcmp(hit + 1, compiled->prefix + 1, prefix_len - 1) == 0) {
+            *start = pos;
+            return 1;
+        }
+        pos++;
+    }
+    return 0;
+}
+
+// Returns 1 when data has a match, 0 when it has none and -1 when memory is
+// exhausted; *start is where a match search can begin
+static int HasMatch(regex_compiled_t *compiled, const uint8_t *data, size_t len, size_t *start) {
+    if (!FindStart(compiled, data, len, start)) {
+        return 0;
+    }
+    // Every match starts with the prefix (with no assertion before it), so
+    // the DFA can begin at its first occurrence as if the input started there
+    uint32_t state = REGEX_DFA_START;
+    int result = RegexDfaScan(compiled->dfa, &state, data + *start, len - *start, StopAtMatch, NULL);
+    if (result == 1) {
+        result = RegexDfaFinish(compiled->dfa, state, len - *start, StopAtMatch, NULL);
+    }
+    if (result >= 0) {
+        return result == 0;
+    }
+    // The DFA ran out of memory for states; the NFA needs far less
+    return RegexSearch(compiled->prog, data + *start, len - *start, NULL);
+}
+
+static void RegexRun(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output, int extract) {
+    regex_cache_t *cache = (regex_cache_t *)duckdb_scalar_function_get_extra_info(info);
+    idx_t size = duckdb_data_chunk_get_size(input);
+    duckdb_vector data_vector = duckdb_data_chunk_get_vector(input, 0);
+    duckdb_vector pattern_vector = duckdb_data_chunk_get_vector(input, 1);
+    duckdb_string_t *data = (duckdb_string_t *)duckdb_vector_get_data(data_vector);
+    duckdb_string_t *patterns = (duckdb_string_t *)duckdb_vector_get_data(pattern_vector);
+    uint64_t *data_validity = duckdb_vector_get_validity(data_vector);
+    uint64_t *pattern_validity = duckdb_vector_get_validity(pattern_vector);
+    int32_t *groups = NULL;
+    uint64_t *group_validity = NULL;
+    if (duckdb_data_chunk_get_column_count(input) > 2) {
+        duckdb_vector group_vector = duckdb_data_chunk_get_vector(input, 2);
+        groups = (int32_t *)duckdb_vector_get_data(group_vector);
+        group_validity = duckdb_vector_get_validity(group_vector);
+    }
+    bool *matches = extract ? NULL : (bool *)duckdb_vector_get_data(output);
+
+    // Rows usually share one pattern; it stays checked out until it changes
+    regex_compiled_t *compiled = NULL;
+    const char *error = NULL;
+    for (idx_t row = 0; row < size && !error; row++) {
+        if (!PcapRowValid(data_validity, row) || !PcapRowValid(pattern_validity, row) ||
+            (groups && !PcapRowValid(group_validity, row))) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        size_t pattern_len;
+        const char *pattern = (const char *)PcapStringBytes(&patterns[row], &pattern_len);
+        if (!compiled || !SamePattern(compiled, pattern, pattern_len)) {
+            if (compiled) {
+                CacheRelease(cache, compiled);
+                compiled = NULL;
+            }
+            error = CacheAcquire(cache, pattern, pattern_len, &compiled);
+            if (error) {
+                break;
+            }
+        }
+        int32_t group = groups ? groups[row] : 0;
+        if (group < 0 || (uint32_t)group >= compiled->group_count) {
+            error = "Regular expression group index out of range";
+            break;
+        }
+
+        size_t len;
+        const uint8_t *bytes = PcapStringBytes(&data[row], &len);
+        size_t start;
+        int found = HasMatch(compiled, bytes, len, &start);
+        if (found < 0) {
+            error = "Out of memory matching regular expression";
+            break;
+        }
+        if (!extract) {
+            matches[row] = found;
+            continue;
+        }
+        // Only rows that match pay for the NFA, which tracks groups
+        regex_match_t match;
+        found = found ? RegexSearch(compiled->prog, bytes + start, len - start, &match) : 0;
+        if (found < 0) {
+            error = "Out of memory matching regular expression";
+            break;
+        }
+        if (!found || match.start[group] == SIZE_MAX) {
+            PcapVectorSetNull(output, row);
+            continue;
+        }
+        duckdb_vector_assign_string_element_len(output, row, (const char *)bytes + start + match.start[group],
+                                                match.end[group] - match.start[group]);
+    }
+    if (compiled) {
+        CacheRelease(cache, compiled);
+    }
+    if (error) {
+        duckdb_scalar_function_set_error(info, error);
+    }
+}
+
+static void RegexMatchFunction(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output) {
+    RegexRun(info, input, output, 0);
+}
+
+static void RegexExtractFunction(duckdb_function_info info, duckdb_data_chunk input, duckdb_vector output) {
+    RegexRun(info, input, output, 1);
+}
+
+// Add one overload to set; each has its own pattern cache
+static void AddOverload(duckdb_scalar_function_set set, const char *name, duckdb_type data_type, int with_group,
+                        duckdb_type return_type, duckdb_scalar_function_t callback) {
+    regex_cache_t *cache = CacheCreate();
+    if (!cache) {
+        return;
+    }
+    duckdb_scalar_function function = duckdb_create_scalar_function();
+    duckdb_scalar_function_set_name(function, name);
+    duckdb_logical_type type = duckdb_create_logical_type(data_type);
+    duckdb_scalar_function_add_parameter(function, type);
+    duckdb_destroy_logical_type(&type);
+    type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_scalar_function_add_parameter(function, type);
+    duckdb_destroy_logical_type(&type);
+    if (with_group) {
+        type = duckdb_create_logical_type(DUCKDB_TYPE_INTEGER);
+        duckdb_scalar_function_add_parameter(function, type);
+        duckdb_destroy_logical_type(&type);
+    }
+    type = duckdb_create_logical_type(return_type);
+    duckdb_scalar_function_set_return_type(function, type);
+    duckdb_destroy_logical_type(&type);
+    duckdb_scalar_function_set_function(function, callback);
+    duckdb_scalar_function_set_extra_info(function, cache, CacheFree);
+    duckdb_add_scalar_function_to_set(set, function);
+    duckdb_destroy_scalar_function(&function);
+}
+
+void RegisterRegexFunctions(duckdb_connection connection) {
+    static const duckdb_type data_types[] = {DUCKDB_TYPE_BLOB, DUCKDB_TYPE_VARCHAR};
+
+    duckdb_scalar_function_set set = duckdb_create_scalar_function_set("pcap_regex_match");
+    for (size_t i = 0; i < 2; i++) {
+        AddOverload(set, "pcap_regex_match", data_types[i], 0, DUCKDB_TYPE_BOOLEAN, RegexMatchFunction);
+    }
+    duckdb_register_scalar_function_set(connection, set);
+    duckdb_destroy_scalar_function_set(&set);
+
+    set = duckdb_create_scalar_function_set("pcap_regex_extract");
+    for (size_t i = 0; i < 2; i++) {
+        AddOverload(set, "pcap_regex_extract", data_types[i], 0, DUCKDB_TYPE_BLOB, RegexExtractFunction);
+        AddOverload(set, "pcap_regex_extract", data_types[i], 1, DUCKDB_TYPE_BLOB, RegexExtractFunction);
+    }
+    duckdb_register_scalar_function_set(connection, set);
+    duckdb_destroy_scalar_function_set(&set);
+}
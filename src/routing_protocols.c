@@ -0,0 +1,1094 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "message_stream.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "routing_protocols.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// BGP message header: 16-byte marker, length, type
+#define BGP_HEADER_LEN 19
+#define BGP_OPEN 1
+#define BGP_UPDATE 2
+#define BGP_NOTIFICATION 3
+#define BGP_KEEPALIVE 4
+#define BGP_ROUTE_REFRESH 5
+
+// Path attribute type codes
+#define BGP_ATTR_ORIGIN 1
+#define BGP_ATTR_AS_PATH 2
+#define BGP_ATTR_NEXT_HOP 3
+#define BGP_ATTR_MED 4
+#define BGP_ATTR_LOCAL_PREF 5
+#define BGP_ATTR_COMMUNITIES 8
+#define BGP_ATTR_MP_REACH 14
+#define BGP_ATTR_MP_UNREACH 15
+#define BGP_ATTR_AS4_PATH 17
+#define BGP_ATTR_LARGE_COMMUNITIES 32
+#define BGP_ATTR_FLAG_EXTENDED 0x10
+
+#define BGP_AS_SET 1
+#define BGP_AS_SEQUENCE 2
+#define BGP_CAPABILITY_AS4 65
+
+#define AFI_IPV4 1
+#define AFI_IPV6 2
+#define SAFI_UNICAST 1
+#define SAFI_MULTICAST 2
+
+// OSPF packet types and header lengths
+#define OSPF_HELLO 1
+#define OSPF_LS_UPDATE 4
+#define OSPFV2_HEADER_LEN 24
+#define OSPFV3_HEADER_LEN 16
+#define OSPF_LSA_HEADER_LEN 20
+
+// Shared columns
+enum {
+    ROUTE_COL_TIMESTAMP,
+    ROUTE_COL_SRC_IP,
+    ROUTE_COL_SRC_PORT,
+    ROUTE_COL_DST_IP,
+    ROUTE_COL_DST_PORT
+};
+
+static void AssignU32(duckdb_vector vector, idx_t row, uint32_t value, int valid) {
+    if (valid) {
+        ((uint32_t *)duckdb_vector_get_data(vector))[row] = value;
+    } else {
+        PcapVectorSetNull(vector, row);
+    }
+}
+
+static void AssignIpv4(duckdb_vector vector, idx_t row, const uint8_t *addr) {
+    char text[16];
+    PacketFormatIp(4, addr, text, sizeof(text));
+    duckdb_vector_assign_string_element(vector, row, text);
+}
+
+// Append "addr/len" to a comma-separated text list
+static void AppendPrefix(stream_buffer_t *text, uint8_t ip_version, const uint8_t *addr, uint8_t prefix_len) {
+    char prefix[64];
+    char ip[48];
+    PacketFormatIp(ip_version, addr, ip, sizeof(ip));
+    int written = snprintf(prefix, sizeof(prefix), "%s%s/%u", text->len ? "," : "", ip, prefix_len);
+    StreamBufferAppend(text, (const uint8_t *)prefix, (size_t)written, SIZE_MAX);
+}
+
+// ---------------------------------------------------------------------------
+// BGP
+// ---------------------------------------------------------------------------
+
+enum {
+    BGP_COL_MESSAGE_TYPE = ROUTE_COL_DST_PORT + 1,
+    BGP_COL_ACTION,
+    BGP_COL_AFI,
+    BGP_COL_SAFI,
+    BGP_COL_PREFIX,
+    BGP_COL_PREFIX_LENGTH,
+    BGP_COL_NEXT_HOP,
+    BGP_COL_ORIGIN,
+    BGP_COL_AS_PATH,
+    BGP_COL_ORIGIN_AS,
+    BGP_COL_MED,
+    BGP_COL_LOCAL_PREF,
+    BGP_COL_COMMUNITIES,
+    BGP_COL_LARGE_COMMUNITIES,
+    BGP_COL_PEER_AS,
+    BGP_COL_HOLD_TIME,
+    BGP_COL_BGP_ID,
+    BGP_COL_ERROR_CODE,
+    BGP_COL_ERROR_SUBCODE,
+    BGP_COL_COUNT
+};
+
+// Capabilities learned from the OPEN messages of a session
+typedef struct {
+    uint8_t open_seen[2];
+    uint8_t as4[2];
+} bgp_session_t;
+
+// A run of encoded prefixes within an UPDATE
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    uint16_t afi;
+    uint8_t safi;
+    uint8_t announce;
+    const uint8_t *next_hop;   // announcements only, NULL otherwise
+} bgp_section_t;
+
+// Path attributes of the UPDATE being emitted
+typedef struct {
+    int has_origin;
+    uint8_t origin;
+    int has_as_path;
+    size_t as_path_len;
+    int has_origin_as;
+    uint32_t origin_as;
+    int has_med;
+    uint32_t med;
+    int has_local_pref;
+    uint32_t local_pref;
+    const uint8_t *next_hop;           // NEXT_HOP attribute (IPv4)
+    uint8_t mp_next_hop[16];           // MP_REACH_NLRI next hop
+    uint16_t mp_afi;
+    const uint8_t *communities;
+    size_t communities_len;
+    const uint8_t *large_communities;
+    size_t large_communities_len;
+} bgp_attributes_t;
+
+typedef struct {
+    message_stream_t *stream;
+    hash_map_t sessions;               // flow_key_t -> bgp_session_t
+
+    // UPDATE currently being expanded into prefix rows
+    int in_update;
+    message_t update;
+    bgp_attributes_t attrs;
+    bgp_section_t sections[4];
+    int section_count;
+    int section;
+    size_t offset;
+    uint64_t rows_emitted;
+
+    uint32_t as_path[BGP_MAX_AS_PATH];
+    stream_buffer_t communities_text;
+    stream_buffer_t large_communities_text;
+} bgp_state_t;
+
+static const char *BgpMessageTypeName(uint8_t type) {
+    static const char *names[] = {NULL, "OPEN", "UPDATE", "NOTIFICATION", "KEEPALIVE", "ROUTE_REFRESH"};
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : NULL;
+}
+
+static size_t BgpFrame(const uint8_t *data, size_t avail) {
+    static const uint8_t marker[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    size_t check = avail < sizeof(marker) ? avail : sizeof(marker);
+    if (memcmp(data, marker, check) != 0) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    if (avail < 18) {
+        return 0;
+    }
+    uint16_t length = PacketRead16(data + 16);
+    return length < BGP_HEADER_LEN ? MESSAGE_FRAME_INVALID : length;
+}
+
+static void BgpInitDataFree(void *data) {
+    bgp_state_t *state = (bgp_state_t *)data;
+    if (state) {
+        MessageStreamClose(state->stream);
+        HashMapDestroy(&state->sessions);
+        StreamBufferFree(&state->communities_text);
+        StreamBufferFree(&state->large_communities_text);
+        duckdb_free(state);
+    }
+}
+
+static void BgpInit(duckdb_init_info info) {
+    static const message_protocol_t protocol = {BGP_PORT, 0, BgpFrame, BGP_MAX_MESSAGE};
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    bgp_state_t *state = (bgp_state_t *)duckdb_malloc(sizeof(bgp_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(bgp_state_t));
+    if (!HashMapInit(&state->sessions, sizeof(flow_key_t), sizeof(bgp_session_t))) {
+        BgpInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = MessageStreamOpen(bind->filename, &protocol, &state->stream);
+    if (error) {
+        BgpInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, BgpInitDataFree);
+}
+
+static void BgpBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "message_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "action", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "afi", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "safi", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "prefix", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "prefix_length", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "next_hop", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "origin", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "as_path", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "origin_as", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "med", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "local_pref", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddListColumn(info, "communities", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "large_communities", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "peer_as", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "hold_time", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "bgp_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "error_code", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "error_subcode", DUCKDB_TYPE_UTINYINT);
+}
+
+// Whether an AS_PATH value parses exactly with the given AS number width
+static int AsPathFits(const uint8_t *value, size_t len, size_t width) {
+    size_t offset = 0;
+    while (offset < len) {
+        if (offset + 2 > len || value[offset] < BGP_AS_SET || value[offset] > 4) {
+            return 0;
+        }
+        offset += 2 + (size_t)value[offset + 1] * width;
+    }
+    return offset == len;
+}
+
+// Append the AS numbers of an AS_PATH/AS4_PATH value. AS_SET members are
+// appended in order; confederation segments are local and skipped.
+static void ParseAsPath(bgp_state_t *state, const uint8_t *value, size_t len, size_t width) {
+    bgp_attributes_t *attrs = &state->attrs;
+    size_t offset = 0;
+    while (offset + 2 <= len) {
+        uint8_t segment_type = value[offset];
+        size_t count = value[offset + 1];
+        const uint8_t *asn = value + offset + 2;
+        offset += 2 + count * width;
+        if (offset > len) {
+            break;
+        }
+        if (segment_type != BGP_AS_SET && segment_type != BGP_AS_SEQUENCE) {
+            continue;
+        }
+        for (size_t i = 0; i < count && attrs->as_path_len < BGP_MAX_AS_PATH; i++) {
+            uint32_t as = width == 4 ? PacketRead32(asn + i * 4) : PacketRead16(asn + i * 2);
+            state->as_path[attrs->as_path_len++] = as;
+        }
+        // The origin is the last AS of a path ending in a sequence
+        attrs->has_origin_as = segment_type == BGP_AS_SEQUENCE && count > 0;
+        if (attrs->has_origin_as) {
+            attrs->origin_as = width == 4 ? PacketRead32(asn + (count - 1) * 4) : PacketRead16(asn + (count - 1) * 2);
+        }
+    }
+    attrs->has_as_path = 1;
+}
+
+// Format COMMUNITIES ("asn:value") or LARGE_COMMUNITY ("global:local1:local2")
+static void FormatCommunities(stream_buffer_t *text, const uint8_t *value, size_t len, int large) {
+    char item[48];
+    StreamBufferConsume(text, text->len);
+    size_t size = large ? 12 : 4;
+    for (size_t offset = 0; offset + size <= len; offset += size) {
+        int written;
+        if (large) {
+            written = snprintf(item, sizeof(item), "%s%u:%u:%u", text->len ? "," : "", PacketRead32(value + offset),
+                               PacketRead32(value + offset + 4), PacketRead32(value + offset + 8));
+        } else {
+            written = snprintf(item, sizeof(item), "%s%u:%u", text->len ? "," : "", PacketRead16(value + offset),
+                               PacketRead16(value + offset + 2));
+        }
+        StreamBufferAppend(text, (const uint8_t *)item, (size_t)written, SIZE_MAX);
+    }
+}
+
+static void AddSection(bgp_state_t *state, const uint8_t *data, size_t len, uint16_t afi, uint8_t safi,
+                       int announce) {
+    if (state->section_count >= 4 || (afi != AFI_IPV4 && afi != AFI_IPV6) ||
+        (safi != SAFI_UNICAST && safi != SAFI_MULTICAST)) {
+        return;
+    }
+    bgp_section_t *section = &state->sections[state->section_count++];
+    section->data = data;
+    section->len = len;
+    section->afi = afi;
+    section->safi = safi;
+    section->announce = (uint8_t)announce;
+    section->next_hop = NULL;
+}
+
+// Whether 4-octet AS numbers are in use: known from the session's OPEN
+// messages, otherwise inferred from which width the AS_PATH parses with
+static int SessionUsesAs4(bgp_state_t *state, const message_t *msg, const uint8_t *as_path, size_t len) {
+    bgp_session_t *session = (bgp_session_t *)HashMapFind(&state->sessions, msg->key);
+    if (session && session->open_seen[0] && session->open_seen[1]) {
+        return session->as4[0] && session->as4[1];
+    }
+    return AsPathFits(as_path, len, 4) || !AsPathFits(as_path, len, 2);
+}
+
+// Parse an UPDATE into path attributes and prefix sections
+static void ParseUpdate(bgp_state_t *state, const message_t *msg) {
+    bgp_attributes_t *attrs = &state->attrs;
+    memset(attrs, 0, sizeof(bgp_attributes_t));
+    state->section_count = 0;
+    state->section = 0;
+    state->offset = 0;
+    state->rows_emitted = 0;
+    StreamBufferConsume(&state->communities_text, state->communities_text.len);
+    StreamBufferConsume(&state->large_communities_text, state->large_communities_text.len);
+
+    const uint8_t *body = msg->data + BGP_HEADER_LEN;
+    size_t body_len = msg->len - BGP_HEADER_LEN;
+    if (body_len < 4) {
+        return;
+    }
+    size_t withdrawn_len = PacketRead16(body);
+    if (4 + withdrawn_len > body_len) {
+        return;
+    }
+    size_t attr_len = PacketRead16(body + 2 + withdrawn_len);
+    if (4 + withdrawn_len + attr_len > body_len) {
+        return;
+    }
+    const uint8_t *attributes = body + 4 + withdrawn_len;
+    AddSection(state, body + 2, withdrawn_len, AFI_IPV4, SAFI_UNICAST, 0);
+
+    const uint8_t *as_path = NULL, *as4_path = NULL;
+    size_t as_path_len = 0, as4_path_len = 0;
+    const uint8_t *mp_reach = NULL, *mp_unreach = NULL;
+    size_t mp_reach_len = 0, mp_unreach_len = 0;
+    size_t offset = 0;
+    while (offset + 3 <= attr_len) {
+        uint8_t flags = attributes[offset];
+        uint8_t type = attributes[offset + 1];
+        size_t header = (flags & BGP_ATTR_FLAG_EXTENDED) ? 4 : 3;
+        if (offset + header > attr_len) {
+            break;
+        }
+        size_t len = header == 4 ? PacketRead16(attributes + offset + 2) : attributes[offset + 2];
+        const uint8_t *value = attributes + offset + header;
+        offset += header + len;
+        if (offset > attr_len) {
+            break;
+        }
+        switch (type) {
+        case BGP_ATTR_ORIGIN:
+            attrs->has_origin = len >= 1;
+            attrs->origin = len ? value[0] : 0;
+            break;
+        case BGP_ATTR_AS_PATH:
+            as_path = value;
+            as_path_len = len;
+            break;
+        case BGP_ATTR_NEXT_HOP:
+            attrs->next_hop = len == 4 ? value : NULL;
+            break;
+        case BGP_ATTR_MED:
+            attrs->has_med = len == 4;
+            attrs->med = len == 4 ? PacketRead32(value) : 0;
+            break;
+        case BGP_ATTR_LOCAL_PREF:
+            attrs->has_local_pref = len == 4;
+            attrs->local_pref = len == 4 ? PacketRead32(value) : 0;
+            break;
+        case BGP_ATTR_COMMUNITIES:
+            attrs->communities = value;
+            attrs->communities_len = len;
+            break;
+        case BGP_ATTR_LARGE_COMMUNITIES:
+            attrs->large_communities = value;
+            attrs->large_communities_len = len;
+            break;
+        case BGP_ATTR_MP_REACH:
+            mp_reach = value;
+            mp_reach_len = len;
+            break;
+        case BGP_ATTR_MP_UNREACH:
+            mp_unreach = value;
+            mp_unreach_len = len;
+            break;
+        case BGP_ATTR_AS4_PATH:
+            as4_path = value;
+            as4_path_len = len;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (as_path) {
+        if (SessionUsesAs4(state, msg, as_path, as_path_len)) {
+            ParseAsPath(state, as_path, as_path_len, 4);
+        } else {
+            ParseAsPath(state, as_path, as_path_len, 2);
+            if (as4_path) {
+                // RFC 6793: AS4_PATH replaces the trailing part of a 2-octet
+                // path, so parse it after the 2-octet path and splice it in
+                size_t two_octet_len = attrs->as_path_len;
+                int has_origin_as = attrs->has_origin_as;
+                uint32_t origin_as = attrs->origin_as;
+                ParseAsPath(state, as4_path, as4_path_len, 4);
+                size_t as4_len = attrs->as_path_len - two_octet_len;
+                if (as4_len <= two_octet_len) {
+                    size_t keep = two_octet_len - as4_len;
+                    memmove(state->as_path + keep, state->as_path + two_octet_len, as4_len * sizeof(uint32_t));
+                    attrs->as_path_len = keep + as4_len;
+                } else {
+                    attrs->as_path_len = two_octet_len;
+                    attrs->has_origin_as = has_origin_as;
+                    attrs->origin_as = origin_as;
+                }
+            }
+        }
+    }
+    if (attrs->communities) {
+        FormatCommunities(&state->communities_text, attrs->communities, attrs->communities_len, 0);
+    }
+    if (attrs->large_communities) {
+        FormatCommunities(&state->large_communities_text, attrs->large_communities, attrs->large_communities_len, 1);
+    }
+
+    if (mp_unreach && mp_unreach_len >= 3) {
+        AddSection(state, mp_unreach + 3, mp_unreach_len - 3, PacketRead16(mp_unreach), mp_unreach[2], 0);
+    }
+    // MP_REACH_NLRI: AFI, SAFI, next hop length and address, reserved, NLRI
+    if (mp_reach && mp_reach_len >= 5 && 5 + (size_t)mp_reach[3] <= mp_reach_len) {
+        uint16_t afi = PacketRead16(mp_reach);
+        size_t next_hop_len = mp_reach[3];
+        int before = state->section_count;
+        AddSection(state, mp_reach + 5 + next_hop_len, mp_reach_len - 5 - next_hop_len, afi, mp_reach[2], 1);
+        // An IPv6 next hop may be followed by a link-local address
+        size_t address_len = afi == AFI_IPV6 ? 16 : 4;
+        if (state->section_count > before && next_hop_len >= address_len) {
+            memcpy(attrs->mp_next_hop, mp_reach + 4, address_len);
+            attrs->mp_afi = afi;
+            state->sections[before].next_hop = attrs->mp_next_hop;
+        }
+    }
+    size_t nlri_offset = 4 + withdrawn_len + attr_len;
+    int before = state->section_count;
+    AddSection(state, body + nlri_offset, body_len - nlri_offset, AFI_IPV4, SAFI_UNICAST, 1);
+    if (state->section_count > before) {
+        state->sections[before].next_hop = attrs->next_hop;
+    }
+}
+
+static void BgpOpenSeen(bgp_state_t *state, const message_t *msg, uint32_t *peer_as) {
+    const uint8_t *body = msg->data + BGP_HEADER_LEN;
+    size_t body_len = msg->len - BGP_HEADER_LEN;
+    *peer_as = PacketRead16(body + 1);
+    int as4 = 0;
+
+    // Optional parameters; type 2 holds capabilities
+    size_t params_len = body[9];
+    size_t offset = 10;
+    size_t end = 10 + params_len < body_len ? 10 + params_len : body_len;
+    while (offset + 2 <= end) {
+        uint8_t param_type = body[offset];
+        size_t param_len = body[offset + 1];
+        const uint8_t *param = body + offset + 2;
+        offset += 2 + param_len;
+        if (offset > end || param_type != 2) {
+            continue;
+        }
+        for (size_t cap = 0; cap + 2 <= param_len;) {
+            uint8_t code = param[cap];
+            size_t cap_len = param[cap + 1];
+            if (cap + 2 + cap_len > param_len) {
+                break;
+            }
+            if (code == BGP_CAPABILITY_AS4 && cap_len == 4) {
+                as4 = 1;
+                *peer_as = PacketRead32(param + cap + 2);
+            }
+            cap += 2 + cap_len;
+        }
+    }
+
+    int is_new;
+    bgp_session_t *session = (bgp_session_t *)HashMapInsert(&state->sessions, msg->key, &is_new);
+    if (session) {
+        session->open_seen[msg->direction] = 1;
+        session->as4[msg->direction] = (uint8_t)as4;
+    }
+}
+
+static void BgpAssignCommon(duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    char addr[64];
+    uint16_t port;
+    ((uint64_t *)duckdb_vector_get_data(vectors[ROUTE_COL_TIMESTAMP]))[row] = msg->timestamp_ns;
+    FlowFormatEndpoint(msg->key, msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[ROUTE_COL_SRC_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[ROUTE_COL_SRC_PORT]))[row] = port;
+    FlowFormatEndpoint(msg->key, 1 - msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[ROUTE_COL_DST_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[ROUTE_COL_DST_PORT]))[row] = port;
+    PcapVectorAssignString(vectors[BGP_COL_MESSAGE_TYPE], row, BgpMessageTypeName(msg->data[18]));
+}
+
+// Null every column from first to last
+static void SetNullRange(duckdb_vector *vectors, idx_t row, int first, int last) {
+    for (int i = first; i <= last; i++) {
+        PcapVectorSetNull(vectors[i], row);
+    }
+}
+
+// Row for a message without prefixes
+static void BgpEmitMessage(bgp_state_t *state, duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    uint8_t type = msg->data[18];
+    const uint8_t *body = msg->data + BGP_HEADER_LEN;
+    size_t body_len = msg->len - BGP_HEADER_LEN;
+
+    BgpAssignCommon(vectors, row, msg);
+    SetNullRange(vectors, row, BGP_COL_ACTION, BGP_COL_LARGE_COMMUNITIES);
+    if (type == BGP_OPEN && body_len >= 10) {
+        uint32_t peer_as;
+        BgpOpenSeen(state, msg, &peer_as);
+        ((uint32_t *)duckdb_vector_get_data(vectors[BGP_COL_PEER_AS]))[row] = peer_as;
+        ((uint16_t *)duckdb_vector_get_data(vectors[BGP_COL_HOLD_TIME]))[row] = PacketRead16(body + 3);
+        AssignIpv4(vectors[BGP_COL_BGP_ID], row, body + 5);
+    } else {
+        SetNullRange(vectors, row, BGP_COL_PEER_AS, BGP_COL_BGP_ID);
+    }
+    if (type == BGP_NOTIFICATION && body_len >= 2) {
+        ((uint8_t *)duckdb_vector_get_data(vectors[BGP_COL_ERROR_CODE]))[row] = body[0];
+        ((uint8_t *)duckdb_vector_get_data(vectors[BGP_COL_ERROR_SUBCODE]))[row] = body[1];
+    } else {
+        SetNullRange(vectors, row, BGP_COL_ERROR_CODE, BGP_COL_ERROR_SUBCODE);
+    }
+}
+
+static const char *BgpOriginName(uint8_t origin) {
+    static const char *names[] = {"IGP", "EGP", "INCOMPLETE"};
+    return origin < 3 ? names[origin] : NULL;
+}
+
+// Emit the next prefix of the current UPDATE. Returns 0 once all prefixes
+// have been emitted.
+static int BgpEmitPrefix(bgp_state_t *state, duckdb_vector *vectors, idx_t row) {
+    const bgp_attributes_t *attrs = &state->attrs;
+    while (state->section < state->section_count) {
+        const bgp_section_t *section = &state->sections[state->section];
+        if (state->offset >= section->len) {
+            state->section++;
+            state->offset = 0;
+            continue;
+        }
+        const uint8_t *p = section->data + state->offset;
+        uint8_t prefix_len = p[0];
+        size_t max_len = section->afi == AFI_IPV6 ? 128 : 32;
+        size_t prefix_bytes = ((size_t)prefix_len + 7) / 8;
+        if (prefix_len > max_len || state->offset + 1 + prefix_bytes > section->len) {
+            // Malformed (or ADD-PATH encoded) NLRI: skip the rest of the section
+            state->section++;
+            state->offset = 0;
+            continue;
+        }
+        state->offset += 1 + prefix_bytes;
+
+        uint8_t ip_version = section->afi == AFI_IPV6 ? 6 : 4;
+        uint8_t addr[16];
+        char text[64];
+        memset(addr, 0, sizeof(addr));
+        memcpy(addr, p + 1, prefix_bytes);
+        PacketFormatIp(ip_version, addr, text, sizeof(text) - 5);
+        snprintf(text + strlen(text), 5, "/%u", prefix_len);
+
+        const message_t *msg = &state->update;
+        BgpAssignCommon(vectors, row, msg);
+        duckdb_vector_assign_string_element(vectors[BGP_COL_ACTION], row, section->announce ? "announce" : "withdraw");
+        ((uint16_t *)duckdb_vector_get_data(vectors[BGP_COL_AFI]))[row] = section->afi;
+        ((uint8_t *)duckdb_vector_get_data(vectors[BGP_COL_SAFI]))[row] = section->safi;
+        duckdb_vector_assign_string_element(vectors[BGP_COL_PREFIX], row, text);
+        ((uint8_t *)duckdb_vector_get_data(vectors[BGP_COL_PREFIX_LENGTH]))[row] = prefix_len;
+
+        if (section->announce) {
+            if (section->next_hop) {
+                uint8_t next_hop_version = section->next_hop == attrs->mp_next_hop && attrs->mp_afi == AFI_IPV6 ? 6 : 4;
+                PacketFormatIp(next_hop_version, section->next_hop, text, sizeof(text));
+                duckdb_vector_assign_string_element(vectors[BGP_COL_NEXT_HOP], row, text);
+            } else {
+                PcapVectorSetNull(vectors[BGP_COL_NEXT_HOP], row);
+            }
+            PcapVectorAssignString(vectors[BGP_COL_ORIGIN], row, attrs->has_origin ? BgpOriginName(attrs->origin) : NULL);
+            if (attrs->has_as_path) {
+                PcapListAssignU32(vectors[BGP_COL_AS_PATH], row, state->as_path, attrs->as_path_len);
+            } else {
+                PcapVectorSetNull(vectors[BGP_COL_AS_PATH], row);
+            }
+            AssignU32(vectors[BGP_COL_ORIGIN_AS], row, attrs->origin_as, attrs->has_origin_as);
+            AssignU32(vectors[BGP_COL_MED], row, attrs->med, attrs->has_med);
+            AssignU32(vectors[BGP_COL_LOCAL_PREF], row, attrs->local_pref, attrs->has_local_pref);
+            if (attrs->communities) {
+                PcapListAssignSplit(vectors[BGP_COL_COMMUNITIES], row, (const char *)state->communities_text.data,
+                                    state->communities_text.len, ',');
+            } else {
+                PcapVectorSetNull(vectors[BGP_COL_COMMUNITIES], row);
+            }
+            if (attrs->large_communities) {
+                PcapListAssignSplit(vectors[BGP_COL_LARGE_COMMUNITIES], row,
+                                    (const char *)state->large_communities_text.data,
+                                    state->large_communities_text.len, ',');
+            } else {
+                PcapVectorSetNull(vectors[BGP_COL_LARGE_COMMUNITIES], row);
+            }
+        } else {
+            SetNullRange(vectors, row, BGP_COL_NEXT_HOP, BGP_COL_LARGE_COMMUNITIES);
+        }
+        SetNullRange(vectors, row, BGP_COL_PEER_AS, BGP_COL_ERROR_SUBCODE);
+        state->rows_emitted++;
+        return 1;
+    }
+
+    // An UPDATE without prefixes (such as End-of-RIB) still gets a row
+    if (state->rows_emitted == 0) {
+        BgpEmitMessage(state, vectors, row, &state->update);
+        state->rows_emitted++;
+        return 1;
+    }
+    return 0;
+}
+
+static void BgpFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    bgp_state_t *state = (bgp_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[BGP_COL_COUNT];
+    for (idx_t i = 0; i < BGP_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    message_t msg;
+    while (row_count < max_rows) {
+        if (state->in_update) {
+            if (BgpEmitPrefix(state, vectors, row_count)) {
+                row_count++;
+                continue;
+            }
+            state->in_update = 0;
+        }
+        // The current UPDATE's bytes stay valid until the stream advances
+        if (!MessageStreamNext(state->stream, &msg)) {
+            break;
+        }
+        if (msg.data[18] == BGP_UPDATE) {
+            state->update = msg;
+            state->in_update = 1;
+            ParseUpdate(state, &state->update);
+        } else {
+            BgpEmitMessage(state, vectors, row_count++, &msg);
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+// ---------------------------------------------------------------------------
+// OSPF
+// ---------------------------------------------------------------------------
+
+enum {
+    OSPF_COL_TIMESTAMP,
+    OSPF_COL_SRC_IP,
+    OSPF_COL_DST_IP,
+    OSPF_COL_VERSION,
+    OSPF_COL_PACKET_TYPE,
+    OSPF_COL_ROUTER_ID,
+    OSPF_COL_AREA_ID,
+    OSPF_COL_HELLO_INTERVAL,
+    OSPF_COL_DEAD_INTERVAL,
+    OSPF_COL_DESIGNATED_ROUTER,
+    OSPF_COL_BACKUP_DESIGNATED_ROUTER,
+    OSPF_COL_NEIGHBORS,
+    OSPF_COL_LSA_TYPE,
+    OSPF_COL_LSA_TYPE_NAME,
+    OSPF_COL_LINK_STATE_ID,
+    OSPF_COL_ADVERTISING_ROUTER,
+    OSPF_COL_LSA_SEQUENCE,
+    OSPF_COL_LSA_AGE,
+    OSPF_COL_PREFIXES,
+    OSPF_COL_METRIC,
+    OSPF_COL_COUNT
+};
+
+typedef struct {
+    pcap_source_t *source;
+
+    // Link State Update whose LSAs are being emitted
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    const uint8_t *lsa;
+    size_t lsa_remaining;
+    uint32_t lsa_count;
+
+    stream_buffer_t text;
+} ospf_state_t;
+
+static const char *OspfPacketTypeName(uint8_t type) {
+    static const char *names[] = {NULL, "hello", "database_description", "ls_request", "ls_update", "ls_ack"};
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : NULL;
+}
+
+static const char *OspfLsaTypeName(uint8_t version, uint16_t type) {
+    if (version == 2) {
+        switch (type) {
+        case 1: return "router";
+        case 2: return "network";
+        case 3: return "summary_network";
+        case 4: return "summary_asbr";
+        case 5: return "as_external";
+        case 7: return "nssa_external";
+        case 9: return "opaque_link";
+        case 10: return "opaque_area";
+        case 11: return "opaque_as";
+        default: return NULL;
+        }
+    }
+    // OSPFv3 function code (RFC 5340 A.4.2.1)
+    switch (type & 0x1FFF) {
+    case 1: return "router";
+    case 2: return "network";
+    case 3: return "inter_area_prefix";
+    case 4: return "inter_area_router";
+    case 5: return "as_external";
+    case 7: return "nssa";
+    case 8: return "link";
+    case 9: return "intra_area_prefix";
+    default: return NULL;
+    }
+}
+
+static void OspfInitDataFree(void *data) {
+    ospf_state_t *state = (ospf_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        StreamBufferFree(&state->text);
+        duckdb_free(state);
+    }
+}
+
+static void OspfInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    ospf_state_t *state = (ospf_state_t *)duckdb_malloc(sizeof(ospf_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(ospf_state_t));
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        OspfInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, OspfInitDataFree);
+}
+
+static void OspfBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "version", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "packet_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "router_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "area_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hello_interval", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dead_interval", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "designated_router", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "backup_designated_router", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "neighbors", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "lsa_type", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "lsa_type_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "link_state_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "advertising_router", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "lsa_sequence", DUCKDB_TYPE_INTEGER);
+    PcapBindAddColumn(info, "lsa_age", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddListColumn(info, "prefixes", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "metric", DUCKDB_TYPE_UINTEGER);
+}
+
+static size_t OspfHeaderLen(uint8_t version) {
+    return version == 2 ? OSPFV2_HEADER_LEN : OSPFV3_HEADER_LEN;
+}
+
+static void OspfAssignPacket(duckdb_vector *vectors, idx_t row, const ospf_state_t *state) {
+    const packet_info_t *pkt = &state->pkt;
+    const uint8_t *ospf = pkt->payload;
+    char addr[64];
+
+    ((uint64_t *)duckdb_vector_get_data(vectors[OSPF_COL_TIMESTAMP]))[row] = state->packet.timestamp_ns;
+    PacketFormatIp(pkt->ip_version, pkt->src_ip, addr, sizeof(addr));
+    duckdb_vector_assign_string_element(vectors[OSPF_COL_SRC_IP], row, addr);
+    PacketFormatIp(pkt->ip_version, pkt->dst_ip, addr, sizeof(addr));
+    duckdb_vector_assign_string_element(vectors[OSPF_COL_DST_IP], row, addr);
+    ((uint8_t *)duckdb_vector_get_data(vectors[OSPF_COL_VERSION]))[row] = ospf[0];
+    PcapVectorAssignString(vectors[OSPF_COL_PACKET_TYPE], row, OspfPacketTypeName(ospf[1]));
+    AssignIpv4(vectors[OSPF_COL_ROUTER_ID], row, ospf + 4);
+    AssignIpv4(vectors[OSPF_COL_AREA_ID], row, ospf + 8);
+}
+
+static void OspfAssignHello(duckdb_vector *vectors, idx_t row, const uint8_t *ospf, size_t len) {
+    uint8_t version = ospf[0];
+    const uint8_t *body = ospf + OspfHeaderLen(version);
+    size_t body_len = len - OspfHeaderLen(version);
+    // v2: mask, hello interval, options, priority, dead interval, DR, BDR
+    // v3: interface id, priority, options, hello interval, dead interval, DR, BDR
+    size_t fixed = 20;
+    if (body_len < fixed) {
+        SetNullRange(vectors, row, OSPF_COL_HELLO_INTERVAL, OSPF_COL_NEIGHBORS);
+        return;
+    }
+    uint16_t hello_interval = version == 2 ? PacketRead16(body + 4) : PacketRead16(body + 8);
+    uint32_t dead_interval = version == 2 ? PacketRead32(body + 8) : PacketRead16(body + 10);
+    ((uint16_t *)duckdb_vector_get_data(vectors[OSPF_COL_HELLO_INTERVAL]))[row] = hello_interval;
+    ((uint32_t *)duckdb_vector_get_data(vectors[OSPF_COL_DEAD_INTERVAL]))[row] = dead_interval;
+    AssignIpv4(vectors[OSPF_COL_DESIGNATED_ROUTER], row, body + 12);
+    AssignIpv4(vectors[OSPF_COL_BACKUP_DESIGNATED_ROUTER], row, body + 16);
+
+    char neighbors[1024];
+    size_t neighbors_len = 0;
+    for (size_t offset = fixed; offset + 4 <= body_len && neighbors_len + 17 < sizeof(neighbors); offset += 4) {
+        if (neighbors_len) {
+            neighbors[neighbors_len++] = ',';
+        }
+        PacketFormatIp(4, body + offset, neighbors + neighbors_len, sizeof(neighbors) - neighbors_len);
+        neighbors_len += strlen(neighbors + neighbors_len);
+    }
+    PcapListAssignSplit(vectors[OSPF_COL_NEIGHBORS], row, neighbors, neighbors_len, ',');
+}
+
+// Prefix with the v2 (address, mask) encoding
+static void AppendMaskedPrefix(stream_buffer_t *text, const uint8_t *addr, const uint8_t *mask) {
+    uint32_t mask_bits = PacketRead32(mask);
+    uint8_t prefix_len = 0;
+    while (prefix_len < 32 && (mask_bits & (0x80000000u >> prefix_len))) {
+        prefix_len++;
+    }
+    uint8_t network[16];
+    memset(network, 0, sizeof(network));
+    for (int i = 0; i < 4; i++) {
+        network[i] = addr[i] & mask[i];
+    }
+    AppendPrefix(text, 4, network, prefix_len);
+}
+
+// OSPFv3 address prefix (RFC 5340 A.4.1): length, options, 16-bit field,
+// then the prefix padded to 32-bit words. Returns the encoded size or 0.
+static size_t AppendV3Prefix(stream_buffer_t *text, const uint8_t *p, size_t len) {
+    if (len < 4 || p[0] > 128) {
+        return 0;
+    }
+    size_t words = ((size_t)p[0] + 31) / 32;
+    if (4 + words * 4 > len) {
+        return 0;
+    }
+    uint8_t addr[16];
+    memset(addr, 0, sizeof(addr));
+    memcpy(addr, p + 4, words * 4);
+    AppendPrefix(text, 6, addr, p[0]);
+    return 4 + words * 4;
+}
+
+// Collect the prefixes an LSA advertises. Returns 1 and sets *metric when
+// the LSA carries a single metric.
+static int OspfLsaPrefixes(stream_buffer_t *text, uint8_t version, uint16_t type, const uint8_t *lsa, size_t len,
+                           uint32_t *metric) {
+    const uint8_t *body = lsa + OSPF_LSA_HEADER_LEN;
+    size_t body_len = len - OSPF_LSA_HEADER_LEN;
+    StreamBufferConsume(text, text->len);
+
+    if (version == 2) {
+        switch (type) {
+        case 1: {
+            // Router LSA: stub network links (type 3) are the attached prefixes
+            if (body_len < 4) {
+                return 0;
+            }
+            size_t links = PacketRead16(body + 2);
+            size_t offset = 4;
+            for (size_t i = 0; i < links && offset + 12 <= body_len; i++) {
+                if (body[offset + 8] == 3) {
+                    AppendMaskedPrefix(text, body + offset, body + offset + 4);
+                }
+                offset += 12 + (size_t)body[offset + 9] * 4;
+            }
+            return 0;
+        }
+        case 2:
+            if (body_len >= 4) {
+                AppendMaskedPrefix(text, lsa + 4, body);
+            }
+            return 0;
+        case 3:
+        case 5:
+        case 7:
+            if (body_len < 8) {
+                return 0;
+            }
+            AppendMaskedPrefix(text, lsa + 4, body);
+            *metric = PacketRead32(body + 4) & 0xFFFFFF;
+            return 1;
+        case 4:
+            if (body_len < 8) {
+                return 0;
+            }
+            *metric = PacketRead32(body + 4) & 0xFFFFFF;
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    switch (type & 0x1FFF) {
+    case 3:  // inter-area-prefix: metric, prefix
+    case 5:  // AS-external: flags and metric, prefix
+    case 7:
+        if (body_len < 4) {
+            return 0;
+        }
+        *metric = PacketRead32(body) & 0xFFFFFF;
+        AppendV3Prefix(text, body + 4, body_len - 4);
+        return 1;
+    case 8: {
+        // Link LSA: priority, options, link-local address, prefix count
+        if (body_len < 24) {
+            return 0;
+        }
+        uint32_t count = PacketRead32(body + 20);
+        size_t offset = 24;
+        for (uint32_t i = 0; i < count; i++) {
+            size_t used = AppendV3Prefix(text, body + offset, body_len - offset);
+            if (!used) {
+                break;
+            }
+            offset += used;
+        }
+        return 0;
+    }
+    case 9: {
+        // Intra-area-prefix: count, referenced LSA, prefixes
+        if (body_len < 12) {
+            return 0;
+        }
+        uint16_t count = PacketRead16(body);
+        size_t offset = 12;
+        for (uint16_t i = 0; i < count; i++) {
+            size_t used = AppendV3Prefix(text, body + offset, body_len - offset);
+            if (!used) {
+                break;
+            }
+            offset += used;
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+static void OspfAssignLsa(ospf_state_t *state, duckdb_vector *vectors, idx_t row, const uint8_t *lsa, size_t len) {
+    uint8_t version = state->pkt.payload[0];
+    uint16_t type = version == 2 ? lsa[3] : PacketRead16(lsa + 2);
+    ((uint16_t *)duckdb_vector_get_data(vectors[OSPF_COL_LSA_TYPE]))[row] = type;
+    PcapVectorAssignString(vectors[OSPF_COL_LSA_TYPE_NAME], row, OspfLsaTypeName(version, type));
+    AssignIpv4(vectors[OSPF_COL_LINK_STATE_ID], row, lsa + 4);
+    AssignIpv4(vectors[OSPF_COL_ADVERTISING_ROUTER], row, lsa + 8);
+    ((int32_t *)duckdb_vector_get_data(vectors[OSPF_COL_LSA_SEQUENCE]))[row] = (int32_t)PacketRead32(lsa + 12);
+    ((uint16_t *)duckdb_vector_get_data(vectors[OSPF_COL_LSA_AGE]))[row] = PacketRead16(lsa);
+
+    uint32_t metric = 0;
+    int has_metric = OspfLsaPrefixes(&state->text, version, type, lsa, len, &metric);
+    PcapListAssignSplit(vectors[OSPF_COL_PREFIXES], row, (const char *)state->text.data, state->text.len, ',');
+    AssignU32(vectors[OSPF_COL_METRIC], row, metric, has_metric);
+}
+
+// Emit the next LSA of the current Link State Update. Returns 0 when done.
+static int OspfEmitLsa(ospf_state_t *state, duckdb_vector *vectors, idx_t row) {
+    if (!state->lsa_count || state->lsa_remaining < OSPF_LSA_HEADER_LEN) {
+        state->lsa_count = 0;
+        return 0;
+    }
+    const uint8_t *lsa = state->lsa;
+    size_t len = PacketRead16(lsa + 18);
+    if (len < OSPF_LSA_HEADER_LEN || len > state->lsa_remaining) {
+        state->lsa_count = 0;
+        return 0;
+    }
+    state->lsa += len;
+    state->lsa_remaining -= len;
+    state->lsa_count--;
+
+    OspfAssignPacket(vectors, row, state);
+    SetNullRange(vectors, row, OSPF_COL_HELLO_INTERVAL, OSPF_COL_NEIGHBORS);
+    OspfAssignLsa(state, vectors, row, lsa, len);
+    return 1;
+}
+
+static void OspfFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    ospf_state_t *state = (ospf_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[OSPF_COL_COUNT];
+    for (idx_t i = 0; i < OSPF_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    while (row_count < max_rows) {
+        if (state->lsa_count) {
+            if (OspfEmitLsa(state, vectors, row_count)) {
+                row_count++;
+            }
+            continue;
+        }
+        if (!PcapSourceNext(state->source, &state->packet)) {
+            break;
+        }
+        packet_info_t *pkt = &state->pkt;
+        if (!PacketDecode(state->packet.link_type, state->packet.data, state->packet.capture_len, pkt) ||
+            pkt->ip_proto != IPPROTO_NUM_OSPF || pkt->is_fragment || !pkt->payload || pkt->payload_len < 4) {
+            continue;
+        }
+        const uint8_t *ospf = pkt->payload;
+        uint8_t version = ospf[0];
+        size_t len = PacketRead16(ospf + 2);
+        if ((version != 2 && version != 3) || len < OspfHeaderLen(version) || len > pkt->payload_len) {
+            continue;
+        }
+
+        if (ospf[1] == OSPF_LS_UPDATE && len >= OspfHeaderLen(version) + 4) {
+            // One row per LSA
+            const uint8_t *body = ospf + OspfHeaderLen(version);
+            state->lsa_count = PacketRead32(body);
+            state->lsa = body + 4;
+            state->lsa_remaining = len - OspfHeaderLen(version) - 4;
+            continue;
+        }
+
+        OspfAssignPacket(vectors, row_count, state);
+        if (ospf[1] == OSPF_HELLO) {
+            OspfAssignHello(vectors, row_count, ospf, len);
+        } else {
+            SetNullRange(vectors, row_count, OSPF_COL_HELLO_INTERVAL, OSPF_COL_NEIGHBORS);
+        }
+        SetNullRange(vectors, row_count, OSPF_COL_LSA_TYPE, OSPF_COL_METRIC);
+        row_count++;
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterBgpFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_bgp", BgpBind, BgpInit, BgpFunction);
+}
+
+void RegisterOspfFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_ospf", OspfBind, OspfInit, OspfFunction);
+}
@@ -0,0 +1,515 @@
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "scan_detection.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// ICMP echo requests
+#define ICMP_ECHO_REQUEST 8
+#define ICMPV6_ECHO_REQUEST 128
+
+typedef enum {
+    SCAN_ALERT_PORT_SCAN,
+    SCAN_ALERT_HOST_SWEEP,
+    SCAN_ALERT_SYN_FLOOD
+} scan_alert_t;
+
+static const char *const scan_alert_names[] = {"port_scan", "host_sweep", "syn_flood"};
+
+typedef struct {
+    uint8_t registers[SCAN_HLL_REGISTERS];
+} hll_t;
+
+// A tracked address: a probing source, or the destination of SYNs. The
+// sliding window is made of two panes of half a window each, with their own
+// counts and sketches indexed by pane parity; the window is their union.
+typedef struct {
+    uint64_t pane;            // pane of the latest packet (timestamp / pane length)
+    uint64_t first_ns;        // alert episode in progress
+    uint64_t last_ns;
+    uint64_t probes;
+    uint32_t counts[2];
+    uint32_t peak[2];         // largest window estimates during the episode
+    hll_t sketches[2][2];     // [pane parity][0: hosts or sources, 1: ports]
+    uint8_t used;
+    uint8_t active;
+    uint8_t ip_version;
+    uint8_t addr[16];
+} scan_slot_t;
+
+// One finished episode
+typedef struct {
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t probes;
+    uint32_t peak[2];
+    uint8_t alert;
+    uint8_t ip_version;
+    uint8_t addr[16];
+} scan_row_t;
+
+typedef struct {
+    char *filename;
+    uint64_t pane_ns;
+    uint64_t scan_threshold;
+    uint64_t flood_threshold;
+} scan_bind_t;
+
+typedef struct {
+    const scan_bind_t *bind;
+    pcap_source_t *source;
+    scan_slot_t *sources;
+    scan_slot_t *targets;
+    int draining;             // end of capture: open episodes are being ended
+    size_t drain_position;    // next slot, targets first
+    int done;
+
+    // Rows not yet emitted
+    stream_buffer_t rows;     // scan_row_t
+    size_t row_next;
+} scan_state_t;
+
+enum {
+    SCAN_COL_ALERT,
+    SCAN_COL_FIRST_TIMESTAMP,
+    SCAN_COL_LAST_TIMESTAMP,
+    SCAN_COL_SRC_IP,
+    SCAN_COL_DST_IP,
+    SCAN_COL_PROBES,
+    SCAN_COL_DISTINCT_HOSTS,
+    SCAN_COL_DISTINCT_PORTS,
+    SCAN_COL_DISTINCT_SOURCES,
+    SCAN_COL_COUNT
+};
+
+// ---------------------------------------------------------------------------
+// HyperLogLog
+// ---------------------------------------------------------------------------
+
+// The low bits of the hash pick a register, which keeps the largest
+// position of the lowest set bit among the rest. Returns 1 when the
+// register grew (and so the estimate may have changed).
+static int HllAdd(hll_t *hll, uint64_t hash) {
+    uint32_t index = (uint32_t)(hash % SCAN_HLL_REGISTERS);
+    uint64_t rest = hash / SCAN_HLL_REGISTERS;
+    uint8_t rank = 1;
+    while (!(rest & 1) && rank < 58) {
+        rest >>= 1;
+        rank++;
+    }
+    if (rank <= hll->registers[index]) {
+        return 0;
+    }
+    hll->registers[index] = rank;
+    return 1;
+}
+
+// ln(x) for x >= 1, from ln(x) = k ln 2 + 2 atanh((m - 1) / (m + 1)) with
+// m in [1, 2)
+static double NaturalLog(double x) {
+    int octaves = 0;
+    while (x >= 2) {
+        x /= 2;
+        octaves++;
+    }
+    double z = (x - 1) / (x + 1);
+    double term = z;
+    double sum = 0;
+    for (int i = 1; i < 40; i += 2) {
+        sum += term / i;
+        term *= z * z;
+    }
+    return octaves * 0.6931471805599453 + 2 * sum;
+}
+
+// Distinct count of the union of two sketches
+static uint32_t HllUnionEstimate(const hll_t *a, const hll_t *b) {
+    double sum = 0;
+    uint32_t zeros = 0;
+    for (uint32_t i = 0; i < SCAN_HLL_REGISTERS; i++) {
+        uint8_t rank = a->registers[i] > b->registers[i] ? a->registers[i] : b->registers[i];
+        sum += 1.0 / (double)(1ULL << rank);
+        zeros += rank == 0;
+    }
+    double m = SCAN_HLL_REGISTERS;
+    double estimate = 0.709 * m * m / sum;
+    if (estimate <= 2.5 * m && zeros) {
+        // Linear counting over the empty registers
+        estimate = m * NaturalLog(m / zeros);
+    }
+    return (uint32_t)(estimate + 0.5);
+}
+
+// ---------------------------------------------------------------------------
+// Tracking
+// ---------------------------------------------------------------------------
+
+static void PushRow(scan_state_t *state, const scan_slot_t *slot, scan_alert_t alert) {
+    scan_row_t row;
+    memset(&row, 0, sizeof(row));
+    row.first_ns = slot->first_ns;
+    row.last_ns = slot->last_ns;
+    row.probes = slot->probes;
+    row.peak[0] = slot->peak[0];
+    row.peak[1] = slot->peak[1];
+    row.alert = (uint8_t)alert;
+    row.ip_version = slot->ip_version;
+    memcpy(row.addr, slot->addr, sizeof(row.addr));
+    StreamBufferAppend(&state->rows, (const uint8_t *)&row, sizeof(row), SIZE_MAX);
+}
+
+static void EndEpisode(scan_state_t *state, scan_slot_t *slot, int is_target) {
+    if (!slot->active) {
+        return;
+    }
+    scan_alert_t alert = SCAN_ALERT_SYN_FLOOD;
+    if (!is_target) {
+        alert = slot->peak[1] >= state->bind->scan_threshold ? SCAN_ALERT_PORT_SCAN : SCAN_ALERT_HOST_SWEEP;
+    }
+    PushRow(state, slot, alert);
+    slot->active = 0;
+}
+
+// Whether the window holds enough to alert on: distinct hosts or ports
+// probed by a source, or SYNs sent to a target
+static int WindowOver(const scan_state_t *state, const scan_slot_t *slot, int is_target) {
+    if (is_target) {
+        return (uint64_t)slot->counts[0] + slot->counts[1] >= state->bind->flood_threshold;
+    }
+    uint64_t threshold = state->bind->scan_threshold;
+    return HllUnionEstimate(&slot->sketches[0][0], &slot->sketches[1][0]) >= threshold ||
+           HllUnionEstimate(&slot->sketches[0][1], &slot->sketches[1][1]) >= threshold;
+}
+
+static void UpdatePeaks(scan_slot_t *slot, int is_target) {
+    for (int i = 0; i < (is_target ? 1 : 2); i++) {
+        uint32_t estimate = HllUnionEstimate(&slot->sketches[0][i], &slot->sketches[1][i]);
+        slot->peak[i] = estimate > slot->peak[i] ? estimate : slot->peak[i];
+    }
+}
+
+// Move a slot's window forward to pane, ending its episode when what is left
+// of the window no longer reaches the threshold
+static void AdvancePane(scan_state_t *state, scan_slot_t *slot, uint64_t pane, int is_target) {
+    if (pane <= slot->pane) {
+        return;
+    }
+    if (pane - slot->pane >= 2) {
+        memset(slot->counts, 0, sizeof(slot->counts));
+        memset(slot->sketches, 0, sizeof(slot->sketches));
+    } else {
+        slot->counts[pane & 1] = 0;
+        memset(slot->sketches[pane & 1], 0, sizeof(slot->sketches[pane & 1]));
+    }
+    slot->pane = pane;
+    if (slot->active && !WindowOver(state, slot, is_target)) {
+        EndEpisode(state, slot, is_target);
+    }
+}
+
+// Slot of an address, taking the least recently active one in its set when
+// the address is not tracked
+static scan_slot_t *FindSlot(scan_state_t *state, scan_slot_t *table, size_t slots, const packet_info_t *pkt,
+                             const uint8_t *addr, uint64_t pane, int is_target) {
+    size_t addr_len = pkt->ip_version == 4 ? 4 : 16;
+    uint8_t key[17];
+    memset(key, 0, sizeof(key));
+    key[0] = pkt->ip_version;
+    memcpy(key + 1, addr, addr_len);
+    size_t set = (size_t)(HashBytes(key, sizeof(key)) % (slots / SCAN_WAYS));
+    scan_slot_t *ways = table + set * SCAN_WAYS;
+    scan_slot_t *victim = NULL;
+    for (size_t i = 0; i < SCAN_WAYS; i++) {
+        scan_slot_t *slot = &ways[i];
+        if (slot->used && slot->ip_version == key[0] && memcmp(slot->addr, key + 1, 16) == 0) {
+            AdvancePane(state, slot, pane, is_target);
+            return slot;
+        }
+        if (!victim || (victim->used && (!slot->used || slot->pane < victim->pane))) {
+            victim = slot;
+        }
+    }
+    EndEpisode(state, victim, is_target);
+    memset(victim, 0, sizeof(scan_slot_t));
+    victim->used = 1;
+    victim->ip_version = key[0];
+    memcpy(victim->addr, key + 1, 16);
+    victim->pane = pane;
+    return victim;
+}
+
+// Count a probe into the current pane. changed tells whether a sketch grew;
+// distinct counts are only estimated again when one did.
+static void CountProbe(scan_state_t *state, scan_slot_t *slot, uint64_t timestamp_ns, int changed,
+                       int is_target) {
+    slot->counts[slot->pane & 1]++;
+    if (slot->active) {
+        slot->probes++;
+        slot->last_ns = timestamp_ns;
+        if (changed) {
+            UpdatePeaks(slot, is_target);
+        }
+        return;
+    }
+    if ((is_target || changed) && WindowOver(state, slot, is_target)) {
+        slot->active = 1;
+        slot->first_ns = slot->last_ns = timestamp_ns;
+        slot->probes = (uint64_t)slot->counts[0] + slot->counts[1];
+        UpdatePeaks(slot, is_target);
+    }
+}
+
+static void ProcessPacket(scan_state_t *state, uint64_t timestamp_ns, const packet_info_t *pkt) {
+    int syn = 0;
+    int has_port = 1;
+    switch (pkt->ip_proto) {
+    case IPPROTO_NUM_TCP:
+        syn = (pkt->tcp_flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == TCP_FLAG_SYN;
+        if (!syn) {
+            return;
+        }
+        break;
+    case IPPROTO_NUM_UDP:
+        // Datagrams towards the lower port: requests rather than replies
+        if (pkt->dst_port >= pkt->src_port) {
+            return;
+        }
+        break;
+    case IPPROTO_NUM_ICMP:
+    case IPPROTO_NUM_ICMPV6:
+        if (!pkt->l4 || pkt->l4_len < 1 ||
+            pkt->l4[0] != (pkt->ip_proto == IPPROTO_NUM_ICMP ? ICMP_ECHO_REQUEST : ICMPV6_ECHO_REQUEST)) {
+            return;
+        }
+        has_port = 0;
+        break;
+    default:
+        return;
+    }
+    size_t addr_len = pkt->ip_version == 4 ? 4 : 16;
+    uint64_t pane = timestamp_ns / state->bind->pane_ns;
+
+    scan_slot_t *source = FindSlot(state, state->sources, SCAN_SOURCE_SLOTS, pkt, pkt->src_ip, pane, 0);
+    int changed = HllAdd(&source->sketches[source->pane & 1][0], HashBytes(pkt->dst_ip, addr_len));
+    if (has_port) {
+        changed |= HllAdd(&source->sketches[source->pane & 1][1], HashBytes(&pkt->dst_port, sizeof(pkt->dst_port)));
+    }
+    CountProbe(state, source, timestamp_ns, changed, 0);
+
+    if (syn) {
+        scan_slot_t *target = FindSlot(state, state->targets, SCAN_TARGET_SLOTS, pkt, pkt->dst_ip, pane, 1);
+        changed = HllAdd(&target->sketches[target->pane & 1][0], HashBytes(pkt->src_ip, addr_len));
+        CountProbe(state, target, timestamp_ns, changed, 1);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table function
+// ---------------------------------------------------------------------------
+
+static void ScanBindDataFree(void *data) {
+    scan_bind_t *bind = (scan_bind_t *)data;
+    if (bind) {
+        duckdb_free(bind->filename);
+        duckdb_free(bind);
+    }
+}
+
+// Positive integer named parameter, or fallback when it is not given
+static int BindPositive(duckdb_bind_info info, const char *name, int64_t fallback, uint64_t *out) {
+    int64_t value = fallback;
+    duckdb_value named = duckdb_bind_get_named_parameter(info, name);
+    if (named) {
+        if (!duckdb_is_null_value(named)) {
+            value = duckdb_get_int64(named);
+        }
+        duckdb_destroy_value(&named);
+    }
+    if (value <= 0) {
+        char message[96];
+        snprintf(message, sizeof(message), "%s must be positive", name);
+        duckdb_bind_set_error(info, message);
+        return 0;
+    }
+    *out = (uint64_t)value;
+    return 1;
+}
+
+static void ScanBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    scan_bind_t *bind = (scan_bind_t *)duckdb_malloc(sizeof(scan_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    memset(bind, 0, sizeof(scan_bind_t));
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, ScanBindDataFree);
+
+    uint64_t window_seconds;
+    if (!BindPositive(info, "window_seconds", SCAN_DEFAULT_WINDOW_SECONDS, &window_seconds) ||
+        !BindPositive(info, "scan_threshold", SCAN_DEFAULT_THRESHOLD, &bind->scan_threshold) ||
+        !BindPositive(info, "flood_threshold", SCAN_DEFAULT_FLOOD_THRESHOLD, &bind->flood_threshold)) {
+        return;
+    }
+    if (window_seconds > UINT64_MAX / 1000000000ULL) {
+        duckdb_bind_set_error(info, "window_seconds is too large");
+        return;
+    }
+    bind->pane_ns = window_seconds * 1000000000ULL / 2;
+
+    PcapBindAddColumn(info, "alert", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "first_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "last_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "probes", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "distinct_hosts", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "distinct_ports", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "distinct_sources", DUCKDB_TYPE_UINTEGER);
+}
+
+static void ScanInitDataFree(void *data) {
+    scan_state_t *state = (scan_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        duckdb_free(state->sources);
+        duckdb_free(state->targets);
+        StreamBufferFree(&state->rows);
+        duckdb_free(state);
+    }
+}
+
+static void ScanInit(duckdb_init_info info) {
+    scan_bind_t *bind = (scan_bind_t *)duckdb_init_get_bind_data(info);
+
+    scan_state_t *state = (scan_state_t *)duckdb_malloc(sizeof(scan_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(scan_state_t));
+    state->bind = bind;
+    state->sources = (scan_slot_t *)duckdb_malloc(SCAN_SOURCE_SLOTS * sizeof(scan_slot_t));
+    state->targets = (scan_slot_t *)duckdb_malloc(SCAN_TARGET_SLOTS * sizeof(scan_slot_t));
+    if (!state->sources || !state->targets) {
+        ScanInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state->sources, 0, SCAN_SOURCE_SLOTS * sizeof(scan_slot_t));
+    memset(state->targets, 0, SCAN_TARGET_SLOTS * sizeof(scan_slot_t));
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        ScanInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, ScanInitDataFree);
+}
+
+static void AssignIp(duckdb_vector vector, idx_t row, const scan_row_t *queued) {
+    char text[46];
+    PacketFormatIp(queued->ip_version, queued->addr, text, sizeof(text));
+    duckdb_vector_assign_string_element(vector, row, text);
+}
+
+static void ScanFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    scan_state_t *state = (scan_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[SCAN_COL_COUNT];
+    for (idx_t i = 0; i < SCAN_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *firsts = (uint64_t *)duckdb_vector_get_data(vectors[SCAN_COL_FIRST_TIMESTAMP]);
+    uint64_t *lasts = (uint64_t *)duckdb_vector_get_data(vectors[SCAN_COL_LAST_TIMESTAMP]);
+    uint64_t *probes = (uint64_t *)duckdb_vector_get_data(vectors[SCAN_COL_PROBES]);
+    uint32_t *hosts = (uint32_t *)duckdb_vector_get_data(vectors[SCAN_COL_DISTINCT_HOSTS]);
+    uint32_t *ports = (uint32_t *)duckdb_vector_get_data(vectors[SCAN_COL_DISTINCT_PORTS]);
+    uint32_t *sources = (uint32_t *)duckdb_vector_get_data(vectors[SCAN_COL_DISTINCT_SOURCES]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    while (row_count < max_rows) {
+        if (state->row_next * sizeof(scan_row_t) == state->rows.len) {
+            state->rows.len = 0;
+            state->row_next = 0;
+            if (state->done) {
+                break;
+            }
+            if (state->draining) {
+                // End of capture: end the episodes still in progress
+                if (state->drain_position < SCAN_TARGET_SLOTS) {
+                    EndEpisode(state, &state->targets[state->drain_position++], 1);
+                } else if (state->drain_position < SCAN_TARGET_SLOTS + SCAN_SOURCE_SLOTS) {
+                    EndEpisode(state, &state->sources[state->drain_position++ - SCAN_TARGET_SLOTS], 0);
+                } else {
+                    state->done = 1;
+                }
+                continue;
+            }
+            if (!PcapSourceNext(state->source, &packet)) {
+                state->draining = 1;
+                continue;
+            }
+            if (PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) && pkt.ip_version &&
+                !pkt.is_fragment) {
+                ProcessPacket(state, packet.timestamp_ns, &pkt);
+            }
+            continue;
+        }
+        const scan_row_t *queued = (const scan_row_t *)(const void *)state->rows.data + state->row_next++;
+        idx_t row = row_count++;
+        duckdb_vector_assign_string_element(vectors[SCAN_COL_ALERT], row, scan_alert_names[queued->alert]);
+        firsts[row] = queued->first_ns;
+        lasts[row] = queued->last_ns;
+        probes[row] = queued->probes;
+        if (queued->alert == SCAN_ALERT_SYN_FLOOD) {
+            PcapVectorSetNull(vectors[SCAN_COL_SRC_IP], row);
+            AssignIp(vectors[SCAN_COL_DST_IP], row, queued);
+            PcapVectorSetNull(vectors[SCAN_COL_DISTINCT_HOSTS], row);
+            PcapVectorSetNull(vectors[SCAN_COL_DISTINCT_PORTS], row);
+            sources[row] = queued->peak[0];
+        } else {
+            AssignIp(vectors[SCAN_COL_SRC_IP], row, queued);
+            PcapVectorSetNull(vectors[SCAN_COL_DST_IP], row);
+            hosts[row] = queued->peak[0];
+            ports[row] = queued->peak[1];
+            PcapVectorSetNull(vectors[SCAN_COL_DISTINCT_SOURCES], row);
+        }
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterScansFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_scans");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+    duckdb_logical_type bigint_type = duckdb_create_logical_type(DUCKDB_TYPE_BIGINT);
+    duckdb_table_function_add_named_parameter(function, "window_seconds", bigint_type);
+    duckdb_table_function_add_named_parameter(function, "scan_threshold", bigint_type);
+    duckdb_table_function_add_named_parameter(function, "flood_threshold", bigint_type);
+    duckdb_destroy_logical_type(&bigint_type);
+
+    duckdb_table_function_set_bind(function, ScanBind);
+    duckdb_table_function_set_init(function, ScanInit);
+    duckdb_table_function_set_function(function, ScanFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
@@ -0,0 +1,329 @@
+#include "duckdb_extension.h"
+#include "shared_scan.h"
+#include "sync.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Packets of one batch, their data packed into one arena
+typedef struct {
+    uint64_t seq;            // position in the sequence of batches the scan produced
+    uint64_t file_batch;     // index of the batch within the capture
+    uint32_t count;
+    uint32_t refs;           // readers returning packets from it
+    int orphaned;            // no longer in the ring; freed with its last reference
+    pcap_packet_t packets[SHARED_SCAN_BATCH_PACKETS];
+    uint8_t *arena;
+    size_t arena_capacity;
+} shared_batch_t;
+
+typedef struct shared_scan {
+    struct shared_scan *next;  // in the list of scans in progress
+    char *filename;
+    capture_cache_t cache;
+    uint32_t readers;        // guarded by the list lock
+    pcap_mutex_t lock;       // guards everything below
+    pcap_source_t *source;
+    int restart;             // the source reached the end; reopen before reading on
+    int failed;              // the capture could not be reopened
+    uint64_t produced;       // batches read so far, over every pass
+    uint64_t file_batch;     // index within the capture of the next batch read
+    uint64_t file_batches;   // batches in the capture, UINT64_MAX until a pass ends
+    shared_batch_t *ring[SHARED_SCAN_BATCHES];  // batch seq at seq % SHARED_SCAN_BATCHES
+    shared_batch_t *spare;   // batch the next one is read into
+} shared_scan_t;
+
+struct shared_reader {
+    shared_scan_t *scan;
+    uint64_t next_seq;       // next batch to return
+    uint64_t start_batch;    // file batch of the first one returned
+    uint64_t consumed;       // batches returned
+    shared_batch_t *batch;   // batch being returned, referenced
+    uint32_t at;             // next packet of it
+    pcap_source_t *fallback;  // private scan after falling behind
+    uint64_t fallback_packet;  // packets read by it
+    uint64_t fallback_batches;  // file_batches when falling behind
+};
+
+// Scans in progress
+static shared_scan_t *shared_scans = NULL;
+static pcap_mutex_t shared_scans_lock = PCAP_MUTEX_INITIALIZER;
+
+static void FreeBatch(shared_batch_t *batch) {
+    if (batch) {
+        duckdb_free(batch->arena);
+        duckdb_free(batch);
+    }
+}
+
+static void ReleaseBatch(shared_batch_t *batch) {
+    batch->refs--;
+    if (batch->orphaned && !batch->refs) {
+        FreeBatch(batch);
+    }
+}
+
+static void FreeScan(shared_scan_t *scan) {
+    for (size_t i = 0; i < SHARED_SCAN_BATCHES; i++) {
+        if (scan->ring[i] && !scan->ring[i]->refs) {
+            FreeBatch(scan->ring[i]);
+        }
+    }
+    FreeBatch(scan->spare);
+    PcapSourceClose(scan->source);
+    duckdb_free(scan->filename);
+    duckdb_free(scan);
+}
+
+// ---------------------------------------------------------------------------
+// Reading batches
+// ---------------------------------------------------------------------------
+
+// Copy the next packets of the capture into the spare batch. Returns the
+// number read, 0 at the end of the capture and -1 when out of memory.
+static int64_t FillBatch(shared_scan_t *scan, shared_batch_t *batch) {
+    size_t used = 0;
+    uint32_t count = 0;
+    pcap_packet_t packet;
+    while (count < SHARED_SCAN_BATCH_PACKETS && PcapSourceNext(scan->source, &packet)) {
+        if (used + packet.capture_len > batch->arena_capacity) {
+            size_t capacity = batch->arena_capacity ? batch->arena_capacity : 65536;
+            while (capacity < used + packet.capture_len) {
+                capacity *= 2;
+            }
+            uint8_t *arena = (uint8_t *)duckdb_malloc(capacity);
+            if (!arena) {
+                return -1;
+            }
+            if (used) {
+                memcpy(arena, batch->arena, used);
+            }
+            duckdb_free(batch->arena);
+            batch->arena = arena;
+            batch->arena_capacity = capacity;
+        }
+        if (packet.capture_len) {
+            memcpy(batch->arena + used, packet.data, packet.capture_len);
+        }
+        // Offsets for now; the arena may still move
+        packet.data = (const uint8_t *)(uintptr_t)used;
+        batch->packets[count++] = packet;
+        used += packet.capture_len;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        batch->packets[i].data = batch->arena + (uintptr_t)batch->packets[i].data;
+    }
+    batch->count = count;
+    return count;
+}
+
+// Read the next batch into the ring, replacing the oldest one. Returns 1 when
+// a batch was added, 0 at the end of the capture (which the next call starts
+// over) and -1 on failure. Called with the scan locked.
+static int ProduceBatch(shared_scan_t *scan) {
+    if (scan->failed) {
+        return -1;
+    }
+    if (scan->restart) {
+        PcapSourceClose(scan->source);
+        scan->source = NULL;
+        if (PcapSourceOpenWithCache(scan->filename, scan->cache, &scan->source)) {
+            scan->failed = 1;
+            return -1;
+        }
+        scan->restart = 0;
+        scan->file_batch = 0;
+    }
+    if (!scan->spare) {
+        scan->spare = (shared_batch_t *)duckdb_malloc(sizeof(shared_batch_t));
+        if (!scan->spare) {
+            return -1;
+        }
+        memset(scan->spare, 0, sizeof(shared_batch_t));
+    }
+    shared_batch_t *batch = scan->spare;
+    int64_t count = FillBatch(scan, batch);
+    if (count < 0) {
+        return -1;
+    }
+    if (!count) {
+        scan->file_batches = scan->file_batch;
+        scan->restart = 1;
+        return 0;
+    }
+    batch->seq = scan->produced;
+    batch->file_batch = scan->file_batch++;
+    shared_batch_t **slot = &scan->ring[scan->produced % SHARED_SCAN_BATCHES];
+    scan->spare = *slot;
+    if (scan->spare && scan->spare->refs) {
+        // A reader is still returning the oldest batch
+        scan->spare->orphaned = 1;
+        scan->spare = NULL;
+    }
+    *slot = batch;
+    scan->produced++;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Readers
+// ---------------------------------------------------------------------------
+
+const char *SharedScanJoin(const char *filename, capture_cache_t cache, pcap_source_t *source,
+                           shared_reader_t **out) {
+    *out = NULL;
+    shared_reader_t *reader = (shared_reader_t *)duckdb_malloc(sizeof(shared_reader_t));
+    if (!reader) {
+        PcapSourceClose(source);
+        return "Failed to allocate memory for shared scan";
+    }
+    memset(reader, 0, sizeof(shared_reader_t));
+
+    PcapMutexLock(&shared_scans_lock);
+    shared_scan_t *scan = shared_scans;
+    while (scan && (scan->cache != cache || strcmp(scan->filename, filename) != 0)) {
+        scan = scan->next;
+    }
+    if (scan) {
+        scan->readers++;
+    } else {
+        size_t len = strlen(filename);
+        scan = (shared_scan_t *)duckdb_malloc(sizeof(shared_scan_t));
+        char *copy = (char *)duckdb_malloc(len + 1);
+        if (!scan || !copy) {
+            PcapMutexUnlock(&shared_scans_lock);
+            duckdb_free(scan);
+            duckdb_free(copy);
+            duckdb_free(reader);
+            PcapSourceClose(source);
+            return "Failed to allocate memory for shared scan";
+        }
+        memset(scan, 0, sizeof(shared_scan_t));
+        pcap_mutex_t unlocked = PCAP_MUTEX_INITIALIZER;
+        scan->lock = unlocked;
+        memcpy(copy, filename, len + 1);
+        scan->filename = copy;
+        scan->cache = cache;
+        scan->readers = 1;
+        scan->source = source;
+        scan->file_batches = UINT64_MAX;
+        source = NULL;
+        scan->next = shared_scans;
+        shared_scans = scan;
+    }
+    PcapMutexUnlock(&shared_scans_lock);
+    PcapSourceClose(source);
+
+    // Start a few batches back, at data already decoded; not so far back as
+    // to fall behind right away
+    PcapMutexLock(&scan->lock);
+    uint64_t back = scan->produced < SHARED_SCAN_BATCHES / 2 ? scan->produced : SHARED_SCAN_BATCHES / 2;
+    reader->scan = scan;
+    reader->next_seq = scan->produced - back;
+    if (back) {
+        reader->start_batch = scan->ring[reader->next_seq % SHARED_SCAN_BATCHES]->file_batch;
+    } else {
+        reader->start_batch = scan->restart ? 0 : scan->file_batch;
+    }
+    PcapMutexUnlock(&scan->lock);
+    *out = reader;
+    return NULL;
+}
+
+// Whether the reader returned the given file batch before falling behind
+static int BatchConsumed(const shared_reader_t *reader, uint64_t file_batch) {
+    uint64_t end = reader->start_batch + reader->consumed;
+    if (reader->fallback_batches != UINT64_MAX && end > reader->fallback_batches) {
+        return file_batch >= reader->start_batch || file_batch < end - reader->fallback_batches;
+    }
+    return file_batch >= reader->start_batch && file_batch < end;
+}
+
+static int FallbackNext(shared_reader_t *reader, pcap_packet_t *packet) {
+    while (PcapSourceNext(reader->fallback, packet)) {
+        uint64_t file_batch = reader->fallback_packet++ / SHARED_SCAN_BATCH_PACKETS;
+        if (!BatchConsumed(reader, file_batch)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int SharedScanNext(shared_reader_t *reader, pcap_packet_t *packet) {
+    shared_scan_t *scan = reader->scan;
+    for (;;) {
+        if (reader->fallback) {
+            return FallbackNext(reader, packet);
+        }
+        if (reader->batch && reader->at < reader->batch->count) {
+            *packet = reader->batch->packets[reader->at++];
+            return 1;
+        }
+
+        PcapMutexLock(&scan->lock);
+        if (reader->batch) {
+            ReleaseBatch(reader->batch);
+            reader->batch = NULL;
+        }
+        if (reader->consumed == scan->file_batches) {
+            PcapMutexUnlock(&scan->lock);
+            return 0;
+        }
+        if (reader->next_seq + SHARED_SCAN_BATCHES <= scan->produced) {
+            // Fell behind: read the capture again, privately
+            reader->fallback_batches = scan->file_batches;
+            PcapMutexUnlock(&scan->lock);
+            if (PcapSourceOpenWithCache(scan->filename, scan->cache, &reader->fallback)) {
+                return 0;
+            }
+            continue;
+        }
+        if (reader->next_seq == scan->produced) {
+            int produced = ProduceBatch(scan);
+            if (produced <= 0) {
+                // At the end of the capture, the reader may be done; otherwise
+                // the next batch starts the capture over
+                PcapMutexUnlock(&scan->lock);
+                if (produced < 0) {
+                    return 0;
+                }
+                continue;
+            }
+        }
+        reader->batch = scan->ring[reader->next_seq % SHARED_SCAN_BATCHES];
+        reader->batch->refs++;
+        reader->at = 0;
+        reader->next_seq++;
+        reader->consumed++;
+        PcapMutexUnlock(&scan->lock);
+    }
+}
+
+void SharedScanLeave(shared_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+    shared_scan_t *scan = reader->scan;
+    if (reader->batch) {
+        PcapMutexLock(&scan->lock);
+        ReleaseBatch(reader->batch);
+        PcapMutexUnlock(&scan->lock);
+    }
+    PcapSourceClose(reader->fallback);
+    duckdb_free(reader);
+
+    PcapMutexLock(&shared_scans_lock);
+    if (--scan->readers) {
+        scan = NULL;
+    } else {
+        shared_scan_t **link = &shared_scans;
+        while (*link != scan) {
+            link = &(*link)->next;
+        }
+        *link = scan->next;
+    }
+    PcapMutexUnlock(&shared_scans_lock);
+    if (scan) {
+        FreeScan(scan);
+    }
+}
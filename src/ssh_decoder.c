@@ -0,0 +1,554 @@
+#include "duckdb_extension.h"
+#include "digest.h"
+#include "flow.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "ssh_decoder.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define SSH_MSG_KEXINIT 20
+#define SSH_MSG_NEWKEYS 21
+
+// KEXINIT name-list indices (RFC 4253 section 7.1)
+#define SSH_LIST_KEX 0
+#define SSH_LIST_HOST_KEY 1
+#define SSH_LIST_ENC_C2S 2
+#define SSH_LIST_ENC_S2C 3
+#define SSH_LIST_MAC_C2S 4
+#define SSH_LIST_MAC_S2C 5
+#define SSH_LIST_COMP_C2S 6
+#define SSH_LIST_COMP_S2C 7
+#define SSH_NAME_LISTS 10
+
+// Largest binary packet accepted during the handshake (RFC 4253 section 6.1)
+#define SSH_MAX_PACKET 35000
+
+// Unencrypted handshake parser for one direction. Discarded once the
+// direction switches to encrypted traffic (SSH_MSG_NEWKEYS).
+typedef struct {
+    stream_buffer_t stream;
+    uint8_t banner_done;
+} ssh_parser_t;
+
+// Per-direction results kept for the lifetime of the session
+typedef struct {
+    char banner[SSH_MAX_BANNER];
+    char *kexinit;           // the ten name-lists separated by '\n', or NULL
+    uint64_t encrypted_bytes;
+    uint64_t packets;
+    uint8_t encrypted;       // NEWKEYS seen (or handshake abandoned)
+    uint8_t newkeys;
+} ssh_direction_t;
+
+typedef struct {
+    flow_key_t key;
+    uint64_t first_ts_ns;
+    uint64_t last_ts_ns;
+    int server_endpoint;              // 0 = flow endpoint A, 1 = B
+    tcp_direction_t tcp[2];           // indexed by packet direction
+    ssh_parser_t *parsers;            // [2], NULL once the handshake is done
+    ssh_direction_t dir[2];
+    uint8_t fin[2];
+} ssh_session_t;
+
+typedef struct {
+    pcap_source_t *source;
+    hash_map_t sessions;  // flow_key_t -> ssh_session_t *
+    int draining;         // end of capture reached, emitting open sessions
+    size_t drain_position;
+} ssh_state_t;
+
+enum {
+    SSH_COL_START,
+    SSH_COL_END,
+    SSH_COL_CLIENT_IP,
+    SSH_COL_CLIENT_PORT,
+    SSH_COL_SERVER_IP,
+    SSH_COL_SERVER_PORT,
+    SSH_COL_CLIENT_BANNER,
+    SSH_COL_SERVER_BANNER,
+    SSH_COL_HASSH,
+    SSH_COL_HASSH_ALGORITHMS,
+    SSH_COL_HASSH_SERVER,
+    SSH_COL_HASSH_SERVER_ALGORITHMS,
+    SSH_COL_CLIENT_KEX,
+    SSH_COL_SERVER_KEX,
+    SSH_COL_SERVER_HOST_KEY,
+    SSH_COL_CLIENT_ENC,
+    SSH_COL_SERVER_ENC,
+    SSH_COL_CLIENT_MAC,
+    SSH_COL_SERVER_MAC,
+    SSH_COL_CLIENT_COMP,
+    SSH_COL_SERVER_COMP,
+    SSH_COL_HANDSHAKE_COMPLETE,
+    SSH_COL_CLIENT_BYTES,
+    SSH_COL_SERVER_BYTES,
+    SSH_COL_CLIENT_PACKETS,
+    SSH_COL_SERVER_PACKETS,
+    SSH_COL_COUNT
+};
+
+static void FreeParsers(ssh_session_t *session) {
+    if (session->parsers) {
+        for (int i = 0; i < 2; i++) {
+            StreamBufferFree(&session->parsers[i].stream);
+        }
+        duckdb_free(session->parsers);
+        session->parsers = NULL;
+    }
+}
+
+static void FreeSession(ssh_session_t *session) {
+    FreeParsers(session);
+    for (int i = 0; i < 2; i++) {
+        if (session->dir[i].kexinit) {
+            duckdb_free(session->dir[i].kexinit);
+        }
+    }
+    duckdb_free(session);
+}
+
+static void SshInitDataFree(void *data) {
+    ssh_state_t *state = (ssh_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        if (state->sessions.slots) {
+            size_t position = 0;
+            const void *key;
+            void *value;
+            while (HashMapNext(&state->sessions, &position, &key, &value)) {
+                FreeSession(*(ssh_session_t **)value);
+            }
+        }
+        HashMapDestroy(&state->sessions);
+        duckdb_free(state);
+    }
+}
+
+static void SshInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    ssh_state_t *state = (ssh_state_t *)duckdb_malloc(sizeof(ssh_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(ssh_state_t));
+    if (!HashMapInit(&state->sessions, sizeof(flow_key_t), sizeof(ssh_session_t *))) {
+        SshInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        SshInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, SshInitDataFree);
+}
+
+// Copy the ten KEXINIT name-lists into a '\n'-separated string
+static char *ParseKexinit(const uint8_t *payload, size_t len) {
+    // Message type byte and 16-byte cookie precede the name-lists
+    size_t offset = 17;
+    size_t total = 0;
+    for (int i = 0; i < SSH_NAME_LISTS; i++) {
+        if (offset + 4 > len) {
+            return NULL;
+        }
+        size_t list_len = PacketRead32(payload + offset);
+        if (list_len > len - offset - 4) {
+            return NULL;
+        }
+        total += list_len + 1;
+        offset += 4 + list_len;
+    }
+
+    char *lists = (char *)duckdb_malloc(total);
+    if (!lists) {
+        return NULL;
+    }
+    offset = 17;
+    size_t pos = 0;
+    for (int i = 0; i < SSH_NAME_LISTS; i++) {
+        size_t list_len = PacketRead32(payload + offset);
+        memcpy(lists + pos, payload + offset + 4, list_len);
+        pos += list_len;
+        lists[pos++] = (char)(i + 1 < SSH_NAME_LISTS ? '\n' : '\0');
+        offset += 4 + list_len;
+    }
+    return lists;
+}
+
+// Locate name-list index within a '\n'-separated KEXINIT string
+static const char *KexinitList(const char *lists, int index, size_t *len) {
+    const char *p = lists;
+    for (int i = 0; i < index; i++) {
+        p = strchr(p, '\n') + 1;
+    }
+    const char *end = strchr(p, '\n');
+    *len = end ? (size_t)(end - p) : strlen(p);
+    return p;
+}
+
+// Consume complete banner lines and binary packets from the parser buffer.
+// Returns 1 once the direction has switched to encrypted traffic.
+static int ParseHandshake(ssh_parser_t *parser, ssh_direction_t *dir) {
+    size_t consumed = 0;
+    int encrypted = 0;
+
+    stream_buffer_t *stream = &parser->stream;
+    while (consumed < stream->len) {
+        const uint8_t *p = stream->data + consumed;
+        size_t avail = stream->len - consumed;
+
+        if (!parser->banner_done) {
+            const uint8_t *newline = (const uint8_t *)memchr(p, '\n', avail);
+            if (!newline) {
+                break;
+            }
+            size_t line_len = (size_t)(newline - p);
+            // Servers may send other lines before the version string
+            if (line_len >= 4 && memcmp(p, "SSH-", 4) == 0) {
+                size_t copy = line_len;
+                if (copy && p[copy - 1] == '\r') {
+                    copy--;
+                }
+                if (copy >= SSH_MAX_BANNER) {
+                    copy = SSH_MAX_BANNER - 1;
+                }
+                memcpy(dir->banner, p, copy);
+                dir->banner[copy] = '\0';
+                parser->banner_done = 1;
+            }
+            consumed += line_len + 1;
+            continue;
+        }
+
+        if (avail < 6) {
+            break;
+        }
+        uint32_t packet_len = PacketRead32(p);
+        uint8_t padding_len = p[4];
+        if (packet_len > SSH_MAX_PACKET || packet_len < (uint32_t)padding_len + 1) {
+            // Not plain binary packet framing; give up on this direction
+            return 1;
+        }
+        if (avail < 4 + (size_t)packet_len) {
+            break;
+        }
+        const uint8_t *payload = p + 5;
+        size_t payload_len = packet_len - padding_len - 1;
+        consumed += 4 + packet_len;
+        if (payload_len && payload[0] == SSH_MSG_KEXINIT && !dir->kexinit) {
+            dir->kexinit = ParseKexinit(payload, payload_len);
+        } else if (payload_len && payload[0] == SSH_MSG_NEWKEYS) {
+            // Everything after NEWKEYS is encrypted
+            dir->newkeys = 1;
+            dir->encrypted_bytes += stream->len - consumed;
+            encrypted = 1;
+            consumed = stream->len;
+            break;
+        }
+    }
+
+    StreamBufferConsume(stream, consumed);
+    return encrypted;
+}
+
+static void FeedHandshake(ssh_session_t *session, int direction, const uint8_t *data, uint32_t len) {
+    ssh_direction_t *dir = &session->dir[direction];
+    ssh_parser_t *parser = &session->parsers[direction];
+
+    if (!StreamBufferAppend(&parser->stream, data, len, SSH_MAX_HANDSHAKE_BUFFER)) {
+        dir->encrypted = 1;
+    } else {
+        dir->encrypted = (uint8_t)ParseHandshake(parser, dir);
+    }
+
+    if (session->dir[0].encrypted && session->dir[1].encrypted) {
+        // Handshake done: drop the reassembly state, keep only counters
+        FreeParsers(session);
+    }
+}
+
+// Version exchange in a segment: "SSH-" at the start of any line, since
+// servers may send other lines before the version string
+static int HasSshBanner(const uint8_t *payload, uint32_t len) {
+    for (uint32_t i = 0; i + 4 <= len; i++) {
+        if ((i == 0 || payload[i - 1] == '\n') && memcmp(payload + i, "SSH-", 4) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Port-based guess of the server side: well-known SSH ports, else the lower port
+static int GuessServerEndpoint(const flow_key_t *key) {
+    if (key->port_a == 22 || key->port_a == 2222) {
+        return 0;
+    }
+    if (key->port_b == 22 || key->port_b == 2222) {
+        return 1;
+    }
+    return key->port_a <= key->port_b ? 0 : 1;
+}
+
+static void SshBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "start_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "end_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "client_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "client_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "server_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "server_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "client_banner", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "server_banner", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hassh", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hassh_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hassh_server", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "hassh_server_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "client_kex_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "server_kex_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "server_host_key_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "client_encryption_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "server_encryption_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "client_mac_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "server_mac_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "client_compression_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "server_compression_algorithms", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "handshake_complete", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "client_encrypted_bytes", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "server_encrypted_bytes", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "client_packets", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "server_packets", DUCKDB_TYPE_UBIGINT);
+}
+
+static void AssignKexList(duckdb_vector vector, idx_t row, const char *lists, int index) {
+    if (!lists) {
+        PcapVectorSetNull(vector, row);
+        return;
+    }
+    size_t len;
+    const char *list = KexinitList(lists, index, &len);
+    PcapListAssignSplit(vector, row, list, len, ',');
+}
+
+// HASSH: MD5 of "kex;encryption;mac;compression" for one side's KEXINIT
+static void AssignHassh(duckdb_vector hash_vector, duckdb_vector text_vector, idx_t row, const char *lists,
+                        const int *indices) {
+    if (!lists) {
+        PcapVectorSetNull(hash_vector, row);
+        PcapVectorSetNull(text_vector, row);
+        return;
+    }
+    size_t total = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t len;
+        KexinitList(lists, indices[i], &len);
+        total += len + 1;
+    }
+    char *text = (char *)duckdb_malloc(total);
+    if (!text) {
+        PcapVectorSetNull(hash_vector, row);
+        PcapVectorSetNull(text_vector, row);
+        return;
+    }
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t len;
+        const char *list = KexinitList(lists, indices[i], &len);
+        memcpy(text + pos, list, len);
+        pos += len;
+        if (i < 3) {
+            text[pos++] = ';';
+        }
+    }
+
+    md5_ctx_t md5;
+    uint8_t digest[MD5_DIGEST_LEN];
+    char hex[MD5_DIGEST_LEN * 2 + 1];
+    Md5Init(&md5);
+    Md5Update(&md5, text, pos);
+    Md5Final(&md5, digest);
+    DigestToHex(digest, MD5_DIGEST_LEN, hex);
+    duckdb_vector_assign_string_element(hash_vector, row, hex);
+    duckdb_vector_assign_string_element_len(text_vector, row, text, pos);
+    duckdb_free(text);
+}
+
+static void EmitSession(duckdb_vector *vectors, idx_t row, const ssh_session_t *session) {
+    static const int client_hassh[4] = {SSH_LIST_KEX, SSH_LIST_ENC_C2S, SSH_LIST_MAC_C2S, SSH_LIST_COMP_C2S};
+    static const int server_hassh[4] = {SSH_LIST_KEX, SSH_LIST_ENC_S2C, SSH_LIST_MAC_S2C, SSH_LIST_COMP_S2C};
+    char addr[64];
+    uint16_t port;
+
+    // Directions are indexed by sending endpoint, so the client sends from
+    // the endpoint that is not the server
+    int server = session->server_endpoint;
+    int client = 1 - server;
+    const ssh_direction_t *c = &session->dir[client];
+    const ssh_direction_t *s = &session->dir[server];
+
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_START]))[row] = session->first_ts_ns;
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_END]))[row] = session->last_ts_ns;
+    FlowFormatEndpoint(&session->key, client, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[SSH_COL_CLIENT_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[SSH_COL_CLIENT_PORT]))[row] = port;
+    FlowFormatEndpoint(&session->key, server, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[SSH_COL_SERVER_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[SSH_COL_SERVER_PORT]))[row] = port;
+
+    if (c->banner[0]) {
+        duckdb_vector_assign_string_element(vectors[SSH_COL_CLIENT_BANNER], row, c->banner);
+    } else {
+        PcapVectorSetNull(vectors[SSH_COL_CLIENT_BANNER], row);
+    }
+    if (s->banner[0]) {
+        duckdb_vector_assign_string_element(vectors[SSH_COL_SERVER_BANNER], row, s->banner);
+    } else {
+        PcapVectorSetNull(vectors[SSH_COL_SERVER_BANNER], row);
+    }
+
+    AssignHassh(vectors[SSH_COL_HASSH], vectors[SSH_COL_HASSH_ALGORITHMS], row, c->kexinit, client_hassh);
+    AssignHassh(vectors[SSH_COL_HASSH_SERVER], vectors[SSH_COL_HASSH_SERVER_ALGORITHMS], row, s->kexinit,
+                server_hassh);
+    AssignKexList(vectors[SSH_COL_CLIENT_KEX], row, c->kexinit, SSH_LIST_KEX);
+    AssignKexList(vectors[SSH_COL_SERVER_KEX], row, s->kexinit, SSH_LIST_KEX);
+    AssignKexList(vectors[SSH_COL_SERVER_HOST_KEY], row, s->kexinit, SSH_LIST_HOST_KEY);
+    AssignKexList(vectors[SSH_COL_CLIENT_ENC], row, c->kexinit, SSH_LIST_ENC_C2S);
+    AssignKexList(vectors[SSH_COL_SERVER_ENC], row, s->kexinit, SSH_LIST_ENC_S2C);
+    AssignKexList(vectors[SSH_COL_CLIENT_MAC], row, c->kexinit, SSH_LIST_MAC_C2S);
+    AssignKexList(vectors[SSH_COL_SERVER_MAC], row, s->kexinit, SSH_LIST_MAC_S2C);
+    AssignKexList(vectors[SSH_COL_CLIENT_COMP], row, c->kexinit, SSH_LIST_COMP_C2S);
+    AssignKexList(vectors[SSH_COL_SERVER_COMP], row, s->kexinit, SSH_LIST_COMP_S2C);
+
+    ((bool *)duckdb_vector_get_data(vectors[SSH_COL_HANDSHAKE_COMPLETE]))[row] =
+        c->kexinit && s->kexinit && c->newkeys && s->newkeys;
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_CLIENT_BYTES]))[row] = c->encrypted_bytes;
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_SERVER_BYTES]))[row] = s->encrypted_bytes;
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_CLIENT_PACKETS]))[row] = c->packets;
+    ((uint64_t *)duckdb_vector_get_data(vectors[SSH_COL_SERVER_PACKETS]))[row] = s->packets;
+}
+
+// Process one TCP packet. Returns a session that was closed by this packet
+// (removed from the map, to be emitted and freed by the caller) or NULL.
+static ssh_session_t *ProcessPacket(ssh_state_t *state, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0) {
+        return NULL;
+    }
+
+    ssh_session_t **slot = (ssh_session_t **)HashMapFind(&state->sessions, &key);
+    ssh_session_t *session = slot ? *slot : NULL;
+    if (!session) {
+        // Only version exchanges start tracking, so other flows cost one lookup
+        if (!pkt->payload || !HasSshBanner(pkt->payload, pkt->payload_len)) {
+            return NULL;
+        }
+        session = (ssh_session_t *)duckdb_malloc(sizeof(ssh_session_t));
+        if (!session) {
+            return NULL;
+        }
+        memset(session, 0, sizeof(ssh_session_t));
+        session->parsers = (ssh_parser_t *)duckdb_malloc(2 * sizeof(ssh_parser_t));
+        if (!session->parsers) {
+            duckdb_free(session);
+            return NULL;
+        }
+        memset(session->parsers, 0, 2 * sizeof(ssh_parser_t));
+        session->key = key;
+        session->first_ts_ns = packet->timestamp_ns;
+        session->server_endpoint = GuessServerEndpoint(&key);
+        int is_new;
+        slot = (ssh_session_t **)HashMapInsert(&state->sessions, &key, &is_new);
+        if (!slot) {
+            FreeSession(session);
+            return NULL;
+        }
+        *slot = session;
+    }
+
+    session->last_ts_ns = packet->timestamp_ns;
+    ssh_direction_t *dir = &session->dir[direction];
+    dir->packets++;
+    if (session->parsers && !dir->encrypted) {
+        const uint8_t *data;
+        uint32_t len = TcpDirectionAccept(&session->tcp[direction], pkt, &data);
+        if (session->tcp[direction].gap) {
+            // Lost handshake bytes cannot be recovered; count from here on
+            dir->encrypted = 1;
+            dir->encrypted_bytes += pkt->payload_len;
+            if (session->dir[1 - direction].encrypted) {
+                FreeParsers(session);
+            }
+        } else if (len) {
+            FeedHandshake(session, direction, data, len);
+        }
+    } else {
+        dir->encrypted_bytes += pkt->payload_len;
+    }
+
+    if (pkt->tcp_flags & TCP_FLAG_FIN) {
+        session->fin[direction] = 1;
+    }
+    if ((pkt->tcp_flags & TCP_FLAG_RST) || (session->fin[0] && session->fin[1])) {
+        HashMapRemove(&state->sessions, &key);
+        return session;
+    }
+    return NULL;
+}
+
+static void SshFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    ssh_state_t *state = (ssh_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[SSH_COL_COUNT];
+    for (idx_t i = 0; i < SSH_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+
+    while (row_count < max_rows && !state->draining) {
+        if (!PcapSourceNext(state->source, &packet)) {
+            state->draining = 1;
+            break;
+        }
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) ||
+            pkt.ip_proto != IPPROTO_NUM_TCP || pkt.is_fragment) {
+            continue;
+        }
+        ssh_session_t *closed = ProcessPacket(state, &packet, &pkt);
+        if (closed) {
+            EmitSession(vectors, row_count++, closed);
+            FreeSession(closed);
+        }
+    }
+
+    // Sessions still open at the end of the capture
+    const void *key;
+    void *value;
+    while (state->draining && row_count < max_rows &&
+           HashMapNext(&state->sessions, &state->drain_position, &key, &value)) {
+        EmitSession(vectors, row_count++, *(ssh_session_t **)value);
+    }
+
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterSshFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_ssh", SshBind, SshInit, SshFunction);
+}
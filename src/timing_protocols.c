@@ -0,0 +1,606 @@
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "timing_protocols.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// PTP message types
+#define PTP_SYNC 0x0
+#define PTP_DELAY_REQ 0x1
+#define PTP_PDELAY_REQ 0x2
+#define PTP_PDELAY_RESP 0x3
+#define PTP_FOLLOW_UP 0x8
+#define PTP_DELAY_RESP 0x9
+#define PTP_PDELAY_RESP_FOLLOW_UP 0xA
+#define PTP_ANNOUNCE 0xB
+
+#define PTP_HEADER_LEN 34
+#define PTP_FLAG_TWO_STEP 0x02
+
+// Exchange state kinds, part of the state key so one map holds them all
+#define PTP_STATE_SYNC 1       // keyed by master port identity
+#define PTP_STATE_DELAY_REQ 2  // keyed by slave port identity
+#define PTP_STATE_PDELAY 3     // keyed by requesting port identity
+
+// Scan state shared by pcap_ptp and pcap_ntp
+typedef struct {
+    pcap_source_t *source;
+    hash_map_t exchanges;  // ptp_state_key_t -> ptp_state_t
+} timing_state_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t domain;
+    uint8_t port_identity[10];
+} ptp_state_key_t;
+
+// Timestamps of an in-progress exchange in nanoseconds. For Sync the fields
+// are t1 (origin) and t2 (capture), for Delay_Req t3 (capture), and for peer
+// delay t1 (request capture), t2 (request receipt) and t4 (response capture).
+typedef struct {
+    uint64_t t1;
+    uint64_t t2;
+    uint64_t t3;
+    uint64_t t4;
+    int64_t correction;    // accumulated correctionField, 2^-16 ns units
+    uint16_t sequence_id;
+    uint8_t has_t1;
+    uint8_t has_t2;
+} ptp_state_t;
+
+// Decoded fields of one PTP message
+typedef struct {
+    uint8_t message_type;
+    uint8_t version;
+    uint8_t domain;
+    uint8_t two_step;
+    uint16_t sequence_id;
+    int64_t correction;
+    const uint8_t *port_identity;
+    const uint8_t *requesting_identity;  // NULL unless the message carries one
+    uint64_t message_timestamp_ns;
+    int has_timestamp;
+} ptp_message_t;
+
+enum {
+    PTP_COL_TIMESTAMP,
+    PTP_COL_DOMAIN,
+    PTP_COL_MESSAGE_TYPE,
+    PTP_COL_VERSION,
+    PTP_COL_SEQUENCE_ID,
+    PTP_COL_CLOCK_IDENTITY,
+    PTP_COL_PORT_NUMBER,
+    PTP_COL_TWO_STEP,
+    PTP_COL_CORRECTION,
+    PTP_COL_MESSAGE_TIMESTAMP,
+    PTP_COL_REQUESTING_CLOCK_IDENTITY,
+    PTP_COL_REQUESTING_PORT_NUMBER,
+    PTP_COL_OFFSET,
+    PTP_COL_MEAN_PATH_DELAY,
+    PTP_COL_COUNT
+};
+
+enum {
+    NTP_COL_TIMESTAMP,
+    NTP_COL_SRC_IP,
+    NTP_COL_DST_IP,
+    NTP_COL_SRC_PORT,
+    NTP_COL_DST_PORT,
+    NTP_COL_LEAP,
+    NTP_COL_VERSION,
+    NTP_COL_MODE,
+    NTP_COL_STRATUM,
+    NTP_COL_POLL,
+    NTP_COL_PRECISION,
+    NTP_COL_ROOT_DELAY,
+    NTP_COL_ROOT_DISPERSION,
+    NTP_COL_REFERENCE_ID,
+    NTP_COL_REFERENCE_TS,
+    NTP_COL_ORIGIN_TS,
+    NTP_COL_RECEIVE_TS,
+    NTP_COL_TRANSMIT_TS,
+    NTP_COL_OFFSET,
+    NTP_COL_DELAY,
+    NTP_COL_COUNT
+};
+
+static const char *PtpMessageTypeName(uint8_t message_type) {
+    switch (message_type) {
+    case PTP_SYNC: return "Sync";
+    case PTP_DELAY_REQ: return "Delay_Req";
+    case PTP_PDELAY_REQ: return "Pdelay_Req";
+    case PTP_PDELAY_RESP: return "Pdelay_Resp";
+    case PTP_FOLLOW_UP: return "Follow_Up";
+    case PTP_DELAY_RESP: return "Delay_Resp";
+    case PTP_PDELAY_RESP_FOLLOW_UP: return "Pdelay_Resp_Follow_Up";
+    case PTP_ANNOUNCE: return "Announce";
+    case 0xC: return "Signaling";
+    case 0xD: return "Management";
+    default: return "Reserved";
+    }
+}
+
+static const char *NtpModeName(uint8_t mode) {
+    static const char *names[] = {"reserved", "symmetric_active", "symmetric_passive", "client",
+                                  "server", "broadcast", "control", "private"};
+    return names[mode & 0x7];
+}
+
+static void TimingInitDataFree(void *data) {
+    timing_state_t *state = (timing_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        HashMapDestroy(&state->exchanges);
+        duckdb_free(state);
+    }
+}
+
+static void TimingInit(duckdb_init_info info) {
+    pcap_path_bind_t *bind = (pcap_path_bind_t *)duckdb_init_get_bind_data(info);
+
+    timing_state_t *state = (timing_state_t *)duckdb_malloc(sizeof(timing_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(timing_state_t));
+    if (!HashMapInit(&state->exchanges, sizeof(ptp_state_key_t), sizeof(ptp_state_t))) {
+        duckdb_free(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        TimingInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, TimingInitDataFree);
+}
+
+// PTP timestamps are 48-bit seconds followed by 32-bit nanoseconds
+static uint64_t PtpTimestampNs(const uint8_t *p) {
+    return PacketRead48(p) * 1000000000ULL + PacketRead32(p + 6);
+}
+
+static int ParsePtpMessage(const uint8_t *p, uint32_t len, ptp_message_t *msg) {
+    if (len < PTP_HEADER_LEN) {
+        return 0;
+    }
+    memset(msg, 0, sizeof(ptp_message_t));
+    msg->message_type = p[0] & 0x0F;
+    msg->version = p[1] & 0x0F;
+    if (msg->version != 2) {
+        return 0;
+    }
+    msg->domain = p[4];
+    msg->two_step = (p[6] & PTP_FLAG_TWO_STEP) != 0;
+    msg->correction = (int64_t)PacketRead64(p + 8);
+    msg->port_identity = p + 20;
+    msg->sequence_id = PacketRead16(p + 30);
+
+    switch (msg->message_type) {
+    case PTP_PDELAY_RESP:
+    case PTP_DELAY_RESP:
+    case PTP_PDELAY_RESP_FOLLOW_UP:
+        if (len >= PTP_HEADER_LEN + 20) {
+            msg->requesting_identity = p + PTP_HEADER_LEN + 10;
+        }
+        // fall through
+    case PTP_SYNC:
+    case PTP_DELAY_REQ:
+    case PTP_PDELAY_REQ:
+    case PTP_FOLLOW_UP:
+    case PTP_ANNOUNCE:
+        if (len >= PTP_HEADER_LEN + 10) {
+            msg->message_timestamp_ns = PtpTimestampNs(p + PTP_HEADER_LEN);
+            msg->has_timestamp = 1;
+        }
+        break;
+    default:
+        break;
+    }
+    return 1;
+}
+
+static ptp_state_t *PtpState(timing_state_t *state, uint8_t kind, uint8_t domain, const uint8_t *identity,
+                             int create) {
+    ptp_state_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.kind = kind;
+    key.domain = domain;
+    memcpy(key.port_identity, identity, sizeof(key.port_identity));
+    if (!create) {
+        return (ptp_state_t *)HashMapFind(&state->exchanges, &key);
+    }
+    int is_new;
+    return (ptp_state_t *)HashMapInsert(&state->exchanges, &key, &is_new);
+}
+
+// Update exchange state with a message captured at capture_ns. Sets *offset and
+// *delay (in ns) and returns a bitmask of which estimates are valid.
+static int PtpTrackExchange(timing_state_t *state, const ptp_message_t *msg, uint64_t capture_ns, double *offset,
+                            double *delay) {
+    ptp_state_t *entry;
+
+    switch (msg->message_type) {
+    case PTP_SYNC:
+        entry = PtpState(state, PTP_STATE_SYNC, msg->domain, msg->port_identity, 1);
+        if (!entry) {
+            return 0;
+        }
+        entry->sequence_id = msg->sequence_id;
+        entry->t2 = capture_ns;
+        entry->correction = msg->correction;
+        entry->has_t2 = 1;
+        // One-step clocks carry the precise origin timestamp in the Sync itself
+        entry->has_t1 = !msg->two_step && msg->has_timestamp;
+        entry->t1 = msg->message_timestamp_ns;
+        return 0;
+    case PTP_FOLLOW_UP:
+        entry = PtpState(state, PTP_STATE_SYNC, msg->domain, msg->port_identity, 0);
+        if (entry && entry->has_t2 && entry->sequence_id == msg->sequence_id && msg->has_timestamp) {
+            entry->t1 = msg->message_timestamp_ns;
+            entry->correction += msg->correction;
+            entry->has_t1 = 1;
+        }
+        return 0;
+    case PTP_DELAY_REQ:
+        entry = PtpState(state, PTP_STATE_DELAY_REQ, msg->domain, msg->port_identity, 1);
+        if (!entry) {
+            return 0;
+        }
+        entry->sequence_id = msg->sequence_id;
+        entry->t3 = capture_ns;
+        entry->has_t1 = 1;
+        return 0;
+    case PTP_DELAY_RESP: {
+        if (!msg->requesting_identity || !msg->has_timestamp) {
+            return 0;
+        }
+        ptp_state_t *request = PtpState(state, PTP_STATE_DELAY_REQ, msg->domain, msg->requesting_identity, 0);
+        if (!request || !request->has_t1 || request->sequence_id != msg->sequence_id) {
+            return 0;
+        }
+        uint64_t t3 = request->t3;
+        request->has_t1 = 0;
+
+        ptp_state_t *sync = PtpState(state, PTP_STATE_SYNC, msg->domain, msg->port_identity, 0);
+        if (!sync || !sync->has_t1 || !sync->has_t2) {
+            return 0;
+        }
+        // master-to-slave and slave-to-master delays, corrections removed
+        double ms = (double)(int64_t)(sync->t2 - sync->t1) - (double)sync->correction / 65536.0;
+        double sm = (double)(int64_t)(msg->message_timestamp_ns - t3) - (double)msg->correction / 65536.0;
+        *offset = (ms - sm) / 2.0;
+        *delay = (ms + sm) / 2.0;
+        return 3;
+    }
+    case PTP_PDELAY_REQ:
+        entry = PtpState(state, PTP_STATE_PDELAY, msg->domain, msg->port_identity, 1);
+        if (!entry) {
+            return 0;
+        }
+        memset(entry, 0, sizeof(ptp_state_t));
+        entry->sequence_id = msg->sequence_id;
+        entry->t1 = capture_ns;
+        entry->has_t1 = 1;
+        return 0;
+    case PTP_PDELAY_RESP:
+        if (!msg->requesting_identity) {
+            return 0;
+        }
+        entry = PtpState(state, PTP_STATE_PDELAY, msg->domain, msg->requesting_identity, 0);
+        if (!entry || !entry->has_t1 || entry->sequence_id != msg->sequence_id) {
+            return 0;
+        }
+        entry->t2 = msg->message_timestamp_ns;
+        entry->t4 = capture_ns;
+        entry->correction = msg->correction;
+        entry->has_t2 = 1;
+        if (!msg->two_step) {
+            // One-step responders fold the turnaround time into correctionField
+            *delay = ((double)(int64_t)(entry->t4 - entry->t1) - (double)entry->correction / 65536.0) / 2.0;
+            entry->has_t1 = 0;
+            return 2;
+        }
+        return 0;
+    case PTP_PDELAY_RESP_FOLLOW_UP:
+        if (!msg->requesting_identity || !msg->has_timestamp) {
+            return 0;
+        }
+        entry = PtpState(state, PTP_STATE_PDELAY, msg->domain, msg->requesting_identity, 0);
+        if (!entry || !entry->has_t1 || !entry->has_t2 || entry->sequence_id != msg->sequence_id) {
+            return 0;
+        }
+        *delay = ((double)(int64_t)(entry->t4 - entry->t1) - (double)(int64_t)(msg->message_timestamp_ns - entry->t2) -
+                  (double)(entry->correction + msg->correction) / 65536.0) /
+                 2.0;
+        entry->has_t1 = 0;
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+static void FormatClockIdentity(const uint8_t *identity, char *out, size_t out_len) {
+    snprintf(out, out_len, "%02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x", identity[0], identity[1], identity[2],
+             identity[3], identity[4], identity[5], identity[6], identity[7]);
+}
+
+// Locate the PTP message inside a packet (Layer 2 or UDP transport)
+static int FindPtpPayload(const packet_info_t *pkt, const uint8_t **payload, uint32_t *payload_len) {
+    if (pkt->ethertype == ETHERTYPE_PTP) {
+        *payload = pkt->l3;
+        *payload_len = pkt->l3_len;
+        return 1;
+    }
+    if (pkt->ip_proto == IPPROTO_NUM_UDP && pkt->payload &&
+        (pkt->dst_port == PTP_EVENT_PORT || pkt->dst_port == PTP_GENERAL_PORT)) {
+        *payload = pkt->payload;
+        *payload_len = pkt->payload_len;
+        return 1;
+    }
+    return 0;
+}
+
+static void PtpBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "domain", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "message_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "version", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "sequence_id", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "clock_identity", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "port_number", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "two_step", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "correction_ns", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "message_timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "requesting_clock_identity", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "requesting_port_number", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "offset_ns", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "mean_path_delay_ns", DUCKDB_TYPE_DOUBLE);
+}
+
+static void PtpFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    timing_state_t *state = (timing_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[PTP_COL_COUNT];
+    for (idx_t i = 0; i < PTP_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(vectors[PTP_COL_TIMESTAMP]);
+    uint8_t *domain_data = (uint8_t *)duckdb_vector_get_data(vectors[PTP_COL_DOMAIN]);
+    uint8_t *version_data = (uint8_t *)duckdb_vector_get_data(vectors[PTP_COL_VERSION]);
+    uint16_t *sequence_data = (uint16_t *)duckdb_vector_get_data(vectors[PTP_COL_SEQUENCE_ID]);
+    uint16_t *port_data = (uint16_t *)duckdb_vector_get_data(vectors[PTP_COL_PORT_NUMBER]);
+    bool *two_step_data = (bool *)duckdb_vector_get_data(vectors[PTP_COL_TWO_STEP]);
+    double *correction_data = (double *)duckdb_vector_get_data(vectors[PTP_COL_CORRECTION]);
+    uint64_t *message_ts_data = (uint64_t *)duckdb_vector_get_data(vectors[PTP_COL_MESSAGE_TIMESTAMP]);
+    uint16_t *requesting_port_data = (uint16_t *)duckdb_vector_get_data(vectors[PTP_COL_REQUESTING_PORT_NUMBER]);
+    double *offset_data = (double *)duckdb_vector_get_data(vectors[PTP_COL_OFFSET]);
+    double *delay_data = (double *)duckdb_vector_get_data(vectors[PTP_COL_MEAN_PATH_DELAY]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    ptp_message_t msg;
+    char identity[24];
+
+    while (row_count < max_rows && PcapSourceNext(state->source, &packet)) {
+        const uint8_t *payload;
+        uint32_t payload_len;
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) ||
+            !FindPtpPayload(&pkt, &payload, &payload_len) || !ParsePtpMessage(payload, payload_len, &msg)) {
+            continue;
+        }
+
+        idx_t row = row_count++;
+        timestamp_data[row] = packet.timestamp_ns;
+        domain_data[row] = msg.domain;
+        duckdb_vector_assign_string_element(vectors[PTP_COL_MESSAGE_TYPE], row, PtpMessageTypeName(msg.message_type));
+        version_data[row] = msg.version;
+        sequence_data[row] = msg.sequence_id;
+        FormatClockIdentity(msg.port_identity, identity, sizeof(identity));
+        duckdb_vector_assign_string_element(vectors[PTP_COL_CLOCK_IDENTITY], row, identity);
+        port_data[row] = PacketRead16(msg.port_identity + 8);
+        two_step_data[row] = msg.two_step;
+        correction_data[row] = (double)msg.correction / 65536.0;
+
+        if (msg.has_timestamp) {
+            message_ts_data[row] = msg.message_timestamp_ns;
+        } else {
+            PcapVectorSetNull(vectors[PTP_COL_MESSAGE_TIMESTAMP], row);
+        }
+        if (msg.requesting_identity) {
+            FormatClockIdentity(msg.requesting_identity, identity, sizeof(identity));
+            duckdb_vector_assign_string_element(vectors[PTP_COL_REQUESTING_CLOCK_IDENTITY], row, identity);
+            requesting_port_data[row] = PacketRead16(msg.requesting_identity + 8);
+        } else {
+            PcapVectorSetNull(vectors[PTP_COL_REQUESTING_CLOCK_IDENTITY], row);
+            PcapVectorSetNull(vectors[PTP_COL_REQUESTING_PORT_NUMBER], row);
+        }
+
+        double offset = 0, delay = 0;
+        int estimates = PtpTrackExchange(state, &msg, packet.timestamp_ns, &offset, &delay);
+        if (estimates & 1) {
+            offset_data[row] = offset;
+        } else {
+            PcapVectorSetNull(vectors[PTP_COL_OFFSET], row);
+        }
+        if (estimates & 2) {
+            delay_data[row] = delay;
+        } else {
+            PcapVectorSetNull(vectors[PTP_COL_MEAN_PATH_DELAY], row);
+        }
+    }
+
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+// Convert a 64-bit NTP timestamp (32.32 seconds since 1900) to Unix nanoseconds.
+// Era 1 (after February 2036) is assumed for seconds values below 2^31.
+// Returns 0 for an unset (zero) timestamp and for times before 1970, which
+// Unix nanoseconds cannot hold.
+static int NtpTimestampNs(const uint8_t *p, uint64_t *ns) {
+    if (PacketRead64(p) == 0) {
+        return 0;
+    }
+    uint64_t seconds = PacketRead32(p);
+    uint64_t fraction = PacketRead32(p + 4);
+    if (seconds < 0x80000000ULL) {
+        seconds += 0x100000000ULL;
+    }
+    if (seconds < NTP_UNIX_EPOCH_OFFSET) {
+        return 0;
+    }
+    *ns = (seconds - NTP_UNIX_EPOCH_OFFSET) * 1000000000ULL + ((fraction * 1000000000ULL) >> 32);
+    return 1;
+}
+
+// NTP short format (16.16 seconds) in nanoseconds
+static double NtpShortNs(const uint8_t *p) {
+    return (double)PacketRead32(p) * 1e9 / 65536.0;
+}
+
+static void NtpSetTimestamp(duckdb_vector vector, idx_t row, const uint8_t *p) {
+    uint64_t ns;
+    if (!NtpTimestampNs(p, &ns)) {
+        PcapVectorSetNull(vector, row);
+        return;
+    }
+    ((uint64_t *)duckdb_vector_get_data(vector))[row] = ns;
+}
+
+static void NtpBind(duckdb_bind_info info) {
+    if (!PcapBindPath(info)) {
+        return;
+    }
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "leap", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "version", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "mode", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "stratum", DUCKDB_TYPE_UTINYINT);
+    PcapBindAddColumn(info, "poll", DUCKDB_TYPE_TINYINT);
+    PcapBindAddColumn(info, "precision", DUCKDB_TYPE_TINYINT);
+    PcapBindAddColumn(info, "root_delay_ns", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "root_dispersion_ns", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "reference_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "reference_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "origin_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "receive_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "transmit_ts_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "offset_ns", DUCKDB_TYPE_DOUBLE);
+    PcapBindAddColumn(info, "delay_ns", DUCKDB_TYPE_DOUBLE);
+}
+
+static void NtpFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    timing_state_t *state = (timing_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[NTP_COL_COUNT];
+    for (idx_t i = 0; i < NTP_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamp_data = (uint64_t *)duckdb_vector_get_data(vectors[NTP_COL_TIMESTAMP]);
+    uint16_t *src_port_data = (uint16_t *)duckdb_vector_get_data(vectors[NTP_COL_SRC_PORT]);
+    uint16_t *dst_port_data = (uint16_t *)duckdb_vector_get_data(vectors[NTP_COL_DST_PORT]);
+    uint8_t *leap_data = (uint8_t *)duckdb_vector_get_data(vectors[NTP_COL_LEAP]);
+    uint8_t *version_data = (uint8_t *)duckdb_vector_get_data(vectors[NTP_COL_VERSION]);
+    uint8_t *stratum_data = (uint8_t *)duckdb_vector_get_data(vectors[NTP_COL_STRATUM]);
+    int8_t *poll_data = (int8_t *)duckdb_vector_get_data(vectors[NTP_COL_POLL]);
+    int8_t *precision_data = (int8_t *)duckdb_vector_get_data(vectors[NTP_COL_PRECISION]);
+    double *root_delay_data = (double *)duckdb_vector_get_data(vectors[NTP_COL_ROOT_DELAY]);
+    double *root_dispersion_data = (double *)duckdb_vector_get_data(vectors[NTP_COL_ROOT_DISPERSION]);
+    double *offset_data = (double *)duckdb_vector_get_data(vectors[NTP_COL_OFFSET]);
+    double *delay_data = (double *)duckdb_vector_get_data(vectors[NTP_COL_DELAY]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    char text[64];
+
+    while (row_count < max_rows && PcapSourceNext(state->source, &packet)) {
+        if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) ||
+            pkt.ip_proto != IPPROTO_NUM_UDP || !pkt.payload || pkt.payload_len < 48 ||
+            (pkt.src_port != NTP_PORT && pkt.dst_port != NTP_PORT)) {
+            continue;
+        }
+        const uint8_t *p = pkt.payload;
+        uint8_t version = (p[0] >> 3) & 0x7;
+        uint8_t mode = p[0] & 0x7;
+        if (version < 1 || version > 4 || mode == 0 || mode == 6 || mode == 7) {
+            continue;
+        }
+
+        idx_t row = row_count++;
+        timestamp_data[row] = packet.timestamp_ns;
+        PacketFormatIp(pkt.ip_version, pkt.src_ip, text, sizeof(text));
+        duckdb_vector_assign_string_element(vectors[NTP_COL_SRC_IP], row, text);
+        PacketFormatIp(pkt.ip_version, pkt.dst_ip, text, sizeof(text));
+        duckdb_vector_assign_string_element(vectors[NTP_COL_DST_IP], row, text);
+        src_port_data[row] = pkt.src_port;
+        dst_port_data[row] = pkt.dst_port;
+        leap_data[row] = p[0] >> 6;
+        version_data[row] = version;
+        duckdb_vector_assign_string_element(vectors[NTP_COL_MODE], row, NtpModeName(mode));
+        stratum_data[row] = p[1];
+        poll_data[row] = (int8_t)p[2];
+        precision_data[row] = (int8_t)p[3];
+        root_delay_data[row] = NtpShortNs(p + 4);
+        root_dispersion_data[row] = NtpShortNs(p + 8);
+
+        // Stratum 0/1 reference ids are ASCII codes, otherwise an IPv4 address
+        // (or the first bytes of an MD5 hash of an IPv6 address)
+        if (p[1] <= 1) {
+            size_t len = 0;
+            while (len < 4 && p[12 + len] >= 0x20 && p[12 + len] < 0x7F) {
+                len++;
+            }
+            duckdb_vector_assign_string_element_len(vectors[NTP_COL_REFERENCE_ID], row, (const char *)p + 12, len);
+        } else {
+            PacketFormatIp(4, p + 12, text, sizeof(text));
+            duckdb_vector_assign_string_element(vectors[NTP_COL_REFERENCE_ID], row, text);
+        }
+
+        NtpSetTimestamp(vectors[NTP_COL_REFERENCE_TS], row, p + 16);
+        NtpSetTimestamp(vectors[NTP_COL_ORIGIN_TS], row, p + 24);
+        NtpSetTimestamp(vectors[NTP_COL_RECEIVE_TS], row, p + 32);
+        NtpSetTimestamp(vectors[NTP_COL_TRANSMIT_TS], row, p + 40);
+
+        // For server replies the capture time stands in for the client's
+        // destination timestamp (T4), which is exact when captured at the client
+        uint64_t t1, t2, t3;
+        if (mode == 4 && NtpTimestampNs(p + 24, &t1) && NtpTimestampNs(p + 32, &t2) && NtpTimestampNs(p + 40, &t3)) {
+            int64_t t4 = (int64_t)packet.timestamp_ns;
+            offset_data[row] = ((double)((int64_t)t2 - (int64_t)t1) + (double)((int64_t)t3 - t4)) / 2.0;
+            delay_data[row] = (double)(t4 - (int64_t)t1) - (double)((int64_t)t3 - (int64_t)t2);
+        } else {
+            PcapVectorSetNull(vectors[NTP_COL_OFFSET], row);
+            PcapVectorSetNull(vectors[NTP_COL_DELAY], row);
+        }
+    }
+
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterPtpFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_ptp", PtpBind, TimingInit, PtpFunction);
+}
+
+void RegisterNtpFunction(duckdb_connection connection) {
+    PcapRegisterPathFunction(connection, "pcap_ntp", NtpBind, TimingInit, NtpFunction);
+}
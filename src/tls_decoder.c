@@ -0,0 +1,976 @@
+#include "aead.h"
+#include "digest.h"
+#include "duckdb_extension.h"
+#include "hash_map.h"
+#include "message_stream.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "tls_decoder.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+#define TLS_RECORD_HEADER_LEN 5
+#define TLS_HANDSHAKE_HEADER_LEN 4
+#define TLS_RANDOM_LEN 32
+#define TLS_MASTER_SECRET_LEN 48
+#define TLS_MAX_SECRET_LEN SHA384_DIGEST_LEN
+#define TLS_MAX_KEY_LINE 512
+
+#define TLS_CONTENT_CHANGE_CIPHER_SPEC 20
+#define TLS_CONTENT_ALERT 21
+#define TLS_CONTENT_HANDSHAKE 22
+#define TLS_CONTENT_APPLICATION_DATA 23
+#define TLS_CONTENT_HEARTBEAT 24
+
+#define TLS_HANDSHAKE_CLIENT_HELLO 1
+#define TLS_HANDSHAKE_SERVER_HELLO 2
+#define TLS_HANDSHAKE_FINISHED 20
+#define TLS_HANDSHAKE_KEY_UPDATE 24
+
+#define TLS_EXT_SERVER_NAME 0
+#define TLS_EXT_SUPPORTED_VERSIONS 43
+
+#define TLS_VERSION_1_2 0x0303
+#define TLS_VERSION_1_3 0x0304
+
+// TLS 1.3 key phases of one direction
+#define TLS13_PHASE_HANDSHAKE 1
+#define TLS13_PHASE_APPLICATION 2
+
+typedef struct {
+    uint16_t id;
+    const char *name;
+    aead_algorithm_t aead;
+    uint8_t sha384;       // PRF / HKDF hash is SHA-384 rather than SHA-256
+} tls_cipher_t;
+
+// AEAD cipher suites; CBC and stream suites are reported but not decrypted
+static const tls_cipher_t tls_ciphers[] = {
+    {0x1301, "TLS_AES_128_GCM_SHA256", AEAD_AES_128_GCM, 0},
+    {0x1302, "TLS_AES_256_GCM_SHA384", AEAD_AES_256_GCM, 1},
+    {0x1303, "TLS_CHACHA20_POLY1305_SHA256", AEAD_CHACHA20_POLY1305, 0},
+    {0x009C, "TLS_RSA_WITH_AES_128_GCM_SHA256", AEAD_AES_128_GCM, 0},
+    {0x009D, "TLS_RSA_WITH_AES_256_GCM_SHA384", AEAD_AES_256_GCM, 1},
+    {0x009E, "TLS_DHE_RSA_WITH_AES_128_GCM_SHA256", AEAD_AES_128_GCM, 0},
+    {0x009F, "TLS_DHE_RSA_WITH_AES_256_GCM_SHA384", AEAD_AES_256_GCM, 1},
+    {0xC02B, "TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256", AEAD_AES_128_GCM, 0},
+    {0xC02C, "TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384", AEAD_AES_256_GCM, 1},
+    {0xC02F, "TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256", AEAD_AES_128_GCM, 0},
+    {0xC030, "TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384", AEAD_AES_256_GCM, 1},
+    {0xCCA8, "TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256", AEAD_CHACHA20_POLY1305, 0},
+    {0xCCA9, "TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256", AEAD_CHACHA20_POLY1305, 0},
+    {0xCCAA, "TLS_DHE_RSA_WITH_CHACHA20_POLY1305_SHA256", AEAD_CHACHA20_POLY1305, 0},
+};
+
+// ServerHello.random of a HelloRetryRequest (RFC 8446 section 4.1.3)
+static const uint8_t tls_hello_retry_random[TLS_RANDOM_LEN] = {
+    0xCF, 0x21, 0xAD, 0x74, 0xE5, 0x9A, 0x61, 0x11, 0xBE, 0x1D, 0x8C, 0x02, 0x1E, 0x65, 0xB8, 0x91,
+    0xC2, 0xA2, 0x11, 0x16, 0x7A, 0xBB, 0x8C, 0x5E, 0x07, 0x9E, 0x09, 0xE2, 0xC8, 0xA8, 0x33, 0x9C};
+
+// TLS 1.3 secrets of the NSS key log format
+enum {
+    TLS_SECRET_CLIENT_HANDSHAKE,
+    TLS_SECRET_SERVER_HANDSHAKE,
+    TLS_SECRET_CLIENT_TRAFFIC,
+    TLS_SECRET_SERVER_TRAFFIC,
+    TLS_SECRET_COUNT
+};
+
+static const char *const tls_secret_labels[TLS_SECRET_COUNT] = {
+    "CLIENT_HANDSHAKE_TRAFFIC_SECRET", "SERVER_HANDSHAKE_TRAFFIC_SECRET", "CLIENT_TRAFFIC_SECRET_0",
+    "SERVER_TRAFFIC_SECRET_0"};
+
+// Everything the key log holds for one client random
+typedef struct {
+    uint8_t master_secret[TLS_MASTER_SECRET_LEN];   // CLIENT_RANDOM (TLS 1.2)
+    uint8_t has_master_secret;
+    uint8_t secret_len[TLS_SECRET_COUNT];
+    uint8_t secrets[TLS_SECRET_COUNT][TLS_MAX_SECRET_LEN];
+} tls_keylog_entry_t;
+
+typedef struct {
+    char *filename;
+    hash_map_t keys;      // client random -> tls_keylog_entry_t
+} tls_bind_t;
+
+typedef struct {
+    aead_key_t *key;      // allocated on first use
+    uint8_t has_key;
+    uint8_t encrypted;    // records from here on are protected
+    uint8_t phase;        // TLS13_PHASE_*
+    uint8_t secret_len;
+    uint8_t secret[TLS_MAX_SECRET_LEN];   // current TLS 1.3 traffic secret
+    uint8_t iv[AEAD_NONCE_LEN];           // TLS 1.2 GCM uses only the 4-byte salt
+    uint64_t seq;
+    stream_buffer_t handshake;            // handshake message reassembly
+} tls_direction_t;
+
+typedef struct {
+    int client;           // flow endpoint of the client, -1 until known
+    uint16_t version;     // negotiated version, 0 until the ServerHello
+    uint16_t cipher_suite;
+    const tls_cipher_t *cipher;
+    const tls_keylog_entry_t *keys;
+    uint8_t has_client_random;
+    uint8_t has_server_random;
+    uint8_t client_random[TLS_RANDOM_LEN];
+    uint8_t server_random[TLS_RANDOM_LEN];
+    char server_name[TLS_MAX_SERVER_NAME];
+    tls_direction_t dir[2];
+} tls_session_t;
+
+typedef struct {
+    message_stream_t *stream;
+    const tls_bind_t *bind;
+    hash_map_t sessions;  // flow_key_t -> tls_session_t *
+    uint8_t plaintext[TLS_MAX_RECORD_BODY];
+} tls_state_t;
+
+enum {
+    TLS_COL_TIMESTAMP,
+    TLS_COL_SRC_IP,
+    TLS_COL_SRC_PORT,
+    TLS_COL_DST_IP,
+    TLS_COL_DST_PORT,
+    TLS_COL_FROM_CLIENT,
+    TLS_COL_VERSION,
+    TLS_COL_CIPHER_SUITE,
+    TLS_COL_SERVER_NAME,
+    TLS_COL_CONTENT_TYPE,
+    TLS_COL_LENGTH,
+    TLS_COL_ENCRYPTED,
+    TLS_COL_PLAINTEXT,
+    TLS_COL_COUNT
+};
+
+static void WriteBe64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Key schedules: TLS 1.2 PRF (RFC 5246 section 5), HKDF-Expand-Label
+// (RFC 8446 section 7.1)
+// ---------------------------------------------------------------------------
+
+static size_t HashLength(int sha384) {
+    return sha384 ? SHA384_DIGEST_LEN : SHA256_DIGEST_LEN;
+}
+
+static void Hmac(int sha384, const uint8_t *key, size_t key_len, const uint8_t *data, size_t len, uint8_t *out) {
+    size_t block_len = sha384 ? 128 : 64;
+    uint8_t pad[128];
+    uint8_t inner[SHA384_DIGEST_LEN];
+    // Keys here are secrets no longer than a hash block
+    memset(pad, 0x36, block_len);
+    for (size_t i = 0; i < key_len; i++) {
+        pad[i] ^= key[i];
+    }
+    if (sha384) {
+        sha512_ctx_t ctx;
+        Sha384Init(&ctx);
+        Sha512Update(&ctx, pad, block_len);
+        Sha512Update(&ctx, data, len);
+        Sha512Final(&ctx, inner);
+        for (size_t i = 0; i < block_len; i++) {
+            pad[i] ^= 0x36 ^ 0x5C;
+        }
+        Sha384Init(&ctx);
+        Sha512Update(&ctx, pad, block_len);
+        Sha512Update(&ctx, inner, SHA384_DIGEST_LEN);
+        Sha512Final(&ctx, out);
+    } else {
+        sha256_ctx_t ctx;
+        Sha256Init(&ctx);
+        Sha256Update(&ctx, pad, block_len);
+        Sha256Update(&ctx, data, len);
+        Sha256Final(&ctx, inner);
+        for (size_t i = 0; i < block_len; i++) {
+            pad[i] ^= 0x36 ^ 0x5C;
+        }
+        Sha256Init(&ctx);
+        Sha256Update(&ctx, pad, block_len);
+        Sha256Update(&ctx, inner, SHA256_DIGEST_LEN);
+        Sha256Final(&ctx, out);
+    }
+}
+
+// P_hash(secret, label + seed), TLS 1.2 key expansion
+static void Tls12Prf(int sha384, const uint8_t *secret, size_t secret_len, const char *label, const uint8_t *seed,
+                     size_t seed_len, uint8_t *out, size_t out_len) {
+    size_t hash_len = HashLength(sha384);
+    uint8_t label_seed[64 + 2 * TLS_RANDOM_LEN];
+    size_t label_len = strlen(label);
+    memcpy(label_seed, label, label_len);
+    memcpy(label_seed + label_len, seed, seed_len);
+    size_t label_seed_len = label_len + seed_len;
+
+    // buffer holds A(i) followed by label + seed
+    uint8_t buffer[SHA384_DIGEST_LEN + sizeof(label_seed)];
+    Hmac(sha384, secret, secret_len, label_seed, label_seed_len, buffer);
+    memcpy(buffer + hash_len, label_seed, label_seed_len);
+    while (out_len) {
+        uint8_t chunk[SHA384_DIGEST_LEN];
+        Hmac(sha384, secret, secret_len, buffer, hash_len + label_seed_len, chunk);
+        size_t take = out_len < hash_len ? out_len : hash_len;
+        memcpy(out, chunk, take);
+        out += take;
+        out_len -= take;
+        Hmac(sha384, secret, secret_len, buffer, hash_len, buffer);
+    }
+}
+
+// HKDF-Expand-Label(secret, label, "", out_len) for out_len <= 255
+static void HkdfExpandLabel(int sha384, const uint8_t *secret, size_t secret_len, const char *label, uint8_t *out,
+                            size_t out_len) {
+    size_t hash_len = HashLength(sha384);
+    // T(i-1) || HkdfLabel || i
+    uint8_t buffer[SHA384_DIGEST_LEN + 4 + 6 + 32 + 1 + 1];
+    size_t label_len = strlen(label);
+    size_t info_len = 0;
+    uint8_t *info = buffer + hash_len;
+    info[info_len++] = (uint8_t)(out_len >> 8);
+    info[info_len++] = (uint8_t)out_len;
+    info[info_len++] = (uint8_t)(6 + label_len);
+    memcpy(info + info_len, "tls13 ", 6);
+    info_len += 6;
+    memcpy(info + info_len, label, label_len);
+    info_len += label_len;
+    info[info_len++] = 0;   // empty context
+
+    uint8_t counter = 1;
+    size_t previous_len = 0;
+    while (out_len) {
+        uint8_t chunk[SHA384_DIGEST_LEN];
+        uint8_t *start = buffer + hash_len - previous_len;
+        info[info_len] = counter++;
+        Hmac(sha384, secret, secret_len, start, previous_len + info_len + 1, chunk);
+        size_t take = out_len < hash_len ? out_len : hash_len;
+        memcpy(out, chunk, take);
+        out += take;
+        out_len -= take;
+        memcpy(buffer, chunk, hash_len);
+        previous_len = hash_len;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Key log file (NSS SSLKEYLOGFILE format)
+// ---------------------------------------------------------------------------
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int HexDecode(const char *text, size_t len, uint8_t *out) {
+    for (size_t i = 0; i < len / 2; i++) {
+        int high = HexValue(text[2 * i]);
+        int low = HexValue(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return 0;
+        }
+        out[i] = (uint8_t)(high << 4 | low);
+    }
+    return 1;
+}
+
+// "<label> <client random> <secret>"; unknown labels and malformed lines are
+// ignored, as NSS specifies
+static void ParseKeyLogLine(hash_map_t *keys, char *line) {
+    char *random = strchr(line, ' ');
+    if (!random) {
+        return;
+    }
+    *random++ = '\0';
+    char *secret = strchr(random, ' ');
+    if (!secret) {
+        return;
+    }
+    *secret++ = '\0';
+    size_t secret_hex_len = strcspn(secret, " \t\r\n");
+
+    int master = strcmp(line, "CLIENT_RANDOM") == 0;
+    int slot = -1;
+    for (int i = 0; i < TLS_SECRET_COUNT; i++) {
+        if (strcmp(line, tls_secret_labels[i]) == 0) {
+            slot = i;
+        }
+    }
+    if (!master && slot < 0) {
+        return;
+    }
+
+    uint8_t client_random[TLS_RANDOM_LEN];
+    uint8_t value[TLS_MAX_SECRET_LEN];
+    size_t value_len = secret_hex_len / 2;
+    if (strlen(random) != 2 * TLS_RANDOM_LEN || !HexDecode(random, 2 * TLS_RANDOM_LEN, client_random) ||
+        secret_hex_len % 2 || value_len > TLS_MAX_SECRET_LEN || !HexDecode(secret, secret_hex_len, value)) {
+        return;
+    }
+    if (master && value_len != TLS_MASTER_SECRET_LEN) {
+        return;
+    }
+
+    int is_new;
+    tls_keylog_entry_t *entry = (tls_keylog_entry_t *)HashMapInsert(keys, client_random, &is_new);
+    if (!entry) {
+        return;
+    }
+    if (master) {
+        memcpy(entry->master_secret, value, value_len);
+        entry->has_master_secret = 1;
+    } else {
+        memcpy(entry->secrets[slot], value, value_len);
+        entry->secret_len[slot] = (uint8_t)value_len;
+    }
+}
+
+static const char *LoadKeyLog(tls_bind_t *bind, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return "Failed to open TLS key log file";
+    }
+    char line[TLS_MAX_KEY_LINE];
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            // Longer than any valid entry: skip the rest of it
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n') {
+            }
+            continue;
+        }
+        if (line[0] != '#') {
+            ParseKeyLogLine(&bind->keys, line);
+        }
+    }
+    fclose(file);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Record protection
+// ---------------------------------------------------------------------------
+
+static const tls_cipher_t *FindCipher(uint16_t id) {
+    for (size_t i = 0; i < sizeof(tls_ciphers) / sizeof(tls_ciphers[0]); i++) {
+        if (tls_ciphers[i].id == id) {
+            return &tls_ciphers[i];
+        }
+    }
+    return NULL;
+}
+
+static void InstallKey(tls_direction_t *dir, aead_algorithm_t aead, const uint8_t *key, const uint8_t *iv,
+                       size_t iv_len) {
+    dir->seq = 0;
+    dir->has_key = 0;
+    if (!dir->key) {
+        dir->key = (aead_key_t *)duckdb_malloc(sizeof(aead_key_t));
+        if (!dir->key) {
+            return;
+        }
+    }
+    AeadInit(dir->key, aead, key);
+    memset(dir->iv, 0, sizeof(dir->iv));
+    memcpy(dir->iv, iv, iv_len);
+    dir->has_key = 1;
+}
+
+// TLS 1.2 ChangeCipherSpec: the sender's following records are protected
+// with keys expanded from the master secret
+static void StartProtection12(tls_session_t *session, int direction) {
+    tls_direction_t *dir = &session->dir[direction];
+    dir->encrypted = 1;
+    dir->seq = 0;
+    dir->has_key = 0;
+    const tls_cipher_t *cipher = session->cipher;
+    if (!cipher || !session->keys || !session->keys->has_master_secret || !session->has_server_random ||
+        session->client < 0) {
+        return;
+    }
+    size_t key_len = AeadKeyLength(cipher->aead);
+    size_t iv_len = cipher->aead == AEAD_CHACHA20_POLY1305 ? AEAD_NONCE_LEN : 4;
+    uint8_t seed[2 * TLS_RANDOM_LEN];
+    memcpy(seed, session->server_random, TLS_RANDOM_LEN);
+    memcpy(seed + TLS_RANDOM_LEN, session->client_random, TLS_RANDOM_LEN);
+    uint8_t key_block[2 * AEAD_MAX_KEY_LEN + 2 * AEAD_NONCE_LEN];
+    Tls12Prf(cipher->sha384, session->keys->master_secret, TLS_MASTER_SECRET_LEN, "key expansion", seed,
+             sizeof(seed), key_block, 2 * (key_len + iv_len));
+
+    // client_write_key, server_write_key, client_write_IV, server_write_IV
+    int from_server = direction != session->client;
+    InstallKey(dir, cipher->aead, key_block + (from_server ? key_len : 0),
+               key_block + 2 * key_len + (from_server ? iv_len : 0), iv_len);
+}
+
+static void InstallSecret13(tls_session_t *session, int direction, const uint8_t *secret, size_t secret_len) {
+    tls_direction_t *dir = &session->dir[direction];
+    const tls_cipher_t *cipher = session->cipher;
+    dir->seq = 0;
+    dir->has_key = 0;
+    dir->secret_len = 0;
+    if (!cipher || secret_len != HashLength(cipher->sha384)) {
+        return;
+    }
+    memcpy(dir->secret, secret, secret_len);
+    dir->secret_len = (uint8_t)secret_len;
+    uint8_t key[AEAD_MAX_KEY_LEN];
+    uint8_t iv[AEAD_NONCE_LEN];
+    HkdfExpandLabel(cipher->sha384, secret, secret_len, "key", key, AeadKeyLength(cipher->aead));
+    HkdfExpandLabel(cipher->sha384, secret, secret_len, "iv", iv, AEAD_NONCE_LEN);
+    InstallKey(dir, cipher->aead, key, iv, AEAD_NONCE_LEN);
+}
+
+// Switch a TLS 1.3 direction to the key log secret of a phase
+static void EnterPhase13(tls_session_t *session, int direction, uint8_t phase) {
+    tls_direction_t *dir = &session->dir[direction];
+    dir->encrypted = 1;
+    dir->phase = phase;
+    int from_client = direction == session->client;
+    int slot = phase == TLS13_PHASE_HANDSHAKE
+                   ? (from_client ? TLS_SECRET_CLIENT_HANDSHAKE : TLS_SECRET_SERVER_HANDSHAKE)
+                   : (from_client ? TLS_SECRET_CLIENT_TRAFFIC : TLS_SECRET_SERVER_TRAFFIC);
+    if (!session->keys || !session->keys->secret_len[slot]) {
+        dir->has_key = 0;
+        dir->secret_len = 0;
+        return;
+    }
+    InstallSecret13(session, direction, session->keys->secrets[slot], session->keys->secret_len[slot]);
+}
+
+// Decrypt a protected record into plaintext. Returns 1 on success with the
+// inner content type and plaintext length set.
+static int DecryptRecord(const tls_session_t *session, tls_direction_t *dir, const uint8_t *record, size_t len,
+                         uint8_t *plaintext, uint8_t *content_type, size_t *plaintext_len) {
+    if (!dir->has_key) {
+        return 0;
+    }
+    const uint8_t *body = record + TLS_RECORD_HEADER_LEN;
+    size_t body_len = len - TLS_RECORD_HEADER_LEN;
+    uint64_t seq = dir->seq++;
+    uint8_t nonce[AEAD_NONCE_LEN];
+    uint8_t aad[13];
+    size_t aad_len;
+    const uint8_t *ciphertext = body;
+    size_t ciphertext_len;
+    int explicit_nonce = session->version != TLS_VERSION_1_3 && session->cipher->aead != AEAD_CHACHA20_POLY1305;
+
+    if (explicit_nonce) {
+        // TLS 1.2 AES-GCM: 4-byte implicit salt + 8-byte explicit nonce
+        if (body_len < 8 + AEAD_TAG_LEN) {
+            return 0;
+        }
+        memcpy(nonce, dir->iv, 4);
+        memcpy(nonce + 4, body, 8);
+        ciphertext = body + 8;
+        ciphertext_len = body_len - 8 - AEAD_TAG_LEN;
+    } else {
+        // Per-record nonce: IV xor the 64-bit sequence number
+        if (body_len < AEAD_TAG_LEN) {
+            return 0;
+        }
+        memcpy(nonce, dir->iv, AEAD_NONCE_LEN);
+        for (int i = 0; i < 8; i++) {
+            nonce[4 + i] ^= (uint8_t)(seq >> (56 - 8 * i));
+        }
+        ciphertext_len = body_len - AEAD_TAG_LEN;
+    }
+
+    if (session->version == TLS_VERSION_1_3) {
+        memcpy(aad, record, TLS_RECORD_HEADER_LEN);
+        aad_len = TLS_RECORD_HEADER_LEN;
+    } else {
+        WriteBe64(aad, seq);
+        memcpy(aad + 8, record, 3);
+        aad[11] = (uint8_t)(ciphertext_len >> 8);
+        aad[12] = (uint8_t)ciphertext_len;
+        aad_len = 13;
+    }
+    if (!AeadOpen(dir->key, nonce, aad, aad_len, ciphertext, ciphertext_len, ciphertext + ciphertext_len,
+                  plaintext)) {
+        return 0;
+    }
+
+    *content_type = record[0];
+    if (session->version == TLS_VERSION_1_3) {
+        // TLSInnerPlaintext: content, real type, zero padding
+        while (ciphertext_len && plaintext[ciphertext_len - 1] == 0) {
+            ciphertext_len--;
+        }
+        if (!ciphertext_len) {
+            return 0;
+        }
+        *content_type = plaintext[--ciphertext_len];
+    }
+    *plaintext_len = ciphertext_len;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Handshake messages
+// ---------------------------------------------------------------------------
+
+static void CopyServerName(tls_session_t *session, const uint8_t *name, size_t len) {
+    if (len >= TLS_MAX_SERVER_NAME) {
+        len = TLS_MAX_SERVER_NAME - 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        // Host names are ASCII; keep the column valid UTF-8 regardless
+        session->server_name[i] = name[i] >= 0x20 && name[i] < 0x7F ? (char)name[i] : '?';
+    }
+    session->server_name[len] = '\0';
+}
+
+// Skip the length-prefixed vectors ahead of the extensions. Returns the
+// extension block bounds, or 0 when there are none.
+static int ExtensionsRange(const uint8_t *body, size_t len, size_t pos, size_t *start, size_t *end) {
+    if (pos + 2 > len) {
+        return 0;
+    }
+    *start = pos + 2;
+    *end = *start + PacketRead16(body + pos);
+    if (*end > len) {
+        *end = len;
+    }
+    return 1;
+}
+
+static void ParseClientHello(const tls_state_t *state, tls_session_t *session, int direction, const uint8_t *body,
+                             size_t len) {
+    // legacy_version, random, session_id, cipher_suites, compression_methods, extensions
+    if (len < 2 + TLS_RANDOM_LEN + 1) {
+        return;
+    }
+    session->client = direction;
+    memcpy(session->client_random, body + 2, TLS_RANDOM_LEN);
+    session->has_client_random = 1;
+    session->keys = (const tls_keylog_entry_t *)HashMapFind(&state->bind->keys, session->client_random);
+
+    size_t pos = 2 + TLS_RANDOM_LEN;
+    pos += 1 + (size_t)body[pos];
+    if (pos + 2 > len) {
+        return;
+    }
+    pos += 2 + (size_t)PacketRead16(body + pos);
+    if (pos + 1 > len) {
+        return;
+    }
+    pos += 1 + (size_t)body[pos];
+    size_t end;
+    if (!ExtensionsRange(body, len, pos, &pos, &end)) {
+        return;
+    }
+    while (pos + 4 <= end) {
+        uint16_t type = PacketRead16(body + pos);
+        size_t ext_len = PacketRead16(body + pos + 2);
+        pos += 4;
+        if (pos + ext_len > end) {
+            break;
+        }
+        // server_name_list: the host_name entry (type 0)
+        if (type == TLS_EXT_SERVER_NAME && ext_len >= 5 && body[pos + 2] == 0) {
+            size_t name_len = PacketRead16(body + pos + 3);
+            if (5 + name_len <= ext_len) {
+                CopyServerName(session, body + pos + 5, name_len);
+            }
+        }
+        pos += ext_len;
+    }
+}
+
+static void ParseServerHello(tls_session_t *session, int direction, const uint8_t *body, size_t len) {
+    // legacy_version, random, session_id, cipher_suite, compression_method, extensions
+    if (len < 2 + TLS_RANDOM_LEN + 1) {
+        return;
+    }
+    if (memcmp(body + 2, tls_hello_retry_random, TLS_RANDOM_LEN) == 0) {
+        // A second ClientHello follows
+        return;
+    }
+    uint16_t version = PacketRead16(body);
+    size_t pos = 2 + TLS_RANDOM_LEN;
+    pos += 1 + (size_t)body[pos];
+    if (pos + 3 > len) {
+        return;
+    }
+    uint16_t cipher_suite = PacketRead16(body + pos);
+    pos += 3;
+    size_t end;
+    if (ExtensionsRange(body, len, pos, &pos, &end)) {
+        while (pos + 4 <= end) {
+            uint16_t type = PacketRead16(body + pos);
+            size_t ext_len = PacketRead16(body + pos + 2);
+            pos += 4;
+            if (pos + ext_len > end) {
+                break;
+            }
+            if (type == TLS_EXT_SUPPORTED_VERSIONS && ext_len == 2) {
+                version = PacketRead16(body + pos);
+            }
+            pos += ext_len;
+        }
+    }
+
+    if (session->client < 0) {
+        session->client = 1 - direction;
+    }
+    memcpy(session->server_random, body + 2, TLS_RANDOM_LEN);
+    session->has_server_random = 1;
+    session->version = version;
+    session->cipher_suite = cipher_suite;
+    session->cipher = FindCipher(cipher_suite);
+    if (version == TLS_VERSION_1_3) {
+        // Everything after the ServerHello is protected, in both directions
+        EnterPhase13(session, 0, TLS13_PHASE_HANDSHAKE);
+        EnterPhase13(session, 1, TLS13_PHASE_HANDSHAKE);
+    }
+}
+
+static void HandshakeMessage(const tls_state_t *state, tls_session_t *session, int direction, uint8_t type,
+                             const uint8_t *body, size_t len) {
+    tls_direction_t *dir = &session->dir[direction];
+    switch (type) {
+    case TLS_HANDSHAKE_CLIENT_HELLO:
+        if (!dir->encrypted) {
+            ParseClientHello(state, session, direction, body, len);
+        }
+        break;
+    case TLS_HANDSHAKE_SERVER_HELLO:
+        if (!dir->encrypted) {
+            ParseServerHello(session, direction, body, len);
+        }
+        break;
+    case TLS_HANDSHAKE_FINISHED:
+        if (session->version == TLS_VERSION_1_3 && dir->phase == TLS13_PHASE_HANDSHAKE) {
+            EnterPhase13(session, direction, TLS13_PHASE_APPLICATION);
+        }
+        break;
+    case TLS_HANDSHAKE_KEY_UPDATE:
+        if (session->version == TLS_VERSION_1_3 && dir->phase == TLS13_PHASE_APPLICATION && dir->secret_len) {
+            uint8_t secret[TLS_MAX_SECRET_LEN];
+            HkdfExpandLabel(session->cipher->sha384, dir->secret, dir->secret_len, "traffic upd", secret,
+                            dir->secret_len);
+            InstallSecret13(session, direction, secret, dir->secret_len);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Reassemble handshake messages, which may span records or share one
+static void HandshakeData(const tls_state_t *state, tls_session_t *session, int direction, const uint8_t *data,
+                          size_t len) {
+    stream_buffer_t *buffer = &session->dir[direction].handshake;
+    if (!StreamBufferAppend(buffer, data, len, TLS_MAX_HANDSHAKE_BUFFER)) {
+        StreamBufferFree(buffer);
+        return;
+    }
+    size_t pos = 0;
+    while (buffer->len - pos >= TLS_HANDSHAKE_HEADER_LEN) {
+        const uint8_t *message = buffer->data + pos;
+        size_t message_len = ((size_t)message[1] << 16) | ((size_t)message[2] << 8) | message[3];
+        if (TLS_HANDSHAKE_HEADER_LEN + message_len > buffer->len - pos) {
+            break;
+        }
+        HandshakeMessage(state, session, direction, message[0], message + TLS_HANDSHAKE_HEADER_LEN, message_len);
+        pos += TLS_HANDSHAKE_HEADER_LEN + message_len;
+    }
+    if (pos == buffer->len) {
+        StreamBufferFree(buffer);
+    } else {
+        StreamBufferConsume(buffer, pos);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table function
+// ---------------------------------------------------------------------------
+
+static void FreeSession(tls_session_t *session) {
+    for (int i = 0; i < 2; i++) {
+        if (session->dir[i].key) {
+            duckdb_free(session->dir[i].key);
+        }
+        StreamBufferFree(&session->dir[i].handshake);
+    }
+    duckdb_free(session);
+}
+
+static void TlsBindDataFree(void *data) {
+    tls_bind_t *bind = (tls_bind_t *)data;
+    if (bind) {
+        if (bind->filename) {
+            duckdb_free(bind->filename);
+        }
+        HashMapDestroy(&bind->keys);
+        duckdb_free(bind);
+    }
+}
+
+static void TlsInitDataFree(void *data) {
+    tls_state_t *state = (tls_state_t *)data;
+    if (state) {
+        MessageStreamClose(state->stream);
+        if (state->sessions.slots) {
+            size_t position = 0;
+            const void *key;
+            void *value;
+            while (HashMapNext(&state->sessions, &position, &key, &value)) {
+                FreeSession(*(tls_session_t **)value);
+            }
+        }
+        HashMapDestroy(&state->sessions);
+        duckdb_free(state);
+    }
+}
+
+static void TlsBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    tls_bind_t *bind = (tls_bind_t *)duckdb_malloc(sizeof(tls_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    memset(bind, 0, sizeof(tls_bind_t));
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, TlsBindDataFree);
+    if (!HashMapInit(&bind->keys, TLS_RANDOM_LEN, sizeof(tls_keylog_entry_t))) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        return;
+    }
+
+    duckdb_value keylog = duckdb_bind_get_named_parameter(info, "keylog");
+    if (keylog) {
+        char *path = duckdb_is_null_value(keylog) ? NULL : duckdb_get_varchar(keylog);
+        duckdb_destroy_value(&keylog);
+        if (path) {
+            const char *error = LoadKeyLog(bind, path);
+            duckdb_free(path);
+            if (error) {
+                duckdb_bind_set_error(info, error);
+                return;
+            }
+        }
+    }
+
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "from_client", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "version", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "cipher_suite", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "server_name", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "content_type", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "length", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "encrypted", DUCKDB_TYPE_BOOLEAN);
+    PcapBindAddColumn(info, "plaintext", DUCKDB_TYPE_BLOB);
+}
+
+static size_t TlsFrame(const uint8_t *data, size_t avail) {
+    if (avail < TLS_RECORD_HEADER_LEN) {
+        return 0;
+    }
+    // Known content type and an SSL 3.0 - TLS 1.3 record version
+    if (data[0] < TLS_CONTENT_CHANGE_CIPHER_SPEC || data[0] > TLS_CONTENT_HEARTBEAT || data[1] != 3 || data[2] > 4) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    size_t len = PacketRead16(data + 3);
+    if (len > TLS_MAX_RECORD_BODY) {
+        return MESSAGE_FRAME_INVALID;
+    }
+    return TLS_RECORD_HEADER_LEN + len;
+}
+
+static void TlsInit(duckdb_init_info info) {
+    // Any TCP port: the key log, not the port, decides what is TLS
+    static const message_protocol_t protocol = {0, 0, TlsFrame, TLS_RECORD_HEADER_LEN + TLS_MAX_RECORD_BODY};
+    tls_bind_t *bind = (tls_bind_t *)duckdb_init_get_bind_data(info);
+
+    tls_state_t *state = (tls_state_t *)duckdb_malloc(sizeof(tls_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(tls_state_t));
+    state->bind = bind;
+    if (!HashMapInit(&state->sessions, sizeof(flow_key_t), sizeof(tls_session_t *))) {
+        TlsInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    const char *error = MessageStreamOpen(bind->filename, &protocol, &state->stream);
+    if (error) {
+        TlsInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, TlsInitDataFree);
+}
+
+// Session of the record's connection; one is started by a plaintext hello
+static tls_session_t *FindSession(tls_state_t *state, const message_t *msg) {
+    tls_session_t **slot = (tls_session_t **)HashMapFind(&state->sessions, msg->key);
+    if (slot) {
+        return *slot;
+    }
+    const uint8_t *body = msg->data + TLS_RECORD_HEADER_LEN;
+    if (msg->data[0] != TLS_CONTENT_HANDSHAKE || msg->len <= TLS_RECORD_HEADER_LEN ||
+        (body[0] != TLS_HANDSHAKE_CLIENT_HELLO && body[0] != TLS_HANDSHAKE_SERVER_HELLO) ||
+        state->sessions.count >= TLS_MAX_SESSIONS) {
+        return NULL;
+    }
+    tls_session_t *session = (tls_session_t *)duckdb_malloc(sizeof(tls_session_t));
+    if (!session) {
+        return NULL;
+    }
+    memset(session, 0, sizeof(tls_session_t));
+    session->client = -1;
+    int is_new;
+    slot = (tls_session_t **)HashMapInsert(&state->sessions, msg->key, &is_new);
+    if (!slot) {
+        duckdb_free(session);
+        return NULL;
+    }
+    *slot = session;
+    return session;
+}
+
+static const char *VersionName(uint16_t version) {
+    switch (version) {
+    case 0x0300: return "SSL 3.0";
+    case 0x0301: return "TLS 1.0";
+    case 0x0302: return "TLS 1.1";
+    case TLS_VERSION_1_2: return "TLS 1.2";
+    case TLS_VERSION_1_3: return "TLS 1.3";
+    default: return NULL;
+    }
+}
+
+static const char *ContentTypeName(uint8_t content_type) {
+    switch (content_type) {
+    case TLS_CONTENT_CHANGE_CIPHER_SPEC: return "change_cipher_spec";
+    case TLS_CONTENT_ALERT: return "alert";
+    case TLS_CONTENT_HANDSHAKE: return "handshake";
+    case TLS_CONTENT_APPLICATION_DATA: return "application_data";
+    case TLS_CONTENT_HEARTBEAT: return "heartbeat";
+    default: return NULL;
+    }
+}
+
+static void TlsEmit(tls_state_t *state, duckdb_vector *vectors, idx_t row, const message_t *msg) {
+    const uint8_t *body = msg->data + TLS_RECORD_HEADER_LEN;
+    size_t body_len = msg->len - TLS_RECORD_HEADER_LEN;
+    uint8_t content_type = msg->data[0];
+    int encrypted = 0;
+    const uint8_t *plaintext = body;
+    size_t plaintext_len = body_len;
+
+    tls_session_t *session = FindSession(state, msg);
+    if (session) {
+        tls_direction_t *dir = &session->dir[msg->direction];
+        if (dir->encrypted && (session->version != TLS_VERSION_1_3 || content_type == TLS_CONTENT_APPLICATION_DATA)) {
+            // TLS 1.3 still sends ChangeCipherSpec (and early alerts) in the clear
+            encrypted = 1;
+            plaintext = NULL;
+            if (DecryptRecord(session, dir, msg->data, msg->len, state->plaintext, &content_type, &plaintext_len)) {
+                plaintext = state->plaintext;
+                if (session->version == TLS_VERSION_1_3 && content_type == TLS_CONTENT_HANDSHAKE) {
+                    HandshakeData(state, session, msg->direction, plaintext, plaintext_len);
+                }
+            }
+        } else if (content_type == TLS_CONTENT_CHANGE_CIPHER_SPEC) {
+            if (session->version != TLS_VERSION_1_3) {
+                StartProtection12(session, msg->direction);
+            }
+        } else if (content_type == TLS_CONTENT_HANDSHAKE) {
+            HandshakeData(state, session, msg->direction, body, body_len);
+        }
+    } else if (content_type == TLS_CONTENT_APPLICATION_DATA) {
+        // Mid-stream connection: application data is always protected
+        encrypted = 1;
+        plaintext = NULL;
+    }
+
+    char addr[64];
+    uint16_t port;
+    ((uint64_t *)duckdb_vector_get_data(vectors[TLS_COL_TIMESTAMP]))[row] = msg->timestamp_ns;
+    FlowFormatEndpoint(msg->key, msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[TLS_COL_SRC_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[TLS_COL_SRC_PORT]))[row] = port;
+    FlowFormatEndpoint(msg->key, 1 - msg->direction, addr, sizeof(addr), &port);
+    duckdb_vector_assign_string_element(vectors[TLS_COL_DST_IP], row, addr);
+    ((uint16_t *)duckdb_vector_get_data(vectors[TLS_COL_DST_PORT]))[row] = port;
+
+    if (session && session->client >= 0) {
+        ((bool *)duckdb_vector_get_data(vectors[TLS_COL_FROM_CLIENT]))[row] = msg->direction == session->client;
+    } else {
+        PcapVectorSetNull(vectors[TLS_COL_FROM_CLIENT], row);
+    }
+    PcapVectorAssignString(vectors[TLS_COL_VERSION], row, session ? VersionName(session->version) : NULL);
+    PcapVectorAssignString(vectors[TLS_COL_CIPHER_SUITE], row,
+                         session && session->cipher ? session->cipher->name : NULL);
+    PcapVectorAssignString(vectors[TLS_COL_SERVER_NAME], row, session ? session->server_name : NULL);
+    PcapVectorAssignString(vectors[TLS_COL_CONTENT_TYPE], row, ContentTypeName(content_type));
+    ((uint32_t *)duckdb_vector_get_data(vectors[TLS_COL_LENGTH]))[row] = (uint32_t)body_len;
+    ((bool *)duckdb_vector_get_data(vectors[TLS_COL_ENCRYPTED]))[row] = encrypted;
+    if (plaintext) {
+        duckdb_vector_assign_string_element_len(vectors[TLS_COL_PLAINTEXT], row, (const char *)plaintext,
+                                                plaintext_len);
+    } else {
+        PcapVectorSetNull(vectors[TLS_COL_PLAINTEXT], row);
+    }
+}
+
+static void TlsFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    tls_state_t *state = (tls_state_t *)duckdb_function_get_init_data(info);
+
+    duckdb_vector vectors[TLS_COL_COUNT];
+    for (idx_t i = 0; i < TLS_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    message_t msg;
+    while (row_count < max_rows && MessageStreamNext(state->stream, &msg)) {
+        TlsEmit(state, vectors, row_count++, &msg);
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterTlsFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_tls");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_table_function_add_named_parameter(function, "keylog", varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+
+    duckdb_table_function_set_bind(function, TlsBind);
+    duckdb_table_function_set_init(function, TlsInit);
+    duckdb_table_function_set_function(function, TlsFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
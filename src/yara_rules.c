@@ -0,0 +1,2077 @@
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "hash_map.h"
+#include "packet_decode.h"
+#include "pcap_reader.h"
+#include "pcap_source.h"
+#include "regex_engine.h"
+#include "yara_rules.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Returned by parse functions after setting parser->error
+#define YARA_NONE UINT32_MAX
+
+// Three-valued conditions: undefined values (stream contents that were not
+// kept, or not known when deciding which rules need string hits) propagate
+// as in YARA and only a definite true matches
+#define YARA_UNKNOWN 2
+
+// ---------------------------------------------------------------------------
+// Rules
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+} yara_range_t;
+
+// A string of a rule; its index is the pattern id in the compiled set
+typedef struct {
+    uint32_t rule;
+    uint32_t name;             // "$name" in the byte pool
+    uint32_t min_len;          // shortest and longest match
+    uint32_t max_len;          // UINT32_MAX when unbounded
+    uint8_t is_private;
+    uint8_t has_predicates;
+} yara_string_t;
+
+typedef struct {
+    uint32_t name;             // byte pool offsets
+    uint32_t tags;             // space-separated
+    uint32_t tags_len;
+    uint32_t condition;        // root node
+    uint8_t is_private;
+    yara_range_t strings;
+    yara_range_t predicates;
+} yara_rule_t;
+
+// `$a at N` or `$a in (low..high)`: a match of a fixed-length string starts
+// in [low, high]
+typedef struct {
+    uint32_t string;
+    uint64_t low;
+    uint64_t high;
+} yara_predicate_t;
+
+typedef enum {
+    YARA_NODE_TRUE,
+    YARA_NODE_FALSE,
+    YARA_NODE_AND,             // left: first child in the item pool, right: child count
+    YARA_NODE_OR,
+    YARA_NODE_NOT,             // left: child
+    YARA_NODE_STRING,          // left: string
+    YARA_NODE_PREDICATE,       // left: predicate
+    YARA_NODE_COMPARE,         // op: yara_compare_t, left and right: integer nodes
+    YARA_NODE_OF,              // op: yara_quantifier_t, left: first string in the item pool, right: count
+    YARA_NODE_INTEGER,         // value
+    YARA_NODE_COUNT,           // left: string
+    YARA_NODE_FILESIZE,
+    YARA_NODE_READ             // op: width in bytes, left: offset node
+} yara_node_type_t;
+
+typedef enum {
+    YARA_COMPARE_EQUAL,
+    YARA_COMPARE_NOT_EQUAL,
+    YARA_COMPARE_LESS,
+    YARA_COMPARE_LESS_EQUAL,
+    YARA_COMPARE_GREATER,
+    YARA_COMPARE_GREATER_EQUAL
+} yara_compare_t;
+
+typedef enum {
+    YARA_OF_ANY,
+    YARA_OF_ALL,
+    YARA_OF_NONE,
+    YARA_OF_AT_LEAST           // N of
+} yara_quantifier_t;
+
+// uint and int reads
+#define YARA_READ_BIG_ENDIAN 0x01
+#define YARA_READ_SIGNED 0x02
+
+typedef struct {
+    uint8_t type;              // yara_node_type_t
+    uint8_t op;
+    uint8_t read_flags;        // YARA_READ_* for YARA_NODE_READ
+    uint32_t left;
+    uint32_t right;
+    int64_t value;
+} yara_node_t;
+
+// Pattern text of a string in the text pool
+typedef struct {
+    uint32_t text;
+    uint32_t len;
+    uint32_t flags;
+} yara_pattern_t;
+
+// Parsed and compiled rules file, in typed pools addressed by index
+typedef struct {
+    char *filename;
+    stream_buffer_t rules;         // yara_rule_t
+    stream_buffer_t strings;       // yara_string_t
+    stream_buffer_t patterns;      // yara_pattern_t, one per string
+    stream_buffer_t pattern_text;
+    stream_buffer_t nodes;         // yara_node_t
+    stream_buffer_t items;         // uint32_t children of and/or, strings of of
+    stream_buffer_t predicates;    // yara_predicate_t
+    stream_buffer_t bytes;         // NUL-terminated names and tags
+    stream_buffer_t always;        // uint32_t rules that can match without string hits
+    uint32_t rule_count;
+    uint32_t string_count;
+    int needs_prefix;
+    regex_prog_t *prog;            // NULL when no rule has strings
+} yara_bind_t;
+
+static const yara_rule_t *Rules(const yara_bind_t *bind) {
+    return (const yara_rule_t *)(const void *)bind->rules.data;
+}
+
+static yara_string_t *Strings(const yara_bind_t *bind) {
+    return (yara_string_t *)(void *)bind->strings.data;
+}
+
+static const yara_node_t *Nodes(const yara_bind_t *bind) {
+    return (const yara_node_t *)(const void *)bind->nodes.data;
+}
+
+static const uint32_t *Items(const yara_bind_t *bind) {
+    return (const uint32_t *)(const void *)bind->items.data;
+}
+
+static const yara_predicate_t *Predicates(const yara_bind_t *bind) {
+    return (const yara_predicate_t *)(const void *)bind->predicates.data;
+}
+
+static const char *Bytes(const yara_bind_t *bind, uint32_t offset) {
+    return (const char *)bind->bytes.data + offset;
+}
+
+static uint32_t PoolCount(const stream_buffer_t *pool, size_t item_size) {
+    return (uint32_t)(pool->len / item_size);
+}
+
+static int PoolAppend(stream_buffer_t *pool, const void *item, size_t item_size) {
+    return StreamBufferAppend(pool, (const uint8_t *)item, item_size, UINT32_MAX);
+}
+
+// Add a NUL-terminated string to the byte pool; returns its offset or UINT32_MAX
+static uint32_t PoolString(yara_bind_t *bind, const char *text, size_t len) {
+    uint32_t offset = (uint32_t)bind->bytes.len;
+    if (!StreamBufferAppend(&bind->bytes, (const uint8_t *)text, len, UINT32_MAX) ||
+        !StreamBufferAppend(&bind->bytes, (const uint8_t *)"", 1, UINT32_MAX)) {
+        return UINT32_MAX;
+    }
+    return offset;
+}
+
+static int IsWordChar(uint8_t c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static int HexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Lexer
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    TOKEN_END,
+    TOKEN_IDENTIFIER,          // also keywords
+    TOKEN_STRING_ID,           // $name, $name* or $
+    TOKEN_STRING_COUNT,        // #name
+    TOKEN_INTEGER,
+    TOKEN_TEXT,                // contents of "...", escapes not yet processed
+    TOKEN_SYMBOL
+} yara_token_t;
+
+typedef struct {
+    yara_bind_t *bind;
+    const char *text;
+    size_t len;
+    size_t pos;
+    uint32_t line;
+    const char *error;
+
+    // Current token
+    uint8_t token;             // yara_token_t
+    const char *start;
+    size_t token_len;
+    uint32_t token_line;
+    int64_t value;
+
+    // Rule being parsed: its strings are the pool entries from rule_strings on
+    uint32_t rule;
+    uint32_t rule_strings;
+    uint32_t rule_predicates;
+    uint32_t depth;
+} yara_parser_t;
+
+static void SkipBlank(yara_parser_t *parser) {
+    const char *text = parser->text;
+    while (parser->pos < parser->len) {
+        char c = text[parser->pos];
+        char next = parser->pos + 1 < parser->len ? text[parser->pos + 1] : '\0';
+        if (c == '\n') {
+            parser->line++;
+            parser->pos++;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            parser->pos++;
+        } else if (c == '/' && next == '/') {
+            while (parser->pos < parser->len && text[parser->pos] != '\n') {
+                parser->pos++;
+            }
+        } else if (c == '/' && next == '*') {
+            parser->pos += 2;
+            while (parser->pos + 1 < parser->len && !(text[parser->pos] == '*' && text[parser->pos + 1] == '/')) {
+                parser->line += text[parser->pos] == '\n';
+                parser->pos++;
+            }
+            if (parser->pos + 1 >= parser->len) {
+                parser->error = "Unterminated comment";
+                parser->pos = parser->len;
+                return;
+            }
+            parser->pos += 2;
+        } else {
+            return;
+        }
+    }
+}
+
+static void LexInteger(yara_parser_t *parser) {
+    const char *text = parser->text;
+    uint64_t value = 0;
+    int digits = 0;
+    int hex = parser->pos + 1 < parser->len && text[parser->pos] == '0' &&
+              (text[parser->pos + 1] == 'x' || text[parser->pos + 1] == 'X');
+    if (hex) {
+        parser->pos += 2;
+    }
+    while (parser->pos < parser->len) {
+        int digit = hex ? HexDigit(text[parser->pos]) : (text[parser->pos] >= '0' && text[parser->pos] <= '9')
+                                                             ? text[parser->pos] - '0'
+                                                             : -1;
+        if (digit < 0) {
+            break;
+        }
+        value = value * (hex ? 16u : 10u) + (uint64_t)digit;
+        if (value > INT64_MAX) {
+            parser->error = "Integer too large";
+            return;
+        }
+        digits++;
+        parser->pos++;
+    }
+    uint64_t scale = 1;
+    if (parser->pos + 1 < parser->len && text[parser->pos + 1] == 'B' &&
+        (text[parser->pos] == 'K' || text[parser->pos] == 'M')) {
+        scale = text[parser->pos] == 'K' ? 1024 : 1024 * 1024;
+        parser->pos += 2;
+    }
+    if (!digits || (parser->pos < parser->len && IsWordChar((uint8_t)text[parser->pos]))) {
+        parser->error = "Malformed integer";
+        return;
+    }
+    if (value > INT64_MAX / scale) {
+        parser->error = "Integer too large";
+        return;
+    }
+    parser->value = (int64_t)(value * scale);
+}
+
+// Read the next token into the parser
+static void Lex(yara_parser_t *parser) {
+    SkipBlank(parser);
+    const char *text = parser->text;
+    size_t begin = parser->pos;
+    parser->token = TOKEN_END;
+    parser->start = text + begin;
+    parser->token_len = 0;
+    parser->token_line = parser->line;
+    if (parser->error || begin >= parser->len) {
+        return;
+    }
+    char c = text[begin];
+    if (IsWordChar((uint8_t)c) && !(c >= '0' && c <= '9')) {
+        while (parser->pos < parser->len && IsWordChar((uint8_t)text[parser->pos])) {
+            parser->pos++;
+        }
+        parser->token = TOKEN_IDENTIFIER;
+    } else if (c == '$' || c == '#') {
+        parser->pos++;
+        while (parser->pos < parser->len && IsWordChar((uint8_t)text[parser->pos])) {
+            parser->pos++;
+        }
+        if (c == '$' && parser->pos < parser->len && text[parser->pos] == '*') {
+            parser->pos++;
+        }
+        if (c == '#' && parser->pos == begin + 1) {
+            parser->error = "Expected a string name after #";
+            return;
+        }
+        parser->token = c == '$' ? TOKEN_STRING_ID : TOKEN_STRING_COUNT;
+    } else if (c >= '0' && c <= '9') {
+        LexInteger(parser);
+        parser->token = TOKEN_INTEGER;
+    } else if (c == '"') {
+        parser->pos++;
+        while (parser->pos < parser->len && text[parser->pos] != '"' && text[parser->pos] != '\n') {
+            parser->pos += text[parser->pos] == '\\' && parser->pos + 1 < parser->len ? 2 : 1;
+        }
+        if (parser->pos >= parser->len || text[parser->pos] != '"') {
+            parser->error = "Unterminated text string";
+            return;
+        }
+        parser->pos++;
+        parser->token = TOKEN_TEXT;
+        parser->start = text + begin + 1;
+        parser->token_len = parser->pos - begin - 2;
+        return;
+    } else if (c == '@' || (c == '!' && !(begin + 1 < parser->len && text[begin + 1] == '='))) {
+        parser->error = "Match offsets (@) and lengths (!) are not supported";
+        return;
+    } else {
+        static const char *const symbols[] = {"..", "<=", ">=", "==", "!=", "(", ")", "{", "}",
+                                               ":",  "=",  ",",  "<",  ">",  "-"};
+        for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+            size_t len = strlen(symbols[i]);
+            if (begin + len <= parser->len && memcmp(text + begin, symbols[i], len) == 0) {
+                parser->pos += len;
+                parser->token = TOKEN_SYMBOL;
+                break;
+            }
+        }
+        if (parser->token != TOKEN_SYMBOL) {
+            parser->error = "Unexpected character";
+            return;
+        }
+    }
+    parser->token_len = parser->pos - begin;
+}
+
+static int TokenIs(const yara_parser_t *parser, uint8_t token, const char *text) {
+    size_t len = strlen(text);
+    return parser->token == token && parser->token_len == len && memcmp(parser->start, text, len) == 0;
+}
+
+static int IsKeyword(const yara_parser_t *parser, const char *keyword) {
+    return TokenIs(parser, TOKEN_IDENTIFIER, keyword);
+}
+
+static int IsSymbol(const yara_parser_t *parser, const char *symbol) {
+    return TokenIs(parser, TOKEN_SYMBOL, symbol);
+}
+
+// Consume the current token if it is symbol, otherwise fail with error
+static int Expect(yara_parser_t *parser, const char *symbol, const char *error) {
+    if (parser->error) {
+        return 0;
+    }
+    if (!IsSymbol(parser, symbol)) {
+        parser->error = error;
+        return 0;
+    }
+    Lex(parser);
+    return !parser->error;
+}
+
+static int ExpectKeyword(yara_parser_t *parser, const char *keyword, const char *error) {
+    if (parser->error) {
+        return 0;
+    }
+    if (!IsKeyword(parser, keyword)) {
+        parser->error = error;
+        return 0;
+    }
+    Lex(parser);
+    return !parser->error;
+}
+
+// ---------------------------------------------------------------------------
+// Strings: every string becomes a regular expression of the compiled set
+// ---------------------------------------------------------------------------
+
+#define YARA_MODIFIER_NOCASE 0x01
+#define YARA_MODIFIER_ASCII 0x02
+#define YARA_MODIFIER_WIDE 0x04
+#define YARA_MODIFIER_FULLWORD 0x08
+#define YARA_MODIFIER_PRIVATE 0x10
+
+typedef enum {
+    YARA_STRING_TEXT,
+    YARA_STRING_HEX,
+    YARA_STRING_REGEX
+} yara_string_kind_t;
+
+static int EmitText(stream_buffer_t *out, const char *text) {
+    return StreamBufferAppend(out, (const uint8_t *)text, strlen(text), UINT32_MAX);
+}
+
+static int EmitByte(stream_buffer_t *out, uint8_t byte) {
+    char text[8];
+    snprintf(text, sizeof(text), "\\x%02x", byte);
+    return EmitText(out, text);
+}
+
+// Unescape a text string: \" \\ \t \n \r and \xHH
+static const char *UnescapeText(const char *text, size_t len, stream_buffer_t *out) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (c == '\\') {
+            if (++i == len) {
+                return "Malformed escape in text string";
+            }
+            switch (text[i]) {
+            case '"': c = '"'; break;
+            case '\\': c = '\\'; break;
+            case 't': c = '\t'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 'x': {
+                int high = i + 1 < len ? HexDigit(text[i + 1]) : -1;
+                int low = i + 2 < len ? HexDigit(text[i + 2]) : -1;
+                if (high < 0 || low < 0) {
+                    return "Malformed escape in text string";
+                }
+                c = (uint8_t)(high * 16 + low);
+                i += 2;
+                break;
+            }
+            default:
+                return "Malformed escape in text string";
+            }
+        }
+        if (!StreamBufferAppend(out, &c, 1, UINT32_MAX)) {
+            return "Out of memory parsing rules";
+        }
+    }
+    return out->len ? NULL : "Empty text string";
+}
+
+// One hex string token: a byte with ? nibbles, optionally negated with ~
+static int EmitHexByte(stream_buffer_t *out, int high, int low, int negate) {
+    char text[32];
+    if (high >= 0 && low >= 0 && !negate) {
+        return EmitByte(out, (uint8_t)(high * 16 + low));
+    }
+    if (!EmitText(out, negate ? "[^" : "[")) {
+        return 0;
+    }
+    if (high < 0 && low < 0) {
+        snprintf(text, sizeof(text), "\\x00-\\xff");
+    } else if (low < 0) {
+        snprintf(text, sizeof(text), "\\x%x0-\\x%xf", high, high);
+    } else if (high >= 0) {
+        snprintf(text, sizeof(text), "\\x%x%x", high, low);
+    } else {
+        for (int h = 0; h < 16; h++) {
+            if (!EmitByte(out, (uint8_t)(h * 16 + low))) {
+                return 0;
+            }
+        }
+        text[0] = '\0';
+    }
+    return EmitText(out, text) && EmitText(out, "]");
+}
+
+// Hex string after the opening brace, up to and including the closing one.
+// Wildcards become classes, jumps counted repetitions and alternatives
+// non-capturing groups.
+static const char *ParseHexString(yara_parser_t *parser, stream_buffer_t *out) {
+    const char *text = parser->text;
+    uint32_t depth = 0;
+    uint32_t bytes = 0;
+    for (;;) {
+        SkipBlank(parser);
+        if (parser->error) {
+            return parser->error;
+        }
+        if (parser->pos >= parser->len) {
+            return "Unterminated hex string";
+        }
+        char c = text[parser->pos++];
+        int ok = 1;
+        if (c == '}') {
+            break;
+        } else if (c == '(') {
+            if (++depth > YARA_MAX_DEPTH) {
+                return "Hex string nested too deeply";
+            }
+            ok = EmitText(out, "(?:");
+        } else if (c == '|' || c == ')') {
+            if (!depth) {
+                return "Unbalanced alternative in hex string";
+            }
+            depth -= c == ')';
+            ok = EmitText(out, c == ')' ? ")" : "|");
+        } else if (c == '[') {
+            // Jump: [n], [n-m], [n-] or [-]
+            int64_t bounds[2] = {-1, -1};
+            int range = 0;
+            for (int part = 0; part < 2; part++) {
+                SkipBlank(parser);
+                if (parser->pos < parser->len && text[parser->pos] >= '0' && text[parser->pos] <= '9') {
+                    LexInteger(parser);
+                    if (parser->error) {
+                        return parser->error;
+                    }
+                    bounds[part] = parser->value;
+                }
+                SkipBlank(parser);
+                if (part == 0 && parser->pos < parser->len && text[parser->pos] == '-') {
+                    parser->pos++;
+                    range = 1;
+                } else {
+                    break;
+                }
+            }
+            if (parser->pos >= parser->len || text[parser->pos] != ']' || (!range && bounds[0] < 0) ||
+                (bounds[1] >= 0 && bounds[1] < (bounds[0] < 0 ? 0 : bounds[0]))) {
+                return "Malformed jump in hex string";
+            }
+            if (bounds[0] > REGEX_MAX_REPEAT || bounds[1] > REGEX_MAX_REPEAT) {
+                return "Jump in hex string too long";
+            }
+            parser->pos++;
+            char repeat[48];
+            if (!range) {
+                snprintf(repeat, sizeof(repeat), "[\\x00-\\xff]{%d}", (int)bounds[0]);
+            } else if (bounds[1] < 0) {
+                snprintf(repeat, sizeof(repeat), "[\\x00-\\xff]{%d,}", bounds[0] < 0 ? 0 : (int)bounds[0]);
+            } else {
+                snprintf(repeat, sizeof(repeat), "[\\x00-\\xff]{%d,%d}", bounds[0] < 0 ? 0 : (int)bounds[0],
+                         (int)bounds[1]);
+            }
+            ok = EmitText(out, repeat);
+        } else {
+            int negate = c == '~';
+            if (negate) {
+                if (parser->pos >= parser->len) {
+                    return "Unterminated hex string";
+                }
+                c = text[parser->pos++];
+            }
+            if (parser->pos >= parser->len) {
+                return "Unterminated hex string";
+            }
+            char second = text[parser->pos++];
+            int high = c == '?' ? -1 : HexDigit(c);
+            int low = second == '?' ? -1 : HexDigit(second);
+            if ((high < 0 && c != '?') || (low < 0 && second != '?') || (negate && high < 0 && low < 0)) {
+                return "Malformed byte in hex string";
+            }
+            ok = EmitHexByte(out, high, low, negate);
+            bytes++;
+        }
+        if (!ok) {
+            return "Out of memory parsing rules";
+        }
+    }
+    if (depth) {
+        return "Unbalanced alternative in hex string";
+    }
+    return bytes ? NULL : "Empty hex string";
+}
+
+// Regular expression after the opening slash, up to and including the
+// closing slash and its i/s flags
+static const char *ParseRegexString(yara_parser_t *parser, stream_buffer_t *out, uint32_t *flags) {
+    const char *text = parser->text;
+    size_t start = parser->pos;
+    while (parser->pos < parser->len && text[parser->pos] != '/') {
+        if (text[parser->pos] == '\n') {
+            return "Unterminated regular expression";
+        }
+        parser->pos += text[parser->pos] == '\\' && parser->pos + 1 < parser->len ? 2 : 1;
+    }
+    if (parser->pos >= parser->len) {
+        return "Unterminated regular expression";
+    }
+    if (parser->pos == start) {
+        return "Empty regular expression";
+    }
+    if (!StreamBufferAppend(out, (const uint8_t *)text + start, parser->pos - start, UINT32_MAX)) {
+        return "Out of memory parsing rules";
+    }
+    parser->pos++;
+    while (parser->pos < parser->len && (text[parser->pos] == 'i' || text[parser->pos] == 's')) {
+        *flags |= text[parser->pos++] == 'i' ? REGEX_NOCASE : REGEX_DOTALL;
+    }
+    return NULL;
+}
+
+static const char *ParseModifiers(yara_parser_t *parser, uint8_t kind, uint32_t *modifiers) {
+    static const char *const names[] = {"nocase", "ascii", "wide", "fullword", "private"};
+    static const uint32_t bits[] = {YARA_MODIFIER_NOCASE, YARA_MODIFIER_ASCII, YARA_MODIFIER_WIDE,
+                                    YARA_MODIFIER_FULLWORD, YARA_MODIFIER_PRIVATE};
+    // Modifiers each string kind accepts here
+    static const uint32_t allowed[] = {0x1F, YARA_MODIFIER_PRIVATE,
+                                       YARA_MODIFIER_NOCASE | YARA_MODIFIER_ASCII | YARA_MODIFIER_PRIVATE};
+    while (parser->token == TOKEN_IDENTIFIER && !IsKeyword(parser, "condition")) {
+        uint32_t bit = 0;
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (IsKeyword(parser, names[i])) {
+                bit = bits[i];
+            }
+        }
+        if (!bit) {
+            int known = IsKeyword(parser, "xor") || IsKeyword(parser, "base64") || IsKeyword(parser, "base64wide");
+            return known ? "Unsupported string modifier" : "Unknown string modifier";
+        }
+        if (!(allowed[kind] & bit)) {
+            return "String modifier not supported for this kind of string";
+        }
+        *modifiers |= bit;
+        Lex(parser);
+        if (parser->error) {
+            return parser->error;
+        }
+    }
+    return NULL;
+}
+
+// Regular expression for a text string in one encoding. fullword becomes
+// word boundary assertions fitting the first and last byte; it applies to
+// the ascii form only.
+static int EmitTextVariant(stream_buffer_t *out, const uint8_t *bytes, size_t len, int wide, int fullword) {
+    if (fullword && !wide && !EmitText(out, IsWordChar(bytes[0]) ? "\\b" : "\\B")) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!EmitByte(out, bytes[i]) || (wide && !EmitByte(out, 0))) {
+            return 0;
+        }
+    }
+    return !(fullword && !wide) || EmitText(out, IsWordChar(bytes[len - 1]) ? "\\b" : "\\B");
+}
+
+static const char *AddString(yara_parser_t *parser, const char *name, size_t name_len, const stream_buffer_t *body,
+                             uint8_t kind, uint32_t modifiers, uint32_t flags) {
+    yara_bind_t *bind = parser->bind;
+    stream_buffer_t *text = &bind->pattern_text;
+    yara_pattern_t pattern;
+    pattern.text = (uint32_t)text->len;
+    pattern.flags = flags | ((modifiers & YARA_MODIFIER_NOCASE) ? REGEX_NOCASE : 0);
+    int ok = 1;
+    if (kind != YARA_STRING_TEXT) {
+        ok = StreamBufferAppend(text, body->data, body->len, UINT32_MAX);
+    } else {
+        int wide = (modifiers & YARA_MODIFIER_WIDE) != 0;
+        int ascii = !wide || (modifiers & YARA_MODIFIER_ASCII);
+        int fullword = (modifiers & YARA_MODIFIER_FULLWORD) != 0;
+        if (ascii && wide) {
+            ok = EmitText(text, "(?:") && EmitTextVariant(text, body->data, body->len, 0, fullword) &&
+                 EmitText(text, "|") && EmitTextVariant(text, body->data, body->len, 1, fullword) &&
+                 EmitText(text, ")");
+        } else {
+            ok = EmitTextVariant(text, body->data, body->len, wide, fullword);
+        }
+    }
+    if (!ok || text->len > UINT32_MAX) {
+        return "Out of memory parsing rules";
+    }
+    pattern.len = (uint32_t)(text->len - pattern.text);
+
+    // Compile the string alone to report errors at its line and learn its
+    // match lengths
+    regex_prog_t *prog;
+    const char *error = RegexCompile((const char *)text->data + pattern.text, pattern.len, pattern.flags, &prog);
+    if (error) {
+        return error;
+    }
+    yara_string_t string;
+    memset(&string, 0, sizeof(string));
+    RegexPatternLength(prog, 0, &string.min_len, &string.max_len);
+    RegexFree(prog);
+    string.rule = parser->rule;
+    string.is_private = (modifiers & YARA_MODIFIER_PRIVATE) != 0;
+    string.name = PoolString(bind, name, name_len);
+    if (bind->string_count >= REGEX_MAX_PATTERNS) {
+        return "Too many strings in rules file";
+    }
+    if (string.name == UINT32_MAX || !PoolAppend(&bind->strings, &string, sizeof(string)) ||
+        !PoolAppend(&bind->patterns, &pattern, sizeof(pattern))) {
+        return "Out of memory parsing rules";
+    }
+    bind->string_count++;
+    return NULL;
+}
+
+static const char *ParseString(yara_parser_t *parser) {
+    yara_bind_t *bind = parser->bind;
+    const char *name = parser->start;
+    size_t name_len = parser->token_len;
+    if (name[name_len - 1] == '*') {
+        return "Invalid string name";
+    }
+    if (name_len > 1) {
+        for (uint32_t s = parser->rule_strings; s < bind->string_count; s++) {
+            const char *other = Bytes(bind, Strings(bind)[s].name);
+            if (strlen(other) == name_len && memcmp(other, name, name_len) == 0) {
+                return "Duplicate string name";
+            }
+        }
+    }
+    Lex(parser);
+    if (parser->error || !IsSymbol(parser, "=")) {
+        return parser->error ? parser->error : "Expected = after string name";
+    }
+    // The string body is read from the raw text
+    SkipBlank(parser);
+    stream_buffer_t body;
+    memset(&body, 0, sizeof(body));
+    uint8_t kind;
+    uint32_t flags = 0;
+    const char *error = NULL;
+    char c = parser->pos < parser->len ? parser->text[parser->pos] : '\0';
+    if (c == '"') {
+        kind = YARA_STRING_TEXT;
+        Lex(parser);
+        error = parser->error ? parser->error : UnescapeText(parser->start, parser->token_len, &body);
+    } else if (c == '{') {
+        kind = YARA_STRING_HEX;
+        parser->pos++;
+        error = ParseHexString(parser, &body);
+    } else if (c == '/') {
+        kind = YARA_STRING_REGEX;
+        parser->pos++;
+        error = ParseRegexString(parser, &body, &flags);
+    } else {
+        kind = YARA_STRING_TEXT;
+        error = parser->error ? parser->error : "Expected a text, hex or regular expression string";
+    }
+    uint32_t modifiers = 0;
+    if (!error) {
+        Lex(parser);
+        error = parser->error ? parser->error : ParseModifiers(parser, kind, &modifiers);
+    }
+    if (!error) {
+        error = AddString(parser, name, name_len, &body, kind, modifiers, flags);
+    }
+    StreamBufferFree(&body);
+    return error;
+}
+
+// ---------------------------------------------------------------------------
+// Conditions
+// ---------------------------------------------------------------------------
+
+static uint32_t AddNode(yara_parser_t *parser, uint8_t type, uint8_t op, uint32_t left, uint32_t right,
+                        int64_t value) {
+    yara_node_t node;
+    memset(&node, 0, sizeof(node));
+    node.type = type;
+    node.op = op;
+    node.left = left;
+    node.right = right;
+    node.value = value;
+    uint32_t index = PoolCount(&parser->bind->nodes, sizeof(yara_node_t));
+    if (!PoolAppend(&parser->bind->nodes, &node, sizeof(node))) {
+        parser->error = "Out of memory parsing rules";
+        return YARA_NONE;
+    }
+    return index;
+}
+
+// Find a string of the current rule by its $name; anonymous strings cannot
+// be referenced on their own
+static uint32_t LookupString(yara_parser_t *parser) {
+    const yara_bind_t *bind = parser->bind;
+    if (parser->token_len > 1 && parser->start[parser->token_len - 1] != '*') {
+        for (uint32_t s = parser->rule_strings; s < bind->string_count; s++) {
+            const char *name = Bytes(bind, Strings(bind)[s].name);
+            if (strlen(name) == parser->token_len && memcmp(name, parser->start, parser->token_len) == 0) {
+                return s;
+            }
+        }
+    }
+    parser->error = "Undefined string";
+    return YARA_NONE;
+}
+
+static uint32_t ParseExpression(yara_parser_t *parser);
+
+static int ParseIntegerLiteral(yara_parser_t *parser, int64_t *value) {
+    if (parser->token != TOKEN_INTEGER) {
+        parser->error = "Expected an integer";
+        return 0;
+    }
+    *value = parser->value;
+    Lex(parser);
+    return !parser->error;
+}
+
+// Integer expressions: literals, #a, filesize and uintN/intN[be](offset)
+static uint32_t ParseInteger(yara_parser_t *parser) {
+    if (parser->token == TOKEN_INTEGER) {
+        int64_t value = parser->value;
+        Lex(parser);
+        return AddNode(parser, YARA_NODE_INTEGER, 0, 0, 0, value);
+    }
+    if (parser->token == TOKEN_STRING_COUNT) {
+        // #a counts like $a
+        parser->start++;
+        parser->token_len--;
+        parser->token = TOKEN_STRING_ID;
+        char name[256];
+        if (parser->token_len + 1 >= sizeof(name)) {
+            parser->error = "Undefined string";
+            return YARA_NONE;
+        }
+        name[0] = '$';
+        memcpy(name + 1, parser->start, parser->token_len);
+        parser->start = name;
+        parser->token_len++;
+        uint32_t string = LookupString(parser);
+        if (string == YARA_NONE) {
+            return YARA_NONE;
+        }
+        Lex(parser);
+        return AddNode(parser, YARA_NODE_COUNT, 0, string, 0, 0);
+    }
+    if (IsKeyword(parser, "filesize")) {
+        Lex(parser);
+        return AddNode(parser, YARA_NODE_FILESIZE, 0, 0, 0, 0);
+    }
+    static const char *const reads[] = {"uint8", "uint16", "uint32", "uint16be", "uint32be",
+                                        "int8",  "int16",  "int32",  "int16be",  "int32be"};
+    for (size_t i = 0; i < sizeof(reads) / sizeof(reads[0]); i++) {
+        if (!IsKeyword(parser, reads[i])) {
+            continue;
+        }
+        const char *digits = strchr(reads[i], 't') + 1;
+        uint8_t width = (uint8_t)(atoi(digits) / 8);
+        uint8_t flags = (uint8_t)((strstr(reads[i], "be") ? YARA_READ_BIG_ENDIAN : 0) |
+                                  (reads[i][0] == 'i' ? YARA_READ_SIGNED : 0));
+        Lex(parser);
+        if (++parser->depth > YARA_MAX_DEPTH) {
+            parser->error = "Condition nested too deeply";
+            return YARA_NONE;
+        }
+        if (!Expect(parser, "(", "Expected ( after integer function")) {
+            return YARA_NONE;
+        }
+        uint32_t offset = ParseInteger(parser);
+        if (offset == YARA_NONE || !Expect(parser, ")", "Expected ) after integer function argument")) {
+            return YARA_NONE;
+        }
+        parser->depth--;
+        parser->bind->needs_prefix = 1;
+        uint32_t node = AddNode(parser, YARA_NODE_READ, width, offset, 0, 0);
+        if (node != YARA_NONE) {
+            ((yara_node_t *)(void *)parser->bind->nodes.data)[node].read_flags = flags;
+        }
+        return node;
+    }
+    if (!parser->error) {
+        parser->error = "Expected an integer expression";
+    }
+    return YARA_NONE;
+}
+
+static uint32_t ParseComparison(yara_parser_t *parser, uint32_t left) {
+    static const char *const operators[] = {"==", "!=", "<", "<=", ">", ">="};
+    for (uint8_t op = 0; op < sizeof(operators) / sizeof(operators[0]); op++) {
+        if (IsSymbol(parser, operators[op])) {
+            Lex(parser);
+            uint32_t right = ParseInteger(parser);
+            if (right == YARA_NONE) {
+                return YARA_NONE;
+            }
+            return AddNode(parser, YARA_NODE_COMPARE, op, left, right, 0);
+        }
+    }
+    if (!parser->error) {
+        parser->error = "Expected a comparison operator";
+    }
+    return YARA_NONE;
+}
+
+// `of` with the quantifier already read: them or a parenthesized list of
+// string names, which may end in * to match a prefix
+static uint32_t ParseOf(yara_parser_t *parser, uint8_t quantifier, int64_t count) {
+    yara_bind_t *bind = parser->bind;
+    if (!ExpectKeyword(parser, "of", "Expected of")) {
+        return YARA_NONE;
+    }
+    uint32_t first = PoolCount(&bind->items, sizeof(uint32_t));
+    if (IsKeyword(parser, "them")) {
+        for (uint32_t s = parser->rule_strings; s < bind->string_count; s++) {
+            if (!PoolAppend(&bind->items, &s, sizeof(s))) {
+                parser->error = "Out of memory parsing rules";
+                return YARA_NONE;
+            }
+        }
+        if (parser->rule_strings == bind->string_count) {
+            parser->error = "No strings defined for them";
+            return YARA_NONE;
+        }
+        Lex(parser);
+    } else {
+        if (!Expect(parser, "(", "Expected them or a list of strings")) {
+            return YARA_NONE;
+        }
+        do {
+            if (parser->token != TOKEN_STRING_ID) {
+                parser->error = "Expected a string name";
+                return YARA_NONE;
+            }
+            int wildcard = parser->start[parser->token_len - 1] == '*';
+            size_t len = parser->token_len - (size_t)wildcard;
+            uint32_t matched = 0;
+            for (uint32_t s = parser->rule_strings; s < bind->string_count; s++) {
+                const char *name = Bytes(bind, Strings(bind)[s].name);
+                size_t name_len = strlen(name);
+                if ((wildcard ? name_len >= len : name_len == len) && memcmp(name, parser->start, len) == 0) {
+                    if (!PoolAppend(&bind->items, &s, sizeof(s))) {
+                        parser->error = "Out of memory parsing rules";
+                        return YARA_NONE;
+                    }
+                    matched++;
+                }
+            }
+            if (!matched) {
+                parser->error = "Undefined string";
+                return YARA_NONE;
+            }
+            Lex(parser);
+        } while (!parser->error && IsSymbol(parser, ",") && (Lex(parser), !parser->error));
+        if (!Expect(parser, ")", "Expected ) after list of strings")) {
+            return YARA_NONE;
+        }
+    }
+    uint32_t items = PoolCount(&bind->items, sizeof(uint32_t)) - first;
+    return AddNode(parser, YARA_NODE_OF, quantifier, first, items, count);
+}
+
+// $a, $a at N or $a in (low..high)
+static uint32_t ParseStringTerm(yara_parser_t *parser) {
+    yara_bind_t *bind = parser->bind;
+    uint32_t string = LookupString(parser);
+    if (string == YARA_NONE) {
+        return YARA_NONE;
+    }
+    Lex(parser);
+    int is_at = IsKeyword(parser, "at");
+    if (!is_at && !IsKeyword(parser, "in")) {
+        return parser->error ? YARA_NONE : AddNode(parser, YARA_NODE_STRING, 0, string, 0, 0);
+    }
+    Lex(parser);
+    int64_t low;
+    int64_t high;
+    if (is_at) {
+        if (!ParseIntegerLiteral(parser, &low)) {
+            return YARA_NONE;
+        }
+        high = low;
+    } else if (!Expect(parser, "(", "Expected ( after in") || !ParseIntegerLiteral(parser, &low) ||
+               !Expect(parser, "..", "Expected .. in range") || !ParseIntegerLiteral(parser, &high) ||
+               !Expect(parser, ")", "Expected ) after range")) {
+        return YARA_NONE;
+    }
+    // Matches are found by their end, so only fixed-length strings have a
+    // known start
+    yara_string_t *info = &Strings(bind)[string];
+    if (info->min_len != info->max_len) {
+        parser->error = "at and in need a fixed-length string";
+        return YARA_NONE;
+    }
+    info->has_predicates = 1;
+    yara_predicate_t predicate;
+    predicate.string = string;
+    predicate.low = (uint64_t)low;
+    predicate.high = (uint64_t)high;
+    uint32_t index = PoolCount(&bind->predicates, sizeof(yara_predicate_t));
+    if (!PoolAppend(&bind->predicates, &predicate, sizeof(predicate))) {
+        parser->error = "Out of memory parsing rules";
+        return YARA_NONE;
+    }
+    return AddNode(parser, YARA_NODE_PREDICATE, 0, index, 0, 0);
+}
+
+static uint32_t ParsePrimary(yara_parser_t *parser) {
+    if (IsSymbol(parser, "(")) {
+        if (++parser->depth > YARA_MAX_DEPTH) {
+            parser->error = "Condition nested too deeply";
+            return YARA_NONE;
+        }
+        Lex(parser);
+        uint32_t node = ParseExpression(parser);
+        if (node == YARA_NONE || !Expect(parser, ")", "Expected )")) {
+            return YARA_NONE;
+        }
+        parser->depth--;
+        return node;
+    }
+    if (IsKeyword(parser, "true") || IsKeyword(parser, "false")) {
+        uint8_t type = IsKeyword(parser, "true") ? YARA_NODE_TRUE : YARA_NODE_FALSE;
+        Lex(parser);
+        return AddNode(parser, type, 0, 0, 0, 0);
+    }
+    static const char *const quantifiers[] = {"any", "all", "none"};
+    for (uint8_t q = 0; q < sizeof(quantifiers) / sizeof(quantifiers[0]); q++) {
+        if (IsKeyword(parser, quantifiers[q])) {
+            Lex(parser);
+            return ParseOf(parser, q, 0);
+        }
+    }
+    if (parser->token == TOKEN_STRING_ID) {
+        return ParseStringTerm(parser);
+    }
+    if (parser->token == TOKEN_INTEGER) {
+        int64_t value = parser->value;
+        Lex(parser);
+        if (IsKeyword(parser, "of")) {
+            return ParseOf(parser, YARA_OF_AT_LEAST, value);
+        }
+        uint32_t left = AddNode(parser, YARA_NODE_INTEGER, 0, 0, 0, value);
+        return left == YARA_NONE ? YARA_NONE : ParseComparison(parser, left);
+    }
+    if (parser->token == TOKEN_IDENTIFIER && !IsKeyword(parser, "filesize") && strncmp(parser->start, "uint", 4) != 0 &&
+        strncmp(parser->start, "int", 3) != 0) {
+        parser->error = "Unsupported identifier in condition (modules and rule references are not supported)";
+        return YARA_NONE;
+    }
+    uint32_t left = ParseInteger(parser);
+    return left == YARA_NONE ? YARA_NONE : ParseComparison(parser, left);
+}
+
+static uint32_t ParseNot(yara_parser_t *parser) {
+    if (!IsKeyword(parser, "not")) {
+        return ParsePrimary(parser);
+    }
+    if (++parser->depth > YARA_MAX_DEPTH) {
+        parser->error = "Condition nested too deeply";
+        return YARA_NONE;
+    }
+    Lex(parser);
+    uint32_t child = ParseNot(parser);
+    parser->depth--;
+    return child == YARA_NONE ? YARA_NONE : AddNode(parser, YARA_NODE_NOT, 0, child, 0, 0);
+}
+
+// A chain of operands joined by and (or by or); the children are stored
+// contiguously in the item pool once the chain is complete
+static uint32_t ParseChain(yara_parser_t *parser, int is_or) {
+    stream_buffer_t children;
+    memset(&children, 0, sizeof(children));
+    for (;;) {
+        uint32_t child = is_or ? ParseChain(parser, 0) : ParseNot(parser);
+        if (child == YARA_NONE) {
+            break;
+        }
+        if (!PoolAppend(&children, &child, sizeof(child))) {
+            parser->error = "Out of memory parsing rules";
+            break;
+        }
+        if (!IsKeyword(parser, is_or ? "or" : "and")) {
+            break;
+        }
+        Lex(parser);
+    }
+    uint32_t node = YARA_NONE;
+    uint32_t count = PoolCount(&children, sizeof(uint32_t));
+    if (!parser->error && count == 1) {
+        node = *(const uint32_t *)(const void *)children.data;
+    } else if (!parser->error) {
+        uint32_t first = PoolCount(&parser->bind->items, sizeof(uint32_t));
+        if (!StreamBufferAppend(&parser->bind->items, children.data, children.len, UINT32_MAX)) {
+            parser->error = "Out of memory parsing rules";
+        } else {
+            node = AddNode(parser, is_or ? YARA_NODE_OR : YARA_NODE_AND, 0, first, count, 0);
+        }
+    }
+    StreamBufferFree(&children);
+    return node;
+}
+
+static uint32_t ParseExpression(yara_parser_t *parser) {
+    return ParseChain(parser, 1);
+}
+
+// ---------------------------------------------------------------------------
+// Rules file
+// ---------------------------------------------------------------------------
+
+// meta: entries are accepted and ignored
+static void ParseMeta(yara_parser_t *parser) {
+    while (!parser->error && parser->token == TOKEN_IDENTIFIER && !IsKeyword(parser, "strings") &&
+           !IsKeyword(parser, "condition")) {
+        Lex(parser);
+        if (!Expect(parser, "=", "Expected = in meta entry")) {
+            return;
+        }
+        if (IsSymbol(parser, "-")) {
+            Lex(parser);
+        }
+        if (parser->token != TOKEN_TEXT && parser->token != TOKEN_INTEGER && !IsKeyword(parser, "true") &&
+            !IsKeyword(parser, "false")) {
+            if (!parser->error) {
+                parser->error = "Expected a meta value";
+            }
+            return;
+        }
+        Lex(parser);
+    }
+}
+
+static void ParseRule(yara_parser_t *parser) {
+    yara_bind_t *bind = parser->bind;
+    yara_rule_t rule;
+    memset(&rule, 0, sizeof(rule));
+    if (IsKeyword(parser, "private")) {
+        rule.is_private = 1;
+        Lex(parser);
+    }
+    if (IsKeyword(parser, "global")) {
+        parser->error = "Global rules are not supported";
+        return;
+    }
+    if (IsKeyword(parser, "import") || IsKeyword(parser, "include")) {
+        parser->error = "Modules and includes are not supported";
+        return;
+    }
+    if (!ExpectKeyword(parser, "rule", "Expected rule")) {
+        return;
+    }
+    if (parser->token != TOKEN_IDENTIFIER) {
+        parser->error = "Expected a rule name";
+        return;
+    }
+    rule.name = PoolString(bind, parser->start, parser->token_len);
+    Lex(parser);
+
+    // Tags are kept space-separated
+    stream_buffer_t tags;
+    memset(&tags, 0, sizeof(tags));
+    if (IsSymbol(parser, ":")) {
+        Lex(parser);
+        while (!parser->error && parser->token == TOKEN_IDENTIFIER) {
+            if ((tags.len && !StreamBufferAppend(&tags, (const uint8_t *)" ", 1, UINT32_MAX)) ||
+                !StreamBufferAppend(&tags, (const uint8_t *)parser->start, parser->token_len, UINT32_MAX)) {
+                parser->error = "Out of memory parsing rules";
+            }
+            Lex(parser);
+        }
+    }
+    rule.tags = PoolString(bind, tags.len ? (const char *)tags.data : "", tags.len);
+    rule.tags_len = (uint32_t)tags.len;
+    StreamBufferFree(&tags);
+    if (rule.name == UINT32_MAX || rule.tags == UINT32_MAX) {
+        parser->error = "Out of memory parsing rules";
+        return;
+    }
+    if (!Expect(parser, "{", "Expected { after rule name")) {
+        return;
+    }
+
+    parser->rule = bind->rule_count;
+    parser->rule_strings = bind->string_count;
+    parser->rule_predicates = PoolCount(&bind->predicates, sizeof(yara_predicate_t));
+    if (IsKeyword(parser, "meta")) {
+        Lex(parser);
+        if (!Expect(parser, ":", "Expected : after meta")) {
+            return;
+        }
+        ParseMeta(parser);
+    }
+    if (!parser->error && IsKeyword(parser, "strings")) {
+        Lex(parser);
+        if (!Expect(parser, ":", "Expected : after strings")) {
+            return;
+        }
+        if (parser->token != TOKEN_STRING_ID) {
+            parser->error = "Expected a string definition";
+            return;
+        }
+        while (!parser->error && parser->token == TOKEN_STRING_ID) {
+            const char *error = ParseString(parser);
+            if (error) {
+                parser->error = error;
+            }
+        }
+    }
+    if (!ExpectKeyword(parser, "condition", "Expected condition") ||
+        !Expect(parser, ":", "Expected : after condition")) {
+        return;
+    }
+    parser->depth = 0;
+    rule.condition = ParseExpression(parser);
+    if (rule.condition == YARA_NONE || !Expect(parser, "}", "Expected } at the end of the rule")) {
+        return;
+    }
+    rule.strings.first = parser->rule_strings;
+    rule.strings.count = bind->string_count - parser->rule_strings;
+    rule.predicates.first = parser->rule_predicates;
+    rule.predicates.count = PoolCount(&bind->predicates, sizeof(yara_predicate_t)) - parser->rule_predicates;
+    if (!PoolAppend(&bind->rules, &rule, sizeof(rule))) {
+        parser->error = "Out of memory parsing rules";
+        return;
+    }
+    bind->rule_count++;
+}
+
+// ---------------------------------------------------------------------------
+// Evaluation
+// ---------------------------------------------------------------------------
+
+// A matched string of one stream
+typedef struct {
+    uint32_t string;
+    uint32_t count;            // matches; consecutive ends of a variable-length string count once
+    uint64_t first_end;        // stream offset just past the first match
+    uint64_t last_end;
+    uint64_t timestamp_ns;     // packet in which the first match was found
+} yara_hit_t;
+
+// One scanned stream: a direction of a TCP connection or a UDP datagram
+typedef struct {
+    tcp_direction_t tcp;
+    uint32_t dfa_state;
+    uint32_t prefix_len;
+    uint16_t hit_count;
+    uint16_t hit_capacity;
+    uint16_t predicate_count;
+    uint16_t predicate_capacity;
+    uint64_t offset;           // stream bytes so far, lost ones included
+    uint64_t timestamp_ns;     // latest packet
+    yara_hit_t *hits;
+    uint32_t *predicates;      // satisfied at/in constraints
+    const uint8_t *prefix;     // leading bytes, when rules read them
+} yara_stream_t;
+
+typedef struct {
+    const yara_bind_t *bind;
+    const yara_stream_t *stream;   // NULL: no string matched and the stream is unknown
+} yara_eval_t;
+
+static const yara_hit_t *FindHit(const yara_stream_t *stream, uint32_t string) {
+    for (uint16_t i = 0; i < stream->hit_count; i++) {
+        if (stream->hits[i].string == string) {
+            return &stream->hits[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t HitCount(const yara_eval_t *eval, uint32_t string) {
+    const yara_hit_t *hit = eval->stream ? FindHit(eval->stream, string) : NULL;
+    return hit ? hit->count : 0;
+}
+
+// Returns 1 with *value set, or 0 when the value is undefined
+static int EvalInteger(const yara_eval_t *eval, uint32_t index, int64_t *value) {
+    const yara_node_t *node = &Nodes(eval->bind)[index];
+    const yara_stream_t *stream = eval->stream;
+    switch (node->type) {
+    case YARA_NODE_INTEGER:
+        *value = node->value;
+        return 1;
+    case YARA_NODE_COUNT:
+        *value = HitCount(eval, node->left);
+        return 1;
+    case YARA_NODE_FILESIZE:
+        if (!stream) {
+            return 0;
+        }
+        *value = (int64_t)stream->offset;
+        return 1;
+    case YARA_NODE_READ: {
+        int64_t offset;
+        if (!stream || !EvalInteger(eval, node->left, &offset) || offset < 0 ||
+            (uint64_t)offset + node->op > stream->prefix_len) {
+            return 0;
+        }
+        const uint8_t *bytes = stream->prefix + offset;
+        uint32_t raw = 0;
+        for (uint8_t i = 0; i < node->op; i++) {
+            uint8_t byte = (node->read_flags & YARA_READ_BIG_ENDIAN) ? bytes[i] : bytes[node->op - 1 - i];
+            raw = raw << 8 | byte;
+        }
+        if ((node->read_flags & YARA_READ_SIGNED) && node->op < 4 && (raw >> (node->op * 8 - 1))) {
+            *value = (int64_t)raw - ((int64_t)1 << (node->op * 8));
+        } else if (node->read_flags & YARA_READ_SIGNED) {
+            *value = (int32_t)raw;
+        } else {
+            *value = raw;
+        }
+        return 1;
+    }
+    default:
+        return 0;
+    }
+}
+
+// Returns 0, 1 or YARA_UNKNOWN
+static int EvalCondition(const yara_eval_t *eval, uint32_t index) {
+    const yara_bind_t *bind = eval->bind;
+    const yara_node_t *node = &Nodes(bind)[index];
+    switch (node->type) {
+    case YARA_NODE_TRUE:
+        return 1;
+    case YARA_NODE_FALSE:
+        return 0;
+    case YARA_NODE_AND:
+    case YARA_NODE_OR: {
+        // and: any false decides, or: any true decides; otherwise an
+        // unknown operand leaves the result unknown
+        int decisive = node->type == YARA_NODE_OR;
+        int result = !decisive;
+        for (uint32_t i = 0; i < node->right; i++) {
+            int value = EvalCondition(eval, Items(bind)[node->left + i]);
+            if (value == decisive) {
+                return decisive;
+            }
+            if (value == YARA_UNKNOWN) {
+                result = YARA_UNKNOWN;
+            }
+        }
+        return result;
+    }
+    case YARA_NODE_NOT: {
+        int value = EvalCondition(eval, node->left);
+        return value == YARA_UNKNOWN ? YARA_UNKNOWN : !value;
+    }
+    case YARA_NODE_STRING:
+        return HitCount(eval, node->left) > 0;
+    case YARA_NODE_PREDICATE:
+        if (eval->stream) {
+            for (uint16_t i = 0; i < eval->stream->predicate_count; i++) {
+                if (eval->stream->predicates[i] == node->left) {
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    case YARA_NODE_COMPARE: {
+        int64_t left;
+        int64_t right;
+        if (!EvalInteger(eval, node->left, &left) || !EvalInteger(eval, node->right, &right)) {
+            return YARA_UNKNOWN;
+        }
+        switch (node->op) {
+        case YARA_COMPARE_EQUAL:
+            return left == right;
+        case YARA_COMPARE_NOT_EQUAL:
+            return left != right;
+        case YARA_COMPARE_LESS:
+            return left < right;
+        case YARA_COMPARE_LESS_EQUAL:
+            return left <= right;
+        case YARA_COMPARE_GREATER:
+            return left > right;
+        default:
+            return left >= right;
+        }
+    }
+    case YARA_NODE_OF: {
+        uint32_t matched = 0;
+        for (uint32_t i = 0; i < node->right; i++) {
+            matched += HitCount(eval, Items(bind)[node->left + i]) > 0;
+        }
+        switch (node->op) {
+        case YARA_OF_ANY:
+            return matched > 0;
+        case YARA_OF_ALL:
+            return matched == node->right;
+        case YARA_OF_NONE:
+            return matched == 0;
+        default:
+            return (int64_t)matched >= node->value;
+        }
+    }
+    default:
+        return 0;
+    }
+}
+
+static const char *CompileRules(yara_bind_t *bind) {
+    if (bind->string_count) {
+        regex_pattern_t *patterns = (regex_pattern_t *)duckdb_malloc(bind->string_count * sizeof(regex_pattern_t));
+        if (!patterns) {
+            return "Out of memory parsing rules";
+        }
+        const yara_pattern_t *sources = (const yara_pattern_t *)(const void *)bind->patterns.data;
+        for (uint32_t i = 0; i < bind->string_count; i++) {
+            patterns[i].pattern = (const char *)bind->pattern_text.data + sources[i].text;
+            patterns[i].len = sources[i].len;
+            patterns[i].flags = sources[i].flags;
+        }
+        const char *error = RegexCompileSet(patterns, bind->string_count, &bind->prog);
+        duckdb_free(patterns);
+        if (error) {
+            return error;
+        }
+    }
+    // Rules whose condition can hold with no string matched are evaluated
+    // for every stream; the others only for streams where one of their
+    // strings matched
+    yara_eval_t eval;
+    eval.bind = bind;
+    eval.stream = NULL;
+    for (uint32_t r = 0; r < bind->rule_count; r++) {
+        const yara_rule_t *rule = &Rules(bind)[r];
+        if (!rule->is_private && EvalCondition(&eval, rule->condition) != 0 &&
+            !PoolAppend(&bind->always, &r, sizeof(r))) {
+            return "Out of memory parsing rules";
+        }
+    }
+    return NULL;
+}
+
+static const char *LoadRules(yara_bind_t *bind, const char *path, char *error_text, size_t error_len) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return "Failed to open rules file";
+    }
+    stream_buffer_t text;
+    memset(&text, 0, sizeof(text));
+    char chunk[4096];
+    size_t len;
+    const char *error = NULL;
+    while (!error && (len = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        if (!StreamBufferAppend(&text, (const uint8_t *)chunk, len, YARA_MAX_RULES_FILE)) {
+            error = "Rules file too large";
+        }
+    }
+    fclose(file);
+    if (!error) {
+        yara_parser_t parser;
+        memset(&parser, 0, sizeof(parser));
+        parser.bind = bind;
+        parser.text = text.len ? (const char *)text.data : "";
+        parser.len = text.len;
+        parser.line = 1;
+        Lex(&parser);
+        while (!parser.error && parser.token != TOKEN_END) {
+            ParseRule(&parser);
+        }
+        if (parser.error) {
+            snprintf(error_text, error_len, "%s (rules file line %u)", parser.error, parser.token_line);
+            error = error_text;
+        }
+    }
+    StreamBufferFree(&text);
+    if (error) {
+        return error;
+    }
+    if (!bind->rule_count) {
+        return "No rules in rules file";
+    }
+    return CompileRules(bind);
+}
+
+// ---------------------------------------------------------------------------
+// Table function
+// ---------------------------------------------------------------------------
+
+enum {
+    YARA_COL_TIMESTAMP,
+    YARA_COL_RULE,
+    YARA_COL_TAGS,
+    YARA_COL_STRING,
+    YARA_COL_START_OFFSET,
+    YARA_COL_END_OFFSET,
+    YARA_COL_MATCH_COUNT,
+    YARA_COL_SRC_IP,
+    YARA_COL_SRC_PORT,
+    YARA_COL_DST_IP,
+    YARA_COL_DST_PORT,
+    YARA_COL_IP_PROTO,
+    YARA_COL_COUNT
+};
+
+typedef struct {
+    yara_stream_t streams[2];  // by sending endpoint of the flow key
+    uint8_t fin[2];
+} yara_flow_t;
+
+// A queued output row
+typedef struct {
+    flow_key_t key;
+    uint8_t direction;
+    uint32_t rule;
+    uint32_t string;           // UINT32_MAX when the rule matched without string hits
+    uint32_t count;
+    uint64_t end;
+    uint64_t timestamp_ns;
+} yara_row_t;
+
+typedef struct {
+    const yara_bind_t *bind;
+    pcap_source_t *source;
+    regex_dfa_t *dfa;              // NULL when no rule has strings
+    hash_map_t flows;              // flow_key_t -> yara_flow_t
+    int draining;                  // end of capture: open streams are being finished
+    int done;
+    size_t drain_position;
+    uint32_t *stamps;              // per rule: generation it was last made a candidate
+    uint32_t generation;
+    uint32_t *candidates;
+
+    // Scan in progress
+    yara_stream_t *scan_stream;
+    uint64_t scan_base;            // stream offset of the scanned data
+    uint64_t scan_timestamp_ns;
+
+    // Rows not yet emitted
+    stream_buffer_t rows;          // yara_row_t
+    size_t row_next;
+} yara_state_t;
+
+static void YaraBindDataFree(void *data) {
+    yara_bind_t *bind = (yara_bind_t *)data;
+    if (!bind) {
+        return;
+    }
+    RegexFree(bind->prog);
+    StreamBufferFree(&bind->rules);
+    StreamBufferFree(&bind->strings);
+    StreamBufferFree(&bind->patterns);
+    StreamBufferFree(&bind->pattern_text);
+    StreamBufferFree(&bind->nodes);
+    StreamBufferFree(&bind->items);
+    StreamBufferFree(&bind->predicates);
+    StreamBufferFree(&bind->bytes);
+    StreamBufferFree(&bind->always);
+    duckdb_free(bind->filename);
+    duckdb_free(bind);
+}
+
+static void ReleaseStream(yara_stream_t *stream, int owns_prefix) {
+    duckdb_free(stream->hits);
+    duckdb_free(stream->predicates);
+    if (owns_prefix) {
+        duckdb_free((void *)stream->prefix);
+    }
+    stream->hits = NULL;
+    stream->predicates = NULL;
+    stream->prefix = NULL;
+    stream->hit_count = stream->hit_capacity = 0;
+    stream->predicate_count = stream->predicate_capacity = 0;
+}
+
+static void ReleaseFlows(hash_map_t *flows) {
+    size_t position = 0;
+    const void *key;
+    void *value;
+    while (HashMapNext(flows, &position, &key, &value)) {
+        yara_flow_t *flow = (yara_flow_t *)value;
+        ReleaseStream(&flow->streams[0], 1);
+        ReleaseStream(&flow->streams[1], 1);
+    }
+}
+
+static void YaraInitDataFree(void *data) {
+    yara_state_t *state = (yara_state_t *)data;
+    if (state) {
+        PcapSourceClose(state->source);
+        ReleaseFlows(&state->flows);
+        HashMapDestroy(&state->flows);
+        RegexDfaFree(state->dfa);
+        duckdb_free(state->stamps);
+        duckdb_free(state->candidates);
+        StreamBufferFree(&state->rows);
+        duckdb_free(state);
+    }
+}
+
+static void YaraBind(duckdb_bind_info info) {
+    char *filename = PcapBindFilename(info);
+    if (!filename) {
+        return;
+    }
+    yara_bind_t *bind = (yara_bind_t *)duckdb_malloc(sizeof(yara_bind_t));
+    if (!bind) {
+        duckdb_bind_set_error(info, "Failed to allocate memory for pcap reader state");
+        duckdb_free(filename);
+        return;
+    }
+    memset(bind, 0, sizeof(yara_bind_t));
+    bind->filename = filename;
+    duckdb_bind_set_bind_data(info, bind, YaraBindDataFree);
+
+    duckdb_value rules_value = duckdb_bind_get_parameter(info, 1);
+    char *rules_path = duckdb_is_null_value(rules_value) ? NULL : duckdb_get_varchar(rules_value);
+    duckdb_destroy_value(&rules_value);
+    if (!rules_path) {
+        duckdb_bind_set_error(info, "Rules file path cannot be NULL");
+        return;
+    }
+    char error_text[256];
+    const char *error = LoadRules(bind, rules_path, error_text, sizeof(error_text));
+    duckdb_free(rules_path);
+    if (error) {
+        duckdb_bind_set_error(info, error);
+        return;
+    }
+
+    PcapBindAddColumn(info, "timestamp_ns", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "rule", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddListColumn(info, "tags", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "string_id", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "start_offset", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "end_offset", DUCKDB_TYPE_UBIGINT);
+    PcapBindAddColumn(info, "match_count", DUCKDB_TYPE_UINTEGER);
+    PcapBindAddColumn(info, "src_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "src_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "dst_ip", DUCKDB_TYPE_VARCHAR);
+    PcapBindAddColumn(info, "dst_port", DUCKDB_TYPE_USMALLINT);
+    PcapBindAddColumn(info, "ip_proto", DUCKDB_TYPE_UTINYINT);
+}
+
+// DFA states of open streams survive cache rebuilds
+static void VisitStreamStates(void *context, regex_dfa_visit_t visit, void *visitor) {
+    yara_state_t *state = (yara_state_t *)context;
+    size_t position = 0;
+    const void *key;
+    void *value;
+    while (HashMapNext(&state->flows, &position, &key, &value)) {
+        yara_flow_t *flow = (yara_flow_t *)value;
+        visit(visitor, &flow->streams[0].dfa_state);
+        visit(visitor, &flow->streams[1].dfa_state);
+    }
+}
+
+static void YaraInit(duckdb_init_info info) {
+    yara_bind_t *bind = (yara_bind_t *)duckdb_init_get_bind_data(info);
+
+    yara_state_t *state = (yara_state_t *)duckdb_malloc(sizeof(yara_state_t));
+    if (!state) {
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state, 0, sizeof(yara_state_t));
+    state->bind = bind;
+    size_t rule_bytes = bind->rule_count * sizeof(uint32_t);
+    state->stamps = (uint32_t *)duckdb_malloc(rule_bytes);
+    state->candidates = (uint32_t *)duckdb_malloc(rule_bytes);
+    if (!state->stamps || !state->candidates || !HashMapInit(&state->flows, sizeof(flow_key_t), sizeof(yara_flow_t)) ||
+        (bind->prog && RegexDfaCreate(bind->prog, &state->dfa))) {
+        YaraInitDataFree(state);
+        duckdb_init_set_error(info, "Failed to allocate memory for init state");
+        return;
+    }
+    memset(state->stamps, 0, rule_bytes);
+    if (state->dfa) {
+        RegexDfaSetRoots(state->dfa, VisitStreamStates, state);
+    }
+    const char *error = PcapSourceOpen(bind->filename, &state->source);
+    if (error) {
+        YaraInitDataFree(state);
+        duckdb_init_set_error(info, error);
+        return;
+    }
+    duckdb_init_set_init_data(info, state, YaraInitDataFree);
+}
+
+static int RecordMatch(void *context, uint32_t pattern, size_t end) {
+    yara_state_t *state = (yara_state_t *)context;
+    const yara_bind_t *bind = state->bind;
+    yara_stream_t *stream = state->scan_stream;
+    uint64_t stream_end = state->scan_base + end;
+
+    yara_hit_t *hit = (yara_hit_t *)FindHit(stream, pattern);
+    if (!hit) {
+        if (stream->hit_count == stream->hit_capacity) {
+            if (stream->hit_capacity >= YARA_MAX_STREAM_HITS) {
+                return 0;
+            }
+            uint16_t capacity = (uint16_t)(stream->hit_capacity ? stream->hit_capacity * 2 : 4);
+            yara_hit_t *hits = (yara_hit_t *)duckdb_malloc(capacity * sizeof(yara_hit_t));
+            if (!hits) {
+                return 0;
+            }
+            if (stream->hit_count) {
+                memcpy(hits, stream->hits, stream->hit_count * sizeof(yara_hit_t));
+            }
+            duckdb_free(stream->hits);
+            stream->hits = hits;
+            stream->hit_capacity = capacity;
+        }
+        hit = &stream->hits[stream->hit_count++];
+        hit->string = pattern;
+        hit->count = 0;
+        hit->first_end = stream_end;
+        hit->timestamp_ns = state->scan_timestamp_ns;
+    }
+    // A variable-length string ending at successive bytes ("Host: [a-z]+")
+    // is one longer match rather than several
+    const yara_string_t *string = &Strings(bind)[pattern];
+    int extends = hit->count && string->min_len != string->max_len && stream_end == hit->last_end + 1;
+    hit->last_end = stream_end;
+    if (!extends && hit->count < UINT32_MAX) {
+        hit->count++;
+    }
+
+    if (!string->has_predicates || stream_end < string->min_len) {
+        return 0;
+    }
+    uint64_t start = stream_end - string->min_len;
+    const yara_rule_t *rule = &Rules(bind)[string->rule];
+    for (uint32_t p = rule->predicates.first; p < rule->predicates.first + rule->predicates.count; p++) {
+        const yara_predicate_t *predicate = &Predicates(bind)[p];
+        if (predicate->string != pattern || start < predicate->low || start > predicate->high) {
+            continue;
+        }
+        uint16_t i = 0;
+        while (i < stream->predicate_count && stream->predicates[i] != p) {
+            i++;
+        }
+        if (i < stream->predicate_count) {
+            continue;
+        }
+        if (stream->predicate_count == stream->predicate_capacity) {
+            if (stream->predicate_capacity >= YARA_MAX_STREAM_HITS) {
+                return 0;
+            }
+            uint16_t capacity = (uint16_t)(stream->predicate_capacity ? stream->predicate_capacity * 2 : 4);
+            uint32_t *predicates = (uint32_t *)duckdb_malloc(capacity * sizeof(uint32_t));
+            if (!predicates) {
+                return 0;
+            }
+            if (stream->predicate_count) {
+                memcpy(predicates, stream->predicates, stream->predicate_count * sizeof(uint32_t));
+            }
+            duckdb_free(stream->predicates);
+            stream->predicates = predicates;
+            stream->predicate_capacity = capacity;
+        }
+        stream->predicates[stream->predicate_count++] = p;
+    }
+    return 0;
+}
+
+static int CompareRuleIndex(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+static void QueueRow(yara_state_t *state, const flow_key_t *key, int direction, uint32_t rule, const yara_hit_t *hit,
+                     uint64_t timestamp_ns) {
+    yara_row_t row;
+    memset(&row, 0, sizeof(row));
+    row.key = *key;
+    row.direction = (uint8_t)direction;
+    row.rule = rule;
+    row.string = hit ? hit->string : UINT32_MAX;
+    row.count = hit ? hit->count : 0;
+    row.end = hit ? hit->first_end : 0;
+    row.timestamp_ns = hit ? hit->timestamp_ns : timestamp_ns;
+    PoolAppend(&state->rows, &row, sizeof(row));
+}
+
+static void MarkRule(yara_state_t *state, uint32_t rule, uint32_t *count) {
+    if (state->stamps[rule] != state->generation) {
+        state->stamps[rule] = state->generation;
+        state->candidates[(*count)++] = rule;
+    }
+}
+
+// Evaluate the rules for a finished stream and queue their rows
+static void EvaluateStream(yara_state_t *state, const yara_stream_t *stream, const flow_key_t *key, int direction) {
+    const yara_bind_t *bind = state->bind;
+    if (++state->generation == 0) {
+        memset(state->stamps, 0, bind->rule_count * sizeof(uint32_t));
+        state->generation = 1;
+    }
+    uint32_t count = 0;
+    const uint32_t *always = (const uint32_t *)(const void *)bind->always.data;
+    for (uint32_t i = 0; i < PoolCount(&bind->always, sizeof(uint32_t)); i++) {
+        MarkRule(state, always[i], &count);
+    }
+    for (uint16_t i = 0; i < stream->hit_count; i++) {
+        uint32_t rule = Strings(bind)[stream->hits[i].string].rule;
+        if (!Rules(bind)[rule].is_private) {
+            MarkRule(state, rule, &count);
+        }
+    }
+    if (stream->hit_count && count > 1) {
+        qsort(state->candidates, count, sizeof(uint32_t), CompareRuleIndex);
+    }
+
+    yara_eval_t eval;
+    eval.bind = bind;
+    eval.stream = stream;
+    for (uint32_t i = 0; i < count; i++) {
+        const yara_rule_t *rule = &Rules(bind)[state->candidates[i]];
+        if (EvalCondition(&eval, rule->condition) != 1) {
+            continue;
+        }
+        // One row per matched string, in definition order
+        int queued = 0;
+        for (uint32_t s = rule->strings.first; s < rule->strings.first + rule->strings.count; s++) {
+            const yara_hit_t *hit = Strings(bind)[s].is_private ? NULL : FindHit(stream, s);
+            if (hit) {
+                QueueRow(state, key, direction, state->candidates[i], hit, 0);
+                queued = 1;
+            }
+        }
+        if (!queued) {
+            QueueRow(state, key, direction, state->candidates[i], NULL, stream->timestamp_ns);
+        }
+    }
+}
+
+static void ScanStream(yara_state_t *state, yara_stream_t *stream, const uint8_t *data, size_t len,
+                       uint64_t timestamp_ns) {
+    if (!state->dfa) {
+        return;
+    }
+    state->scan_stream = stream;
+    state->scan_base = stream->offset;
+    state->scan_timestamp_ns = timestamp_ns;
+    if (RegexDfaScan(state->dfa, &stream->dfa_state, data, len, RecordMatch, state) < 0) {
+        // Out of memory for DFA states: matches in progress are lost
+        stream->dfa_state = RegexDfaResumeState(state->dfa);
+    }
+}
+
+static void FinishStream(yara_state_t *state, yara_stream_t *stream, const flow_key_t *key, int direction) {
+    if (stream->offset) {
+        if (state->dfa) {
+            state->scan_stream = stream;
+            state->scan_base = 0;
+            state->scan_timestamp_ns = stream->timestamp_ns;
+            RegexDfaFinish(state->dfa, stream->dfa_state, (size_t)stream->offset, RecordMatch, state);
+        }
+        EvaluateStream(state, stream, key, direction);
+    }
+    ReleaseStream(stream, 1);
+    stream->offset = 0;
+    stream->dfa_state = REGEX_DFA_START;
+}
+
+static void FinishFlow(yara_state_t *state, const flow_key_t *key, yara_flow_t *flow) {
+    FinishStream(state, &flow->streams[0], key, 0);
+    FinishStream(state, &flow->streams[1], key, 1);
+}
+
+static int ResetFlows(yara_state_t *state) {
+    size_t position = 0;
+    const void *key;
+    void *value;
+    while (HashMapNext(&state->flows, &position, &key, &value)) {
+        FinishFlow(state, (const flow_key_t *)key, (yara_flow_t *)value);
+    }
+    HashMapDestroy(&state->flows);
+    return HashMapInit(&state->flows, sizeof(flow_key_t), sizeof(yara_flow_t));
+}
+
+// Keep the first bytes of a stream while they arrive without gaps
+static void KeepPrefix(yara_stream_t *stream, const uint8_t *data, uint32_t len) {
+    if (stream->prefix_len != stream->offset || stream->offset >= YARA_PREFIX_BYTES) {
+        return;
+    }
+    if (!stream->prefix) {
+        stream->prefix = (const uint8_t *)duckdb_malloc(YARA_PREFIX_BYTES);
+        if (!stream->prefix) {
+            return;
+        }
+    }
+    uint32_t take = YARA_PREFIX_BYTES - stream->prefix_len;
+    take = take < len ? take : len;
+    memcpy((uint8_t *)stream->prefix + stream->prefix_len, data, take);
+    stream->prefix_len += take;
+}
+
+static void ProcessTcp(yara_state_t *state, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0) {
+        return;
+    }
+    int syn = (pkt->tcp_flags & TCP_FLAG_SYN) != 0;
+    yara_flow_t *flow = (yara_flow_t *)HashMapFind(&state->flows, &key);
+    if (!flow) {
+        // Flows are tracked from their first segment with data (or SYN);
+        // trailing ACKs of finished flows do not open new ones
+        if (!syn && !pkt->payload_len) {
+            return;
+        }
+        if (state->flows.count >= YARA_MAX_FLOWS && !ResetFlows(state)) {
+            return;
+        }
+        int is_new;
+        flow = (yara_flow_t *)HashMapInsert(&state->flows, &key, &is_new);
+        if (!flow) {
+            return;
+        }
+    } else if (syn && !(pkt->tcp_flags & TCP_FLAG_ACK) && (flow->streams[0].offset || flow->streams[1].offset)) {
+        // A new connection reusing the tuple
+        FinishFlow(state, &key, flow);
+        memset(flow, 0, sizeof(yara_flow_t));
+    }
+
+    yara_stream_t *stream = &flow->streams[direction];
+    stream->timestamp_ns = packet->timestamp_ns;
+    const uint8_t *data = NULL;
+    uint32_t len = TcpDirectionAccept(&stream->tcp, pkt, &data);
+    if (stream->tcp.gap) {
+        // Lost bytes still advance stream offsets; matching resumes after them
+        stream->offset += (uint32_t)(pkt->tcp_seq - stream->tcp.next_seq);
+        if (state->dfa) {
+            stream->dfa_state = RegexDfaResumeState(state->dfa);
+        }
+        TcpDirectionResync(&stream->tcp, pkt);
+        len = TcpDirectionAccept(&stream->tcp, pkt, &data);
+    }
+    if (len) {
+        if (state->bind->needs_prefix) {
+            KeepPrefix(stream, data, len);
+        }
+        ScanStream(state, stream, data, len, packet->timestamp_ns);
+        stream->offset += len;
+    }
+
+    if (pkt->tcp_flags & TCP_FLAG_FIN) {
+        flow->fin[direction] = 1;
+    }
+    if ((pkt->tcp_flags & TCP_FLAG_RST) || (flow->fin[0] && flow->fin[1])) {
+        FinishFlow(state, &key, flow);
+        HashMapRemove(&state->flows, &key);
+    }
+}
+
+// A UDP payload is a stream of its own, finished right away
+static void ProcessDatagram(yara_state_t *state, const pcap_packet_t *packet, const packet_info_t *pkt) {
+    flow_key_t key;
+    int direction = FlowKeyFromPacket(pkt, &key);
+    if (direction < 0) {
+        return;
+    }
+    yara_stream_t stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.prefix = pkt->payload;
+    stream.prefix_len = pkt->payload_len;
+    stream.timestamp_ns = packet->timestamp_ns;
+    if (state->dfa) {
+        ScanStream(state, &stream, pkt->payload, pkt->payload_len, packet->timestamp_ns);
+        RegexDfaFinish(state->dfa, stream.dfa_state, pkt->payload_len, RecordMatch, state);
+    }
+    stream.offset = pkt->payload_len;
+    EvaluateStream(state, &stream, &key, direction);
+    ReleaseStream(&stream, 0);
+}
+
+static void YaraFunction(duckdb_function_info info, duckdb_data_chunk output) {
+    yara_state_t *state = (yara_state_t *)duckdb_function_get_init_data(info);
+    const yara_bind_t *bind = state->bind;
+
+    duckdb_vector vectors[YARA_COL_COUNT];
+    for (idx_t i = 0; i < YARA_COL_COUNT; i++) {
+        vectors[i] = duckdb_data_chunk_get_vector(output, i);
+    }
+    uint64_t *timestamps = (uint64_t *)duckdb_vector_get_data(vectors[YARA_COL_TIMESTAMP]);
+    uint64_t *offsets = (uint64_t *)duckdb_vector_get_data(vectors[YARA_COL_START_OFFSET]);
+    uint64_t *end_offsets = (uint64_t *)duckdb_vector_get_data(vectors[YARA_COL_END_OFFSET]);
+    uint32_t *counts = (uint32_t *)duckdb_vector_get_data(vectors[YARA_COL_MATCH_COUNT]);
+    uint16_t *src_ports = (uint16_t *)duckdb_vector_get_data(vectors[YARA_COL_SRC_PORT]);
+    uint16_t *dst_ports = (uint16_t *)duckdb_vector_get_data(vectors[YARA_COL_DST_PORT]);
+    uint8_t *ip_protos = (uint8_t *)duckdb_vector_get_data(vectors[YARA_COL_IP_PROTO]);
+
+    idx_t row_count = 0;
+    idx_t max_rows = duckdb_vector_size();
+    pcap_packet_t packet;
+    packet_info_t pkt;
+    while (row_count < max_rows) {
+        if (state->row_next * sizeof(yara_row_t) == state->rows.len) {
+            state->rows.len = 0;
+            state->row_next = 0;
+            if (state->done) {
+                break;
+            }
+            if (state->draining) {
+                // End of capture: finish the open streams one flow at a time
+                const void *key;
+                void *value;
+                if (HashMapNext(&state->flows, &state->drain_position, &key, &value)) {
+                    FinishFlow(state, (const flow_key_t *)key, (yara_flow_t *)value);
+                } else {
+                    state->done = 1;
+                }
+                continue;
+            }
+            if (!PcapSourceNext(state->source, &packet)) {
+                state->draining = 1;
+                continue;
+            }
+            if (!PacketDecode(packet.link_type, packet.data, packet.capture_len, &pkt) || !pkt.ip_version ||
+                pkt.is_fragment) {
+                continue;
+            }
+            if (pkt.ip_proto == IPPROTO_NUM_TCP) {
+                ProcessTcp(state, &packet, &pkt);
+            } else if (pkt.ip_proto == IPPROTO_NUM_UDP && pkt.payload && pkt.payload_len) {
+                ProcessDatagram(state, &packet, &pkt);
+            }
+            continue;
+        }
+        const yara_row_t *queued = (const yara_row_t *)(const void *)state->rows.data + state->row_next++;
+        const yara_rule_t *rule = &Rules(bind)[queued->rule];
+        idx_t row = row_count++;
+        timestamps[row] = queued->timestamp_ns;
+        duckdb_vector_assign_string_element(vectors[YARA_COL_RULE], row, Bytes(bind, rule->name));
+        PcapListAssignSplit(vectors[YARA_COL_TAGS], row, Bytes(bind, rule->tags), rule->tags_len, ' ');
+        if (queued->string != UINT32_MAX) {
+            const yara_string_t *string = &Strings(bind)[queued->string];
+            duckdb_vector_assign_string_element(vectors[YARA_COL_STRING], row, Bytes(bind, string->name));
+            // Matches are found by their end; the start is known for
+            // fixed-length strings only
+            if (string->min_len == string->max_len && queued->end >= string->min_len) {
+                offsets[row] = queued->end - string->min_len;
+            } else {
+                PcapVectorSetNull(vectors[YARA_COL_START_OFFSET], row);
+            }
+            end_offsets[row] = queued->end;
+            counts[row] = queued->count;
+        } else {
+            PcapVectorSetNull(vectors[YARA_COL_STRING], row);
+            PcapVectorSetNull(vectors[YARA_COL_START_OFFSET], row);
+            PcapVectorSetNull(vectors[YARA_COL_END_OFFSET], row);
+            PcapVectorSetNull(vectors[YARA_COL_MATCH_COUNT], row);
+        }
+        char src_ip[64];
+        char dst_ip[64];
+        FlowFormatEndpoint(&queued->key, queued->direction, src_ip, sizeof(src_ip), &src_ports[row]);
+        FlowFormatEndpoint(&queued->key, 1 - queued->direction, dst_ip, sizeof(dst_ip), &dst_ports[row]);
+        duckdb_vector_assign_string_element(vectors[YARA_COL_SRC_IP], row, src_ip);
+        duckdb_vector_assign_string_element(vectors[YARA_COL_DST_IP], row, dst_ip);
+        ip_protos[row] = queued->key.ip_proto;
+    }
+    duckdb_data_chunk_set_size(output, row_count);
+}
+
+void RegisterYaraFunction(duckdb_connection connection) {
+    duckdb_table_function function = duckdb_create_table_function();
+    duckdb_table_function_set_name(function, "pcap_yara");
+
+    duckdb_logical_type varchar_type = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_table_function_add_parameter(function, varchar_type);
+    duckdb_destroy_logical_type(&varchar_type);
+
+    duckdb_table_function_set_bind(function, YaraBind);
+    duckdb_table_function_set_init(function, YaraInit);
+    duckdb_table_function_set_function(function, YaraFunction);
+
+    duckdb_register_table_function(connection, function);
+    duckdb_destroy_table_function(&function);
+}
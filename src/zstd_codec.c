@@ -0,0 +1,1742 @@
+#include "duckdb_extension.h"
+#include "zstd_codec.h"
+#include <stdlib.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Sequence alphabets: literal length, match length and offset codes, with
+// the largest FSE accuracy each may use
+#define LL_MAX_SYMBOL 35
+#define ML_MAX_SYMBOL 52
+#define OF_MAX_SYMBOL 31
+#define LL_MAX_LOG 9
+#define ML_MAX_LOG 9
+#define OF_MAX_LOG 8
+#define FSE_MAX_LOG 9
+#define FSE_MAX_SYMBOLS 64
+
+// Huffman literal codes: the encoder writes codes up to HUF_MAX_BITS long,
+// the decoder also accepts the reference decoder's limit. Code weights are
+// FSE-coded with at most HUF_WEIGHT_LOG accuracy.
+#define HUF_MAX_BITS 11
+#define HUF_DECODE_MAX_BITS 12
+#define HUF_WEIGHT_LOG 6
+
+// Encoder match finder
+#define HASH_BITS 17
+#define MIN_MATCH 4
+#define SEARCH_DEPTH 8
+// Without matches the search moves ahead faster, by one more byte for every
+// 2^SKIP_SHIFT bytes since the last match
+#define SKIP_SHIFT 8
+
+static const uint32_t ll_base[LL_MAX_SYMBOL + 1] = {0,  1,  2,  3,  4,  5,  6,   7,   8,   9,    10,   11,
+                                                    12, 13, 14, 15, 16, 18, 20,  22,  24,  28,   32,   40,
+                                                    48, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
+static const uint8_t ll_bits[LL_MAX_SYMBOL + 1] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  0,  0,  0,  0,  0,  1,  1,
+                                                   1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+static const uint32_t ml_base[ML_MAX_SYMBOL + 1] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13,  14,  15,  16,  17,   18,   19,   20,   21,   22,    23,    24,    25,   26,
+    27, 28, 29, 30, 31, 32, 33, 34, 35, 37, 39,  41,  43,  47,  51,   59,   67,   83,   99,   131,   259,   515,   1027, 2051,
+    4099, 8195, 16387, 32771, 65539};
+static const uint8_t ml_bits[ML_MAX_SYMBOL + 1] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+                                                   2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+// Predefined distributions (RFC 8878 3.1.1.3.2.2); -1 marks a "less than 1"
+// probability
+static const int16_t ll_default[LL_MAX_SYMBOL + 1] = {4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  2,  1,  1,  1,  2,  2,
+                                                      2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1};
+static const int16_t ml_default[ML_MAX_SYMBOL + 1] = {1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1,  1,  1,  1,  1,  1,  1,  1,
+                                                      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  1,  1,  1,  1,  1,  1,  1,
+                                                      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1};
+static const int16_t of_default[29] = {1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1,  1,
+                                       1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1};
+#define LL_DEFAULT_LOG 6
+#define ML_DEFAULT_LOG 6
+#define OF_DEFAULT_LOG 5
+
+// Position of the highest set bit of a non-zero value
+static unsigned HighBit(uint64_t value) {
+    unsigned bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+static uint16_t Get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t Get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t Get64(const uint8_t *p) {
+    return (uint64_t)Get32(p) | (uint64_t)Get32(p + 4) << 32;
+}
+
+static void Put16(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void Put32(uint8_t *p, uint32_t value) {
+    Put16(p, value);
+    Put16(p + 2, value >> 16);
+}
+
+// ---------------------------------------------------------------------------
+// Bit input
+// ---------------------------------------------------------------------------
+
+// Little-endian bits from the start of src; bits past the end read as zero
+static uint32_t PeekForward(const uint8_t *src, size_t len, size_t bit, unsigned count) {
+    uint32_t value = 0;
+    size_t byte = bit >> 3;
+    for (unsigned i = 0; i < 4 && byte + i < len; i++) {
+        value |= (uint32_t)src[byte + i] << (8 * i);
+    }
+    return (value >> (bit & 7)) & ((1u << count) - 1);
+}
+
+// Huffman and FSE streams are read backwards: from the last byte, whose
+// highest set bit marks the end, towards the first. Bits are taken from
+// below pos; reading past the start yields zeros and a negative pos.
+typedef struct {
+    const uint8_t *src;
+    size_t len;
+    int64_t pos;
+} bit_reader_t;
+
+static int BitInit(bit_reader_t *reader, const uint8_t *src, size_t len) {
+    if (!len || !src[len - 1]) {
+        return 0;
+    }
+    reader->src = src;
+    reader->len = len;
+    reader->pos = (int64_t)(len - 1) * 8 + HighBit(src[len - 1]);
+    return 1;
+}
+
+static uint64_t LoadWord(const bit_reader_t *reader, size_t byte) {
+    if (byte + 8 <= reader->len) {
+        return Get64(reader->src + byte);
+    }
+    uint64_t word = 0;
+    for (size_t i = 0; byte + i < reader->len; i++) {
+        word |= (uint64_t)reader->src[byte + i] << (8 * i);
+    }
+    return word;
+}
+
+// Up to 32 bits below pos, without consuming them
+static uint32_t BitPeek(const bit_reader_t *reader, unsigned count) {
+    if (!count) {
+        return 0;
+    }
+    int64_t low = reader->pos - (int64_t)count;
+    if (low >= 0) {
+        uint64_t word = LoadWord(reader, (size_t)(low >> 3));
+        return (uint32_t)((word >> (low & 7)) & ((1ULL << count) - 1));
+    }
+    if (reader->pos <= 0) {
+        return 0;
+    }
+    uint64_t word = LoadWord(reader, 0) & ((1ULL << reader->pos) - 1);
+    return (uint32_t)(word << -low);
+}
+
+static uint32_t BitRead(bit_reader_t *reader, unsigned count) {
+    uint32_t value = BitPeek(reader, count);
+    reader->pos -= count;
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// FSE and Huffman tables
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint16_t baseline;       // next state, before adding the bits read
+    uint8_t symbol;
+    uint8_t bits;
+} fse_entry_t;
+
+typedef struct {
+    uint8_t symbol;
+    uint8_t bits;
+} huf_entry_t;
+
+// Read an FSE table description (the normalized counts of each symbol) from
+// the start of src. Returns the bytes it takes, or 0 when it is malformed.
+static size_t ReadFseCounts(const uint8_t *src, size_t len, unsigned max_symbol, unsigned max_log, int16_t *counts,
+                            unsigned *symbols, unsigned *log) {
+    if (!len) {
+        return 0;
+    }
+    unsigned accuracy = (src[0] & 15) + 5;
+    if (accuracy > max_log) {
+        return 0;
+    }
+    size_t bit = 4;
+    int remaining = (1 << accuracy) + 1;
+    int threshold = 1 << accuracy;
+    unsigned bits = accuracy + 1;
+    unsigned symbol = 0;
+    int previous_zero = 0;
+    while (remaining > 1 && symbol <= max_symbol) {
+        if (previous_zero) {
+            // 2-bit repeat flags give the number of further zero counts
+            unsigned run = symbol;
+            uint32_t flag;
+            while ((flag = PeekForward(src, len, bit, 2)) == 3) {
+                run += 3;
+                bit += 2;
+                if (run > max_symbol || bit > len * 8) {
+                    return 0;
+                }
+            }
+            bit += 2;
+            run += flag;
+            if (run > max_symbol) {
+                return 0;
+            }
+            while (symbol < run) {
+                counts[symbol++] = 0;
+            }
+        }
+        int max = (2 * threshold - 1) - remaining;
+        uint32_t value = PeekForward(src, len, bit, bits);
+        int count;
+        if ((int)(value & (uint32_t)(threshold - 1)) < max) {
+            count = (int)(value & (uint32_t)(threshold - 1));
+            bit += bits - 1;
+        } else {
+            count = (int)(value & (uint32_t)(2 * threshold - 1));
+            if (count >= threshold) {
+                count -= max;
+            }
+            bit += bits;
+        }
+        count--;
+        remaining -= count < 0 ? -count : count;
+        counts[symbol++] = (int16_t)count;
+        previous_zero = count == 0;
+        if (remaining < 1) {
+            break;
+        }
+        while (remaining < threshold) {
+            bits--;
+            threshold >>= 1;
+        }
+    }
+    if (remaining != 1 || bit > len * 8) {
+        return 0;
+    }
+    *symbols = symbol;
+    *log = accuracy;
+    return (bit + 7) >> 3;
+}
+
+// Table cells of a symbol: its normalized count, or one for "less than 1"
+static uint32_t CountCells(int16_t count) {
+    return count < 0 ? 1 : (uint32_t)count;
+}
+
+// Spread the symbols over the table as the reference implementation does;
+// the encoder must place them identically. Low-probability symbols take the
+// last cells. Returns 0 when the counts do not fill the table exactly.
+static int SpreadSymbols(const int16_t *counts, unsigned symbols, unsigned log, uint8_t *spread, uint32_t *high) {
+    uint32_t size = 1u << log;
+    uint32_t mask = size - 1;
+    uint32_t step = (size >> 1) + (size >> 3) + 3;
+    uint32_t total = 0;
+    *high = size - 1;
+    for (unsigned s = 0; s < symbols; s++) {
+        total += CountCells(counts[s]);
+    }
+    if (total != size) {
+        return 0;
+    }
+    for (unsigned s = 0; s < symbols; s++) {
+        if (counts[s] == -1) {
+            spread[(*high)--] = (uint8_t)s;
+        }
+    }
+    uint32_t position = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        for (int i = 0; i < counts[s]; i++) {
+            spread[position] = (uint8_t)s;
+            do {
+                position = (position + step) & mask;
+            } while (position > *high);
+        }
+    }
+    return position == 0;
+}
+
+static int BuildFseTable(const int16_t *counts, unsigned symbols, unsigned log, fse_entry_t *table) {
+    uint8_t spread[1 << FSE_MAX_LOG];
+    uint32_t high;
+    if (!SpreadSymbols(counts, symbols, log, spread, &high)) {
+        return 0;
+    }
+    uint32_t size = 1u << log;
+    uint32_t next[FSE_MAX_SYMBOLS];
+    for (unsigned s = 0; s < symbols; s++) {
+        next[s] = CountCells(counts[s]);
+    }
+    for (uint32_t u = 0; u < size; u++) {
+        uint8_t symbol = spread[u];
+        uint32_t state = next[symbol]++;
+        unsigned bits = log - HighBit(state);
+        table[u].symbol = symbol;
+        table[u].bits = (uint8_t)bits;
+        table[u].baseline = (uint16_t)((state << bits) - size);
+    }
+    return 1;
+}
+
+// Decode FSE-compressed Huffman weights: a table description followed by a
+// stream interleaving two states. Returns 0 when malformed.
+static int DecodeWeights(const uint8_t *src, size_t len, uint8_t *weights, unsigned *count) {
+    int16_t counts[FSE_MAX_SYMBOLS];
+    unsigned symbols;
+    unsigned log;
+    fse_entry_t table[1 << HUF_WEIGHT_LOG];
+    size_t used = ReadFseCounts(src, len, HUF_DECODE_MAX_BITS, HUF_WEIGHT_LOG, counts, &symbols, &log);
+    bit_reader_t reader;
+    if (!used || !BuildFseTable(counts, symbols, log, table) || !BitInit(&reader, src + used, len - used)) {
+        return 0;
+    }
+    uint32_t state1 = BitRead(&reader, log);
+    uint32_t state2 = BitRead(&reader, log);
+    unsigned n = 0;
+    // The stream ends when a state update runs past its start; the other
+    // state then holds the last weight
+    for (;;) {
+        if (n > 252) {
+            return 0;
+        }
+        weights[n++] = table[state1].symbol;
+        state1 = table[state1].baseline + BitRead(&reader, table[state1].bits);
+        if (reader.pos < 0) {
+            weights[n++] = table[state2].symbol;
+            break;
+        }
+        weights[n++] = table[state2].symbol;
+        state2 = table[state2].baseline + BitRead(&reader, table[state2].bits);
+        if (reader.pos < 0) {
+            weights[n++] = table[state1].symbol;
+            break;
+        }
+    }
+    *count = n;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Decoder
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    STATE_FRAME_HEADER,
+    STATE_BLOCK,
+    STATE_DONE,
+    STATE_ERROR
+} zstd_state_t;
+
+typedef struct {
+    fse_entry_t entries[1 << FSE_MAX_LOG];
+    unsigned log;
+    int ready;               // a table was set up in this frame, for repeat mode
+} sequence_table_t;
+
+struct zstd_stream {
+    capture_file_t *file;
+    uint8_t prefix[16];
+    size_t prefix_len;
+    size_t prefix_pos;
+    zstd_state_t state;
+    int frames;              // frames started so far, skippable ones included
+
+    // Current frame
+    uint64_t window_size;
+    uint64_t content_size;
+    int has_content_size;
+    int has_checksum;
+    uint64_t frame_out;      // bytes decoded in the frame so far
+    uint32_t repeat[3];      // repeated offsets
+
+    // Entropy tables, which later blocks of the frame may reuse
+    huf_entry_t huffman[1 << HUF_DECODE_MAX_BITS];
+    unsigned huffman_bits;   // 0 until the frame has a Huffman table
+    sequence_table_t literal_lengths;
+    sequence_table_t offsets;
+    sequence_table_t match_lengths;
+
+    // Decoded bytes of the frame: the window of history followed by bytes
+    // not yet read
+    uint8_t *output;
+    size_t out_capacity;
+    size_t out_len;
+    size_t out_read;
+
+    uint8_t block[ZSTD_BLOCK_SIZE_MAX];
+    uint8_t literals[ZSTD_BLOCK_SIZE_MAX];
+};
+
+static size_t ReadInput(zstd_stream_t *stream, uint8_t *buffer, size_t len) {
+    size_t read = 0;
+    while (read < len && stream->prefix_pos < stream->prefix_len) {
+        buffer[read++] = stream->prefix[stream->prefix_pos++];
+    }
+    if (read < len) {
+        read += CaptureFileRead(stream->file, buffer + read, len - read);
+    }
+    return read;
+}
+
+// Pass over a skippable frame's content, seeking when the file allows it
+static int SkipInput(zstd_stream_t *stream, uint64_t len) {
+    while (len && stream->prefix_pos < stream->prefix_len) {
+        stream->prefix_pos++;
+        len--;
+    }
+    return CaptureFileSkip(stream->file, len);
+}
+
+static size_t BlockMaximum(const zstd_stream_t *stream) {
+    return stream->window_size < ZSTD_BLOCK_SIZE_MAX ? (size_t)stream->window_size : ZSTD_BLOCK_SIZE_MAX;
+}
+
+// Read the next frame header, passing over skippable frames. Returns 0 at
+// the end of the file or on a malformed header, with the state set
+// accordingly.
+static int StartFrame(zstd_stream_t *stream) {
+    static const size_t dictionary_id_sizes[4] = {0, 1, 2, 4};
+    for (;;) {
+        uint8_t magic[4];
+        size_t read = ReadInput(stream, magic, sizeof(magic));
+        if (read == 0 && stream->frames) {
+            stream->state = STATE_DONE;
+            return 0;
+        }
+        if (read != sizeof(magic)) {
+            break;
+        }
+        stream->frames++;
+        uint32_t value = Get32(magic);
+        if ((value & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC) {
+            uint8_t size[4];
+            if (ReadInput(stream, size, sizeof(size)) != sizeof(size) || !SkipInput(stream, Get32(size))) {
+                break;
+            }
+            continue;
+        }
+        uint8_t descriptor;
+        if (value != ZSTD_MAGIC || ReadInput(stream, &descriptor, 1) != 1 || (descriptor & 0x08)) {
+            break;
+        }
+        unsigned content_size_flag = descriptor >> 6;
+        int single_segment = (descriptor >> 5) & 1;
+        size_t content_size_len = content_size_flag ? (size_t)1 << content_size_flag : (size_t)single_segment;
+        size_t dictionary_id_len = dictionary_id_sizes[descriptor & 3];
+        uint8_t fields[1 + 4 + 8];
+        size_t fields_len = (single_segment ? 0 : 1) + dictionary_id_len + content_size_len;
+        if (ReadInput(stream, fields, fields_len) != fields_len) {
+            break;
+        }
+        const uint8_t *p = fields;
+        uint64_t window = 0;
+        if (!single_segment) {
+            uint64_t base = 1ULL << (10 + (p[0] >> 3));
+            window = base + (base >> 3) * (p[0] & 7);
+            p++;
+        }
+        // Frames that need a dictionary cannot be decoded
+        uint32_t dictionary_id = 0;
+        for (size_t i = 0; i < dictionary_id_len; i++) {
+            dictionary_id |= (uint32_t)p[i] << (8 * i);
+        }
+        p += dictionary_id_len;
+        if (dictionary_id) {
+            break;
+        }
+        uint64_t content_size = 0;
+        for (size_t i = 0; i < content_size_len; i++) {
+            content_size |= (uint64_t)p[i] << (8 * i);
+        }
+        if (content_size_len == 2) {
+            content_size += 256;
+        }
+        if (single_segment) {
+            window = content_size;
+        }
+        if (window > ZSTD_WINDOW_SIZE_MAX) {
+            break;
+        }
+
+        // A single segment never outgrows its window; otherwise room for as
+        // much again as the window keeps the history moves infrequent
+        stream->window_size = window;
+        size_t capacity = (size_t)window + (single_segment ? BlockMaximum(stream) : (size_t)window);
+        if (capacity > stream->out_capacity) {
+            duckdb_free(stream->output);
+            stream->output = (uint8_t *)duckdb_malloc(capacity);
+            stream->out_capacity = stream->output ? capacity : 0;
+            if (!stream->output) {
+                break;
+            }
+        }
+        stream->content_size = content_size;
+        stream->has_content_size = content_size_len != 0;
+        stream->has_checksum = (descriptor >> 2) & 1;
+        stream->frame_out = 0;
+        stream->out_len = 0;
+        stream->out_read = 0;
+        stream->repeat[0] = 1;
+        stream->repeat[1] = 4;
+        stream->repeat[2] = 8;
+        stream->huffman_bits = 0;
+        stream->literal_lengths.ready = 0;
+        stream->offsets.ready = 0;
+        stream->match_lengths.ready = 0;
+        stream->state = STATE_BLOCK;
+        return 1;
+    }
+    stream->state = STATE_ERROR;
+    return 0;
+}
+
+// Read a Huffman tree description into stream->huffman. Returns the bytes
+// it takes, or 0 when it is malformed.
+static size_t ReadHuffmanTable(zstd_stream_t *stream, const uint8_t *src, size_t len) {
+    if (!len) {
+        return 0;
+    }
+    uint8_t weights[256];
+    unsigned count = 0;
+    size_t used;
+    unsigned header = src[0];
+    if (header >= 128) {
+        // Weights stored directly, four bits each
+        count = header - 127;
+        used = 1 + (count + 1) / 2;
+        if (used > len) {
+            return 0;
+        }
+        for (unsigned i = 0; i < count; i++) {
+            uint8_t byte = src[1 + i / 2];
+            weights[i] = (uint8_t)(i & 1 ? byte & 15 : byte >> 4);
+        }
+    } else {
+        used = 1 + header;
+        if (used > len || !DecodeWeights(src + 1, header, weights, &count)) {
+            return 0;
+        }
+    }
+
+    // The last symbol's weight is implied: it completes the code
+    uint32_t ranks[HUF_DECODE_MAX_BITS + 1] = {0};
+    uint32_t total = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (weights[i] > HUF_DECODE_MAX_BITS) {
+            return 0;
+        }
+        ranks[weights[i]]++;
+        total += weights[i] ? 1u << (weights[i] - 1) : 0;
+    }
+    if (!total) {
+        return 0;
+    }
+    unsigned bits = HighBit(total) + 1;
+    uint32_t rest = (1u << bits) - total;
+    if (bits > HUF_DECODE_MAX_BITS || (rest & (rest - 1))) {
+        return 0;
+    }
+    unsigned last = HighBit(rest) + 1;
+    weights[count++] = (uint8_t)last;
+    ranks[last]++;
+    if (ranks[1] < 2 || (ranks[1] & 1)) {
+        return 0;
+    }
+
+    // Codes of each weight take consecutive table ranges, lowest weight
+    // (longest code) first and symbols in order within a weight
+    uint32_t start[HUF_DECODE_MAX_BITS + 1];
+    uint32_t next = 0;
+    for (unsigned w = 1; w <= bits; w++) {
+        start[w] = next;
+        next += ranks[w] << (w - 1);
+    }
+    for (unsigned s = 0; s < count; s++) {
+        unsigned w = weights[s];
+        if (!w) {
+            continue;
+        }
+        huf_entry_t entry = {(uint8_t)s, (uint8_t)(bits + 1 - w)};
+        for (uint32_t i = 0; i < 1u << (w - 1); i++) {
+            stream->huffman[start[w] + i] = entry;
+        }
+        start[w] += 1u << (w - 1);
+    }
+    stream->huffman_bits = bits;
+    return used;
+}
+
+static int DecodeHuffmanStream(const zstd_stream_t *stream, const uint8_t *src, size_t len, uint8_t *dst,
+                               size_t count) {
+    bit_reader_t reader;
+    if (!BitInit(&reader, src, len)) {
+        return 0;
+    }
+    unsigned bits = stream->huffman_bits;
+    for (size_t i = 0; i < count; i++) {
+        const huf_entry_t *entry = &stream->huffman[BitPeek(&reader, bits)];
+        dst[i] = entry->symbol;
+        reader.pos -= entry->bits;
+    }
+    return reader.pos == 0;
+}
+
+// Decode the literals section at the start of a compressed block into
+// stream->literals. Returns the bytes it takes, or 0 when it is malformed.
+static size_t DecodeLiterals(zstd_stream_t *stream, const uint8_t *src, size_t len, size_t *literal_count) {
+    if (!len) {
+        return 0;
+    }
+    unsigned type = src[0] & 3;
+    unsigned format = (src[0] >> 2) & 3;
+    size_t header;
+    size_t regenerated;
+    if (type < 2) {
+        // Raw or run-length literals
+        if (format == 1) {
+            header = 2;
+            regenerated = len < 2 ? 0 : (size_t)(src[0] >> 4) | (size_t)src[1] << 4;
+        } else if (format == 3) {
+            header = 3;
+            regenerated = len < 3 ? 0 : (size_t)(src[0] >> 4) | (size_t)src[1] << 4 | (size_t)src[2] << 12;
+        } else {
+            header = 1;
+            regenerated = src[0] >> 3;
+        }
+        size_t used = header + (type == 0 ? regenerated : 1);
+        if (len < header || used > len || regenerated > ZSTD_BLOCK_SIZE_MAX) {
+            return 0;
+        }
+        if (type == 0) {
+            memcpy(stream->literals, src + header, regenerated);
+        } else {
+            memset(stream->literals, src[header], regenerated);
+        }
+        *literal_count = regenerated;
+        return used;
+    }
+
+    // Huffman-coded literals, in one stream or four
+    header = format < 2 ? 3 : format + 2;
+    if (len < header) {
+        return 0;
+    }
+    uint64_t fields = 0;
+    for (size_t i = 0; i < header; i++) {
+        fields |= (uint64_t)src[i] << (8 * i);
+    }
+    unsigned size_bits = format < 2 ? 10 : format == 2 ? 14 : 18;
+    uint64_t size_mask = (1ULL << size_bits) - 1;
+    regenerated = (size_t)((fields >> 4) & size_mask);
+    size_t compressed = (size_t)((fields >> (4 + size_bits)) & size_mask);
+    if (regenerated > ZSTD_BLOCK_SIZE_MAX || header + compressed > len) {
+        return 0;
+    }
+    const uint8_t *data = src + header;
+    size_t data_len = compressed;
+    if (type == 2) {
+        size_t used = ReadHuffmanTable(stream, data, data_len);
+        if (!used) {
+            return 0;
+        }
+        data += used;
+        data_len -= used;
+    } else if (!stream->huffman_bits) {
+        return 0;
+    }
+    if (format == 0) {
+        if (!DecodeHuffmanStream(stream, data, data_len, stream->literals, regenerated)) {
+            return 0;
+        }
+    } else {
+        // A jump table gives the sizes of the first three streams; each of
+        // them decodes a quarter (rounded up) of the literals
+        if (data_len < 6) {
+            return 0;
+        }
+        size_t sizes[4] = {Get16(data), Get16(data + 2), Get16(data + 4), 0};
+        size_t streams = 6 + sizes[0] + sizes[1] + sizes[2];
+        size_t segment = (regenerated + 3) / 4;
+        if (streams > data_len || segment * 3 > regenerated) {
+            return 0;
+        }
+        sizes[3] = data_len - streams;
+        const uint8_t *in = data + 6;
+        uint8_t *out = stream->literals;
+        for (int i = 0; i < 4; i++) {
+            size_t count = i < 3 ? segment : regenerated - 3 * segment;
+            if (!DecodeHuffmanStream(stream, in, sizes[i], out, count)) {
+                return 0;
+            }
+            in += sizes[i];
+            out += count;
+        }
+    }
+    *literal_count = regenerated;
+    return header + compressed;
+}
+
+// Set up a sequence decoding table in the given mode (predefined, RLE, FSE
+// compressed or repeat). Returns the bytes its description takes, or
+// SIZE_MAX when it is malformed.
+static size_t ReadSequenceTable(sequence_table_t *table, unsigned mode, const int16_t *defaults,
+                                unsigned default_symbols, unsigned default_log, unsigned max_symbol, unsigned max_log,
+                                const uint8_t *src, size_t len) {
+    size_t used = 0;
+    switch (mode) {
+    case 0:
+        BuildFseTable(defaults, default_symbols, default_log, table->entries);
+        table->log = default_log;
+        break;
+    case 1:
+        if (!len || src[0] > max_symbol) {
+            return SIZE_MAX;
+        }
+        table->entries[0].symbol = src[0];
+        table->entries[0].bits = 0;
+        table->entries[0].baseline = 0;
+        table->log = 0;
+        used = 1;
+        break;
+    case 2: {
+        int16_t counts[FSE_MAX_SYMBOLS];
+        unsigned symbols;
+        used = ReadFseCounts(src, len, max_symbol, max_log, counts, &symbols, &table->log);
+        if (!used || !BuildFseTable(counts, symbols, table->log, table->entries)) {
+            return SIZE_MAX;
+        }
+        break;
+    }
+    default:
+        if (!table->ready) {
+            return SIZE_MAX;
+        }
+        break;
+    }
+    table->ready = 1;
+    return used;
+}
+
+// Decode the sequences section and execute it: literals and matches are
+// written at the end of the output, at most room bytes
+static int DecodeSequences(zstd_stream_t *stream, const uint8_t *src, size_t len, size_t literal_count,
+                           size_t room) {
+    uint8_t *out = stream->output + stream->out_len;
+    uint8_t *end = out + room;
+    const uint8_t *literal = stream->literals;
+    const uint8_t *literal_end = literal + literal_count;
+    if (!len) {
+        return 0;
+    }
+    uint32_t count = src[0];
+    size_t pos = 1;
+    if (count >= 255) {
+        if (len < 3) {
+            return 0;
+        }
+        count = src[1] + ((uint32_t)src[2] << 8) + 0x7F00;
+        pos = 3;
+    } else if (count >= 128) {
+        if (len < 2) {
+            return 0;
+        }
+        count = ((count - 128) << 8) + src[1];
+        pos = 2;
+    }
+
+    if (count) {
+        if (pos >= len) {
+            return 0;
+        }
+        unsigned modes = src[pos++];
+        if (modes & 3) {
+            return 0;
+        }
+        size_t used = ReadSequenceTable(&stream->literal_lengths, modes >> 6, ll_default, LL_MAX_SYMBOL + 1,
+                                        LL_DEFAULT_LOG, LL_MAX_SYMBOL, LL_MAX_LOG, src + pos, len - pos);
+        if (used == SIZE_MAX) {
+            return 0;
+        }
+        pos += used;
+        used = ReadSequenceTable(&stream->offsets, (modes >> 4) & 3, of_default, 29, OF_DEFAULT_LOG, OF_MAX_SYMBOL,
+                                 OF_MAX_LOG, src + pos, len - pos);
+        if (used == SIZE_MAX) {
+            return 0;
+        }
+        pos += used;
+        used = ReadSequenceTable(&stream->match_lengths, (modes >> 2) & 3, ml_default, ML_MAX_SYMBOL + 1,
+                                 ML_DEFAULT_LOG, ML_MAX_SYMBOL, ML_MAX_LOG, src + pos, len - pos);
+        if (used == SIZE_MAX) {
+            return 0;
+        }
+        pos += used;
+
+        const fse_entry_t *ll_table = stream->literal_lengths.entries;
+        const fse_entry_t *of_table = stream->offsets.entries;
+        const fse_entry_t *ml_table = stream->match_lengths.entries;
+        bit_reader_t reader;
+        if (!BitInit(&reader, src + pos, len - pos)) {
+            return 0;
+        }
+        uint32_t ll_state = BitRead(&reader, stream->literal_lengths.log);
+        uint32_t of_state = BitRead(&reader, stream->offsets.log);
+        uint32_t ml_state = BitRead(&reader, stream->match_lengths.log);
+        uint32_t *repeat = stream->repeat;
+        for (uint32_t i = 0; i < count; i++) {
+            const fse_entry_t *ll_entry = &ll_table[ll_state];
+            const fse_entry_t *of_entry = &of_table[of_state];
+            const fse_entry_t *ml_entry = &ml_table[ml_state];
+            uint32_t offset = (1u << of_entry->symbol) + BitRead(&reader, of_entry->symbol);
+            size_t match_len = ml_base[ml_entry->symbol] + BitRead(&reader, ml_bits[ml_entry->symbol]);
+            size_t literal_len = ll_base[ll_entry->symbol] + BitRead(&reader, ll_bits[ll_entry->symbol]);
+
+            // Offset values up to 3 pick one of the repeated offsets (shifted
+            // by one without literals); larger ones are new offsets
+            if (offset > 3) {
+                repeat[2] = repeat[1];
+                repeat[1] = repeat[0];
+                repeat[0] = offset - 3;
+                offset = repeat[0];
+            } else {
+                unsigned index = offset - 1 + (literal_len == 0);
+                if (index) {
+                    offset = index == 3 ? repeat[0] - 1 : repeat[index];
+                    if (index != 1) {
+                        repeat[2] = repeat[1];
+                    }
+                    repeat[1] = repeat[0];
+                    repeat[0] = offset;
+                } else {
+                    offset = repeat[0];
+                }
+            }
+            if (i + 1 < count) {
+                ll_state = ll_entry->baseline + BitRead(&reader, ll_entry->bits);
+                ml_state = ml_entry->baseline + BitRead(&reader, ml_entry->bits);
+                of_state = of_entry->baseline + BitRead(&reader, of_entry->bits);
+            }
+
+            if (literal_len > (size_t)(literal_end - literal) || literal_len + match_len > (size_t)(end - out)) {
+                return 0;
+            }
+            memcpy(out, literal, literal_len);
+            out += literal_len;
+            literal += literal_len;
+            if (!offset || offset > (size_t)(out - stream->output)) {
+                return 0;
+            }
+            const uint8_t *match = out - offset;
+            if (offset >= match_len) {
+                memcpy(out, match, match_len);
+            } else {
+                for (size_t k = 0; k < match_len; k++) {
+                    out[k] = match[k];
+                }
+            }
+            out += match_len;
+        }
+        if (reader.pos != 0) {
+            return 0;
+        }
+    }
+
+    size_t rest = (size_t)(literal_end - literal);
+    if (rest > (size_t)(end - out)) {
+        return 0;
+    }
+    memcpy(out, literal, rest);
+    out += rest;
+    stream->out_len = (size_t)(out - stream->output);
+    return 1;
+}
+
+// Decode the next block of the frame, and the frame's end after its last
+// block. Returns 0 on truncated or corrupt data.
+static int DecodeBlock(zstd_stream_t *stream) {
+    uint8_t header[3];
+    if (ReadInput(stream, header, sizeof(header)) != sizeof(header)) {
+        return 0;
+    }
+    uint32_t fields = (uint32_t)header[0] | (uint32_t)header[1] << 8 | (uint32_t)header[2] << 16;
+    int last = fields & 1;
+    unsigned type = (fields >> 1) & 3;
+    size_t size = fields >> 3;
+    size_t block_max = BlockMaximum(stream);
+    if (size > block_max || type == 3) {
+        return 0;
+    }
+
+    // Keep only the window of history once the buffer runs out of room
+    if (stream->out_capacity - stream->out_len < block_max) {
+        size_t keep = stream->out_len < stream->window_size ? stream->out_len : (size_t)stream->window_size;
+        memmove(stream->output, stream->output + stream->out_len - keep, keep);
+        stream->out_len = keep;
+        stream->out_read = keep;
+    }
+    size_t start = stream->out_len;
+    uint8_t *out = stream->output + start;
+    if (type == 0) {
+        if (ReadInput(stream, out, size) != size) {
+            return 0;
+        }
+        stream->out_len += size;
+    } else if (type == 1) {
+        uint8_t byte;
+        if (ReadInput(stream, &byte, 1) != 1) {
+            return 0;
+        }
+        memset(out, byte, size);
+        stream->out_len += size;
+    } else {
+        size_t literal_count;
+        size_t used;
+        if (ReadInput(stream, stream->block, size) != size ||
+            !(used = DecodeLiterals(stream, stream->block, size, &literal_count)) ||
+            !DecodeSequences(stream, stream->block + used, size - used, literal_count, block_max)) {
+            return 0;
+        }
+    }
+    stream->frame_out += stream->out_len - start;
+    if (stream->has_content_size && stream->frame_out > stream->content_size) {
+        return 0;
+    }
+    if (last) {
+        uint8_t checksum[4];
+        if ((stream->has_checksum && ReadInput(stream, checksum, sizeof(checksum)) != sizeof(checksum)) ||
+            (stream->has_content_size && stream->frame_out != stream->content_size)) {
+            return 0;
+        }
+        stream->state = STATE_FRAME_HEADER;
+    }
+    return 1;
+}
+
+zstd_stream_t *ZstdOpen(capture_file_t *file, const uint8_t *prefix, size_t prefix_len) {
+    zstd_stream_t *stream = (zstd_stream_t *)duckdb_malloc(sizeof(zstd_stream_t));
+    if (!stream) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(zstd_stream_t));
+    stream->file = file;
+    if (prefix_len > sizeof(stream->prefix)) {
+        prefix_len = sizeof(stream->prefix);
+    }
+    memcpy(stream->prefix, prefix, prefix_len);
+    stream->prefix_len = prefix_len;
+    stream->state = STATE_FRAME_HEADER;
+    return stream;
+}
+
+int ZstdSeek(zstd_stream_t *stream, uint64_t in_offset) {
+    if (!CaptureFileSeek(stream->file, in_offset)) {
+        return 0;
+    }
+    stream->prefix_pos = stream->prefix_len;
+    stream->state = STATE_FRAME_HEADER;
+    stream->out_len = 0;
+    stream->out_read = 0;
+    return 1;
+}
+
+size_t ZstdRead(zstd_stream_t *stream, uint8_t *buffer, size_t len) {
+    size_t produced = 0;
+    while (produced < len) {
+        if (stream->out_read < stream->out_len) {
+            size_t available = stream->out_len - stream->out_read;
+            size_t chunk = available < len - produced ? available : len - produced;
+            if (buffer) {
+                memcpy(buffer + produced, stream->output + stream->out_read, chunk);
+            }
+            stream->out_read += chunk;
+            produced += chunk;
+        } else if (stream->state == STATE_BLOCK) {
+            if (!DecodeBlock(stream)) {
+                stream->state = STATE_ERROR;
+            }
+        } else if (stream->state == STATE_FRAME_HEADER) {
+            StartFrame(stream);
+        } else {
+            break;
+        }
+    }
+    return produced;
+}
+
+int ZstdFinished(const zstd_stream_t *stream) {
+    return stream->state == STATE_DONE;
+}
+
+void ZstdClose(zstd_stream_t *stream) {
+    if (stream) {
+        duckdb_free(stream->output);
+        duckdb_free(stream);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Bit output
+// ---------------------------------------------------------------------------
+
+// Little-endian bit writer; overflowing the capacity fails the stream
+typedef struct {
+    uint8_t *dst;
+    size_t capacity;
+    size_t len;
+    uint64_t bits;
+    unsigned count;
+    int overflow;
+} bit_writer_t;
+
+static void BitWriterInit(bit_writer_t *writer, uint8_t *dst, size_t capacity) {
+    memset(writer, 0, sizeof(bit_writer_t));
+    writer->dst = dst;
+    writer->capacity = capacity;
+}
+
+static void BitAdd(bit_writer_t *writer, uint64_t value, unsigned count) {
+    writer->bits |= (value & ((1ULL << count) - 1)) << writer->count;
+    writer->count += count;
+    while (writer->count >= 8) {
+        if (writer->len < writer->capacity) {
+            writer->dst[writer->len++] = (uint8_t)writer->bits;
+        } else {
+            writer->overflow = 1;
+        }
+        writer->bits >>= 8;
+        writer->count -= 8;
+    }
+}
+
+// Write out the last partial byte. Returns the bytes written, 0 on overflow.
+static size_t BitFlush(bit_writer_t *writer) {
+    if (writer->count) {
+        BitAdd(writer, 0, 8 - writer->count);
+    }
+    return writer->overflow ? 0 : writer->len;
+}
+
+// End a backward-read stream with its marker bit
+static size_t BitClose(bit_writer_t *writer) {
+    BitAdd(writer, 1, 1);
+    return BitFlush(writer);
+}
+
+// ---------------------------------------------------------------------------
+// FSE encoding
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint16_t states[1 << FSE_MAX_LOG];
+    struct {
+        int32_t find_state;  // offset of the symbol's states in the table
+        uint32_t bits;       // (bits << 16) - lowest state needing them, rounded
+    } symbols[FSE_MAX_SYMBOLS];
+    unsigned log;
+} fse_ctable_t;
+
+static int BuildFseCTable(const int16_t *counts, unsigned symbols, unsigned log, fse_ctable_t *table) {
+    uint8_t spread[1 << FSE_MAX_LOG];
+    uint32_t high;
+    if (!SpreadSymbols(counts, symbols, log, spread, &high)) {
+        return 0;
+    }
+    uint32_t size = 1u << log;
+    uint32_t cumulative[FSE_MAX_SYMBOLS + 1];
+    cumulative[0] = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        cumulative[s + 1] = cumulative[s] + CountCells(counts[s]);
+    }
+    for (uint32_t u = 0; u < size; u++) {
+        table->states[cumulative[spread[u]]++] = (uint16_t)(size + u);
+    }
+    uint32_t total = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        int count = counts[s];
+        if (count == 0) {
+            table->symbols[s].bits = ((log + 1) << 16) - size;
+            table->symbols[s].find_state = 0;
+        } else if (count == -1 || count == 1) {
+            table->symbols[s].bits = (log << 16) - size;
+            table->symbols[s].find_state = (int32_t)total - 1;
+            total++;
+        } else {
+            unsigned max_bits = log - HighBit((uint32_t)count - 1);
+            table->symbols[s].bits = (max_bits << 16) - ((uint32_t)count << max_bits);
+            table->symbols[s].find_state = (int32_t)total - count;
+            total += (uint32_t)count;
+        }
+    }
+    table->log = log;
+    return 1;
+}
+
+// First state for the last symbol of a stream, which costs no bits
+static uint32_t FseInitState(const fse_ctable_t *table, unsigned symbol) {
+    uint32_t delta = table->symbols[symbol].bits;
+    uint32_t bits = (delta + (1 << 15)) >> 16;
+    uint32_t value = (bits << 16) - delta;
+    return table->states[(int32_t)(value >> bits) + table->symbols[symbol].find_state];
+}
+
+static uint32_t FseEncode(bit_writer_t *writer, const fse_ctable_t *table, uint32_t state, unsigned symbol) {
+    uint32_t bits = (state + table->symbols[symbol].bits) >> 16;
+    BitAdd(writer, state, bits);
+    return table->states[(int32_t)(state >> bits) + table->symbols[symbol].find_state];
+}
+
+static void FseFlush(bit_writer_t *writer, const fse_ctable_t *table, uint32_t state) {
+    BitAdd(writer, state, table->log);
+}
+
+// Table description, the inverse of ReadFseCounts
+static size_t WriteFseCounts(const int16_t *counts, unsigned symbols, unsigned log, uint8_t *dst, size_t capacity) {
+    bit_writer_t writer;
+    BitWriterInit(&writer, dst, capacity);
+    BitAdd(&writer, log - 5, 4);
+    int remaining = (1 << log) + 1;
+    int threshold = 1 << log;
+    unsigned bits = log + 1;
+    unsigned symbol = 0;
+    int previous_zero = 0;
+    while (symbol < symbols && remaining > 1) {
+        if (previous_zero) {
+            unsigned start = symbol;
+            while (symbol < symbols && !counts[symbol]) {
+                symbol++;
+            }
+            if (symbol == symbols) {
+                break;
+            }
+            while (symbol >= start + 3) {
+                BitAdd(&writer, 3, 2);
+                start += 3;
+            }
+            BitAdd(&writer, symbol - start, 2);
+        }
+        int count = counts[symbol++];
+        int max = (2 * threshold - 1) - remaining;
+        remaining -= count < 0 ? -count : count;
+        count++;
+        if (count >= threshold) {
+            count += max;
+        }
+        BitAdd(&writer, (uint32_t)count, bits - (count < max));
+        previous_zero = count == 1;
+        if (remaining < 1) {
+            return 0;
+        }
+        while (remaining < threshold) {
+            bits--;
+            threshold >>= 1;
+        }
+    }
+    return remaining == 1 ? BitFlush(&writer) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t literal_len;
+    uint32_t match_len;
+    uint32_t offset;
+} sequence_t;
+
+struct zstd_encoder {
+    uint32_t head[1 << HASH_BITS];    // 1 + last position with each hash, 0 for none
+    uint32_t *chain;                  // 1 + previous position with the same hash
+    size_t chain_capacity;
+    fse_ctable_t literal_lengths;
+    fse_ctable_t offsets;
+    fse_ctable_t match_lengths;
+    size_t literal_count;
+    size_t sequence_count;
+    uint8_t literals[ZSTD_BLOCK_SIZE_MAX];
+    sequence_t sequences[ZSTD_BLOCK_SIZE_MAX / MIN_MATCH];
+};
+
+zstd_encoder_t *ZstdEncoderCreate(void) {
+    zstd_encoder_t *encoder = (zstd_encoder_t *)duckdb_malloc(sizeof(zstd_encoder_t));
+    if (!encoder) {
+        return NULL;
+    }
+    memset(encoder, 0, sizeof(zstd_encoder_t));
+    BuildFseCTable(ll_default, LL_MAX_SYMBOL + 1, LL_DEFAULT_LOG, &encoder->literal_lengths);
+    BuildFseCTable(of_default, 29, OF_DEFAULT_LOG, &encoder->offsets);
+    BuildFseCTable(ml_default, ML_MAX_SYMBOL + 1, ML_DEFAULT_LOG, &encoder->match_lengths);
+    return encoder;
+}
+
+void ZstdEncoderFree(zstd_encoder_t *encoder) {
+    if (encoder) {
+        duckdb_free(encoder->chain);
+        duckdb_free(encoder);
+    }
+}
+
+size_t ZstdFrameBound(size_t len) {
+    // Header, then every block stored raw in the worst case
+    return 4 + 1 + 8 + len + 3 * (len / ZSTD_BLOCK_SIZE_MAX + 1);
+}
+
+// Code of a literal or match length: the last one whose base is not above it
+static unsigned LengthCode(const uint32_t *base, unsigned codes, uint32_t value) {
+    unsigned low = 0;
+    unsigned high = codes - 1;
+    while (low < high) {
+        unsigned middle = (low + high + 1) / 2;
+        if (base[middle] <= value) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+static uint32_t Hash4(const uint8_t *p) {
+    return (Get32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static size_t MatchLength(const uint8_t *a, const uint8_t *b, size_t max) {
+    size_t len = 0;
+    while (len + 8 <= max && Get64(a + len) == Get64(b + len)) {
+        len += 8;
+    }
+    while (len < max && a[len] == b[len]) {
+        len++;
+    }
+    return len;
+}
+
+static void InsertPosition(zstd_encoder_t *encoder, const uint8_t *src, size_t pos) {
+    uint32_t hash = Hash4(src + pos);
+    encoder->chain[pos] = encoder->head[hash];
+    encoder->head[hash] = (uint32_t)pos + 1;
+}
+
+// Greedy parse of src[start, end) into literals and sequences. Matches may
+// reach back to the start of the frame but not past the end of the block.
+static void FindSequences(zstd_encoder_t *encoder, const uint8_t *src, size_t start, size_t end) {
+    size_t anchor = start;
+    size_t pos = start;
+    encoder->literal_count = 0;
+    encoder->sequence_count = 0;
+    while (pos + MIN_MATCH <= end) {
+        uint32_t hash = Hash4(src + pos);
+        uint32_t candidate = encoder->head[hash];
+        encoder->chain[pos] = candidate;
+        encoder->head[hash] = (uint32_t)pos + 1;
+        size_t best_len = 0;
+        size_t best_offset = 0;
+        for (unsigned depth = 0; candidate && depth < SEARCH_DEPTH; depth++) {
+            size_t match = candidate - 1;
+            if (src[match + best_len] == src[pos + best_len]) {
+                size_t len = MatchLength(src + match, src + pos, end - pos);
+                if (len > best_len) {
+                    best_len = len;
+                    best_offset = pos - match;
+                    if (pos + len == end) {
+                        break;
+                    }
+                }
+            }
+            candidate = encoder->chain[match];
+        }
+        if (best_len < MIN_MATCH) {
+            pos += 1 + ((pos - anchor) >> SKIP_SHIFT);
+            continue;
+        }
+        sequence_t *sequence = &encoder->sequences[encoder->sequence_count++];
+        sequence->literal_len = (uint32_t)(pos - anchor);
+        sequence->match_len = (uint32_t)best_len;
+        sequence->offset = (uint32_t)best_offset;
+        memcpy(encoder->literals + encoder->literal_count, src + anchor, pos - anchor);
+        encoder->literal_count += pos - anchor;
+        size_t match_end = pos + best_len;
+        for (pos++; pos < match_end && pos + MIN_MATCH <= end; pos++) {
+            InsertPosition(encoder, src, pos);
+        }
+        pos = anchor = match_end;
+    }
+    memcpy(encoder->literals + encoder->literal_count, src + anchor, end - anchor);
+    encoder->literal_count += end - anchor;
+}
+
+// Huffman code lengths of at most max_bits for the used symbols, forming a
+// complete code. Returns 0 when fewer than two symbols are used.
+typedef struct {
+    uint32_t count;
+    uint16_t symbol;
+} huf_leaf_t;
+
+static int CompareLeaves(const void *a, const void *b) {
+    const huf_leaf_t *left = (const huf_leaf_t *)a;
+    const huf_leaf_t *right = (const huf_leaf_t *)b;
+    if (left->count != right->count) {
+        return left->count < right->count ? -1 : 1;
+    }
+    return left->symbol < right->symbol ? -1 : 1;
+}
+
+static int BuildHuffmanLengths(const uint32_t *counts, unsigned symbols, unsigned max_bits, uint8_t *lengths) {
+    huf_leaf_t leaves[256];
+    unsigned n = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        lengths[s] = 0;
+        if (counts[s]) {
+            leaves[n].count = counts[s];
+            leaves[n].symbol = (uint16_t)s;
+            n++;
+        }
+    }
+    if (n < 2) {
+        return 0;
+    }
+    qsort(leaves, n, sizeof(huf_leaf_t), CompareLeaves);
+
+    // Two-queue Huffman construction: leaves in count order, then internal
+    // nodes in the order they are made, which is also by weight
+    uint64_t weight[511];
+    uint16_t parent[511];
+    uint8_t depth[511];
+    for (unsigned i = 0; i < n; i++) {
+        weight[i] = leaves[i].count;
+    }
+    unsigned leaf = 0;
+    unsigned internal = n;
+    for (unsigned node = n; node < 2 * n - 1; node++) {
+        unsigned pick[2];
+        for (int k = 0; k < 2; k++) {
+            if (leaf < n && (internal >= node || weight[leaf] <= weight[internal])) {
+                pick[k] = leaf++;
+            } else {
+                pick[k] = internal++;
+            }
+        }
+        weight[node] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = (uint16_t)node;
+        parent[pick[1]] = (uint16_t)node;
+    }
+    depth[2 * n - 2] = 0;
+    for (unsigned node = 2 * n - 2; node-- > 0;) {
+        unsigned d = depth[parent[node]] + 1u;
+        depth[node] = (uint8_t)(d < 255 ? d : 255);
+    }
+
+    // Cap the lengths, then restore an exactly complete code: lengthen the
+    // rarest of the longest capped-below codes while over-subscribed, and
+    // shorten the most frequent of the longest codes while incomplete
+    int64_t kraft = 0;
+    int64_t target = (int64_t)1 << max_bits;
+    for (unsigned i = 0; i < n; i++) {
+        unsigned len = depth[i] < max_bits ? depth[i] : max_bits;
+        lengths[leaves[i].symbol] = (uint8_t)len;
+        kraft += (int64_t)1 << (max_bits - len);
+    }
+    while (kraft > target) {
+        int found = 0;
+        for (unsigned len = max_bits - 1; len >= 1 && !found; len--) {
+            for (unsigned i = 0; i < n; i++) {
+                if (lengths[leaves[i].symbol] == len) {
+                    lengths[leaves[i].symbol]++;
+                    kraft -= (int64_t)1 << (max_bits - len - 1);
+                    found = 1;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            return 0;
+        }
+    }
+    while (kraft < target) {
+        int found = 0;
+        for (unsigned len = max_bits; len > 1 && !found; len--) {
+            if (((int64_t)1 << (max_bits - len)) > target - kraft) {
+                continue;
+            }
+            for (unsigned i = n; i-- > 0;) {
+                if (lengths[leaves[i].symbol] == len) {
+                    lengths[leaves[i].symbol]--;
+                    kraft += (int64_t)1 << (max_bits - len);
+                    found = 1;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// FSE-compress Huffman weights (two interleaved states). Returns the size,
+// or 0 when FSE does not apply or the result would not decode back.
+static size_t CompressWeights(const uint8_t *weights, unsigned count, uint8_t *dst, size_t capacity) {
+    uint32_t histogram[HUF_MAX_BITS + 1] = {0};
+    unsigned symbols = 0;
+    for (unsigned i = 0; i < count; i++) {
+        histogram[weights[i]]++;
+        if (weights[i] + 1u > symbols) {
+            symbols = weights[i] + 1u;
+        }
+    }
+    int16_t counts[HUF_MAX_BITS + 1];
+    int total = 0;
+    unsigned largest = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        int normalized = 0;
+        if (histogram[s]) {
+            normalized = (int)((histogram[s] << HUF_WEIGHT_LOG) / count);
+            normalized = normalized ? normalized : 1;
+        }
+        counts[s] = (int16_t)normalized;
+        total += normalized;
+        if (histogram[s] > histogram[largest]) {
+            largest = s;
+        }
+    }
+    int fixed = counts[largest] + (1 << HUF_WEIGHT_LOG) - total;
+    if (count < 3 || fixed < 1 || fixed == 1 << HUF_WEIGHT_LOG) {
+        return 0;
+    }
+    counts[largest] = (int16_t)fixed;
+    fse_ctable_t table;
+    size_t used = WriteFseCounts(counts, symbols, HUF_WEIGHT_LOG, dst, capacity);
+    if (!used || !BuildFseCTable(counts, symbols, HUF_WEIGHT_LOG, &table)) {
+        return 0;
+    }
+
+    // Weight i is decoded by the first state for even i, the second for odd
+    // i; encoding runs from the last weight back
+    bit_writer_t writer;
+    BitWriterInit(&writer, dst + used, capacity - used);
+    uint32_t states[2];
+    states[(count - 1) & 1] = FseInitState(&table, weights[count - 1]);
+    states[(count - 2) & 1] = FseInitState(&table, weights[count - 2]);
+    for (unsigned i = count - 2; i-- > 0;) {
+        states[i & 1] = FseEncode(&writer, &table, states[i & 1], weights[i]);
+    }
+    FseFlush(&writer, &table, states[1]);
+    FseFlush(&writer, &table, states[0]);
+    size_t stream = BitClose(&writer);
+    uint8_t decoded[256];
+    unsigned decoded_count;
+    if (!stream || !DecodeWeights(dst, used + stream, decoded, &decoded_count) || decoded_count != count ||
+        memcmp(decoded, weights, count) != 0) {
+        return 0;
+    }
+    return used + stream;
+}
+
+static size_t EncodeHuffmanStream(const uint8_t *src, size_t len, const uint16_t *codes, const uint8_t *bits,
+                                  uint8_t *dst, size_t capacity) {
+    bit_writer_t writer;
+    BitWriterInit(&writer, dst, capacity);
+    for (size_t i = len; i-- > 0;) {
+        BitAdd(&writer, codes[src[i]], bits[src[i]]);
+    }
+    return BitClose(&writer);
+}
+
+static size_t PutLiteralsHeader(uint8_t *dst, unsigned type, size_t len) {
+    if (len < 32) {
+        dst[0] = (uint8_t)(type | len << 3);
+        return 1;
+    }
+    if (len < 4096) {
+        dst[0] = (uint8_t)(type | 1 << 2 | (len & 15) << 4);
+        dst[1] = (uint8_t)(len >> 4);
+        return 2;
+    }
+    dst[0] = (uint8_t)(type | 3 << 2 | (len & 15) << 4);
+    dst[1] = (uint8_t)(len >> 4);
+    dst[2] = (uint8_t)(len >> 12);
+    return 3;
+}
+
+// Huffman-coded literals section. Returns its size, or 0 when it cannot be
+// built within capacity.
+static size_t HuffmanLiterals(const uint8_t *literals, size_t len, const uint32_t *counts, unsigned symbols,
+                              uint8_t *dst, size_t capacity) {
+    uint8_t lengths[256];
+    if (capacity < 5 + 6 || !BuildHuffmanLengths(counts, symbols, HUF_MAX_BITS, lengths)) {
+        return 0;
+    }
+    unsigned max_bits = 0;
+    for (unsigned s = 0; s < symbols; s++) {
+        max_bits = lengths[s] > max_bits ? lengths[s] : max_bits;
+    }
+    uint8_t weights[256];
+    uint32_t ranks[HUF_MAX_BITS + 1] = {0};
+    for (unsigned s = 0; s < symbols; s++) {
+        weights[s] = (uint8_t)(lengths[s] ? max_bits + 1 - lengths[s] : 0);
+        ranks[weights[s]]++;
+    }
+    uint32_t start[HUF_MAX_BITS + 1];
+    uint32_t next = 0;
+    for (unsigned w = 1; w <= max_bits; w++) {
+        start[w] = next;
+        next += ranks[w] << (w - 1);
+    }
+    uint16_t codes[256];
+    for (unsigned s = 0; s < symbols; s++) {
+        unsigned w = weights[s];
+        if (w) {
+            codes[s] = (uint16_t)(start[w] >> (w - 1));
+            start[w] += 1u << (w - 1);
+        }
+    }
+
+    // Tree description: the weights of all but the last symbol, FSE-coded
+    // or four bits each, whichever is smaller
+    uint8_t *out = dst + 5;
+    size_t room = capacity - 5;
+    unsigned weight_count = symbols - 1;
+    size_t description = CompressWeights(weights, weight_count, out + 1, room - 1 < 127 ? room - 1 : 127);
+    size_t direct = weight_count <= 128 ? 1 + (weight_count + 1) / 2 : SIZE_MAX;
+    if (description && 1 + description < direct) {
+        out[0] = (uint8_t)description;
+        description++;
+    } else if (direct <= room) {
+        out[0] = (uint8_t)(127 + weight_count);
+        for (unsigned i = 0; i < weight_count; i += 2) {
+            out[1 + i / 2] = (uint8_t)(weights[i] << 4 | (i + 1 < weight_count ? weights[i + 1] : 0));
+        }
+        description = direct;
+    } else {
+        return 0;
+    }
+    out += description;
+    room -= description;
+
+    int four_streams = len >= 256;
+    size_t streams;
+    if (!four_streams) {
+        streams = EncodeHuffmanStream(literals, len, codes, lengths, out, room);
+    } else {
+        if (room < 6) {
+            return 0;
+        }
+        size_t segment = (len + 3) / 4;
+        streams = 6;
+        for (int i = 0; i < 4; i++) {
+            size_t count = i < 3 ? segment : len - 3 * segment;
+            size_t size = EncodeHuffmanStream(literals + (size_t)i * segment, count, codes, lengths, out + streams,
+                                              room - streams);
+            if (!size || (i < 3 && size > UINT16_MAX)) {
+                return 0;
+            }
+            if (i < 3) {
+                Put16(out + 2 * i, (uint32_t)size);
+            }
+            streams += size;
+        }
+    }
+    if (!streams) {
+        return 0;
+    }
+
+    // Section header with the smallest size format that fits, moved up to
+    // the description
+    size_t compressed = description + streams;
+    size_t largest = len > compressed ? len : compressed;
+    unsigned format = !four_streams ? 0 : largest < 1024 ? 1 : largest < 16384 ? 2 : 3;
+    size_t header = format < 2 ? 3 : format + 2;
+    unsigned size_bits = format < 2 ? 10 : format == 2 ? 14 : 18;
+    if (largest >= (size_t)1 << size_bits) {
+        return 0;
+    }
+    uint64_t fields = 2 | (uint64_t)format << 2 | (uint64_t)len << 4 | (uint64_t)compressed << (4 + size_bits);
+    memmove(dst + header, dst + 5, compressed);
+    for (size_t i = 0; i < header; i++) {
+        dst[i] = (uint8_t)(fields >> (8 * i));
+    }
+    return header + compressed;
+}
+
+static size_t EncodeLiterals(const uint8_t *literals, size_t len, uint8_t *dst, size_t capacity) {
+    uint32_t counts[256] = {0};
+    for (size_t i = 0; i < len; i++) {
+        counts[literals[i]]++;
+    }
+    unsigned symbols = 0;
+    unsigned distinct = 0;
+    for (unsigned s = 0; s < 256; s++) {
+        if (counts[s]) {
+            symbols = s + 1;
+            distinct++;
+        }
+    }
+    if (distinct == 1 && capacity >= 4) {
+        size_t header = PutLiteralsHeader(dst, 1, len);
+        dst[header] = literals[0];
+        return header + 1;
+    }
+    size_t raw = (len < 32 ? 1 : len < 4096 ? 2 : 3) + len;
+    if (len >= 64) {
+        size_t size = HuffmanLiterals(literals, len, counts, symbols, dst, capacity < raw ? capacity : raw);
+        if (size && size < raw) {
+            return size;
+        }
+    }
+    if (raw > capacity) {
+        return 0;
+    }
+    size_t header = PutLiteralsHeader(dst, 0, len);
+    memcpy(dst + header, literals, len);
+    return raw;
+}
+
+// Sequences section in the predefined tables. Returns its size, or 0 when it
+// exceeds capacity.
+static size_t EncodeSequences(const zstd_encoder_t *encoder, uint8_t *dst, size_t capacity) {
+    size_t count = encoder->sequence_count;
+    if (capacity < 4) {
+        return 0;
+    }
+    size_t pos;
+    if (count < 128) {
+        dst[0] = (uint8_t)count;
+        pos = 1;
+    } else if (count < 0x7F00) {
+        dst[0] = (uint8_t)((count >> 8) + 128);
+        dst[1] = (uint8_t)count;
+        pos = 2;
+    } else {
+        dst[0] = 255;
+        Put16(dst + 1, (uint32_t)(count - 0x7F00));
+        pos = 3;
+    }
+    if (!count) {
+        return pos;
+    }
+    dst[pos++] = 0;
+
+    // Sequences are written last to first, so that the decoder reads them in
+    // order; each carries its extra bits after the state transitions
+    const fse_ctable_t *ll_table = &encoder->literal_lengths;
+    const fse_ctable_t *of_table = &encoder->offsets;
+    const fse_ctable_t *ml_table = &encoder->match_lengths;
+    bit_writer_t writer;
+    BitWriterInit(&writer, dst + pos, capacity - pos);
+    uint32_t ll_state = 0;
+    uint32_t of_state = 0;
+    uint32_t ml_state = 0;
+    for (size_t i = count; i-- > 0;) {
+        const sequence_t *sequence = &encoder->sequences[i];
+        unsigned ll_code = LengthCode(ll_base, LL_MAX_SYMBOL + 1, sequence->literal_len);
+        unsigned ml_code = LengthCode(ml_base, ML_MAX_SYMBOL + 1, sequence->match_len);
+        uint32_t offset_value = sequence->offset + 3;
+        unsigned of_code = HighBit(offset_value);
+        if (i == count - 1) {
+            ml_state = FseInitState(ml_table, ml_code);
+            of_state = FseInitState(of_table, of_code);
+            ll_state = FseInitState(ll_table, ll_code);
+        } else {
+            of_state = FseEncode(&writer, of_table, of_state, of_code);
+            ml_state = FseEncode(&writer, ml_table, ml_state, ml_code);
+            ll_state = FseEncode(&writer, ll_table, ll_state, ll_code);
+        }
+        BitAdd(&writer, sequence->literal_len - ll_base[ll_code], ll_bits[ll_code]);
+        BitAdd(&writer, sequence->match_len - ml_base[ml_code], ml_bits[ml_code]);
+        BitAdd(&writer, offset_value - (1u << of_code), of_code);
+    }
+    FseFlush(&writer, ml_table, ml_state);
+    FseFlush(&writer, of_table, of_state);
+    FseFlush(&writer, ll_table, ll_state);
+    size_t stream = BitClose(&writer);
+    return stream ? pos + stream : 0;
+}
+
+// Compress one block, falling back to run-length or raw storage when that is
+// smaller. Returns the bytes written, header included.
+static size_t CompressBlock(zstd_encoder_t *encoder, const uint8_t *src, size_t start, size_t len, int last,
+                            uint8_t *dst) {
+    const uint8_t *block = src + start;
+    size_t size = 0;
+    if (len >= 2 * MIN_MATCH) {
+        FindSequences(encoder, src, start, start + len);
+        size_t literals = EncodeLiterals(encoder->literals, encoder->literal_count, dst + 3, len - 1);
+        size_t sequences = literals ? EncodeSequences(encoder, dst + 3 + literals, len - 1 - literals) : 0;
+        size = sequences ? literals + sequences : 0;
+    }
+    unsigned type = 2;
+    if (!size) {
+        size_t run = len ? MatchLength(block, block + 1, len - 1) + 1 : 0;
+        if (run == len && len > 1) {
+            type = 1;
+            dst[3] = block[0];
+        } else {
+            type = 0;
+            memcpy(dst + 3, block, len);
+            size = len;
+        }
+    }
+    uint32_t header = (uint32_t)last | type << 1 | (uint32_t)(type == 1 ? len : size) << 3;
+    dst[0] = (uint8_t)header;
+    dst[1] = (uint8_t)(header >> 8);
+    dst[2] = (uint8_t)(header >> 16);
+    return 3 + (type == 1 ? 1 : size);
+}
+
+size_t ZstdCompressFrame(zstd_encoder_t *encoder, const uint8_t *src, size_t len, uint8_t *dst) {
+    if (len > encoder->chain_capacity) {
+        duckdb_free(encoder->chain);
+        encoder->chain = (uint32_t *)duckdb_malloc(len * sizeof(uint32_t));
+        encoder->chain_capacity = encoder->chain ? len : 0;
+        if (!encoder->chain) {
+            return 0;
+        }
+    }
+    memset(encoder->head, 0, sizeof(encoder->head));
+
+    // Single-segment frame: the content size doubles as the window size
+    uint8_t *out = dst;
+    Put32(out, ZSTD_MAGIC);
+    out += 4;
+    if (len < 256) {
+        *out++ = 0x20;
+        *out++ = (uint8_t)len;
+    } else if (len < 65536 + 256) {
+        *out++ = 0x60;
+        Put16(out, (uint32_t)(len - 256));
+        out += 2;
+    } else {
+        *out++ = 0xA0;
+        Put32(out, (uint32_t)len);
+        out += 4;
+    }
+    size_t pos = 0;
+    do {
+        size_t block_len = len - pos < ZSTD_BLOCK_SIZE_MAX ? len - pos : ZSTD_BLOCK_SIZE_MAX;
+        out += CompressBlock(encoder, src, pos, block_len, pos + block_len == len, out);
+        pos += block_len;
+    } while (pos < len);
+    return (size_t)(out - dst);
+}
@@ -0,0 +1,191 @@
+#include "duckdb_extension.h"
+#include "zstd_seekable.h"
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Seek table: entries of compressed and decompressed size (plus a checksum
+// when the descriptor's top bit is set), then the footer of frame count,
+// descriptor and magic
+#define SEEK_ENTRY_LEN 8
+#define SEEK_FOOTER_LEN 9
+#define SEEK_DESCRIPTOR_CHECKSUM 0x80
+#define SEEK_DESCRIPTOR_RESERVED 0x7C
+
+#define TIME_HEADER_LEN 16
+#define TIME_ENTRY_LEN 24
+
+// Skippable frame header: magic and content size
+#define FRAME_HEADER_LEN 8
+
+// Upper bound on frames accepted from a seek table
+#define MAX_FRAMES (1u << 24)
+
+static void PutU32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void PutU64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t GetU32(const uint8_t *p) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+static uint64_t GetU64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+int ZstdSeekableWriteTables(FILE *file, const zstd_seekable_frame_t *frames, uint32_t count) {
+    uint8_t header[FRAME_HEADER_LEN + TIME_HEADER_LEN];
+    PutU32(header, ZSTD_TIME_INDEX_MAGIC);
+    PutU32(header + 4, TIME_HEADER_LEN + count * TIME_ENTRY_LEN);
+    memcpy(header + FRAME_HEADER_LEN, ZSTD_TIME_INDEX_TAG, 8);
+    PutU32(header + FRAME_HEADER_LEN + 8, count);
+    PutU32(header + FRAME_HEADER_LEN + 12, 0);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t entry[TIME_ENTRY_LEN];
+        PutU64(entry, frames[i].packets);
+        PutU64(entry + 8, frames[i].packets ? frames[i].min_timestamp_ns : 0);
+        PutU64(entry + 16, frames[i].packets ? frames[i].max_timestamp_ns : 0);
+        if (fwrite(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            return 0;
+        }
+    }
+
+    PutU32(header, ZSTD_SEEK_TABLE_MAGIC);
+    PutU32(header + 4, count * SEEK_ENTRY_LEN + SEEK_FOOTER_LEN);
+    if (fwrite(header, 1, FRAME_HEADER_LEN, file) != FRAME_HEADER_LEN) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t entry[SEEK_ENTRY_LEN];
+        PutU32(entry, frames[i].compressed_size);
+        PutU32(entry + 4, frames[i].decompressed_size);
+        if (fwrite(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            return 0;
+        }
+    }
+    uint8_t footer[SEEK_FOOTER_LEN];
+    PutU32(footer, count);
+    footer[4] = 0;
+    PutU32(footer + 5, ZSTD_SEEKABLE_MAGIC);
+    return fwrite(footer, 1, sizeof(footer), file) == sizeof(footer);
+}
+
+static int ReadAt(capture_file_t *file, int64_t offset, uint8_t *buffer, size_t len) {
+    return offset >= 0 && CaptureFileReadAt(file, (uint64_t)offset, buffer, len);
+}
+
+// Build the index from the tables, with the file positioned anywhere
+static capture_index_t *ReadTables(capture_file_t *file, uint64_t first_record) {
+    uint8_t footer[SEEK_FOOTER_LEN];
+    int64_t end = file->size;
+    if (!ReadAt(file, end - SEEK_FOOTER_LEN, footer, sizeof(footer)) || GetU32(footer + 5) != ZSTD_SEEKABLE_MAGIC ||
+        (footer[4] & SEEK_DESCRIPTOR_RESERVED)) {
+        return NULL;
+    }
+    uint32_t count = GetU32(footer);
+    if (!count || count > MAX_FRAMES) {
+        return NULL;
+    }
+    int64_t entry_len = footer[4] & SEEK_DESCRIPTOR_CHECKSUM ? SEEK_ENTRY_LEN + 4 : SEEK_ENTRY_LEN;
+    int64_t seek_table = end - FRAME_HEADER_LEN - (int64_t)count * entry_len - SEEK_FOOTER_LEN;
+    int64_t time_index = seek_table - FRAME_HEADER_LEN - TIME_HEADER_LEN - (int64_t)count * TIME_ENTRY_LEN;
+    uint8_t header[FRAME_HEADER_LEN + TIME_HEADER_LEN];
+    if (!ReadAt(file, seek_table, header, FRAME_HEADER_LEN) || GetU32(header) != ZSTD_SEEK_TABLE_MAGIC ||
+        GetU32(header + 4) != (uint64_t)(end - seek_table - FRAME_HEADER_LEN)) {
+        return NULL;
+    }
+    if (!ReadAt(file, time_index, header, sizeof(header)) || GetU32(header) != ZSTD_TIME_INDEX_MAGIC ||
+        GetU32(header + 4) != TIME_HEADER_LEN + (uint64_t)count * TIME_ENTRY_LEN ||
+        memcmp(header + FRAME_HEADER_LEN, ZSTD_TIME_INDEX_TAG, 8) != 0 || GetU32(header + FRAME_HEADER_LEN + 8) != count) {
+        return NULL;
+    }
+
+    size_t seek_len = (size_t)count * (size_t)entry_len;
+    size_t time_len = (size_t)count * TIME_ENTRY_LEN;
+    uint8_t *entries = (uint8_t *)duckdb_malloc(seek_len + time_len);
+    capture_index_t *index = entries ? CaptureIndexCreate() : NULL;
+    capture_checkpoint_t *checkpoint = index ? CaptureIndexAddCheckpoint(index) : NULL;
+    int ok = checkpoint && ReadAt(file, seek_table + FRAME_HEADER_LEN, entries, seek_len) &&
+             ReadAt(file, time_index + FRAME_HEADER_LEN + TIME_HEADER_LEN, entries + seek_len, time_len);
+    if (!ok) {
+        duckdb_free(entries);
+        CaptureIndexFree(index);
+        return NULL;
+    }
+    checkpoint->record_offset = first_record;
+
+    // Walk both tables side by side; the first region also takes the frames
+    // holding the file header
+    uint64_t in_offset = 0;
+    uint64_t out_offset = 0;
+    for (uint32_t i = 0; i < count && ok; i++) {
+        const uint8_t *entry = entries + (size_t)i * (size_t)entry_len;
+        const uint8_t *times = entries + seek_len + (size_t)i * TIME_ENTRY_LEN;
+        uint32_t decompressed_size = GetU32(entry + 4);
+        if (out_offset > first_record && decompressed_size) {
+            checkpoint = CaptureIndexAddCheckpoint(index);
+            if (!checkpoint) {
+                ok = 0;
+                break;
+            }
+            checkpoint->in_bits = in_offset * 8;
+            checkpoint->out_offset = out_offset;
+            checkpoint->record_offset = out_offset;
+        }
+        uint64_t packets = GetU64(times);
+        if (packets) {
+            uint64_t min_timestamp_ns = GetU64(times + 8);
+            uint64_t max_timestamp_ns = GetU64(times + 16);
+            checkpoint->packets += packets;
+            if (min_timestamp_ns < checkpoint->min_timestamp_ns) {
+                checkpoint->min_timestamp_ns = min_timestamp_ns;
+            }
+            if (max_timestamp_ns > checkpoint->max_timestamp_ns) {
+                checkpoint->max_timestamp_ns = max_timestamp_ns;
+            }
+        }
+        in_offset += GetU32(entry);
+        out_offset += decompressed_size;
+    }
+    duckdb_free(entries);
+
+    // The frames must fill the file up to the time index
+    if (!ok || in_offset != (uint64_t)time_index || out_offset < first_record) {
+        CaptureIndexFree(index);
+        return NULL;
+    }
+    index->compressed_size = (uint64_t)end;
+    return index;
+}
+
+capture_index_t *ZstdSeekableLoad(capture_file_t *file, uint64_t first_record) {
+    uint64_t position = file->position;
+    if (!file->ops->seek || file->size < 0) {
+        return NULL;
+    }
+    capture_index_t *index = ReadTables(file, first_record);
+    if (!CaptureFileSeek(file, position)) {
+        CaptureIndexFree(index);
+        return NULL;
+    }
+    return index;
+}
@@ -0,0 +1,295 @@
+#include "duckdb_extension.h"
+#include "flow.h"
+#include "packet_decode.h"
+#include "partitioned_writer.h"
+#include "pcap_reader.h"
+#include "sync.h"
+#include "zstd_codec.h"
+#include "zstd_seekable.h"
+#include "zstd_writer.h"
+#include <stdio.h>
+#include <string.h>
+
+DUCKDB_EXTENSION_EXTERN
+
+// Snapshot length declared in the file header
+#define WRITER_SNAPLEN 262144
+
+// ---------------------------------------------------------------------------
+// Output files
+// ---------------------------------------------------------------------------
+
+// A seekable zstd capture being written (partitioned_writer.h). States
+// compress frames on their own and append them one at a time; the seek table
+// and time index go after the last frame once the last reference is released.
+typedef struct {
+    partitioned_output_t base;
+    uint32_t link_type;
+    zstd_seekable_frame_t *frames;     // frames written so far, in file order
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+} zstd_output_t;
+
+// Records of one aggregate state bound for one output file: the frame being
+// filled
+typedef struct {
+    partitioned_partition_t base;  // records are pcap records not yet compressed
+    uint64_t packets;
+    uint64_t min_timestamp_ns;
+    uint64_t max_timestamp_ns;
+} zstd_partition_t;
+
+typedef struct {
+    partitioned_writer_t base;
+    zstd_encoder_t *encoder;     // created with the first frame
+    uint8_t *compressed;         // frame being written
+    size_t compressed_capacity;
+    zstd_seekable_frame_t frame;  // seek table entry of that frame
+} zstd_writer_t;
+
+enum {
+    WRITE_ARG_PATH,
+    WRITE_ARG_TIMESTAMP,
+    WRITE_ARG_DATA,
+    WRITE_ARG_LINK_TYPE,
+    WRITE_ARG_ORIGINAL_LEN,
+    WRITE_ARG_COUNT
+};
+
+static zstd_encoder_t *WriterEncoder(zstd_writer_t *writer) {
+    if (!writer->encoder) {
+        writer->encoder = ZstdEncoderCreate();
+    }
+    return writer->encoder;
+}
+
+// Add a frame just appended to the file to its seek table
+static int AddFrame(zstd_output_t *output, const zstd_seekable_frame_t *frame) {
+    if (output->frame_count == output->frame_capacity) {
+        uint32_t capacity = output->frame_capacity ? output->frame_capacity * 2 : 16;
+        zstd_seekable_frame_t *grown =
+            (zstd_seekable_frame_t *)duckdb_malloc(capacity * sizeof(zstd_seekable_frame_t));
+        if (!grown) {
+            return 0;
+        }
+        if (output->frames) {
+            memcpy(grown, output->frames, output->frame_count * sizeof(zstd_seekable_frame_t));
+            duckdb_free(output->frames);
+        }
+        output->frames = grown;
+        output->frame_capacity = capacity;
+    }
+    output->frames[output->frame_count++] = *frame;
+    return 1;
+}
+
+// A new file gets the pcap file header for the row's link type as its first
+// frame
+static int StartFile(partitioned_writer_t *base, partitioned_output_t *base_output, const void *arg) {
+    zstd_writer_t *writer = (zstd_writer_t *)base;
+    zstd_output_t *output = (zstd_output_t *)base_output;
+    output->link_type = *(const uint32_t *)arg;
+    zstd_encoder_t *encoder = WriterEncoder(writer);
+    if (!encoder) {
+        return 0;
+    }
+    pcap_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic_number = PCAP_MAGIC_NANO_NATIVE;
+    header.version_major = 2;
+    header.version_minor = 4;
+    header.snaplen = WRITER_SNAPLEN;
+    header.network = output->link_type;
+    uint8_t frame[64];
+    size_t frame_len = ZstdCompressFrame(encoder, (const uint8_t *)&header, sizeof(header), frame);
+    zstd_seekable_frame_t entry = {(uint32_t)frame_len, sizeof(header), 0, 0, 0};
+    return frame_len && fwrite(frame, 1, frame_len, base_output->file) == frame_len && AddFrame(output, &entry);
+}
+
+// Compress the partition's records into a frame
+static const uint8_t *EncodeFrame(partitioned_writer_t *base, partitioned_partition_t *base_partition,
+                                  size_t *frame_len) {
+    zstd_writer_t *writer = (zstd_writer_t *)base;
+    zstd_partition_t *partition = (zstd_partition_t *)base_partition;
+    size_t len = base_partition->records.len;
+    size_t bound = ZstdFrameBound(len);
+    if (bound > writer->compressed_capacity) {
+        duckdb_free(writer->compressed);
+        writer->compressed = (uint8_t *)duckdb_malloc(bound);
+        writer->compressed_capacity = writer->compressed ? bound : 0;
+    }
+    zstd_encoder_t *encoder = WriterEncoder(writer);
+    *frame_len = encoder && writer->compressed
+                     ? ZstdCompressFrame(encoder, base_partition->records.data, len, writer->compressed)
+                     : 0;
+    zstd_seekable_frame_t frame = {(uint32_t)*frame_len, (uint32_t)len, partition->packets,
+                                   partition->min_timestamp_ns, partition->max_timestamp_ns};
+    writer->frame = frame;
+    partition->packets = 0;
+    return *frame_len ? writer->compressed : NULL;
+}
+
+static int FrameAppended(partitioned_writer_t *writer, partitioned_output_t *output) {
+    return AddFrame((zstd_output_t *)output, &((zstd_writer_t *)writer)->frame);
+}
+
+static int FinishFile(partitioned_output_t *output) {
+    zstd_output_t *zstd_output = (zstd_output_t *)output;
+    return ZstdSeekableWriteTables(output->file, zstd_output->frames, zstd_output->frame_count);
+}
+
+static void FreeOutput(partitioned_output_t *output) {
+    duckdb_free(((zstd_output_t *)output)->frames);
+}
+
+static void FreeWriter(partitioned_writer_t *base) {
+    zstd_writer_t *writer = (zstd_writer_t *)base;
+    ZstdEncoderFree(writer->encoder);
+    duckdb_free(writer->compressed);
+    writer->encoder = NULL;
+    writer->compressed = NULL;
+    writer->compressed_capacity = 0;
+}
+
+static const partitioned_writer_ops_t zstd_ops = {
+    .writer_size = sizeof(zstd_writer_t),
+    .output_size = sizeof(zstd_output_t),
+    .partition_size = sizeof(zstd_partition_t),
+    .flush_size = ZSTD_WRITER_FRAME_SIZE,
+    .buffer_budget = ZSTD_WRITER_BUFFER_BUDGET,
+    .open_error = "Failed to open zstd output file",
+    .write_error = "Failed to write zstd output file",
+    .start_file = StartFile,
+    .encode = EncodeFrame,
+    .appended = FrameAppended,
+    .finish_file = FinishFile,
+    .free_output = FreeOutput,
+    .free_writer = FreeWriter,
+};
+
+// ---------------------------------------------------------------------------
+// Aggregate
+// ---------------------------------------------------------------------------
+
+static void WriteUpdate(duckdb_function_info info, duckdb_data_chunk input, duckdb_aggregate_state *states) {
+    idx_t size = duckdb_data_chunk_get_size(input);
+    idx_t columns = duckdb_data_chunk_get_column_count(input);
+    void *data[WRITE_ARG_COUNT] = {NULL};
+    uint64_t *validity[WRITE_ARG_COUNT] = {NULL};
+    for (idx_t i = 0; i < columns && i < WRITE_ARG_COUNT; i++) {
+        duckdb_vector vector = duckdb_data_chunk_get_vector(input, i);
+        data[i] = duckdb_vector_get_data(vector);
+        validity[i] = duckdb_vector_get_validity(vector);
+    }
+    duckdb_string_t *paths = (duckdb_string_t *)data[WRITE_ARG_PATH];
+    uint64_t *timestamps = (uint64_t *)data[WRITE_ARG_TIMESTAMP];
+    duckdb_string_t *packets = (duckdb_string_t *)data[WRITE_ARG_DATA];
+    int32_t *link_types = (int32_t *)data[WRITE_ARG_LINK_TYPE];
+    int64_t *original_lens = (int64_t *)data[WRITE_ARG_ORIGINAL_LEN];
+
+    for (idx_t row = 0; row < size; row++) {
+        if (!PcapRowValid(validity[WRITE_ARG_PATH], row) || !PcapRowValid(validity[WRITE_ARG_TIMESTAMP], row) ||
+            !PcapRowValid(validity[WRITE_ARG_DATA], row)) {
+            continue;
+        }
+        partitioned_writer_t *writer = (partitioned_writer_t *)states[row];
+        uint32_t link_type = LINKTYPE_ETHERNET;
+        if (link_types && PcapRowValid(validity[WRITE_ARG_LINK_TYPE], row)) {
+            if (link_types[row] < 0 || link_types[row] > UINT16_MAX) {
+                duckdb_aggregate_function_set_error(info, "link_type must be between 0 and 65535");
+                return;
+            }
+            link_type = (uint32_t)link_types[row];
+        }
+        uint64_t timestamp_ns = timestamps[row];
+        if (timestamp_ns / 1000000000 > UINT32_MAX) {
+            duckdb_aggregate_function_set_error(info, "timestamp_ns is beyond the range of pcap timestamps");
+            return;
+        }
+        size_t path_len;
+        const char *path = (const char *)PcapStringBytes(&paths[row], &path_len);
+        zstd_partition_t *partition =
+            (zstd_partition_t *)PartitionedWriterPartition(writer, path, path_len, &link_type);
+        if (!partition) {
+            duckdb_aggregate_function_set_error(info, zstd_ops.open_error);
+            return;
+        }
+        if (((zstd_output_t *)partition->base.output)->link_type != link_type) {
+            duckdb_aggregate_function_set_error(info, "pcap_write_zstd writes a single link_type per file");
+            return;
+        }
+
+        size_t len;
+        const uint8_t *bytes = PcapStringBytes(&packets[row], &len);
+        if (len > PCAPNG_MAX_BLOCK_SIZE) {
+            duckdb_aggregate_function_set_error(info, "Packet too large for pcap");
+            return;
+        }
+        uint32_t original_len;
+        if (!PartitionedWriterOriginalLen(original_lens, validity[WRITE_ARG_ORIGINAL_LEN], row, len, &original_len)) {
+            duckdb_aggregate_function_set_error(info, PARTITIONED_WRITER_ORIGINAL_LEN_ERROR);
+            return;
+        }
+        // Frames end at record boundaries, so a region read never starts
+        // inside a record
+        stream_buffer_t *records = &partition->base.records;
+        if (records->len && records->len + sizeof(pcap_packet_header_t) + len > ZSTD_WRITER_FRAME_SIZE &&
+            !PartitionedWriterFlush(writer, &partition->base)) {
+            duckdb_aggregate_function_set_error(info, zstd_ops.write_error);
+            return;
+        }
+        pcap_packet_header_t header;
+        header.ts_sec = (uint32_t)(timestamp_ns / 1000000000);
+        header.ts_usec = (uint32_t)(timestamp_ns % 1000000000);
+        header.caplen = (uint32_t)len;
+        header.len = original_len;
+        if (!StreamBufferAppend(records, (const uint8_t *)&header, sizeof(header), SIZE_MAX) ||
+            !StreamBufferAppend(records, bytes, len, SIZE_MAX)) {
+            duckdb_aggregate_function_set_error(info, "Out of memory buffering zstd output");
+            return;
+        }
+        if (!partition->packets || timestamp_ns < partition->min_timestamp_ns) {
+            partition->min_timestamp_ns = timestamp_ns;
+        }
+        if (!partition->packets || timestamp_ns > partition->max_timestamp_ns) {
+            partition->max_timestamp_ns = timestamp_ns;
+        }
+        partition->packets++;
+        if (!PartitionedWriterAdded(writer, &partition->base, sizeof(header) + len)) {
+            duckdb_aggregate_function_set_error(info, zstd_ops.write_error);
+            return;
+        }
+    }
+}
+
+static void AddParameter(duckdb_aggregate_function function, duckdb_type type) {
+    duckdb_logical_type logical_type = duckdb_create_logical_type(type);
+    duckdb_aggregate_function_add_parameter(function, logical_type);
+    duckdb_destroy_logical_type(&logical_type);
+}
+
+void RegisterZstdWriterFunction(duckdb_connection connection) {
+    static const duckdb_type parameter_types[WRITE_ARG_COUNT] = {DUCKDB_TYPE_VARCHAR, DUCKDB_TYPE_UBIGINT,
+                                                                 DUCKDB_TYPE_BLOB, DUCKDB_TYPE_INTEGER,
+                                                                 DUCKDB_TYPE_BIGINT};
+
+    duckdb_logical_type ubigint = duckdb_create_logical_type(DUCKDB_TYPE_UBIGINT);
+    duckdb_aggregate_function_set set = duckdb_create_aggregate_function_set("pcap_write_zstd");
+    for (idx_t arity = WRITE_ARG_LINK_TYPE; arity <= WRITE_ARG_COUNT; arity++) {
+        duckdb_aggregate_function function = duckdb_create_aggregate_function();
+        duckdb_aggregate_function_set_name(function, "pcap_write_zstd");
+        for (idx_t i = 0; i < arity; i++) {
+            AddParameter(function, parameter_types[i]);
+        }
+        duckdb_aggregate_function_set_return_type(function, ubigint);
+        PartitionedWriterSetFunctions(function, &zstd_ops, WriteUpdate);
+        // A NULL link_type means Ethernet and a NULL original_len the data
+        // length, so rows are not skipped
+        duckdb_aggregate_function_set_special_handling(function);
+        duckdb_add_aggregate_function_to_set(set, function);
+        duckdb_destroy_aggregate_function(&function);
+    }
+    duckdb_register_aggregate_function_set(connection, set);
+    duckdb_destroy_aggregate_function_set(&set);
+    duckdb_destroy_logical_type(&ubigint);
+}
@@ -10,10 +10,17 @@ Supports creating PCAP files with:
 """
 
 import argparse
+import gzip
+import hashlib
+import hmac
+import io
 import struct
+import tarfile
 import time
 import random
+import subprocess
 import sys
+import zipfile
 from pathlib import Path
 
 # PCAP magic numbers
@@ -76,6 +83,1272 @@ def generate_simple_pcap(filename, precision='micro'):
     
     print(f"Created {precision}second-precision PCAP: {filename}")
 
+def ethernet_frame(payload, ethertype, src_mac=b'\x02\x00\x00\x00\x00\x01',
+                   dst_mac=b'\x02\x00\x00\x00\x00\x02'):
+    """Wrap a payload in an Ethernet II header."""
+    return dst_mac + src_mac + struct.pack('>H', ethertype) + payload
+
+def ipv4_packet(payload, proto, src_ip, dst_ip, ttl=64):
+    """Build an IPv4 header (no options) around a payload."""
+    header = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(payload), 0, 0x4000,
+                         ttl, proto, 0, bytes(src_ip), bytes(dst_ip))
+    return header + payload
+
+def udp_datagram(payload, src_port, dst_port):
+    """Build a UDP header (checksum left at zero) around a payload."""
+    return struct.pack('>HHHH', src_port, dst_port, 8 + len(payload), 0) + payload
+
+def udp_frame(payload, src_ip, dst_ip, src_port, dst_port, **kwargs):
+    """Ethernet/IPv4/UDP frame carrying a payload."""
+    ip = ipv4_packet(udp_datagram(payload, src_port, dst_port), 17, src_ip, dst_ip)
+    return ethernet_frame(ip, 0x0800, **kwargs)
+
+def tcp_segment(payload, src_port, dst_port, seq, ack=0, flags=0x18, window=65535):
+    """Build a TCP header (no options, checksum left at zero) around a payload."""
+    return struct.pack('>HHIIBBHHH', src_port, dst_port, seq, ack, 5 << 4, flags,
+                       window, 0, 0) + payload
+
+def tcp_frame(payload, src_ip, dst_ip, src_port, dst_port, seq, ack=0, flags=0x18, **kwargs):
+    """Ethernet/IPv4/TCP frame carrying a payload."""
+    ip = ipv4_packet(tcp_segment(payload, src_port, dst_port, seq, ack, flags), 6, src_ip, dst_ip)
+    return ethernet_frame(ip, 0x0800, **kwargs)
+
+class TcpConversation:
+    """Client/server TCP connection that tracks sequence numbers for both sides."""
+
+    def __init__(self, client_ip, client_port, server_ip, server_port, start_ns, step_ns=1000000):
+        self.endpoints = [(client_ip, client_port), (server_ip, server_port)]
+        self.seq = [1000, 50000]
+        self.ts = start_ns
+        self.step = step_ns
+        self.frames = []
+
+    def send(self, side, payload=b'', flags=0x18, seq=None):
+        """Append a segment from side 0 (client) or 1 (server)."""
+        src, dst = self.endpoints[side], self.endpoints[1 - side]
+        seq = self.seq[side] if seq is None else seq
+        self.frames.append((self.ts, tcp_frame(payload, src[0], dst[0], src[1], dst[1],
+                                               seq, self.seq[1 - side], flags)))
+        self.ts += self.step
+        consumed = len(payload) + (1 if flags & 0x03 else 0)
+        self.seq[side] = max(self.seq[side], seq + consumed)
+
+    def handshake(self):
+        self.send(0, flags=0x02)
+        self.send(1, flags=0x12)
+        self.send(0, flags=0x10)
+
+    def close(self):
+        self.send(0, flags=0x11)
+        self.send(1, flags=0x11)
+        self.send(0, flags=0x10)
+
+def write_timed_pcap(filename, frames, precision='nano', network=1):
+    """Write (timestamp_ns, frame) pairs with deterministic timestamps."""
+    with open(filename, 'wb') as f:
+        write_pcap_header(f, precision=precision, network=network)
+        for ts_ns, frame in frames:
+            subsec = ts_ns % 1000000000
+            if precision != 'nano':
+                subsec //= 1000
+            write_packet(f, frame, ts_ns // 1000000000, subsec, precision)
+
+def ptp_message(message_type, domain, port_identity, sequence_id, body,
+                two_step=False, correction_ns=0):
+    """Build a PTPv2 message from its common header fields and body."""
+    flags = 0x0200 if two_step else 0
+    header = struct.pack('>BBHBBHq4s10sHBb',
+                         message_type, 2, 34 + len(body), domain, 0, flags,
+                         correction_ns * 65536, b'\x00' * 4, port_identity,
+                         sequence_id, 0, 0)
+    return header + body
+
+def ptp_timestamp(ts_ns):
+    """PTP timestamp: 48-bit seconds and 32-bit nanoseconds."""
+    seconds = ts_ns // 1000000000
+    return struct.pack('>HII', seconds >> 32, seconds & 0xFFFFFFFF, ts_ns % 1000000000)
+
+def ntp_timestamp(ts_ns):
+    """NTP 32.32 timestamp for a Unix time in nanoseconds."""
+    seconds = ts_ns // 1000000000 + 2208988800
+    fraction = -((-(ts_ns % 1000000000) << 32) // 1000000000)  # ceil keeps ns exact
+    return struct.pack('>II', seconds & 0xFFFFFFFF, fraction)
+
+def generate_timing_pcap(filename):
+    """Generate a nanosecond capture with PTP exchanges and an NTP query."""
+    master = bytes.fromhex('001122fffe334455') + struct.pack('>H', 1)
+    slave = bytes.fromhex('aabbccfffeddeeff') + struct.pack('>H', 1)
+    master_ip, slave_ip = [192, 168, 1, 1], [192, 168, 1, 2]
+    base = 1000 * 1000000000
+    zero_ts = ptp_timestamp(0)
+
+    def ptp_udp(msg, port, src_ip, dst_ip=(224, 0, 1, 129)):
+        return udp_frame(msg, src_ip, dst_ip, port, port)
+
+    frames = [
+        # Two-step Sync / Follow_Up: t1 = base + 500, t2 = base + 1000
+        (base + 1000, ptp_udp(ptp_message(0x0, 0, master, 1, zero_ts, two_step=True), 319, master_ip)),
+        (base + 2000, ptp_udp(ptp_message(0x8, 0, master, 1, ptp_timestamp(base + 500),
+                                          correction_ns=10), 320, master_ip)),
+        # Delay_Req / Delay_Resp: t3 = base + 100000, t4 = base + 100300
+        (base + 100000, ptp_udp(ptp_message(0x1, 0, slave, 7, zero_ts), 319, slave_ip)),
+        (base + 101000, ptp_udp(ptp_message(0x9, 0, master, 7, ptp_timestamp(base + 100300) + slave),
+                                320, master_ip)),
+        # Announce on another domain
+        (base + 200000, ptp_udp(ptp_message(0xB, 4, master, 2, ptp_timestamp(base) + b'\x00' * 20),
+                                320, master_ip)),
+        # Layer 2 two-step peer delay: t1 = +1s, t2 = +1s+200, t3 = +1s+600, t4 = +1s+1000
+        (base + 1000000000, ethernet_frame(ptp_message(0x2, 0, slave, 3, zero_ts + b'\x00' * 10), 0x88F7)),
+        (base + 1000001000, ethernet_frame(ptp_message(0x3, 0, master, 3,
+                                                       ptp_timestamp(base + 1000000200) + slave,
+                                                       two_step=True), 0x88F7)),
+        (base + 1000002000, ethernet_frame(ptp_message(0xA, 0, master, 3,
+                                                       ptp_timestamp(base + 1000000600) + slave), 0x88F7)),
+    ]
+
+    # NTP client query at T1 and server reply with T2/T3, captured at T4
+    t1, t2, t3, t4 = base + 2000000000, base + 2000000800, base + 2000001000, base + 2000002000
+    client_ip, server_ip = [10, 0, 0, 2], [10, 0, 0, 1]
+    query = struct.pack('>BBbbII4s', 0x23, 0, 6, -20, 0, 0, b'\x00' * 4) + bytes(16) + bytes(8) + ntp_timestamp(t1)
+    reply = (struct.pack('>BBbbII4s', 0x24, 1, 6, -23, 0x00010000, 0x00008000, b'GPS\x00') +
+             ntp_timestamp(base) + ntp_timestamp(t1) + ntp_timestamp(t2) + ntp_timestamp(t3))
+    frames.append((t1, udp_frame(query, client_ip, server_ip, 50123, 123)))
+    frames.append((t4, udp_frame(reply, server_ip, client_ip, 123, 50123)))
+    # A reply to a client whose clock is set before 1970
+    t1_1969 = -86400 * 365 * 1000000000
+    reply_1969 = (struct.pack('>BBbbII4s', 0x24, 1, 6, -23, 0x00010000, 0x00008000, b'GPS\x00') +
+                  ntp_timestamp(base) + ntp_timestamp(t1_1969) + ntp_timestamp(t2 + 1000000000) +
+                  ntp_timestamp(t3 + 1000000000))
+    frames.append((t4 + 1000000000, udp_frame(reply_1969, server_ip, client_ip, 123, 50124)))
+
+    write_timed_pcap(filename, frames, precision='nano')
+    print(f"Created timing PCAP: {filename}")
+
+def ipv6_packet(payload, next_header, src_ip, dst_ip, hop_limit=255):
+    """Build an IPv6 header around a payload."""
+    return struct.pack('>IHBB16s16s', 0x60000000, len(payload), next_header, hop_limit,
+                       bytes(src_ip), bytes(dst_ip)) + payload
+
+def arp_frame(operation, sender_mac, sender_ip, target_mac, target_ip, frame_src=None):
+    """Ethernet frame carrying an ARP request (1) or reply (2)."""
+    arp = struct.pack('>HHBBH6s4s6s4s', 1, 0x0800, 6, 4, operation,
+                      sender_mac, bytes(sender_ip), target_mac, bytes(target_ip))
+    return ethernet_frame(arp, 0x0806, src_mac=frame_src or sender_mac, dst_mac=b'\xff' * 6)
+
+def dhcp_frame(message_type, xid, client_mac, src_ip, dst_ip, ciaddr=(0, 0, 0, 0),
+               yiaddr=(0, 0, 0, 0), options=(), src_mac=None):
+    """Ethernet/IPv4/UDP frame carrying a DHCPv4 message."""
+    op = 1 if message_type in (1, 3, 4, 7, 8) else 2
+    bootp = struct.pack('>BBBBIHH4s4s4s4s16s64s128s', op, 1, 6, 0, xid, 0, 0,
+                        bytes(ciaddr), bytes(yiaddr), bytes(4), bytes(4),
+                        client_mac, b'', b'')
+    opts = struct.pack('>IBBB', 0x63825363, 53, 1, message_type)
+    for code, value in options:
+        opts += struct.pack('>BB', code, len(value)) + value
+    opts += b'\xff'
+    ports = (68, 67) if op == 1 else (67, 68)
+    return udp_frame(bootp + opts, src_ip, dst_ip, *ports, src_mac=src_mac or client_mac)
+
+def icmpv6_nd_frame(icmp_type, src_mac, src_ip, dst_ip, target, option_type=None, option_mac=None, flags=0):
+    """Ethernet/IPv6 frame carrying a neighbor discovery message."""
+    body = struct.pack('>BBHI16s', icmp_type, 0, 0, flags << 24, bytes(target))
+    if option_type:
+        body += struct.pack('>BB6s', option_type, 1, option_mac)
+    return ethernet_frame(ipv6_packet(body, 58, src_ip, dst_ip), 0x86DD, src_mac=src_mac)
+
+def generate_addresses_pcap(filename):
+    """Generate ARP, DHCP and ICMPv6 ND traffic with conflicts and spoofing."""
+    mac_a, mac_b = bytes.fromhex('02000000000a'), bytes.fromhex('02000000000b')
+    mac_c, mac_e = bytes.fromhex('02000000000c'), bytes.fromhex('0200000000ee')
+    mac_s, mac_r = bytes.fromhex('020000000001'), bytes.fromhex('0200000000fe')
+    mac_f = bytes.fromhex('0200000000ff')
+    host_a, host_x = [192, 168, 1, 10], [192, 168, 1, 20]
+    server, rogue = [192, 168, 1, 1], [192, 168, 1, 254]
+    lease = [192, 168, 1, 50]
+    zero, bcast = [0, 0, 0, 0], [255, 255, 255, 255]
+    ll_a = bytes.fromhex('fe80000000000000000000fffe00000a')
+    ll_b = bytes.fromhex('fe80000000000000000000fffe00000b')
+    all_nodes = bytes.fromhex('ff020000000000000000000000000001')
+    unspecified = bytes(16)
+    hostname1 = (12, b'laptop-1')
+    base = 1700000000 * 1000000000
+    sec = 1000000000
+
+    frames = [
+        arp_frame(1, mac_a, host_a, bytes(6), server),
+        arp_frame(2, mac_a, host_a, mac_s, server),
+        dhcp_frame(1, 0x1234, mac_c, zero, bcast, options=[hostname1]),
+        dhcp_frame(2, 0x1234, mac_c, server, bcast, yiaddr=lease,
+                   options=[(54, bytes(server)), (51, struct.pack('>I', 3600))], src_mac=mac_s),
+        dhcp_frame(3, 0x1234, mac_c, zero, bcast, options=[hostname1, (50, bytes(lease))]),
+        dhcp_frame(5, 0x1234, mac_c, server, bcast, yiaddr=lease,
+                   options=[(54, bytes(server)), (51, struct.pack('>I', 3600))], src_mac=mac_s),
+        dhcp_frame(2, 0x9999, mac_c, rogue, bcast, yiaddr=[192, 168, 1, 99],
+                   options=[(54, bytes(rogue))], src_mac=mac_r),
+        arp_frame(2, mac_e, host_a, mac_s, server),
+        arp_frame(2, mac_b, host_x, mac_s, server, frame_src=mac_f),
+        icmpv6_nd_frame(135, mac_a, ll_a, all_nodes, ll_b, 1, mac_a),
+        icmpv6_nd_frame(136, mac_b, ll_b, ll_a, ll_b, 2, mac_b, flags=0x60),
+        icmpv6_nd_frame(135, mac_e, unspecified, all_nodes, ll_a),
+        dhcp_frame(4, 0x5555, mac_c, zero, bcast, options=[(50, bytes([192, 168, 1, 51]))]),
+        dhcp_frame(3, 0x6666, mac_c, lease, server, ciaddr=lease, options=[(12, b'laptop-2')]),
+        dhcp_frame(7, 0x7777, mac_c, lease, server, ciaddr=lease),
+    ]
+    timed = [(base + i * sec, frame) for i, frame in enumerate(frames)]
+    # Host A reclaims its address with a gratuitous ARP long after the takeover
+    timed.append((base + 300 * sec, arp_frame(2, mac_a, host_a, bytes(6), host_a)))
+
+    write_timed_pcap(filename, timed, precision='micro')
+    print(f"Created address tracking PCAP: {filename}")
+
+def ssh_packet(payload, block=8):
+    """Frame an SSH payload as an unencrypted binary packet (RFC 4253 section 6)."""
+    padding = block - (len(payload) + 5) % block
+    if padding < 4:
+        padding += block
+    return struct.pack('>IB', len(payload) + padding + 1, padding) + payload + bytes(padding)
+
+def ssh_kexinit(lists):
+    """SSH_MSG_KEXINIT with a fixed cookie and ten comma-separated name-lists."""
+    body = bytes([20]) + bytes(range(16))
+    for name_list in lists:
+        body += struct.pack('>I', len(name_list)) + name_list.encode()
+    return ssh_packet(body + bytes(5))
+
+def generate_ssh_pcap(filename):
+    """Generate SSH sessions: a full handshake, a pre-banner line and a truncated exchange."""
+    client_lists = ['curve25519-sha256,diffie-hellman-group14-sha256', 'ssh-ed25519,rsa-sha2-512',
+                    'aes128-ctr,chacha20-poly1305@openssh.com', 'aes128-ctr,chacha20-poly1305@openssh.com',
+                    'hmac-sha2-256', 'hmac-sha2-256', 'none,zlib@openssh.com', 'none,zlib@openssh.com', '', '']
+    server_lists = ['curve25519-sha256', 'ssh-ed25519', 'chacha20-poly1305@openssh.com',
+                    'aes256-gcm@openssh.com', 'hmac-sha2-512', 'hmac-sha2-512', 'none', 'none', '', '']
+    base = 1700000000 * 1000000000
+    client, server = [10, 0, 0, 1], [10, 0, 0, 2]
+
+    # Full session: KEXINIT split across segments, a retransmission, encrypted data
+    conv = TcpConversation(client, 50000, server, 22, base)
+    conv.handshake()
+    conv.send(1, b'SSH-2.0-OpenSSH_9.6\r\n')
+    conv.send(0, b'SSH-2.0-OpenSSH_9.3p1 Ubuntu\r\n')
+    kexinit = ssh_kexinit(client_lists)
+    conv.send(0, kexinit[:40])
+    start = conv.seq[0]
+    conv.send(0, kexinit[40:])
+    conv.send(0, kexinit[40:], seq=start)
+    conv.send(1, ssh_kexinit(server_lists))
+    newkeys = ssh_packet(bytes([21]))
+    conv.send(0, newkeys + bytes(100))
+    conv.send(1, newkeys)
+    conv.send(1, bytes(300))
+    conv.send(0, bytes(64))
+    conv.close()
+    frames = conv.frames
+
+    # Server on a non-standard port that sends a pre-banner line; no FIN seen
+    conv = TcpConversation([10, 0, 0, 3], 40000, server, 2200, base + 1000000000)
+    conv.send(1, b'Welcome\r\nSSH-2.0-dropbear_2022.83\r\n')
+    conv.send(0, b'SSH-2.0-PuTTY_Release_0.80\r\n')
+    conv.send(0, ssh_kexinit(client_lists))
+    frames += conv.frames
+
+    # Non-SSH traffic is ignored
+    conv = TcpConversation([10, 0, 0, 4], 40001, server, 80, base + 2000000000)
+    conv.send(0, b'GET / HTTP/1.1\r\n\r\n')
+    frames += conv.frames
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+    print(f"Created SSH PCAP: {filename}")
+
+def modbus_adu(transaction_id, unit_id, pdu):
+    """Modbus/TCP ADU: MBAP header followed by the PDU."""
+    return struct.pack('>HHHB', transaction_id, 0, len(pdu) + 1, unit_id) + pdu
+
+def dnp3_crc(data):
+    """CRC-16/DNP over a link header or data block."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA6BC if crc & 1 else crc >> 1
+    return struct.pack('<H', ~crc & 0xFFFF)
+
+def dnp3_frame(control, dst, src, user_data):
+    """DNP3 link frame with a CRC after the header and every 16-byte data block."""
+    header = struct.pack('<BBBBHH', 0x05, 0x64, len(user_data) + 5, control, dst, src)
+    frame = header + dnp3_crc(header)
+    for i in range(0, len(user_data), 16):
+        block = user_data[i:i + 16]
+        frame += block + dnp3_crc(block)
+    return frame
+
+def s7_pdu(rosctr, pdu_reference, params, data=b'', error=None):
+    """S7comm PDU in a COTP data TPDU in a TPKT."""
+    header = struct.pack('>BBHHHH', 0x32, rosctr, 0, pdu_reference, len(params), len(data))
+    if error is not None:
+        header += bytes(error)
+    cotp = bytes([2, 0xF0, 0x80])
+    payload = cotp + header + params + data
+    return struct.pack('>BBH', 3, 0, len(payload) + 4) + payload
+
+def s7_item(area, db_number, byte_address, length, transport_size=0x02):
+    """S7ANY variable specification."""
+    bit_address = byte_address * 8
+    return struct.pack('>BBBBHHB', 0x12, 0x0A, 0x10, transport_size, length, db_number,
+                       area) + bit_address.to_bytes(3, 'big')
+
+def generate_industrial_pcap(filename):
+    """Generate Modbus/TCP, DNP3 (TCP and UDP) and S7comm request/response traffic."""
+    base = 1700000000 * 1000000000
+    hmi, plc, rtu = [10, 1, 0, 10], [10, 1, 0, 20], [10, 1, 0, 30]
+
+    # Modbus: pipelined requests in one segment, a response split across segments
+    modbus = TcpConversation(hmi, 49152, plc, 502, base)
+    modbus.handshake()
+    modbus.send(0, modbus_adu(1, 1, struct.pack('>BHH', 3, 100, 10)))
+    modbus.send(1, modbus_adu(1, 1, struct.pack('>BB', 3, 20) + bytes(20)))
+    modbus.send(0, modbus_adu(2, 1, struct.pack('>BHH', 6, 200, 5)) +
+                modbus_adu(3, 1, struct.pack('>BHH', 1, 0, 16)))
+    modbus.send(1, modbus_adu(2, 1, struct.pack('>BHH', 6, 200, 5)))
+    exception = modbus_adu(3, 1, bytes([0x81, 2]))
+    modbus.send(1, exception[:5])
+    modbus.send(1, exception[5:])
+    modbus.close()
+
+    # DNP3 over TCP: class 0 read and a response from a restarted outstation
+    dnp3 = TcpConversation(hmi, 49153, rtu, 20000, base + 100000000)
+    dnp3.handshake()
+    read = bytes([0xC0, 0xC3, 1, 30, 1, 0x00, 0, 9])
+    dnp3.send(0, dnp3_frame(0xC4, 10, 1, read))
+    response = bytes([0xC0, 0xC3, 129, 0x90, 0x00, 30, 1, 0x00, 0, 9]) + bytes(50)
+    dnp3.send(1, dnp3_frame(0x44, 1, 10, response))
+    # Link status request without application data
+    dnp3.send(0, dnp3_frame(0xC9, 10, 1, b''))
+    dnp3.close()
+    frames = modbus.frames + dnp3.frames
+    unsolicited = bytes([0xC0, 0xF5, 130, 0x00, 0x02, 2, 1, 0x17, 1, 3, 0x81])
+    frames.append((base + 200000000, udp_frame(dnp3_frame(0x44, 1, 10, unsolicited), rtu, hmi, 20000, 20000)))
+
+    # S7comm: connection setup, a read split across segments and a failing write
+    s7 = TcpConversation(hmi, 49154, plc, 102, base + 300000000)
+    s7.handshake()
+    s7.send(0, struct.pack('>BBH', 3, 0, 22) + bytes([17, 0xE0, 0, 0, 0, 1, 0, 0xC0, 1, 0x0A,
+                                                     0xC1, 2, 1, 0, 0xC2, 2, 1, 2]))
+    s7.send(0, s7_pdu(1, 1, struct.pack('>BBHHH', 0xF0, 0, 1, 1, 480)))
+    s7.send(1, s7_pdu(3, 1, struct.pack('>BBHHH', 0xF0, 0, 1, 1, 240), error=[0, 0]))
+    read = s7_pdu(1, 2, bytes([0x04, 1]) + s7_item(0x84, 1, 8, 4))
+    s7.send(0, read[:10])
+    s7.send(0, read[10:])
+    s7.send(1, s7_pdu(3, 2, bytes([0x04, 1]), bytes([0xFF, 0x04, 0, 32, 1, 2, 3, 4]), error=[0, 0]))
+    s7.send(0, s7_pdu(1, 3, bytes([0x05, 1]) + s7_item(0x83, 0, 0, 2),
+                      bytes([0, 0x04, 0, 16, 0xAB, 0xCD])))
+    s7.send(1, s7_pdu(3, 3, bytes([0x05, 1]), bytes([0x05]), error=[0, 0]))
+    s7.close()
+    frames += s7.frames
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+    print(f"Created industrial protocols PCAP: {filename}")
+
+def bgp_message(msg_type, body=b''):
+    """BGP message: all-ones marker, length and type."""
+    return b'\xff' * 16 + struct.pack('>HB', 19 + len(body), msg_type) + body
+
+def bgp_open(my_as, bgp_id, as4=None, hold_time=90):
+    """BGP OPEN, optionally advertising the 4-octet AS capability."""
+    params = b''
+    if as4 is not None:
+        capability = struct.pack('>BBI', 65, 4, as4)
+        params = struct.pack('>BB', 2, len(capability)) + capability
+    return bgp_message(1, struct.pack('>BHH4sB', 4, my_as, hold_time, bytes(bgp_id), len(params)) + params)
+
+def bgp_prefix(prefix, length):
+    """NLRI encoding: length in bits followed by the significant octets."""
+    return bytes([length]) + bytes(prefix)[:(length + 7) // 8]
+
+def bgp_attribute(attr_type, value, flags=0x40):
+    if len(value) > 255:
+        return struct.pack('>BBH', flags | 0x10, attr_type, len(value)) + value
+    return struct.pack('>BBB', flags, attr_type, len(value)) + value
+
+def bgp_as_path(segments, width=4):
+    """AS_PATH value from (segment type, [asn, ...]) pairs."""
+    fmt = '>I' if width == 4 else '>H'
+    return b''.join(struct.pack('>BB', seg_type, len(asns)) + b''.join(struct.pack(fmt, a) for a in asns)
+                    for seg_type, asns in segments)
+
+def bgp_update(withdrawn=b'', attributes=b'', nlri=b''):
+    return bgp_message(2, struct.pack('>H', len(withdrawn)) + withdrawn +
+                       struct.pack('>H', len(attributes)) + attributes + nlri)
+
+def ospf_packet(version, packet_type, router_id, area_id, body):
+    """OSPFv2 (24-byte) or OSPFv3 (16-byte) header around a packet body."""
+    if version == 2:
+        header_len = 24
+        header = struct.pack('>BBH4s4sHH8s', 2, packet_type, header_len + len(body),
+                             bytes(router_id), bytes(area_id), 0, 0, bytes(8))
+    else:
+        header_len = 16
+        header = struct.pack('>BBH4s4sHBB', 3, packet_type, header_len + len(body),
+                             bytes(router_id), bytes(area_id), 0, 0, 0)
+    return header + body
+
+def ospf_lsa(version, lsa_type, link_state_id, advertising_router, body, age=1, sequence=0x80000001):
+    """LSA with its 20-byte header."""
+    if version == 2:
+        header = struct.pack('>HBB4s4sIHH', age, 0x02, lsa_type, bytes(link_state_id),
+                             bytes(advertising_router), sequence, 0, 20 + len(body))
+    else:
+        header = struct.pack('>HH4s4sIHH', age, lsa_type, bytes(link_state_id),
+                             bytes(advertising_router), sequence, 0, 20 + len(body))
+    return header + body
+
+def ospf_v3_prefix(prefix, length, field=0):
+    """OSPFv3 address prefix padded to 32-bit words."""
+    words = (length + 31) // 32
+    return struct.pack('>BBH', length, 0, field) + bytes(prefix).ljust(16, b'\x00')[:words * 4]
+
+def generate_routing_pcap(filename):
+    """Generate BGP sessions (4-octet with MP-BGP, and 2-octet with AS4_PATH) and OSPFv2/v3 packets."""
+    base = 1700000000 * 1000000000
+    peer_a, peer_b = [10, 0, 0, 1], [10, 0, 0, 2]
+
+    bgp = TcpConversation(peer_b, 40000, peer_a, 179, base)
+    bgp.handshake()
+    bgp.send(0, bgp_open(23456, [2, 2, 2, 2], as4=4200000001) + bgp_message(4))
+    bgp.send(1, bgp_open(65001, [1, 1, 1, 1], as4=65001) + bgp_message(4))
+    attributes = (bgp_attribute(1, b'\x00') +
+                  bgp_attribute(2, bgp_as_path([(2, [4200000001, 3356, 15169])])) +
+                  bgp_attribute(3, bytes(peer_b)) +
+                  bgp_attribute(4, struct.pack('>I', 50), flags=0x80) +
+                  bgp_attribute(5, struct.pack('>I', 200)) +
+                  bgp_attribute(8, struct.pack('>HHHH', 65001, 100, 65001, 200), flags=0xC0) +
+                  bgp_attribute(32, struct.pack('>III', 4200000001, 1, 2), flags=0xC0))
+    nlri = (bgp_prefix([10, 1], 16) + bgp_prefix([10, 2, 0], 24) + bgp_prefix([192, 0, 2], 24))
+    bgp.send(0, bgp_update(attributes=attributes, nlri=nlri))
+
+    # A withdrawal split across segments, followed by an MP-BGP IPv6 announcement
+    withdraw = bgp_update(withdrawn=bgp_prefix([10, 2, 0], 24))
+    ipv6_next_hop = bytes.fromhex('20010db8000000000000000000000002') + bytes.fromhex('fe800000000000000000000000000002')
+    mp_reach = (struct.pack('>HBB', 2, 1, len(ipv6_next_hop)) + ipv6_next_hop + b'\x00' +
+                bgp_prefix(bytes.fromhex('20010db8'), 32) + bgp_prefix(bytes.fromhex('20010db80001'), 48))
+    ipv6_update = bgp_update(attributes=bgp_attribute(1, b'\x02') +
+                             bgp_attribute(2, bgp_as_path([(2, [4200000001, 64512]), (1, [1, 2])])) +
+                             bgp_attribute(14, mp_reach, flags=0x80))
+    bgp.send(0, withdraw[:10])
+    bgp.send(0, withdraw[10:] + ipv6_update)
+    mp_unreach = struct.pack('>HB', 2, 1) + bgp_prefix(bytes.fromhex('20010db80001'), 48)
+    bgp.send(0, bgp_update(attributes=bgp_attribute(15, mp_unreach, flags=0x80)))
+    bgp.send(0, bgp_update())
+    bgp.send(1, bgp_message(3, bytes([6, 2])))
+    bgp.close()
+    frames = bgp.frames
+
+    # Mid-session capture of a 2-octet AS session carrying AS4_PATH
+    legacy = TcpConversation([10, 0, 0, 4], 40001, [10, 0, 0, 3], 179, base + 1000000000)
+    legacy.send(1, bgp_update(attributes=bgp_attribute(1, b'\x00') +
+                              bgp_attribute(2, bgp_as_path([(2, [65010, 23456])], width=2)) +
+                              bgp_attribute(3, bytes([10, 0, 0, 3])) +
+                              bgp_attribute(17, bgp_as_path([(2, [4200000009])]), flags=0xC0),
+                              nlri=bgp_prefix([198, 51, 100], 24)))
+    frames += legacy.frames
+
+    # OSPFv2: hello, an update with router, summary and external LSAs, an ack
+    r1, r2, area = [1, 1, 1, 1], [2, 2, 2, 2], [0, 0, 0, 0]
+    all_spf = [224, 0, 0, 5]
+    hello = struct.pack('>4sHBBI4s4s', bytes([255, 255, 255, 0]), 10, 0x02, 1, 40,
+                        bytes([10, 0, 12, 1]), bytes([10, 0, 12, 2])) + bytes(r2)
+    router_links = (struct.pack('>4s4sBBH', bytes(r2), bytes([10, 0, 12, 1]), 1, 0, 10) +
+                    struct.pack('>4s4sBBH', bytes([10, 0, 12, 0]), bytes([255, 255, 255, 0]), 3, 0, 10))
+    lsas = [
+        ospf_lsa(2, 1, r1, r1, struct.pack('>BBH', 0, 0, 2) + router_links),
+        ospf_lsa(2, 3, [172, 16, 0, 0], r1, bytes([255, 255, 0, 0]) + struct.pack('>I', 20)),
+        ospf_lsa(2, 5, [0, 0, 0, 0], r1, bytes(4) + struct.pack('>I', 0x80000001) + bytes(8),
+                 sequence=0x80000005),
+    ]
+    update = struct.pack('>I', len(lsas)) + b''.join(lsas)
+    ospf_v2 = [
+        ospf_packet(2, 1, r1, area, hello),
+        ospf_packet(2, 4, r1, area, update),
+        ospf_packet(2, 5, r2, area, lsas[0][:20]),
+    ]
+    for i, packet in enumerate(ospf_v2):
+        frame = ethernet_frame(ipv4_packet(packet, 89, [10, 0, 12, 1 + (i == 2)], all_spf, ttl=1), 0x0800)
+        frames.append((base + 2000000000 + i * 1000000, frame))
+
+    # OSPFv3: hello and an update with intra- and inter-area prefix LSAs
+    ll_r1 = bytes.fromhex('fe800000000000000000000000000001')
+    all_spf6 = bytes.fromhex('ff020000000000000000000000000005')
+    hello6 = struct.pack('>IBBHHH4s4s', 5, 1, 0, 0x13, 10, 40, bytes(r1), bytes(4))
+    intra = struct.pack('>HH4s4s', 2, 0x2001, bytes(4), bytes(r1)) + \
+        ospf_v3_prefix(bytes.fromhex('20010db8001200000000000000000000'), 64, 10) + \
+        ospf_v3_prefix(bytes.fromhex('20010db800ff00000000000000000001'), 128, 0)
+    inter = struct.pack('>I', 30) + ospf_v3_prefix(bytes.fromhex('20010db80099'), 48)
+    lsas6 = [ospf_lsa(3, 0x2009, [0, 0, 0, 1], r1, intra), ospf_lsa(3, 0x2003, [0, 0, 0, 2], r1, inter)]
+    ospf_v3 = [
+        ospf_packet(3, 1, r1, area, hello6),
+        ospf_packet(3, 4, r1, area, struct.pack('>I', len(lsas6)) + b''.join(lsas6)),
+    ]
+    for i, packet in enumerate(ospf_v3):
+        frame = ethernet_frame(ipv6_packet(packet, 89, ll_r1, all_spf6, hop_limit=1), 0x86DD)
+        frames.append((base + 3000000000 + i * 1000000, frame))
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+    print(f"Created routing protocols PCAP: {filename}")
+
+def tls_record(content_type, body, version=0x0303):
+    return struct.pack('>BHH', content_type, version, len(body)) + body
+
+def tls_handshake(msg_type, body):
+    return bytes([msg_type]) + len(body).to_bytes(3, 'big') + body
+
+def tls_extension(ext_type, data):
+    return struct.pack('>HH', ext_type, len(data)) + data
+
+def tls_client_hello(client_random, server_name, tls13=False):
+    name = server_name.encode()
+    extensions = tls_extension(0, struct.pack('>HBH', len(name) + 3, 0, len(name)) + name)
+    if tls13:
+        extensions += tls_extension(43, b'\x04\x03\x04\x03\x03')
+    suites = struct.pack('>H6H', 12, 0x1301, 0x1302, 0x1303, 0xC02F, 0xCCA8, 0x009C)
+    body = struct.pack('>H', 0x0303) + client_random + b'\x00' + suites + b'\x01\x00'
+    return tls_handshake(1, body + struct.pack('>H', len(extensions)) + extensions)
+
+def tls_server_hello(server_random, cipher_suite, tls13=False):
+    extensions = tls_extension(43, b'\x03\x04') if tls13 else b''
+    body = struct.pack('>H', 0x0303) + server_random + b'\x00' + struct.pack('>HB', cipher_suite, 0)
+    return tls_handshake(2, body + struct.pack('>H', len(extensions)) + extensions)
+
+def tls12_prf(secret, label, seed, length, digest):
+    """P_hash of RFC 5246 section 5."""
+    seed = label + seed
+    out, a = b'', hmac.new(secret, seed, digest).digest()
+    while len(out) < length:
+        out += hmac.new(secret, a + seed, digest).digest()
+        a = hmac.new(secret, a, digest).digest()
+    return out[:length]
+
+def hkdf_expand_label(secret, label, length, digest):
+    """HKDF-Expand-Label of RFC 8446 section 7.1 with an empty context."""
+    full_label = b'tls13 ' + label
+    info = struct.pack('>HB', length, len(full_label)) + full_label + b'\x00'
+    out, block, counter = b'', b'', 1
+    while len(out) < length:
+        block = hmac.new(secret, block + info + bytes([counter]), digest).digest()
+        out += block
+        counter += 1
+    return out[:length]
+
+class TlsProtection:
+    """Record protection of one direction (AES-GCM or ChaCha20-Poly1305)."""
+
+    def __init__(self, cipher, key, iv, tls13):
+        from cryptography.hazmat.primitives.ciphers.aead import AESGCM, ChaCha20Poly1305
+        self.aead = ChaCha20Poly1305(key) if cipher == 'chacha20' else AESGCM(key)
+        self.explicit_nonce = not tls13 and cipher != 'chacha20'
+        self.iv, self.tls13, self.seq = iv, tls13, 0
+
+    def protect(self, content_type, plaintext, padding=0):
+        seq = self.seq
+        self.seq += 1
+        if self.explicit_nonce:
+            explicit = struct.pack('>Q', seq)
+            aad = struct.pack('>QBHH', seq, content_type, 0x0303, len(plaintext))
+            return tls_record(content_type, explicit + self.aead.encrypt(self.iv + explicit, plaintext, aad))
+        nonce = bytes(a ^ b for a, b in zip(self.iv, bytes(4) + struct.pack('>Q', seq)))
+        if not self.tls13:
+            aad = struct.pack('>QBHH', seq, content_type, 0x0303, len(plaintext))
+            return tls_record(content_type, self.aead.encrypt(nonce, plaintext, aad))
+        inner = plaintext + bytes([content_type]) + bytes(padding)
+        header = struct.pack('>BHH', 23, 0x0303, len(inner) + 16)
+        return header + self.aead.encrypt(nonce, inner, header)
+
+def tls12_keys(cipher, master, client_random, server_random):
+    key_len = 16 if cipher == 'aes128' else 32
+    iv_len = 12 if cipher == 'chacha20' else 4
+    block = tls12_prf(master, b'key expansion', server_random + client_random,
+                      2 * (key_len + iv_len), hashlib.sha256)
+    keys = block[:key_len], block[key_len:2 * key_len]
+    ivs = block[2 * key_len:2 * key_len + iv_len], block[2 * key_len + iv_len:]
+    return [TlsProtection(cipher, keys[i], ivs[i], False) for i in range(2)]
+
+def tls13_protection(cipher, secret, digest):
+    key_len = 16 if cipher == 'aes128' else 32
+    return TlsProtection(cipher, hkdf_expand_label(secret, b'key', key_len, digest),
+                         hkdf_expand_label(secret, b'iv', 12, digest), True)
+
+def generate_tls_pcap(filename):
+    """Generate TLS 1.2 and 1.3 connections plus the NSS key log that decrypts them."""
+    base = 1700000000 * 1000000000
+    rng = random.Random(81)
+    def secret(n):
+        return bytes(rng.getrandbits(8) for _ in range(n))
+    keylog = ['# SSL/TLS secrets log file, generated by generate_pcap.py']
+    frames = []
+    request = b'GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n\r\n'
+    response = b'HTTP/1.1 200 OK\r\nContent-Length: 2000\r\n\r\n' + b'x' * 2000
+
+    # TLS 1.2 with AES-128-GCM (explicit nonces) and with ChaCha20-Poly1305
+    for index, (cipher, suite, port, sni) in enumerate([('aes128', 0xC02F, 443, 'www.example.com'),
+                                                         ('chacha20', 0xCCA8, 4433, 'chacha.example.com')]):
+        conn = TcpConversation([10, 0, 0, 1], 50000 + index, [10, 0, 0, 2], port, base + index * 1000000000)
+        client_random, server_random, master = secret(32), secret(32), secret(48)
+        keylog.append(f'CLIENT_RANDOM {client_random.hex()} {master.hex()}')
+        conn.handshake()
+        conn.send(0, tls_record(22, tls_client_hello(client_random, sni), version=0x0301))
+        conn.send(1, tls_record(22, tls_server_hello(server_random, suite) + tls_handshake(11, bytes(3)) +
+                                tls_handshake(14, b'')))
+        client, server = tls12_keys(cipher, master, client_random, server_random)
+        conn.send(0, tls_record(22, tls_handshake(16, bytes(33))) + tls_record(20, b'\x01') +
+                  client.protect(22, tls_handshake(20, bytes(12))))
+        conn.send(1, tls_record(20, b'\x01') + server.protect(22, tls_handshake(20, bytes(12))))
+        conn.send(0, client.protect(23, request))
+        # A record spanning two segments
+        record = server.protect(23, response)
+        conn.send(1, record[:1000])
+        conn.send(1, record[1000:])
+        conn.send(0, client.protect(21, b'\x01\x00'))
+        conn.close()
+        frames += conn.frames
+
+    # TLS 1.3 with AES-256-GCM/SHA-384 on a non-standard port, with a KeyUpdate
+    conn = TcpConversation([10, 0, 0, 3], 51000, [10, 0, 0, 4], 8443, base + 2000000000)
+    client_random, server_random = secret(32), secret(32)
+    secrets = [secret(48) for _ in range(4)]
+    labels = ['CLIENT_HANDSHAKE_TRAFFIC_SECRET', 'SERVER_HANDSHAKE_TRAFFIC_SECRET',
+              'CLIENT_TRAFFIC_SECRET_0', 'SERVER_TRAFFIC_SECRET_0']
+    keylog += [f'{label} {client_random.hex()} {value.hex()}' for label, value in zip(labels, secrets)]
+    keylog.append(f'EXPORTER_SECRET {client_random.hex()} {secret(48).hex()}')
+    digest = hashlib.sha384
+    conn.handshake()
+    conn.send(0, tls_record(22, tls_client_hello(client_random, 'api.example.net', tls13=True), version=0x0301))
+    server_hs = tls13_protection('aes256', secrets[1], digest)
+    flight = (tls_handshake(8, b'\x00\x00') + tls_handshake(11, bytes(4)) + tls_handshake(15, bytes(4)) +
+              tls_handshake(20, bytes(48)))
+    conn.send(1, tls_record(22, tls_server_hello(server_random, 0x1302, tls13=True)) + tls_record(20, b'\x01') +
+              server_hs.protect(22, flight))
+    client_hs = tls13_protection('aes256', secrets[0], digest)
+    conn.send(0, tls_record(20, b'\x01') + client_hs.protect(22, tls_handshake(20, bytes(48))))
+    client_app = tls13_protection('aes256', secrets[2], digest)
+    server_app = tls13_protection('aes256', secrets[3], digest)
+    conn.send(1, server_app.protect(22, tls_handshake(4, bytes(16))))
+    conn.send(0, client_app.protect(23, b'GET /v1/status HTTP/1.1\r\nHost: api.example.net\r\n\r\n'))
+    conn.send(1, server_app.protect(23, b'HTTP/1.1 204 No Content\r\n\r\n', padding=32))
+    conn.send(0, client_app.protect(22, tls_handshake(24, b'\x00')))
+    updated = hkdf_expand_label(secrets[2], b'traffic upd', 48, digest)
+    conn.send(0, tls13_protection('aes256', updated, digest).protect(23, b'after key update'))
+    conn.close()
+    frames += conn.frames
+
+    # TLS 1.3 with ChaCha20-Poly1305 whose keys are not in the log
+    conn = TcpConversation([10, 0, 0, 5], 52000, [10, 0, 0, 6], 443, base + 3000000000)
+    conn.handshake()
+    conn.send(0, tls_record(22, tls_client_hello(secret(32), 'unknown.example.org', tls13=True)))
+    conn.send(1, tls_record(22, tls_server_hello(secret(32), 0x1303, tls13=True)) + tls_record(20, b'\x01') +
+              tls13_protection('chacha20', secret(32), hashlib.sha256).protect(22, tls_handshake(20, bytes(32))))
+    conn.send(0, tls13_protection('chacha20', secret(32), hashlib.sha256).protect(23, b'hidden'))
+    frames += conn.frames
+
+    # Plain HTTP is not framed as TLS
+    conn = TcpConversation([10, 0, 0, 7], 53000, [10, 0, 0, 8], 80, base + 4000000000)
+    conn.handshake()
+    conn.send(0, request)
+    conn.send(1, response[:200])
+    frames += conn.frames
+
+    keylog.append('CLIENT_RANDOM not-hex-at-all 00')
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+    keylog_path = Path(filename).with_suffix('.keylog')
+    keylog_path.write_text('\n'.join(keylog) + '\n')
+    print(f"Created TLS PCAP: {filename} (key log {keylog_path})")
+
+def generate_classify_pcap(filename):
+    """Generate flows whose application protocol must be recognized from payload, not ports."""
+    base = 1700000000 * 1000000000
+    rng = random.Random(82)
+    frames = []
+    client, server = [10, 0, 2, 1], [10, 0, 2, 2]
+
+    def tcp_flow(index, port, messages, close=True):
+        conn = TcpConversation(client, 41000 + index, server, port, base + index * 100000000)
+        conn.handshake()
+        for side, payload in messages:
+            conn.send(side, payload)
+        if close:
+            conn.close()
+        frames.extend(conn.frames)
+
+    def udp_flow(index, port, messages):
+        ts = base + index * 100000000
+        for side, payload in messages:
+            src, dst = (client, server) if side == 0 else (server, client)
+            sport, dport = (42000 + index, port) if side == 0 else (port, 42000 + index)
+            frames.append((ts, udp_frame(payload, src, dst, sport, dport)))
+            ts += 1000000
+
+    # HTTP and SSH on the TLS port, SMTP and FTP on unusual ports
+    tcp_flow(0, 443, [(0, b'GET / HTTP/1.1\r\nHost: example.com\r\n\r\n'),
+                      (1, b'HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n')])
+    tcp_flow(1, 443, [(1, b'SSH-2.0-OpenSSH_9.6\r\n'), (0, b'SSH-2.0-PuTTY_0.80\r\n')])
+    tcp_flow(2, 2525, [(1, b'220 mail.example.com ESMTP Postfix\r\n'), (0, b'EHLO client.example.com\r\n'),
+                       (1, b'250 mail.example.com\r\n')])
+    tcp_flow(3, 2121, [(1, b'220 ProFTPD Server (FTP) ready\r\n'), (0, b'USER anonymous\r\n')])
+    # MQTT CONNECT on a non-standard port
+    mqtt = b'\x00\x04MQTT\x04\x02\x00\x3c\x00\x06client'
+    tcp_flow(4, 8080, [(0, bytes([0x10, len(mqtt)]) + mqtt), (1, b'\x20\x02\x00\x00')])
+    # Random bytes: settled as unknown after the inspection budget, left open
+    tcp_flow(5, 9999, [(i % 2, bytes(rng.getrandbits(8) | 0x80 for _ in range(64))) for i in range(10)],
+             close=False)
+
+    # DNS on a non-53 port
+    query = struct.pack('>HHHHHH', 0x1234, 0x0100, 1, 0, 0, 0) + b'\x07example\x03com\x00' + struct.pack('>HH', 1, 1)
+    answer = struct.pack('>HHHHHH', 0x1234, 0x8180, 1, 1, 0, 0) + query[12:] + \
+        struct.pack('>HHHIH4s', 0xC00C, 1, 1, 300, 4, bytes([93, 184, 216, 34]))
+    udp_flow(6, 5353, [(0, query), (1, answer)])
+    # QUIC v1 Initial
+    initial = bytes([0xC3]) + struct.pack('>I', 1) + bytes([8]) + bytes(8) + bytes([0]) + bytes(1180)
+    udp_flow(7, 443, [(0, initial)])
+    # WireGuard handshake initiation and response
+    udp_flow(8, 51820, [(0, b'\x01\x00\x00\x00' + bytes(144)), (1, b'\x02\x00\x00\x00' + bytes(88))])
+    # STUN binding request on an arbitrary port
+    udp_flow(9, 19302, [(0, struct.pack('>HHI', 0x0001, 0, 0x2112A442) + bytes(12))])
+    # Syslog and SNMPv2c get-request
+    udp_flow(10, 1514, [(0, b'<34>Oct 11 22:14:15 host su: session opened')])
+    snmp = bytes.fromhex('302602010104067075626c6963a0190204000000010201000201003' +
+                         '00b300906052b06010201050500')
+    udp_flow(11, 1161, [(0, snmp)])
+    # ICMP echo request: no application protocol
+    icmp = struct.pack('>BBHHH', 8, 0, 0, 1, 1) + b'ping'
+    frames.append((base + 1200000000, ethernet_frame(ipv4_packet(icmp, 1, client, server), 0x0800)))
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+    print(f"Created classification PCAP: {filename}")
+
+def generate_alerts_pcap(filename):
+    """Generate traffic and a rules file exercising the pcap_alerts rule subset."""
+    base = 1700000000 * 1000000000
+    frames = []
+    server = [198, 51, 100, 10]
+
+    # HTTP on a non-standard port, with a relative match that needs backtracking
+    conn = TcpConversation([10, 0, 3, 1], 43000, server, 8080, base)
+    conn.handshake()
+    conn.send(0, b'GET /ADMIN/login?a=12345&a=1&b=1 HTTP/1.1\r\nHost: intranet\r\nUser-Agent: curl/8.5.0\r\n\r\n')
+    conn.send(1, b'HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n')
+    conn.close()
+    frames.extend(conn.frames)
+    # FTP picked up mid-stream: root login sets a flowbit, bob's does not
+    for index, user in enumerate([b'root', b'bob']):
+        conn = TcpConversation([10, 0, 3, 2 + index], 43001 + index, server, 21, base + (index + 1) * 100000000)
+        conn.send(0, b'USER ' + user + b'\r\n')
+        conn.send(1, b'331 Password required\r\n')
+        conn.send(0, b'PASS hunter2\r\n')
+        frames.extend(conn.frames)
+    # Bare SYN to telnet with ECN bits set
+    frames.append((base + 300000000, tcp_frame(b'', [10, 0, 3, 5], server, 43010, 23, 7000, 0, 0xC2)))
+    # DNS query, answer and a repeated query on the same flow
+    query = struct.pack('>HHHHHH', 0x4242, 0x0100, 1, 0, 0, 0) + b'\x07example\x03com\x00' + struct.pack('>HH', 1, 1)
+    answer = query[:2] + b'\x81\x80' + query[4:]
+    for offset, (src, dst, sport, dport, payload) in enumerate([
+            ([10, 0, 3, 6], [203, 0, 113, 5], 5000, 53, query),
+            ([203, 0, 113, 5], [10, 0, 3, 6], 53, 5000, answer),
+            ([10, 0, 3, 6], [203, 0, 113, 5], 5000, 53, query)]):
+        frames.append((base + 400000000 + offset * 1000000, udp_frame(payload, src, dst, sport, dport)))
+    # ICMP echo request carrying a marker
+    icmp = struct.pack('>BBHHH', 8, 0, 0, 7, 1) + b'ping-probe'
+    frames.append((base + 500000000, ethernet_frame(ipv4_packet(icmp, 1, [10, 0, 3, 7], server), 0x0800)))
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+
+    rules = [
+        '# Rules for pcap_alerts.test, generated by generate_pcap.py',
+        'alert http any any -> any any (msg:"HTTP admin path"; content:"/admin"; nocase; '
+        'classtype:web-application-attack; priority:1; sid:1000001; rev:3;)',
+        'alert tcp $HOME_NET any -> $EXTERNAL_NET any (msg:"curl user agent"; flow:to_server,established; '
+        'content:"User-Agent|3a 20|"; content:"curl/"; distance:0; within:5; sid:1000002;)',
+        'alert tcp any any -> any any (msg:"GET at start"; content:"GET"; depth:3; sid:1000003;)',
+        'alert tcp any any -> any any (msg:"GET at offset one"; content:"GET"; offset:1; depth:3; sid:1000004;)',
+        'alert tcp any any <> any any (msg:"403 response"; flow:to_client; content:"403"; offset:9; depth:3; \\',
+        '    sid:1000005;)',
+        'alert tcp any any -> any 21 (msg:"FTP root user"; content:"USER root"; flowbits:set,ftp.root; '
+        'flowbits:noalert; sid:1000006;)',
+        'alert tcp any any -> any 21 (msg:"FTP root password"; content:"PASS "; flowbits:isset,ftp.root; sid:1000007;)',
+        'alert tcp any any -> any 21 (msg:"FTP PASS command"; dsize:<20; pcre:"/^PASS\\s+\\S+\\r\\n$/"; sid:1000008;)',
+        'alert tcp any any -> any 21 (msg:"Query parameter pair"; content:"a="; content:"&b=1"; distance:0; within:6; '
+        'sid:1000009;)',
+        'alert tcp any any -> any 8080 (msg:"Query parameter pair"; content:"a="; content:"&b=1"; distance:0; '
+        'within:6; sid:1000010;)',
+        'alert tcp any any -> any 23 (msg:"SYN to telnet"; flags:S,12; sid:1000011;)',
+        'alert tcp any any -> 198.51.100.0/24 ![23,8080] (msg:"Client data without USER"; flow:to_server; '
+        'dsize:>0; content:!"USER"; sid:1000012;)',
+        'alert udp any any -> any 53 (msg:"example.com lookup"; content:"|07|example|03|com|00|"; sid:1000013;)',
+        'alert udp any any -> any 53 (msg:"First DNS query"; flow:to_server,not_established; sid:1000014;)',
+        'alert icmp any any -> any any (msg:"ICMP probe"; itype:8; icode:0; content:"probe"; sid:1000015;)',
+        '# Unsupported keyword: skipped unless strict',
+        'alert tcp any any -> any any (msg:"HTTP method"; http.method; content:"GET"; sid:1000016;)',
+    ]
+    rules_path = Path(filename).with_suffix('.rules')
+    rules_path.write_text('\n'.join(rules) + '\n')
+    print(f"Created alerts PCAP: {filename} (rules {rules_path})")
+
+def generate_yara_pcap(filename):
+    """Generate streams and a rules file exercising the pcap_yara rule subset."""
+    base = 1700000000 * 1000000000
+    frames = []
+    server = [198, 51, 100, 20]
+
+    # HTTP download whose marker string is split across two segments
+    conn = TcpConversation([10, 0, 4, 1], 44000, server, 80, base)
+    conn.handshake()
+    conn.send(0, b'GET /DL/payload.bin HTTP/1.1\r\nHost: downloads\r\n\r\n')
+    conn.send(1, b'HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: 64\r\n\r\n'
+                 b'header bytes then EVIL_MAR')
+    conn.send(1, b'KER_2024 and trailing data')
+    conn.close()
+    frames.extend(conn.frames)
+    # Raw PE image on a second connection
+    conn = TcpConversation([10, 0, 4, 2], 44001, server, 9000, base + 100000000)
+    conn.handshake()
+    conn.send(1, b'MZ\x90\x00' + bytes(28) + b'PE\x00\x00' + bytes(6) + b'\x4c\x01' + bytes(8))
+    conn.close()
+    frames.extend(conn.frames)
+    # Beacons, and a segment lost before the token
+    conn = TcpConversation([10, 0, 4, 3], 44002, server, 4444, base + 200000000)
+    conn.handshake()
+    conn.send(0, b'beacon beacon xyz beacons beacon')
+    conn.send(1, b'0123456789')
+    conn.seq[1] += 10
+    conn.send(1, b'secret_token')
+    conn.send(0, flags=0x04)
+    frames.extend(conn.frames)
+    # UDP datagrams: UTF-16 text and a byte sequence with alternatives
+    wide = 'user=admin password=x'.encode('utf-16-le')
+    frames.append((base + 300000000, udp_frame(wide, [10, 0, 4, 4], server, 5000, 9999)))
+    frames.append((base + 300100000, udp_frame(b'\x01\xc0\xff\xee\x02\x7f', [10, 0, 4, 4], server, 5000, 9999)))
+    frames.append((base + 300200000, udp_frame(b'\xc0\xff\xee\x03\x7f', [10, 0, 4, 4], server, 5000, 9999)))
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+
+    rules = '''// Rules for pcap_yara.test, generated by generate_pcap.py
+rule spanning_marker : malware network {
+    meta:
+        author = "test"
+        score = 5
+    strings:
+        $m = "EVIL_MARKER_2024"
+    condition:
+        $m
+}
+
+rule pe_image : file {
+    strings:
+        $mz = { 4D 5A ?? 00 }
+        $pe = { 50 45 00 00 [4-16] 4C 01 }
+    condition:
+        uint16(0) == 0x5A4D and $mz at 0 and $pe
+}
+
+rule http_get {
+    strings:
+        $get = "get /dl" nocase
+        $host = /Host: [a-z]+/
+    condition:
+        all of them
+}
+
+rule wide_or_magic {
+    strings:
+        $p = "password" wide ascii
+        $magic = { C0 FF EE ( 01 | 02 ) ~00 }
+    condition:
+        any of them
+}
+
+/* Three whole-word beacons and a private helper string */
+rule repeated_beacon {
+    strings:
+        $b = "beacon" fullword
+        $x = "xyz" private
+    condition:
+        #b > 2 and $x
+}
+
+private rule hidden {
+    strings:
+        $s = "secret_token"
+    condition:
+        $s
+}
+
+rule token_after_gap {
+    strings:
+        $s = "secret_token"
+    condition:
+        $s in (15..40) and not $s at 10
+}
+
+rule never_matches {
+    strings:
+        $n = "not present anywhere"
+    condition:
+        $n or filesize > 1MB
+}
+
+rule long_http_response {
+    condition:
+        filesize > 100 and uint8(0) == 0x48 and uint32be(0) == 0x48545450
+}
+'''
+    rules_path = Path(filename).with_suffix('.yar')
+    rules_path.write_text(rules)
+    print(f"Created YARA PCAP: {filename} (rules {rules_path})")
+
+def generate_beacons_pcap(filename):
+    """Generate periodic and irregular traffic for pcap_beacons."""
+    base = 1700000000 * 1000000000
+    second = 1000000000
+    rng = random.Random(87)
+    frames = []
+
+    # HTTPS beacon every 60 s with up to 2 s of jitter; one beacon is missed
+    for i in range(40):
+        if i == 25:
+            continue
+        start = base + i * 60 * second + rng.randint(-2000, 2000) * 1000000
+        conn = TcpConversation([10, 0, 5, 1], 40000 + i, [203, 0, 113, 50], 443, start)
+        conn.handshake()
+        conn.send(0, b'\x17\x03\x03\x00\x20' + bytes(32))
+        conn.send(1, b'\x17\x03\x03\x00\x10' + bytes(16))
+        conn.close()
+        frames.extend(conn.frames)
+    # DNS beacon every 300 s exactly, query and answer
+    for i in range(12):
+        ts = base + 5 * second + i * 300 * second
+        frames.append((ts, udp_frame(b'\x12\x34\x01\x00' + bytes(8), [10, 0, 5, 2], [203, 0, 113, 53], 53000 + i, 53)))
+        frames.append((ts + 20000000, udp_frame(b'\x12\x34\x81\x80' + bytes(8), [203, 0, 113, 53], [10, 0, 5, 2], 53, 53000 + i)))
+    # Browsing at irregular times
+    ts = base
+    for i in range(30):
+        ts += int(rng.expovariate(1 / 90) * second) + 2 * second
+        conn = TcpConversation([10, 0, 5, 3], 41000 + i, [198, 51, 100, 80], 80, ts)
+        conn.handshake()
+        conn.send(0, b'GET / HTTP/1.1\r\n\r\n')
+        conn.close()
+        frames.extend(conn.frames)
+    # A media stream: packets every 20 ms make a single event
+    for i in range(250):
+        frames.append((base + 10 * second + i * 20000000,
+                       udp_frame(bytes(160), [10, 0, 5, 4], [198, 51, 100, 7], 30000, 5004)))
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+
+def generate_scans_pcap(filename):
+    """Generate a port scan, a host sweep, a SYN flood and ordinary traffic for pcap_scans."""
+    base = 1700000000 * 1000000000
+    ms = 1000000
+    rng = random.Random(88)
+    frames = []
+    victim = [192, 0, 2, 80]
+
+    # Vertical scan: SYNs to 300 ports of one host over 30 s, answered by RSTs
+    for port in range(1, 301):
+        ts = base + port * 100 * ms
+        frames.append((ts, tcp_frame(b'', [10, 0, 6, 66], [192, 0, 2, 10], 45000, port, 7000, 0, 0x02)))
+        frames.append((ts + ms, tcp_frame(b'', [192, 0, 2, 10], [10, 0, 6, 66], port, 45000, 0, 7001, 0x14)))
+    # Horizontal sweep: ICMP echo to 200 hosts, then SNMP to the same hosts
+    for host in range(1, 201):
+        ts = base + 40000 * ms + host * 50 * ms
+        icmp = struct.pack('>BBHHH', 8, 0, 0, 9, host) + b'sweep'
+        frames.append((ts, ethernet_frame(ipv4_packet(icmp, 1, [10, 0, 6, 77], [192, 0, 2, host]), 0x0800)))
+        frames.append((ts + 10 * ms, udp_frame(b'\x30\x26', [10, 0, 6, 77], [192, 0, 2, host], 50161, 161)))
+    # SYN flood from spoofed sources: 1500 SYNs in 3 s
+    for i in range(1500):
+        source = [rng.randint(1, 223), rng.randint(0, 255), rng.randint(0, 255), rng.randint(1, 254)]
+        frames.append((base + 60000 * ms + i * 2 * ms,
+                       tcp_frame(b'', source, victim, rng.randint(1024, 65535), 80, rng.getrandbits(32), 0, 0x02)))
+    # A client using a handful of servers stays below the thresholds
+    for i in range(40):
+        conn = TcpConversation([10, 0, 6, 5], 46000 + i, [198, 51, 100, 10 + i % 5], 443 if i % 2 else 80,
+                               base + i * 1500 * ms)
+        conn.handshake()
+        conn.send(0, b'hello')
+        conn.close()
+        frames.extend(conn.frames)
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+
+def generate_loss_pcap(filename):
+    """Generate TCP connections with segments missing from the capture."""
+    base = 1700000000 * 1000000000
+    second = 1000000000
+    frames = []
+
+    # Complete download: nothing lost
+    conn = TcpConversation([10, 0, 9, 1], 40001, [198, 51, 100, 1], 80, base + 10 * second)
+    conn.handshake()
+    conn.send(0, b'G' * 100)
+    for i in range(10):
+        conn.send(1, b'D' * 1000)
+        conn.send(0, flags=0x10)
+    conn.close()
+    frames.extend(conn.frames)
+
+    # Two minutes later: the tap drops two of the server's segments, which
+    # the client still acknowledges
+    conn = TcpConversation([10, 0, 9, 2], 40002, [198, 51, 100, 2], 80, base + 130 * second)
+    conn.handshake()
+    conn.send(0, b'G' * 100)
+    for i in range(10):
+        conn.send(1, b'D' * 1000)
+        if i in (3, 7):
+            conn.frames.pop()
+        conn.send(0, flags=0x10)
+    conn.close()
+    frames.extend(conn.frames)
+
+    # Picked up mid-stream, with one retransmission
+    conn = TcpConversation([10, 0, 9, 3], 40003, [198, 51, 100, 3], 443, base + 140 * second)
+    for i in range(5):
+        conn.send(1, b'T' * 500)
+        conn.send(0, flags=0x10)
+    conn.send(1, b'T' * 500, seq=conn.seq[1] - 500)
+    frames.extend(conn.frames)
+
+    # Refused connection: no data acknowledged, so no flow row
+    conn = TcpConversation([10, 0, 9, 4], 40004, [198, 51, 100, 4], 22, base + 150 * second)
+    conn.send(0, flags=0x02)
+    conn.send(1, flags=0x14)
+    frames.extend(conn.frames)
+
+    write_timed_pcap(filename, sorted(frames, key=lambda f: f[0]))
+
+def pcapng_block(block_type, body, endian='<'):
+    """pcapng block: type, total length, body padded to 4 bytes, length."""
+    body += b'\x00' * (-len(body) % 4)
+    total = len(body) + 12
+    return struct.pack(endian + 'II', block_type, total) + body + struct.pack(endian + 'I', total)
+
+def pcapng_options(options, endian='<'):
+    """Encode (code, value) options followed by opt_endofopt."""
+    out = b''
+    for code, value in options:
+        out += struct.pack(endian + 'HH', code, len(value)) + value + b'\x00' * (-len(value) % 4)
+    return out + struct.pack(endian + 'HH', 0, 0)
+
+def pcapng_section(endian='<'):
+    return pcapng_block(0x0A0D0D0A, struct.pack(endian + 'IHHq', 0x1A2B3C4D, 1, 0, -1), endian)
+
+def pcapng_interface(link_type, name, tsresol=None, endian='<'):
+    options = [(2, name.encode())]
+    if tsresol is not None:
+        options.append((9, bytes([tsresol])))
+    return pcapng_block(1, struct.pack(endian + 'HHI', link_type, 0, 65535) + pcapng_options(options, endian), endian)
+
+def pcapng_packet(interface, units, frame, flags=None, drops=None, endian='<'):
+    options = []
+    if flags is not None:
+        options.append((2, struct.pack(endian + 'I', flags)))
+    if drops is not None:
+        options.append((4, struct.pack(endian + 'Q', drops)))
+    body = struct.pack(endian + 'IIIII', interface, units >> 32, units & 0xFFFFFFFF, len(frame), len(frame))
+    body += frame + b'\x00' * (-len(frame) % 4)
+    return pcapng_block(6, body + (pcapng_options(options, endian) if options else b''), endian)
+
+def pcapng_statistics(interface, units, counters, endian='<'):
+    """ISB with isb_starttime/endtime (units) and 64-bit counters by option code."""
+    options = []
+    for code, value in counters:
+        if code in (2, 3):
+            options.append((code, struct.pack(endian + 'II', value >> 32, value & 0xFFFFFFFF)))
+        else:
+            options.append((code, struct.pack(endian + 'Q', value)))
+    body = struct.pack(endian + 'III', interface, units >> 32, units & 0xFFFFFFFF)
+    return pcapng_block(5, body + pcapng_options(options, endian), endian)
+
+def generate_pcapng(filename):
+    """Generate a two-section pcapng capture with flags, drops and statistics."""
+    base = 1700000000 * 1000000000
+    second = 1000000000
+    blocks = [pcapng_section(),
+              pcapng_interface(1, 'eth0'),               # microseconds
+              pcapng_interface(1, 'eth1', tsresol=9)]    # nanoseconds
+
+    # A clean connection on eth0 and a lossy one on eth1
+    clean = TcpConversation([10, 0, 9, 1], 40001, [198, 51, 100, 1], 80, base + 10 * second)
+    clean.handshake()
+    clean.send(0, b'G' * 100)
+    clean.send(1, b'D' * 1000)
+    clean.send(0, flags=0x10)
+    lossy = TcpConversation([10, 0, 9, 2], 40002, [198, 51, 100, 2], 80, base + 20 * second + 123)
+    lossy.handshake()
+    lossy.send(1, b'D' * 1000)
+    lossy.send(1, b'D' * 1000)
+    lossy.frames.pop()
+    lossy.send(0, flags=0x10)
+
+    for i, (ts, frame) in enumerate(clean.frames):
+        flags = 1 if frame[26:30] == bytes([10, 0, 9, 1]) else 2
+        blocks.append(pcapng_packet(0, ts // 1000, frame, flags=flags, drops=i % 2))
+    for ts, frame in lossy.frames:
+        blocks.append(pcapng_packet(1, ts, frame))
+    # A frame with a CRC error and unknown direction, then SPB and obsolete PB
+    blocks.append(pcapng_packet(0, (base + 30 * second) // 1000, b'\xff' * 20, flags=0x01000000))
+    blocks.append(pcapng_block(3, struct.pack('<I', 16) + b'\xaa' * 16))
+    blocks.append(pcapng_block(2, struct.pack('<HHIIII', 1, 7, (base + 31 * second) >> 32,
+                                              (base + 31 * second) & 0xFFFFFFFF, 8, 8) + b'\xbb' * 8))
+    blocks.append(pcapng_statistics(0, (base + 40 * second) // 1000,
+                                    [(2, (base + 5 * second) // 1000), (3, (base + 40 * second) // 1000),
+                                     (4, 120), (5, 3), (7, 2), (8, 115)]))
+    blocks.append(pcapng_statistics(1, base + 40 * second, [(4, 50), (5, 0)]))
+
+    # Big-endian second section: interface ids restart at 0
+    blocks.append(pcapng_section('>'))
+    blocks.append(pcapng_interface(101, 'tun0', endian='>'))
+    packet = ipv4_packet(b'\x00' * 8, 17, [192, 0, 2, 1], [192, 0, 2, 2])
+    blocks.append(pcapng_packet(0, (base + 50 * second) // 1000, packet, flags=2, endian='>'))
+    blocks.append(pcapng_statistics(0, (base + 60 * second) // 1000, [(4, 1), (5, 1000000)], endian='>'))
+
+    with open(filename, 'wb') as f:
+        f.write(b''.join(blocks))
+
+def format_conversation():
+    """The clean TCP exchange used by the alternative capture format tests."""
+    base = 1700000000 * 1000000000
+    conv = TcpConversation([10, 0, 8, 1], 40100, [198, 51, 100, 8], 80, base + 70 * 1000000000 + 123)
+    conv.handshake()
+    conv.send(0, b'G' * 100)
+    conv.send(1, b'D' * 1000)
+    conv.close()
+    return conv.frames
+
+def erf_record(ts_ns, erf_type, flags, payload, wire_len, loss=0, extensions=()):
+    """Build an ERF record: fixed-point timestamp, header, extensions, payload padded to 8 bytes."""
+    fraction = ((ts_ns % 1000000000) << 32) // 1000000000
+    timestamp = ((ts_ns // 1000000000) << 32) | fraction
+    body = b''
+    for i, extension in enumerate(extensions):
+        more = 0x80 if i + 1 < len(extensions) else 0
+        body += bytes([extension[0] | more]) + extension[1:8]
+    body += payload
+    body += b'\x00' * (-(16 + len(body)) % 8)
+    if extensions:
+        erf_type |= 0x80
+    return struct.pack('<Q', timestamp) + struct.pack('>BBHHH', erf_type, flags, 16 + len(body),
+                                                       loss, wire_len) + body
+
+def generate_erf(filename):
+    """Generate an ERF capture: Ethernet records on two ports, raw IPv4 and skipped types."""
+    frames = format_conversation()
+    records = []
+    for i, (ts, frame) in enumerate(frames):
+        port = 0 if frame[26:30] == bytes([10, 0, 8, 1]) else 1
+        flags = port | (0x10 if i == 4 else 0)
+        extensions = [b'\x01' + b'\x00' * 7, b'\x02' + b'\x00' * 7] if i == 3 else ()
+        # Ethernet records carry two bytes of offset/pad ahead of the frame
+        records.append(erf_record(ts, 2, flags, b'\x00\x00' + frame, len(frame),
+                                  loss=3 if i == 2 else 0, extensions=extensions))
+        if i == 1:
+            # Padding record, which holds no packet
+            records.append(erf_record(ts, 48, 0, b'\x00' * 24, 0))
+    packet = ipv4_packet(b'\x00' * 8, 17, [192, 0, 2, 1], [192, 0, 2, 2])
+    records.append(erf_record(frames[-1][0] + 1000000, 22, 0, packet, len(packet)))
+    with open(filename, 'wb') as f:
+        f.write(b''.join(records))
+
+def generate_snoop(filename):
+    """Generate a Solaris snoop capture (big-endian, microseconds, cumulative drops)."""
+    frames = format_conversation()
+    drops = [0, 0, 2, 2, 5, 5, 5, 5, 5]
+    out = b'snoop\x00\x00\x00' + struct.pack('>II', 2, 4)
+    for i, (ts, frame) in enumerate(frames):
+        padded = frame + b'\x00' * (-len(frame) % 4)
+        out += struct.pack('>IIIIII', len(frame), len(frame), 24 + len(padded), drops[i],
+                           ts // 1000000000, ts % 1000000000 // 1000) + padded
+    with open(filename, 'wb') as f:
+        f.write(out)
+
+def generate_modified_pcap(filename):
+    """Generate a modified (Kuznetzov) pcap capture with interface index and packet type."""
+    frames = format_conversation()
+    out = struct.pack('<IHHiIII', 0xa1b2cd34, 2, 4, 0, 0, 65535, 1)
+    for ts, frame in frames:
+        outgoing = frame[26:30] == bytes([10, 0, 8, 1])
+        out += struct.pack('<IIII', ts // 1000000000, ts % 1000000000 // 1000, len(frame), len(frame))
+        out += struct.pack('<IHBB', 2 if outgoing else 3, 0x0800, 4 if outgoing else 0, 0) + frame
+    with open(filename, 'wb') as f:
+        f.write(out)
+
+def generate_gzip_pcap(filename):
+    """Generate a gzip-compressed pcap spanning several index regions: one
+    large compressed member followed by a small stored (level 0) one."""
+    members = []
+    for first, count, size, level in ((0, 10000, 1000, 9), (10000, 200, 40, 0)):
+        out = io.BytesIO()
+        if first == 0:
+            write_pcap_header(out)
+        for i in range(first, first + count):
+            payload = bytes((j * 7 + i % 13) & 0xff for j in range(size))
+            frame = udp_frame(payload, [10, 0, 0, 1], [10, 0, 0, 2], 40000 + i % 100, 9000)
+            write_packet(out, frame, 1700000000 + i // 1000, i % 1000 * 1000)
+        members.append(gzip.compress(out.getvalue(), compresslevel=level, mtime=0))
+    with open(filename, 'wb') as f:
+        f.write(b''.join(members))
+
+def generate_zstd_pcap(filename):
+    """Generate a zstd-compressed pcap with the reference zstd tool: a
+    streamed level 19 frame, a skippable frame, and a level 1 frame without
+    checksum. Requires the zstd command on PATH."""
+    out = io.BytesIO()
+    write_pcap_header(out)
+    for i in range(3000):
+        payload = bytes((j * (i % 7 + 1) + i) & 0xff for j in range(60 + i * 37 % 1400))
+        frame = udp_frame(payload, [10, 0, 0, 1 + i % 5], [10, 0, 0, 9], 40000 + i % 100, 9000)
+        write_packet(out, frame, 1700000000 + i // 100, i % 100 * 10000)
+    data = out.getvalue()
+    half = len(data) // 2
+    first = subprocess.run(['zstd', '-19', '-c'], input=data[:half], stdout=subprocess.PIPE, check=True).stdout
+    second = subprocess.run(['zstd', '-1', '--no-check', '-c'], input=data[half:], stdout=subprocess.PIPE,
+                            check=True).stdout
+    skippable = struct.pack('<II', 0x184D2A53, 8) + b'pcaptest'
+    with open(filename, 'wb') as f:
+        f.write(first + skippable + second)
+
+def generate_archives(base):
+    """Generate the same captures bundled as <base>.tar, <base>.tgz and
+    <base>.zip: pcaps in subdirectories (one nanosecond, one gzip-compressed,
+    one under a path too long for a plain tar header) and a text file."""
+    def capture(first, count, precision='micro'):
+        out = io.BytesIO()
+        write_pcap_header(out, precision=precision)
+        for i in range(first, first + count):
+            payload = bytes((j + i) & 0xff for j in range(20 + i % 50))
+            frame = udp_frame(payload, [10, 0, 1, 1], [10, 0, 1, 2], 50000 + i % 10, 53)
+            subsec = i % 100 * (10000 if precision == 'micro' else 10000000)
+            write_packet(out, frame, 1700000000 + i // 100, subsec, precision=precision)
+        return out.getvalue()
+
+    long_dir = 'day2/' + 'x' * 120
+    members = [
+        ('day1/a.pcap', capture(0, 100)),
+        ('day1/b.pcap.gz', gzip.compress(capture(100, 50), mtime=0)),
+        ('day2/c.pcap', capture(150, 30, precision='nano')),
+        (long_dir + '/d.pcap', capture(180, 20)),
+        ('notes.txt', b'Evidence bundle for case 42\n'),
+    ]
+    with tarfile.open(base + '.tar', 'w', format=tarfile.PAX_FORMAT) as tar:
+        for name, data in members:
+            info = tarfile.TarInfo('./' + name)
+            info.size = len(data)
+            info.mtime = 1700000000
+            tar.addfile(info, io.BytesIO(data))
+    with open(base + '.tar', 'rb') as f:
+        tar_data = f.read()
+    with open(base + '.tgz', 'wb') as f:
+        f.write(gzip.compress(tar_data, mtime=0))
+    with zipfile.ZipFile(base + '.zip', 'w') as archive:
+        for name, data in members:
+            info = zipfile.ZipInfo(name, date_time=(2023, 11, 14, 22, 13, 20))
+            info.compress_type = zipfile.ZIP_STORED if name.endswith('.gz') else zipfile.ZIP_DEFLATED
+            archive.writestr(info, data)
+
 def generate_large_pcap(filename, num_packets=10000, min_size=64, max_size=1500):
     """Generate a large PCAP file with random packets."""
     with open(filename, 'wb') as f:
@@ -125,7 +1398,7 @@ def generate_custom_pcap(filename, packets, precision='micro'):
 def main():
     parser = argparse.ArgumentParser(description='Generate PCAP files for testing')
     parser.add_argument('output', help='Output PCAP filename')
-    parser.add_argument('--type', choices=['simple', 'large', 'custom'], 
+    parser.add_argument('--type', choices=['simple', 'large', 'custom', 'timing', 'addresses', 'ssh', 'industrial', 'routing', 'tls', 'classify', 'alerts', 'yara', 'beacons', 'scans', 'loss', 'pcapng', 'erf', 'snoop', 'modified', 'gzip', 'zstd', 'archives'], 
                        default='simple', help='Type of PCAP to generate')
     parser.add_argument('--precision', choices=['micro', 'nano'], 
                        default='micro', help='Timestamp precision')
@@ -153,6 +1426,44 @@ def main():
                           num_packets=args.packets,
                           min_size=args.min_size,
                           max_size=args.max_size)
+    elif args.type == 'timing':
+        generate_timing_pcap(args.output)
+    elif args.type == 'addresses':
+        generate_addresses_pcap(args.output)
+    elif args.type == 'ssh':
+        generate_ssh_pcap(args.output)
+    elif args.type == 'industrial':
+        generate_industrial_pcap(args.output)
+    elif args.type == 'routing':
+        generate_routing_pcap(args.output)
+    elif args.type == 'tls':
+        generate_tls_pcap(args.output)
+    elif args.type == 'classify':
+        generate_classify_pcap(args.output)
+    elif args.type == 'alerts':
+        generate_alerts_pcap(args.output)
+    elif args.type == 'yara':
+        generate_yara_pcap(args.output)
+    elif args.type == 'beacons':
+        generate_beacons_pcap(args.output)
+    elif args.type == 'scans':
+        generate_scans_pcap(args.output)
+    elif args.type == 'loss':
+        generate_loss_pcap(args.output)
+    elif args.type == 'pcapng':
+        generate_pcapng(args.output)
+    elif args.type == 'erf':
+        generate_erf(args.output)
+    elif args.type == 'snoop':
+        generate_snoop(args.output)
+    elif args.type == 'modified':
+        generate_modified_pcap(args.output)
+    elif args.type == 'gzip':
+        generate_gzip_pcap(args.output)
+    elif args.type == 'zstd':
+        generate_zstd_pcap(args.output)
+    elif args.type == 'archives':
+        generate_archives(args.output)
     elif args.type == 'custom':
         if not args.data:
             print("Error: --data required for custom type", file=sys.stderr)
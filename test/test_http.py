@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""Test reading captures over HTTP and from an S3-compatible endpoint.
+
+Starts a local stand-in server that answers range requests, optionally
+ignores them or answers them in parts, and checks AWS signature version 4 on bucket paths, then reads
+the test captures through it and compares them with the local files.
+"""
+
+import hashlib
+import hmac
+import os
+import re
+import shutil
+import struct
+import sys
+import tempfile
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import unquote
+
+DATA_DIR = "test/data"
+ACCESS_KEY = "AKIDEXAMPLE"
+SECRET_KEY = "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY"
+REGION = "eu-west-1"
+SHORT_RANGE = 50000
+
+
+class StandIn(BaseHTTPRequestHandler):
+    """Serves /data/<file>, /norange/<file> (ignoring Range), /short/<file>
+    (sending at most SHORT_RANGE bytes of each range) and S3-style
+    /bucket/<file> (requiring a valid signature) from the roots in
+    server.roots."""
+
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        pass
+
+    def file_path(self):
+        prefix, _, name = self.path.lstrip("/").partition("/")
+        name = unquote(name)
+        for root in self.server.roots:
+            candidate = os.path.join(root, name)
+            if name and ".." not in name and os.path.isfile(candidate):
+                return prefix, candidate
+        return prefix, None
+
+    def signature_valid(self):
+        auth = self.headers.get("Authorization", "")
+        match = re.match(r"AWS4-HMAC-SHA256 Credential=([^/]+)/(\d{8})/([^/]+)/s3/aws4_request, "
+                         r"SignedHeaders=([^,]+), Signature=([0-9a-f]{64})$", auth)
+        if not match or match.group(1) != ACCESS_KEY or match.group(3) != REGION:
+            return False
+        day, signed = match.group(2), match.group(4).split(";")
+        canonical_headers = "".join(f"{name}:{self.headers.get(name, '').strip()}\n" for name in signed)
+        canonical = "\n".join(["GET", self.path, "", canonical_headers, ";".join(signed),
+                               self.headers.get("x-amz-content-sha256", "")])
+        scope = f"{day}/{REGION}/s3/aws4_request"
+        to_sign = "\n".join(["AWS4-HMAC-SHA256", self.headers.get("x-amz-date", ""), scope,
+                             hashlib.sha256(canonical.encode()).hexdigest()])
+        key = ("AWS4" + SECRET_KEY).encode()
+        for part in (day, REGION, "s3", "aws4_request"):
+            key = hmac.new(key, part.encode(), hashlib.sha256).digest()
+        expected = hmac.new(key, to_sign.encode(), hashlib.sha256).hexdigest()
+        return hmac.compare_digest(expected, match.group(5))
+
+    def send_empty(self, status):
+        self.send_response(status)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def do_GET(self):
+        prefix, path = self.file_path()
+        if prefix == "bucket" and not self.signature_valid():
+            return self.send_empty(403)
+        if path is None:
+            return self.send_empty(404)
+        with open(path, "rb") as f:
+            data = f.read()
+        requested = re.match(r"bytes=(\d+)-(\d+)$", self.headers.get("Range", ""))
+        with self.server.lock:
+            self.server.active += 1
+            self.server.max_active = max(self.server.max_active, self.server.active)
+            self.server.requests.append((os.path.basename(path), self.headers.get("Range")))
+        try:
+            if prefix == "norange" or not requested:
+                self.send_response(200)
+                self.send_header("Content-Length", str(len(data)))
+                self.end_headers()
+                self.wfile.write(data)
+                return
+            first, last = int(requested.group(1)), int(requested.group(2))
+            if first >= len(data):
+                self.send_response(416)
+                self.send_header("Content-Range", f"bytes */{len(data)}")
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            last = min(last, len(data) - 1)
+            if prefix == "short":
+                last = min(last, first + SHORT_RANGE - 1)
+            self.send_response(206)
+            self.send_header("Content-Range", f"bytes {first}-{last}/{len(data)}")
+            self.send_header("Content-Length", str(last - first + 1))
+            self.end_headers()
+            self.wfile.write(data[first:last + 1])
+        finally:
+            with self.server.lock:
+                self.server.active -= 1
+
+
+def start_server(roots):
+    server = ThreadingHTTPServer(("127.0.0.1", 0), StandIn)
+    server.daemon_threads = True
+    server.roots = roots
+    server.lock = threading.Lock()
+    server.requests = []
+    server.active = 0
+    server.max_active = 0
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def write_big_pcap(path, packets=40000, size=600):
+    """A capture spanning several HTTP chunks"""
+    with open(path, "wb") as f:
+        f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i in range(packets):
+            f.write(struct.pack("<IIII", 1700000000 + i // 1000, (i % 1000) * 1000, size, size))
+            f.write(bytes([i & 0xFF]) * size)
+
+
+def check(name, actual, expected):
+    if actual != expected:
+        print(f"  FAILED: {name}: expected {expected}, got {actual}")
+        return False
+    print(f"  SUCCESS: {name}")
+    return True
+
+
+def test_http(extension_path):
+    import duckdb
+
+    scratch = tempfile.mkdtemp()
+    server = start_server([DATA_DIR, scratch])
+    base = f"http://127.0.0.1:{server.server_address[1]}"
+    os.environ["AWS_ENDPOINT_URL"] = base
+    os.environ["AWS_ACCESS_KEY_ID"] = ACCESS_KEY
+    os.environ["AWS_SECRET_ACCESS_KEY"] = SECRET_KEY
+    os.environ["AWS_REGION"] = REGION
+    os.environ.pop("AWS_ENDPOINT_URL_S3", None)
+    os.environ.pop("AWS_SESSION_TOKEN", None)
+
+    conn = duckdb.connect(config={"allow_unsigned_extensions": True})
+    conn.execute(f"LOAD '{extension_path}'")
+    summary = "SELECT count(*), sum(capture_len), sum(hash(data)) FROM read_pcap('{}')"
+    ok = True
+    try:
+        write_big_pcap(f"{scratch}/big.pcap")
+        conn.execute(f"SELECT pcap_write_zstd('{scratch}/large.pcap.zst', timestamp_ns, data) "
+                     f"FROM read_pcap('{DATA_DIR}/test_large.pcap')").fetchall()
+
+        print("Test 1: Captures over HTTP match the local files...")
+        for name in ["test.pcap", "test.pcapng", "test.pcap.gz", "test.pcap.zst", "test_large.pcap"]:
+            local = conn.execute(summary.format(f"{DATA_DIR}/{name}")).fetchone()
+            ok &= check(name, conn.execute(summary.format(f"{base}/data/{name}")).fetchone(), local)
+
+        print("Test 2: A scan requests chunks ahead, in parallel...")
+        del server.requests[:]
+        server.max_active = 0
+        local = conn.execute(summary.format(f"{scratch}/big.pcap")).fetchone()
+        ok &= check("big.pcap", conn.execute(summary.format(f"{base}/data/big.pcap")).fetchone(), local)
+        ranges = [r for f, r in server.requests if f == "big.pcap"]
+        ok &= check("range requests", all(ranges) and len(ranges) >= 6, True)
+        ok &= check("parallel requests", server.max_active > 1, True)
+        local = conn.execute(summary.format(f"{scratch}/large.pcap.zst")).fetchone()
+        ok &= check("seekable zstd", conn.execute(summary.format(f"{base}/data/large.pcap.zst")).fetchone(), local)
+
+        print("Test 3: Time windows and archive members over HTTP...")
+        window = "SELECT count(*) FROM read_pcap('{}', start_ns := 1700000010000000000, end_ns := 1700000020000000000)"
+        ok &= check("zstd window", conn.execute(window.format(f"{base}/data/large.pcap.zst")).fetchone(),
+                    conn.execute(window.format(f"{scratch}/large.pcap.zst")).fetchone())
+        for name in ["captures.zip/**", "captures.tar/day1/*", "captures.tgz/**/*.pcap"]:
+            local = conn.execute(summary.format(f"{DATA_DIR}/{name}")).fetchone()
+            ok &= check(name, conn.execute(summary.format(f"{base}/data/{name}")).fetchone(), local)
+
+        print("Test 4: A server that ignores ranges...")
+        for name in ["test.pcap.gz", "captures.tgz/day2/c.pcap"]:
+            local = conn.execute(summary.format(f"{DATA_DIR}/{name}")).fetchone()
+            ok &= check(name, conn.execute(summary.format(f"{base}/norange/{name}")).fetchone(), local)
+
+        print("Test 5: A server that sends ranges in parts...")
+        for name in ["test.pcap", "test.pcap.gz", "test_large.pcap"]:
+            local = conn.execute(summary.format(f"{DATA_DIR}/{name}")).fetchone()
+            ok &= check(name, conn.execute(summary.format(f"{base}/short/{name}")).fetchone(), local)
+        local = conn.execute(summary.format(f"{scratch}/big.pcap")).fetchone()
+        ok &= check("big.pcap", conn.execute(summary.format(f"{base}/short/big.pcap")).fetchone(), local)
+
+        print("Test 6: Signed requests to an S3-compatible endpoint...")
+        local = conn.execute(summary.format(f"{DATA_DIR}/test.pcap.gz")).fetchone()
+        ok &= check("s3 read", conn.execute(summary.format("s3://bucket/test.pcap.gz")).fetchone(), local)
+        os.environ["AWS_SECRET_ACCESS_KEY"] = "wrong"
+        try:
+            conn.execute(summary.format("s3://bucket/test.pcap.gz")).fetchone()
+            ok &= check("bad signature rejected", False, True)
+        except duckdb.Error as e:
+            ok &= check("bad signature rejected", "Failed to open pcap file" in str(e), True)
+
+        print("Test 7: Missing files...")
+        try:
+            conn.execute(summary.format(f"{base}/data/missing.pcap")).fetchone()
+            ok &= check("missing file", False, True)
+        except duckdb.Error as e:
+            ok &= check("missing file", "Failed to open pcap file" in str(e), True)
+    finally:
+        server.shutdown()
+        shutil.rmtree(scratch, ignore_errors=True)
+    return ok
+
+
+if __name__ == "__main__":
+    extension = sys.argv[1] if len(sys.argv) > 1 else "build/debug/duckdb_pcap.duckdb_extension"
+    if not os.path.exists(extension):
+        print(f"ERROR: Extension {extension} not found. Run 'make debug' first.")
+        sys.exit(1)
+    print("Testing PCAP reading over HTTP...")
+    if test_http(extension):
+        print("\nAll tests passed!")
+        sys.exit(0)
+    print("\nTests failed!")
+    sys.exit(1)
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Test the I/O scheduler under contention: concurrent read_pcap queries with
+pcap_io_slots(1), checking which finishes first.
+
+The captures are gzip files of 64 KiB zero-filled packets, so a scan decodes
+hundreds of MiB (and runs for a while) from a file of a few hundred KiB.
+"""
+
+import gzip
+import os
+import shutil
+import struct
+import sys
+import tempfile
+import threading
+import time
+
+MEMBER_PACKETS = 256  # 16 MiB of packets per gzip member
+
+
+def write_zero_pcap_gz(path, members):
+    """A gzip capture of members * 16 MiB of packet data"""
+    record = struct.pack("<IIII", 1700000000, 0, 65535, 65535) + bytes(65535)
+    member = gzip.compress(record * MEMBER_PACKETS, compresslevel=9)
+    with open(path, "wb") as f:
+        f.write(gzip.compress(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1)))
+        for _ in range(members):
+            f.write(member)
+
+
+def check(name, actual, expected):
+    if actual != expected:
+        print(f"  FAILED: {name}: expected {expected}, got {actual}")
+        return False
+    print(f"  SUCCESS: {name}")
+    return True
+
+
+def race(conn, scans):
+    """Run (name, query, delay) scans on their own threads, each started delay
+    seconds after the first; returns the names in order of completion"""
+    finished = []
+    errors = []
+
+    def run(name, query, delay):
+        cursor = conn.cursor()
+        try:
+            time.sleep(delay)
+            cursor.execute(query).fetchall()
+            finished.append(name)
+        except Exception as e:  # reported by the caller
+            errors.append(f"{name}: {e}")
+        finally:
+            cursor.close()
+
+    threads = [threading.Thread(target=run, args=scan) for scan in scans]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return errors or finished
+
+
+def test_io_scheduler(extension_path):
+    import duckdb
+
+    scratch = tempfile.mkdtemp()
+    conn = duckdb.connect(config={"allow_unsigned_extensions": True})
+    conn.execute(f"LOAD '{extension_path}'")
+    # One thread per query, so the scheduler alone decides who reads
+    conn.execute("SET threads = 1")
+    ok = True
+    try:
+        medium = f"{scratch}/medium.pcap.gz"   # 256 MiB
+        large = f"{scratch}/large.pcap.gz"     # 512 MiB
+        small = f"{scratch}/small.pcap.gz"     # 32 MiB, below the small-scan size
+        write_zero_pcap_gz(medium, 16)
+        write_zero_pcap_gz(large, 32)
+        write_zero_pcap_gz(small, 2)
+
+        def scan(path, share):
+            return f"SELECT count(*) FROM read_pcap('{path}', io_share := {share})"
+
+        print("Test 1: Throughput is split by io_share...")
+        ok &= check("previous slots", conn.execute("SELECT pcap_io_slots(1)").fetchall(), [(0,)])
+        # The batch scan starts first, but the one with ten times its share
+        # reads ten of every eleven units from then on
+        order = race(conn, [("batch", scan(medium, 1), 0), ("interactive", scan(medium, 10), 0.1)])
+        ok &= check("completion order", order, ["interactive", "batch"])
+
+        print("Test 2: Small scans go first...")
+        # By its cost per share the small scan would wait for the large one
+        # to finish; it is served first while it has decoded less than 64 MiB
+        order = race(conn, [("large", scan(large, 1000), 0), ("small", scan(small, 1), 0.3)])
+        ok &= check("completion order", order, ["small", "large"])
+
+        print("Test 3: Without a slot limit no scan is held back...")
+        ok &= check("previous slots", conn.execute("SELECT pcap_io_slots(0)").fetchall(), [(1,)])
+        order = race(conn, [("batch", scan(medium, 1), 0), ("interactive", scan(medium, 10), 0.1)])
+        ok &= check("completion order", order, ["batch", "interactive"])
+    finally:
+        conn.execute("SELECT pcap_io_slots(0)")
+        shutil.rmtree(scratch, ignore_errors=True)
+    return ok
+
+
+if __name__ == "__main__":
+    extension = sys.argv[1] if len(sys.argv) > 1 else "build/debug/duckdb_pcap.duckdb_extension"
+    if not os.path.exists(extension):
+        print(f"ERROR: Extension {extension} not found. Run 'make debug' first.")
+        sys.exit(1)
+    print("Testing the I/O scheduler...")
+    if test_io_scheduler(extension):
+        print("\nAll tests passed!")
+        sys.exit(0)
+    print("\nTests failed!")
+    sys.exit(1)
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Test shared scans: concurrent read_pcap queries with shared := true over
+one capture, started at different points of each other's scans.
+
+Each query is held open part way through its result while the others read
+on, so that later queries join a scan in progress (and wrap around to where
+they joined) and the ones held back fall behind it.
+"""
+
+import os
+import shutil
+import struct
+import sys
+import tempfile
+
+PACKETS = 100000
+
+
+def write_numbered_pcap(path, packets=PACKETS):
+    """A capture of many batches whose packets start with their number"""
+    with open(path, "wb") as f:
+        f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i in range(packets):
+            f.write(struct.pack("<IIII", 1700000000 + i // 1000, (i % 1000) * 1000, 64, 64))
+            f.write(struct.pack("<Q", i) * 8)
+
+
+def numbers(rows):
+    return [struct.unpack("<Q", data[:8])[0] for data, in rows]
+
+
+def check(name, actual, expected):
+    if actual != expected:
+        print(f"  FAILED: {name}: expected {expected}, got {actual}")
+        return False
+    print(f"  SUCCESS: {name}")
+    return True
+
+
+def test_shared(extension_path):
+    import duckdb
+
+    scratch = tempfile.mkdtemp()
+    conn = duckdb.connect(config={"allow_unsigned_extensions": True})
+    conn.execute(f"LOAD '{extension_path}'")
+    ok = True
+    try:
+        path = f"{scratch}/numbered.pcap"
+        write_numbered_pcap(path)
+        query = f"SELECT data FROM read_pcap('{path}', shared := true)"
+
+        print("Test 1: Readers joining a scan in progress see every packet once...")
+        first, second, third = conn.cursor(), conn.cursor(), conn.cursor()
+        first.execute(query)
+        rows_first = first.fetchmany(30000)
+        second.execute(query)
+        rows_second = second.fetchmany(5000)
+        rows_first += first.fetchmany(10000)
+        # Runs to the end while the others wait, leaving them behind
+        third.execute(query)
+        rows_third = third.fetchall()
+        rows_second += second.fetchall()
+        rows_first += first.fetchall()
+        for name, rows in (("first", rows_first), ("second", rows_second), ("third", rows_third)):
+            seen = numbers(rows)
+            ok &= check(f"{name} reader", (len(seen), sorted(seen) == list(range(PACKETS))), (PACKETS, True))
+        ok &= check("late reader wrapped around", numbers(rows_second)[0] > 0, True)
+
+        print("Test 2: A reader after the scan ended starts a new one...")
+        for cursor in (first, second, third):
+            cursor.close()
+        ok &= check("new scan", numbers(conn.execute(query).fetchall()), list(range(PACKETS)))
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+    return ok
+
+
+if __name__ == "__main__":
+    extension = sys.argv[1] if len(sys.argv) > 1 else "build/debug/duckdb_pcap.duckdb_extension"
+    if not os.path.exists(extension):
+        print(f"ERROR: Extension {extension} not found. Run 'make debug' first.")
+        sys.exit(1)
+    print("Testing shared scans...")
+    if test_shared(extension):
+        print("\nAll tests passed!")
+        sys.exit(0)
+    print("\nTests failed!")
+    sys.exit(1)